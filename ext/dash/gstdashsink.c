@@ -72,6 +72,27 @@
  * The current implementation is generating compliant MPDs for both static and dynamic
  * profiles with  https://conformance.dashif.org/
  *
+ * Low latency:
+ *
+ * With the MP4 muxer, #GstDashSink:chunk-duration makes each segment a
+ * sequence of CMAF chunks (one moof/mdat pair per chunk), which are written to
+ * the fragment stream as soon as the muxer produces them. In a dynamic MPD the
+ * segment templates then advertise an availabilityTimeOffset so that clients
+ * can fetch a segment while it is still being written.
+ *
+ * The offset is derived from the largest delay measured between the start
+ * of a segment and its first bytes being written, and is only advertised
+ * once the first segment has been written. splitmuxsink holds each GOP back
+ * until the next keyframe arrives, so a segment becomes available at least
+ * one GOP after its start, not one chunk: with 2 second segments and 1
+ * second GOPs, clients can fetch a segment 1 second before it is complete.
+ * Short GOPs are needed for a latency close to the chunk duration.
+ *
+ * With #GstDashSink:use-segment-timeline, segments are listed in a
+ * SegmentTimeline with their exact duration. In a dynamic MPD, the timeline
+ * only lists the last #GstDashSink:timeline-length segments. The MPD is
+ * serialized in full at each update; the bounded timeline keeps it small.
+ *
  * Limitations:
  *
  * The fragments during the DASH generation does not look reliable enough to be used as
@@ -160,6 +181,12 @@ static const DashSinkMuxer dash_muxer_list[] = {
 #define DEFAULT_MPD_USE_SEGMENT_LIST FALSE
 #define DEFAULT_MPD_MIN_BUFFER_TIME 2000
 #define DEFAULT_MPD_PERIOD_DURATION GST_CLOCK_TIME_NONE
+#define DEFAULT_CHUNK_DURATION 0
+#define DEFAULT_USE_SEGMENT_TIMELINE FALSE
+#define DEFAULT_TIMELINE_LENGTH 5
+
+/* timescale of the SegmentTimeline entries */
+#define DASH_SINK_TIMELINE_TIMESCALE 1000
 
 #define DEFAULT_DASH_SINK_MUXER GST_DASH_SINK_MUXER_TS
 
@@ -184,6 +211,9 @@ enum
   PROP_MPD_MIN_BUFFER_TIME,
   PROP_MPD_BASEURL,
   PROP_MPD_PERIOD_DURATION,
+  PROP_CHUNK_DURATION,
+  PROP_USE_SEGMENT_TIMELINE,
+  PROP_TIMELINE_LENGTH,
 };
 
 enum
@@ -250,6 +280,9 @@ struct _GstDashSink
   guint64 minimum_update_period;
   guint64 min_buffer_time;
   gint64 period_duration;
+  guint chunk_duration;
+  gboolean use_segment_timeline;
+  guint timeline_length;
 };
 
 typedef struct _GstDashSinkStream
@@ -268,8 +301,18 @@ typedef struct _GstDashSinkStream
   gint bitrate;
   gchar *codec;
   GstClockTime current_running_time_start;
+  GstClockTime current_running_time_end;
   GstDashSinkStreamInfo info;
   GstElement *giostreamsink;
+  gint write_probe;
+
+  /* Running time of the last input buffer, and the largest delay measured
+   * between the start of a segment and its first bytes being written.
+   * Protected by the object lock */
+  GstSegment segment;
+  GstClockTime input_running_time;
+  gboolean first_write_pending;
+  GstClockTime write_delay;
 } GstDashSinkStream;
 
 static GstStaticPadTemplate video_sink_template =
@@ -539,6 +582,52 @@ gst_dash_sink_class_init (GstDashSinkClass * klass)
           G_MAXUINT64, DEFAULT_MPD_PERIOD_DURATION,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstDashSink:chunk-duration:
+   *
+   * Duration in milliseconds of the CMAF chunks of a segment. Each chunk is
+   * written as soon as the muxer has produced it, and a dynamic MPD
+   * advertises the segments as available once their first chunk is.
+   * Only used with the MP4 muxer.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_CHUNK_DURATION,
+      g_param_spec_uint ("chunk-duration", "Chunk duration",
+          "Duration in milliseconds of the CMAF chunks of a segment "
+          "(0 - disabled, MP4 muxer only)", 0, G_MAXUINT,
+          DEFAULT_CHUNK_DURATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstDashSink:use-segment-timeline:
+   *
+   * List the segments of a segment template in a SegmentTimeline with their
+   * exact duration, instead of announcing the target duration.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_USE_SEGMENT_TIMELINE,
+      g_param_spec_boolean ("use-segment-timeline", "Use segment timeline",
+          "Use a segment timeline in the segment template to describe the "
+          "segments", DEFAULT_USE_SEGMENT_TIMELINE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstDashSink:timeline-length:
+   *
+   * Number of segments listed in the segment timeline of a dynamic MPD.
+   * Older segments are removed from the timeline and the start number of
+   * the segment template is advanced. If set to 0, the timeline lists all
+   * the segments.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_TIMELINE_LENGTH,
+      g_param_spec_uint ("timeline-length", "Timeline length",
+          "Number of segments in the segment timeline of a dynamic MPD "
+          "(0 - unlimited)", 0, G_MAXUINT, DEFAULT_TIMELINE_LENGTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstDashSink::get-playlist-stream:
    * @sink: the #GstDashSink
@@ -621,16 +710,66 @@ on_format_location (GstElement * splitmuxsink, guint fragment_id,
   return NULL;
 }
 
+static gboolean
+gst_dash_sink_uses_chunks (GstDashSink * sink)
+{
+  return sink->muxer == GST_DASH_SINK_MUXER_MP4 && sink->chunk_duration > 0;
+}
+
+/* Measures how long after the start of a segment its first bytes are
+ * written. splitmuxsink holds each GOP back until the next keyframe, so
+ * this is at least a GOP, whatever the chunk duration */
+static GstPadProbeReturn
+_dash_sink_write_probe (GstPad * pad, GstPadProbeInfo * probe_info,
+    gpointer user_data)
+{
+  GstDashSinkStream *stream = (GstDashSinkStream *) user_data;
+  GstDashSink *sink = stream->sink;
+
+  GST_OBJECT_LOCK (sink);
+  if (stream->first_write_pending
+      && GST_CLOCK_TIME_IS_VALID (stream->input_running_time)
+      && GST_CLOCK_TIME_IS_VALID (stream->current_running_time_start)) {
+    GstClockTime delay = 0;
+
+    if (stream->input_running_time > stream->current_running_time_start)
+      delay = stream->input_running_time - stream->current_running_time_start;
+
+    if (!GST_CLOCK_TIME_IS_VALID (stream->write_delay)
+        || delay > stream->write_delay) {
+      GST_INFO_OBJECT (sink, "Segment %d of %s written %" GST_TIME_FORMAT
+          " after its start", stream->current_segment_id,
+          stream->representation_id, GST_TIME_ARGS (delay));
+      stream->write_delay = delay;
+    }
+  }
+  stream->first_write_pending = FALSE;
+  GST_OBJECT_UNLOCK (sink);
+
+  return GST_PAD_PROBE_OK;
+}
+
 static gboolean
 gst_dash_sink_add_splitmuxsink (GstDashSink * sink, GstDashSinkStream * stream)
 {
+  GstPad *pad;
+
   GstElement *mux =
       gst_element_factory_make (dash_muxer_list[sink->muxer].element_name,
       NULL);
 
-  if (sink->muxer == GST_DASH_SINK_MUXER_MP4)
+  if (gst_dash_sink_uses_chunks (sink)) {
+    /* Every moof/mdat pair of the fragmented output is a chunk, pushed to
+     * the fragment stream as soon as it is complete */
+    g_object_set (mux, "fragment-duration", sink->chunk_duration,
+        "streamable", TRUE, NULL);
+  } else if (sink->muxer == GST_DASH_SINK_MUXER_MP4) {
     g_object_set (mux, "fragment-duration", sink->target_duration * GST_MSECOND,
         NULL);
+  } else if (sink->chunk_duration > 0) {
+    GST_WARNING_OBJECT (sink, "chunk-duration is only supported with the "
+        "MP4 muxer");
+  }
 
   g_return_val_if_fail (mux != NULL, FALSE);
 
@@ -648,6 +787,12 @@ gst_dash_sink_add_splitmuxsink (GstDashSink * sink, GstDashSinkStream * stream)
 
   gst_bin_add (GST_BIN (sink), stream->splitmuxsink);
 
+  pad = gst_element_get_static_pad (stream->giostreamsink, "sink");
+  stream->write_probe = gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      _dash_sink_write_probe, stream, NULL);
+  gst_object_unref (pad);
+
   if (!sink->use_segment_list)
     stream->current_segment_id = 1;
   else
@@ -680,6 +825,9 @@ gst_dash_sink_init (GstDashSink * sink)
 
   sink->min_buffer_time = DEFAULT_MPD_MIN_BUFFER_TIME;
   sink->period_duration = DEFAULT_MPD_PERIOD_DURATION;
+  sink->chunk_duration = DEFAULT_CHUNK_DURATION;
+  sink->use_segment_timeline = DEFAULT_USE_SEGMENT_TIMELINE;
+  sink->timeline_length = DEFAULT_TIMELINE_LENGTH;
 
   g_mutex_init (&sink->mpd_lock);
 
@@ -734,6 +882,68 @@ gst_dash_sink_get_stream_metadata (GstDashSink * sink,
   gst_caps_unref (caps);
 }
 
+/* Adds the last closed segment of @stream to its SegmentTimeline, keeping
+ * only the last timeline-length segments in a dynamic MPD */
+static void
+gst_dash_sink_add_segment_timeline_entry (GstDashSink * sink,
+    GstDashSinkStream * stream)
+{
+  guint64 t, d;
+
+  t = gst_util_uint64_scale (stream->current_running_time_start,
+      DASH_SINK_TIMELINE_TIMESCALE, GST_SECOND);
+  d = gst_util_uint64_scale (stream->current_running_time_end,
+      DASH_SINK_TIMELINE_TIMESCALE, GST_SECOND) - t;
+
+  gst_mpd_client_add_segment_timeline_entry (sink->mpd_client,
+      sink->current_period_id, stream->adaptation_set_id,
+      stream->representation_id, t, d);
+
+  if (sink->is_dynamic && sink->timeline_length > 0)
+    gst_mpd_client_trim_segment_timeline (sink->mpd_client,
+        sink->current_period_id, stream->adaptation_set_id,
+        stream->representation_id, sink->timeline_length);
+}
+
+/* Advertises segments as available as soon as their first chunk is written,
+ * which is known once the first segment has been written */
+static void
+gst_dash_sink_set_availability (GstDashSink * sink, GstDashSinkStream * stream)
+{
+  GstClockTime duration = sink->target_duration * GST_SECOND;
+  GstClockTime delay;
+  gdouble offset = 0;
+
+  if (!sink->is_dynamic || !gst_dash_sink_uses_chunks (sink))
+    return;
+
+  GST_OBJECT_LOCK (sink);
+  delay = stream->write_delay;
+  GST_OBJECT_UNLOCK (sink);
+
+  if (!GST_CLOCK_TIME_IS_VALID (delay))
+    return;
+
+  delay = MAX (delay, sink->chunk_duration * GST_MSECOND);
+  if (delay < duration)
+    offset = (duration - delay) / (gdouble) GST_SECOND;
+
+  GST_DEBUG_OBJECT (sink, "%s segments available %" GST_TIME_FORMAT
+      " after their start", stream->representation_id, GST_TIME_ARGS (delay));
+
+  if (sink->use_segment_list) {
+    gst_mpd_client_set_segment_list (sink->mpd_client,
+        sink->current_period_id, stream->adaptation_set_id,
+        stream->representation_id, "availability-time-offset", offset,
+        "availability-time-complete", FALSE, NULL);
+  } else {
+    gst_mpd_client_set_segment_template (sink->mpd_client,
+        sink->current_period_id, stream->adaptation_set_id,
+        stream->representation_id, "availability-time-offset", offset,
+        "availability-time-complete", FALSE, NULL);
+  }
+}
+
 static void
 gst_dash_sink_generate_mpd_content (GstDashSink * sink,
     GstDashSinkStream * stream)
@@ -804,12 +1014,20 @@ gst_dash_sink_generate_mpd_content (GstDashSink * sink,
         gchar *media_segment_template =
             g_strconcat (stream->representation_id, "_$Number$",
             ".", dash_muxer_list[sink->muxer].file_ext, NULL);
-        gst_mpd_client_set_segment_template (sink->mpd_client,
-            sink->current_period_id, stream->adaptation_set_id,
-            stream->representation_id, "media", media_segment_template,
-            "duration", sink->target_duration, NULL);
+        if (sink->use_segment_timeline) {
+          gst_mpd_client_set_segment_template (sink->mpd_client,
+              sink->current_period_id, stream->adaptation_set_id,
+              stream->representation_id, "media", media_segment_template,
+              "timescale", DASH_SINK_TIMELINE_TIMESCALE, NULL);
+        } else {
+          gst_mpd_client_set_segment_template (sink->mpd_client,
+              sink->current_period_id, stream->adaptation_set_id,
+              stream->representation_id, "media", media_segment_template,
+              "duration", sink->target_duration, NULL);
+        }
         g_free (media_segment_template);
       }
+      gst_dash_sink_set_availability (sink, stream);
     }
   }
   /* MPD updates */
@@ -820,6 +1038,10 @@ gst_dash_sink_generate_mpd_content (GstDashSink * sink,
         stream->adaptation_set_id, stream->representation_id, "media",
         stream->current_segment_location, NULL);
   } else {
+    if (sink->use_segment_timeline && stream)
+      gst_dash_sink_add_segment_timeline_entry (sink, stream);
+    if (stream)
+      gst_dash_sink_set_availability (sink, stream);
     if (!sink->is_dynamic) {
       if (sink->period_duration != DEFAULT_MPD_PERIOD_DURATION)
         gst_mpd_client_set_period_node (sink->mpd_client,
@@ -907,14 +1129,20 @@ gst_dash_sink_handle_message (GstBin * bin, GstMessage * message)
           GST_ELEMENT (message->src));
       if (stream) {
         if (gst_structure_has_name (s, "splitmuxsink-fragment-opened")) {
+          GstClockTime running_time;
+
           gst_dash_sink_get_stream_metadata (sink, stream);
-          gst_structure_get_clock_time (s, "running-time",
-              &stream->current_running_time_start);
+          gst_structure_get_clock_time (s, "running-time", &running_time);
+          GST_OBJECT_LOCK (sink);
+          stream->current_running_time_start = running_time;
+          stream->first_write_pending = TRUE;
+          GST_OBJECT_UNLOCK (sink);
         } else if (gst_structure_has_name (s, "splitmuxsink-fragment-closed")) {
           GstClockTime running_time;
           gst_structure_get_clock_time (s, "running-time", &running_time);
           if (sink->running_time < running_time)
             sink->running_time = running_time;
+          stream->current_running_time_end = running_time;
           gst_dash_sink_write_mpd_file (sink, stream);
         }
       }
@@ -935,14 +1163,35 @@ static GstPadProbeReturn
 _dash_sink_buffers_probe (GstPad * pad, GstPadProbeInfo * probe_info,
     gpointer user_data)
 {
-  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (probe_info);
   GstDashSinkStream *stream = (GstDashSinkStream *) user_data;
+  GstBuffer *buffer;
+
+  if (GST_PAD_PROBE_INFO_TYPE (probe_info) &
+      GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (probe_info);
+
+    if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT)
+      gst_event_copy_segment (event, &stream->segment);
+    return GST_PAD_PROBE_OK;
+  }
 
+  buffer = GST_PAD_PROBE_INFO_BUFFER (probe_info);
   if (GST_BUFFER_DURATION (buffer))
     stream->bitrate =
         gst_buffer_get_size (buffer) * GST_SECOND /
         GST_BUFFER_DURATION (buffer);
 
+  if (stream->segment.format == GST_FORMAT_TIME
+      && GST_BUFFER_PTS_IS_VALID (buffer)) {
+    GstClockTime running_time = gst_segment_to_running_time (&stream->segment,
+        GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+
+    GST_OBJECT_LOCK (stream->sink);
+    if (GST_CLOCK_TIME_IS_VALID (running_time))
+      stream->input_running_time = running_time;
+    GST_OBJECT_UNLOCK (stream->sink);
+  }
+
   return GST_PAD_PROBE_OK;
 }
 
@@ -958,6 +1207,10 @@ gst_dash_sink_request_new_pad (GstElement * element, GstPadTemplate * templ,
 
   stream = g_new0 (GstDashSinkStream, 1);
   stream->sink = g_object_ref (sink);
+  gst_segment_init (&stream->segment, GST_FORMAT_UNDEFINED);
+  stream->input_running_time = GST_CLOCK_TIME_NONE;
+  stream->current_running_time_start = GST_CLOCK_TIME_NONE;
+  stream->write_delay = GST_CLOCK_TIME_NONE;
   if (g_str_has_prefix (templ->name_template, "video")) {
     stream->type = DASH_SINK_STREAM_TYPE_VIDEO;
     stream->adaptation_set_id = ADAPTATION_SET_ID_VIDEO;
@@ -1002,7 +1255,8 @@ gst_dash_sink_request_new_pad (GstElement * element, GstPadTemplate * templ,
   stream->pad = pad;
 
   stream->buffer_probe = gst_pad_add_probe (stream->pad,
-      GST_PAD_PROBE_TYPE_BUFFER, _dash_sink_buffers_probe, stream, NULL);
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      _dash_sink_buffers_probe, stream, NULL);
 
   sink->streams = g_list_append (sink->streams, stream);
   GST_DEBUG_OBJECT (sink, "Adding a new stream with id %s",
@@ -1117,6 +1371,15 @@ gst_dash_sink_set_property (GObject * object, guint prop_id,
     case PROP_MPD_PERIOD_DURATION:
       sink->period_duration = g_value_get_uint64 (value);
       break;
+    case PROP_CHUNK_DURATION:
+      sink->chunk_duration = g_value_get_uint (value);
+      break;
+    case PROP_USE_SEGMENT_TIMELINE:
+      sink->use_segment_timeline = g_value_get_boolean (value);
+      break;
+    case PROP_TIMELINE_LENGTH:
+      sink->timeline_length = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1163,6 +1426,15 @@ gst_dash_sink_get_property (GObject * object, guint prop_id,
     case PROP_MPD_PERIOD_DURATION:
       g_value_set_uint64 (value, sink->period_duration);
       break;
+    case PROP_CHUNK_DURATION:
+      g_value_set_uint (value, sink->chunk_duration);
+      break;
+    case PROP_USE_SEGMENT_TIMELINE:
+      g_value_set_boolean (value, sink->use_segment_timeline);
+      break;
+    case PROP_TIMELINE_LENGTH:
+      g_value_set_uint (value, sink->timeline_length);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
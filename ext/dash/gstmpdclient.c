@@ -3391,3 +3391,113 @@ gst_mpd_client_add_segment_url (GstMPDClient * client,
 
   return TRUE;
 }
+
+/* add an S node to the SegmentTimeline of a SegmentTemplate node */
+gboolean
+gst_mpd_client_add_segment_timeline_entry (GstMPDClient * client,
+    gchar * period_id, guint adap_set_id, gchar * rep_id, guint64 t,
+    guint64 d)
+{
+  GstMPDRepresentationNode *representation = NULL;
+  GstMPDAdaptationSetNode *adaptation_set = NULL;
+  GstMPDPeriodNode *period = NULL;
+  GstMPDMultSegmentBaseNode *mult_seg_base;
+  GstMPDSNode *s_node;
+
+  g_return_val_if_fail (client != NULL, FALSE);
+  g_return_val_if_fail (client->mpd_root_node != NULL, FALSE);
+
+  period =
+      GST_MPD_PERIOD_NODE (gst_mpd_client_get_period_with_id
+      (client->mpd_root_node->Periods, period_id));
+  adaptation_set =
+      GST_MPD_ADAPTATION_SET_NODE (gst_mpd_client_get_adaptation_set_with_id
+      (period->AdaptationSets, adap_set_id));
+  g_return_val_if_fail (adaptation_set != NULL, FALSE);
+
+  representation =
+      GST_MPD_REPRESENTATION_NODE (gst_mpd_client_get_representation_with_id
+      (adaptation_set->Representations, rep_id));
+  g_return_val_if_fail (representation->SegmentTemplate != NULL, FALSE);
+
+  mult_seg_base = GST_MPD_MULT_SEGMENT_BASE_NODE
+      (representation->SegmentTemplate);
+  if (!mult_seg_base->SegmentTimeline)
+    mult_seg_base->SegmentTimeline = gst_mpd_segment_timeline_node_new ();
+
+  s_node = gst_mpd_s_node_new ();
+  s_node->t = t;
+  s_node->d = d;
+  g_queue_push_tail (&mult_seg_base->SegmentTimeline->S, s_node);
+
+  return TRUE;
+}
+
+/* remove the oldest S nodes of the SegmentTimeline of a SegmentTemplate node
+ * so that it describes at most max_segments segments, and advance its
+ * startNumber accordingly. Returns the number of segments removed */
+guint
+gst_mpd_client_trim_segment_timeline (GstMPDClient * client,
+    gchar * period_id, guint adap_set_id, gchar * rep_id, guint max_segments)
+{
+  GstMPDRepresentationNode *representation = NULL;
+  GstMPDAdaptationSetNode *adaptation_set = NULL;
+  GstMPDPeriodNode *period = NULL;
+  GstMPDMultSegmentBaseNode *mult_seg_base;
+  GQueue *timeline;
+  guint n_segments = 0, removed = 0;
+  GList *l;
+
+  g_return_val_if_fail (client != NULL, 0);
+  g_return_val_if_fail (client->mpd_root_node != NULL, 0);
+
+  period =
+      GST_MPD_PERIOD_NODE (gst_mpd_client_get_period_with_id
+      (client->mpd_root_node->Periods, period_id));
+  adaptation_set =
+      GST_MPD_ADAPTATION_SET_NODE (gst_mpd_client_get_adaptation_set_with_id
+      (period->AdaptationSets, adap_set_id));
+  g_return_val_if_fail (adaptation_set != NULL, 0);
+
+  representation =
+      GST_MPD_REPRESENTATION_NODE (gst_mpd_client_get_representation_with_id
+      (adaptation_set->Representations, rep_id));
+  g_return_val_if_fail (representation->SegmentTemplate != NULL, 0);
+
+  mult_seg_base = GST_MPD_MULT_SEGMENT_BASE_NODE
+      (representation->SegmentTemplate);
+  if (!mult_seg_base->SegmentTimeline)
+    return 0;
+
+  timeline = &mult_seg_base->SegmentTimeline->S;
+  for (l = timeline->head; l; l = l->next)
+    n_segments += MAX (((GstMPDSNode *) l->data)->r, 0) + 1;
+
+  while (n_segments > max_segments) {
+    GstMPDSNode *s_node = g_queue_peek_head (timeline);
+
+    if (s_node->r > 0) {
+      /* the next repetition now starts the entry */
+      s_node->t += s_node->d;
+      s_node->r--;
+    } else {
+      GstMPDSNode *next;
+
+      g_queue_pop_head (timeline);
+      /* an S node without t starts where the previous one ends */
+      next = g_queue_peek_head (timeline);
+      if (next && next->t == 0)
+        next->t = s_node->t + s_node->d;
+      gst_mpd_s_node_free (s_node);
+    }
+    n_segments--;
+    removed++;
+  }
+
+  /* an absent startNumber is 1 */
+  if (removed)
+    mult_seg_base->startNumber =
+        MAX (mult_seg_base->startNumber, 1) + removed;
+
+  return removed;
+}
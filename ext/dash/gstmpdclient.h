@@ -183,6 +183,17 @@ gboolean gst_mpd_client_add_segment_url (GstMPDClient * client,
                                          gchar * rep_id,
                                          const gchar * property_name,
                                          ...);
+gboolean gst_mpd_client_add_segment_timeline_entry (GstMPDClient * client,
+                                                    gchar * period_id,
+                                                    guint adap_set_id,
+                                                    gchar * rep_id,
+                                                    guint64 t,
+                                                    guint64 d);
+guint gst_mpd_client_trim_segment_timeline (GstMPDClient * client,
+                                            gchar * period_id,
+                                            guint adap_set_id,
+                                            gchar * rep_id,
+                                            guint max_segments);
 G_END_DECLS
 
 #endif /* __GST_MPDCLIENT_H__ */
@@ -29,8 +29,22 @@ enum
   PROP_MPD_MULT_SEGMENT_BASE_0 = 100,
   PROP_MPD_MULT_SEGMENT_BASE_DURATION,
   PROP_MPD_MULT_SEGMENT_BASE_START_NUMBER,
+  PROP_MPD_MULT_SEGMENT_BASE_TIMESCALE,
+  PROP_MPD_MULT_SEGMENT_BASE_AVAILABILITY_TIME_OFFSET,
+  PROP_MPD_MULT_SEGMENT_BASE_AVAILABILITY_TIME_COMPLETE,
 };
 
+/* The SegmentBaseType attributes live in the SegmentBase extension */
+static GstMPDSegmentBaseNode *
+gst_mpd_mult_segment_base_node_get_segment_base (GstMPDMultSegmentBaseNode *
+    self)
+{
+  if (!self->SegmentBase)
+    self->SegmentBase = gst_mpd_segment_base_node_new ();
+
+  return self->SegmentBase;
+}
+
 /* GObject VMethods */
 
 static void
@@ -45,6 +59,18 @@ gst_mpd_mult_segment_base_node_set_property (GObject * object, guint prop_id,
     case PROP_MPD_MULT_SEGMENT_BASE_START_NUMBER:
       self->startNumber = g_value_get_uint (value);
       break;
+    case PROP_MPD_MULT_SEGMENT_BASE_TIMESCALE:
+      gst_mpd_mult_segment_base_node_get_segment_base (self)->timescale =
+          g_value_get_uint (value);
+      break;
+    case PROP_MPD_MULT_SEGMENT_BASE_AVAILABILITY_TIME_OFFSET:
+      gst_mpd_mult_segment_base_node_get_segment_base
+          (self)->availabilityTimeOffset = g_value_get_double (value);
+      break;
+    case PROP_MPD_MULT_SEGMENT_BASE_AVAILABILITY_TIME_COMPLETE:
+      gst_mpd_mult_segment_base_node_get_segment_base
+          (self)->availabilityTimeComplete = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -63,6 +89,19 @@ gst_mpd_mult_segment_base_node_get_property (GObject * object, guint prop_id,
     case PROP_MPD_MULT_SEGMENT_BASE_START_NUMBER:
       g_value_set_uint (value, self->startNumber);
       break;
+    case PROP_MPD_MULT_SEGMENT_BASE_TIMESCALE:
+      g_value_set_uint (value,
+          self->SegmentBase ? self->SegmentBase->timescale : 0);
+      break;
+    case PROP_MPD_MULT_SEGMENT_BASE_AVAILABILITY_TIME_OFFSET:
+      g_value_set_double (value,
+          self->SegmentBase ? self->SegmentBase->availabilityTimeOffset : 0);
+      break;
+    case PROP_MPD_MULT_SEGMENT_BASE_AVAILABILITY_TIME_COMPLETE:
+      g_value_set_boolean (value,
+          self->SegmentBase ? self->SegmentBase->availabilityTimeComplete :
+          TRUE);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -96,9 +135,36 @@ gst_mpd_mult_segment_base_get_xml_node (GstMPDNode * node,
   if (self->startNumber)
     gst_xml_helper_set_prop_uint (mult_segment_base_node, "startNumber",
         self->startNumber);
-  if (self->SegmentBase)
-    gst_mpd_node_add_child_node (GST_MPD_NODE (self->SegmentBase),
-        mult_segment_base_node);
+  if (self->SegmentBase) {
+    GstMPDSegmentBaseNode *base = self->SegmentBase;
+
+    /* MultipleSegmentBaseType extends SegmentBaseType, so its attributes
+     * and children go on this element rather than on a SegmentBase child */
+    if (base->timescale)
+      gst_xml_helper_set_prop_uint (mult_segment_base_node, "timescale",
+          base->timescale);
+    if (base->presentationTimeOffset)
+      gst_xml_helper_set_prop_uint64 (mult_segment_base_node,
+          "presentationTimeOffset", base->presentationTimeOffset);
+    if (base->indexRange) {
+      gst_xml_helper_set_prop_range (mult_segment_base_node, "indexRange",
+          base->indexRange);
+      gst_xml_helper_set_prop_boolean (mult_segment_base_node,
+          "indexRangeExact", base->indexRangeExact);
+    }
+    if (base->availabilityTimeOffset)
+      gst_xml_helper_set_prop_double (mult_segment_base_node,
+          "availabilityTimeOffset", base->availabilityTimeOffset);
+    if (!base->availabilityTimeComplete)
+      gst_xml_helper_set_prop_boolean (mult_segment_base_node,
+          "availabilityTimeComplete", FALSE);
+    if (base->Initialization)
+      gst_mpd_node_add_child_node (GST_MPD_NODE (base->Initialization),
+          mult_segment_base_node);
+    if (base->RepresentationIndex)
+      gst_mpd_node_add_child_node (GST_MPD_NODE (base->RepresentationIndex),
+          mult_segment_base_node);
+  }
   if (self->SegmentTimeline)
     gst_mpd_node_add_child_node (GST_MPD_NODE (self->SegmentTimeline),
         mult_segment_base_node);
@@ -129,6 +195,25 @@ gst_mpd_mult_segment_base_node_class_init (GstMPDMultSegmentBaseNodeClass *
       g_param_spec_uint ("start-number", "start number",
           "start number in the segment list", 0, G_MAXINT, 0,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class,
+      PROP_MPD_MULT_SEGMENT_BASE_TIMESCALE, g_param_spec_uint ("timescale",
+          "timescale", "timescale of the segment durations and times", 0,
+          G_MAXINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class,
+      PROP_MPD_MULT_SEGMENT_BASE_AVAILABILITY_TIME_OFFSET,
+      g_param_spec_double ("availability-time-offset",
+          "availability time offset",
+          "how much earlier in seconds the segments are available", 0,
+          G_MAXDOUBLE, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class,
+      PROP_MPD_MULT_SEGMENT_BASE_AVAILABILITY_TIME_COMPLETE,
+      g_param_spec_boolean ("availability-time-complete",
+          "availability time complete",
+          "whether the segments are complete at their availability time", TRUE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
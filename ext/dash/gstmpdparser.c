@@ -255,6 +255,7 @@ gst_mpdparser_parse_seg_base_type_ext (GstMPDSegmentBaseNode ** pointer,
   guint64 int64val;
   gboolean boolval;
   GstXMLRange *rangeval;
+  gdouble doubleval;
 
   gst_mpd_segment_base_node_free (*pointer);
   *pointer = seg_base_type = gst_mpd_segment_base_node_new ();
@@ -269,6 +270,8 @@ gst_mpdparser_parse_seg_base_type_ext (GstMPDSegmentBaseNode ** pointer,
     seg_base_type->presentationTimeOffset = parent->presentationTimeOffset;
     seg_base_type->indexRange = gst_xml_helper_clone_range (parent->indexRange);
     seg_base_type->indexRangeExact = parent->indexRangeExact;
+    seg_base_type->availabilityTimeOffset = parent->availabilityTimeOffset;
+    seg_base_type->availabilityTimeComplete = parent->availabilityTimeComplete;
     seg_base_type->Initialization =
         gst_mpd_url_type_node_clone (parent->Initialization);
     seg_base_type->RepresentationIndex =
@@ -296,6 +299,14 @@ gst_mpdparser_parse_seg_base_type_ext (GstMPDSegmentBaseNode ** pointer,
           FALSE, &boolval)) {
     seg_base_type->indexRangeExact = boolval;
   }
+  if (gst_xml_helper_get_prop_double (a_node, "availabilityTimeOffset",
+          &doubleval)) {
+    seg_base_type->availabilityTimeOffset = doubleval;
+  }
+  if (gst_xml_helper_get_prop_boolean (a_node, "availabilityTimeComplete",
+          TRUE, &boolval)) {
+    seg_base_type->availabilityTimeComplete = boolval;
+  }
 
   /* explore children nodes */
   for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
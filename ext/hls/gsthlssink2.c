@@ -34,6 +34,20 @@
  * Just point an external webserver to the directory with the playlist and
  * fragment files.
  *
+ * When #GstHlsSink2:part-duration is set, a Low-Latency HLS playlist is
+ * produced: each fragment is announced while it is being written as a
+ * sequence of partial segments (byte ranges of the fragment file), followed
+ * by a preload hint for the next one. Servers that implement blocking
+ * playlist reloads can use the #GstHlsSink2::playlist-updated signal to
+ * answer pending requests as soon as the playlist contains what they wait
+ * for.
+ *
+ * Note that splitmuxsink only passes a GOP on to the muxer once the next
+ * keyframe arrived, to decide which fragment it goes to. The partial
+ * segments of a GOP are therefore all announced at once, when the GOP
+ * after it starts, and the latency is at least a GOP. Low latency needs
+ * GOPs not much longer than #GstHlsSink2:part-duration.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 videotestsrc is-live=true ! x264enc ! h264parse ! hlssink2 max-files=5
@@ -62,6 +76,7 @@ GST_DEBUG_CATEGORY_STATIC (gst_hls_sink2_debug);
 #define DEFAULT_TARGET_DURATION 15
 #define DEFAULT_PLAYLIST_LENGTH 5
 #define DEFAULT_SEND_KEYFRAME_REQUESTS TRUE
+#define DEFAULT_PART_DURATION 0
 
 #define GST_M3U8_PLAYLIST_VERSION 3
 
@@ -75,6 +90,7 @@ enum
   PROP_TARGET_DURATION,
   PROP_PLAYLIST_LENGTH,
   PROP_SEND_KEYFRAME_REQUESTS,
+  PROP_PART_DURATION,
 };
 
 enum
@@ -82,11 +98,22 @@ enum
   SIGNAL_GET_PLAYLIST_STREAM,
   SIGNAL_GET_FRAGMENT_STREAM,
   SIGNAL_DELETE_FRAGMENT,
+  SIGNAL_PLAYLIST_UPDATED,
   SIGNAL_LAST
 };
 
 static guint signals[SIGNAL_LAST];
 
+/* A playlist rendered with the lock taken, written once it is released so
+ * that the signals involved can call back into the sink */
+struct _GstHlsSink2PlaylistUpdate
+{
+  guint64 serial;
+  gchar *content;
+  guint sequence_number;
+  guint n_parts;
+};
+
 static GstStaticPadTemplate video_template = GST_STATIC_PAD_TEMPLATE ("video",
     GST_PAD_SINK,
     GST_PAD_REQUEST,
@@ -110,6 +137,12 @@ static void gst_hls_sink2_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * spec);
 static void gst_hls_sink2_handle_message (GstBin * bin, GstMessage * message);
 static void gst_hls_sink2_reset (GstHlsSink2 * sink);
+static GstHlsSink2PlaylistUpdate *gst_hls_sink2_render_playlist (GstHlsSink2 *
+    sink);
+static void gst_hls_sink2_write_playlist (GstHlsSink2 * sink,
+    GstHlsSink2PlaylistUpdate * update);
+static void gst_hls_sink2_playlist_update_free (GstHlsSink2PlaylistUpdate *
+    update);
 static GstStateChangeReturn
 gst_hls_sink2_change_state (GstElement * element, GstStateChange trans);
 static GstPad *gst_hls_sink2_request_new_pad (GstElement * element,
@@ -138,6 +171,8 @@ gst_hls_sink2_finalize (GObject * object)
 
   g_queue_foreach (&sink->old_locations, (GFunc) g_free, NULL);
   g_queue_clear (&sink->old_locations);
+  g_mutex_clear (&sink->lock);
+  g_mutex_clear (&sink->write_lock);
 
   G_OBJECT_CLASS (parent_class)->finalize ((GObject *) sink);
 }
@@ -257,6 +292,23 @@ gst_hls_sink2_class_init (GstHlsSink2Class * klass)
           DEFAULT_SEND_KEYFRAME_REQUESTS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstHlsSink2:part-duration:
+   *
+   * Target duration of Low-Latency HLS partial segments, in milliseconds.
+   * Partial segments are cut on muxer output buffer boundaries once this
+   * duration is reached, and are listed as byte ranges of their fragment.
+   * They are only written, and announced, a GOP at a time.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_PART_DURATION,
+      g_param_spec_uint ("part-duration", "Part duration",
+          "Target duration in milliseconds of Low-Latency HLS partial "
+          "segments (0 - disabled)",
+          0, G_MAXUINT, DEFAULT_PART_DURATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstHlsSink2::get-playlist-stream:
    * @sink: the #GstHlsSink2
@@ -302,6 +354,28 @@ gst_hls_sink2_class_init (GstHlsSink2Class * klass)
       g_signal_new ("delete-fragment", G_TYPE_FROM_CLASS (klass),
       G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_STRING);
 
+  /**
+   * GstHlsSink2::playlist-updated:
+   * @sink: the #GstHlsSink2
+   * @media_sequence: media sequence number of the fragment being written
+   * @part: number of complete partial segments of that fragment
+   * @playlist: the playlist that was just written
+   *
+   * Emitted from the streaming thread every time the playlist was written.
+   * A blocking playlist request for `_HLS_msn=M&_HLS_part=P` can be
+   * answered with @playlist once @media_sequence > M, or @media_sequence
+   * == M and @part > P.
+   *
+   * The playlist advertises CAN-BLOCK-RELOAD=YES while a handler is
+   * connected to this signal.
+   *
+   * Since: 1.22
+   */
+  signals[SIGNAL_PLAYLIST_UPDATED] =
+      g_signal_new ("playlist-updated", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 3, G_TYPE_UINT,
+      G_TYPE_UINT, G_TYPE_STRING);
+
   klass->get_playlist_stream = gst_hls_sink2_get_playlist_stream;
   klass->get_fragment_stream = gst_hls_sink2_get_fragment_stream;
 }
@@ -320,12 +394,18 @@ on_format_location (GstElement * splitmuxsink, guint fragment_id,
   if (!stream) {
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
         (("Got no output stream for fragment '%s'."), location), (NULL));
-    g_free (sink->current_location);
-    sink->current_location = NULL;
-  } else {
-    g_free (sink->current_location);
-    sink->current_location = g_steal_pointer (&location);
   }
+
+  g_mutex_lock (&sink->lock);
+  sink->fragment_id = fragment_id;
+  sink->fragment_offset = 0;
+  sink->part_offset = 0;
+  sink->part_start_pts = GST_CLOCK_TIME_NONE;
+  sink->parts_duration = 0;
+  g_free (sink->current_location);
+  sink->current_location = stream ? g_steal_pointer (&location) : NULL;
+  g_mutex_unlock (&sink->lock);
+
   g_object_set (sink->giostreamsink, "stream", stream, NULL);
 
   if (stream)
@@ -336,10 +416,114 @@ on_format_location (GstElement * splitmuxsink, guint fragment_id,
   return NULL;
 }
 
+static gchar *
+gst_hls_sink2_entry_location (GstHlsSink2 * sink, const gchar * location)
+{
+  gchar *name, *entry_location;
+
+  name = g_path_get_basename (location);
+  if (sink->playlist_root == NULL)
+    return name;
+
+  entry_location = g_build_filename (sink->playlist_root, name, NULL);
+  g_free (name);
+
+  return entry_location;
+}
+
+/* Called with the lock taken */
+static void
+gst_hls_sink2_close_part (GstHlsSink2 * sink, GstClockTime duration)
+{
+  gchar *entry_location;
+
+  entry_location = gst_hls_sink2_entry_location (sink, sink->current_location);
+  gst_m3u8_playlist_add_part (sink->playlist, entry_location, duration,
+      sink->part_offset, sink->fragment_offset - sink->part_offset,
+      sink->part_independent);
+
+  GST_LOG_OBJECT (sink, "Partial segment of %s: %" G_GUINT64_FORMAT "@%"
+      G_GUINT64_FORMAT ", duration %" GST_TIME_FORMAT, entry_location,
+      sink->fragment_offset - sink->part_offset, sink->part_offset,
+      GST_TIME_ARGS (duration));
+
+  sink->parts_duration += duration;
+  sink->part_offset = sink->fragment_offset;
+
+  /* The next part continues in the same fragment file */
+  gst_m3u8_playlist_set_preload_hint (sink->playlist, entry_location,
+      sink->part_offset);
+  g_free (entry_location);
+}
+
+/* Called with the lock taken. Renders the playlist into
+ * sink->pending_update when a part is closed */
+static void
+gst_hls_sink2_handle_part_buffer (GstHlsSink2 * sink, GstBuffer * buffer)
+{
+  GstClockTime pts = GST_BUFFER_PTS (buffer);
+
+  if (sink->part_duration > 0 && sink->current_location &&
+      GST_CLOCK_TIME_IS_VALID (pts)) {
+    if (!GST_CLOCK_TIME_IS_VALID (sink->part_start_pts)) {
+      sink->part_start_pts = pts;
+      sink->part_independent =
+          !GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    } else if (pts >= sink->part_start_pts +
+        sink->part_duration * GST_MSECOND
+        && sink->fragment_offset > sink->part_offset) {
+      /* Parts are cut on muxer output buffer boundaries, so each of them
+       * can be served as a byte range of the fragment being written */
+      gst_hls_sink2_close_part (sink, pts - sink->part_start_pts);
+      sink->part_start_pts = pts;
+      sink->part_independent =
+          !GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+      /* Of several parts closed by a buffer list, only the playlist with
+       * the last one is written */
+      if (sink->pending_update)
+        gst_hls_sink2_playlist_update_free (sink->pending_update);
+      sink->pending_update = gst_hls_sink2_render_playlist (sink);
+    }
+  }
+
+  sink->fragment_offset += gst_buffer_get_size (buffer);
+}
+
+static gboolean
+handle_part_buffer_list_cb (GstBuffer ** buffer, guint idx, gpointer user_data)
+{
+  gst_hls_sink2_handle_part_buffer (GST_HLS_SINK2_CAST (user_data), *buffer);
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+gst_hls_sink2_fragment_probe (GstPad * pad, GstPadProbeInfo * info,
+    GstHlsSink2 * sink)
+{
+  GstHlsSink2PlaylistUpdate *update;
+
+  g_mutex_lock (&sink->lock);
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    gst_buffer_list_foreach (GST_PAD_PROBE_INFO_BUFFER_LIST (info),
+        handle_part_buffer_list_cb, sink);
+  } else {
+    gst_hls_sink2_handle_part_buffer (sink, GST_PAD_PROBE_INFO_BUFFER (info));
+  }
+  update = g_steal_pointer (&sink->pending_update);
+  g_mutex_unlock (&sink->lock);
+
+  if (update)
+    gst_hls_sink2_write_playlist (sink, update);
+
+  return GST_PAD_PROBE_OK;
+}
+
 static void
 gst_hls_sink2_init (GstHlsSink2 * sink)
 {
   GstElement *mux;
+  GstPad *pad;
 
   sink->location = g_strdup (DEFAULT_LOCATION);
   sink->playlist_location = g_strdup (DEFAULT_PLAYLIST_LOCATION);
@@ -348,13 +532,24 @@ gst_hls_sink2_init (GstHlsSink2 * sink)
   sink->max_files = DEFAULT_MAX_FILES;
   sink->target_duration = DEFAULT_TARGET_DURATION;
   sink->send_keyframe_requests = DEFAULT_SEND_KEYFRAME_REQUESTS;
+  sink->part_duration = DEFAULT_PART_DURATION;
   g_queue_init (&sink->old_locations);
+  g_mutex_init (&sink->lock);
+  g_mutex_init (&sink->write_lock);
 
   sink->splitmuxsink = gst_element_factory_make ("splitmuxsink", NULL);
   gst_bin_add (GST_BIN (sink), sink->splitmuxsink);
 
   sink->giostreamsink = gst_element_factory_make ("giostreamsink", NULL);
 
+  /* Tracks the byte offsets of the fragment being written, used to announce
+   * partial segments */
+  pad = gst_element_get_static_pad (sink->giostreamsink, "sink");
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      (GstPadProbeCallback) gst_hls_sink2_fragment_probe, sink, NULL);
+  gst_object_unref (pad);
+
   mux = gst_element_factory_make ("mpegtsmux", NULL);
   g_object_set (sink->splitmuxsink, "location", NULL, "max-size-time",
       ((GstClockTime) sink->target_duration * GST_SECOND),
@@ -378,6 +573,7 @@ gst_hls_sink2_reset (GstHlsSink2 * sink)
     gst_m3u8_playlist_free (sink->playlist);
   sink->playlist =
       gst_m3u8_playlist_new (GST_M3U8_PLAYLIST_VERSION, sink->playlist_length);
+  sink->playlist->part_target = sink->part_duration * GST_MSECOND;
 
   g_queue_foreach (&sink->old_locations, (GFunc) g_free, NULL);
   g_queue_clear (&sink->old_locations);
@@ -386,12 +582,46 @@ gst_hls_sink2_reset (GstHlsSink2 * sink)
 }
 
 static void
-gst_hls_sink2_write_playlist (GstHlsSink2 * sink)
+gst_hls_sink2_playlist_update_free (GstHlsSink2PlaylistUpdate * update)
+{
+  g_free (update->content);
+  g_free (update);
+}
+
+/* Called with the lock taken */
+static GstHlsSink2PlaylistUpdate *
+gst_hls_sink2_render_playlist (GstHlsSink2 * sink)
+{
+  GstHlsSink2PlaylistUpdate *update = g_new0 (GstHlsSink2PlaylistUpdate, 1);
+
+  sink->playlist->can_block_reload = g_signal_has_handler_pending (sink,
+      signals[SIGNAL_PLAYLIST_UPDATED], 0, FALSE);
+
+  update->serial = ++sink->playlist_serial;
+  update->content = gst_m3u8_playlist_render (sink->playlist);
+  update->sequence_number = sink->playlist->sequence_number;
+  update->n_parts = g_queue_get_length (sink->playlist->parts);
+
+  return update;
+}
+
+/* Called without the lock, takes ownership of @update */
+static void
+gst_hls_sink2_write_playlist (GstHlsSink2 * sink,
+    GstHlsSink2PlaylistUpdate * update)
 {
-  char *playlist_content;
   GError *error = NULL;
   GOutputStream *stream = NULL;
-  gsize bytes_to_write;
+
+  g_mutex_lock (&sink->write_lock);
+
+  /* Playlists are rendered from several threads, never replace a newer
+   * one with an older one */
+  if (update->serial <= sink->playlist_written_serial) {
+    GST_DEBUG_OBJECT (sink, "Skipping outdated playlist");
+    goto done;
+  }
+  sink->playlist_written_serial = update->serial;
 
   g_signal_emit (sink, signals[SIGNAL_GET_PLAYLIST_STREAM], 0,
       sink->playlist_location, &stream);
@@ -399,22 +629,26 @@ gst_hls_sink2_write_playlist (GstHlsSink2 * sink)
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
         (("Got no output stream for playlist '%s'."), sink->playlist_location),
         (NULL));
-    return;
+    goto done;
   }
 
-  playlist_content = gst_m3u8_playlist_render (sink->playlist);
-  bytes_to_write = strlen (playlist_content);
-  if (!g_output_stream_write_all (stream, playlist_content, bytes_to_write,
-          NULL, NULL, &error)) {
+  if (!g_output_stream_write_all (stream, update->content,
+          strlen (update->content), NULL, NULL, &error)) {
     GST_ERROR ("Failed to write playlist: %s", error->message);
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
         (("Failed to write playlist '%s'."), error->message), (NULL));
     g_error_free (error);
     error = NULL;
+  } else {
+    g_signal_emit (sink, signals[SIGNAL_PLAYLIST_UPDATED], 0,
+        update->sequence_number, update->n_parts, update->content);
   }
 
-  g_free (playlist_content);
   g_object_unref (stream);
+
+done:
+  g_mutex_unlock (&sink->write_lock);
+  gst_hls_sink2_playlist_update_free (update);
 }
 
 static void
@@ -431,73 +665,101 @@ gst_hls_sink2_handle_message (GstBin * bin, GstMessage * message)
           gst_structure_get_clock_time (s, "running-time",
               &sink->current_running_time_start);
         } else if (gst_structure_has_name (s, "splitmuxsink-fragment-closed")) {
-          GstClockTime running_time;
-          gchar *entry_location;
+          GstHlsSink2PlaylistUpdate *update;
+          GQueue expired_locations = G_QUEUE_INIT;
+          GstClockTime running_time, duration;
+          gchar *entry_location, *old_location;
 
+          g_mutex_lock (&sink->lock);
           if (!sink->current_location) {
+            g_mutex_unlock (&sink->lock);
             GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE, ((NULL)),
                 ("Fragment closed without knowing its location"));
             break;
           }
 
           gst_structure_get_clock_time (s, "running-time", &running_time);
+          duration = running_time - sink->current_running_time_start;
 
           GST_INFO_OBJECT (sink, "COUNT %d", sink->index);
-          if (sink->playlist_root == NULL) {
-            entry_location = g_path_get_basename (sink->current_location);
-          } else {
-            gchar *name = g_path_get_basename (sink->current_location);
-            entry_location = g_build_filename (sink->playlist_root, name, NULL);
-            g_free (name);
+          entry_location =
+              gst_hls_sink2_entry_location (sink, sink->current_location);
+
+          if (sink->part_duration > 0) {
+            /* The remaining bytes of the fragment form its last part */
+            if (sink->fragment_offset > sink->part_offset) {
+              gst_hls_sink2_close_part (sink,
+                  duration > sink->parts_duration ?
+                  duration - sink->parts_duration : 0);
+            }
           }
 
           gst_m3u8_playlist_add_entry (sink->playlist, entry_location,
-              NULL, running_time - sink->current_running_time_start,
-              sink->index++, FALSE);
+              NULL, duration, sink->index++, FALSE);
           g_free (entry_location);
 
-          gst_hls_sink2_write_playlist (sink);
+          if (sink->part_duration > 0) {
+            gchar *next_location;
+
+            /* splitmuxsink numbers its fragments consecutively */
+            next_location = g_strdup_printf (sink->location,
+                sink->fragment_id + 1);
+            entry_location = gst_hls_sink2_entry_location (sink, next_location);
+            gst_m3u8_playlist_set_preload_hint (sink->playlist, entry_location,
+                0);
+            g_free (entry_location);
+            g_free (next_location);
+          }
+
+          update = gst_hls_sink2_render_playlist (sink);
           sink->state |= GST_M3U8_PLAYLIST_RENDER_STARTED;
 
           g_queue_push_tail (&sink->old_locations,
-              g_strdup (sink->current_location));
-
+              g_steal_pointer (&sink->current_location));
           if (sink->max_files > 0) {
-            while (g_queue_get_length (&sink->old_locations) > sink->max_files) {
-              gchar *old_location = g_queue_pop_head (&sink->old_locations);
-
-
-              if (g_signal_has_handler_pending (sink,
-                      signals[SIGNAL_DELETE_FRAGMENT], 0, FALSE)) {
-                g_signal_emit (sink, signals[SIGNAL_DELETE_FRAGMENT], 0,
-                    old_location);
-              } else {
-                GFile *file = g_file_new_for_path (old_location);
-                GError *err = NULL;
-
-                if (!g_file_delete (file, NULL, &err)) {
-                  GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
-                      (("Failed to delete fragment file '%s': %s."),
-                          old_location, err->message), (NULL));
-                  g_clear_error (&err);
-                }
-
-                g_object_unref (file);
+            while (g_queue_get_length (&sink->old_locations) > sink->max_files)
+              g_queue_push_tail (&expired_locations,
+                  g_queue_pop_head (&sink->old_locations));
+          }
+          g_mutex_unlock (&sink->lock);
+
+          gst_hls_sink2_write_playlist (sink, update);
+
+          while ((old_location = g_queue_pop_head (&expired_locations))) {
+            if (g_signal_has_handler_pending (sink,
+                    signals[SIGNAL_DELETE_FRAGMENT], 0, FALSE)) {
+              g_signal_emit (sink, signals[SIGNAL_DELETE_FRAGMENT], 0,
+                  old_location);
+            } else {
+              GFile *file = g_file_new_for_path (old_location);
+              GError *err = NULL;
+
+              if (!g_file_delete (file, NULL, &err)) {
+                GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+                    (("Failed to delete fragment file '%s': %s."),
+                        old_location, err->message), (NULL));
+                g_clear_error (&err);
               }
-              g_free (old_location);
+
+              g_object_unref (file);
             }
+            g_free (old_location);
           }
-
-          g_free (sink->current_location);
-          sink->current_location = NULL;
         }
       }
       break;
     }
     case GST_MESSAGE_EOS:{
+      GstHlsSink2PlaylistUpdate *update;
+
+      g_mutex_lock (&sink->lock);
       sink->playlist->end_list = TRUE;
-      gst_hls_sink2_write_playlist (sink);
+      gst_m3u8_playlist_set_preload_hint (sink->playlist, NULL, 0);
+      update = gst_hls_sink2_render_playlist (sink);
       sink->state |= GST_M3U8_PLAYLIST_RENDER_ENDED;
+      g_mutex_unlock (&sink->lock);
+
+      gst_hls_sink2_write_playlist (sink, update);
       break;
     }
     default:
@@ -589,16 +851,27 @@ gst_hls_sink2_change_state (GstElement * element, GstStateChange trans)
   switch (trans) {
     case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
       break;
-    case GST_STATE_CHANGE_PAUSED_TO_READY:
+    case GST_STATE_CHANGE_PAUSED_TO_READY:{
+      GstHlsSink2PlaylistUpdate *update = NULL;
+
       /* drain playlist with #EXT-X-ENDLIST */
+      g_mutex_lock (&sink->lock);
       if (sink->playlist && (sink->state & GST_M3U8_PLAYLIST_RENDER_STARTED) &&
           !(sink->state & GST_M3U8_PLAYLIST_RENDER_ENDED)) {
         sink->playlist->end_list = TRUE;
-        gst_hls_sink2_write_playlist (sink);
+        gst_m3u8_playlist_set_preload_hint (sink->playlist, NULL, 0);
+        update = gst_hls_sink2_render_playlist (sink);
       }
+      g_mutex_unlock (&sink->lock);
+
+      if (update)
+        gst_hls_sink2_write_playlist (sink, update);
+    }
       /* fall-through */
     case GST_STATE_CHANGE_READY_TO_NULL:
+      g_mutex_lock (&sink->lock);
       gst_hls_sink2_reset (sink);
+      g_mutex_unlock (&sink->lock);
       break;
     default:
       break;
@@ -642,6 +915,12 @@ gst_hls_sink2_set_property (GObject * object, guint prop_id,
       sink->playlist_length = g_value_get_uint (value);
       sink->playlist->window_size = sink->playlist_length;
       break;
+    case PROP_PART_DURATION:
+      g_mutex_lock (&sink->lock);
+      sink->part_duration = g_value_get_uint (value);
+      sink->playlist->part_target = sink->part_duration * GST_MSECOND;
+      g_mutex_unlock (&sink->lock);
+      break;
     case PROP_SEND_KEYFRAME_REQUESTS:
       sink->send_keyframe_requests = g_value_get_boolean (value);
       if (sink->splitmuxsink) {
@@ -683,6 +962,9 @@ gst_hls_sink2_get_property (GObject * object, guint prop_id,
     case PROP_SEND_KEYFRAME_REQUESTS:
       g_value_set_boolean (value, sink->send_keyframe_requests);
       break;
+    case PROP_PART_DURATION:
+      g_value_set_uint (value, sink->part_duration);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -34,6 +34,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstHlsSink2 GstHlsSink2;
 typedef struct _GstHlsSink2Class GstHlsSink2Class;
+typedef struct _GstHlsSink2PlaylistUpdate GstHlsSink2PlaylistUpdate;
 
 struct _GstHlsSink2
 {
@@ -50,14 +51,33 @@ struct _GstHlsSink2
   gint max_files;
   gint target_duration;
   gboolean send_keyframe_requests;
+  guint part_duration;
 
+  /* Protects the playlist, the current location and the partial segment
+   * state, which are updated from the streaming threads. Never held while
+   * emitting signals */
+  GMutex lock;
   GstM3U8Playlist *playlist;
   guint index;
+  guint64 playlist_serial;
+  GstHlsSink2PlaylistUpdate *pending_update;
+
+  /* Serializes the playlist writes and their signals */
+  GMutex write_lock;
+  guint64 playlist_written_serial;
 
   gchar *current_location;
   GstClockTime current_running_time_start;
   GQueue old_locations;
   GstM3U8PlaylistRenderState state;
+
+  /* Partial segments of the current fragment, as byte ranges of it */
+  guint fragment_id;
+  guint64 fragment_offset;
+  guint64 part_offset;
+  GstClockTime part_start_pts;
+  GstClockTime parts_duration;
+  gboolean part_independent;
 };
 
 struct _GstHlsSink2Class
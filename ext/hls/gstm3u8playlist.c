@@ -26,6 +26,9 @@
 
 #define GST_CAT_DEFAULT hls_debug
 
+/* Number of most recent segments that keep their partial segments listed */
+#define GST_M3U8_PART_SEGMENTS 3
+
 enum
 {
   GST_M3U8_PLAYLIST_TYPE_EVENT,
@@ -33,6 +36,16 @@ enum
 };
 
 typedef struct _GstM3U8Entry GstM3U8Entry;
+typedef struct _GstM3U8Part GstM3U8Part;
+
+struct _GstM3U8Part
+{
+  gfloat duration;
+  gchar *url;
+  guint64 offset;
+  guint64 size;
+  gboolean independent;
+};
 
 struct _GstM3U8Entry
 {
@@ -40,8 +53,40 @@ struct _GstM3U8Entry
   gchar *title;
   gchar *url;
   gboolean discontinuous;
+
+  /* partial segments of this entry, dropped once it gets old */
+  GQueue *parts;
+  /* EXT-X-PART/EXTINF/URI lines of this entry, rendered once when the
+   * entry is added and once more when its parts are dropped */
+  gchar *rendered;
 };
 
+static GstM3U8Part *
+gst_m3u8_part_new (const gchar * url, gfloat duration, guint64 offset,
+    guint64 size, gboolean independent)
+{
+  GstM3U8Part *part;
+
+  g_return_val_if_fail (url != NULL, NULL);
+
+  part = g_new0 (GstM3U8Part, 1);
+  part->url = g_strdup (url);
+  part->duration = duration;
+  part->offset = offset;
+  part->size = size;
+  part->independent = independent;
+  return part;
+}
+
+static void
+gst_m3u8_part_free (GstM3U8Part * part)
+{
+  g_return_if_fail (part != NULL);
+
+  g_free (part->url);
+  g_free (part);
+}
+
 static GstM3U8Entry *
 gst_m3u8_entry_new (const gchar * url, const gchar * title,
     gfloat duration, gboolean discontinuous)
@@ -63,11 +108,63 @@ gst_m3u8_entry_free (GstM3U8Entry * entry)
 {
   g_return_if_fail (entry != NULL);
 
+  if (entry->parts)
+    g_queue_free_full (entry->parts, (GDestroyNotify) gst_m3u8_part_free);
   g_free (entry->url);
   g_free (entry->title);
+  g_free (entry->rendered);
   g_free (entry);
 }
 
+static void
+gst_m3u8_part_render (GstM3U8Part * part, GString * str)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_string_append_printf (str, "#EXT-X-PART:DURATION=%s,URI=\"%s\"",
+      g_ascii_dtostr (buf, sizeof (buf), part->duration / GST_SECOND),
+      part->url);
+  if (part->independent)
+    g_string_append (str, ",INDEPENDENT=YES");
+  if (part->size > 0)
+    g_string_append_printf (str, ",BYTERANGE=\"%" G_GUINT64_FORMAT "@%"
+        G_GUINT64_FORMAT "\"", part->size, part->offset);
+  g_string_append_c (str, '\n');
+}
+
+static void
+gst_m3u8_entry_render (GstM3U8Entry * entry, guint version)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+  GString *str;
+  GList *l;
+
+  str = g_string_new (NULL);
+
+  if (entry->discontinuous)
+    g_string_append (str, "#EXT-X-DISCONTINUITY\n");
+
+  if (entry->parts) {
+    for (l = entry->parts->head; l != NULL; l = l->next)
+      gst_m3u8_part_render (l->data, str);
+  }
+
+  if (version < 3) {
+    g_string_append_printf (str, "#EXTINF:%d,%s\n",
+        (gint) ((entry->duration + 500 * GST_MSECOND) / GST_SECOND),
+        entry->title ? entry->title : "");
+  } else {
+    g_string_append_printf (str, "#EXTINF:%s,%s\n",
+        g_ascii_dtostr (buf, sizeof (buf), entry->duration / GST_SECOND),
+        entry->title ? entry->title : "");
+  }
+
+  g_string_append_printf (str, "%s\n", entry->url);
+
+  g_free (entry->rendered);
+  entry->rendered = g_string_free (str, FALSE);
+}
+
 GstM3U8Playlist *
 gst_m3u8_playlist_new (guint version, guint window_size)
 {
@@ -79,6 +176,7 @@ gst_m3u8_playlist_new (guint version, guint window_size)
   playlist->type = GST_M3U8_PLAYLIST_TYPE_EVENT;
   playlist->end_list = FALSE;
   playlist->entries = g_queue_new ();
+  playlist->parts = g_queue_new ();
 
   return playlist;
 }
@@ -90,6 +188,8 @@ gst_m3u8_playlist_free (GstM3U8Playlist * playlist)
 
   g_queue_foreach (playlist->entries, (GFunc) gst_m3u8_entry_free, NULL);
   g_queue_free (playlist->entries);
+  g_queue_free_full (playlist->parts, (GDestroyNotify) gst_m3u8_part_free);
+  g_free (playlist->preload_hint);
   g_free (playlist);
 }
 
@@ -100,6 +200,8 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
     gfloat duration, guint index, gboolean discontinuous)
 {
   GstM3U8Entry *entry;
+  GList *l;
+  guint i;
 
   g_return_val_if_fail (playlist != NULL, FALSE);
   g_return_val_if_fail (url != NULL, FALSE);
@@ -109,6 +211,12 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
 
   entry = gst_m3u8_entry_new (url, title, duration, discontinuous);
 
+  /* The parts written so far make up this entry */
+  if (!g_queue_is_empty (playlist->parts)) {
+    entry->parts = playlist->parts;
+    playlist->parts = g_queue_new ();
+  }
+
   if (playlist->window_size > 0) {
     /* Delete old entries from the playlist */
     while (playlist->entries->length >= playlist->window_size) {
@@ -120,11 +228,74 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
   }
 
   playlist->sequence_number = index + 1;
+  gst_m3u8_entry_render (entry, playlist->version);
   g_queue_push_tail (playlist->entries, entry);
 
+  /* Only the most recent segments list their parts. The entry that just got
+   * too old is the only one that needs to be rendered again */
+  for (l = playlist->entries->tail, i = 0; l != NULL; l = l->prev, i++) {
+    GstM3U8Entry *old_entry = l->data;
+
+    if (i < GST_M3U8_PART_SEGMENTS)
+      continue;
+    if (old_entry->parts == NULL)
+      break;
+
+    g_queue_free_full (old_entry->parts, (GDestroyNotify) gst_m3u8_part_free);
+    old_entry->parts = NULL;
+    gst_m3u8_entry_render (old_entry, playlist->version);
+  }
+
+  return TRUE;
+}
+
+/**
+ * gst_m3u8_playlist_add_part:
+ * @url: URI of the partial segment
+ * @duration: duration of the partial segment
+ * @offset: offset of the partial segment in @url
+ * @size: size of the partial segment, or 0 if it's the whole resource
+ * @independent: whether the partial segment starts with a keyframe
+ *
+ * Adds a partial segment to the segment currently being written, which will
+ * be completed by the next call to gst_m3u8_playlist_add_entry().
+ */
+gboolean
+gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist, const gchar * url,
+    gfloat duration, guint64 offset, guint64 size, gboolean independent)
+{
+  g_return_val_if_fail (playlist != NULL, FALSE);
+  g_return_val_if_fail (url != NULL, FALSE);
+
+  if (playlist->type == GST_M3U8_PLAYLIST_TYPE_VOD)
+    return FALSE;
+
+  g_queue_push_tail (playlist->parts,
+      gst_m3u8_part_new (url, duration, offset, size, independent));
+  playlist->max_part_duration = MAX (playlist->max_part_duration, duration);
+
   return TRUE;
 }
 
+/**
+ * gst_m3u8_playlist_set_preload_hint:
+ * @url: (nullable): URI of the next partial segment, or %NULL to unset
+ * @offset: offset of the next partial segment in @url
+ *
+ * Sets the EXT-X-PRELOAD-HINT announcing the partial segment that is going
+ * to be written next.
+ */
+void
+gst_m3u8_playlist_set_preload_hint (GstM3U8Playlist * playlist,
+    const gchar * url, guint64 offset)
+{
+  g_return_if_fail (playlist != NULL);
+
+  g_free (playlist->preload_hint);
+  playlist->preload_hint = g_strdup (url);
+  playlist->preload_hint_offset = offset;
+}
+
 static guint
 gst_m3u8_playlist_target_duration (GstM3U8Playlist * playlist)
 {
@@ -146,44 +317,59 @@ gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
 {
   GString *playlist_str;
   GList *l;
+  gboolean low_latency;
 
   g_return_val_if_fail (playlist != NULL, NULL);
 
+  low_latency = playlist->part_target > 0;
+
   playlist_str = g_string_new ("#EXTM3U\n");
 
+  /* EXT-X-PART and the associated tags need version 6 */
   g_string_append_printf (playlist_str, "#EXT-X-VERSION:%d\n",
-      playlist->version);
+      low_latency ? MAX (playlist->version, 6) : playlist->version);
 
   g_string_append_printf (playlist_str, "#EXT-X-MEDIA-SEQUENCE:%d\n",
       playlist->sequence_number - playlist->entries->length);
 
   g_string_append_printf (playlist_str, "#EXT-X-TARGETDURATION:%u\n",
       gst_m3u8_playlist_target_duration (playlist));
+
+  if (low_latency) {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+    gfloat part_target = MAX (playlist->part_target,
+        playlist->max_part_duration);
+
+    g_string_append_printf (playlist_str,
+        "#EXT-X-SERVER-CONTROL:%sPART-HOLD-BACK=%s\n",
+        playlist->can_block_reload ? "CAN-BLOCK-RELOAD=YES," : "",
+        g_ascii_dtostr (buf, sizeof (buf), 3 * part_target / GST_SECOND));
+    g_string_append_printf (playlist_str, "#EXT-X-PART-INF:PART-TARGET=%s\n",
+        g_ascii_dtostr (buf, sizeof (buf), part_target / GST_SECOND));
+  }
   g_string_append (playlist_str, "\n");
 
-  /* Entries */
+  /* Entries, as rendered when they were added */
   for (l = playlist->entries->head; l != NULL; l = l->next) {
-    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
     GstM3U8Entry *entry = l->data;
 
-    if (entry->discontinuous)
-      g_string_append (playlist_str, "#EXT-X-DISCONTINUITY\n");
-
-    if (playlist->version < 3) {
-      g_string_append_printf (playlist_str, "#EXTINF:%d,%s\n",
-          (gint) ((entry->duration + 500 * GST_MSECOND) / GST_SECOND),
-          entry->title ? entry->title : "");
-    } else {
-      g_string_append_printf (playlist_str, "#EXTINF:%s,%s\n",
-          g_ascii_dtostr (buf, sizeof (buf), entry->duration / GST_SECOND),
-          entry->title ? entry->title : "");
-    }
-
-    g_string_append_printf (playlist_str, "%s\n", entry->url);
+    g_string_append (playlist_str, entry->rendered);
   }
 
-  if (playlist->end_list)
+  /* Partial segments of the segment being written */
+  for (l = playlist->parts->head; l != NULL; l = l->next)
+    gst_m3u8_part_render (l->data, playlist_str);
+
+  if (playlist->end_list) {
     g_string_append (playlist_str, "#EXT-X-ENDLIST");
+  } else if (low_latency && playlist->preload_hint) {
+    g_string_append_printf (playlist_str,
+        "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s\"", playlist->preload_hint);
+    if (playlist->preload_hint_offset > 0)
+      g_string_append_printf (playlist_str, ",BYTERANGE-START=%"
+          G_GUINT64_FORMAT, playlist->preload_hint_offset);
+    g_string_append_c (playlist_str, '\n');
+  }
 
   return g_string_free (playlist_str, FALSE);
 }
@@ -36,8 +36,19 @@ struct _GstM3U8Playlist
   gboolean end_list;
   guint sequence_number;
 
+  /* Low-latency HLS: target duration of partial segments, in the same unit
+   * as entry durations (0 disables EXT-X-PART-INF), and whether the server
+   * supports blocking playlist reload requests */
+  gfloat part_target;
+  gboolean can_block_reload;
+
   /*< Private >*/
   GQueue *entries;
+  /* partial segments of the segment currently being written */
+  GQueue *parts;
+  gfloat max_part_duration;
+  gchar *preload_hint;
+  guint64 preload_hint_offset;
 };
 
 typedef enum
@@ -60,6 +71,17 @@ gboolean          gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
                                                guint             index,
                                                gboolean          discontinuous);
 
+gboolean          gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist,
+                                              const gchar     * url,
+                                              gfloat            duration,
+                                              guint64           offset,
+                                              guint64           size,
+                                              gboolean          independent);
+
+void              gst_m3u8_playlist_set_preload_hint (GstM3U8Playlist * playlist,
+                                                      const gchar     * url,
+                                                      guint64           offset);
+
 gchar *           gst_m3u8_playlist_render (GstM3U8Playlist * playlist);
 
 G_END_DECLS
@@ -153,6 +153,22 @@
  *   the duration of the respective subsong in LOOPING mode and to G_MAXINT64 in
  *   STEADY mode. If the number of loops is 0, entry durations are set to the
  *   subsong duration regardless of the output mode.
+ *
+ * Most of these formats can only seek by rendering the song from its start
+ * up to the new position, which gets slow in long subsongs. Subclasses that
+ * can serialize their player state implement @save_state and @restore_state.
+ * The base class then keeps snapshots of the state every
+ * #GstNonstreamAudioDecoder:snapshot-interval of the current subsong while
+ * playing, and seeks by restoring the closest snapshot before the new
+ * position and rendering only the rest of the interval. The snapshots are
+ * discarded when the subsong, the subsong mode or the number of loops
+ * change.
+ *
+ * With #GstNonstreamAudioDecoder:render-ahead, @decode is called from a
+ * separate thread, which renders up to that many buffers ahead of the ones
+ * sent downstream. gst_nonstream_audio_decoder_handle_loop() and
+ * output format changes then take effect when the buffer decoded with them
+ * is sent downstream.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -176,7 +192,9 @@ enum
   PROP_CURRENT_SUBSONG,
   PROP_SUBSONG_MODE,
   PROP_NUM_LOOPS,
-  PROP_OUTPUT_MODE
+  PROP_OUTPUT_MODE,
+  PROP_SNAPSHOT_INTERVAL,
+  PROP_RENDER_AHEAD
 };
 
 #define DEFAULT_CURRENT_SUBSONG 0
@@ -184,11 +202,53 @@ enum
 #define DEFAULT_NUM_SUBSONGS 0
 #define DEFAULT_NUM_LOOPS 0
 #define DEFAULT_OUTPUT_MODE GST_NONSTREAM_AUDIO_OUTPUT_MODE_STEADY
+#define DEFAULT_SNAPSHOT_INTERVAL (10 * GST_SECOND)
+#define DEFAULT_RENDER_AHEAD 0
+
+
+typedef struct
+{
+  GstClockTime position;
+  GBytes *state;
+} GstNonstreamAudioSnapshot;
+
+/* A decoded buffer, together with what happened while it was decoded */
+typedef struct
+{
+  GstBuffer *buffer;
+  guint num_samples;
+  GstAudioInfo info;
+  gboolean eos;
+  gboolean format_changed;
+  gboolean loop;
+  GstClockTime loop_position;
+} GstNonstreamAudioRenderedBuffer;
+
+typedef struct
+{
+  /* state snapshots, sorted by position within the current subsong */
+  GstClockTime snapshot_interval;
+  GArray *snapshots;
+
+  /* render-ahead; the render queue is protected by the mutex, and also
+   * holds what is left of the buffer decoded while seeking to a snapshot.
+   * render_queue_size is the render-ahead value the render thread was
+   * started with */
+  guint render_ahead;
+  guint render_queue_size;
+  GThread *render_thread;
+  GCond render_cond;
+  GQueue render_queue;
+  gboolean render_stop, render_eos, rendering_ahead;
+  gboolean render_loop;
+  GstClockTime render_loop_position;
+} GstNonstreamAudioDecoderPrivate;
 
 
 
 
 static GstElementClass *gst_nonstream_audio_decoder_parent_class = NULL;
+static gint private_offset = 0;
 
 static void
 gst_nonstream_audio_decoder_class_init (GstNonstreamAudioDecoderClass * klass);
@@ -266,6 +326,26 @@ gst_nonstream_audio_decoder_output_new_segment (GstNonstreamAudioDecoder * dec,
 static gboolean gst_nonstream_audio_decoder_do_seek (GstNonstreamAudioDecoder *
     dec, GstEvent * event);
 
+static void gst_nonstream_audio_decoder_clear_snapshots (GstNonstreamAudioDecoder
+    * dec);
+static void gst_nonstream_audio_decoder_take_snapshot (GstNonstreamAudioDecoder
+    * dec);
+static gboolean
+gst_nonstream_audio_decoder_seek_to_snapshot (GstNonstreamAudioDecoder * dec,
+    GstClockTime * new_position);
+
+static void gst_nonstream_audio_decoder_render (GstNonstreamAudioDecoder * dec,
+    GstNonstreamAudioRenderedBuffer * rendered);
+static void
+gst_nonstream_audio_decoder_clear_render_queue (GstNonstreamAudioDecoder * dec);
+static gpointer gst_nonstream_audio_decoder_render_thread (GstNonstreamAudioDecoder
+    * dec);
+static void
+gst_nonstream_audio_decoder_start_render_thread (GstNonstreamAudioDecoder *
+    dec);
+static void
+gst_nonstream_audio_decoder_stop_render_thread (GstNonstreamAudioDecoder * dec);
+
 static GstTagList
     * gst_nonstream_audio_decoder_add_main_tags (GstNonstreamAudioDecoder * dec,
     GstTagList * tags);
@@ -359,6 +439,11 @@ gst_nonstream_audio_decoder_get_type (void)
     type_ = g_type_register_static (GST_TYPE_ELEMENT,
         "GstNonstreamAudioDecoder",
         &nonstream_audio_decoder_info, G_TYPE_FLAG_ABSTRACT);
+
+    private_offset =
+        g_type_add_instance_private (type_,
+        sizeof (GstNonstreamAudioDecoderPrivate));
+
     g_once_init_leave (&nonstream_audio_decoder_type, type_);
   }
 
@@ -366,6 +451,14 @@ gst_nonstream_audio_decoder_get_type (void)
 }
 
 
+static inline GstNonstreamAudioDecoderPrivate *
+gst_nonstream_audio_decoder_get_instance_private (GstNonstreamAudioDecoder *
+    dec)
+{
+  return (G_STRUCT_MEMBER_P (dec, private_offset));
+}
+
+
 
 
 static void
@@ -379,6 +472,9 @@ gst_nonstream_audio_decoder_class_init (GstNonstreamAudioDecoderClass * klass)
 
   gst_nonstream_audio_decoder_parent_class = g_type_class_peek_parent (klass);
 
+  if (private_offset != 0)
+    g_type_class_adjust_private_offset (klass, &private_offset);
+
   GST_DEBUG_CATEGORY_INIT (nonstream_audiodecoder_debug,
       "nonstreamaudiodecoder", 0, "nonstream audio decoder base class");
 
@@ -421,6 +517,9 @@ gst_nonstream_audio_decoder_class_init (GstNonstreamAudioDecoderClass * klass)
       GST_DEBUG_FUNCPTR
       (gst_nonstream_audio_decoder_propose_allocation_default);
 
+  klass->save_state = NULL;
+  klass->restore_state = NULL;
+
   klass->loads_from_sinkpad = TRUE;
 
   g_object_class_install_property (object_class,
@@ -458,6 +557,44 @@ gst_nonstream_audio_decoder_class_init (GstNonstreamAudioDecoderClass * klass)
           GST_TYPE_NONSTREAM_AUDIO_DECODER_OUTPUT_MODE,
           DEFAULT_OUTPUT_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
       );
+
+  /**
+   * GstNonstreamAudioDecoder:snapshot-interval:
+   *
+   * Interval between the snapshots of the player state that are kept for
+   * seeking. Only used if the subclass implements @save_state and
+   * @restore_state. Smaller intervals make seeking faster, at the cost of
+   * memory for the snapshots.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (object_class,
+      PROP_SNAPSHOT_INTERVAL,
+      g_param_spec_uint64 ("snapshot-interval",
+          "Snapshot interval",
+          "Interval between the snapshots of the player state used for seeking (0 = no snapshots)",
+          0, G_MAXUINT64,
+          DEFAULT_SNAPSHOT_INTERVAL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
+      );
+
+  /**
+   * GstNonstreamAudioDecoder:render-ahead:
+   *
+   * Number of buffers that are decoded in a separate thread ahead of the
+   * ones sent downstream, so that rendering and the processing downstream
+   * happen in parallel. 0 decodes in the streaming thread. Changes take
+   * effect the next time the output starts, for example after a seek.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (object_class,
+      PROP_RENDER_AHEAD,
+      g_param_spec_uint ("render-ahead",
+          "Render ahead",
+          "Number of buffers to decode in a separate thread ahead of the output (0 = decode in the streaming thread)",
+          0, G_MAXINT,
+          DEFAULT_RENDER_AHEAD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
+      );
 }
 
 
@@ -465,6 +602,8 @@ static void
 gst_nonstream_audio_decoder_init (GstNonstreamAudioDecoder * dec,
     GstNonstreamAudioDecoderClass * klass)
 {
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
   GstPadTemplate *pad_template;
 
   /* These are set here, not in gst_nonstream_audio_decoder_set_initial_state(),
@@ -474,6 +613,14 @@ gst_nonstream_audio_decoder_init (GstNonstreamAudioDecoder * dec,
   dec->subsong_mode = DEFAULT_SUBSONG_MODE;
   dec->output_mode = DEFAULT_OUTPUT_MODE;
   dec->num_loops = DEFAULT_NUM_LOOPS;
+  priv->snapshot_interval = DEFAULT_SNAPSHOT_INTERVAL;
+  priv->render_ahead = DEFAULT_RENDER_AHEAD;
+
+  priv->snapshots = g_array_new (FALSE, FALSE,
+      sizeof (GstNonstreamAudioSnapshot));
+  g_queue_init (&(priv->render_queue));
+  g_cond_init (&(priv->render_cond));
+  priv->render_thread = NULL;
 
   /* Calling this here, not in the NULL->READY state change,
    * to make sure get_property calls return valid values */
@@ -522,6 +669,13 @@ static void
 gst_nonstream_audio_decoder_finalize (GObject * object)
 {
   GstNonstreamAudioDecoder *dec = GST_NONSTREAM_AUDIO_DECODER (object);
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+
+  gst_nonstream_audio_decoder_clear_snapshots (dec);
+  g_array_free (priv->snapshots, TRUE);
+  gst_nonstream_audio_decoder_clear_render_queue (dec);
+  g_cond_clear (&(priv->render_cond));
 
   g_mutex_clear (&(dec->mutex));
   g_object_unref (G_OBJECT (dec->input_data_adapter));
@@ -535,6 +689,8 @@ gst_nonstream_audio_decoder_set_property (GObject * object, guint prop_id,
     GValue const *value, GParamSpec * pspec)
 {
   GstNonstreamAudioDecoder *dec = GST_NONSTREAM_AUDIO_DECODER (object);
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
   GstNonstreamAudioDecoderClass *klass =
       GST_NONSTREAM_AUDIO_DECODER_GET_CLASS (dec);
 
@@ -624,6 +780,7 @@ gst_nonstream_audio_decoder_set_property (GObject * object, guint prop_id,
           }
 
           if (proceed) {
+            gst_nonstream_audio_decoder_clear_snapshots (dec);
             if (GST_CLOCK_TIME_IS_VALID (cur_position))
               gst_nonstream_audio_decoder_output_new_segment (dec,
                   cur_position);
@@ -655,6 +812,9 @@ gst_nonstream_audio_decoder_set_property (GObject * object, guint prop_id,
           } else
             GST_DEBUG_OBJECT (dec,
                 "cannot call set_num_loops, since it is NULL");
+
+          /* the snapshots contain the loop counters */
+          gst_nonstream_audio_decoder_clear_snapshots (dec);
         }
 
         /* store number of loops in case the property is set before the media got loaded */
@@ -665,6 +825,30 @@ gst_nonstream_audio_decoder_set_property (GObject * object, guint prop_id,
       break;
     }
 
+    case PROP_SNAPSHOT_INTERVAL:
+    {
+      GstClockTime new_interval = g_value_get_uint64 (value);
+
+      GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+      if (new_interval != priv->snapshot_interval) {
+        gst_nonstream_audio_decoder_clear_snapshots (dec);
+        priv->snapshot_interval = new_interval;
+      }
+      GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+
+      break;
+    }
+
+    case PROP_RENDER_AHEAD:
+    {
+      /* takes effect the next time the output task is started */
+      GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+      priv->render_ahead = g_value_get_uint (value);
+      GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+
+      break;
+    }
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -677,6 +861,8 @@ gst_nonstream_audio_decoder_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec)
 {
   GstNonstreamAudioDecoder *dec = GST_NONSTREAM_AUDIO_DECODER (object);
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
 
   switch (prop_id) {
     case PROP_OUTPUT_MODE:
@@ -711,6 +897,22 @@ gst_nonstream_audio_decoder_get_property (GObject * object, guint prop_id,
       break;
     }
 
+    case PROP_SNAPSHOT_INTERVAL:
+    {
+      GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+      g_value_set_uint64 (value, priv->snapshot_interval);
+      GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+      break;
+    }
+
+    case PROP_RENDER_AHEAD:
+    {
+      GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+      g_value_set_uint (value, priv->render_ahead);
+      GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+      break;
+    }
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1126,6 +1328,9 @@ gst_nonstream_audio_decoder_src_query (GstPad * pad, GstObject * parent,
 static void
 gst_nonstream_audio_decoder_set_initial_state (GstNonstreamAudioDecoder * dec)
 {
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+
   dec->upstream_size = -1;
   dec->loaded_mode = FALSE;
 
@@ -1138,6 +1343,12 @@ gst_nonstream_audio_decoder_set_initial_state (GstNonstreamAudioDecoder * dec)
   gst_segment_init (&(dec->cur_segment), GST_FORMAT_TIME);
   dec->discont = FALSE;
 
+  priv->render_stop = FALSE;
+  priv->render_eos = FALSE;
+  priv->rendering_ahead = FALSE;
+  priv->render_loop = FALSE;
+  priv->render_loop_position = GST_CLOCK_TIME_NONE;
+
   dec->toc = NULL;
 
   dec->allocator = NULL;
@@ -1149,6 +1360,9 @@ gst_nonstream_audio_decoder_cleanup_state (GstNonstreamAudioDecoder * dec)
 {
   gst_adapter_clear (dec->input_data_adapter);
 
+  gst_nonstream_audio_decoder_clear_snapshots (dec);
+  gst_nonstream_audio_decoder_clear_render_queue (dec);
+
   if (dec->allocator != NULL) {
     gst_object_unref (dec->allocator);
     dec->allocator = NULL;
@@ -1485,6 +1699,8 @@ gst_nonstream_audio_decoder_finish_load (GstNonstreamAudioDecoder * dec,
 static gboolean
 gst_nonstream_audio_decoder_start_task (GstNonstreamAudioDecoder * dec)
 {
+  gst_nonstream_audio_decoder_start_render_thread (dec);
+
   if (!gst_pad_start_task (dec->srcpad,
           (GstTaskFunction) gst_nonstream_audio_decoder_output_task, dec,
           NULL)) {
@@ -1498,6 +1714,9 @@ gst_nonstream_audio_decoder_start_task (GstNonstreamAudioDecoder * dec)
 static gboolean
 gst_nonstream_audio_decoder_stop_task (GstNonstreamAudioDecoder * dec)
 {
+  /* this also wakes up the output task if it waits for a rendered buffer */
+  gst_nonstream_audio_decoder_stop_render_thread (dec);
+
   if (!gst_pad_stop_task (dec->srcpad)) {
     GST_ERROR_OBJECT (dec, "could not stop decoder output task");
     return FALSE;
@@ -1584,12 +1803,17 @@ gst_nonstream_audio_decoder_switch_to_subsong (GstNonstreamAudioDecoder * dec,
       gst_event_unref (fevent);
 
 
+    gst_nonstream_audio_decoder_stop_render_thread (dec);
+
     GST_PAD_STREAM_LOCK (dec->srcpad);
 
 
     GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
 
 
+    /* the snapshots only apply to the subsong they were taken in */
+    gst_nonstream_audio_decoder_clear_snapshots (dec);
+
     if (!(klass->set_current_subsong (dec, new_subsong, &new_position))) {
       /* Switch failed. Do _not_ exit early from here - playback must
        * continue from the current subsong, and it cannot do that if
@@ -1905,6 +2129,10 @@ gst_nonstream_audio_decoder_do_seek (GstNonstreamAudioDecoder * dec,
   } else
     gst_pad_pause_task (dec->srcpad);
 
+  /* the buffers rendered ahead are no longer needed; this also wakes up
+   * the output task if it waits for one */
+  gst_nonstream_audio_decoder_stop_render_thread (dec);
+
   GST_PAD_STREAM_LOCK (dec->srcpad);
 
   segment = dec->cur_segment;
@@ -1941,7 +2169,12 @@ gst_nonstream_audio_decoder_do_seek (GstNonstreamAudioDecoder * dec,
   GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
 
   new_position = segment.position;
-  res = klass->seek (dec, &new_position);
+  if (gst_nonstream_audio_decoder_seek_to_snapshot (dec, &new_position)) {
+    res = TRUE;
+  } else {
+    new_position = segment.position;
+    res = klass->seek (dec, &new_position);
+  }
   segment.position = new_position;
 
   dec->cur_segment = segment;
@@ -1994,6 +2227,167 @@ gst_nonstream_audio_decoder_do_seek (GstNonstreamAudioDecoder * dec,
 }
 
 
+static void
+gst_nonstream_audio_decoder_clear_snapshots (GstNonstreamAudioDecoder * dec)
+{
+  /* must be called with lock */
+
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+  guint i;
+
+  for (i = 0; i < priv->snapshots->len; i++)
+    g_bytes_unref (g_array_index (priv->snapshots, GstNonstreamAudioSnapshot,
+            i).state);
+  g_array_set_size (priv->snapshots, 0);
+}
+
+
+/* Returns the index of the last snapshot at or before position, or -1 */
+static gint
+gst_nonstream_audio_decoder_find_snapshot (GstNonstreamAudioDecoder * dec,
+    GstClockTime position)
+{
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+  gint lo = 0, hi = (gint) priv->snapshots->len - 1, idx = -1;
+
+  while (lo <= hi) {
+    gint mid = (lo + hi) / 2;
+
+    if (g_array_index (priv->snapshots, GstNonstreamAudioSnapshot,
+            mid).position <= position) {
+      idx = mid;
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+
+  return idx;
+}
+
+
+static void
+gst_nonstream_audio_decoder_take_snapshot (GstNonstreamAudioDecoder * dec)
+{
+  /* must be called with lock */
+
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+  GstNonstreamAudioDecoderClass *klass =
+      GST_NONSTREAM_AUDIO_DECODER_GET_CLASS (dec);
+  GstNonstreamAudioSnapshot snapshot;
+  GstClockTime position;
+  gint idx;
+
+  if (priv->snapshot_interval == 0 || klass->save_state == NULL
+      || klass->restore_state == NULL || klass->tell == NULL)
+    return;
+
+  /* positions are relative to a subsong that can change at any time */
+  if (dec->subsong_mode == GST_NONSTREAM_AUDIO_SUBSONG_MODE_ALL)
+    return;
+
+  position = klass->tell (dec);
+  if (!GST_CLOCK_TIME_IS_VALID (position))
+    return;
+
+  /* keep one snapshot per interval; the first one wins, so that playing
+   * past a loop does not replace the snapshots of the first pass */
+  idx = gst_nonstream_audio_decoder_find_snapshot (dec, position);
+  if (idx >= 0 && g_array_index (priv->snapshots, GstNonstreamAudioSnapshot,
+          idx).position / priv->snapshot_interval ==
+      position / priv->snapshot_interval)
+    return;
+
+  snapshot.state = klass->save_state (dec);
+  if (snapshot.state == NULL)
+    return;
+  snapshot.position = position;
+
+  GST_LOG_OBJECT (dec, "took snapshot of %" G_GSIZE_FORMAT " bytes at %"
+      GST_TIME_FORMAT, g_bytes_get_size (snapshot.state),
+      GST_TIME_ARGS (position));
+
+  g_array_insert_val (priv->snapshots, idx + 1, snapshot);
+}
+
+
+static gboolean
+gst_nonstream_audio_decoder_seek_to_snapshot (GstNonstreamAudioDecoder * dec,
+    GstClockTime * new_position)
+{
+  /* must be called with lock */
+
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+  GstNonstreamAudioDecoderClass *klass =
+      GST_NONSTREAM_AUDIO_DECODER_GET_CLASS (dec);
+  GstNonstreamAudioSnapshot *snapshot;
+  guint64 num_skip_samples;
+  gint idx;
+
+  if (klass->restore_state == NULL)
+    return FALSE;
+
+  idx = gst_nonstream_audio_decoder_find_snapshot (dec, *new_position);
+  if (idx < 0) {
+    GST_DEBUG_OBJECT (dec, "no snapshot before %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (*new_position));
+    return FALSE;
+  }
+
+  snapshot = &g_array_index (priv->snapshots, GstNonstreamAudioSnapshot, idx);
+  if (!klass->restore_state (dec, snapshot->state)) {
+    GST_WARNING_OBJECT (dec, "could not restore snapshot at %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (snapshot->position));
+    return FALSE;
+  }
+
+  GST_DEBUG_OBJECT (dec, "restored snapshot at %" GST_TIME_FORMAT
+      ", rendering up to %" GST_TIME_FORMAT, GST_TIME_ARGS (snapshot->position),
+      GST_TIME_ARGS (*new_position));
+
+  /* render the rest of the interval, and keep the part of the last buffer
+   * after the new position for the output task */
+  num_skip_samples = gst_util_uint64_scale_int (*new_position -
+      snapshot->position, dec->output_audio_info.rate, GST_SECOND);
+
+  while (num_skip_samples > 0) {
+    GstNonstreamAudioRenderedBuffer *rendered;
+    GstBuffer *buffer;
+    guint num_samples;
+
+    if (!klass->decode (dec, &buffer, &num_samples) || buffer == NULL) {
+      /* the player state is somewhere in the interval now; let the
+       * subclass seek instead */
+      GST_WARNING_OBJECT (dec, "decoding after restoring snapshot failed");
+      return FALSE;
+    }
+
+    if (num_samples <= num_skip_samples) {
+      num_skip_samples -= num_samples;
+      gst_buffer_unref (buffer);
+      continue;
+    }
+
+    buffer = gst_audio_buffer_truncate (buffer,
+        GST_AUDIO_INFO_BPF (&(dec->output_audio_info)), num_skip_samples,
+        num_samples - num_skip_samples);
+
+    rendered = g_slice_new0 (GstNonstreamAudioRenderedBuffer);
+    rendered->buffer = buffer;
+    rendered->num_samples = num_samples - num_skip_samples;
+    rendered->info = dec->output_audio_info;
+    g_queue_push_tail (&(priv->render_queue), rendered);
+    break;
+  }
+
+  return TRUE;
+}
+
+
 static GstTagList *
 gst_nonstream_audio_decoder_add_main_tags (GstNonstreamAudioDecoder * dec,
     GstTagList * tags)
@@ -2031,21 +2425,191 @@ gst_nonstream_audio_decoder_add_main_tags (GstNonstreamAudioDecoder * dec,
 }
 
 
+static void
+gst_nonstream_audio_decoder_render (GstNonstreamAudioDecoder * dec,
+    GstNonstreamAudioRenderedBuffer * rendered)
+{
+  /* must be called with lock */
+
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+  GstNonstreamAudioDecoderClass *klass =
+      GST_NONSTREAM_AUDIO_DECODER_GET_CLASS (dec);
+
+  g_assert (klass->decode != NULL);
+
+  rendered->buffer = NULL;
+  rendered->num_samples = 0;
+
+  /* perform the actual decoding */
+  rendered->eos = !(klass->decode (dec, &(rendered->buffer),
+          &(rendered->num_samples)));
+  if (rendered->eos)
+    return;
+
+  /* handle_loop() calls made from the render thread are deferred until the
+   * output task gets to this buffer */
+  rendered->loop = priv->render_loop;
+  rendered->loop_position = priv->render_loop_position;
+  priv->render_loop = FALSE;
+
+  /* same for output format changes; the format is kept for negotiating and
+   * for the timestamps, since it might change again before the buffer is
+   * sent */
+  rendered->format_changed = dec->output_format_changed;
+  rendered->info = dec->output_audio_info;
+  if (priv->rendering_ahead)
+    dec->output_format_changed = FALSE;
+
+  if (rendered->buffer != NULL)
+    gst_nonstream_audio_decoder_take_snapshot (dec);
+}
+
+
+static void
+gst_nonstream_audio_decoder_clear_render_queue (GstNonstreamAudioDecoder * dec)
+{
+  /* must be called with lock */
+
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+  GstNonstreamAudioRenderedBuffer *rendered;
+
+  while ((rendered = g_queue_pop_head (&(priv->render_queue))) != NULL) {
+    if (rendered->buffer != NULL)
+      gst_buffer_unref (rendered->buffer);
+    g_slice_free (GstNonstreamAudioRenderedBuffer, rendered);
+  }
+}
+
+
+static gpointer
+gst_nonstream_audio_decoder_render_thread (GstNonstreamAudioDecoder * dec)
+{
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+
+  GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+
+  while (!priv->render_stop) {
+    GstNonstreamAudioRenderedBuffer *rendered;
+
+    if (priv->render_eos
+        || g_queue_get_length (&(priv->render_queue)) >=
+        priv->render_queue_size) {
+      g_cond_wait (&(priv->render_cond), &(dec->mutex));
+      continue;
+    }
+
+    rendered = g_slice_new0 (GstNonstreamAudioRenderedBuffer);
+
+    priv->rendering_ahead = TRUE;
+    gst_nonstream_audio_decoder_render (dec, rendered);
+    priv->rendering_ahead = FALSE;
+
+    /* nothing comes after the end or a failed decode() call */
+    if (rendered->eos || rendered->buffer == NULL)
+      priv->render_eos = TRUE;
+
+    g_queue_push_tail (&(priv->render_queue), rendered);
+    g_cond_broadcast (&(priv->render_cond));
+  }
+
+  GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+
+  return NULL;
+}
+
+
+static void
+gst_nonstream_audio_decoder_start_render_thread (GstNonstreamAudioDecoder *
+    dec)
+{
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+
+  GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+
+  if (priv->render_ahead > 0 && priv->render_thread == NULL) {
+    GST_DEBUG_OBJECT (dec, "starting render thread, rendering %u buffers ahead",
+        priv->render_ahead);
+
+    /* changes of the property only take effect after a restart */
+    priv->render_queue_size = priv->render_ahead;
+    priv->render_stop = FALSE;
+    priv->render_eos = FALSE;
+    priv->render_thread = g_thread_new ("nonstreamaudiodec-render",
+        (GThreadFunc) gst_nonstream_audio_decoder_render_thread, dec);
+  }
+
+  GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+}
+
+
+static void
+gst_nonstream_audio_decoder_stop_render_thread (GstNonstreamAudioDecoder * dec)
+{
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+  GThread *thread;
+
+  GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+  thread = priv->render_thread;
+  priv->render_stop = TRUE;
+  g_cond_broadcast (&(priv->render_cond));
+  GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+
+  if (thread != NULL) {
+    GST_DEBUG_OBJECT (dec, "stopping render thread");
+    g_thread_join (thread);
+  }
+
+  GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+  priv->render_thread = NULL;
+  priv->render_loop = FALSE;
+  gst_nonstream_audio_decoder_clear_render_queue (dec);
+  GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+}
+
+
 static void
 gst_nonstream_audio_decoder_output_task (GstNonstreamAudioDecoder * dec)
 {
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
   GstFlowReturn flow;
   GstBuffer *outbuf;
   guint num_samples;
-
-  GstNonstreamAudioDecoderClass *klass;
-  klass = GST_NONSTREAM_AUDIO_DECODER_CLASS (G_OBJECT_GET_CLASS (dec));
-  g_assert (klass->decode != NULL);
+  GstNonstreamAudioRenderedBuffer rendered;
 
   GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
 
-  /* perform the actual decoding */
-  if (!(klass->decode (dec, &outbuf, &num_samples))) {
+  /* with render-ahead, wait for the render thread to decode a buffer */
+  while (priv->render_thread != NULL && !priv->render_stop
+      && g_queue_is_empty (&(priv->render_queue)))
+    g_cond_wait (&(priv->render_cond), &(dec->mutex));
+
+  if (priv->render_thread != NULL && priv->render_stop) {
+    GST_LOG_OBJECT (dec, "render thread is stopping");
+    goto pause_unlock;
+  }
+
+  /* the queue also holds the rest of the buffer decoded when seeking to a
+   * snapshot; only decode here if it is empty */
+  if (!g_queue_is_empty (&(priv->render_queue))) {
+    GstNonstreamAudioRenderedBuffer *queued =
+        g_queue_pop_head (&(priv->render_queue));
+    rendered = *queued;
+    g_slice_free (GstNonstreamAudioRenderedBuffer, queued);
+    g_cond_broadcast (&(priv->render_cond));
+  } else {
+    gst_nonstream_audio_decoder_render (dec, &rendered);
+  }
+
+  outbuf = rendered.buffer;
+  num_samples = rendered.num_samples;
+
+  if (rendered.eos) {
     /* EOS case */
     GST_INFO_OBJECT (dec, "decode() reports end -> sending EOS event");
     gst_pad_push_event (dec->srcpad, gst_event_new_eos ());
@@ -2053,19 +2617,21 @@ gst_nonstream_audio_decoder_output_task (GstNonstreamAudioDecoder * dec)
   }
 
   if (outbuf == NULL) {
-    GST_ERROR_OBJECT (outbuf, "decode() produced NULL buffer");
+    GST_ERROR_OBJECT (dec, "decode() produced NULL buffer");
     goto pause_unlock;
   }
 
+  if (G_UNLIKELY (rendered.loop))
+    gst_nonstream_audio_decoder_handle_loop (dec, rendered.loop_position);
+
   /* set the buffer's metadata */
   GST_BUFFER_DURATION (outbuf) =
-      gst_util_uint64_scale_int (num_samples, GST_SECOND,
-      dec->output_audio_info.rate);
+      gst_util_uint64_scale_int (num_samples, GST_SECOND, rendered.info.rate);
   GST_BUFFER_OFFSET (outbuf) = dec->cur_pos_in_samples;
   GST_BUFFER_OFFSET_END (outbuf) = dec->cur_pos_in_samples + num_samples;
   GST_BUFFER_PTS (outbuf) =
       gst_util_uint64_scale_int (dec->cur_pos_in_samples, GST_SECOND,
-      dec->output_audio_info.rate);
+      rendered.info.rate);
   GST_BUFFER_DTS (outbuf) = GST_BUFFER_PTS (outbuf);
 
   if (G_UNLIKELY (dec->discont)) {
@@ -2086,12 +2652,21 @@ gst_nonstream_audio_decoder_output_task (GstNonstreamAudioDecoder * dec)
   dec->num_decoded_samples += num_samples;
 
   /* the decode() call might have set a new output format -> renegotiate
-   * before sending the new buffer downstream */
-  if (G_UNLIKELY (dec->output_format_changed ||
-          (GST_AUDIO_INFO_IS_VALID (&(dec->output_audio_info))
+   * before sending the new buffer downstream, with the format the buffer
+   * was rendered in; with render-ahead, the current output format may
+   * already be the one of a later buffer */
+  if (G_UNLIKELY (rendered.format_changed ||
+          (GST_AUDIO_INFO_IS_VALID (&(rendered.info))
               && gst_pad_check_reconfigure (dec->srcpad))
       )) {
-    if (!gst_nonstream_audio_decoder_negotiate (dec)) {
+    GstAudioInfo current_audio_info = dec->output_audio_info;
+    gboolean negotiated;
+
+    dec->output_audio_info = rendered.info;
+    negotiated = gst_nonstream_audio_decoder_negotiate (dec);
+    dec->output_audio_info = current_audio_info;
+
+    if (!negotiated) {
       gst_buffer_unref (outbuf);
       GST_LOG_OBJECT (dec, "could not push output buffer: negotiation failed");
       goto pause_unlock;
@@ -2188,6 +2763,9 @@ void
 gst_nonstream_audio_decoder_handle_loop (GstNonstreamAudioDecoder * dec,
     GstClockTime new_position)
 {
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+
   if (dec->output_mode == GST_NONSTREAM_AUDIO_OUTPUT_MODE_STEADY) {
     /* handle_loop makes no sense with open-ended decoders */
     GST_WARNING_OBJECT (dec,
@@ -2199,6 +2777,13 @@ gst_nonstream_audio_decoder_handle_loop (GstNonstreamAudioDecoder * dec,
       "handle_loop() invoked with new_position = %" GST_TIME_FORMAT,
       GST_TIME_ARGS (new_position));
 
+  if (priv->rendering_ahead) {
+    /* the output task calls this again once it gets to the next buffer */
+    priv->render_loop = TRUE;
+    priv->render_loop_position = new_position;
+    return;
+  }
+
   dec->discont = TRUE;
 
   gst_nonstream_audio_decoder_output_new_segment (dec, new_position);
@@ -2470,10 +3055,14 @@ GstBuffer *
 gst_nonstream_audio_decoder_allocate_output_buffer (GstNonstreamAudioDecoder *
     dec, gsize size)
 {
-  if (G_UNLIKELY (dec->output_format_changed ||
-          (GST_AUDIO_INFO_IS_VALID (&(dec->output_audio_info))
-              && gst_pad_check_reconfigure (dec->srcpad))
-      )) {
+  GstNonstreamAudioDecoderPrivate *priv =
+      gst_nonstream_audio_decoder_get_instance_private (dec);
+
+  /* when rendering ahead, the output task negotiates once it gets to the
+   * buffers in the new format, so that the caps follow the older buffers */
+  if (G_UNLIKELY (!priv->rendering_ahead && (dec->output_format_changed ||
+              (GST_AUDIO_INFO_IS_VALID (&(dec->output_audio_info))
+                  && gst_pad_check_reconfigure (dec->srcpad))))) {
     /* renegotiate if necessary, before allocating,
      * to make sure the right allocator and the right allocation
      * params are used */
@@ -286,6 +286,22 @@ struct _GstNonstreamAudioDecoder
  *                              Proposes buffer allocation parameters for upstream elements.
  *                              Subclasses should chain up to the parent implementation to
  *                              invoke the default handler.
+ * @save_state:                 Optional.
+ *                              Returns a serialized copy of the complete player state (pattern
+ *                              position, channel and instrument states, loop counters etc.) at
+ *                              the current playback position, or NULL if it cannot be saved
+ *                              right now. The base class calls this after @decode every
+ *                              #GstNonstreamAudioDecoder:snapshot-interval of playback, and
+ *                              uses @tell to find out at which position the state was saved, so
+ *                              @tell must be implemented as well. Since: 1.22
+ * @restore_state:              Optional.
+ *                              Restores a player state previously returned by @save_state.
+ *                              Afterwards, @decode must continue exactly from where it was
+ *                              when the state was saved. If this is implemented, a seek
+ *                              restores the closest snapshot before the seek position and
+ *                              renders the remaining part, instead of calling @seek, which
+ *                              is then only used for positions before the first snapshot.
+ *                              Since: 1.22
  *
  * Subclasses can override any of the available optional virtual methods or not, as
  * needed. At minimum, @load_from_buffer (or @load_from_custom), @get_supported_output_modes,
@@ -372,8 +388,12 @@ struct _GstNonstreamAudioDecoderClass
   gboolean     (*propose_allocation)         (GstNonstreamAudioDecoder * dec,
                                               GstQuery * query);
 
+  GBytes *     (*save_state)                 (GstNonstreamAudioDecoder * dec);
+  gboolean     (*restore_state)              (GstNonstreamAudioDecoder * dec,
+                                              GBytes * state);
+
   /*< private > */
-  gpointer _gst_reserved[GST_PADDING_LARGE];
+  gpointer _gst_reserved[GST_PADDING_LARGE - 2];
 };
 
 
@@ -26,6 +26,13 @@
  * This class is similar to GstAdapter, but it is made to work with
  * non-interleaved (planar) audio buffers. Before using, an audio format
  * must be configured with gst_planar_audio_adapter_configure()
+ *
+ * Alternatively, gst_planar_audio_adapter_configure_ring_buffer() makes the
+ * adapter copy the pushed samples into one contiguous ring buffer per
+ * channel. This costs one copy on push, but then
+ * gst_planar_audio_adapter_peek_planes() gives direct access to the planes
+ * of any number of samples, whatever the pushed buffers were, which suits
+ * elements processing fixed size blocks.
  */
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -33,6 +40,9 @@
 
 #include "gstplanaraudioadapter.h"
 
+#include <string.h>
+#include <gst/base/gstqueuearray.h>
+
 GST_DEBUG_CATEGORY_STATIC (gst_planar_audio_adapter_debug);
 #define GST_CAT_DEFAULT gst_planar_audio_adapter_debug
 
@@ -59,8 +69,30 @@ struct _GstPlanarAudioAdapter
   guint64 offset_at_discont;
 
   guint64 distance_from_discont;
+
+  /* ring buffer mode, when ring_capacity is not 0. Each plane holds
+   * ring_capacity samples followed by ring_guard samples, where the
+   * wrapped around part of a contiguous peek is copied */
+  guint8 *ring;
+  gsize ring_capacity;
+  gsize ring_guard;
+  gsize ring_head;
+  /* number of samples flushed since the last clear */
+  guint64 ring_read_pos;
+  /* RingMarker of the pushed buffers not at the head yet */
+  GstQueueArray *ring_markers;
 };
 
+/* The timestamps and offset of a buffer pushed in ring buffer mode */
+typedef struct
+{
+  guint64 pos;
+  GstClockTime pts;
+  GstClockTime dts;
+  guint64 offset;
+  gboolean discont;
+} RingMarker;
+
 struct _GstPlanarAudioAdapterClass
 {
   GObjectClass parent_class;
@@ -105,6 +137,13 @@ gst_planar_audio_adapter_dispose (GObject * object)
 
   gst_planar_audio_adapter_clear (adapter);
 
+  g_clear_pointer (&adapter->ring, g_free);
+  adapter->ring_capacity = 0;
+  if (adapter->ring_markers) {
+    gst_queue_array_free (adapter->ring_markers);
+    adapter->ring_markers = NULL;
+  }
+
   GST_CALL_PARENT (G_OBJECT_CLASS, dispose, (object));
 }
 
@@ -140,6 +179,83 @@ gst_planar_audio_adapter_configure (GstPlanarAudioAdapter * adapter,
 
   gst_planar_audio_adapter_clear (adapter);
   adapter->info = *info;
+
+  g_clear_pointer (&adapter->ring, g_free);
+  adapter->ring_capacity = 0;
+  adapter->ring_guard = 0;
+}
+
+/* Moves the samples in the ring buffer to a new one, starting at index 0 */
+static void
+gst_planar_audio_adapter_resize_ring (GstPlanarAudioAdapter * adapter,
+    gsize capacity, gsize guard)
+{
+  gint c, channels, bps;
+  gsize old_stride, stride, n_first;
+  guint8 *ring;
+
+  g_assert (capacity >= adapter->samples);
+
+  channels = adapter->info.channels;
+  bps = adapter->info.finfo->width / 8;
+  old_stride = (adapter->ring_capacity + adapter->ring_guard) * bps;
+  stride = (capacity + guard) * bps;
+
+  GST_DEBUG_OBJECT (adapter, "resizing ring buffer to %" G_GSIZE_FORMAT
+      " + %" G_GSIZE_FORMAT " samples", capacity, guard);
+
+  ring = g_malloc (channels * stride);
+
+  if (adapter->ring && adapter->samples > 0) {
+    n_first = MIN (adapter->samples, adapter->ring_capacity -
+        adapter->ring_head);
+
+    for (c = 0; c < channels; c++) {
+      guint8 *src = adapter->ring + c * old_stride;
+      guint8 *dest = ring + c * stride;
+
+      memcpy (dest, src + adapter->ring_head * bps, n_first * bps);
+      memcpy (dest + n_first * bps, src, (adapter->samples - n_first) * bps);
+    }
+  }
+
+  g_free (adapter->ring);
+  adapter->ring = ring;
+  adapter->ring_capacity = capacity;
+  adapter->ring_guard = guard;
+  adapter->ring_head = 0;
+}
+
+/**
+ * gst_planar_audio_adapter_configure_ring_buffer:
+ * @adapter: a #GstPlanarAudioAdapter
+ * @info: a #GstAudioInfo describing the format of the audio data
+ * @capacity: the initial number of samples the ring buffer can hold
+ *
+ * Like gst_planar_audio_adapter_configure(), but makes the @adapter copy the
+ * samples of the pushed buffers into a contiguous ring buffer per channel,
+ * which can then be accessed with gst_planar_audio_adapter_peek_planes().
+ * The ring buffer grows if more than @capacity samples are pushed.
+ *
+ * Since: 1.22
+ */
+void
+gst_planar_audio_adapter_configure_ring_buffer (GstPlanarAudioAdapter *
+    adapter, const GstAudioInfo * info, gsize capacity)
+{
+  g_return_if_fail (GST_IS_PLANAR_AUDIO_ADAPTER (adapter));
+  g_return_if_fail (info != NULL);
+  g_return_if_fail (GST_AUDIO_INFO_IS_VALID (info));
+  g_return_if_fail (info->layout == GST_AUDIO_LAYOUT_NON_INTERLEAVED);
+  g_return_if_fail (capacity > 0);
+
+  gst_planar_audio_adapter_configure (adapter, info);
+
+  if (!adapter->ring_markers)
+    adapter->ring_markers =
+        gst_queue_array_new_for_struct (sizeof (RingMarker), 16);
+
+  gst_planar_audio_adapter_resize_ring (adapter, capacity, 0);
 }
 
 /**
@@ -161,6 +277,11 @@ gst_planar_audio_adapter_clear (GstPlanarAudioAdapter * adapter)
   adapter->samples = 0;
   adapter->skip = 0;
 
+  adapter->ring_head = 0;
+  adapter->ring_read_pos = 0;
+  if (adapter->ring_markers)
+    gst_queue_array_clear (adapter->ring_markers);
+
   adapter->pts = GST_CLOCK_TIME_NONE;
   adapter->pts_distance = 0;
   adapter->dts = GST_CLOCK_TIME_NONE;
@@ -173,40 +294,103 @@ gst_planar_audio_adapter_clear (GstPlanarAudioAdapter * adapter)
   adapter->distance_from_discont = 0;
 }
 
+/* @distance is the number of samples of the buffer already flushed */
 static inline void
-update_timestamps_and_offset (GstPlanarAudioAdapter * adapter, GstBuffer * buf)
+update_timestamps_and_offset_full (GstPlanarAudioAdapter * adapter,
+    GstClockTime pts, GstClockTime dts, guint64 offset, gboolean discont,
+    guint64 distance)
 {
-  GstClockTime pts, dts;
-  guint64 offset;
-
-  pts = GST_BUFFER_PTS (buf);
   if (GST_CLOCK_TIME_IS_VALID (pts)) {
     GST_LOG_OBJECT (adapter, "new pts %" GST_TIME_FORMAT, GST_TIME_ARGS (pts));
     adapter->pts = pts;
-    adapter->pts_distance = 0;
+    adapter->pts_distance = distance;
   }
-  dts = GST_BUFFER_DTS (buf);
   if (GST_CLOCK_TIME_IS_VALID (dts)) {
     GST_LOG_OBJECT (adapter, "new dts %" GST_TIME_FORMAT, GST_TIME_ARGS (dts));
     adapter->dts = dts;
-    adapter->dts_distance = 0;
+    adapter->dts_distance = distance;
   }
-  offset = GST_BUFFER_OFFSET (buf);
   if (offset != GST_BUFFER_OFFSET_NONE) {
     GST_LOG_OBJECT (adapter, "new offset %" G_GUINT64_FORMAT, offset);
     adapter->offset = offset;
-    adapter->offset_distance = 0;
+    adapter->offset_distance = distance;
   }
 
-  if (GST_BUFFER_IS_DISCONT (buf)) {
+  if (discont) {
     /* Take values as-is (might be NONE) */
     adapter->pts_at_discont = pts;
     adapter->dts_at_discont = dts;
     adapter->offset_at_discont = offset;
-    adapter->distance_from_discont = 0;
+    adapter->distance_from_discont = distance;
   }
 }
 
+static inline void
+update_timestamps_and_offset (GstPlanarAudioAdapter * adapter, GstBuffer * buf)
+{
+  update_timestamps_and_offset_full (adapter, GST_BUFFER_PTS (buf),
+      GST_BUFFER_DTS (buf), GST_BUFFER_OFFSET (buf), GST_BUFFER_IS_DISCONT (buf),
+      0);
+}
+
+static void
+gst_planar_audio_adapter_push_ring (GstPlanarAudioAdapter * adapter,
+    GstBuffer * buf, gsize samples)
+{
+  GstAudioBuffer abuf;
+  gint c, bps;
+  gsize stride, write, n_first;
+
+  if (adapter->samples + samples > adapter->ring_capacity) {
+    gst_planar_audio_adapter_resize_ring (adapter,
+        MAX (adapter->ring_capacity * 2, adapter->samples + samples),
+        adapter->ring_guard);
+  }
+
+  if (!gst_audio_buffer_map (&abuf, &adapter->info, buf, GST_MAP_READ)) {
+    GST_ERROR_OBJECT (adapter, "failed to map buffer %p", buf);
+    gst_buffer_unref (buf);
+    return;
+  }
+
+  bps = adapter->info.finfo->width / 8;
+  stride = (adapter->ring_capacity + adapter->ring_guard) * bps;
+  write = (adapter->ring_head + adapter->samples) % adapter->ring_capacity;
+  n_first = MIN (samples, adapter->ring_capacity - write);
+
+  for (c = 0; c < adapter->info.channels; c++) {
+    guint8 *dest = adapter->ring + c * stride;
+    const guint8 *src = abuf.planes[c];
+
+    memcpy (dest + write * bps, src, n_first * bps);
+    memcpy (dest, src + n_first * bps, (samples - n_first) * bps);
+  }
+  gst_audio_buffer_unmap (&abuf);
+
+  if (adapter->samples == 0) {
+    GST_LOG_OBJECT (adapter, "pushing %p first %" G_GSIZE_FORMAT " samples",
+        buf, samples);
+    update_timestamps_and_offset (adapter, buf);
+  } else {
+    RingMarker marker;
+
+    GST_LOG_OBJECT (adapter, "pushing %p %" G_GSIZE_FORMAT " samples at end, "
+        "samples now %" G_GSIZE_FORMAT, buf, samples,
+        adapter->samples + samples);
+
+    marker.pos = adapter->ring_read_pos + adapter->samples;
+    marker.pts = GST_BUFFER_PTS (buf);
+    marker.dts = GST_BUFFER_DTS (buf);
+    marker.offset = GST_BUFFER_OFFSET (buf);
+    marker.discont = GST_BUFFER_IS_DISCONT (buf);
+    gst_queue_array_push_tail_struct (adapter->ring_markers, &marker);
+  }
+
+  adapter->samples += samples;
+  ++adapter->count;
+  gst_buffer_unref (buf);
+}
+
 /**
  * gst_planar_audio_adapter_push:
  * @adapter: a #GstPlanarAudioAdapter
@@ -230,6 +414,12 @@ gst_planar_audio_adapter_push (GstPlanarAudioAdapter * adapter, GstBuffer * buf)
   g_return_if_fail (gst_audio_info_is_equal (&meta->info, &adapter->info));
 
   samples = meta->samples;
+
+  if (adapter->ring_capacity) {
+    gst_planar_audio_adapter_push_ring (adapter, buf, samples);
+    return;
+  }
+
   adapter->samples += samples;
 
   if (G_UNLIKELY (adapter->buflist == NULL)) {
@@ -247,6 +437,35 @@ gst_planar_audio_adapter_push (GstPlanarAudioAdapter * adapter, GstBuffer * buf)
   ++adapter->count;
 }
 
+static void
+gst_planar_audio_adapter_flush_ring (GstPlanarAudioAdapter * adapter,
+    gsize to_flush)
+{
+  RingMarker *marker;
+
+  adapter->samples -= to_flush;
+  adapter->ring_head = (adapter->ring_head + to_flush) % adapter->ring_capacity;
+  adapter->ring_read_pos += to_flush;
+
+  adapter->pts_distance += to_flush;
+  adapter->dts_distance += to_flush;
+  adapter->offset_distance += to_flush;
+  adapter->distance_from_discont += to_flush;
+
+  /* apply the timestamps of the buffers which are now at the head or were
+   * flushed, in order */
+  while ((marker = gst_queue_array_peek_head_struct (adapter->ring_markers))
+      && marker->pos <= adapter->ring_read_pos) {
+    update_timestamps_and_offset_full (adapter, marker->pts, marker->dts,
+        marker->offset, marker->discont, adapter->ring_read_pos - marker->pos);
+    gst_queue_array_pop_head_struct (adapter->ring_markers);
+    --adapter->count;
+  }
+
+  if (adapter->samples == 0)
+    adapter->count = 0;
+}
+
 static void
 gst_planar_audio_adapter_flush_unchecked (GstPlanarAudioAdapter * adapter,
     gsize to_flush)
@@ -254,6 +473,11 @@ gst_planar_audio_adapter_flush_unchecked (GstPlanarAudioAdapter * adapter,
   GSList *g = adapter->buflist;
   gsize cur_samples;
 
+  if (adapter->ring_capacity) {
+    gst_planar_audio_adapter_flush_ring (adapter, to_flush);
+    return;
+  }
+
   /* clear state */
   adapter->samples -= to_flush;
 
@@ -363,6 +587,37 @@ gst_planar_audio_adapter_get_buffer (GstPlanarAudioAdapter * adapter,
   if (G_UNLIKELY (nsamples > adapter->samples))
     return NULL;
 
+  if (adapter->ring_capacity) {
+    gpointer *planes = g_newa (gpointer, adapter->info.channels);
+    gpointer *wrap_planes = g_newa (gpointer, adapter->info.channels);
+    gsize wrap_samples, n_first;
+    gint c, bps;
+    GstMapInfo map;
+
+    GST_LOG_OBJECT (adapter, "providing buffer of %" G_GSIZE_FORMAT " samples"
+        " copied from the ring buffer", nsamples);
+
+    gst_planar_audio_adapter_peek_planes (adapter, nsamples, planes,
+        wrap_planes, &wrap_samples);
+    n_first = nsamples - wrap_samples;
+    bps = adapter->info.finfo->width / 8;
+
+    buffer = gst_buffer_new_allocate (NULL, nsamples * adapter->info.bpf,
+        NULL);
+    gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+    for (c = 0; c < adapter->info.channels; c++) {
+      guint8 *dest = map.data + c * nsamples * bps;
+
+      memcpy (dest, planes[c], n_first * bps);
+      if (wrap_samples)
+        memcpy (dest + n_first * bps, wrap_planes[c], wrap_samples * bps);
+    }
+    gst_buffer_unmap (buffer, &map);
+
+    gst_buffer_add_audio_meta (buffer, &adapter->info, nsamples, NULL);
+    return buffer;
+  }
+
   cur = adapter->buflist->data;
   skip = adapter->skip;
   hsamples = gst_buffer_get_audio_meta (cur)->samples;
@@ -463,6 +718,79 @@ gst_planar_audio_adapter_take_buffer (GstPlanarAudioAdapter * adapter,
   return buffer;
 }
 
+/**
+ * gst_planar_audio_adapter_peek_planes:
+ * @adapter: a #GstPlanarAudioAdapter configured in ring buffer mode
+ * @nsamples: the number of samples to peek
+ * @planes: (out caller-allocates) (array): an array of one pointer per
+ *     channel, filled with the address of the first sample of each plane
+ * @wrap_planes: (out caller-allocates) (array) (nullable): an array of one
+ *     pointer per channel, or %NULL
+ * @wrap_samples: (out) (optional): the number of samples at @wrap_planes
+ *
+ * Gives direct access to the first @nsamples of each channel of an @adapter
+ * configured with gst_planar_audio_adapter_configure_ring_buffer(), without
+ * flushing them.
+ *
+ * If the samples wrap around the end of the ring buffer and @wrap_planes is
+ * given, @planes point to the first @nsamples - @wrap_samples samples and
+ * @wrap_planes to the @wrap_samples remaining ones. If @wrap_planes is %NULL,
+ * the samples are made contiguous at @planes, which copies the wrapped
+ * around samples.
+ *
+ * The pointers are valid until the next call modifying the @adapter.
+ *
+ * Returns: %TRUE if @nsamples samples are available
+ *
+ * Since: 1.22
+ */
+gboolean
+gst_planar_audio_adapter_peek_planes (GstPlanarAudioAdapter * adapter,
+    gsize nsamples, gpointer * planes, gpointer * wrap_planes,
+    gsize * wrap_samples)
+{
+  gint c, bps;
+  gsize stride, n_first, n_wrap;
+
+  g_return_val_if_fail (GST_IS_PLANAR_AUDIO_ADAPTER (adapter), FALSE);
+  g_return_val_if_fail (adapter->ring_capacity > 0, FALSE);
+  g_return_val_if_fail (planes != NULL, FALSE);
+
+  if (G_UNLIKELY (nsamples > adapter->samples))
+    return FALSE;
+
+  n_first = MIN (nsamples, adapter->ring_capacity - adapter->ring_head);
+  n_wrap = nsamples - n_first;
+
+  /* without wrap_planes, the wrapped around samples are copied after the
+   * end of each plane, in the guard area. If it is too small, growing it
+   * moves the samples to the start of the planes, so there is no wrap */
+  if (n_wrap > 0 && !wrap_planes && adapter->ring_guard < n_wrap) {
+    gst_planar_audio_adapter_resize_ring (adapter, adapter->ring_capacity,
+        nsamples);
+    n_first = nsamples;
+    n_wrap = 0;
+  }
+
+  bps = adapter->info.finfo->width / 8;
+  stride = (adapter->ring_capacity + adapter->ring_guard) * bps;
+
+  for (c = 0; c < adapter->info.channels; c++) {
+    guint8 *plane = adapter->ring + c * stride;
+
+    planes[c] = plane + adapter->ring_head * bps;
+    if (wrap_planes)
+      wrap_planes[c] = n_wrap ? plane : NULL;
+    else if (n_wrap)
+      memcpy (plane + adapter->ring_capacity * bps, plane, n_wrap * bps);
+  }
+
+  if (wrap_samples)
+    *wrap_samples = wrap_planes ? n_wrap : 0;
+
+  return TRUE;
+}
+
 /**
  * gst_planar_audio_adapter_available:
  * @adapter: a #GstPlanarAudioAdapter
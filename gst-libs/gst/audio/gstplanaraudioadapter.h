@@ -63,6 +63,10 @@ GST_AUDIO_BAD_API
 void gst_planar_audio_adapter_configure (GstPlanarAudioAdapter * adapter,
     const GstAudioInfo * info);
 
+GST_AUDIO_BAD_API
+void gst_planar_audio_adapter_configure_ring_buffer (GstPlanarAudioAdapter * adapter,
+    const GstAudioInfo * info, gsize capacity);
+
 GST_AUDIO_BAD_API
 void gst_planar_audio_adapter_clear (GstPlanarAudioAdapter * adapter);
 
@@ -82,6 +86,11 @@ GST_AUDIO_BAD_API
 GstBuffer * gst_planar_audio_adapter_take_buffer (GstPlanarAudioAdapter * adapter,
     gsize nsamples, GstMapFlags flags);
 
+GST_AUDIO_BAD_API
+gboolean gst_planar_audio_adapter_peek_planes (GstPlanarAudioAdapter * adapter,
+    gsize nsamples, gpointer * planes, gpointer * wrap_planes,
+    gsize * wrap_samples);
+
 GST_AUDIO_BAD_API
 gsize gst_planar_audio_adapter_available (GstPlanarAudioAdapter * adapter);
 
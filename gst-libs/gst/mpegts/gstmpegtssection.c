@@ -35,6 +35,16 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_CRC32_PCLMUL 1
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#define HAVE_CRC32_ARMV8 1
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
 #include "mpegts.h"
 #include "gstmpegts-private.h"
 
@@ -152,17 +162,184 @@ static const guint32 crc_tab[256] = {
   0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
+/* Slicing-by-8 tables, crc_slice_tab[k][b] being the CRC of byte b followed
+ * by k zero bytes (crc_slice_tab[0] == crc_tab) */
+static guint32 crc_slice_tab[8][256];
+
+static guint32
+_calc_crc32_slice8 (guint32 crc, const guint8 * data, gsize datalen)
+{
+  while (datalen >= 8) {
+    guint32 a = crc ^ GST_READ_UINT32_BE (data);
+    guint32 b = GST_READ_UINT32_BE (data + 4);
+
+    crc = crc_slice_tab[7][a >> 24] ^ crc_slice_tab[6][(a >> 16) & 0xff] ^
+        crc_slice_tab[5][(a >> 8) & 0xff] ^ crc_slice_tab[4][a & 0xff] ^
+        crc_slice_tab[3][b >> 24] ^ crc_slice_tab[2][(b >> 16) & 0xff] ^
+        crc_slice_tab[1][(b >> 8) & 0xff] ^ crc_slice_tab[0][b & 0xff];
+    data += 8;
+    datalen -= 8;
+  }
+
+  while (datalen--)
+    crc = (crc << 8) ^ crc_tab[((crc >> 24) ^ *data++) & 0xff];
+
+  return crc;
+}
+
+#if defined(HAVE_CRC32_PCLMUL)
+
+#define CRC32_FOLD(x, k, next) \
+  _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x, k, 0x11), \
+          _mm_clmulepi64_si128 (x, k, 0x00)), next)
+
+/* Folds the input 64 and then 16 bytes at a time with carry-less
+ * multiplications, keeping a 128 bit value congruent to the data processed
+ * so far modulo the CRC polynomial. The remainder is computed from that
+ * value and the tail with the tables. */
+__attribute__ ((target ("pclmul,ssse3")))
+static guint32
+_calc_crc32_pclmul (guint32 crc, const guint8 * data, gsize datalen)
+{
+  const __m128i bswap = _mm_setr_epi8 (15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5,
+      4, 3, 2, 1, 0);
+  /* x^576 mod P, x^512 mod P */
+  const __m128i k4 = _mm_set_epi64x (0x8833794c, 0xe6228b11);
+  /* x^192 mod P, x^128 mod P */
+  const __m128i k1 = _mm_set_epi64x (0xc5b9cd4c, 0xe8a45605);
+  __m128i x0, x1, x2, x3;
+  guint8 tail[32];
+
+  if (datalen < 64)
+    return _calc_crc32_slice8 (crc, data, datalen);
+
+#define LOAD(p) _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (p)), bswap)
+  x0 = _mm_xor_si128 (LOAD (data), _mm_set_epi32 ((gint) crc, 0, 0, 0));
+  x1 = LOAD (data + 16);
+  x2 = LOAD (data + 32);
+  x3 = LOAD (data + 48);
+  data += 64;
+  datalen -= 64;
+
+  while (datalen >= 64) {
+    x0 = CRC32_FOLD (x0, k4, LOAD (data));
+    x1 = CRC32_FOLD (x1, k4, LOAD (data + 16));
+    x2 = CRC32_FOLD (x2, k4, LOAD (data + 32));
+    x3 = CRC32_FOLD (x3, k4, LOAD (data + 48));
+    data += 64;
+    datalen -= 64;
+  }
+
+  x0 = CRC32_FOLD (x0, k1, x1);
+  x0 = CRC32_FOLD (x0, k1, x2);
+  x0 = CRC32_FOLD (x0, k1, x3);
+
+  while (datalen >= 16) {
+    x0 = CRC32_FOLD (x0, k1, LOAD (data));
+    data += 16;
+    datalen -= 16;
+  }
+#undef LOAD
+
+  _mm_storeu_si128 ((__m128i *) tail, _mm_shuffle_epi8 (x0, bswap));
+  memcpy (tail + 16, data, datalen);
+
+  return _calc_crc32_slice8 (0, tail, 16 + datalen);
+}
+#endif
+
+#if defined(HAVE_CRC32_ARMV8)
+
+/* The CRC32 instructions implement the bit-reflected variant of the same
+ * polynomial, so feed them bit-reversed bytes and reverse the result */
+#ifdef __clang__
+__attribute__ ((target ("crc")))
+#else
+__attribute__ ((target ("+crc")))
+#endif
+static guint32
+_calc_crc32_armv8 (guint32 crc, const guint8 * data, gsize datalen)
+{
+  crc = __rbit (crc);
+
+  while (datalen >= 8) {
+    guint64 v;
+
+    memcpy (&v, data, 8);
+    crc = __crc32d (crc, __builtin_bswap64 (__rbitll (v)));
+    data += 8;
+    datalen -= 8;
+  }
+
+  while (datalen--)
+    crc = __crc32b (crc, __rbit (*data++) >> 24);
+
+  return __rbit (crc);
+}
+#endif
+
+static guint32 (*calc_crc32_func) (guint32 crc, const guint8 * data,
+    gsize datalen);
+
+static void
+_calc_crc32_init (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    guint i, k;
+
+    for (i = 0; i < 256; i++) {
+      crc_slice_tab[0][i] = crc_tab[i];
+      for (k = 1; k < 8; k++)
+        crc_slice_tab[k][i] = (crc_slice_tab[k - 1][i] << 8) ^
+            crc_tab[crc_slice_tab[k - 1][i] >> 24];
+    }
+
+    calc_crc32_func = _calc_crc32_slice8;
+#if defined(HAVE_CRC32_PCLMUL)
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("pclmul") && __builtin_cpu_supports ("ssse3"))
+      calc_crc32_func = _calc_crc32_pclmul;
+#elif defined(HAVE_CRC32_ARMV8)
+    if (getauxval (AT_HWCAP) & HWCAP_CRC32)
+      calc_crc32_func = _calc_crc32_armv8;
+#endif
+
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
 /* _calc_crc32 relicensed to LGPL from fluendo ts demuxer */
 guint32
 _calc_crc32 (const guint8 * data, guint datalen)
 {
-  gint i;
-  guint32 crc = 0xffffffff;
+  _calc_crc32_init ();
 
-  for (i = 0; i < datalen; i++) {
-    crc = (crc << 8) ^ crc_tab[((crc >> 24) ^ *data++) & 0xff];
-  }
-  return crc;
+  return calc_crc32_func (0xffffffff, data, datalen);
+}
+
+/**
+ * gst_mpegts_calc_crc32:
+ * @data: (array length=length): the data
+ * @length: the size of @data
+ *
+ * Calculates the CRC32 used by MPEG-TS sections (ISO/IEC 13818-1 Annex A)
+ * over @data. Calculating it over a full section, including its trailing
+ * CRC_32 field, returns 0 if the section is valid.
+ *
+ * Returns: the CRC32 of @data
+ *
+ * Since: 1.22
+ */
+guint32
+gst_mpegts_calc_crc32 (const guint8 * data, gsize length)
+{
+  g_return_val_if_fail (data != NULL || length == 0, 0);
+
+  _calc_crc32_init ();
+
+  return calc_crc32_func (0xffffffff, data, length);
 }
 
 gpointer
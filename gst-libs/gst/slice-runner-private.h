@@ -0,0 +1,160 @@
+/* GStreamer
+ *
+ * slice-runner-private.h: splitting per-buffer work over a thread pool
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SLICE_RUNNER_PRIVATE_H__
+#define __GST_SLICE_RUNNER_PRIVATE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Runs a function on n_slices slices of some work, on a pool of
+ * n_slices - 1 threads with the calling thread taking the first slice, and
+ * returns once all of them are done. A runner is meant to be used from the
+ * streaming thread only; elements configure it from their n-threads
+ * property. */
+
+typedef void (*GstSliceFunc) (gpointer data, guint slice, guint n_slices);
+
+typedef struct
+{
+  GThreadPool *pool;
+  guint n_slices;        /* number of slices the current pool was made for */
+} GstSliceRunner;
+
+/* first and last + 1 of @n items that belong to @slice */
+#define GST_SLICE_START(n,slice,n_slices) ((guint) (((guint64) (n) * (slice)) / (n_slices)))
+#define GST_SLICE_END(n,slice,n_slices) GST_SLICE_START (n, (slice) + 1, n_slices)
+
+typedef struct
+{
+  GstSliceFunc func;
+  gpointer data;
+  guint n_slices;
+  guint pending;
+  GMutex lock;
+  GCond cond;
+} GstSliceJob;
+
+typedef struct
+{
+  GstSliceJob *job;
+  guint slice;
+} GstSliceTask;
+
+static inline void
+gst_slice_runner_worker (gpointer data, gpointer user_data)
+{
+  GstSliceTask *task = data;
+  GstSliceJob *job = task->job;
+
+  job->func (job->data, task->slice, job->n_slices);
+
+  g_mutex_lock (&job->lock);
+  if (--job->pending == 0)
+    g_cond_signal (&job->cond);
+  g_mutex_unlock (&job->lock);
+}
+
+static inline void
+gst_slice_runner_clear (GstSliceRunner * runner)
+{
+  if (runner->pool) {
+    g_thread_pool_free (runner->pool, FALSE, TRUE);
+    runner->pool = NULL;
+  }
+  runner->n_slices = 0;
+}
+
+/* Sizes the pool for @n_threads slices, 0 meaning one per processor. If
+ * the pool can't be created, @error is set, FALSE is returned and all
+ * slices run on the calling thread */
+static inline gboolean
+gst_slice_runner_set_n_threads (GstSliceRunner * runner, guint n_threads,
+    GError ** error)
+{
+  guint n_slices = n_threads;
+
+  if (n_slices == 0)
+    n_slices = g_get_num_processors ();
+
+  if (n_slices == runner->n_slices)
+    return TRUE;
+
+  gst_slice_runner_clear (runner);
+
+  if (n_slices > 1) {
+    runner->pool = g_thread_pool_new (gst_slice_runner_worker, NULL,
+        n_slices - 1, FALSE, error);
+    if (runner->pool == NULL) {
+      runner->n_slices = 1;
+      return FALSE;
+    }
+  }
+
+  runner->n_slices = n_slices;
+
+  return TRUE;
+}
+
+/* Calls @func for every slice of @n_items items, using no more slices than
+ * there are items */
+static inline void
+gst_slice_runner_run (GstSliceRunner * runner, guint n_items,
+    GstSliceFunc func, gpointer data)
+{
+  GstSliceJob job;
+  GstSliceTask *tasks;
+  guint i, n_slices;
+
+  n_slices = MIN (runner->n_slices, n_items);
+  if (n_slices <= 1 || runner->pool == NULL) {
+    func (data, 0, 1);
+    return;
+  }
+
+  job.func = func;
+  job.data = data;
+  job.n_slices = n_slices;
+  job.pending = n_slices - 1;
+  g_mutex_init (&job.lock);
+  g_cond_init (&job.cond);
+
+  tasks = g_newa (GstSliceTask, n_slices);
+  for (i = 1; i < n_slices; i++) {
+    tasks[i].job = &job;
+    tasks[i].slice = i;
+    g_thread_pool_push (runner->pool, &tasks[i], NULL);
+  }
+
+  func (data, 0, n_slices);
+
+  g_mutex_lock (&job.lock);
+  while (job.pending > 0)
+    g_cond_wait (&job.cond, &job.lock);
+  g_mutex_unlock (&job.lock);
+
+  g_mutex_clear (&job.lock);
+  g_cond_clear (&job.cond);
+}
+
+G_END_DECLS
+
+#endif /* __GST_SLICE_RUNNER_PRIVATE_H__ */
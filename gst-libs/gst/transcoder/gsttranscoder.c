@@ -27,6 +27,8 @@
  *   - gst_transcoder_error_quark
  */
 
+#include <glib/gstdio.h>
+
 #include "gsttranscoder.h"
 #include "gsttranscoder-private.h"
 
@@ -40,6 +42,9 @@ GST_DEBUG_CATEGORY_STATIC (gst_transcoder_debug);
 #define DEFAULT_DURATION GST_CLOCK_TIME_NONE
 #define DEFAULT_POSITION_UPDATE_INTERVAL_MS 100
 #define DEFAULT_AVOID_REENCODING   FALSE
+#define DEFAULT_N_CHUNKS 1
+#define MAX_N_CHUNKS 64
+#define CHUNK_PREROLL_TIMEOUT (10 * GST_SECOND)
 
 GQuark
 gst_transcoder_error_quark (void)
@@ -63,9 +68,28 @@ enum
   PROP_PIPELINE,
   PROP_POSITION_UPDATE_INTERVAL,
   PROP_AVOID_REENCODING,
+  PROP_N_CHUNKS,
   PROP_LAST
 };
 
+/* One of the time ranges the input is split into in chunked mode */
+typedef struct
+{
+  GstTranscoder *transcoder;
+  GstElement *pipeline;
+  GSource *bus_source;
+  gchar *location;
+
+  GstClockTime start, stop;
+  guint32 seqnum;
+  gint seek_sent;
+
+  /* protected by the pipeline's object lock */
+  GstClockTime position;
+
+  gboolean done;
+} GstTranscoderChunk;
+
 struct _GstTranscoder
 {
   GstObject parent;
@@ -95,6 +119,22 @@ struct _GstTranscoder
   GstBus *api_bus;
   GstTranscoderSignalAdapter *signal_adapter;
   GstTranscoderSignalAdapter *sync_signal_adapter;
+
+  /* chunked mode, only used from the transcoder thread */
+  guint n_chunks;
+  GPtrArray *chunks;
+  gchar *chunks_dir;
+  GstElement *stitcher;
+  GSource *stitcher_bus_source;
+  GstClockTime chunked_duration;
+  GstClockTime chunked_position;        /* protected by the object lock */
+
+  /* The input is split from its own thread, which sets the boundaries and
+   * the duration before it exits */
+  GThread *probe_thread;
+  gint probe_cancelled;
+  GArray *boundaries;
+  GstClockTime probed_duration;
 };
 
 struct _GstTranscoderClass
@@ -119,6 +159,9 @@ static gpointer gst_transcoder_main (gpointer data);
 
 static gboolean gst_transcoder_set_position_update_interval_internal (gpointer
     user_data);
+static void gst_transcoder_chunked_cleanup (GstTranscoder * self);
+static GstClockTime chunked_position (GstTranscoder * self);
+static gboolean gst_transcoder_run_chunked_or_linear (GstTranscoder * self);
 
 
 /**
@@ -154,6 +197,8 @@ gst_transcoder_init (GstTranscoder * self)
   self->loop = g_main_loop_new (self->context, FALSE);
   self->api_bus = gst_bus_new ();
   self->wanted_cpu_usage = 100;
+  self->n_chunks = DEFAULT_N_CHUNKS;
+  self->chunked_position = GST_CLOCK_TIME_NONE;
 
   self->position_update_interval_ms = DEFAULT_POSITION_UPDATE_INTERVAL_MS;
 
@@ -216,6 +261,26 @@ gst_transcoder_class_init (GstTranscoderClass * klass)
       "Whether to re-encode portions of compatible video streams that lay on segment boundaries",
       DEFAULT_AVOID_REENCODING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstTranscoder:n-chunks:
+   *
+   * Number of time ranges the input is split into, at keyframes, to be
+   * transcoded concurrently by as many pipelines. The transcoded ranges are
+   * then remuxed into the destination. 1 transcodes the input linearly, in a
+   * single pipeline.
+   *
+   * Chunked transcoding requires a seekable input with a known duration, a
+   * local destination file and a #GstEncodingContainerProfile, otherwise the
+   * input is transcoded linearly.
+   *
+   * Since: 1.22
+   */
+  param_specs[PROP_N_CHUNKS] =
+      g_param_spec_uint ("n-chunks", "Number of chunks",
+      "Number of time ranges to transcode concurrently (1 = linear)",
+      1, MAX_N_CHUNKS, DEFAULT_N_CHUNKS,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, param_specs);
 }
 
@@ -330,6 +395,11 @@ gst_transcoder_set_property (GObject * object, guint prop_id,
       g_object_set (self->transcodebin, "avoid-reencoding",
           g_value_get_boolean (value), NULL);
       break;
+    case PROP_N_CHUNKS:
+      GST_OBJECT_LOCK (self);
+      self->n_chunks = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -356,9 +426,14 @@ gst_transcoder_get_property (GObject * object, guint prop_id,
     case PROP_POSITION:{
       gint64 position = 0;
 
+      GST_OBJECT_LOCK (self);
+      if (GST_CLOCK_TIME_IS_VALID (self->chunked_position))
+        position = self->chunked_position;
+      GST_OBJECT_UNLOCK (self);
+
       if (self->is_eos)
         position = self->last_duration;
-      else
+      else if (!position)
         gst_element_query_position (self->transcodebin, GST_FORMAT_TIME,
             &position);
       g_value_set_uint64 (value, position);
@@ -399,6 +474,11 @@ gst_transcoder_get_property (GObject * object, guint prop_id,
       g_value_set_boolean (value, avoid_reencoding);
       break;
     }
+    case PROP_N_CHUNKS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->n_chunks);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -456,7 +536,12 @@ tick_cb (gpointer user_data)
   if (self->target_state < GST_STATE_PAUSED)
     return G_SOURCE_CONTINUE;
 
-  if (!gst_element_query_position (self->transcodebin, GST_FORMAT_TIME,
+  if (self->chunks) {
+    position = chunked_position (self);
+    GST_OBJECT_LOCK (self);
+    self->chunked_position = position;
+    GST_OBJECT_UNLOCK (self);
+  } else if (!gst_element_query_position (self->transcodebin, GST_FORMAT_TIME,
           &position)) {
     GST_LOG_OBJECT (self, "Could not query position");
     return G_SOURCE_CONTINUE;
@@ -781,6 +866,646 @@ element_cb (G_GNUC_UNUSED GstBus * bus, GstMessage * msg, gpointer user_data)
 }
 
 
+/* Chunked transcoding
+ *
+ * The input is split at keyframes into time ranges, each transcoded into a
+ * temporary file by its own uritranscodebin, all of them running
+ * concurrently. The ranges are set up by dropping the data that comes out
+ * of decodebin3 until the range seek, sent from a pad of the first stream
+ * with data, has gone through. Once all the ranges are done, splitmuxsrc
+ * reads them back as one continuous stream which is remuxed into the
+ * destination.
+ */
+
+static gboolean
+wait_async_done (GstBus * bus)
+{
+  GstMessage *msg;
+  gboolean ret;
+
+  msg = gst_bus_timed_pop_filtered (bus, CHUNK_PREROLL_TIMEOUT,
+      GST_MESSAGE_ASYNC_DONE | GST_MESSAGE_ERROR);
+  if (!msg)
+    return FALSE;
+
+  ret = GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ASYNC_DONE;
+  gst_message_unref (msg);
+
+  return ret;
+}
+
+/* Returns the start of each range, which are all keyframe positions, and
+ * the duration of the input */
+static GArray *
+find_chunk_boundaries (GstTranscoder * self, guint n_chunks,
+    GstClockTime * duration)
+{
+  GstElement *playbin;
+  GstBus *bus;
+  GArray *boundaries = NULL;
+  GstClockTime boundary = 0;
+  gint64 dur, pos;
+  guint i;
+
+  playbin = gst_element_factory_make ("playbin", NULL);
+  if (!playbin)
+    return NULL;
+
+  g_object_set (playbin, "uri", self->source_uri,
+      "video-sink", gst_element_factory_make ("fakesink", NULL),
+      "audio-sink", gst_element_factory_make ("fakesink", NULL),
+      "text-sink", gst_element_factory_make ("fakesink", NULL), NULL);
+  bus = gst_element_get_bus (playbin);
+
+  if (gst_element_set_state (playbin, GST_STATE_PAUSED) ==
+      GST_STATE_CHANGE_FAILURE || !wait_async_done (bus))
+    goto done;
+
+  if (!gst_element_query_duration (playbin, GST_FORMAT_TIME, &dur) || dur <= 0) {
+    GST_INFO_OBJECT (self, "Unknown duration, can't split the input");
+    goto done;
+  }
+
+  boundaries = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  g_array_append_val (boundaries, boundary);
+
+  /* Snap each nominal boundary to the keyframe before it */
+  for (i = 1; i < n_chunks; i++) {
+    GstClockTime target = gst_util_uint64_scale (dur, i, n_chunks);
+
+    if (g_atomic_int_get (&self->probe_cancelled)) {
+      g_clear_pointer (&boundaries, g_array_unref);
+      goto done;
+    }
+
+    if (!gst_element_seek_simple (playbin, GST_FORMAT_TIME,
+            GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT |
+            GST_SEEK_FLAG_SNAP_BEFORE, target) || !wait_async_done (bus) ||
+        !gst_element_query_position (playbin, GST_FORMAT_TIME, &pos)) {
+      GST_INFO_OBJECT (self, "Could not seek to %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (target));
+      break;
+    }
+
+    if (pos > boundary) {
+      boundary = pos;
+      g_array_append_val (boundaries, boundary);
+    }
+  }
+
+  *duration = dur;
+
+done:
+  gst_element_set_state (playbin, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (playbin);
+
+  return boundaries;
+}
+
+typedef struct
+{
+  GstPad *pad;
+  GstEvent *seek;
+} ChunkSeek;
+
+static void
+chunk_seek_free (ChunkSeek * seek)
+{
+  gst_object_unref (seek->pad);
+  gst_event_unref (seek->seek);
+  g_free (seek);
+}
+
+static void
+chunk_seek (GstElement * element, ChunkSeek * seek)
+{
+  if (!gst_pad_send_event (seek->pad, gst_event_ref (seek->seek)))
+    GST_ELEMENT_ERROR (element, CORE, SEEK, (NULL),
+        ("Could not seek to the start of the chunk"));
+}
+
+static GstPadProbeReturn
+chunk_decoded_probe (GstPad * pad, GstPadProbeInfo * info,
+    GstTranscoderChunk * chunk)
+{
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+    if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT
+        && GST_EVENT_SEQNUM (event) == chunk->seqnum)
+      g_object_set_data (G_OBJECT (pad), "gst-transcoder-chunk-started",
+          GINT_TO_POINTER (TRUE));
+
+    return GST_PAD_PROBE_OK;
+  }
+
+  if (!g_object_get_data (G_OBJECT (pad), "gst-transcoder-chunk-started")) {
+    /* Data from before the range seek */
+    if (g_atomic_int_compare_and_exchange (&chunk->seek_sent, FALSE, TRUE)) {
+      ChunkSeek *seek = g_new0 (ChunkSeek, 1);
+
+      seek->pad = gst_object_ref (pad);
+      seek->seek = gst_event_new_seek (1.0, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE, GST_SEEK_TYPE_SET,
+          chunk->start, GST_SEEK_TYPE_SET, chunk->stop);
+      gst_event_set_seqnum (seek->seek, chunk->seqnum);
+
+      /* A flushing seek can't be done from the streaming thread */
+      gst_element_call_async (chunk->pipeline,
+          (GstElementCallAsyncFunc) chunk_seek, seek,
+          (GDestroyNotify) chunk_seek_free);
+    }
+
+    return GST_PAD_PROBE_DROP;
+  }
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+
+    if (GST_BUFFER_PTS_IS_VALID (buf)) {
+      GstClockTime end = GST_BUFFER_PTS (buf);
+
+      if (GST_BUFFER_DURATION_IS_VALID (buf))
+        end += GST_BUFFER_DURATION (buf);
+
+      GST_OBJECT_LOCK (chunk->pipeline);
+      if (end > chunk->start
+          && (!GST_CLOCK_TIME_IS_VALID (chunk->position)
+              || end - chunk->start > chunk->position))
+        chunk->position = end - chunk->start;
+      GST_OBJECT_UNLOCK (chunk->pipeline);
+    }
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+chunk_decodebin_pad_added_cb (G_GNUC_UNUSED GstElement * decodebin,
+    GstPad * pad, GstTranscoderChunk * chunk)
+{
+  if (!GST_PAD_IS_SRC (pad))
+    return;
+
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER |
+      GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      (GstPadProbeCallback) chunk_decoded_probe, chunk, NULL);
+}
+
+static void
+chunk_element_setup_cb (G_GNUC_UNUSED GstElement * uritranscodebin,
+    GstElement * element, GstTranscoderChunk * chunk)
+{
+  GstElementFactory *factory = gst_element_get_factory (element);
+
+  if (factory && !g_strcmp0 (GST_OBJECT_NAME (factory), "decodebin3"))
+    g_signal_connect (element, "pad-added",
+        G_CALLBACK (chunk_decodebin_pad_added_cb), chunk);
+}
+
+static GstClockTime
+chunked_position (GstTranscoder * self)
+{
+  GstClockTime position = 0;
+  guint i;
+
+  for (i = 0; i < self->chunks->len; i++) {
+    GstTranscoderChunk *chunk = g_ptr_array_index (self->chunks, i);
+
+    if (chunk->done && GST_CLOCK_TIME_IS_VALID (chunk->stop)) {
+      position += chunk->stop - chunk->start;
+      continue;
+    }
+
+    GST_OBJECT_LOCK (chunk->pipeline);
+    if (GST_CLOCK_TIME_IS_VALID (chunk->position))
+      position += chunk->position;
+    GST_OBJECT_UNLOCK (chunk->pipeline);
+  }
+
+  return MIN (position, self->chunked_duration);
+}
+
+static void
+chunked_done (GstTranscoder * self)
+{
+  GST_DEBUG_OBJECT (self, "Chunked transcoding done");
+
+  self->last_duration = self->chunked_duration;
+  tick_cb (self);
+  remove_tick_source (self);
+
+  gst_transcoder_chunked_cleanup (self);
+
+  notify_state_changed (self, GST_TRANSCODER_STATE_STOPPED);
+  api_bus_post_message (self, GST_TRANSCODER_MESSAGE_DONE, NULL, NULL);
+  self->is_eos = TRUE;
+}
+
+static void
+chunked_error (GstTranscoder * self, GstMessage * msg)
+{
+  error_cb (NULL, msg, self);
+  remove_tick_source (self);
+  gst_transcoder_chunked_cleanup (self);
+  notify_state_changed (self, GST_TRANSCODER_STATE_STOPPED);
+}
+
+static gboolean
+stitcher_bus_cb (G_GNUC_UNUSED GstBus * bus, GstMessage * msg,
+    GstTranscoder * self)
+{
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:
+      chunked_error (self, msg);
+      return G_SOURCE_REMOVE;
+    case GST_MESSAGE_WARNING:
+      warning_cb (NULL, msg, self);
+      break;
+    case GST_MESSAGE_EOS:
+      chunked_done (self);
+      return G_SOURCE_REMOVE;
+    default:
+      break;
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+stitcher_pad_added_cb (G_GNUC_UNUSED GstElement * src, GstPad * pad,
+    GstElement * muxer)
+{
+  GstPad *sinkpad;
+
+  sinkpad = gst_element_get_compatible_pad (muxer, pad, NULL);
+  if (!sinkpad || gst_pad_link (pad, sinkpad) != GST_PAD_LINK_OK)
+    GST_ELEMENT_ERROR (muxer, STREAM, MUX, (NULL),
+        ("Could not link %" GST_PTR_FORMAT " to the muxer", pad));
+
+  gst_clear_object (&sinkpad);
+}
+
+static GstElement *
+make_stitcher_muxer (GstTranscoder * self)
+{
+  GstElement *muxer = NULL;
+  GstCaps *format;
+  GList *muxers, *compatible;
+
+  format = gst_encoding_profile_get_format (self->profile);
+  muxers =
+      gst_element_factory_list_get_elements (GST_ELEMENT_FACTORY_TYPE_MUXER,
+      GST_RANK_MARGINAL);
+  compatible =
+      gst_element_factory_list_filter (muxers, format, GST_PAD_SRC, FALSE);
+  compatible = g_list_sort (compatible, gst_plugin_feature_rank_compare_func);
+
+  if (compatible)
+    muxer = gst_element_factory_create (compatible->data, NULL);
+
+  gst_plugin_feature_list_free (compatible);
+  gst_plugin_feature_list_free (muxers);
+  gst_caps_unref (format);
+
+  return muxer;
+}
+
+static gboolean
+start_stitcher (GstTranscoder * self)
+{
+  GstElement *src, *muxer, *sink;
+  GstBus *bus;
+  gchar *pattern, *location;
+
+  GST_DEBUG_OBJECT (self, "All chunks done, stitching them");
+
+  src = gst_element_factory_make ("splitmuxsrc", NULL);
+  muxer = make_stitcher_muxer (self);
+  sink = gst_element_factory_make ("filesink", NULL);
+  if (!src || !muxer || !sink) {
+    gst_clear_object (&src);
+    gst_clear_object (&muxer);
+    gst_clear_object (&sink);
+    return FALSE;
+  }
+
+  pattern = g_build_filename (self->chunks_dir, "chunk-*", NULL);
+  location = g_filename_from_uri (self->dest_uri, NULL, NULL);
+  g_object_set (src, "location", pattern, NULL);
+  g_object_set (sink, "location", location, "async", FALSE, NULL);
+  g_free (pattern);
+  g_free (location);
+
+  self->stitcher = gst_pipeline_new ("gst-transcoder-stitcher");
+  gst_bin_add_many (GST_BIN (self->stitcher), src, muxer, sink, NULL);
+  gst_element_link (muxer, sink);
+  g_signal_connect (src, "pad-added", G_CALLBACK (stitcher_pad_added_cb),
+      muxer);
+
+  bus = gst_element_get_bus (self->stitcher);
+  self->stitcher_bus_source = gst_bus_create_watch (bus);
+  g_source_set_callback (self->stitcher_bus_source,
+      (GSourceFunc) stitcher_bus_cb, self, NULL);
+  g_source_attach (self->stitcher_bus_source, self->context);
+  gst_object_unref (bus);
+
+  return gst_element_set_state (self->stitcher, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE;
+}
+
+static gboolean
+chunk_bus_cb (G_GNUC_UNUSED GstBus * bus, GstMessage * msg,
+    GstTranscoderChunk * chunk)
+{
+  GstTranscoder *self = chunk->transcoder;
+  guint i;
+
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:
+      chunked_error (self, msg);
+      return G_SOURCE_REMOVE;
+    case GST_MESSAGE_WARNING:
+      warning_cb (NULL, msg, self);
+      break;
+    case GST_MESSAGE_EOS:
+      GST_DEBUG_OBJECT (self, "Chunk %s done", chunk->location);
+      chunk->done = TRUE;
+      gst_element_set_state (chunk->pipeline, GST_STATE_NULL);
+
+      for (i = 0; i < self->chunks->len; i++) {
+        if (!((GstTranscoderChunk *) g_ptr_array_index (self->chunks,
+                    i))->done)
+          return G_SOURCE_REMOVE;
+      }
+
+      if (!start_stitcher (self)) {
+        GError *err = g_error_new (GST_TRANSCODER_ERROR,
+            GST_TRANSCODER_ERROR_FAILED, "Could not stitch the chunks");
+
+        api_bus_post_message (self, GST_TRANSCODER_MESSAGE_ERROR,
+            GST_TRANSCODER_MESSAGE_DATA_ERROR, G_TYPE_ERROR, err, NULL);
+        g_error_free (err);
+        remove_tick_source (self);
+        gst_transcoder_chunked_cleanup (self);
+        notify_state_changed (self, GST_TRANSCODER_STATE_STOPPED);
+      }
+      return G_SOURCE_REMOVE;
+    default:
+      break;
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+chunk_free (GstTranscoderChunk * chunk)
+{
+  if (chunk->bus_source) {
+    g_source_destroy (chunk->bus_source);
+    g_source_unref (chunk->bus_source);
+  }
+
+  gst_element_set_state (chunk->pipeline, GST_STATE_NULL);
+  gst_object_unref (chunk->pipeline);
+
+  g_unlink (chunk->location);
+  g_free (chunk->location);
+  g_free (chunk);
+}
+
+static void
+gst_transcoder_chunked_cleanup (GstTranscoder * self)
+{
+  if (self->probe_thread) {
+    g_atomic_int_set (&self->probe_cancelled, TRUE);
+    g_thread_join (self->probe_thread);
+    self->probe_thread = NULL;
+    g_atomic_int_set (&self->probe_cancelled, FALSE);
+  }
+  g_clear_pointer (&self->boundaries, g_array_unref);
+
+  if (self->stitcher_bus_source) {
+    g_source_destroy (self->stitcher_bus_source);
+    g_source_unref (self->stitcher_bus_source);
+    self->stitcher_bus_source = NULL;
+  }
+
+  if (self->stitcher) {
+    gst_element_set_state (self->stitcher, GST_STATE_NULL);
+    gst_clear_object (&self->stitcher);
+  }
+
+  g_clear_pointer (&self->chunks, g_ptr_array_unref);
+
+  GST_OBJECT_LOCK (self);
+  self->chunked_position = GST_CLOCK_TIME_NONE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (self->chunks_dir) {
+    g_rmdir (self->chunks_dir);
+    g_clear_pointer (&self->chunks_dir, g_free);
+  }
+}
+
+static GstTranscoderChunk *
+chunk_new (GstTranscoder * self, guint index, GstClockTime start,
+    GstClockTime stop)
+{
+  GstTranscoderChunk *chunk = g_new0 (GstTranscoderChunk, 1);
+  gboolean avoid_reencoding;
+  gchar *name, *dest_uri;
+  GstBus *bus;
+
+  chunk->transcoder = self;
+  chunk->start = start;
+  chunk->stop = stop;
+  chunk->seqnum = gst_util_seqnum_next ();
+  chunk->position = GST_CLOCK_TIME_NONE;
+
+  name = g_strdup_printf ("chunk-%04u", index);
+  chunk->location = g_build_filename (self->chunks_dir, name, NULL);
+  dest_uri = gst_filename_to_uri (chunk->location, NULL);
+
+  chunk->pipeline = gst_element_factory_make ("uritranscodebin", name);
+  g_object_get (self->transcodebin, "avoid-reencoding", &avoid_reencoding,
+      NULL);
+  g_object_set (chunk->pipeline, "source-uri", self->source_uri,
+      "dest-uri", dest_uri, "profile", self->profile,
+      "cpu-usage", self->wanted_cpu_usage,
+      "avoid-reencoding", avoid_reencoding, NULL);
+  g_signal_connect (chunk->pipeline, "element-setup",
+      G_CALLBACK (chunk_element_setup_cb), chunk);
+  g_free (dest_uri);
+  g_free (name);
+
+  bus = gst_element_get_bus (chunk->pipeline);
+  chunk->bus_source = gst_bus_create_watch (bus);
+  g_source_set_callback (chunk->bus_source, (GSourceFunc) chunk_bus_cb,
+      chunk, NULL);
+  g_source_attach (chunk->bus_source, self->context);
+  gst_object_unref (bus);
+
+  return chunk;
+}
+
+/* Called from the transcoder thread with the boundaries found by the probe
+ * thread, which it frees, returns FALSE if the input has to be transcoded
+ * linearly */
+static gboolean
+gst_transcoder_chunked_start (GstTranscoder * self, GArray * boundaries,
+    GstClockTime duration)
+{
+  gchar *location, *dir, *template;
+  guint i;
+
+  if (!boundaries || boundaries->len < 2) {
+    GST_WARNING_OBJECT (self, "Could not split the input, "
+        "transcoding linearly");
+    if (boundaries)
+      g_array_unref (boundaries);
+    return FALSE;
+  }
+
+  location = g_filename_from_uri (self->dest_uri, NULL, NULL);
+  dir = g_path_get_dirname (location);
+  template = g_build_filename (dir, ".gst-transcoder-XXXXXX", NULL);
+  g_free (location);
+  g_free (dir);
+
+  if (!g_mkdtemp (template)) {
+    GST_WARNING_OBJECT (self, "Could not create a temporary directory next "
+        "to the destination, transcoding linearly");
+    g_free (template);
+    g_array_unref (boundaries);
+    return FALSE;
+  }
+
+  self->chunks_dir = template;
+  self->chunked_duration = duration;
+  self->chunks = g_ptr_array_new_with_free_func ((GDestroyNotify) chunk_free);
+
+  for (i = 0; i < boundaries->len; i++) {
+    GstClockTime start = g_array_index (boundaries, GstClockTime, i);
+    GstClockTime stop = i + 1 < boundaries->len ?
+        g_array_index (boundaries, GstClockTime, i + 1) : GST_CLOCK_TIME_NONE;
+
+    GST_INFO_OBJECT (self, "Chunk %u: %" GST_TIME_FORMAT " - %" GST_TIME_FORMAT,
+        i, GST_TIME_ARGS (start), GST_TIME_ARGS (stop));
+    g_ptr_array_add (self->chunks, chunk_new (self, i, start, stop));
+  }
+  g_array_unref (boundaries);
+
+  api_bus_post_message (self, GST_TRANSCODER_MESSAGE_DURATION_CHANGED,
+      GST_TRANSCODER_MESSAGE_DATA_DURATION, GST_TYPE_CLOCK_TIME,
+      self->chunked_duration, NULL);
+
+  for (i = 0; i < self->chunks->len; i++) {
+    GstTranscoderChunk *chunk = g_ptr_array_index (self->chunks, i);
+
+    if (gst_element_set_state (chunk->pipeline, GST_STATE_PLAYING) ==
+        GST_STATE_CHANGE_FAILURE) {
+      GError *err = g_error_new (GST_TRANSCODER_ERROR,
+          GST_TRANSCODER_ERROR_FAILED, "Could not start transcoding");
+
+      api_bus_post_message (self, GST_TRANSCODER_MESSAGE_ERROR,
+          GST_TRANSCODER_MESSAGE_DATA_ERROR, G_TYPE_ERROR, err, NULL);
+      g_error_free (err);
+      gst_transcoder_chunked_cleanup (self);
+
+      return TRUE;
+    }
+  }
+
+  add_tick_source (self);
+  notify_state_changed (self, GST_TRANSCODER_STATE_PLAYING);
+
+  return TRUE;
+}
+
+static void
+gst_transcoder_linear_start (GstTranscoder * self)
+{
+  GstStateChangeReturn state_ret;
+
+  state_ret = gst_element_set_state (self->transcodebin, GST_STATE_PLAYING);
+  if (state_ret == GST_STATE_CHANGE_FAILURE) {
+    GError *err = g_error_new (GST_TRANSCODER_ERROR,
+        GST_TRANSCODER_ERROR_FAILED, "Could not start transcoding");
+    api_bus_post_message (self, GST_TRANSCODER_MESSAGE_ERROR,
+        GST_TRANSCODER_MESSAGE_DATA_ERROR, G_TYPE_ERROR, err, NULL);
+    g_error_free (err);
+  }
+}
+
+/* Called from the transcoder thread once the probe thread is done */
+static gboolean
+chunk_boundaries_found_cb (GstTranscoder * self)
+{
+  GArray *boundaries;
+
+  /* Cleaned up while the input was probed */
+  if (!self->probe_thread)
+    return G_SOURCE_REMOVE;
+
+  g_thread_join (self->probe_thread);
+  self->probe_thread = NULL;
+
+  boundaries = g_steal_pointer (&self->boundaries);
+  if (!gst_transcoder_chunked_start (self, boundaries, self->probed_duration))
+    gst_transcoder_linear_start (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Prerolling and seeking the input blocks, so this runs in its own thread
+ * to keep the transcoder thread dispatching its messages meanwhile */
+static gpointer
+chunk_boundaries_probe (GstTranscoder * self)
+{
+  GstClockTime duration = GST_CLOCK_TIME_NONE;
+  GSource *source;
+  guint n_chunks;
+
+  GST_OBJECT_LOCK (self);
+  n_chunks = self->n_chunks;
+  GST_OBJECT_UNLOCK (self);
+
+  self->boundaries = find_chunk_boundaries (self, n_chunks, &duration);
+  self->probed_duration = duration;
+
+  /* Not invoked, which could call back from this thread */
+  source = g_idle_source_new ();
+  g_source_set_callback (source, (GSourceFunc) chunk_boundaries_found_cb,
+      self, NULL);
+  g_source_attach (source, self->context);
+  g_source_unref (source);
+
+  return NULL;
+}
+
+static gboolean
+gst_transcoder_run_chunked_or_linear (GstTranscoder * self)
+{
+  /* Already started */
+  if (self->probe_thread || self->chunks)
+    return G_SOURCE_REMOVE;
+
+  if (!GST_IS_ENCODING_CONTAINER_PROFILE (self->profile) ||
+      !gst_uri_has_protocol (self->dest_uri, "file")) {
+    GST_WARNING_OBJECT (self, "Chunked transcoding needs a container profile "
+        "and a local destination, transcoding linearly");
+    gst_transcoder_linear_start (self);
+    return G_SOURCE_REMOVE;
+  }
+
+  self->probe_thread = g_thread_new ("GstTranscoderProbe",
+      (GThreadFunc) chunk_boundaries_probe, self);
+
+  return G_SOURCE_REMOVE;
+}
+
 static gpointer
 gst_transcoder_main (gpointer data)
 {
@@ -833,6 +1558,7 @@ gst_transcoder_main (gpointer data)
   gst_object_unref (bus);
 
   remove_tick_source (self);
+  gst_transcoder_chunked_cleanup (self);
 
   g_main_context_pop_thread_default (self->context);
 
@@ -1027,6 +1753,17 @@ gst_transcoder_run_async (GstTranscoder * self)
   }
 
   self->target_state = GST_STATE_PLAYING;
+
+  GST_OBJECT_LOCK (self);
+  if (self->n_chunks > 1) {
+    GST_OBJECT_UNLOCK (self);
+    /* The chunks are started from the transcoder thread */
+    g_main_context_invoke (self->context,
+        (GSourceFunc) gst_transcoder_run_chunked_or_linear, self);
+    return;
+  }
+  GST_OBJECT_UNLOCK (self);
+
   state_ret = gst_element_set_state (self->transcodebin, GST_STATE_PLAYING);
 
   if (state_ret == GST_STATE_CHANGE_FAILURE) {
@@ -51,6 +51,8 @@ enum
   PROP_STRICT_BUFFER_SIZE,
   PROP_GAPLESS,
   PROP_MAX_SILENCE_TIME,
+  PROP_ZERO_COPY,
+  PROP_OUTPUT_BUFFER_LIST,
   LAST_PROP
 };
 
@@ -61,6 +63,8 @@ enum
 #define DEFAULT_STRICT_BUFFER_SIZE (FALSE)
 #define DEFAULT_GAPLESS (FALSE)
 #define DEFAULT_MAX_SILENCE_TIME (0)
+#define DEFAULT_ZERO_COPY (FALSE)
+#define DEFAULT_OUTPUT_BUFFER_LIST (FALSE)
 
 #define parent_class gst_audio_buffer_split_parent_class
 G_DEFINE_TYPE_WITH_CODE (GstAudioBufferSplit, gst_audio_buffer_split,
@@ -157,6 +161,37 @@ gst_audio_buffer_split_class_init (GstAudioBufferSplitClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
           GST_PARAM_MUTABLE_READY));
 
+  /**
+   * GstAudioBufferSplit:zero-copy
+   *
+   * Output buffers made of the memories of the input buffers instead of
+   * copying the samples into a new memory whenever an output buffer spans
+   * several input buffers.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero copy",
+          "Output buffers referencing the memories of the input buffers "
+          "instead of copying them", DEFAULT_ZERO_COPY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstAudioBufferSplit:output-buffer-list
+   *
+   * Push all the output buffers produced from one input buffer downstream
+   * at once in a #GstBufferList, instead of one by one.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_OUTPUT_BUFFER_LIST,
+      g_param_spec_boolean ("output-buffer-list", "Output buffer list",
+          "Push the output buffers produced from each input buffer in a "
+          "buffer list", DEFAULT_OUTPUT_BUFFER_LIST,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   gst_element_class_set_static_metadata (gstelement_class,
       "Audio Buffer Split", "Audio/Filter",
       "Splits raw audio buffers into equal sized chunks",
@@ -193,6 +228,8 @@ gst_audio_buffer_split_init (GstAudioBufferSplit * self)
   self->strict_buffer_size = DEFAULT_STRICT_BUFFER_SIZE;
   self->gapless = DEFAULT_GAPLESS;
   self->output_buffer_size = 0;
+  self->zero_copy = DEFAULT_ZERO_COPY;
+  self->output_buffer_list = DEFAULT_OUTPUT_BUFFER_LIST;
 
   self->adapter = gst_adapter_new ();
 
@@ -301,6 +338,12 @@ gst_audio_buffer_split_set_property (GObject * object, guint property_id,
     case PROP_MAX_SILENCE_TIME:
       self->max_silence_time = g_value_get_uint64 (value);
       break;
+    case PROP_ZERO_COPY:
+      self->zero_copy = g_value_get_boolean (value);
+      break;
+    case PROP_OUTPUT_BUFFER_LIST:
+      self->output_buffer_list = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -342,6 +385,12 @@ gst_audio_buffer_split_get_property (GObject * object, guint property_id,
     case PROP_MAX_SILENCE_TIME:
       g_value_set_uint64 (value, self->max_silence_time);
       break;
+    case PROP_ZERO_COPY:
+      g_value_set_boolean (value, self->zero_copy);
+      break;
+    case PROP_OUTPUT_BUFFER_LIST:
+      g_value_set_boolean (value, self->output_buffer_list);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -399,6 +448,7 @@ gst_audio_buffer_split_output (GstAudioBufferSplit * self, gboolean force,
   gint size, avail;
   GstFlowReturn ret = GST_FLOW_OK;
   GstClockTime resync_pts;
+  GstBufferList *list = NULL;
 
   resync_pts = self->resync_pts;
   size = samples_per_buffer * bpf;
@@ -409,13 +459,24 @@ gst_audio_buffer_split_output (GstAudioBufferSplit * self, gboolean force,
       self->output_buffer_duration_d)
     size += bpf;
 
+  if (self->output_buffer_list) {
+    list =
+        gst_buffer_list_new_sized (gst_adapter_available (self->adapter) /
+        size + 1);
+  }
+
   while ((avail = gst_adapter_available (self->adapter)) >= size || (force
           && avail > 0)) {
     GstBuffer *buffer;
     GstClockTime resync_time_diff;
 
     size = MIN (size, avail);
-    buffer = gst_adapter_take_buffer (self->adapter, size);
+    /* Without copying, the buffer is made of one memory per input buffer it
+     * spans */
+    if (self->zero_copy)
+      buffer = gst_adapter_take_buffer_fast (self->adapter, size);
+    else
+      buffer = gst_adapter_take_buffer (self->adapter, size);
     buffer = gst_buffer_make_writable (buffer);
 
     /* After a reset we have to set the discont flag */
@@ -462,9 +523,13 @@ gst_audio_buffer_split_output (GstAudioBufferSplit * self, gboolean force,
         GST_TIME_ARGS (GST_BUFFER_PTS (buffer)),
         GST_TIME_ARGS (GST_BUFFER_DURATION (buffer)), size / bpf);
 
-    ret = gst_pad_push (self->srcpad, buffer);
-    if (ret != GST_FLOW_OK)
-      break;
+    if (list) {
+      gst_buffer_list_add (list, buffer);
+    } else {
+      ret = gst_pad_push (self->srcpad, buffer);
+      if (ret != GST_FLOW_OK)
+        break;
+    }
 
     /* Update the size based on the accumulated error we have now after
      * taking out a buffer. Same code as above */
@@ -474,6 +539,16 @@ gst_audio_buffer_split_output (GstAudioBufferSplit * self, gboolean force,
       size += bpf;
   }
 
+  if (list) {
+    if (gst_buffer_list_length (list) > 0) {
+      GST_LOG_OBJECT (self, "Outputting list of %u buffers",
+          gst_buffer_list_length (list));
+      ret = gst_pad_push_list (self->srcpad, list);
+    } else {
+      gst_buffer_list_unref (list);
+    }
+  }
+
   return ret;
 }
 
@@ -49,6 +49,27 @@
  * "average-latency" fields in the GstStructure.
  *
  * The average latency is a running average of the last 5 measurements.
+ *
+ * ## Correlation mode
+ *
+ * With #GstAudioLatency:mode set to `correlation`, the element continuously
+ * measures the latency without audible ticks. A pseudo-random sequence of
+ * 32768 samples is repeated at a low amplitude (see
+ * #GstAudioLatency:probe-amplitude) on the source pad, and each received
+ * period of 32768 samples is cross-correlated with it, using an FFT. The
+ * position of the correlation peak tells which part of the sequence was
+ * received, and thus when it was sent. Latencies are measured modulo the
+ * duration of the sequence, about 680ms at 48kHz.
+ *
+ * Each measurement has a confidence between 0 and 1, derived from how much
+ * the correlation peak stands out from the rest of the correlation. It is
+ * available from the #GstAudioLatency:confidence property and the
+ * "confidence" field of the "latency" message. Measurements below
+ * #GstAudioLatency:min-confidence are discarded.
+ *
+ * |[
+ * gst-launch-1.0 -v autoaudiosrc ! audiolatency mode=correlation print-latency=true ! autoaudiosink
+ * ]| Continuously print the latency using an inaudible probe
  */
 
 #ifdef HAVE_CONFIG_H
@@ -87,6 +108,28 @@ GST_ELEMENT_REGISTER_DEFINE (audiolatency, "audiolatency", GST_RANK_PRIMARY,
 
 #define DEFAULT_PRINT_LATENCY   FALSE
 #define DEFAULT_SAMPLES_PER_BUFFER 240
+#define DEFAULT_MODE GST_AUDIOLATENCY_MODE_TICKS
+#define DEFAULT_PROBE_AMPLITUDE 0.001
+#define DEFAULT_MIN_CONFIDENCE 0.5
+
+#define GST_TYPE_AUDIOLATENCY_MODE (gst_audiolatency_mode_get_type ())
+static GType
+gst_audiolatency_mode_get_type (void)
+{
+  static GType type = 0;
+
+  static const GEnumValue modes[] = {
+    {GST_AUDIOLATENCY_MODE_TICKS, "Audible ticks once a second", "ticks"},
+    {GST_AUDIOLATENCY_MODE_CORRELATION,
+        "Cross-correlation with a low-amplitude probe sequence", "correlation"},
+    {0, NULL, NULL}
+  };
+
+  if (!type) {
+    type = g_enum_register_static ("GstAudioLatencyMode", modes);
+  }
+  return type;
+}
 
 enum
 {
@@ -95,6 +138,10 @@ enum
   PROP_LAST_LATENCY,
   PROP_AVERAGE_LATENCY,
   PROP_SAMPLES_PER_BUFFER,
+  PROP_MODE,
+  PROP_PROBE_AMPLITUDE,
+  PROP_MIN_CONFIDENCE,
+  PROP_CONFIDENCE,
 };
 
 static gint64 gst_audiolatency_get_latency (GstAudioLatency * self);
@@ -105,6 +152,55 @@ static gboolean gst_audiolatency_sink_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
 static GstPadProbeReturn gst_audiolatency_src_probe (GstPad * pad,
     GstPadProbeInfo * info, gpointer user_data);
+static GstStateChangeReturn gst_audiolatency_change_state (GstElement *
+    element, GstStateChange transition);
+
+static void
+gst_audiolatency_setup_correlation (GstAudioLatency * self)
+{
+  const guint len = GST_AUDIOLATENCY_PROBE_LENGTH;
+  GRand *rand;
+  guint ii;
+
+  if (self->probe)
+    return;
+
+  /* a fixed pseudo-random +-1 sequence, whose circular autocorrelation has a
+   * single peak */
+  self->probe = g_new (gfloat, len);
+  rand = g_rand_new_with_seed (0x6c6174);
+  for (ii = 0; ii < len; ii++)
+    self->probe[ii] = g_rand_boolean (rand) ? 1.0 : -1.0;
+  g_rand_free (rand);
+
+  self->fft = gst_fft_f32_new (len, FALSE);
+  self->ifft = gst_fft_f32_new (len, TRUE);
+  self->probe_freq = g_new (GstFFTF32Complex, len / 2 + 1);
+  self->rx_freq = g_new (GstFFTF32Complex, len / 2 + 1);
+  self->rx = g_new0 (gfloat, len);
+  self->corr = g_new0 (gfloat, len);
+
+  gst_fft_f32_fft (self->fft, self->probe, self->probe_freq);
+}
+
+static void
+gst_audiolatency_finalize (GObject * object)
+{
+  GstAudioLatency *self = GST_AUDIOLATENCY (object);
+
+  g_free (self->probe);
+  if (self->fft)
+    gst_fft_f32_free (self->fft);
+  if (self->ifft)
+    gst_fft_f32_free (self->ifft);
+  g_free (self->probe_freq);
+  g_free (self->rx_freq);
+  g_free (self->rx);
+  g_free (self->corr);
+  g_array_unref (self->send_times);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
 
 static void
 gst_audiolatency_get_property (GObject * object,
@@ -125,6 +221,20 @@ gst_audiolatency_get_property (GObject * object,
     case PROP_SAMPLES_PER_BUFFER:
       g_value_set_int (value, self->samples_per_buffer);
       break;
+    case PROP_MODE:
+      g_value_set_enum (value, self->mode);
+      break;
+    case PROP_PROBE_AMPLITUDE:
+      g_value_set_float (value, self->probe_amplitude);
+      break;
+    case PROP_MIN_CONFIDENCE:
+      g_value_set_double (value, self->min_confidence);
+      break;
+    case PROP_CONFIDENCE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_double (value, self->confidence);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -146,6 +256,20 @@ gst_audiolatency_set_property (GObject * object,
       g_object_set (self->audiosrc,
           "samplesperbuffer", self->samples_per_buffer, NULL);
       break;
+    case PROP_MODE:
+      self->mode = g_value_get_enum (value);
+      /* the probe is added to silence in correlation mode */
+      g_object_set (self->audiosrc, "wave",
+          self->mode == GST_AUDIOLATENCY_MODE_CORRELATION ? 4 : 8, NULL);
+      if (self->mode == GST_AUDIOLATENCY_MODE_CORRELATION)
+        gst_audiolatency_setup_correlation (self);
+      break;
+    case PROP_PROBE_AMPLITUDE:
+      self->probe_amplitude = g_value_get_float (value);
+      break;
+    case PROP_MIN_CONFIDENCE:
+      self->min_confidence = g_value_get_double (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -160,6 +284,7 @@ gst_audiolatency_class_init (GstAudioLatencyClass * klass)
 
   gobject_class->get_property = gst_audiolatency_get_property;
   gobject_class->set_property = gst_audiolatency_set_property;
+  gobject_class->finalize = gst_audiolatency_finalize;
 
   g_object_class_install_property (gobject_class, PROP_PRINT_LATENCY,
       g_param_spec_boolean ("print-latency", "Print latencies",
@@ -169,12 +294,12 @@ gst_audiolatency_class_init (GstAudioLatencyClass * klass)
   g_object_class_install_property (gobject_class, PROP_LAST_LATENCY,
       g_param_spec_int64 ("last-latency", "Last measured latency",
           "The last latency that was measured, in microseconds", 0,
-          G_USEC_PER_SEC, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+          G_MAXINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   g_object_class_install_property (gobject_class, PROP_AVERAGE_LATENCY,
       g_param_spec_int64 ("average-latency", "Running average latency",
           "The running average latency, in microseconds", 0,
-          G_USEC_PER_SEC, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+          G_MAXINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   /**
    * GstAudioLatency:samplesperbuffer:
@@ -190,6 +315,58 @@ gst_audiolatency_class_init (GstAudioLatencyClass * klass)
           1, G_MAXINT, DEFAULT_SAMPLES_PER_BUFFER,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAudioLatency:mode:
+   *
+   * How the latency is measured.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode", "How the latency is measured",
+          GST_TYPE_AUDIOLATENCY_MODE, DEFAULT_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstAudioLatency:probe-amplitude:
+   *
+   * Amplitude of the probe sequence in correlation mode. The default is
+   * -60dBFS.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_PROBE_AMPLITUDE,
+      g_param_spec_float ("probe-amplitude", "Probe amplitude",
+          "Amplitude of the probe sequence in correlation mode",
+          0.0, 1.0, DEFAULT_PROBE_AMPLITUDE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioLatency:min-confidence:
+   *
+   * Correlation mode measurements with a lower confidence are discarded.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_MIN_CONFIDENCE,
+      g_param_spec_double ("min-confidence", "Minimum confidence",
+          "Minimum confidence of a correlation mode measurement",
+          0.0, 1.0, DEFAULT_MIN_CONFIDENCE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioLatency:confidence:
+   *
+   * Confidence of the last correlation mode measurement, between 0 and 1.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_CONFIDENCE,
+      g_param_spec_double ("confidence", "Confidence",
+          "Confidence of the last correlation mode measurement",
+          0.0, 1.0, 0.0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_template);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_template);
 
@@ -197,6 +374,11 @@ gst_audiolatency_class_init (GstAudioLatencyClass * klass)
       "Audio/Util",
       "Measures the audio latency between the source and the sink",
       "Nirbheek Chauhan <nirbheek@centricular.com>");
+
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_audiolatency_change_state);
+
+  gst_type_mark_as_plugin_api (GST_TYPE_AUDIOLATENCY_MODE, 0);
 }
 
 static void
@@ -209,6 +391,11 @@ gst_audiolatency_init (GstAudioLatency * self)
   self->recv_pts = 0;
   self->print_latency = DEFAULT_PRINT_LATENCY;
   self->samples_per_buffer = DEFAULT_SAMPLES_PER_BUFFER;
+  self->mode = DEFAULT_MODE;
+  self->probe_amplitude = DEFAULT_PROBE_AMPLITUDE;
+  self->min_confidence = DEFAULT_MIN_CONFIDENCE;
+  self->send_times = g_array_new (FALSE, FALSE,
+      sizeof (GstAudioLatencyAnchor));
 
   /* Setup sinkpad */
   self->sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
@@ -284,7 +471,8 @@ gst_audiolatency_get_average_latency (GstAudioLatency * self)
 }
 
 static void
-gst_audiolatency_set_latency (GstAudioLatency * self, gint64 latency)
+gst_audiolatency_set_latency (GstAudioLatency * self, gint64 latency,
+    gdouble confidence)
 {
   gint64 avg_latency;
 
@@ -307,7 +495,8 @@ gst_audiolatency_set_latency (GstAudioLatency * self, gint64 latency)
   gst_element_post_message (GST_ELEMENT (self),
       gst_message_new_element (GST_OBJECT (self),
           gst_structure_new ("latency", "last-latency", G_TYPE_INT64, latency,
-              "average-latency", G_TYPE_INT64, avg_latency, NULL)));
+              "average-latency", G_TYPE_INT64, avg_latency,
+              "confidence", G_TYPE_DOUBLE, confidence, NULL)));
 }
 
 static gint64
@@ -382,6 +571,231 @@ buffer_has_wave (GstBuffer * buffer, GstPad * pad)
   return (offset > 0) ? offset / 1000 : -1;
 }
 
+static void
+get_rate_channels (GstPad * pad, gint * rate, gint * channels)
+{
+  const GstStructure *s;
+  GstCaps *caps;
+
+  *rate = *channels = 0;
+  caps = gst_pad_get_current_caps (pad);
+  if (!caps)
+    return;
+
+  s = gst_caps_get_structure (caps, 0);
+  gst_structure_get_int (s, "channels", channels);
+  gst_structure_get_int (s, "rate", rate);
+  gst_caps_unref (caps);
+}
+
+/* Adds the low-amplitude probe sequence to the outgoing audio and remembers
+ * when each sample of it was sent */
+static void
+gst_audiolatency_embed_probe (GstAudioLatency * self, GstPad * pad,
+    GstPadProbeInfo * info)
+{
+  GstAudioLatencyAnchor anchor;
+  GstBuffer *buffer;
+  GstMapInfo minfo;
+  gint rate, channels;
+  gfloat *fdata;
+  guint64 start;
+  gsize ii, frames;
+  gint c;
+
+  get_rate_channels (pad, &rate, &channels);
+  if (rate <= 0 || channels <= 0)
+    return;
+
+  buffer = gst_buffer_make_writable (gst_pad_probe_info_get_buffer (info));
+  GST_PAD_PROBE_INFO_DATA (info) = buffer;
+
+  if (!gst_buffer_map (buffer, &minfo, GST_MAP_READWRITE)) {
+    GST_WARNING_OBJECT (pad, "failed to map buffer %" GST_PTR_FORMAT, buffer);
+    return;
+  }
+
+  fdata = (gfloat *) minfo.data;
+  frames = minfo.size / (sizeof (gfloat) * channels);
+
+  anchor.time = g_get_monotonic_time ();
+
+  GST_OBJECT_LOCK (self);
+  start = anchor.sample = self->sent_samples;
+  g_array_append_val (self->send_times, anchor);
+  /* keep two periods of anchors, enough to time any received period */
+  while (self->send_times->len > 1 &&
+      g_array_index (self->send_times, GstAudioLatencyAnchor, 1).sample +
+      2 * GST_AUDIOLATENCY_PROBE_LENGTH < start)
+    g_array_remove_index (self->send_times, 0);
+  self->sent_samples += frames;
+  GST_OBJECT_UNLOCK (self);
+
+  for (ii = 0; ii < frames; ii++) {
+    gfloat v = self->probe_amplitude *
+        self->probe[(start + ii) % GST_AUDIOLATENCY_PROBE_LENGTH];
+
+    for (c = 0; c < channels; c++)
+      fdata[ii * channels + c] += v;
+  }
+
+  gst_buffer_unmap (buffer, &minfo);
+}
+
+/* Starts the probe sequence and the received period over. The received
+ * period is restarted by the streaming thread on its next buffer */
+static void
+gst_audiolatency_reset_correlation (GstAudioLatency * self)
+{
+  GST_OBJECT_LOCK (self);
+  self->sent_samples = 0;
+  g_array_set_size (self->send_times, 0);
+  GST_OBJECT_UNLOCK (self);
+
+  g_atomic_int_set (&self->rx_reset, 1);
+}
+
+/* Finds where a received period of audio is in the probe sequence with a
+ * circular cross-correlation, and derives the latency from when that part of
+ * the sequence was sent */
+static void
+gst_audiolatency_correlate (GstAudioLatency * self, gint rate)
+{
+  const guint len = GST_AUDIOLATENCY_PROBE_LENGTH;
+  GstAudioLatencyAnchor *anchor = NULL;
+  gfloat peak = 0, sidelobe = 0;
+  gint64 latency, period, send_time;
+  gdouble confidence;
+  guint64 sent, n;
+  guint ii, k = 0;
+  gint jj;
+
+  gst_fft_f32_fft (self->fft, self->rx, self->rx_freq);
+
+  /* conj (RX) * PROBE */
+  for (ii = 0; ii < len / 2 + 1; ii++) {
+    GstFFTF32Complex r = self->rx_freq[ii];
+    GstFFTF32Complex p = self->probe_freq[ii];
+
+    self->rx_freq[ii].r = r.r * p.r + r.i * p.i;
+    self->rx_freq[ii].i = r.r * p.i - r.i * p.r;
+  }
+
+  gst_fft_f32_inverse_fft (self->ifft, self->rx_freq, self->corr);
+
+  /* the loopback may invert the polarity */
+  for (ii = 0; ii < len; ii++) {
+    if (ABS (self->corr[ii]) > peak) {
+      peak = ABS (self->corr[ii]);
+      k = ii;
+    }
+  }
+
+  /* the highest correlation away from the main lobe */
+  for (ii = 0; ii < len; ii++) {
+    guint dist = ABS ((gint) ii - (gint) k);
+
+    dist = MIN (dist, len - dist);
+    if (dist > 2 && ABS (self->corr[ii]) > sidelobe)
+      sidelobe = ABS (self->corr[ii]);
+  }
+
+  confidence = peak > 0 ? 1.0 - MIN (sidelobe / peak, 1.0) : 0.0;
+
+  GST_OBJECT_LOCK (self);
+  self->confidence = confidence;
+
+  if (confidence < self->min_confidence) {
+    GST_OBJECT_UNLOCK (self);
+    GST_DEBUG_OBJECT (self, "probe not found, confidence %f", confidence);
+    return;
+  }
+
+  /* the last sample sent at that point of the sequence */
+  sent = self->sent_samples;
+  if (sent <= k) {
+    GST_OBJECT_UNLOCK (self);
+    return;
+  }
+  n = sent - 1 - ((sent - 1 - k) % len);
+
+  for (jj = self->send_times->len - 1; jj >= 0; jj--) {
+    anchor = &g_array_index (self->send_times, GstAudioLatencyAnchor, jj);
+    if (anchor->sample <= n)
+      break;
+  }
+  if (jj < 0) {
+    GST_OBJECT_UNLOCK (self);
+    return;
+  }
+
+  send_time = anchor->time +
+      gst_util_uint64_scale_int_round (n - anchor->sample, G_USEC_PER_SEC,
+      rate);
+  GST_OBJECT_UNLOCK (self);
+
+  /* latencies are only known modulo the period of the sequence */
+  period = gst_util_uint64_scale_int_round (len, G_USEC_PER_SEC, rate);
+  latency = (self->rx_time - send_time) % period;
+  if (latency < 0)
+    latency += period;
+
+  GST_INFO_OBJECT (self, "probe at offset %u, latency: %" G_GINT64_FORMAT
+      "ms, confidence %f", k, latency / 1000, confidence);
+
+  gst_audiolatency_set_latency (self, latency, confidence);
+}
+
+static void
+gst_audiolatency_receive_probe (GstAudioLatency * self, GstPad * pad,
+    GstBuffer * buffer)
+{
+  GstMapInfo minfo;
+  gint rate, channels, c;
+  const gfloat *fdata;
+  gsize ii, frames;
+  gint64 now;
+
+  get_rate_channels (pad, &rate, &channels);
+  if (rate <= 0 || channels <= 0)
+    return;
+
+  if (!gst_buffer_map (buffer, &minfo, GST_MAP_READ)) {
+    GST_WARNING_OBJECT (pad, "failed to map buffer %" GST_PTR_FORMAT, buffer);
+    return;
+  }
+
+  /* after a flush or a pause, the samples received so far are not part of
+   * the sequence that is sent now */
+  if (g_atomic_int_compare_and_exchange (&self->rx_reset, 1, 0)) {
+    self->rx_fill = 0;
+    self->rx_time = 0;
+  }
+
+  now = g_get_monotonic_time ();
+  fdata = (const gfloat *) minfo.data;
+  frames = minfo.size / (sizeof (gfloat) * channels);
+
+  for (ii = 0; ii < frames; ii++) {
+    gfloat sum = 0;
+
+    if (self->rx_fill == 0)
+      self->rx_time = now + gst_util_uint64_scale_int_round (ii,
+          G_USEC_PER_SEC, rate);
+
+    for (c = 0; c < channels; c++)
+      sum += fdata[ii * channels + c];
+    self->rx[self->rx_fill++] = sum / channels;
+
+    if (self->rx_fill == GST_AUDIOLATENCY_PROBE_LENGTH) {
+      gst_audiolatency_correlate (self, rate);
+      self->rx_fill = 0;
+    }
+  }
+
+  gst_buffer_unmap (buffer, &minfo);
+}
+
 static GstPadProbeReturn
 gst_audiolatency_src_probe (GstPad * pad, GstPadProbeInfo * info,
     gpointer user_data)
@@ -398,6 +812,11 @@ gst_audiolatency_src_probe (GstPad * pad, GstPadProbeInfo * info,
 
   GST_TRACE ("audiotestsrc pushed out a buffer");
 
+  if (self->mode == GST_AUDIOLATENCY_MODE_CORRELATION) {
+    gst_audiolatency_embed_probe (self, pad, info);
+    goto out;
+  }
+
   pts = g_get_monotonic_time ();
   /* Ticks are once a second, so once we send something, we can skip
    * checking ~1sec of buffers till the next one. */
@@ -432,6 +851,11 @@ gst_audiolatency_sink_chain (GstPad * pad, GstObject * parent,
   GstAudioLatency *self = GST_AUDIOLATENCY (parent);
   gint64 latency, offset, pts;
 
+  if (self->mode == GST_AUDIOLATENCY_MODE_CORRELATION) {
+    gst_audiolatency_receive_probe (self, pad, buffer);
+    goto out;
+  }
+
   /* Ignore buffers till something gets sent out by us. Fixes a bug where we'd
    * start out by printing one garbage latency value on Windows. */
   if (self->send_pts == 0)
@@ -452,7 +876,7 @@ gst_audiolatency_sink_chain (GstPad * pad, GstObject * parent,
 
   self->recv_pts = pts + offset;
   latency = (self->recv_pts - self->send_pts);
-  gst_audiolatency_set_latency (self, latency);
+  gst_audiolatency_set_latency (self, latency, 1.0);
 
   GST_INFO ("recv pts: %" G_GINT64_FORMAT "us, latency: %" G_GINT64_FORMAT
       "ms, offset: %" G_GINT64_FORMAT "ms", self->recv_pts, latency / 1000,
@@ -473,6 +897,9 @@ gst_audiolatency_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
     case GST_EVENT_SEGMENT:
       gst_event_unref (event);
       return TRUE;
+    case GST_EVENT_FLUSH_STOP:
+      gst_audiolatency_reset_correlation (GST_AUDIOLATENCY (parent));
+      break;
     default:
       break;
   }
@@ -480,6 +907,24 @@ gst_audiolatency_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
   return gst_pad_event_default (pad, parent, event);
 }
 
+static GstStateChangeReturn
+gst_audiolatency_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstAudioLatency *self = GST_AUDIOLATENCY (element);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
+      /* the probe is not sent while paused */
+      gst_audiolatency_reset_correlation (self);
+      break;
+    default:
+      break;
+  }
+
+  return GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+}
+
 /* Element registration */
 static gboolean
 plugin_init (GstPlugin * plugin)
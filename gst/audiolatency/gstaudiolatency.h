@@ -22,6 +22,7 @@
 #define __GST_AUDIOLATENCY_H__
 
 #include <gst/gst.h>
+#include <gst/fft/gstfftf32.h>
 
 G_BEGIN_DECLS
 #define GST_TYPE_AUDIOLATENCY \
@@ -39,6 +40,22 @@ typedef struct _GstAudioLatencyClass GstAudioLatencyClass;
 
 #define GST_AUDIOLATENCY_NUM_LATENCIES 5
 
+/* Length in samples of the correlation probe sequence, which bounds the
+ * latency that can be measured in correlation mode */
+#define GST_AUDIOLATENCY_PROBE_LENGTH 32768
+
+typedef enum
+{
+  GST_AUDIOLATENCY_MODE_TICKS,
+  GST_AUDIOLATENCY_MODE_CORRELATION,
+} GstAudioLatencyMode;
+
+typedef struct
+{
+  guint64 sample;
+  gint64 time;
+} GstAudioLatencyAnchor;
+
 struct _GstAudioLatency
 {
   GstBin parent;
@@ -54,9 +71,28 @@ struct _GstAudioLatency
   gint next_latency_idx;
   gint latencies[GST_AUDIOLATENCY_NUM_LATENCIES];
 
+  /* correlation mode */
+  gfloat *probe;
+  GstFFTF32 *fft;
+  GstFFTF32 *ifft;
+  GstFFTF32Complex *probe_freq;
+  GstFFTF32Complex *rx_freq;
+  gfloat *rx;
+  gfloat *corr;
+  guint rx_fill;
+  gint64 rx_time;
+  gint rx_reset;                /* ATOMIC */
+  /* protected by object lock */
+  guint64 sent_samples;
+  GArray *send_times;
+  gdouble confidence;
+
   /* properties */
   gboolean print_latency;
   gint samples_per_buffer;
+  GstAudioLatencyMode mode;
+  gfloat probe_amplitude;
+  gdouble min_confidence;
 };
 
 struct _GstAudioLatencyClass
@@ -33,6 +33,13 @@
  * are automatically negotiated and the transformation matrix is a truncated
  * identity matrix.
  *
+ * Both interleaved and non-interleaved layouts are supported. Output channels
+ * whose matrix row selects a single input with a coefficient of 1 are plain
+ * copies of that input and rows without any non-zero coefficient produce
+ * silence, so routing and permutation matrices cost no multiplications. The
+ * remaining outputs are mixed from their non-zero inputs only and can be
+ * spread over several threads with the n-threads property.
+ *
  * ## Example matrix generation code
  * To generate the matrix using code:
  *
@@ -84,9 +91,19 @@ enum
   PROP_OUT_CHANNELS,
   PROP_MATRIX,
   PROP_CHANNEL_MASK,
-  PROP_MODE
+  PROP_MODE,
+  PROP_N_THREADS
 };
 
+#define DEFAULT_N_THREADS 1
+
+/* routes[] values besides the input channel to copy */
+#define ROUTE_SILENCE -1
+#define ROUTE_MIX -2
+
+/* samples per channel accumulated at once */
+#define MIX_BLOCK_SIZE 256
+
 GType
 gst_audio_mix_matrix_mode_get_type (void)
 {
@@ -115,7 +132,7 @@ GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS
-    ("audio/x-raw, channels = [1, max], layout = (string) interleaved, format = (string) {"
+    ("audio/x-raw, channels = [1, max], layout = (string) { interleaved, non-interleaved }, format = (string) {"
         GST_AUDIO_NE (F32) "," GST_AUDIO_NE (F64) "," GST_AUDIO_NE (S16) ","
         GST_AUDIO_NE (S32) "}")
     );
@@ -125,7 +142,7 @@ GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS
-    ("audio/x-raw, channels = [1, max], layout = (string) interleaved, format = (string) {"
+    ("audio/x-raw, channels = [1, max], layout = (string) { interleaved, non-interleaved }, format = (string) {"
         GST_AUDIO_NE (F32) "," GST_AUDIO_NE (F64) "," GST_AUDIO_NE (S16) ","
         GST_AUDIO_NE (S32) "}")
     );
@@ -201,6 +218,20 @@ gst_audio_mix_matrix_class_init (GstAudioMixMatrixClass * klass)
           GST_TYPE_AUDIO_MIX_MATRIX_MODE,
           GST_AUDIO_MIX_MATRIX_MODE_MANUAL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstAudioMixMatrix:n-threads:
+   *
+   * Output channels are mixed independently of each other, in ranges spread
+   * over up to this many threads, 0 meaning one per processor. The output
+   * is the same for any value.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads to use (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&gst_audio_mix_matrix_sink_template));
@@ -229,9 +260,68 @@ gst_audio_mix_matrix_init (GstAudioMixMatrix * self)
   self->out_channels = 0;
   self->matrix = NULL;
   self->channel_mask = 0;
-  self->s16_conv_matrix = NULL;
-  self->s32_conv_matrix = NULL;
   self->mode = GST_AUDIO_MIX_MATRIX_MODE_MANUAL;
+  self->n_threads = DEFAULT_N_THREADS;
+  gst_audio_info_init (&self->in_info);
+  gst_audio_info_init (&self->out_info);
+}
+
+/* The matrix compiled for the negotiated caps. A plan is never modified
+ * once built: the transform function takes a reference under the object
+ * lock and mixes without holding it, while a new matrix replaces the plan
+ * as a whole */
+struct _GstAudioMixMatrixPlan
+{
+  gint ref_count;
+
+  GstAudioFormat format;
+  guint in_channels;
+  guint out_channels;
+
+  /* per output channel: the input channel to copy, ROUTE_SILENCE or
+   * ROUTE_MIX from the n_inputs[] non-zero inputs listed in inputs[] */
+  gint *routes;
+  guint *n_inputs;
+  guint *inputs;
+
+  /* coefficients in the arithmetic of the format */
+  gdouble *matrix;
+  gint32 *s16_matrix;
+  gint64 *s32_matrix;
+  gint shift_bytes;
+};
+
+static GstAudioMixMatrixPlan *
+gst_audio_mix_matrix_plan_ref (GstAudioMixMatrixPlan * plan)
+{
+  g_atomic_int_inc (&plan->ref_count);
+
+  return plan;
+}
+
+static void
+gst_audio_mix_matrix_plan_unref (GstAudioMixMatrixPlan * plan)
+{
+  if (!g_atomic_int_dec_and_test (&plan->ref_count))
+    return;
+
+  g_free (plan->routes);
+  g_free (plan->n_inputs);
+  g_free (plan->inputs);
+  g_free (plan->matrix);
+  g_free (plan->s16_matrix);
+  g_free (plan->s32_matrix);
+  g_free (plan);
+}
+
+/* Must be called with the object lock held */
+static void
+gst_audio_mix_matrix_set_plan (GstAudioMixMatrix * self,
+    GstAudioMixMatrixPlan * plan)
+{
+  if (self->plan)
+    gst_audio_mix_matrix_plan_unref (self->plan);
+  self->plan = plan;
 }
 
 static void
@@ -244,46 +334,93 @@ gst_audio_mix_matrix_dispose (GObject * object)
     self->matrix = NULL;
   }
 
+  gst_audio_mix_matrix_set_plan (self, NULL);
+  gst_slice_runner_clear (&self->slices);
+
   G_OBJECT_CLASS (gst_audio_mix_matrix_parent_class)->dispose (object);
 }
 
+/* Compiles the matrix for the negotiated caps and replaces the current
+ * plan. Every output channel is classified: a single input with coefficient
+ * 1 is copied, an all-zero row is silence and everything else is mixed from
+ * the list of its non-zero inputs. Must be called with the object lock
+ * held */
 static void
-gst_audio_mix_matrix_convert_s16_matrix (GstAudioMixMatrix * self)
+gst_audio_mix_matrix_compile (GstAudioMixMatrix * self)
 {
-  gint i;
+  GstAudioMixMatrixPlan *plan;
+  guint in_channels = GST_AUDIO_INFO_CHANNELS (&self->in_info);
+  guint out_channels = GST_AUDIO_INFO_CHANNELS (&self->out_info);
+  guint n_coefficients = in_channels * out_channels;
+  guint i, in, out, n_copies = 0, n_silent = 0, n_mixed = 0, n_non_zero = 0;
+
+  plan = g_new0 (GstAudioMixMatrixPlan, 1);
+  plan->ref_count = 1;
+  plan->format = GST_AUDIO_INFO_FORMAT (&self->in_info);
+  plan->in_channels = in_channels;
+  plan->out_channels = out_channels;
+  plan->routes = g_new (gint, out_channels);
+  plan->n_inputs = g_new (guint, out_channels);
+  plan->inputs = g_new (guint, n_coefficients);
+
+  switch (plan->format) {
+    case GST_AUDIO_FORMAT_S16LE:
+    case GST_AUDIO_FORMAT_S16BE:
+      /* converted bits - input bits - sign - bits needed for channel */
+      plan->shift_bytes = 32 - 16 - 1 - ceil (log (in_channels) / log (2));
+      plan->s16_matrix = g_new (gint32, n_coefficients);
+      for (i = 0; i < n_coefficients; i++) {
+        plan->s16_matrix[i] =
+            (gint32) ((self->matrix[i]) * (1 << plan->shift_bytes));
+      }
+      break;
+    case GST_AUDIO_FORMAT_S32LE:
+    case GST_AUDIO_FORMAT_S32BE:
+      /* converted bits - input bits - sign - bits needed for channel */
+      plan->shift_bytes = 64 - 32 - 1 - (gint) (log (in_channels) / log (2));
+      plan->s32_matrix = g_new (gint64, n_coefficients);
+      for (i = 0; i < n_coefficients; i++) {
+        plan->s32_matrix[i] =
+            (gint64) ((self->matrix[i]) * (1 << plan->shift_bytes));
+      }
+      break;
+    default:
+      plan->matrix = g_memdup2 (self->matrix, n_coefficients *
+          sizeof (gdouble));
+      break;
+  }
 
-  /* converted bits - input bits - sign - bits needed for channel */
-  self->shift_bytes = 32 - 16 - 1 - ceil (log (self->in_channels) / log (2));
+  for (out = 0; out < out_channels; out++) {
+    const gdouble *row = self->matrix + out * in_channels;
+    guint *inputs = plan->inputs + out * in_channels;
+    guint n = 0;
 
-  if (self->s16_conv_matrix)
-    g_free (self->s16_conv_matrix);
-  self->s16_conv_matrix =
-      g_new (gint32, self->in_channels * self->out_channels);
-  for (i = 0; i < self->in_channels * self->out_channels; i++) {
-    self->s16_conv_matrix[i] =
-        (gint32) ((self->matrix[i]) * (1 << self->shift_bytes));
+    for (in = 0; in < in_channels; in++) {
+      if (row[in] != 0.0)
+        inputs[n++] = in;
+    }
+    plan->n_inputs[out] = n;
+    n_non_zero += n;
+
+    if (n == 0) {
+      plan->routes[out] = ROUTE_SILENCE;
+      n_silent++;
+    } else if (n == 1 && row[inputs[0]] == 1.0) {
+      plan->routes[out] = inputs[0];
+      n_copies++;
+    } else {
+      plan->routes[out] = ROUTE_MIX;
+      n_mixed++;
+    }
   }
-}
-
-static void
-gst_audio_mix_matrix_convert_s32_matrix (GstAudioMixMatrix * self)
-{
-  gint i;
 
-  /* converted bits - input bits - sign - bits needed for channel */
-  self->shift_bytes = 64 - 32 - 1 - (gint) (log (self->in_channels) / log (2));
+  GST_DEBUG_OBJECT (self, "%u copied, %u silent and %u mixed output channels, "
+      "%u of %u coefficients non-zero", n_copies, n_silent, n_mixed,
+      n_non_zero, n_coefficients);
 
-  if (self->s32_conv_matrix)
-    g_free (self->s32_conv_matrix);
-  self->s32_conv_matrix =
-      g_new (gint64, self->in_channels * self->out_channels);
-  for (i = 0; i < self->in_channels * self->out_channels; i++) {
-    self->s32_conv_matrix[i] =
-        (gint64) ((self->matrix[i]) * (1 << self->shift_bytes));
-  }
+  gst_audio_mix_matrix_set_plan (self, plan);
 }
 
-
 static void
 gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -293,41 +430,49 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
   switch (prop_id) {
     case PROP_IN_CHANNELS:
       self->in_channels = g_value_get_uint (value);
-      if (self->matrix) {
-        gst_audio_mix_matrix_convert_s16_matrix (self);
-        gst_audio_mix_matrix_convert_s32_matrix (self);
-      }
       break;
     case PROP_OUT_CHANNELS:
       self->out_channels = g_value_get_uint (value);
-      if (self->matrix) {
-        gst_audio_mix_matrix_convert_s16_matrix (self);
-        gst_audio_mix_matrix_convert_s32_matrix (self);
-      }
       break;
     case PROP_MATRIX:{
+      gdouble *matrix, *old_matrix;
       gint in, out;
 
-      if (self->matrix)
-        g_free (self->matrix);
-      self->matrix = g_new (gdouble, self->in_channels * self->out_channels);
-
       g_return_if_fail (gst_value_array_get_size (value) == self->out_channels);
       for (out = 0; out < self->out_channels; out++) {
         const GValue *row = gst_value_array_get_value (value, out);
         g_return_if_fail (gst_value_array_get_size (row) == self->in_channels);
+        for (in = 0; in < self->in_channels; in++) {
+          g_return_if_fail (G_VALUE_HOLDS_DOUBLE (gst_value_array_get_value
+                  (row, in)));
+        }
+      }
+
+      matrix = g_new (gdouble, self->in_channels * self->out_channels);
+      for (out = 0; out < self->out_channels; out++) {
+        const GValue *row = gst_value_array_get_value (value, out);
         for (in = 0; in < self->in_channels; in++) {
           const GValue *itm;
           gdouble coefficient;
 
           itm = gst_value_array_get_value (row, in);
-          g_return_if_fail (G_VALUE_HOLDS_DOUBLE (itm));
           coefficient = g_value_get_double (itm);
-          self->matrix[out * self->in_channels + in] = coefficient;
+          matrix[out * self->in_channels + in] = coefficient;
         }
       }
-      gst_audio_mix_matrix_convert_s16_matrix (self);
-      gst_audio_mix_matrix_convert_s32_matrix (self);
+
+      /* the matrix may be replaced while streaming, swap it under the lock
+       * the transform function holds */
+      GST_OBJECT_LOCK (self);
+      old_matrix = self->matrix;
+      self->matrix = matrix;
+      if (GST_AUDIO_INFO_IS_VALID (&self->in_info) &&
+          GST_AUDIO_INFO_CHANNELS (&self->in_info) == self->in_channels &&
+          GST_AUDIO_INFO_CHANNELS (&self->out_info) == self->out_channels)
+        gst_audio_mix_matrix_compile (self);
+      GST_OBJECT_UNLOCK (self);
+
+      g_free (old_matrix);
       break;
     }
     case PROP_CHANNEL_MASK:
@@ -336,6 +481,11 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
     case PROP_MODE:
       self->mode = g_value_get_enum (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      self->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -382,6 +532,11 @@ gst_audio_mix_matrix_get_property (GObject * object, guint prop_id,
     case PROP_MODE:
       g_value_set_enum (value, self->mode);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->n_threads);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -399,140 +554,295 @@ gst_audio_mix_matrix_change_state (GstElement * element,
       (element, transition);
 
   if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
-    if (self->s16_conv_matrix) {
-      g_free (self->s16_conv_matrix);
-      self->s16_conv_matrix = NULL;
-    }
+    GST_OBJECT_LOCK (self);
+    gst_audio_mix_matrix_set_plan (self, NULL);
+    gst_audio_info_init (&self->in_info);
+    gst_audio_info_init (&self->out_info);
+    GST_OBJECT_UNLOCK (self);
+    gst_slice_runner_clear (&self->slices);
+  }
+
+  return s;
+}
+
+
+/* Output channels are independent of each other, so they are split into
+ * ranges which are mixed on the slice runner. Called from the streaming
+ * thread only, with the value of the n-threads property read under the
+ * object lock */
+static void
+gst_audio_mix_matrix_update_slices (GstAudioMixMatrix * self, guint n_threads)
+{
+  GError *err = NULL;
+
+  if (!gst_slice_runner_set_n_threads (&self->slices, n_threads, &err)) {
+    GST_WARNING_OBJECT (self, "Failed to create slice thread pool: %s",
+        err->message);
+    g_clear_error (&err);
+  }
+}
+
+/* Input and output channels are described by a pointer to their first
+ * sample and the distance between samples, which covers both interleaved
+ * (stride = number of channels) and non-interleaved (stride = 1) layouts */
+typedef struct
+{
+  const GstAudioMixMatrixPlan *plan;
+  const guint8 **in_planes;
+  guint8 **out_planes;
+  guint in_channels;
+  guint out_channels;
+  guint in_stride;
+  guint out_stride;
+  guint bps;
+  guint n_samples;
+} GstAudioMixMatrixMixJob;
+
+/* Mixes output channel @out from its non-zero inputs. Samples are accumulated
+ * a block at a time, one input after the other, which turns the inner loops
+ * into multiply-adds over contiguous arrays that the compiler vectorizes */
+#define DEFINE_MIX_FUNC(fmt, type, acc_type, coef_type, coefs, MUL, STORE) \
+static void \
+gst_audio_mix_matrix_mix_##fmt (const GstAudioMixMatrixMixJob * job, \
+    guint out) \
+{ \
+  const GstAudioMixMatrixPlan *plan = job->plan; \
+  const coef_type *row = plan->coefs + out * job->in_channels; \
+  const guint *inputs = plan->inputs + out * job->in_channels; \
+  guint n_inputs = plan->n_inputs[out]; \
+  guint in_stride = job->in_stride, out_stride = job->out_stride; \
+  type *dst = (type *) job->out_planes[out]; \
+  acc_type acc[MIX_BLOCK_SIZE]; \
+  guint s, n, i, k; \
+  \
+  for (s = 0; s < job->n_samples; s += n) { \
+    n = MIN (job->n_samples - s, MIX_BLOCK_SIZE); \
+    \
+    memset (acc, 0, n * sizeof (acc_type)); \
+    for (i = 0; i < n_inputs; i++) { \
+      const type *src = \
+          (const type *) job->in_planes[inputs[i]] + s * in_stride; \
+      coef_type coef = row[inputs[i]]; \
+      \
+      if (in_stride == 1) { \
+        for (k = 0; k < n; k++) \
+          acc[k] += MUL (src[k], coef); \
+      } else { \
+        for (k = 0; k < n; k++) \
+          acc[k] += MUL (src[k * in_stride], coef); \
+      } \
+    } \
+    \
+    if (out_stride == 1) { \
+      for (k = 0; k < n; k++) \
+        dst[s + k] = STORE (acc[k]); \
+    } else { \
+      for (k = 0; k < n; k++) \
+        dst[(s + k) * out_stride] = STORE (acc[k]); \
+    } \
+  } \
+}
+
+#define MUL_FLOAT(x, c) ((x) * (c))
+#define STORE_FLOAT(a) (a)
+#define MUL_S16(x, c) ((gint32) ((x) * (c)))
+#define STORE_S16(a) ((gint16) ((a) >> plan->shift_bytes))
+#define MUL_S32(x, c) ((gint64) ((x) * (c)))
+#define STORE_S32(a) ((gint32) ((a) >> plan->shift_bytes))
+
+/* F32 samples are multiplied by the double coefficients and every product
+ * is added to the float sum in double precision, as the unthreaded
+ * per-sample mixing did */
+DEFINE_MIX_FUNC (f32, gfloat, gfloat, gdouble, matrix, MUL_FLOAT, STORE_FLOAT)
+DEFINE_MIX_FUNC (f64, gdouble, gdouble, gdouble, matrix, MUL_FLOAT,
+    STORE_FLOAT)
+DEFINE_MIX_FUNC (s16, gint16, gint32, gint32, s16_matrix, MUL_S16, STORE_S16)
+DEFINE_MIX_FUNC (s32, gint32, gint64, gint64, s32_matrix, MUL_S32, STORE_S32)
+
+#define DEFINE_COPY_FUNC(bits, type) \
+static void \
+gst_audio_mix_matrix_copy_##bits (const type * src, guint in_stride, \
+    type * dst, guint out_stride, guint n_samples) \
+{ \
+  guint k; \
+  \
+  for (k = 0; k < n_samples; k++) \
+    dst[k * out_stride] = src[k * in_stride]; \
+}
+
+DEFINE_COPY_FUNC (16, guint16)
+DEFINE_COPY_FUNC (32, guint32)
+DEFINE_COPY_FUNC (64, guint64)
+
+/* Copies input channel @in to output channel @out, or fills it with silence
+ * if @in is ROUTE_SILENCE. A coefficient of 1 leaves samples of every
+ * supported format unchanged, so this is a plain copy of the sample bits */
+static void
+gst_audio_mix_matrix_copy (const GstAudioMixMatrixMixJob * job, gint in,
+    guint out)
+{
+  guint bps = job->bps;
+  guint8 *dst = job->out_planes[out];
+  guint k;
 
-    if (self->s32_conv_matrix) {
-      g_free (self->s32_conv_matrix);
-      self->s32_conv_matrix = NULL;
+  if (in == ROUTE_SILENCE) {
+    if (job->out_stride == 1) {
+      memset (dst, 0, job->n_samples * bps);
+    } else {
+      for (k = 0; k < job->n_samples; k++)
+        memset (dst + k * job->out_stride * bps, 0, bps);
     }
+    return;
   }
 
-  return s;
+  if (job->in_stride == 1 && job->out_stride == 1) {
+    memcpy (dst, job->in_planes[in], job->n_samples * bps);
+    return;
+  }
+
+  switch (bps) {
+    case 2:
+      gst_audio_mix_matrix_copy_16 ((const guint16 *) job->in_planes[in],
+          job->in_stride, (guint16 *) dst, job->out_stride, job->n_samples);
+      break;
+    case 4:
+      gst_audio_mix_matrix_copy_32 ((const guint32 *) job->in_planes[in],
+          job->in_stride, (guint32 *) dst, job->out_stride, job->n_samples);
+      break;
+    case 8:
+      gst_audio_mix_matrix_copy_64 ((const guint64 *) job->in_planes[in],
+          job->in_stride, (guint64 *) dst, job->out_stride, job->n_samples);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
 }
 
+static void
+gst_audio_mix_matrix_mix_slice (gpointer data, guint slice, guint n_slices)
+{
+  const GstAudioMixMatrixMixJob *job = data;
+  const GstAudioMixMatrixPlan *plan = job->plan;
+  guint start = GST_SLICE_START (job->out_channels, slice, n_slices);
+  guint end = GST_SLICE_END (job->out_channels, slice, n_slices);
+  guint out;
+
+  for (out = start; out < end; out++) {
+    if (plan->routes[out] != ROUTE_MIX) {
+      gst_audio_mix_matrix_copy (job, plan->routes[out], out);
+      continue;
+    }
+
+    switch (plan->format) {
+      case GST_AUDIO_FORMAT_F32LE:
+      case GST_AUDIO_FORMAT_F32BE:
+        gst_audio_mix_matrix_mix_f32 (job, out);
+        break;
+      case GST_AUDIO_FORMAT_F64LE:
+      case GST_AUDIO_FORMAT_F64BE:
+        gst_audio_mix_matrix_mix_f64 (job, out);
+        break;
+      case GST_AUDIO_FORMAT_S16LE:
+      case GST_AUDIO_FORMAT_S16BE:
+        gst_audio_mix_matrix_mix_s16 (job, out);
+        break;
+      case GST_AUDIO_FORMAT_S32LE:
+      case GST_AUDIO_FORMAT_S32BE:
+        gst_audio_mix_matrix_mix_s32 (job, out);
+        break;
+      default:
+        g_assert_not_reached ();
+        break;
+    }
+  }
+}
 
 static GstFlowReturn
 gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
     GstBuffer * inbuf, GstBuffer * outbuf)
 {
-  GstMapInfo inmap, outmap;
   GstAudioMixMatrix *self = GST_AUDIO_MIX_MATRIX (vfilter);
-  gint in, out, sample;
-  guint inchannels = self->in_channels;
-  guint outchannels = self->out_channels;
-  gdouble *matrix = self->matrix;
-
-  if (!gst_buffer_map (inbuf, &inmap, GST_MAP_READ)) {
-    return GST_FLOW_ERROR;
-  }
-  if (!gst_buffer_map (outbuf, &outmap, GST_MAP_WRITE)) {
-    gst_buffer_unmap (inbuf, &inmap);
-    return GST_FLOW_ERROR;
-  }
+  GstAudioBuffer inabuf, outabuf;
+  GstAudioMixMatrixPlan *plan;
+  GstAudioMixMatrixMixJob job;
+  gboolean in_planar, out_planar;
+  guint i, n_threads;
 
   switch (self->format) {
     case GST_AUDIO_FORMAT_F32LE:
-    case GST_AUDIO_FORMAT_F32BE:{
-      const gfloat *inarray;
-      gfloat *outarray;
-      guint n_samples = outmap.size / (sizeof (gfloat) * outchannels);
-
-      inarray = (gfloat *) inmap.data;
-      outarray = (gfloat *) outmap.data;
-
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gfloat outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval +=
-                inarray[sample * inchannels +
-                in] * matrix[out * inchannels + in];
-          }
-          outarray[sample * outchannels + out] = outval;
-        }
-      }
-      break;
-    }
+    case GST_AUDIO_FORMAT_F32BE:
     case GST_AUDIO_FORMAT_F64LE:
-    case GST_AUDIO_FORMAT_F64BE:{
-      const gdouble *inarray;
-      gdouble *outarray;
-      guint n_samples = outmap.size / (sizeof (gdouble) * outchannels);
-
-      inarray = (gdouble *) inmap.data;
-      outarray = (gdouble *) outmap.data;
-
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gdouble outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval +=
-                inarray[sample * inchannels +
-                in] * matrix[out * inchannels + in];
-          }
-          outarray[sample * outchannels + out] = outval;
-        }
-      }
-      break;
-    }
+    case GST_AUDIO_FORMAT_F64BE:
     case GST_AUDIO_FORMAT_S16LE:
-    case GST_AUDIO_FORMAT_S16BE:{
-      const gint16 *inarray;
-      gint16 *outarray;
-      guint n_samples = outmap.size / (sizeof (gint16) * outchannels);
-      guint n = self->shift_bytes;
-      gint32 *conv_matrix = self->s16_conv_matrix;
-
-      inarray = (gint16 *) inmap.data;
-      outarray = (gint16 *) outmap.data;
-
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gint32 outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval += (gint32) (inarray[sample * inchannels + in] *
-                conv_matrix[out * inchannels + in]);
-          }
-          outarray[sample * outchannels + out] = (gint16) (outval >> n);
-        }
-      }
-      break;
-    }
+    case GST_AUDIO_FORMAT_S16BE:
     case GST_AUDIO_FORMAT_S32LE:
-    case GST_AUDIO_FORMAT_S32BE:{
-      const gint32 *inarray;
-      gint32 *outarray;
-      guint n_samples = outmap.size / (sizeof (gint32) * outchannels);
-      guint n = self->shift_bytes;
-      gint64 *conv_matrix = self->s32_conv_matrix;
-
-      inarray = (gint32 *) inmap.data;
-      outarray = (gint32 *) outmap.data;
-
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gint64 outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval += (gint64) (inarray[sample * inchannels + in] *
-                conv_matrix[out * inchannels + in]);
-          }
-          outarray[sample * outchannels + out] = (gint32) (outval >> n);
-        }
-      }
+    case GST_AUDIO_FORMAT_S32BE:
       break;
-    }
     default:
-      gst_buffer_unmap (inbuf, &inmap);
-      gst_buffer_unmap (outbuf, &outmap);
       return GST_FLOW_NOT_SUPPORTED;
+  }
+
+  in_planar = GST_AUDIO_INFO_LAYOUT (&self->in_info) ==
+      GST_AUDIO_LAYOUT_NON_INTERLEAVED;
+  out_planar = GST_AUDIO_INFO_LAYOUT (&self->out_info) ==
+      GST_AUDIO_LAYOUT_NON_INTERLEAVED;
 
+  /* non-interleaved buffers are described by their audio meta */
+  if (out_planar && !gst_buffer_get_audio_meta (outbuf)) {
+    gst_buffer_add_audio_meta (outbuf, &self->out_info,
+        gst_buffer_get_size (outbuf) / GST_AUDIO_INFO_BPF (&self->out_info),
+        NULL);
   }
 
-  gst_buffer_unmap (inbuf, &inmap);
-  gst_buffer_unmap (outbuf, &outmap);
+  /* the matrix may be replaced while the buffer is mixed, which keeps
+   * using the plan it started with */
+  GST_OBJECT_LOCK (self);
+  plan = self->plan ? gst_audio_mix_matrix_plan_ref (self->plan) : NULL;
+  n_threads = self->n_threads;
+  GST_OBJECT_UNLOCK (self);
+
+  if (plan == NULL)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  gst_audio_mix_matrix_update_slices (self, n_threads);
+
+  if (!gst_audio_buffer_map (&inabuf, &self->in_info, inbuf, GST_MAP_READ)) {
+    gst_audio_mix_matrix_plan_unref (plan);
+    return GST_FLOW_ERROR;
+  }
+  if (!gst_audio_buffer_map (&outabuf, &self->out_info, outbuf,
+          GST_MAP_WRITE)) {
+    gst_audio_buffer_unmap (&inabuf);
+    gst_audio_mix_matrix_plan_unref (plan);
+    return GST_FLOW_ERROR;
+  }
+
+  job.plan = plan;
+  job.in_channels = plan->in_channels;
+  job.out_channels = plan->out_channels;
+  job.in_stride = in_planar ? 1 : job.in_channels;
+  job.out_stride = out_planar ? 1 : job.out_channels;
+  job.bps = GST_AUDIO_INFO_BPS (&self->in_info);
+  job.n_samples = MIN (inabuf.n_samples, outabuf.n_samples);
+
+  job.in_planes = g_newa (const guint8 *, job.in_channels);
+  for (i = 0; i < job.in_channels; i++) {
+    job.in_planes[i] = in_planar ? GST_AUDIO_BUFFER_PLANE_DATA (&inabuf, i) :
+        (guint8 *) GST_AUDIO_BUFFER_PLANE_DATA (&inabuf, 0) + i * job.bps;
+  }
+  job.out_planes = g_newa (guint8 *, job.out_channels);
+  for (i = 0; i < job.out_channels; i++) {
+    job.out_planes[i] = out_planar ? GST_AUDIO_BUFFER_PLANE_DATA (&outabuf, i) :
+        (guint8 *) GST_AUDIO_BUFFER_PLANE_DATA (&outabuf, 0) + i * job.bps;
+  }
+
+  gst_slice_runner_run (&self->slices, job.out_channels,
+      gst_audio_mix_matrix_mix_slice, &job);
+
+  gst_audio_buffer_unmap (&inabuf);
+  gst_audio_buffer_unmap (&outabuf);
+  gst_audio_mix_matrix_plan_unref (plan);
   return GST_FLOW_OK;
 }
 
@@ -556,6 +866,7 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
 {
   GstAudioMixMatrix *self = GST_AUDIO_MIX_MATRIX (trans);
   GstAudioInfo info, out_info;
+  guint n_threads;
 
   if (!gst_audio_info_from_caps (&info, incaps))
     return FALSE;
@@ -565,12 +876,14 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
 
   self->format = info.finfo->format;
 
+  GST_OBJECT_LOCK (self);
   if (self->mode == GST_AUDIO_MIX_MATRIX_MODE_FIRST_CHANNELS) {
     gint in, out;
 
     self->in_channels = info.channels;
     self->out_channels = out_info.channels;
 
+    g_free (self->matrix);
     self->matrix = g_new (gdouble, self->in_channels * self->out_channels);
 
     for (out = 0; out < self->out_channels; out++) {
@@ -580,26 +893,21 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     }
   } else if (!self->matrix || info.channels != self->in_channels ||
       out_info.channels != self->out_channels) {
+    GST_OBJECT_UNLOCK (self);
     GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS,
         ("Erroneous matrix detected"),
         ("Please enter a matrix with the correct input and output channels"));
     return FALSE;
   }
 
-  switch (self->format) {
-    case GST_AUDIO_FORMAT_S16LE:
-    case GST_AUDIO_FORMAT_S16BE:{
-      gst_audio_mix_matrix_convert_s16_matrix (self);
-      break;
-    }
-    case GST_AUDIO_FORMAT_S32LE:
-    case GST_AUDIO_FORMAT_S32BE:{
-      gst_audio_mix_matrix_convert_s32_matrix (self);
-      break;
-    }
-    default:
-      break;
-  }
+  self->in_info = info;
+  self->out_info = out_info;
+  gst_audio_mix_matrix_compile (self);
+  n_threads = self->n_threads;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_audio_mix_matrix_update_slices (self, n_threads);
+
   return TRUE;
 }
 
@@ -25,6 +25,7 @@
 
 #include <gst/gst.h>
 #include <gst/audio/audio.h>
+#include <gst/slice-runner-private.h>
 
 #define GST_TYPE_AUDIO_MIX_MATRIX            (gst_audio_mix_matrix_get_type())
 #define GST_AUDIO_MIX_MATRIX(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_AUDIO_MIX_MATRIX,GstAudioMixMatrix))
@@ -36,6 +37,7 @@
 
 typedef struct _GstAudioMixMatrix GstAudioMixMatrix;
 typedef struct _GstAudioMixMatrixClass GstAudioMixMatrixClass;
+typedef struct _GstAudioMixMatrixPlan GstAudioMixMatrixPlan;
 
 typedef enum _GstAudioMixMatrixMode
 {
@@ -58,11 +60,16 @@ struct _GstAudioMixMatrix
   gdouble *matrix;
   guint64 channel_mask;
   GstAudioMixMatrixMode mode;
-  gint32 *s16_conv_matrix;
-  gint64 *s32_conv_matrix;
-  gint shift_bytes;
 
   GstAudioFormat format;
+  GstAudioInfo in_info;
+  GstAudioInfo out_info;
+
+  /* matrix compiled for the negotiated caps, protected by the object lock */
+  GstAudioMixMatrixPlan *plan;
+
+  guint n_threads;
+  GstSliceRunner slices;
 };
 
 struct _GstAudioMixMatrixClass
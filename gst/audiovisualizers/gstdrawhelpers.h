@@ -21,6 +21,48 @@
  
 /* FIXME: add versions that don't ignore alpha */
  
+/* Adds the channels of _c to the ones of _p, saturating at 255. The four
+ * channels are added at once in one word, which also lets the compiler
+ * vectorize loops over whole rows */
+static inline guint32
+add_pixel_value (guint32 _p, guint32 _c)
+{
+  guint32 s = (_p & 0x7f7f7f7f) + (_c & 0x7f7f7f7f);
+  guint32 o = ((_p & _c) | ((_p ^ _c) & s)) & 0x80808080;
+
+  return (s ^ ((_p ^ _c) & 0x80808080)) | ((o >> 7) * 0xff);
+}
+
+static inline void
+add_pixel (guint32 * _p, guint32 _c)
+{
+  *_p = add_pixel_value (*_p, _c);
+}
+
+/* Whether the audio has to be analysed again for this frame, at most @rate
+ * times per second, or the previous result can be drawn again. @analysed
+ * tells if there is a previous result and @since_analysis accumulates the
+ * time since the last analysis */
+static inline gboolean
+analysis_due (GstAudioVisualizer * bscope, guint rate, gboolean analysed,
+    GstClockTime * since_analysis)
+{
+  gint fps_n = GST_VIDEO_INFO_FPS_N (&bscope->vinfo);
+  gint fps_d = GST_VIDEO_INFO_FPS_D (&bscope->vinfo);
+  GstClockTime period;
+
+  if (rate == 0 || fps_n <= 0 || !analysed)
+    return TRUE;
+
+  period = GST_SECOND / rate;
+  *since_analysis += gst_util_uint64_scale_int (GST_SECOND, fps_d, fps_n);
+  if (*since_analysis < period)
+    return FALSE;
+
+  *since_analysis %= period;
+  return TRUE;
+}
+
 #define draw_dot(_vd, _x, _y, _st, _c) G_STMT_START {                          \
   _vd[(_y * _st) + _x] = _c;                                                   \
 } G_STMT_END
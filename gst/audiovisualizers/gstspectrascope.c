@@ -27,6 +27,11 @@
  * Spectrascope is a simple spectrum visualisation element. It renders the
  * frequency spectrum as a series of bars.
  *
+ * The spectrum is computed for every video frame by default. Setting
+ * #GstSpectraScope:analysis-rate computes it less often, and draws the
+ * previous spectrum again in between, which saves most of the processing
+ * when many scopes run at once.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 audiotestsrc ! audioconvert ! spectrascope ! ximagesink
@@ -37,8 +42,10 @@
 #include "config.h"
 #endif
 #include <stdlib.h>
+#include <math.h>
 
 #include "gstspectrascope.h"
+#include "gstdrawhelpers.h"
 
 #if G_BYTE_ORDER == G_BIG_ENDIAN
 #define RGB_ORDER "xRGB"
@@ -68,6 +75,18 @@ GST_STATIC_PAD_TEMPLATE ("sink",
 GST_DEBUG_CATEGORY_STATIC (spectra_scope_debug);
 #define GST_CAT_DEFAULT spectra_scope_debug
 
+enum
+{
+  PROP_0,
+  PROP_ANALYSIS_RATE
+};
+
+#define DEFAULT_ANALYSIS_RATE 0
+
+static void gst_spectra_scope_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_spectra_scope_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 static void gst_spectra_scope_finalize (GObject * object);
 
 static gboolean gst_spectra_scope_setup (GstAudioVisualizer * scope);
@@ -88,8 +107,25 @@ gst_spectra_scope_class_init (GstSpectraScopeClass * g_class)
   GstElementClass *element_class = (GstElementClass *) g_class;
   GstAudioVisualizerClass *scope_class = (GstAudioVisualizerClass *) g_class;
 
+  gobject_class->set_property = gst_spectra_scope_set_property;
+  gobject_class->get_property = gst_spectra_scope_get_property;
   gobject_class->finalize = gst_spectra_scope_finalize;
 
+  /**
+   * GstSpectraScope:analysis-rate:
+   *
+   * How many times per second the spectrum is computed, independently of
+   * the video framerate. The previous spectrum is drawn again for the
+   * frames in between. 0 computes it for every frame.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_ANALYSIS_RATE,
+      g_param_spec_uint ("analysis-rate", "Analysis rate",
+          "Spectrum computations per second (0 = for every frame)",
+          0, G_MAXUINT, DEFAULT_ANALYSIS_RATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class,
       "Frequency spectrum scope", "Visualization",
       "Simple frequency spectrum scope", "Stefan Kost <ensonic@users.sf.net>");
@@ -106,7 +142,39 @@ gst_spectra_scope_class_init (GstSpectraScopeClass * g_class)
 static void
 gst_spectra_scope_init (GstSpectraScope * scope)
 {
-  /* do nothing */
+  scope->analysis_rate = DEFAULT_ANALYSIS_RATE;
+}
+
+static void
+gst_spectra_scope_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstSpectraScope *scope = GST_SPECTRA_SCOPE (object);
+
+  switch (prop_id) {
+    case PROP_ANALYSIS_RATE:
+      scope->analysis_rate = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_spectra_scope_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSpectraScope *scope = GST_SPECTRA_SCOPE (object);
+
+  switch (prop_id) {
+    case PROP_ANALYSIS_RATE:
+      g_value_set_uint (value, scope->analysis_rate);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
 }
 
 static void
@@ -122,6 +190,12 @@ gst_spectra_scope_finalize (GObject * object)
     g_free (scope->freq_data);
     scope->freq_data = NULL;
   }
+  g_free (scope->mono_data);
+  scope->mono_data = NULL;
+  g_free (scope->window);
+  scope->window = NULL;
+  g_free (scope->bars);
+  scope->bars = NULL;
 
   G_OBJECT_CLASS (gst_spectra_scope_parent_class)->finalize (object);
 }
@@ -131,86 +205,69 @@ gst_spectra_scope_setup (GstAudioVisualizer * bscope)
 {
   GstSpectraScope *scope = GST_SPECTRA_SCOPE (bscope);
   guint num_freq = GST_VIDEO_INFO_WIDTH (&bscope->vinfo) + 1;
+  guint i;
 
   if (scope->fft_ctx)
     gst_fft_s16_free (scope->fft_ctx);
   g_free (scope->freq_data);
+  g_free (scope->mono_data);
+  g_free (scope->window);
+  g_free (scope->bars);
 
   /* we'd need this amount of samples per render() call */
   bscope->req_spf = num_freq * 2 - 2;
   scope->fft_ctx = gst_fft_s16_new (bscope->req_spf, FALSE);
   scope->freq_data = g_new (GstFFTS16Complex, num_freq);
+  scope->mono_data = g_new (gint16, bscope->req_spf);
+  scope->bars = g_new (guint, GST_VIDEO_INFO_WIDTH (&bscope->vinfo));
 
-  return TRUE;
-}
+  /* the same hamming window as gst_fft_s16_window(), which would compute
+   * it again for every frame */
+  scope->window = g_new (gdouble, bscope->req_spf);
+  for (i = 0; i < bscope->req_spf; i++)
+    scope->window[i] =
+        0.53836 - 0.46164 * cos (2.0 * G_PI * i / bscope->req_spf);
 
-static inline void
-add_pixel (guint32 * _p, guint32 _c)
-{
-  guint8 *p = (guint8 *) _p;
-  guint8 *c = (guint8 *) & _c;
-
-  if (p[0] < 255 - c[0])
-    p[0] += c[0];
-  else
-    p[0] = 255;
-  if (p[1] < 255 - c[1])
-    p[1] += c[1];
-  else
-    p[1] = 255;
-  if (p[2] < 255 - c[2])
-    p[2] += c[2];
-  else
-    p[2] = 255;
-  if (p[3] < 255 - c[3])
-    p[3] += c[3];
-  else
-    p[3] = 255;
+  scope->since_analysis = 0;
+  scope->analysed = FALSE;
+
+  return TRUE;
 }
 
-static gboolean
-gst_spectra_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
-    GstVideoFrame * video)
+static void
+gst_spectra_scope_analyse (GstSpectraScope * scope, GstBuffer * audio)
 {
-  GstSpectraScope *scope = GST_SPECTRA_SCOPE (bscope);
-  gint16 *mono_adata;
+  GstAudioVisualizer *bscope = GST_AUDIO_VISUALIZER (scope);
+  gint16 *mono_adata = scope->mono_data;
   GstFFTS16Complex *fdata = scope->freq_data;
-  guint x, y, off, l;
+  const gdouble *window = scope->window;
   guint w = GST_VIDEO_INFO_WIDTH (&bscope->vinfo);
   guint h = GST_VIDEO_INFO_HEIGHT (&bscope->vinfo) - 1;
+  guint ch = GST_AUDIO_INFO_CHANNELS (&bscope->ainfo);
+  guint num_samples, i, c, s = 0, x, y;
+  const gint16 *adata;
   gfloat fr, fi;
   GstMapInfo amap;
-  guint32 *vdata;
-  gint channels;
 
   gst_buffer_map (audio, &amap, GST_MAP_READ);
-  vdata = (guint32 *) GST_VIDEO_FRAME_PLANE_DATA (video, 0);
-
-  channels = GST_AUDIO_INFO_CHANNELS (&bscope->ainfo);
+  adata = (const gint16 *) amap.data;
+  num_samples = MIN (amap.size / (ch * sizeof (gint16)), bscope->req_spf);
 
-  mono_adata = g_memdup2 (amap.data, amap.size);
+  /* mixdown and apply the window in one pass */
+  for (i = 0; i < num_samples; i++) {
+    gint v = 0;
 
-  if (channels > 1) {
-    guint ch = channels;
-    guint num_samples = amap.size / (ch * sizeof (gint16));
-    guint i, c, v, s = 0;
-
-    /* deinterleave and mixdown adata */
-    for (i = 0; i < num_samples; i++) {
-      v = 0;
-      for (c = 0; c < ch; c++) {
-        v += mono_adata[s++];
-      }
-      mono_adata[i] = v / ch;
-    }
+    for (c = 0; c < ch; c++)
+      v += adata[s++];
+    mono_adata[i] = (gint16) ((v / (gint) ch) * window[i]);
   }
+  for (; i < bscope->req_spf; i++)
+    mono_adata[i] = 0;
+  gst_buffer_unmap (audio, &amap);
 
   /* run fft */
-  gst_fft_s16_window (scope->fft_ctx, mono_adata, GST_FFT_WINDOW_HAMMING);
   gst_fft_s16_fft (scope->fft_ctx, mono_adata, fdata);
-  g_free (mono_adata);
 
-  /* draw lines */
   for (x = 0; x < w; x++) {
     /* figure out the range so that we don't need to clip,
      * or even better do a log mapping? */
@@ -219,16 +276,48 @@ gst_spectra_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
     y = (guint) (h * sqrt (fr * fr + fi * fi));
     if (y > h)
       y = h;
-    y = h - y;
-    off = (y * w) + x;
-    vdata[off] = 0x00FFFFFF;
-    for (l = y; l < h; l++) {
-      off += w;
-      add_pixel (&vdata[off], 0x007F7F7F);
+    scope->bars[x] = h - y;
+  }
+
+  scope->analysed = TRUE;
+}
+
+static gboolean
+gst_spectra_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
+    GstVideoFrame * video)
+{
+  GstSpectraScope *scope = GST_SPECTRA_SCOPE (bscope);
+  const guint *bars = scope->bars;
+  guint x, l, top;
+  guint w = GST_VIDEO_INFO_WIDTH (&bscope->vinfo);
+  guint h = GST_VIDEO_INFO_HEIGHT (&bscope->vinfo) - 1;
+  guint32 *vdata, *row;
+
+  vdata = (guint32 *) GST_VIDEO_FRAME_PLANE_DATA (video, 0);
+
+  if (analysis_due (bscope, scope->analysis_rate, scope->analysed,
+          &scope->since_analysis))
+    gst_spectra_scope_analyse (scope, audio);
+
+  /* draw the bars row by row instead of column by column, so that each row
+   * is blended in one go and the frame is written sequentially */
+  top = h;
+  for (x = 0; x < w; x++)
+    top = MIN (top, bars[x]);
+
+  for (l = top; l <= h; l++) {
+    row = vdata + l * w;
+    for (x = 0; x < w; x++) {
+      guint32 p = (l == bars[x]) ? 0x00FFFFFF : row[x];
+
+      row[x] = add_pixel_value (p, (l > bars[x]) ? 0x007F7F7F : 0);
     }
-    /* ensure bottom line is full bright (especially in move-up mode) */
-    add_pixel (&vdata[off], 0x007F7F7F);
   }
-  gst_buffer_unmap (audio, &amap);
+
+  /* ensure bottom line is full bright (especially in move-up mode) */
+  row = vdata + h * w;
+  for (x = 0; x < w; x++)
+    add_pixel (&row[x], 0x007F7F7F);
+
   return TRUE;
 }
@@ -40,6 +40,18 @@ struct _GstSpectraScope
 
   GstFFTS16 *fft_ctx;
   GstFFTS16Complex *freq_data;
+
+  /* mono mixdown of the audio, and the window applied while mixing down */
+  gint16 *mono_data;
+  gdouble *window;
+  /* top row of the bar of each column */
+  guint *bars;
+
+  /* properties */
+  guint analysis_rate;
+
+  GstClockTime since_analysis;
+  gboolean analysed;
 };
 
 struct _GstSpectraScopeClass
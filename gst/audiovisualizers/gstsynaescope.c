@@ -26,6 +26,10 @@
  * Synaescope is an audio visualisation element. It analyzes frequencies and
  * out-of phase properties of audio and draws this as clouds of stars.
  *
+ * The audio is analyzed for every video frame by default. Setting
+ * #GstSynaeScope:analysis-rate analyzes it less often, and draws the previous
+ * stars again in between.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 audiotestsrc ! audioconvert ! synaescope ! ximagesink
@@ -37,6 +41,7 @@
 #endif
 
 #include "gstsynaescope.h"
+#include "gstdrawhelpers.h"
 
 #if G_BYTE_ORDER == G_BIG_ENDIAN
 #define RGB_ORDER "xRGB"
@@ -66,6 +71,18 @@ GST_STATIC_PAD_TEMPLATE ("sink",
 GST_DEBUG_CATEGORY_STATIC (synae_scope_debug);
 #define GST_CAT_DEFAULT synae_scope_debug
 
+enum
+{
+  PROP_0,
+  PROP_ANALYSIS_RATE
+};
+
+#define DEFAULT_ANALYSIS_RATE 0
+
+static void gst_synae_scope_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_synae_scope_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 static void gst_synae_scope_finalize (GObject * object);
 
 static gboolean gst_synae_scope_setup (GstAudioVisualizer * scope);
@@ -86,8 +103,25 @@ gst_synae_scope_class_init (GstSynaeScopeClass * g_class)
   GstElementClass *element_class = (GstElementClass *) g_class;
   GstAudioVisualizerClass *scope_class = (GstAudioVisualizerClass *) g_class;
 
+  gobject_class->set_property = gst_synae_scope_set_property;
+  gobject_class->get_property = gst_synae_scope_get_property;
   gobject_class->finalize = gst_synae_scope_finalize;
 
+  /**
+   * GstSynaeScope:analysis-rate:
+   *
+   * How many times per second the audio is analyzed, independently of the
+   * video framerate. The previous stars are drawn again for the frames in
+   * between. 0 analyzes it for every frame.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_ANALYSIS_RATE,
+      g_param_spec_uint ("analysis-rate", "Analysis rate",
+          "Audio analyses per second (0 = for every frame)",
+          0, G_MAXUINT, DEFAULT_ANALYSIS_RATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class, "Synaescope",
       "Visualization",
       "Creates video visualizations of audio input, using stereo and pitch information",
@@ -124,6 +158,40 @@ gst_synae_scope_init (GstSynaeScope * scope)
 
   for (i = 0; i < 256; i++)
     shade[i] = i * 200 >> 8;
+
+  scope->analysis_rate = DEFAULT_ANALYSIS_RATE;
+}
+
+static void
+gst_synae_scope_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstSynaeScope *scope = GST_SYNAE_SCOPE (object);
+
+  switch (prop_id) {
+    case PROP_ANALYSIS_RATE:
+      scope->analysis_rate = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_synae_scope_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSynaeScope *scope = GST_SYNAE_SCOPE (object);
+
+  switch (prop_id) {
+    case PROP_ANALYSIS_RATE:
+      g_value_set_uint (value, scope->analysis_rate);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
 }
 
 static void
@@ -179,31 +247,10 @@ gst_synae_scope_setup (GstAudioVisualizer * bscope)
   scope->adata_l = g_new (gint16, bscope->req_spf);
   scope->adata_r = g_new (gint16, bscope->req_spf);
 
-  return TRUE;
-}
+  scope->since_analysis = 0;
+  scope->analysed = FALSE;
 
-static inline void
-add_pixel (guint32 * _p, guint32 _c)
-{
-  guint8 *p = (guint8 *) _p;
-  guint8 *c = (guint8 *) & _c;
-
-  if (p[0] < 255 - c[0])
-    p[0] += c[0];
-  else
-    p[0] = 255;
-  if (p[1] < 255 - c[1])
-    p[1] += c[1];
-  else
-    p[1] = 255;
-  if (p[2] < 255 - c[2])
-    p[2] += c[2];
-  else
-    p[2] = 255;
-  if (p[3] < 255 - c[3])
-    p[3] += c[3];
-  else
-    p[3] = 255;
+  return TRUE;
 }
 
 static gboolean
@@ -234,24 +281,30 @@ gst_synae_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
   gdouble frl, fil, frr, fir;
   const guint sl = 30;
 
-  gst_buffer_map (audio, &amap, GST_MAP_READ);
-
   vdata = (guint32 *) GST_VIDEO_FRAME_PLANE_DATA (video, 0);
-  adata = (gint16 *) amap.data;
 
-  num_samples = amap.size / (ch * sizeof (gint16));
+  if (analysis_due (bscope, scope->analysis_rate, scope->analysed,
+          &scope->since_analysis)) {
+    gst_buffer_map (audio, &amap, GST_MAP_READ);
+    adata = (gint16 *) amap.data;
 
-  /* deinterleave */
-  for (i = 0, j = 0; i < num_samples; i++) {
-    adata_l[i] = adata[j++];
-    adata_r[i] = adata[j++];
-  }
+    num_samples = amap.size / (ch * sizeof (gint16));
 
-  /* run fft */
-  /*gst_fft_s16_window (scope->fft_ctx, adata_l, GST_FFT_WINDOW_HAMMING); */
-  gst_fft_s16_fft (scope->fft_ctx, adata_l, fdata_l);
-  /*gst_fft_s16_window (scope->fft_ctx, adata_r, GST_FFT_WINDOW_HAMMING); */
-  gst_fft_s16_fft (scope->fft_ctx, adata_r, fdata_r);
+    /* deinterleave */
+    for (i = 0, j = 0; i < num_samples; i++) {
+      adata_l[i] = adata[j++];
+      adata_r[i] = adata[j++];
+    }
+    gst_buffer_unmap (audio, &amap);
+
+    /* run fft */
+    /*gst_fft_s16_window (scope->fft_ctx, adata_l, GST_FFT_WINDOW_HAMMING); */
+    gst_fft_s16_fft (scope->fft_ctx, adata_l, fdata_l);
+    /*gst_fft_s16_window (scope->fft_ctx, adata_r, GST_FFT_WINDOW_HAMMING); */
+    gst_fft_s16_fft (scope->fft_ctx, adata_r, fdata_r);
+
+    scope->analysed = TRUE;
+  }
 
   /* draw stars */
   for (y = 0; y < h; y++) {
@@ -309,7 +362,6 @@ gst_synae_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
       }
     }
   }
-  gst_buffer_unmap (audio, &amap);
 
   return TRUE;
 }
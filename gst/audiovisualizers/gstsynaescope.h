@@ -44,6 +44,12 @@ struct _GstSynaeScope
 
   guint32 colors[256];
   guint shade[256];
+
+  /* properties */
+  guint analysis_rate;
+
+  GstClockTime since_analysis;
+  gboolean analysed;
 };
 
 struct _GstSynaeScopeClass
@@ -31,6 +31,19 @@
  * gst-launch-1.0 playbin uri=file:///path/to/video.avi video-sink="fpsdisplaysink" audio-sink=fakesink
  * ]|
  *
+ * Each frame reaching the video sink is also timed against the pipeline
+ * clock, and three histograms are kept:
+ *
+ * * latency: how long after its running time the frame reached the sink
+ * * lateness: how far past its render deadline (running time plus the
+ *   pipeline latency) the frame reached the sink, 0 when it was in time
+ * * jitter: the difference between the interval separating the arrival of
+ *   two consecutive frames and the interval separating their running times
+ *
+ * Their 50th, 99th and 99.9th percentiles and maximum are available from
+ * the #GstFPSDisplaySink:stats property, and are posted with each fps
+ * measurement when #GstFPSDisplaySink:post-stats is enabled. Recording a
+ * frame is a few atomic increments, so this can be left on in production.
  */
 /* FIXME:
  * - can we avoid plugging the textoverlay?
@@ -55,6 +68,7 @@
 #define DEFAULT_FONT "Sans 15"
 #define DEFAULT_SILENT FALSE
 #define DEFAULT_LAST_MESSAGE NULL
+#define DEFAULT_POST_STATS FALSE
 
 /* generic templates */
 static GstStaticPadTemplate fps_display_sink_template =
@@ -88,7 +102,9 @@ enum
   PROP_FRAMES_DROPPED,
   PROP_FRAMES_RENDERED,
   PROP_SILENT,
-  PROP_LAST_MESSAGE
+  PROP_LAST_MESSAGE,
+  PROP_STATS,
+  PROP_POST_STATS
       /* FILL ME */
 };
 
@@ -103,6 +119,8 @@ static void fps_display_sink_get_property (GObject * object, guint prop_id,
 static void fps_display_sink_dispose (GObject * object);
 static void fps_display_sink_handle_message (GstBin * bin,
     GstMessage * message);
+static gboolean fps_display_sink_send_event (GstElement * element,
+    GstEvent * event);
 
 static gboolean display_current_fps (gpointer data);
 
@@ -190,6 +208,37 @@ fps_display_sink_class_init (GstFPSDisplaySinkClass * klass)
   g_object_class_install_property (gobject_klass, PROP_LAST_MESSAGE,
       pspec_last_message);
 
+  /**
+   * GstFPSDisplaySink:stats:
+   *
+   * Percentiles of the per-frame latency, lateness and jitter, in
+   * nanoseconds. The structure has a "samples" field and, for each of
+   * "latency", "lateness" and "jitter", "-p50", "-p99", "-p999" and "-max"
+   * fields, e.g. "lateness-p99". Reset when going from NULL to READY.
+   * "samples" is the number of frames the percentiles are computed from:
+   * once it reaches 2^30, all counts are halved so that they can't
+   * overflow.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_klass, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Per-frame latency, lateness and jitter percentiles",
+          GST_TYPE_STRUCTURE, G_PARAM_STATIC_STRINGS | G_PARAM_READABLE));
+
+  /**
+   * GstFPSDisplaySink:post-stats:
+   *
+   * Post an element message with the #GstFPSDisplaySink:stats structure at
+   * each fps measurement.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_klass, PROP_POST_STATS,
+      g_param_spec_boolean ("post-stats", "Post statistics",
+          "Post the statistics on the bus at each fps measurement",
+          DEFAULT_POST_STATS, G_PARAM_STATIC_STRINGS | G_PARAM_READWRITE));
+
   /**
    * GstFPSDisplaySink::fps-measurements:
    * @fpsdisplaysink: a #GstFPSDisplaySink
@@ -205,6 +254,7 @@ fps_display_sink_class_init (GstFPSDisplaySinkClass * klass)
       G_TYPE_NONE, 3, G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE);
 
   gstelement_klass->change_state = fps_display_sink_change_state;
+  gstelement_klass->send_event = fps_display_sink_send_event;
 
   gst_element_class_add_static_pad_template (gstelement_klass,
       &fps_display_sink_template);
@@ -215,6 +265,175 @@ fps_display_sink_class_init (GstFPSDisplaySinkClass * klass)
       "Zeeshan Ali <zeeshan.ali@nokia.com>, Stefan Kost <stefan.kost@nokia.com>");
 }
 
+static void
+histogram_reset (GstFPSDisplaySinkHistogram * hist)
+{
+  guint i;
+
+  g_atomic_int_set (&hist->count, 0);
+  for (i = 0; i < FPS_DISPLAY_SINK_HISTOGRAM_BUCKETS; i++)
+    g_atomic_int_set (&hist->buckets[i], 0);
+}
+
+/* Halves all counts of @hist, which keeps the percentiles of a histogram
+ * running for a very long time. Only called from the streaming thread, the
+ * only one writing to the histogram */
+static void
+histogram_halve (GstFPSDisplaySinkHistogram * hist)
+{
+  gint count = 0;
+  guint i;
+
+  for (i = 0; i < FPS_DISPLAY_SINK_HISTOGRAM_BUCKETS; i++) {
+    gint bucket = g_atomic_int_get (&hist->buckets[i]) / 2;
+
+    g_atomic_int_set (&hist->buckets[i], bucket);
+    count += bucket;
+  }
+  /* the sum of the halved buckets, so the percentiles still add up */
+  g_atomic_int_set (&hist->count, count);
+}
+
+static void
+histogram_record (GstFPSDisplaySinkHistogram * hist, GstClockTimeDiff value)
+{
+  guint64 us = value > 0 ? value / GST_USECOND : 0;
+  guint idx;
+
+  if (us < FPS_DISPLAY_SINK_HISTOGRAM_SUB_BUCKETS) {
+    idx = us;
+  } else {
+    gint msb = g_bit_nth_msf (us, -1);
+
+    idx = (msb - 3) * FPS_DISPLAY_SINK_HISTOGRAM_SUB_BUCKETS +
+        ((us >> (msb - 4)) & (FPS_DISPLAY_SINK_HISTOGRAM_SUB_BUCKETS - 1));
+  }
+
+  g_atomic_int_inc (&hist->buckets[idx]);
+  if (g_atomic_int_add (&hist->count, 1) + 1 >=
+      FPS_DISPLAY_SINK_HISTOGRAM_MAX_COUNT)
+    histogram_halve (hist);
+}
+
+/* Upper bound of a bucket, in nanoseconds */
+static GstClockTime
+histogram_bucket_value (guint idx)
+{
+  guint msb, sub;
+
+  if (idx < FPS_DISPLAY_SINK_HISTOGRAM_SUB_BUCKETS)
+    return idx * GST_USECOND;
+
+  msb = idx / FPS_DISPLAY_SINK_HISTOGRAM_SUB_BUCKETS + 3;
+  sub = idx % FPS_DISPLAY_SINK_HISTOGRAM_SUB_BUCKETS;
+
+  return ((((guint64) FPS_DISPLAY_SINK_HISTOGRAM_SUB_BUCKETS + sub + 1) <<
+          (msb - 4)) - 1) * GST_USECOND;
+}
+
+/* Adds the percentiles of @hist to @s as @name-p50, @name-p99, @name-p999
+ * and @name-max. The histogram may be updated while we read it. */
+static void
+histogram_add_percentiles (GstFPSDisplaySinkHistogram * hist,
+    GstStructure * s, const gchar * name)
+{
+  static const struct
+  {
+    const gchar *suffix;
+    guint64 permille;
+  } percentiles[] = {
+    {"p50", 500}, {"p99", 990}, {"p999", 999}, {"max", 1000}
+  };
+  guint64 count = g_atomic_int_get (&hist->count);
+  guint64 sum = 0;
+  guint i, p = 0;
+  gchar *field;
+
+  for (i = 0; i < FPS_DISPLAY_SINK_HISTOGRAM_BUCKETS &&
+      p < G_N_ELEMENTS (percentiles); i++) {
+    sum += g_atomic_int_get (&hist->buckets[i]);
+
+    while (count > 0 && p < G_N_ELEMENTS (percentiles) &&
+        sum >= (percentiles[p].permille * count + 999) / 1000) {
+      field = g_strdup_printf ("%s-%s", name, percentiles[p].suffix);
+      gst_structure_set (s, field, G_TYPE_UINT64, histogram_bucket_value (i),
+          NULL);
+      g_free (field);
+      p++;
+    }
+  }
+
+  /* empty histogram, or the count went ahead of the buckets */
+  for (; p < G_N_ELEMENTS (percentiles); p++) {
+    field = g_strdup_printf ("%s-%s", name, percentiles[p].suffix);
+    gst_structure_set (s, field, G_TYPE_UINT64, (guint64) 0, NULL);
+    g_free (field);
+  }
+}
+
+static GstStructure *
+fps_display_sink_get_stats (GstFPSDisplaySink * self)
+{
+  GstStructure *s;
+
+  s = gst_structure_new ("fpsdisplaysink-stats", "samples", G_TYPE_UINT64,
+      (guint64) g_atomic_int_get (&self->latency_hist.count), NULL);
+  histogram_add_percentiles (&self->latency_hist, s, "latency");
+  histogram_add_percentiles (&self->lateness_hist, s, "lateness");
+  histogram_add_percentiles (&self->jitter_hist, s, "jitter");
+
+  return s;
+}
+
+static void
+fps_display_sink_reset_timing (GstFPSDisplaySink * self)
+{
+  self->prev_arrival = GST_CLOCK_TIME_NONE;
+  self->prev_running_time = GST_CLOCK_TIME_NONE;
+}
+
+/* Records the latency, lateness and jitter of a frame reaching the sink */
+static void
+fps_display_sink_record_frame (GstFPSDisplaySink * self, GstBuffer * buffer)
+{
+  GstClockTime arrival, running_time, latency;
+  GstClockTimeDiff diff;
+
+  if (self->segment.format != GST_FORMAT_TIME)
+    return;
+
+  running_time = gst_segment_to_running_time (&self->segment,
+      GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    return;
+
+  arrival = gst_element_get_current_running_time (GST_ELEMENT_CAST (self));
+  if (!GST_CLOCK_TIME_IS_VALID (arrival))
+    return;
+
+  /* only take the lock when the latency changed */
+  if (g_atomic_int_get (&self->latency_changed)) {
+    g_atomic_int_set (&self->latency_changed, 0);
+    GST_OBJECT_LOCK (self);
+    self->frame_latency = self->latency;
+    GST_OBJECT_UNLOCK (self);
+  }
+  latency = self->frame_latency;
+
+  diff = GST_CLOCK_DIFF (running_time, arrival);
+  histogram_record (&self->latency_hist, diff);
+  histogram_record (&self->lateness_hist, diff - (GstClockTimeDiff) latency);
+
+  if (GST_CLOCK_TIME_IS_VALID (self->prev_arrival)) {
+    diff = GST_CLOCK_DIFF (self->prev_arrival, arrival) -
+        GST_CLOCK_DIFF (self->prev_running_time, running_time);
+    histogram_record (&self->jitter_hist, ABS (diff));
+  }
+
+  self->prev_arrival = arrival;
+  self->prev_running_time = running_time;
+}
+
 static GstPadProbeReturn
 on_video_sink_data_flow (GstPad * pad, GstPadProbeInfo * info,
     gpointer user_data)
@@ -222,9 +441,20 @@ on_video_sink_data_flow (GstPad * pad, GstPadProbeInfo * info,
   GstMiniObject *mini_obj = GST_PAD_PROBE_INFO_DATA (info);
   GstFPSDisplaySink *self = GST_FPS_DISPLAY_SINK (user_data);
 
-  if (GST_IS_BUFFER (mini_obj)) {
+  if (GST_IS_EVENT (mini_obj)) {
+    GstEvent *event = GST_EVENT_CAST (mini_obj);
+
+    if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
+      gst_event_copy_segment (event, &self->segment);
+      fps_display_sink_reset_timing (self);
+    } else if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+      fps_display_sink_reset_timing (self);
+    }
+  } else if (GST_IS_BUFFER (mini_obj)) {
     GstClockTime ts;
 
+    fps_display_sink_record_frame (self, GST_BUFFER_CAST (mini_obj));
+
     /* assume the frame is going to be rendered. If it isnt', we'll get a qos
      * message and reset ->frames_rendered from there.
      */
@@ -336,7 +566,13 @@ fps_display_sink_init (GstFPSDisplaySink * self,
   self->max_fps = -1;
   self->min_fps = -1;
   self->silent = DEFAULT_SILENT;
+  self->post_stats = DEFAULT_POST_STATS;
   self->last_message = g_strdup (DEFAULT_LAST_MESSAGE);
+  self->latency = 0;
+  self->latency_changed = 0;
+  self->frame_latency = 0;
+  gst_segment_init (&self->segment, GST_FORMAT_UNDEFINED);
+  fps_display_sink_reset_timing (self);
 
   self->ghost_pad = gst_ghost_pad_new_no_target ("sink", GST_PAD_SINK);
   gst_element_add_pad (GST_ELEMENT (self), self->ghost_pad);
@@ -415,6 +651,12 @@ display_current_fps (gpointer data)
     g_object_notify_by_pspec ((GObject *) self, pspec_last_message);
   }
 
+  if (self->post_stats) {
+    gst_element_post_message (GST_ELEMENT_CAST (self),
+        gst_message_new_element (GST_OBJECT_CAST (self),
+            fps_display_sink_get_stats (self)));
+  }
+
   self->last_frames_rendered = frames_rendered;
   self->last_frames_dropped = frames_dropped;
   self->last_ts = current_ts;
@@ -438,6 +680,13 @@ fps_display_sink_start (GstFPSDisplaySink * self)
   /* init time stamps */
   self->last_ts = self->start_ts = self->interval_ts = GST_CLOCK_TIME_NONE;
 
+  /* init per-frame timing */
+  gst_segment_init (&self->segment, GST_FORMAT_UNDEFINED);
+  fps_display_sink_reset_timing (self);
+  histogram_reset (&self->latency_hist);
+  histogram_reset (&self->lateness_hist);
+  histogram_reset (&self->jitter_hist);
+
   GST_DEBUG_OBJECT (self, "Use text-overlay? %d", self->use_text_overlay);
 
   if (self->use_text_overlay) {
@@ -571,6 +820,9 @@ fps_display_sink_set_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       self->silent = g_value_get_boolean (value);
       break;
+    case PROP_POST_STATS:
+      self->post_stats = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -614,6 +866,12 @@ fps_display_sink_get_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       g_value_set_boolean (value, self->silent);
       break;
+    case PROP_STATS:
+      g_value_take_boxed (value, fps_display_sink_get_stats (self));
+      break;
+    case PROP_POST_STATS:
+      g_value_set_boolean (value, self->post_stats);
+      break;
     case PROP_LAST_MESSAGE:
       GST_OBJECT_LOCK (self);
       g_value_set_string (value, self->last_message);
@@ -697,6 +955,27 @@ fps_display_sink_handle_message (GstBin * bin, GstMessage * message)
   GST_BIN_CLASS (parent_class)->handle_message (bin, message);
 }
 
+static gboolean
+fps_display_sink_send_event (GstElement * element, GstEvent * event)
+{
+  GstFPSDisplaySink *self = GST_FPS_DISPLAY_SINK (element);
+
+  /* the render deadline of a frame is its running time plus the latency */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_LATENCY) {
+    GstClockTime latency;
+
+    gst_event_parse_latency (event, &latency);
+    GST_DEBUG_OBJECT (self, "latency %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (latency));
+    GST_OBJECT_LOCK (self);
+    self->latency = latency;
+    g_atomic_int_set (&self->latency_changed, 1);
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  return GST_ELEMENT_CLASS (parent_class)->send_event (element, event);
+}
+
 GType
 fps_display_sink_get_type (void)
 {
@@ -37,6 +37,19 @@ G_BEGIN_DECLS
 
 GType fps_display_sink_get_type (void);
 
+/* Log-linear histogram of durations in microseconds: 16 linear sub-buckets
+ * per power of two, so percentiles are within 1/16th of the value */
+#define FPS_DISPLAY_SINK_HISTOGRAM_SUB_BUCKETS 16
+#define FPS_DISPLAY_SINK_HISTOGRAM_BUCKETS (61 * 16)
+/* the counts are halved when they reach this, long before they overflow */
+#define FPS_DISPLAY_SINK_HISTOGRAM_MAX_COUNT (1 << 30)
+
+typedef struct
+{
+  gint count;                   /* ATOMIC */
+  gint buckets[FPS_DISPLAY_SINK_HISTOGRAM_BUCKETS];    /* ATOMIC */
+} GstFPSDisplaySinkHistogram;
+
 typedef struct _GstFPSDisplaySink GstFPSDisplaySink;
 typedef struct _GstFPSDisplaySinkClass GstFPSDisplaySinkClass;
 
@@ -59,6 +72,17 @@ struct _GstFPSDisplaySink
   GstClockTime interval_ts;
   guint data_probe_id;
 
+  /* per-frame timing, only written from the streaming thread */
+  GstSegment segment;
+  GstClockTime prev_arrival;
+  GstClockTime prev_running_time;
+  GstClockTime latency;         /* protected by object lock */
+  gint latency_changed;         /* ATOMIC */
+  GstClockTime frame_latency;   /* copy of latency for the streaming thread */
+  GstFPSDisplaySinkHistogram latency_hist;
+  GstFPSDisplaySinkHistogram lateness_hist;
+  GstFPSDisplaySinkHistogram jitter_hist;
+
   /* properties */
   gboolean sync;
   gboolean use_text_overlay;
@@ -67,6 +91,7 @@ struct _GstFPSDisplaySink
   gdouble max_fps;
   gdouble min_fps;
   gboolean silent;
+  gboolean post_stats;
   gchar *last_message;
 };
 
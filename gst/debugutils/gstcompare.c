@@ -20,9 +20,29 @@
  * Boston, MA 02110-1301, USA.
  */
 
+/**
+ * SECTION:element-compare
+ * @title: compare
+ *
+ * Compares the buffers arriving on the sink pad, which are passed through,
+ * with the buffers arriving on the check pad and on any requested check_%u
+ * pad, so that one reference can be checked against several candidates in
+ * one pass. Mismatches are signalled with "delta" element messages.
+ *
+ * The psnr and ssim methods work on 8 bits raw video, spread over
+ * #GstCompare:n-threads threads. With #GstCompare:post-results, a
+ * "compare-result" element message with the overall and per-plane values is
+ * posted for every comparison.
+ *
+ * Both methods give higher values for closer frames, so #GstCompare:upper
+ * has to be set to %FALSE with them, making #GstCompare:threshold the lowest
+ * acceptable value. Frames of different sizes or formats always mismatch.
+ */
+
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
+#include <math.h>
 #include <string.h>
 
 #include <gst/gst.h>
@@ -52,13 +72,23 @@ GST_STATIC_PAD_TEMPLATE ("check",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS_ANY);
 
+static GstStaticPadTemplate check_request_sink_factory =
+GST_STATIC_PAD_TEMPLATE ("check_%u",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS_ANY);
+
 enum GstCompareMethod
 {
   GST_COMPARE_METHOD_MEM,
   GST_COMPARE_METHOD_MAX,
-  GST_COMPARE_METHOD_SSIM
+  GST_COMPARE_METHOD_SSIM,
+  GST_COMPARE_METHOD_PSNR
 };
 
+/* PSNR of identical planes */
+#define GST_COMPARE_PSNR_MAX 100.0
+
 #define GST_COMPARE_METHOD_TYPE (gst_compare_method_get_type())
 static GType
 gst_compare_method_get_type (void)
@@ -69,6 +99,7 @@ gst_compare_method_get_type (void)
     {GST_COMPARE_METHOD_MEM, "Memory", "mem"},
     {GST_COMPARE_METHOD_MAX, "Maximum metric", "max"},
     {GST_COMPARE_METHOD_SSIM, "SSIM (raw video)", "ssim"},
+    {GST_COMPARE_METHOD_PSNR, "PSNR in dB (raw video)", "psnr"},
     {0, NULL, NULL}
   };
 
@@ -92,7 +123,9 @@ enum
   PROP_OFFSET_TS,
   PROP_METHOD,
   PROP_THRESHOLD,
-  PROP_UPPER
+  PROP_UPPER,
+  PROP_N_THREADS,
+  PROP_POST_RESULTS
 };
 
 #define DEFAULT_META             GST_BUFFER_COPY_ALL
@@ -100,6 +133,8 @@ enum
 #define DEFAULT_METHOD           GST_COMPARE_METHOD_MEM
 #define DEFAULT_THRESHOLD        0
 #define DEFAULT_UPPER            TRUE
+#define DEFAULT_N_THREADS        1
+#define DEFAULT_POST_RESULTS     FALSE
 
 static void gst_compare_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec);
@@ -115,6 +150,9 @@ static GstFlowReturn gst_compare_collect_pads (GstCollectPads * cpads,
 
 static GstStateChangeReturn gst_compare_change_state (GstElement * element,
     GstStateChange transition);
+static GstPad *gst_compare_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_compare_release_pad (GstElement * element, GstPad * pad);
 
 #define gst_compare_parent_class parent_class
 G_DEFINE_TYPE (GstCompare, gst_compare, GST_TYPE_ELEMENT);
@@ -127,6 +165,7 @@ gst_compare_finalize (GObject * object)
   GstCompare *comp = GST_COMPARE (object);
 
   gst_object_unref (comp->cpads);
+  g_free (comp->scratch);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -143,6 +182,9 @@ gst_compare_class_init (GstCompareClass * klass)
   GST_DEBUG_CATEGORY_INIT (compare_debug, "compare", 0, "Compare buffers");
 
   gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_compare_change_state);
+  gstelement_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_compare_request_new_pad);
+  gstelement_class->release_pad = GST_DEBUG_FUNCPTR (gst_compare_release_pad);
 
   gobject_class->set_property = gst_compare_set_property;
   gobject_class->get_property = gst_compare_get_property;
@@ -171,11 +213,41 @@ gst_compare_class_init (GstCompareClass * klass)
       g_param_spec_boolean ("upper", "Threshold Upper Bound",
           "Whether threshold value is upper bound or lower bound for difference measure",
           DEFAULT_UPPER, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstCompare:n-threads:
+   *
+   * Upper bound on the threads used by the psnr and ssim methods, 0 for one
+   * per processor. Per-line sums are added up in line order afterwards, so
+   * the reported values never change with it.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads to use (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstCompare:post-results:
+   *
+   * Post a "compare-result" element message for every comparison, with the
+   * name of the check pad, the timestamp of the reference buffer, the
+   * overall value and, for the psnr and ssim methods, an array of per-plane
+   * values.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_POST_RESULTS,
+      g_param_spec_boolean ("post-results", "Post results",
+          "Post a message with the result of every comparison",
+          DEFAULT_POST_RESULTS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_add_static_pad_template (gstelement_class, &src_factory);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_factory);
   gst_element_class_add_static_pad_template (gstelement_class,
       &check_sink_factory);
+  gst_element_class_add_static_pad_template (gstelement_class,
+      &check_request_sink_factory);
   gst_element_class_set_static_metadata (gstelement_class, "Compare buffers",
       "Filter/Debug", "Compares incoming buffers",
       "Mark Nauwelaerts <mark.nauwelaerts@collabora.co.uk>");
@@ -215,6 +287,8 @@ gst_compare_init (GstCompare * comp)
   comp->method = DEFAULT_METHOD;
   comp->threshold = DEFAULT_THRESHOLD;
   comp->upper = DEFAULT_UPPER;
+  comp->n_threads = DEFAULT_N_THREADS;
+  comp->post_results = DEFAULT_POST_RESULTS;
 
   gst_compare_reset (comp);
 }
@@ -222,6 +296,40 @@ gst_compare_init (GstCompare * comp)
 static void
 gst_compare_reset (GstCompare * comp)
 {
+  gst_slice_runner_clear (&comp->slices);
+}
+
+static GstPad *
+gst_compare_request_new_pad (GstElement * element, GstPadTemplate * templ,
+    const gchar * name, const GstCaps * caps)
+{
+  GstCompare *comp = GST_COMPARE (element);
+  GstPad *pad;
+  gchar *pad_name;
+
+  GST_OBJECT_LOCK (comp);
+  pad_name = g_strdup_printf ("check_%u", comp->n_checkpads++);
+  GST_OBJECT_UNLOCK (comp);
+
+  pad = gst_pad_new_from_template (templ, name ? name : pad_name);
+  g_free (pad_name);
+
+  gst_pad_set_query_function (pad, gst_compare_query);
+  gst_collect_pads_add_pad (comp->cpads, pad, sizeof (GstCollectData), NULL,
+      TRUE);
+  gst_pad_set_active (pad, TRUE);
+  gst_element_add_pad (element, pad);
+
+  return pad;
+}
+
+static void
+gst_compare_release_pad (GstElement * element, GstPad * pad)
+{
+  GstCompare *comp = GST_COMPARE (element);
+
+  gst_collect_pads_remove_pad (comp->cpads, pad);
+  gst_element_remove_pad (element, pad);
 }
 
 static gboolean
@@ -351,11 +459,102 @@ gst_compare_max (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
   return delta;
 }
 
+/* the psnr and ssim methods split each plane into slices of lines (or rows
+ * of windows) which are processed on the slice runner. per-line or
+ * per-window results are stored and then summed in order on the streaming
+ * thread so that results do not depend on the number of threads */
+static void
+gst_compare_update_slices (GstCompare * comp)
+{
+  GError *err = NULL;
+  guint n_threads;
+
+  GST_OBJECT_LOCK (comp);
+  n_threads = comp->n_threads;
+  GST_OBJECT_UNLOCK (comp);
+
+  if (!gst_slice_runner_set_n_threads (&comp->slices, n_threads, &err)) {
+    GST_WARNING_OBJECT (comp, "Failed to create slice thread pool: %s",
+        err->message);
+    g_clear_error (&err);
+  }
+}
+
+static gpointer
+gst_compare_get_scratch (GstCompare * comp, gsize size)
+{
+  if (comp->scratch_size < size) {
+    comp->scratch = g_realloc (comp->scratch, size);
+    comp->scratch_size = size;
+  }
+
+  return comp->scratch;
+}
+
+/* One component of two frames */
+typedef struct
+{
+  const guint8 *data1, *data2;
+  gint width, height, step, stride;
+  gint n_cols;                  /* windows per row of windows, for ssim */
+  gpointer results;
+} CompareComponent;
+
+/* The kernels below work on whole lines with integer accumulators and
+ * without any dependency between iterations, so that they get vectorized by
+ * the compiler. The contiguous case (planar formats) is kept separate from
+ * the pixel stride case for that. */
+
+static guint64
+gst_compare_ssd_line (const guint8 * data1, const guint8 * data2, gint width,
+    gint step)
+{
+  guint64 ssd = 0;
+  gint i;
+
+  if (step == 1) {
+    /* 32768 squared 8 bits differences fit in 32 bits */
+    while (width > 0) {
+      gint n = MIN (width, 32768);
+      guint32 acc = 0;
+
+      for (i = 0; i < n; i++) {
+        gint d = data1[i] - data2[i];
+        acc += d * d;
+      }
+      ssd += acc;
+      data1 += n;
+      data2 += n;
+      width -= n;
+    }
+  } else {
+    for (i = 0; i < width; i++) {
+      gint d = data1[i * step] - data2[i * step];
+      ssd += d * d;
+    }
+  }
+
+  return ssd;
+}
+
+static void
+gst_compare_psnr_slice (CompareComponent * c, guint slice, guint n_slices)
+{
+  guint64 *line_ssd = c->results;
+  guint start = GST_SLICE_START (c->height, slice, n_slices);
+  guint end = GST_SLICE_END (c->height, slice, n_slices);
+  guint i;
+
+  for (i = start; i < end; i++)
+    line_ssd[i] = gst_compare_ssd_line (c->data1 + i * c->stride,
+        c->data2 + i * c->stride, c->width, c->step);
+}
+
 static double
-gst_compare_ssim_window (GstCompare * comp, guint8 * data1, guint8 * data2,
+gst_compare_ssim_window (const guint8 * data1, const guint8 * data2,
     gint width, gint height, gint step, gint stride)
 {
-  gint count = 0, i, j;
+  gint count, i, j;
   gint sum1 = 0, sum2 = 0, ssum1 = 0, ssum2 = 0, acov = 0;
   gdouble avg1, avg2, var1, var2, cov;
 
@@ -369,24 +568,34 @@ gst_compare_ssim_window (GstCompare * comp, guint8 * data1, guint8 * data2,
   if (height <= 0 || width <= 0)
     return 1.0;
 
-  /* plain and simple; no fancy optimizations */
   for (i = 0; i < height; i++) {
-    for (j = 0; j < width; j++) {
-      sum1 += *data1;
-      sum2 += *data2;
-      ssum1 += *data1 * *data1;
-      ssum2 += *data2 * *data2;
-      acov += *data1 * *data2;
-      count++;
-      data1 += step;
-      data2 += step;
+    if (step == 1) {
+      for (j = 0; j < width; j++) {
+        gint p1 = data1[j], p2 = data2[j];
+
+        sum1 += p1;
+        sum2 += p2;
+        ssum1 += p1 * p1;
+        ssum2 += p2 * p2;
+        acov += p1 * p2;
+      }
+    } else {
+      for (j = 0; j < width; j++) {
+        gint p1 = data1[j * step], p2 = data2[j * step];
+
+        sum1 += p1;
+        sum2 += p2;
+        ssum1 += p1 * p1;
+        ssum2 += p2 * p2;
+        acov += p1 * p2;
+      }
     }
-    data1 -= j * step;
-    data2 -= j * step;
     data1 += stride;
     data2 += stride;
   }
+  count = width * height;
 
+  /* integer averages, as always computed by this element */
   avg1 = sum1 / count;
   avg2 = sum2 / count;
   var1 = ssum1 / count - avg1 * avg1;
@@ -397,44 +606,107 @@ gst_compare_ssim_window (GstCompare * comp, guint8 * data1, guint8 * data2,
       ((avg1 * avg1 + avg2 * avg2 + c1) * (var1 + var2 + c2));
 }
 
-/* @width etc are for the particular component */
-static gdouble
-gst_compare_ssim_component (GstCompare * comp, guint8 * data1, guint8 * data2,
-    gint width, gint height, gint step, gint stride)
+#define SSIM_WINDOW 16
+
+static void
+gst_compare_ssim_slice (CompareComponent * c, guint slice, guint n_slices)
 {
-  const gint window = 16;
-  gdouble ssim_sum = 0;
-  gint count = 0, i, j;
-
-  for (j = 0; j + (window / 2) < height; j += (window / 2)) {
-    for (i = 0; i + (window / 2) < width; i += (window / 2)) {
-      gdouble ssim;
-
-      ssim = gst_compare_ssim_window (comp, data1 + step * i + j * stride,
-          data2 + step * i + j * stride,
-          MIN (window, width - i), MIN (window, height - j), step, stride);
-      GST_LOG_OBJECT (comp, "ssim for %dx%d at (%d, %d) = %f", window, window,
-          i, j, ssim);
-      ssim_sum += ssim;
-      count++;
+  const gint half = SSIM_WINDOW / 2;
+  gdouble *window_ssim = c->results;
+  guint n_rows = (c->height - 1) / half;
+  guint start = GST_SLICE_START (n_rows, slice, n_slices);
+  guint end = GST_SLICE_END (n_rows, slice, n_slices);
+  guint r, col;
+
+  for (r = start; r < end; r++) {
+    gint j = r * half;
+
+    for (col = 0; col < c->n_cols; col++) {
+      gint i = col * half;
+
+      window_ssim[r * c->n_cols + col] =
+          gst_compare_ssim_window (c->data1 + c->step * i + j * c->stride,
+          c->data2 + c->step * i + j * c->stride,
+          MIN (SSIM_WINDOW, c->width - i), MIN (SSIM_WINDOW, c->height - j),
+          c->step, c->stride);
     }
   }
+}
+
+static gdouble
+gst_compare_ssim_component (GstCompare * comp, CompareComponent * c)
+{
+  const gint half = SSIM_WINDOW / 2;
+  guint n_rows, i, count;
+  gdouble ssim_sum = 0;
+  gdouble *window_ssim;
+
+  /* windows overlap by half their size, and the last one of each row and
+   * column is clipped to the image */
+  n_rows = c->height > half ? (c->height - 1) / half : 0;
+  c->n_cols = c->width > half ? (c->width - 1) / half : 0;
+  count = n_rows * c->n_cols;
 
   /* For empty images, return maximum similarity */
   if (count == 0)
     return 1.0;
 
+  c->results = window_ssim =
+      gst_compare_get_scratch (comp, count * sizeof (gdouble));
+  gst_slice_runner_run (&comp->slices, n_rows,
+      (GstSliceFunc) gst_compare_ssim_slice, c);
+
+  for (i = 0; i < count; i++)
+    ssim_sum += window_ssim[i];
+
   return (ssim_sum / count);
 }
 
+static guint64
+gst_compare_ssd_component (GstCompare * comp, CompareComponent * c)
+{
+  guint64 *line_ssd, ssd = 0;
+  gint i;
+
+  c->results = line_ssd =
+      gst_compare_get_scratch (comp, c->height * sizeof (guint64));
+  gst_slice_runner_run (&comp->slices, c->height,
+      (GstSliceFunc) gst_compare_psnr_slice, c);
+
+  for (i = 0; i < c->height; i++)
+    ssd += line_ssd[i];
+
+  return ssd;
+}
+
 static gdouble
-gst_compare_ssim (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
-    GstBuffer * buf2, GstCaps * caps2)
+gst_compare_psnr_from_ssd (guint64 ssd, guint64 n_samples)
+{
+  gdouble mse;
+
+  if (ssd == 0 || n_samples == 0)
+    return GST_COMPARE_PSNR_MAX;
+
+  mse = (gdouble) ssd / n_samples;
+
+  return MIN (10.0 * log10 (255.0 * 255.0 / mse), GST_COMPARE_PSNR_MAX);
+}
+
+/* Compares raw video frames with the psnr or ssim method, and stores the
+ * per component results in @planes */
+static gdouble
+gst_compare_video (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
+    GstBuffer * buf2, GstCaps * caps2, gdouble planes[GST_VIDEO_MAX_COMPONENTS],
+    gint * n_planes, gboolean * mismatch)
 {
   GstVideoInfo info1, info2;
   GstVideoFrame frame1, frame2;
   gint i, comps;
-  gdouble cssim[4], ssim, c[4] = { 1.0, 0.0, 0.0, 0.0 };
+  gdouble ret = 0, c[4] = { 1.0, 0.0, 0.0, 0.0 };
+  guint64 total_ssd = 0, total_samples = 0;
+  gboolean ssim = comp->method == GST_COMPARE_METHOD_SSIM;
+
+  *n_planes = 0;
 
   if (!caps1)
     goto invalid_input;
@@ -445,13 +717,15 @@ gst_compare_ssim (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
   if (!caps2)
     goto invalid_input;
 
-  if (!gst_video_info_from_caps (&info2, caps1))
+  if (!gst_video_info_from_caps (&info2, caps2))
     goto invalid_input;
 
   if (GST_VIDEO_INFO_FORMAT (&info1) != GST_VIDEO_INFO_FORMAT (&info2) ||
       GST_VIDEO_INFO_WIDTH (&info1) != GST_VIDEO_INFO_WIDTH (&info2) ||
-      GST_VIDEO_INFO_HEIGHT (&info1) != GST_VIDEO_INFO_HEIGHT (&info2))
-    return comp->threshold + 1;
+      GST_VIDEO_INFO_HEIGHT (&info1) != GST_VIDEO_INFO_HEIGHT (&info2)) {
+    *mismatch = TRUE;
+    return 0;
+  }
 
   comps = GST_VIDEO_INFO_N_COMPONENTS (&info1);
   /* note that some are reported both yuv and gray */
@@ -464,44 +738,60 @@ gst_compare_ssim (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
     c[i] /= (GST_VIDEO_INFO_IS_YUV (&info1) && (comps > 1)) ?
         2 * (comps - 1) : comps;
 
-  gst_video_frame_map (&frame1, &info1, buf1, GST_MAP_READ);
-  gst_video_frame_map (&frame2, &info2, buf2, GST_MAP_READ);
-
+  /* only support most common formats */
   for (i = 0; i < comps; i++) {
-    gint cw, ch, step, stride;
-
-    /* only support most common formats */
     if (GST_VIDEO_INFO_COMP_DEPTH (&info1, i) != 8)
       goto unsupported_input;
-    cw = GST_VIDEO_FRAME_COMP_WIDTH (&frame1, i);
-    ch = GST_VIDEO_FRAME_COMP_HEIGHT (&frame1, i);
-    step = GST_VIDEO_FRAME_COMP_PSTRIDE (&frame1, i);
-    stride = GST_VIDEO_FRAME_COMP_STRIDE (&frame1, i);
+  }
+
+  if (!gst_video_frame_map (&frame1, &info1, buf1, GST_MAP_READ))
+    goto invalid_input;
+  if (!gst_video_frame_map (&frame2, &info2, buf2, GST_MAP_READ)) {
+    gst_video_frame_unmap (&frame1);
+    goto invalid_input;
+  }
+
+  gst_compare_update_slices (comp);
+
+  for (i = 0; i < comps; i++) {
+    CompareComponent cc;
+
+    cc.data1 = GST_VIDEO_FRAME_COMP_DATA (&frame1, i);
+    cc.data2 = GST_VIDEO_FRAME_COMP_DATA (&frame2, i);
+    cc.width = GST_VIDEO_FRAME_COMP_WIDTH (&frame1, i);
+    cc.height = GST_VIDEO_FRAME_COMP_HEIGHT (&frame1, i);
+    cc.step = GST_VIDEO_FRAME_COMP_PSTRIDE (&frame1, i);
+    cc.stride = GST_VIDEO_FRAME_COMP_STRIDE (&frame1, i);
 
     GST_LOG_OBJECT (comp, "component %d", i);
-    cssim[i] = gst_compare_ssim_component (comp,
-        GST_VIDEO_FRAME_COMP_DATA (&frame1, i),
-        GST_VIDEO_FRAME_COMP_DATA (&frame2, i), cw, ch, step, stride);
-    GST_LOG_OBJECT (comp, "ssim[%d] = %f", i, cssim[i]);
+    if (ssim) {
+      planes[i] = gst_compare_ssim_component (comp, &cc);
+      ret += planes[i] * c[i];
+    } else {
+      guint64 ssd = gst_compare_ssd_component (comp, &cc);
+      guint64 n_samples = (guint64) cc.width * cc.height;
+
+      planes[i] = gst_compare_psnr_from_ssd (ssd, n_samples);
+      total_ssd += ssd;
+      total_samples += n_samples;
+    }
+    GST_LOG_OBJECT (comp, "%s[%d] = %f", ssim ? "ssim" : "psnr", i, planes[i]);
   }
 
   gst_video_frame_unmap (&frame1);
   gst_video_frame_unmap (&frame2);
 
-#ifndef GST_DISABLE_GST_DEBUG
-  for (i = 0; i < 4; i++) {
-    GST_DEBUG_OBJECT (comp, "ssim[%d] = %f, c[%d] = %f", i, cssim[i], i, c[i]);
-  }
-#endif
+  *n_planes = comps;
+  if (!ssim)
+    ret = gst_compare_psnr_from_ssd (total_ssd, total_samples);
 
-  ssim = cssim[0] * c[0] + cssim[1] * c[1] + cssim[2] * c[2] + cssim[3] * c[3];
-
-  return ssim;
+  return ret;
 
   /* ERRORS */
 invalid_input:
   {
-    GST_ERROR_OBJECT (comp, "ssim method needs raw video input");
+    GST_ERROR_OBJECT (comp, "%s method needs raw video input",
+        ssim ? "ssim" : "psnr");
     return 0;
   }
 unsupported_input:
@@ -513,22 +803,60 @@ unsupported_input:
 }
 
 static void
-gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
-    GstBuffer * buf2, GstCaps * caps2)
+gst_compare_post_result (GstCompare * comp, GstPad * checkpad,
+    GstBuffer * buf, gdouble value, const gdouble * planes, gint n_planes)
+{
+  GValue array = G_VALUE_INIT, v = G_VALUE_INIT;
+  GEnumValue *method;
+  GstStructure *s;
+  gint i;
+
+  g_value_init (&array, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_DOUBLE);
+  for (i = 0; i < n_planes; i++) {
+    g_value_set_double (&v, planes[i]);
+    gst_value_array_append_value (&array, &v);
+  }
+  g_value_unset (&v);
+
+  method = g_enum_get_value (g_type_class_peek (GST_COMPARE_METHOD_TYPE),
+      comp->method);
+
+  s = gst_structure_new ("compare-result",
+      "pad", G_TYPE_STRING, GST_PAD_NAME (checkpad),
+      "timestamp", G_TYPE_UINT64, GST_BUFFER_PTS (buf),
+      "method", G_TYPE_STRING, method->value_nick,
+      "value", G_TYPE_DOUBLE, value, NULL);
+  gst_structure_take_value (s, "planes", &array);
+
+  gst_element_post_message (GST_ELEMENT (comp),
+      gst_message_new_element (GST_OBJECT (comp), s));
+}
+
+static void
+gst_compare_buffers (GstCompare * comp, GstPad * checkpad, GstBuffer * buf1,
+    GstCaps * caps1, GstBuffer * buf2, GstCaps * caps2)
 {
   gdouble delta = 0;
+  gdouble planes[GST_VIDEO_MAX_COMPONENTS];
+  gint n_planes = 0;
+  gboolean mismatch = FALSE;
   gsize size1, size2;
 
   /* first check metadata */
   gst_compare_meta (comp, buf1, caps1, buf2, caps2);
 
   size1 = gst_buffer_get_size (buf1);
-  size2 = gst_buffer_get_size (buf1);
+  size2 = gst_buffer_get_size (buf2);
 
   /* check content according to method */
   /* but at least size should match */
   if (size1 != size2) {
-    delta = comp->threshold + 1;
+    /* fails whatever the threshold and its direction */
+    mismatch = TRUE;
+    if (comp->method == GST_COMPARE_METHOD_MEM ||
+        comp->method == GST_COMPARE_METHOD_MAX)
+      delta = comp->threshold + 1;
   } else {
     GstMapInfo map1, map2;
 
@@ -546,7 +874,9 @@ gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
         delta = gst_compare_max (comp, buf1, caps1, buf2, caps2);
         break;
       case GST_COMPARE_METHOD_SSIM:
-        delta = gst_compare_ssim (comp, buf1, caps1, buf2, caps2);
+      case GST_COMPARE_METHOD_PSNR:
+        delta = gst_compare_video (comp, buf1, caps1, buf2, caps2, planes,
+            &n_planes, &mismatch);
         break;
       default:
         g_assert_not_reached ();
@@ -554,7 +884,10 @@ gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
     }
   }
 
-  if ((comp->upper && delta > comp->threshold) ||
+  if (comp->post_results)
+    gst_compare_post_result (comp, checkpad, buf1, delta, planes, n_planes);
+
+  if (mismatch || (comp->upper && delta > comp->threshold) ||
       (!comp->upper && delta < comp->threshold)) {
     GST_WARNING_OBJECT (comp, "buffers %p and %p failed content match %f",
         buf1, buf2, delta);
@@ -562,7 +895,7 @@ gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
     gst_element_post_message (GST_ELEMENT (comp),
         gst_message_new_element (GST_OBJECT (comp),
             gst_structure_new ("delta", "content", G_TYPE_DOUBLE, delta,
-                NULL)));
+                "pad", G_TYPE_STRING, GST_PAD_NAME (checkpad), NULL)));
   }
 }
 
@@ -571,41 +904,56 @@ gst_compare_collect_pads (GstCollectPads * cpads, GstCompare * comp)
 {
   GstBuffer *buf1, *buf2;
   GstCaps *caps1, *caps2;
+  gboolean eos;
+  GSList *l;
 
   buf1 = gst_collect_pads_pop (comp->cpads,
       gst_pad_get_element_private (comp->sinkpad));
   caps1 = gst_pad_get_current_caps (comp->sinkpad);
+  eos = buf1 == NULL;
 
-  buf2 = gst_collect_pads_pop (comp->cpads,
-      gst_pad_get_element_private (comp->checkpad));
-  caps2 = gst_pad_get_current_caps (comp->checkpad);
+  /* compare the reference with each of the check pads, in the order they
+   * were added */
+  for (l = cpads->data; l; l = l->next) {
+    GstCollectData *data = l->data;
 
-  if (!buf1 && !buf2) {
-    gst_pad_push_event (comp->srcpad, gst_event_new_eos ());
-    return GST_FLOW_EOS;
-  } else if (buf1 && buf2) {
-    gst_compare_buffers (comp, buf1, caps1, buf2, caps2);
-  } else {
-    GST_WARNING_OBJECT (comp, "buffer %p != NULL", buf1 ? buf1 : buf2);
+    if (data->pad == comp->sinkpad)
+      continue;
 
-    comp->count++;
-    gst_element_post_message (GST_ELEMENT (comp),
-        gst_message_new_element (GST_OBJECT (comp),
-            gst_structure_new ("delta", "count", G_TYPE_INT, comp->count,
-                NULL)));
-  }
+    buf2 = gst_collect_pads_pop (comp->cpads, data);
+    caps2 = gst_pad_get_current_caps (data->pad);
 
-  if (buf1)
-    gst_pad_push (comp->srcpad, buf1);
+    if (buf1 && buf2) {
+      gst_compare_buffers (comp, data->pad, buf1, caps1, buf2, caps2);
+    } else if (buf1 || buf2) {
+      GST_WARNING_OBJECT (comp, "buffer %p != NULL", buf1 ? buf1 : buf2);
+
+      comp->count++;
+      gst_element_post_message (GST_ELEMENT (comp),
+          gst_message_new_element (GST_OBJECT (comp),
+              gst_structure_new ("delta", "count", G_TYPE_INT, comp->count,
+                  "pad", G_TYPE_STRING, GST_PAD_NAME (data->pad), NULL)));
+    }
+
+    if (buf2) {
+      eos = FALSE;
+      gst_buffer_unref (buf2);
+    }
 
-  if (buf2)
-    gst_buffer_unref (buf2);
+    if (caps2)
+      gst_caps_unref (caps2);
+  }
 
   if (caps1)
     gst_caps_unref (caps1);
 
-  if (caps2)
-    gst_caps_unref (caps2);
+  if (eos) {
+    gst_pad_push_event (comp->srcpad, gst_event_new_eos ());
+    return GST_FLOW_EOS;
+  }
+
+  if (buf1)
+    gst_pad_push (comp->srcpad, buf1);
 
   return GST_FLOW_OK;
 }
@@ -632,6 +980,14 @@ gst_compare_set_property (GObject * object, guint prop_id,
     case PROP_UPPER:
       comp->upper = g_value_get_boolean (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (comp);
+      comp->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (comp);
+      break;
+    case PROP_POST_RESULTS:
+      comp->post_results = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -660,6 +1016,14 @@ gst_compare_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_UPPER:
       g_value_set_boolean (value, comp->upper);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (comp);
+      g_value_set_uint (value, comp->n_threads);
+      GST_OBJECT_UNLOCK (comp);
+      break;
+    case PROP_POST_RESULTS:
+      g_value_set_boolean (value, comp->post_results);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -26,6 +26,7 @@
 
 
 #include <gst/gst.h>
+#include <gst/slice-runner-private.h>
 
 G_BEGIN_DECLS
 
@@ -53,15 +54,23 @@ struct _GstCompare {
   GstPad *checkpad;
 
   GstCollectPads *cpads;
+  guint n_checkpads;     /* for naming the requested check pads */
 
   gint count;
 
+  /* slice threading */
+  GstSliceRunner slices;
+  gpointer scratch;      /* per-line or per-window results */
+  gsize scratch_size;
+
   /* properties */
   GstBufferCopyFlags meta;
   gboolean offset_ts;
   gint method;
   gdouble threshold;
   gboolean upper;
+  guint n_threads;
+  gboolean post_results;
 };
 
 struct _GstCompareClass {
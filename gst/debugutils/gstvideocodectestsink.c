@@ -25,6 +25,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gio/gio.h>
+#include <string.h>
 
 #include "gstdebugutilsbadelements.h"
 #include "gstvideocodectestsink.h"
@@ -45,20 +46,94 @@
  * * "checksum-type"  G_TYPE_STRING The checksum type (only MD5 is supported)
  * * "checksum"       G_TYPE_STRING The checksum as a string
  *
+ * With #GstVideoCodecTestSink:frame-checksum, a digest of each frame (or of
+ * each of its planes, with #GstVideoCodecTestSink:per-plane) is computed on
+ * #GstVideoCodecTestSink:n-threads threads, and posted in frame order with
+ * an element message of type `conformance/frame-checksum`:
+ *
+ * * "checksum-type"   G_TYPE_STRING The frame checksum type
+ * * "frame"           G_TYPE_UINT64 The frame number, starting at 0
+ * * "timestamp"       G_TYPE_UINT64 The timestamp of the frame
+ * * "checksum"        G_TYPE_STRING The checksum of the frame, or
+ * * "plane-checksums" GST_TYPE_ARRAY The checksums of the Y, U and V planes
+ *
+ * These digests can be checked on the fly against a reference file set with
+ * #GstVideoCodecTestSink:reference, which holds one line per frame with its
+ * checksum, or the checksums of its planes separated by spaces. Empty lines
+ * and lines starting with `#` are ignored. An error is posted at the first
+ * frame not matching the reference.
+ *
+ * Frame and plane checksums are computed on the same unpadded I420 layout as
+ * the stream checksum.
+ *
  * ## Example launch lines
  * |[
  * gst-launch-1.0 videotestsrc num-buffers=2 ! videocodectestsink location=true-raw.yuv -m
  * ]|
+ * |[
+ * gst-launch-1.0 filesrc location=in.ivf ! ivfparse ! vp9dec ! videocodectestsink \
+ *     stream-checksum=false frame-checksum=xxhash64 n-threads=0 reference=in.xxh
+ * ]|
  *
  * Since: 1.20
  */
 
+typedef enum
+{
+  FRAME_CHECKSUM_NONE,
+  FRAME_CHECKSUM_MD5,
+  FRAME_CHECKSUM_CRC64,
+  FRAME_CHECKSUM_XXHASH64,
+} GstVideoCodecTestSinkFrameChecksum;
+
+#define GST_TYPE_VIDEO_CODEC_TEST_SINK_FRAME_CHECKSUM \
+    (gst_video_codec_test_sink_frame_checksum_get_type ())
+static GType
+gst_video_codec_test_sink_frame_checksum_get_type (void)
+{
+  static GType type = 0;
+
+  static const GEnumValue types[] = {
+    {FRAME_CHECKSUM_NONE, "No frame checksum", "none"},
+    {FRAME_CHECKSUM_MD5, "MD5", "md5"},
+    {FRAME_CHECKSUM_CRC64, "CRC-64 (ECMA-182, as in xz)", "crc64"},
+    {FRAME_CHECKSUM_XXHASH64, "xxHash 64 bits", "xxhash64"},
+    {0, NULL, NULL}
+  };
+
+  if (!type) {
+    type = g_enum_register_static ("GstVideoCodecTestSinkFrameChecksum",
+        types);
+  }
+  return type;
+}
+
 enum
 {
   PROP_0,
   PROP_LOCATION,
+  PROP_STREAM_CHECKSUM,
+  PROP_FRAME_CHECKSUM,
+  PROP_PER_PLANE,
+  PROP_N_THREADS,
+  PROP_REFERENCE,
 };
 
+#define DEFAULT_STREAM_CHECKSUM TRUE
+#define DEFAULT_FRAME_CHECKSUM FRAME_CHECKSUM_NONE
+#define DEFAULT_PER_PLANE FALSE
+#define DEFAULT_N_THREADS 1
+
+/* A frame whose checksums are being computed */
+typedef struct
+{
+  GstVideoFrame frame;
+  guint64 number;
+  gchar *checksums[4];
+  guint n_checksums;
+  gboolean done;
+} FrameJob;
+
 struct _GstVideoCodecTestSink
 {
   GstBaseSink parent;
@@ -70,9 +145,26 @@ struct _GstVideoCodecTestSink
       GstVideoFrame * frame);
   GOutputStream *ostream;
   GChecksum *checksum;
+  GstVideoCodecTestSinkFrameChecksum frame_hash;
+  gboolean frame_per_plane;
+  gboolean do_stream_checksum;
+  GThreadPool *pool;
+  guint max_pending;
+  guint64 n_frames;
+  GPtrArray *reference;         /* one strv per frame */
+
+  /* frame jobs in frame order, protected by jobs_lock */
+  GMutex jobs_lock;
+  GCond jobs_cond;
+  GQueue jobs;
 
   /* protect with object lock */
   gchar *location;
+  gboolean stream_checksum;
+  GstVideoCodecTestSinkFrameChecksum frame_checksum;
+  gboolean per_plane;
+  guint n_threads;
+  gchar *reference_location;
 };
 
 static GstStaticPadTemplate gst_video_codec_test_sink_template =
@@ -100,6 +192,22 @@ gst_video_codec_test_sink_set_property (GObject * object, guint prop_id,
       g_free (self->location);
       self->location = g_value_dup_string (value);
       break;
+    case PROP_STREAM_CHECKSUM:
+      self->stream_checksum = g_value_get_boolean (value);
+      break;
+    case PROP_FRAME_CHECKSUM:
+      self->frame_checksum = g_value_get_enum (value);
+      break;
+    case PROP_PER_PLANE:
+      self->per_plane = g_value_get_boolean (value);
+      break;
+    case PROP_N_THREADS:
+      self->n_threads = g_value_get_uint (value);
+      break;
+    case PROP_REFERENCE:
+      g_free (self->reference_location);
+      self->reference_location = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -120,6 +228,21 @@ gst_video_codec_test_sink_get_property (GObject * object, guint prop_id,
     case PROP_LOCATION:
       g_value_set_string (value, self->location);
       break;
+    case PROP_STREAM_CHECKSUM:
+      g_value_set_boolean (value, self->stream_checksum);
+      break;
+    case PROP_FRAME_CHECKSUM:
+      g_value_set_enum (value, self->frame_checksum);
+      break;
+    case PROP_PER_PLANE:
+      g_value_set_boolean (value, self->per_plane);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, self->n_threads);
+      break;
+    case PROP_REFERENCE:
+      g_value_set_string (value, self->reference_location);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -128,22 +251,538 @@ gst_video_codec_test_sink_get_property (GObject * object, guint prop_id,
   GST_OBJECT_UNLOCK (self);
 }
 
+/* CRC-64 with the ECMA-182 polynomial, reflected, as used by xz */
+#define CRC64_POLY G_GUINT64_CONSTANT (0xc96c5795d7870f42)
+
+static guint64 crc64_table[256];
+static GOnce crc64_once = G_ONCE_INIT;
+
+static gpointer
+crc64_init_table (gpointer data)
+{
+  guint i, j;
+
+  for (i = 0; i < 256; i++) {
+    guint64 c = i;
+
+    for (j = 0; j < 8; j++)
+      c = (c & 1) ? (c >> 1) ^ CRC64_POLY : c >> 1;
+    crc64_table[i] = c;
+  }
+
+  return NULL;
+}
+
+static guint64
+crc64_update (guint64 crc, const guint8 * data, gsize length)
+{
+  gsize i;
+
+  for (i = 0; i < length; i++)
+    crc = crc64_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+  return crc;
+}
+
+/* Streaming XXH64, with a seed of 0 */
+#define XXH_PRIME64_1 G_GUINT64_CONSTANT (0x9e3779b185ebca87)
+#define XXH_PRIME64_2 G_GUINT64_CONSTANT (0xc2b2ae3d27d4eb4f)
+#define XXH_PRIME64_3 G_GUINT64_CONSTANT (0x165667b19e3779f9)
+#define XXH_PRIME64_4 G_GUINT64_CONSTANT (0x85ebca77c2b2ae63)
+#define XXH_PRIME64_5 G_GUINT64_CONSTANT (0x27d4eb2f165667c5)
+#define XXH_ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+typedef struct
+{
+  guint64 total_len;
+  guint64 v[4];
+  guint8 mem[32];
+  guint memsize;
+} Xxh64State;
+
+static inline guint64
+xxh64_round (guint64 acc, guint64 input)
+{
+  acc += input * XXH_PRIME64_2;
+  acc = XXH_ROTL64 (acc, 31);
+  return acc * XXH_PRIME64_1;
+}
+
+static inline guint64
+xxh64_merge_round (guint64 acc, guint64 val)
+{
+  acc ^= xxh64_round (0, val);
+  return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static void
+xxh64_init (Xxh64State * state)
+{
+  memset (state, 0, sizeof (Xxh64State));
+  state->v[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+  state->v[1] = XXH_PRIME64_2;
+  state->v[2] = 0;
+  state->v[3] = 0 - XXH_PRIME64_1;
+}
+
+static inline void
+xxh64_stripe (Xxh64State * state, const guint8 * p)
+{
+  state->v[0] = xxh64_round (state->v[0], GST_READ_UINT64_LE (p));
+  state->v[1] = xxh64_round (state->v[1], GST_READ_UINT64_LE (p + 8));
+  state->v[2] = xxh64_round (state->v[2], GST_READ_UINT64_LE (p + 16));
+  state->v[3] = xxh64_round (state->v[3], GST_READ_UINT64_LE (p + 24));
+}
+
+static void
+xxh64_update (Xxh64State * state, const guint8 * data, gsize length)
+{
+  const guint8 *end = data + length;
+
+  state->total_len += length;
+
+  if (state->memsize + length < 32) {
+    memcpy (state->mem + state->memsize, data, length);
+    state->memsize += length;
+    return;
+  }
+
+  if (state->memsize) {
+    memcpy (state->mem + state->memsize, data, 32 - state->memsize);
+    data += 32 - state->memsize;
+    xxh64_stripe (state, state->mem);
+    state->memsize = 0;
+  }
+
+  while (data + 32 <= end) {
+    xxh64_stripe (state, data);
+    data += 32;
+  }
+
+  if (data < end) {
+    memcpy (state->mem, data, end - data);
+    state->memsize = end - data;
+  }
+}
+
+static guint64
+xxh64_digest (const Xxh64State * state)
+{
+  const guint8 *p = state->mem;
+  const guint8 *end = p + state->memsize;
+  guint64 h;
+
+  if (state->total_len >= 32) {
+    h = XXH_ROTL64 (state->v[0], 1) + XXH_ROTL64 (state->v[1], 7) +
+        XXH_ROTL64 (state->v[2], 12) + XXH_ROTL64 (state->v[3], 18);
+    h = xxh64_merge_round (h, state->v[0]);
+    h = xxh64_merge_round (h, state->v[1]);
+    h = xxh64_merge_round (h, state->v[2]);
+    h = xxh64_merge_round (h, state->v[3]);
+  } else {
+    h = XXH_PRIME64_5;
+  }
+
+  h += state->total_len;
+
+  while (p + 8 <= end) {
+    h ^= xxh64_round (0, GST_READ_UINT64_LE (p));
+    h = XXH_ROTL64 (h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    p += 8;
+  }
+
+  if (p + 4 <= end) {
+    h ^= (guint64) GST_READ_UINT32_LE (p) * XXH_PRIME64_1;
+    h = XXH_ROTL64 (h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    p += 4;
+  }
+
+  while (p < end) {
+    h ^= (*p++) * XXH_PRIME64_5;
+    h = XXH_ROTL64 (h, 11) * XXH_PRIME64_1;
+  }
+
+  h ^= h >> 33;
+  h *= XXH_PRIME64_2;
+  h ^= h >> 29;
+  h *= XXH_PRIME64_3;
+  h ^= h >> 32;
+
+  return h;
+}
+
+typedef struct
+{
+  GstVideoCodecTestSinkFrameChecksum type;
+  GChecksum *md5;
+  guint64 crc;
+  Xxh64State xxh;
+} FrameHasher;
+
+static void
+frame_hasher_init (FrameHasher * hasher,
+    GstVideoCodecTestSinkFrameChecksum type)
+{
+  hasher->type = type;
+
+  switch (type) {
+    case FRAME_CHECKSUM_MD5:
+      hasher->md5 = g_checksum_new (G_CHECKSUM_MD5);
+      break;
+    case FRAME_CHECKSUM_CRC64:
+      hasher->crc = G_MAXUINT64;
+      break;
+    case FRAME_CHECKSUM_XXHASH64:
+      xxh64_init (&hasher->xxh);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+}
+
+static void
+frame_hasher_update (FrameHasher * hasher, const guint8 * data, gsize length)
+{
+  switch (hasher->type) {
+    case FRAME_CHECKSUM_MD5:
+      g_checksum_update (hasher->md5, data, length);
+      break;
+    case FRAME_CHECKSUM_CRC64:
+      hasher->crc = crc64_update (hasher->crc, data, length);
+      break;
+    case FRAME_CHECKSUM_XXHASH64:
+      xxh64_update (&hasher->xxh, data, length);
+      break;
+    default:
+      break;
+  }
+}
+
+static gchar *
+frame_hasher_finish (FrameHasher * hasher)
+{
+  gchar *ret = NULL;
+
+  switch (hasher->type) {
+    case FRAME_CHECKSUM_MD5:
+      ret = g_strdup (g_checksum_get_string (hasher->md5));
+      g_checksum_free (hasher->md5);
+      hasher->md5 = NULL;
+      break;
+    case FRAME_CHECKSUM_CRC64:
+      ret = g_strdup_printf ("%016" G_GINT64_MODIFIER "x", ~hasher->crc);
+      break;
+    case FRAME_CHECKSUM_XXHASH64:
+      ret = g_strdup_printf ("%016" G_GINT64_MODIFIER "x",
+          xxh64_digest (&hasher->xxh));
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+static const gchar *
+frame_checksum_nick (GstVideoCodecTestSinkFrameChecksum type)
+{
+  GEnumClass *klass;
+  GEnumValue *value;
+  const gchar *ret;
+
+  klass = g_type_class_ref (GST_TYPE_VIDEO_CODEC_TEST_SINK_FRAME_CHECKSUM);
+  value = g_enum_get_value (klass, type);
+  ret = value ? value->value_nick : "unknown";
+  g_type_class_unref (klass);
+
+  return ret;
+}
+
+/* Hashes a component in the same unpadded I420 layout as the stream checksum,
+ * deinterleaving the NV12 chroma into @line */
+static void
+hash_component (FrameHasher * hasher, GstVideoFrame * frame, guint comp,
+    guint8 * line)
+{
+  const GstVideoInfo *vinfo = &frame->info;
+  guint plane = GST_VIDEO_INFO_COMP_PLANE (vinfo, comp);
+  guint stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+  guint pstride = GST_VIDEO_INFO_COMP_PSTRIDE (vinfo, comp);
+  guint width = GST_VIDEO_INFO_COMP_WIDTH (vinfo, comp);
+  const guint8 *data;
+  gint x, y;
+
+  data = GST_VIDEO_FRAME_PLANE_DATA (frame, plane);
+  data += GST_VIDEO_INFO_COMP_POFFSET (vinfo, comp);
+
+  for (y = 0; y < GST_VIDEO_INFO_COMP_HEIGHT (vinfo, comp); y++) {
+    if (pstride == 2 && GST_VIDEO_INFO_FORMAT (vinfo) == GST_VIDEO_FORMAT_NV12) {
+      for (x = 0; x < width; x++)
+        line[x] = data[2 * x];
+      frame_hasher_update (hasher, line, width);
+    } else {
+      frame_hasher_update (hasher, data, width * pstride);
+    }
+
+    data += stride;
+  }
+}
+
+static void
+frame_job_worker (gpointer data, gpointer user_data)
+{
+  FrameJob *job = data;
+  GstVideoCodecTestSink *self = user_data;
+  FrameHasher hashers[3];
+  guint8 *line;
+  guint comp;
+
+  line = g_malloc (GST_VIDEO_FRAME_WIDTH (&job->frame));
+
+  if (self->frame_per_plane) {
+    job->n_checksums = 3;
+    for (comp = 0; comp < 3; comp++) {
+      frame_hasher_init (&hashers[comp], self->frame_hash);
+      hash_component (&hashers[comp], &job->frame, comp, line);
+      job->checksums[comp] = frame_hasher_finish (&hashers[comp]);
+    }
+  } else {
+    job->n_checksums = 1;
+    frame_hasher_init (&hashers[0], self->frame_hash);
+    for (comp = 0; comp < 3; comp++)
+      hash_component (&hashers[0], &job->frame, comp, line);
+    job->checksums[0] = frame_hasher_finish (&hashers[0]);
+  }
+
+  g_free (line);
+
+  g_mutex_lock (&self->jobs_lock);
+  job->done = TRUE;
+  g_cond_broadcast (&self->jobs_cond);
+  g_mutex_unlock (&self->jobs_lock);
+}
+
+static void
+frame_job_free (FrameJob * job)
+{
+  guint i;
+
+  gst_video_frame_unmap (&job->frame);
+  for (i = 0; i < job->n_checksums; i++)
+    g_free (job->checksums[i]);
+  g_free (job);
+}
+
+/* Posts the checksums of a frame and checks them against the reference,
+ * called in frame order */
+static GstFlowReturn
+gst_video_codec_test_sink_finish_frame (GstVideoCodecTestSink * self,
+    FrameJob * job)
+{
+  GstStructure *s;
+  gchar *checksums;
+  guint i;
+
+  s = gst_structure_new ("conformance/frame-checksum",
+      "checksum-type", G_TYPE_STRING, frame_checksum_nick (self->frame_hash),
+      "frame", G_TYPE_UINT64, job->number,
+      "timestamp", G_TYPE_UINT64, GST_BUFFER_PTS (job->frame.buffer), NULL);
+
+  if (self->frame_per_plane) {
+    GValue array = G_VALUE_INIT;
+    GValue v = G_VALUE_INIT;
+
+    gst_value_array_init (&array, job->n_checksums);
+    g_value_init (&v, G_TYPE_STRING);
+    for (i = 0; i < job->n_checksums; i++) {
+      g_value_set_string (&v, job->checksums[i]);
+      gst_value_array_append_value (&array, &v);
+    }
+    g_value_unset (&v);
+    gst_structure_take_value (s, "plane-checksums", &array);
+  } else {
+    gst_structure_set (s, "checksum", G_TYPE_STRING, job->checksums[0], NULL);
+  }
+
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self), s));
+
+  if (!self->reference)
+    return GST_FLOW_OK;
+
+  checksums = g_strjoinv (" ", job->checksums);
+
+  if (job->number >= self->reference->len) {
+    GST_ELEMENT_ERROR (self, STREAM, FAILED,
+        ("Frame %" G_GUINT64_FORMAT " is not in the reference, which has %u "
+            "frames", job->number, self->reference->len),
+        ("got %s", checksums));
+    g_free (checksums);
+    return GST_FLOW_ERROR;
+  } else {
+    gchar **expected = g_ptr_array_index (self->reference, job->number);
+    gboolean match = g_strv_length (expected) == job->n_checksums;
+
+    for (i = 0; match && i < job->n_checksums; i++)
+      match = g_ascii_strcasecmp (expected[i], job->checksums[i]) == 0;
+
+    if (!match) {
+      gchar *expected_str = g_strjoinv (" ", expected);
+
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          ("Frame %" G_GUINT64_FORMAT " does not match the reference",
+              job->number), ("got %s, expected %s", checksums, expected_str));
+      g_free (expected_str);
+      g_free (checksums);
+      return GST_FLOW_ERROR;
+    }
+  }
+
+  g_free (checksums);
+  return GST_FLOW_OK;
+}
+
+/* Finishes the computed frames in order, until at most @max_pending frames
+ * are left */
+static GstFlowReturn
+gst_video_codec_test_sink_finish_frames (GstVideoCodecTestSink * self,
+    guint max_pending)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  g_mutex_lock (&self->jobs_lock);
+  while (!g_queue_is_empty (&self->jobs)) {
+    FrameJob *job = g_queue_peek_head (&self->jobs);
+
+    if (!job->done) {
+      if (g_queue_get_length (&self->jobs) <= max_pending)
+        break;
+      g_cond_wait (&self->jobs_cond, &self->jobs_lock);
+      continue;
+    }
+
+    g_queue_pop_head (&self->jobs);
+    g_mutex_unlock (&self->jobs_lock);
+
+    if (ret == GST_FLOW_OK)
+      ret = gst_video_codec_test_sink_finish_frame (self, job);
+    frame_job_free (job);
+
+    g_mutex_lock (&self->jobs_lock);
+  }
+  g_mutex_unlock (&self->jobs_lock);
+
+  return ret;
+}
+
+static GPtrArray *
+load_reference (GstVideoCodecTestSink * self, const gchar * location)
+{
+  GPtrArray *reference;
+  GError *error = NULL;
+  gchar *contents;
+  gchar **lines;
+  guint i;
+
+  if (!g_file_get_contents (location, &contents, NULL, &error)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ,
+        ("Failed to read reference checksums '%s'", location),
+        ("%s", error->message));
+    g_error_free (error);
+    return NULL;
+  }
+
+  reference = g_ptr_array_new_with_free_func ((GDestroyNotify) g_strfreev);
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (i = 0; lines[i]; i++) {
+    gchar **tokens;
+    GPtrArray *checksums;
+    guint j;
+
+    g_strstrip (lines[i]);
+    if (lines[i][0] == '\0' || lines[i][0] == '#')
+      continue;
+
+    /* split on any amount of whitespace */
+    tokens = g_strsplit_set (lines[i], " \t\r", -1);
+    checksums = g_ptr_array_new ();
+    for (j = 0; tokens[j]; j++) {
+      if (tokens[j][0] != '\0')
+        g_ptr_array_add (checksums, g_strdup (tokens[j]));
+    }
+    g_ptr_array_add (checksums, NULL);
+    g_ptr_array_add (reference, g_ptr_array_free (checksums, FALSE));
+    g_strfreev (tokens);
+  }
+
+  g_strfreev (lines);
+
+  GST_DEBUG_OBJECT (self, "Loaded %u reference frame checksums from '%s'",
+      reference->len, location);
+
+  return reference;
+}
+
 static gboolean
 gst_video_codec_test_sink_start (GstBaseSink * sink)
 {
   GstVideoCodecTestSink *self = GST_VIDEO_CODEC_TEST_SINK (sink);
   GError *error = NULL;
   GFile *file = NULL;
+  gchar *reference_location;
   gboolean ret = TRUE;
+  guint n_threads;
 
   GST_OBJECT_LOCK (self);
 
   self->checksum = g_checksum_new (self->hash);
   if (self->location)
     file = g_file_new_for_path (self->location);
+  self->do_stream_checksum = self->stream_checksum;
+  self->frame_hash = self->frame_checksum;
+  self->frame_per_plane = self->per_plane;
+  n_threads = self->n_threads;
+  reference_location = g_strdup (self->reference_location);
 
   GST_OBJECT_UNLOCK (self);
 
+  self->n_frames = 0;
+
+  if (reference_location) {
+    self->reference = load_reference (self, reference_location);
+    g_free (reference_location);
+    if (!self->reference) {
+      g_clear_pointer (&self->checksum, g_checksum_free);
+      g_clear_object (&file);
+      return FALSE;
+    }
+
+    if (self->frame_hash == FRAME_CHECKSUM_NONE)
+      GST_WARNING_OBJECT (self, "Reference set without a frame checksum");
+  }
+
+  self->max_pending = 0;
+  if (self->frame_hash != FRAME_CHECKSUM_NONE) {
+    if (n_threads == 0)
+      n_threads = g_get_num_processors ();
+
+    /* keep a few frames in flight per thread, to hide the ordering */
+    if (n_threads > 1) {
+      self->pool = g_thread_pool_new (frame_job_worker, self, n_threads,
+          FALSE, &error);
+      if (!self->pool) {
+        GST_WARNING_OBJECT (self, "Failed to create thread pool: %s",
+            error->message);
+        g_clear_error (&error);
+      } else {
+        self->max_pending = 2 * n_threads;
+      }
+    }
+  }
+
   if (file) {
     self->ostream = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE,
             G_FILE_CREATE_REPLACE_DESTINATION, NULL, &error));
@@ -166,6 +805,13 @@ gst_video_codec_test_sink_stop (GstBaseSink * sink)
 {
   GstVideoCodecTestSink *self = GST_VIDEO_CODEC_TEST_SINK (sink);
 
+  gst_video_codec_test_sink_finish_frames (self, 0);
+  if (self->pool) {
+    g_thread_pool_free (self->pool, FALSE, TRUE);
+    self->pool = NULL;
+  }
+  g_clear_pointer (&self->reference, g_ptr_array_unref);
+
   g_checksum_free (self->checksum);
   self->checksum = NULL;
 
@@ -190,7 +836,8 @@ gst_video_codec_test_sink_process_data (GstVideoCodecTestSink * self,
 {
   GError *error = NULL;
 
-  g_checksum_update (self->checksum, data, length);
+  if (self->do_stream_checksum)
+    g_checksum_update (self->checksum, data, length);
 
   if (!self->ostream)
     return GST_FLOW_OK;
@@ -290,15 +937,35 @@ static GstFlowReturn
 gst_video_codec_test_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
   GstVideoCodecTestSink *self = GST_VIDEO_CODEC_TEST_SINK (sink);
-  GstVideoFrame frame;
+  GstFlowReturn ret = GST_FLOW_OK;
+  FrameJob *job;
 
-  if (!gst_video_frame_map (&frame, &self->vinfo, buffer, GST_MAP_READ))
+  job = g_new0 (FrameJob, 1);
+  if (!gst_video_frame_map (&job->frame, &self->vinfo, buffer, GST_MAP_READ)) {
+    g_free (job);
     return GST_FLOW_ERROR;
+  }
+  job->number = self->n_frames++;
 
-  self->process (self, &frame);
+  /* the stream checksum and the raw file are sequential */
+  if (self->do_stream_checksum || self->ostream)
+    ret = self->process (self, &job->frame);
 
-  gst_video_frame_unmap (&frame);
-  return GST_FLOW_OK;
+  if (ret != GST_FLOW_OK || self->frame_hash == FRAME_CHECKSUM_NONE) {
+    frame_job_free (job);
+    return ret;
+  }
+
+  g_mutex_lock (&self->jobs_lock);
+  g_queue_push_tail (&self->jobs, job);
+  g_mutex_unlock (&self->jobs_lock);
+
+  if (self->pool)
+    g_thread_pool_push (self->pool, job, NULL);
+  else
+    frame_job_worker (job, self);
+
+  return gst_video_codec_test_sink_finish_frames (self, self->max_pending);
 }
 
 static gboolean
@@ -341,6 +1008,16 @@ gst_video_codec_test_sink_event (GstBaseSink * sink, GstEvent * event)
   if (event->type == GST_EVENT_EOS) {
     const gchar *checksum_type = "UNKNOWN";
 
+    if (gst_video_codec_test_sink_finish_frames (self, 0) == GST_FLOW_OK
+        && self->reference && self->n_frames < self->reference->len) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          ("Stream ended after %" G_GUINT64_FORMAT " frames, the reference "
+              "has %u frames", self->n_frames, self->reference->len), (NULL));
+    }
+
+    if (!self->do_stream_checksum)
+      return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
+
     switch (self->hash) {
       case G_CHECKSUM_MD5:
         checksum_type = "MD5";
@@ -378,6 +1055,13 @@ gst_video_codec_test_sink_init (GstVideoCodecTestSink * sink)
 {
   gst_base_sink_set_sync (GST_BASE_SINK (sink), FALSE);
   sink->hash = G_CHECKSUM_MD5;
+  sink->stream_checksum = DEFAULT_STREAM_CHECKSUM;
+  sink->frame_checksum = DEFAULT_FRAME_CHECKSUM;
+  sink->per_plane = DEFAULT_PER_PLANE;
+  sink->n_threads = DEFAULT_N_THREADS;
+  g_mutex_init (&sink->jobs_lock);
+  g_cond_init (&sink->jobs_cond);
+  g_queue_init (&sink->jobs);
 }
 
 static void
@@ -386,6 +1070,9 @@ gst_video_codec_test_sink_finalize (GObject * object)
   GstVideoCodecTestSink *self = GST_VIDEO_CODEC_TEST_SINK (object);
 
   g_free (self->location);
+  g_free (self->reference_location);
+  g_mutex_clear (&self->jobs_lock);
+  g_cond_clear (&self->jobs_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -419,8 +1106,81 @@ gst_video_codec_test_sink_class_init (GstVideoCodecTestSinkClass * klass)
           "File path to store non-padded I420 stream (optional).", NULL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstVideoCodecTestSink:stream-checksum:
+   *
+   * Compute the MD5 checksum of the whole stream, posted before EOS. This
+   * runs on the streaming thread; disable it when only frame checksums are
+   * needed.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_STREAM_CHECKSUM,
+      g_param_spec_boolean ("stream-checksum", "Stream checksum",
+          "Compute the checksum of the whole stream", DEFAULT_STREAM_CHECKSUM,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVideoCodecTestSink:frame-checksum:
+   *
+   * Checksum to compute for each frame, posted in frame order.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_FRAME_CHECKSUM,
+      g_param_spec_enum ("frame-checksum", "Frame checksum",
+          "Checksum to compute for each frame",
+          GST_TYPE_VIDEO_CODEC_TEST_SINK_FRAME_CHECKSUM, DEFAULT_FRAME_CHECKSUM,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVideoCodecTestSink:per-plane:
+   *
+   * Compute one frame checksum per plane instead of one for the whole
+   * frame.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_PER_PLANE,
+      g_param_spec_boolean ("per-plane", "Per plane",
+          "Compute the frame checksums per plane", DEFAULT_PER_PLANE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVideoCodecTestSink:n-threads:
+   *
+   * Frames are hashed concurrently on up to this many threads, 0 for one
+   * per processor. Checksums are still posted and compared in frame
+   * order.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads to use (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVideoCodecTestSink:reference:
+   *
+   * File path of the reference frame checksums to check the frame checksums
+   * against (optional).
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_REFERENCE,
+      g_param_spec_string ("reference", "Reference",
+          "File path of the reference frame checksums (optional).", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class,
       "Video CODEC Test Sink", "Debug/video/Sink",
       "Sink to test video CODEC conformance",
       "Nicolas Dufresne <nicolas.dufresne@collabora.com");
+
+  gst_type_mark_as_plugin_api (GST_TYPE_VIDEO_CODEC_TEST_SINK_FRAME_CHECKSUM,
+      0);
+
+  g_once (&crc64_once, crc64_init_table, NULL);
 }
@@ -82,6 +82,7 @@ GST_DEBUG_CATEGORY_STATIC (gst_field_analysis_debug);
 #define DEFAULT_BLOCK_HEIGHT 16
 #define DEFAULT_BLOCK_THRESH 80
 #define DEFAULT_IGNORED_LINES 2
+#define DEFAULT_N_THREADS 1
 
 enum
 {
@@ -96,7 +97,8 @@ enum
   PROP_BLOCK_WIDTH,
   PROP_BLOCK_HEIGHT,
   PROP_BLOCK_THRESH,
-  PROP_IGNORED_LINES
+  PROP_IGNORED_LINES,
+  PROP_N_THREADS
 };
 
 static GstStaticPadTemplate sink_factory =
@@ -280,6 +282,20 @@ gst_field_analysis_class_init (GstFieldAnalysisClass * klass)
           "Ignore this many lines from the top and bottom for windowed comb detection",
           2, G_MAXUINT64, DEFAULT_IGNORED_LINES,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFieldAnalysis:n-threads:
+   *
+   * How many threads compute the field difference and comb metrics of a
+   * frame, 0 for as many as there are processors. The metrics and the
+   * resulting decisions are identical whatever the value.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads to use (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_field_analysis_change_state);
@@ -306,12 +322,6 @@ static gfloat same_parity_3_tap (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2]);
 static gfloat opposite_parity_5_tap (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2]);
-static guint64 block_score_for_row_32detect (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
-static guint64 block_score_for_row_iscombed (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
-static guint64 block_score_for_row_5_tap (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
 static gfloat opposite_parity_windowed_comb (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2]);
 
@@ -336,8 +346,14 @@ gst_field_analysis_reset (GstFieldAnalysis * filter)
   gst_video_info_init (&filter->vinfo);
   g_free (filter->comb_mask);
   filter->comb_mask = NULL;
-  g_free (filter->block_scores);
-  filter->block_scores = NULL;
+  g_free (filter->comb_cols);
+  filter->comb_cols = NULL;
+  filter->scratch_width = 0;
+  filter->scratch_slices = 0;
+  g_free (filter->line_sums);
+  filter->line_sums = NULL;
+  filter->line_sums_len = 0;
+  gst_slice_runner_clear (&filter->slices);
 }
 
 static void
@@ -361,12 +377,13 @@ gst_field_analysis_init (GstFieldAnalysis * filter)
   filter->same_frame = &opposite_parity_5_tap;
   filter->frame_thresh = DEFAULT_FRAME_THRESH;
   filter->noise_floor = DEFAULT_NOISE_FLOOR;
-  filter->block_score_for_row = &block_score_for_row_5_tap;
+  filter->comb_line = &gst_field_analysis_comb_line_5_tap;
   filter->spatial_thresh = DEFAULT_SPATIAL_THRESH;
   filter->block_width = DEFAULT_BLOCK_WIDTH;
   filter->block_height = DEFAULT_BLOCK_HEIGHT;
   filter->block_thresh = DEFAULT_BLOCK_THRESH;
   filter->ignored_lines = DEFAULT_IGNORED_LINES;
+  filter->n_threads = DEFAULT_N_THREADS;
 }
 
 static void
@@ -415,13 +432,13 @@ gst_field_analysis_set_property (GObject * object, guint prop_id,
     case PROP_COMB_METHOD:
       switch (g_value_get_enum (value)) {
         case METHOD_32DETECT:
-          filter->block_score_for_row = &block_score_for_row_32detect;
+          filter->comb_line = &gst_field_analysis_comb_line_32detect;
           break;
         case METHOD_IS_COMBED:
-          filter->block_score_for_row = &block_score_for_row_iscombed;
+          filter->comb_line = &gst_field_analysis_comb_line_iscombed;
           break;
         case METHOD_5_TAP:
-          filter->block_score_for_row = &block_score_for_row_5_tap;
+          filter->comb_line = &gst_field_analysis_comb_line_5_tap;
           break;
         default:
           break;
@@ -432,18 +449,6 @@ gst_field_analysis_set_property (GObject * object, guint prop_id,
       break;
     case PROP_BLOCK_WIDTH:
       filter->block_width = g_value_get_uint64 (value);
-      if (GST_VIDEO_FRAME_WIDTH (&filter->frames[0].frame)) {
-        const gint frame_width =
-            GST_VIDEO_FRAME_WIDTH (&filter->frames[0].frame);
-        if (filter->block_scores) {
-          gsize nbytes = (frame_width / filter->block_width) * sizeof (guint);
-          filter->block_scores = g_realloc (filter->block_scores, nbytes);
-          memset (filter->block_scores, 0, nbytes);
-        } else {
-          filter->block_scores =
-              g_malloc0 ((frame_width / filter->block_width) * sizeof (guint));
-        }
-      }
       break;
     case PROP_BLOCK_HEIGHT:
       filter->block_height = g_value_get_uint64 (value);
@@ -454,6 +459,11 @@ gst_field_analysis_set_property (GObject * object, guint prop_id,
     case PROP_IGNORED_LINES:
       filter->ignored_lines = g_value_get_uint64 (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (filter);
+      filter->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -503,11 +513,11 @@ gst_field_analysis_get_property (GObject * object, guint prop_id,
     case PROP_COMB_METHOD:
     {
       FieldAnalysisCombMethod method = DEFAULT_COMB_METHOD;
-      if (filter->block_score_for_row == &block_score_for_row_32detect) {
+      if (filter->comb_line == &gst_field_analysis_comb_line_32detect) {
         method = METHOD_32DETECT;
-      } else if (filter->block_score_for_row == &block_score_for_row_iscombed) {
+      } else if (filter->comb_line == &gst_field_analysis_comb_line_iscombed) {
         method = METHOD_IS_COMBED;
-      } else if (filter->block_score_for_row == &block_score_for_row_5_tap) {
+      } else if (filter->comb_line == &gst_field_analysis_comb_line_5_tap) {
         method = METHOD_5_TAP;
       }
       g_value_set_enum (value, method);
@@ -528,6 +538,11 @@ gst_field_analysis_get_property (GObject * object, guint prop_id,
     case PROP_IGNORED_LINES:
       g_value_set_uint64 (value, filter->ignored_lines);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->n_threads);
+      GST_OBJECT_UNLOCK (filter);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -537,7 +552,6 @@ gst_field_analysis_get_property (GObject * object, guint prop_id,
 static void
 gst_field_analysis_update_format (GstFieldAnalysis * filter, GstCaps * caps)
 {
-  gint width;
   GQueue *outbufs;
   GstVideoInfo vinfo;
 
@@ -574,22 +588,8 @@ gst_field_analysis_update_format (GstFieldAnalysis * filter, GstCaps * caps)
   filter->flushing = FALSE;
 
   filter->vinfo = vinfo;
-  width = GST_VIDEO_INFO_WIDTH (&filter->vinfo);
 
-  /* update allocations for metric scores */
-  if (filter->comb_mask) {
-    filter->comb_mask = g_realloc (filter->comb_mask, width);
-  } else {
-    filter->comb_mask = g_malloc (width);
-  }
-  if (filter->block_scores) {
-    gsize nbytes = (width / filter->block_width) * sizeof (guint);
-    filter->block_scores = g_realloc (filter->block_scores, nbytes);
-    memset (filter->block_scores, 0, nbytes);
-  } else {
-    filter->block_scores =
-        g_malloc0 ((width / filter->block_width) * sizeof (guint));
-  }
+  /* the metric scratch buffers are resized when first used */
 
   GST_OBJECT_UNLOCK (filter);
   return;
@@ -811,520 +811,367 @@ gst_field_analysis_sink_event (GstPad * pad, GstObject * parent,
 }
 
 
+/* the metrics below split their work into slices of lines (or rows of blocks)
+ * which are processed on the slice runner. per-line results are stored and
+ * then summed in line order on the streaming thread so that results are
+ * bit-exact with sequential processing, independent of the number of
+ * threads */
+static void
+gst_field_analysis_update_slices (GstFieldAnalysis * filter)
+{
+  GError *err = NULL;
+  guint n_threads;
+
+  GST_OBJECT_LOCK (filter);
+  n_threads = filter->n_threads;
+  GST_OBJECT_UNLOCK (filter);
+
+  if (!gst_slice_runner_set_n_threads (&filter->slices, n_threads, &err)) {
+    GST_WARNING_OBJECT (filter, "Failed to create slice thread pool: %s",
+        err->message);
+    g_clear_error (&err);
+  }
+}
+
+static guint32 *
+gst_field_analysis_get_line_sums (GstFieldAnalysis * filter, gsize n)
+{
+  if (filter->line_sums_len < n) {
+    filter->line_sums = g_renew (guint32, filter->line_sums, n);
+    filter->line_sums_len = n;
+  }
+  return filter->line_sums;
+}
+
+/* accumulate the per-line results in line order so that the floating point
+ * sum does not depend on how the lines were split into slices */
 static gfloat
-same_parity_sad (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+gst_field_analysis_sum_lines (GstFieldAnalysis * filter, gsize n)
 {
-  gint j;
-  gfloat sum;
-  guint8 *f1j, *f2j;
+  gsize i;
+  gfloat sum = 0.0f;
+
+  for (i = 0; i < n; i++)
+    sum += filter->line_sums[i];
+
+  return sum;
+}
+
+/* line j of the field with the given parity, with j == 0 being the first line
+ * of that field */
+static inline guint8 *
+field_analysis_field_line (FieldAnalysisFields * field, guint j)
+{
+  return GST_VIDEO_FRAME_COMP_DATA (&field->frame, 0) +
+      GST_VIDEO_FRAME_COMP_OFFSET (&field->frame, 0) +
+      (field->parity + 2 * (gsize) j) *
+      GST_VIDEO_FRAME_COMP_STRIDE (&field->frame, 0);
+}
+
+typedef void (*FieldAnalysisSameParityLineFunc) (guint32 * sum,
+    const guint8 * s1, const guint8 * s2, int noise_floor, int n);
 
+typedef struct
+{
+  GstFieldAnalysis *filter;
+  FieldAnalysisFields (*history)[2];
+  FieldAnalysisSameParityLineFunc line_func;
+  guint n_lines;
+  guint32 noise_floor;
+} FieldAnalysisMetricJob;
+
+static void
+same_parity_diff_slice (gpointer data, guint slice, guint n_slices)
+{
+  FieldAnalysisMetricJob *job = data;
+  FieldAnalysisFields (*history)[2] = job->history;
+  guint32 *line_sums = job->filter->line_sums;
+  const guint start = GST_SLICE_START (job->n_lines, slice, n_slices);
+  const guint end = GST_SLICE_END (job->n_lines, slice, n_slices);
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
-  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
   const gint stride0x2 =
       GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
   const gint stride1x2 =
       GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
-  const guint32 noise_floor = filter->noise_floor;
+  guint8 *f1j, *f2j;
+  guint j;
 
-  f1j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-      0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
+  f1j = field_analysis_field_line (&(*history)[0], start);
+  f2j = field_analysis_field_line (&(*history)[1], start);
 
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
+  for (j = start; j < end; j++) {
     guint32 tempsum = 0;
-    fieldanalysis_orc_same_parity_sad_planar_yuv (&tempsum, f1j, f2j,
-        noise_floor, width);
-    sum += tempsum;
+    job->line_func (&tempsum, f1j, f2j, job->noise_floor, width);
+    line_sums[j] = tempsum;
     f1j += stride0x2;
     f2j += stride1x2;
   }
-
-  return sum / (0.5f * width * height);
 }
 
 static gfloat
-same_parity_ssd (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+same_parity_sad (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
 {
-  gint j;
-  gfloat sum;
-  guint8 *f1j, *f2j;
+  FieldAnalysisMetricJob job;
 
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride0x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const gint stride1x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
-  /* noise floor needs to be squared for SSD */
-  const guint32 noise_floor = filter->noise_floor * filter->noise_floor;
 
-  f1j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-      0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
+  job.filter = filter;
+  job.history = history;
+  job.line_func = fieldanalysis_orc_same_parity_sad_planar_yuv;
+  job.n_lines = height >> 1;
+  job.noise_floor = filter->noise_floor;
 
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
-    guint32 tempsum = 0;
-    fieldanalysis_orc_same_parity_ssd_planar_yuv (&tempsum, f1j, f2j,
-        noise_floor, width);
-    sum += tempsum;
-    f1j += stride0x2;
-    f2j += stride1x2;
-  }
+  gst_field_analysis_get_line_sums (filter, job.n_lines);
+  gst_slice_runner_run (&filter->slices, job.n_lines, same_parity_diff_slice,
+      &job);
 
-  return sum / (0.5f * width * height); /* field is half height */
+  return gst_field_analysis_sum_lines (filter,
+      job.n_lines) / (0.5f * width * height);
 }
 
-/* horizontal [1,4,1] diff between fields - is this a good idea or should the
- * current sample be emphasised more or less? */
 static gfloat
-same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+same_parity_ssd (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
 {
-  gint i, j;
-  gfloat sum;
-  guint8 *f1j, *f2j;
+  FieldAnalysisMetricJob job;
 
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
+
+  job.filter = filter;
+  job.history = history;
+  job.line_func = fieldanalysis_orc_same_parity_ssd_planar_yuv;
+  job.n_lines = height >> 1;
+  /* noise floor needs to be squared for SSD */
+  job.noise_floor = filter->noise_floor * filter->noise_floor;
+
+  gst_field_analysis_get_line_sums (filter, job.n_lines);
+  gst_slice_runner_run (&filter->slices, job.n_lines, same_parity_diff_slice,
+      &job);
+
+  return gst_field_analysis_sum_lines (filter, job.n_lines) / (0.5f * width * height);       /* field is half height */
+}
+
+/* stores three results per line: the left edge, the body and the right edge,
+ * which is the order in which they were summed before slicing */
+static void
+same_parity_3_tap_slice (gpointer data, guint slice, guint n_slices)
+{
+  FieldAnalysisMetricJob *job = data;
+  FieldAnalysisFields (*history)[2] = job->history;
+  guint32 *line_sums = job->filter->line_sums;
+  const guint start = GST_SLICE_START (job->n_lines, slice, n_slices);
+  const guint end = GST_SLICE_END (job->n_lines, slice, n_slices);
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint stride0x2 =
       GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
   const gint stride1x2 =
       GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
   const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
-  /* noise floor needs to be *6 for [1,4,1] */
-  const guint32 noise_floor = filter->noise_floor * 6;
+  const guint32 noise_floor = job->noise_floor;
+  guint8 *f1j, *f2j;
+  guint j;
 
-  f1j = GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame, 0) +
-      GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame, 0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
+  f1j = field_analysis_field_line (&(*history)[0], start);
+  f2j = field_analysis_field_line (&(*history)[1], start);
 
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
+  for (j = start; j < end; j++) {
     guint32 tempsum = 0;
     guint32 diff;
+    gint i;
 
     /* unroll first as it is a special case */
     diff = abs (((f1j[0] << 2) + (f1j[incr] << 1))
         - ((f2j[0] << 2) + (f2j[incr] << 1)));
-    if (diff > noise_floor)
-      sum += diff;
+    line_sums[3 * j] = diff > noise_floor ? diff : 0;
 
     fieldanalysis_orc_same_parity_3_tap_planar_yuv (&tempsum, f1j, &f1j[incr],
         &f1j[incr << 1], f2j, &f2j[incr], &f2j[incr << 1], noise_floor,
         width - 1);
-    sum += tempsum;
+    line_sums[3 * j + 1] = tempsum;
 
     /* unroll last as it is a special case */
     i = width - 1;
     diff = abs (((f1j[i - incr] << 1) + (f1j[i] << 2))
         - ((f2j[i - incr] << 1) + (f2j[i] << 2)));
-    if (diff > noise_floor)
-      sum += diff;
+    line_sums[3 * j + 2] = diff > noise_floor ? diff : 0;
 
     f1j += stride0x2;
     f2j += stride1x2;
   }
-
-  return sum / ((6.0f / 2.0f) * width * height);        /* 1 + 4 + 1 = 6; field is half height */
 }
 
-/* vertical [1,-3,4,-3,1] - same as is used in FieldDiff from TIVTC,
- * tritical's AVISynth IVTC filter */
-/* 0th field's parity defines operation */
+/* horizontal [1,4,1] diff between fields - is this a good idea or should the
+ * current sample be emphasised more or less? */
 static gfloat
-opposite_parity_5_tap (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2])
+same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
 {
-  gint j;
-  gfloat sum;
-  guint8 *fjm2, *fjm1, *fj, *fjp1, *fjp2;
-  guint32 tempsum;
+  FieldAnalysisMetricJob job;
 
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride0x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const gint stride1x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
-  /* noise floor needs to be *6 for [1,-3,4,-3,1] */
-  const guint32 noise_floor = filter->noise_floor * 6;
-
-  sum = 0.0f;
-
-  /* fj is line j of the combined frame made from the top field even lines of
-   *   field 0 and the bottom field odd lines from field 1
-   * fjp1 is one line down from fj
-   * fjm2 is two lines up from fj
-   * fj with j == 0 is the 0th line of the top field
-   * fj with j == 1 is the 0th line of the bottom field or the 1st field of
-   *   the frame*/
 
-  /* unroll first line as it is a special case */
-  if ((*history)[0].parity == TOP_FIELD) {
-    fj = GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame, 0);
-    fjp1 =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0);
-    fjp2 = fj + stride0x2;
-  } else {
-    fj = GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame, 0);
-    fjp1 =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
-    fjp2 = fj + stride1x2;
-  }
-
-  tempsum = 0;
-  fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjp2, fjp1, fj,
-      fjp1, fjp2, noise_floor, width);
-  sum += tempsum;
-
-  for (j = 1; j < (height >> 1) - 1; j++) {
-    /* shift everything down a line in the field of interest (means += stridex2) */
-    fjm2 = fj;
-    fjm1 = fjp1;
-    fj = fjp2;
-    if ((*history)[0].parity == TOP_FIELD) {
-      fjp1 += stride1x2;
-      fjp2 += stride0x2;
-    } else {
-      fjp1 += stride0x2;
-      fjp2 += stride1x2;
-    }
-
-    tempsum = 0;
-    fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjm2, fjm1,
-        fj, fjp1, fjp2, noise_floor, width);
-    sum += tempsum;
-  }
-
-  /* unroll the last line as it is a special case */
-  /* shift everything down a line in the field of interest (means += stridex2) */
-  fjm2 = fj;
-  fjm1 = fjp1;
-  fj = fjp2;
+  job.filter = filter;
+  job.history = history;
+  job.line_func = NULL;
+  job.n_lines = height >> 1;
+  /* noise floor needs to be *6 for [1,4,1] */
+  job.noise_floor = filter->noise_floor * 6;
 
-  tempsum = 0;
-  fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjm2, fjm1, fj,
-      fjm1, fjm2, noise_floor, width);
-  sum += tempsum;
+  gst_field_analysis_get_line_sums (filter, 3 * job.n_lines);
+  gst_slice_runner_run (&filter->slices, job.n_lines, same_parity_3_tap_slice,
+      &job);
 
-  return sum / ((6.0f / 2.0f) * width * height);        /* 1 + 4 + 1 == 3 + 3 == 6; field is half height */
+  return gst_field_analysis_sum_lines (filter, 3 * job.n_lines) / ((6.0f / 2.0f) * width * height);  /* 1 + 4 + 1 = 6; field is half height */
 }
 
-/* this metric was sourced from HandBrake but originally from transcode
- * the return value is the highest block score for the row of blocks */
-static inline guint64
-block_score_for_row_32detect (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+/* fj is line j of the combined frame made from the even lines of field a
+ * (the top field of frame 0 or the top field of frame 1 depending on the
+ * parity of field 0) and the odd lines of field b, the other frame
+ * fjp1 is one line down from fj
+ * fjm2 is two lines up from fj
+ * the first and last lines mirror the missing lines */
+typedef struct
 {
-  guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
-  guint64 block_score;
-  guint8 *fjm2, *fjm1, *fj, *fjp1;
-  const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
-  const gint stridex2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const guint64 block_width = filter->block_width;
-  const guint64 block_height = filter->block_height;
-  const gint64 spatial_thresh = filter->spatial_thresh;
-  const gint width =
-      GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
-      (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
-
-  fjm2 = base_fj - stridex2;
-  fjm1 = base_fjp1 - stridex2;
-  fj = base_fj;
-  fjp1 = base_fjp1;
-
-  for (j = 0; j < block_height; j++) {
-    /* we have to work one result ahead of ourselves which results in some small
-     * peculiarities below */
-    gint diff1, diff2;
-
-    diff1 = fj[0] - fjm1[0];
-    diff2 = fj[0] - fjp1[0];
-    /* change in the same direction */
-    if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-        || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-      comb_mask[0] = abs (fj[0] - fjm2[0]) < 10 && abs (fj[0] - fjm1[0]) > 15;
-    } else {
-      comb_mask[0] = FALSE;
-    }
-
-    for (i = 1; i < width; i++) {
-      const guint64 idx = i * incr;
-      const guint64 res_idx = (i - 1) / block_width;
+  GstFieldAnalysis *filter;
+  guint8 *base_a, *base_b;
+  gint stride_ax2, stride_bx2;
+  gint width;
+  guint n_lines;
+  guint32 noise_floor;
+} FieldAnalysisOppositeParityJob;
 
-      diff1 = fj[idx] - fjm1[idx];
-      diff2 = fj[idx] - fjp1[idx];
-      if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-          || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-        comb_mask[i] = abs (fj[idx] - fjm2[idx]) < 10
-            && abs (fj[idx] - fjm1[idx]) > 15;
-      } else {
-        comb_mask[i] = FALSE;
-      }
+static void
+opposite_parity_5_tap_slice (gpointer data, guint slice, guint n_slices)
+{
+  FieldAnalysisOppositeParityJob *job = data;
+  guint32 *line_sums = job->filter->line_sums;
+  const guint start = GST_SLICE_START (job->n_lines, slice, n_slices);
+  const guint end = GST_SLICE_END (job->n_lines, slice, n_slices);
+  const guint last = job->n_lines - 1;
+  guint j;
+
+  for (j = start; j < end; j++) {
+    guint8 *fj = job->base_a + (gssize) j * job->stride_ax2;
+    guint8 *fjp1 = job->base_b + (gssize) j * job->stride_bx2;
+    guint8 *fjp2 = fj + job->stride_ax2;
+    guint8 *fjm1 = fjp1 - job->stride_bx2;
+    guint8 *fjm2 = fj - job->stride_ax2;
+    guint32 tempsum = 0;
 
-      if (i == 1 && comb_mask[i - 1] && comb_mask[i]) {
-        /* left edge */
-        block_scores[res_idx]++;
-      } else if (i == width - 1) {
-        /* right edge */
-        if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
-          block_scores[res_idx]++;
-        if (comb_mask[i - 1] && comb_mask[i])
-          block_scores[i / block_width]++;
-      } else if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i]) {
-        block_scores[res_idx]++;
-      }
+    if (j == 0) {
+      fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjp2, fjp1,
+          fj, fjp1, fjp2, job->noise_floor, job->width);
+    } else if (j == last) {
+      fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjm2, fjm1,
+          fj, fjm1, fjm2, job->noise_floor, job->width);
+    } else {
+      fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjm2, fjm1,
+          fj, fjp1, fjp2, job->noise_floor, job->width);
     }
-    /* advance down a line */
-    fjm2 = fjm1;
-    fjm1 = fj;
-    fj = fjp1;
-    fjp1 = fjm1 + stridex2;
-  }
-
-  block_score = 0;
-  for (i = 0; i < width / block_width; i++) {
-    if (block_scores[i] > block_score)
-      block_score = block_scores[i];
+    line_sums[j] = tempsum;
   }
-
-  g_free (block_scores);
-  g_free (comb_mask);
-  return block_score;
 }
 
-/* this metric was sourced from HandBrake but originally from
- * tritical's isCombedT Avisynth function
- * the return value is the highest block score for the row of blocks */
-static inline guint64
-block_score_for_row_iscombed (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+/* vertical [1,-3,4,-3,1] - same as is used in FieldDiff from TIVTC,
+ * tritical's AVISynth IVTC filter */
+/* 0th field's parity defines operation */
+static gfloat
+opposite_parity_5_tap (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2])
 {
-  guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
-  guint64 block_score;
-  guint8 *fjm1, *fj, *fjp1;
-  const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
-  const gint stridex2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const guint64 block_width = filter->block_width;
-  const guint64 block_height = filter->block_height;
-  const gint64 spatial_thresh = filter->spatial_thresh;
-  const gint64 spatial_thresh_squared = spatial_thresh * spatial_thresh;
-  const gint width =
-      GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
-      (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
-
-  fjm1 = base_fjp1 - stridex2;
-  fj = base_fj;
-  fjp1 = base_fjp1;
-
-  for (j = 0; j < block_height; j++) {
-    /* we have to work one result ahead of ourselves which results in some small
-     * peculiarities below */
-    gint diff1, diff2;
-
-    diff1 = fj[0] - fjm1[0];
-    diff2 = fj[0] - fjp1[0];
-    /* change in the same direction */
-    if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-        || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-      comb_mask[0] =
-          (fjm1[0] - fj[0]) * (fjp1[0] - fj[0]) > spatial_thresh_squared;
-    } else {
-      comb_mask[0] = FALSE;
-    }
+  FieldAnalysisOppositeParityJob job;
+  GstVideoFrame *frame_a, *frame_b;
 
-    for (i = 1; i < width; i++) {
-      const guint64 idx = i * incr;
-      const guint64 res_idx = (i - 1) / block_width;
-
-      diff1 = fj[idx] - fjm1[idx];
-      diff2 = fj[idx] - fjp1[idx];
-      if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-          || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-        comb_mask[i] =
-            (fjm1[idx] - fj[idx]) * (fjp1[idx] - fj[idx]) >
-            spatial_thresh_squared;
-      } else {
-        comb_mask[i] = FALSE;
-      }
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
 
-      if (i == 1 && comb_mask[i - 1] && comb_mask[i]) {
-        /* left edge */
-        block_scores[res_idx]++;
-      } else if (i == width - 1) {
-        /* right edge */
-        if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
-          block_scores[res_idx]++;
-        if (comb_mask[i - 1] && comb_mask[i])
-          block_scores[i / block_width]++;
-      } else if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i]) {
-        block_scores[res_idx]++;
-      }
-    }
-    /* advance down a line */
-    fjm1 = fj;
-    fj = fjp1;
-    fjp1 = fjm1 + stridex2;
+  if ((*history)[0].parity == TOP_FIELD) {
+    frame_a = &(*history)[0].frame;
+    frame_b = &(*history)[1].frame;
+  } else {
+    frame_a = &(*history)[1].frame;
+    frame_b = &(*history)[0].frame;
   }
 
-  block_score = 0;
-  for (i = 0; i < width / block_width; i++) {
-    if (block_scores[i] > block_score)
-      block_score = block_scores[i];
-  }
+  job.filter = filter;
+  job.base_a = GST_VIDEO_FRAME_COMP_DATA (frame_a, 0) +
+      GST_VIDEO_FRAME_COMP_OFFSET (frame_a, 0);
+  job.base_b = GST_VIDEO_FRAME_COMP_DATA (frame_b, 0) +
+      GST_VIDEO_FRAME_COMP_OFFSET (frame_b, 0) +
+      GST_VIDEO_FRAME_COMP_STRIDE (frame_b, 0);
+  job.stride_ax2 = GST_VIDEO_FRAME_COMP_STRIDE (frame_a, 0) << 1;
+  job.stride_bx2 = GST_VIDEO_FRAME_COMP_STRIDE (frame_b, 0) << 1;
+  job.width = width;
+  /* the first and the last line are always processed */
+  job.n_lines = MAX (height >> 1, 2);
+  /* noise floor needs to be *6 for [1,-3,4,-3,1] */
+  job.noise_floor = filter->noise_floor * 6;
+
+  gst_field_analysis_get_line_sums (filter, job.n_lines);
+  gst_slice_runner_run (&filter->slices, job.n_lines,
+      opposite_parity_5_tap_slice, &job);
 
-  g_free (block_scores);
-  g_free (comb_mask);
-  return block_score;
+  return gst_field_analysis_sum_lines (filter, job.n_lines) / ((6.0f / 2.0f) * width * height);      /* 1 + 4 + 1 == 3 + 3 == 6; field is half height */
 }
 
-/* this metric was sourced from HandBrake but originally from
- * tritical's isCombedT Avisynth function
- * the return value is the highest block score for the row of blocks */
-static inline guint64
-block_score_for_row_5_tap (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+enum
 {
-  guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
-  guint64 block_score;
-  guint8 *fjm2, *fjm1, *fj, *fjp1, *fjp2;
-  const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
-  const gint stridex2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const guint64 block_width = filter->block_width;
+  COMB_NONE,
+  COMB_SLIGHT,
+  COMB_FULL
+};
+
+typedef struct
+{
+  GstFieldAnalysis *filter;
+  FieldAnalysisFields (*history)[2];
+  guint8 *base_fj, *base_fjp1;
+  guint n_rows;
+  gint combed;
+} FieldAnalysisCombJob;
+
+static void
+opposite_parity_windowed_comb_slice (gpointer data, guint slice,
+    guint n_slices)
+{
+  FieldAnalysisCombJob *job = data;
+  GstFieldAnalysis *filter = job->filter;
+  const guint start = GST_SLICE_START (job->n_rows, slice, n_slices);
+  const guint end = GST_SLICE_END (job->n_rows, slice, n_slices);
+  const gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&(*job->history)[0].frame,
+      0);
+  const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*job->history)[0].frame,
+      0);
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*job->history)[0].frame);
+  const guint64 block_thresh = filter->block_thresh;
   const guint64 block_height = filter->block_height;
-  const gint64 spatial_thresh = filter->spatial_thresh;
-  const gint64 spatial_threshx6 = 6 * spatial_thresh;
-  const gint width =
-      GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
-      (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
-
-
-  fjm2 = base_fj - stridex2;
-  fjm1 = base_fjp1 - stridex2;
-  fj = base_fj;
-  fjp1 = base_fjp1;
-  fjp2 = fj + stridex2;
-
-  for (j = 0; j < block_height; j++) {
-    /* we have to work one result ahead of ourselves which results in some small
-     * peculiarities below */
-    gint diff1, diff2;
-
-    diff1 = fj[0] - fjm1[0];
-    diff2 = fj[0] - fjp1[0];
-    /* change in the same direction */
-    if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-        || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-      comb_mask[0] =
-          abs (fjm2[0] + (fj[0] << 2) + fjp2[0] - 3 * (fjm1[0] + fjp1[0])) >
-          spatial_threshx6;
-
-      /* motion detection that needs previous and next frames
-         this isn't really necessary, but acts as an optimisation if the
-         additional delay isn't a problem
-         if (motion_detection) {
-         if (abs(fpj[idx] - fj[idx]               ) > motion_thresh &&
-         abs(           fjm1[idx] - fnjm1[idx]) > motion_thresh &&
-         abs(           fjp1[idx] - fnjp1[idx]) > motion_thresh)
-         motion++;
-         if (abs(             fj[idx]   - fnj[idx]) > motion_thresh &&
-         abs(fpjm1[idx] - fjm1[idx]           ) > motion_thresh &&
-         abs(fpjp1[idx] - fjp1[idx]           ) > motion_thresh)
-         motion++;
-         } else {
-         motion = 1;
-         }
-       */
-    } else {
-      comb_mask[0] = FALSE;
-    }
+  guint8 *comb_mask = filter->comb_mask + slice * filter->scratch_width;
+  guint *comb_cols = filter->comb_cols + slice * (filter->scratch_width + 1);
+  guint r;
 
-    for (i = 1; i < width; i++) {
-      const guint64 idx = i * incr;
-      const guint64 res_idx = (i - 1) / block_width;
-
-      diff1 = fj[idx] - fjm1[idx];
-      diff2 = fj[idx] - fjp1[idx];
-      if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-          || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-        comb_mask[i] =
-            abs (fjm2[idx] + (fj[idx] << 2) + fjp2[idx] - 3 * (fjm1[idx] +
-                fjp1[idx])) > spatial_threshx6;
-      } else {
-        comb_mask[i] = FALSE;
-      }
+  for (r = start; r < end; r++) {
+    guint64 line_offset, block_score;
 
-      if (i == 1 && comb_mask[i - 1] && comb_mask[i]) {
-        /* left edge */
-        block_scores[res_idx]++;
-      } else if (i == width - 1) {
-        /* right edge */
-        if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
-          block_scores[res_idx]++;
-        if (comb_mask[i - 1] && comb_mask[i])
-          block_scores[i / block_width]++;
-      } else if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i]) {
-        block_scores[res_idx]++;
-      }
-    }
-    /* advance down a line */
-    fjm2 = fjm1;
-    fjm1 = fj;
-    fj = fjp1;
-    fjp1 = fjp2;
-    fjp2 = fj + stridex2;
-  }
+    /* another slice already found a combed block, no need to continue */
+    if (g_atomic_int_get (&job->combed) == COMB_FULL)
+      return;
 
-  block_score = 0;
-  for (i = 0; i < width / block_width; i++) {
-    if (block_scores[i] > block_score)
-      block_score = block_scores[i];
-  }
+    line_offset = (filter->ignored_lines + r * block_height) * stride;
+    block_score = gst_field_analysis_block_score_for_row (filter->comb_line,
+        job->base_fj + line_offset, job->base_fjp1 + line_offset, incr, stride,
+        width, filter->block_width, block_height, filter->spatial_thresh,
+        comb_mask, comb_cols);
 
-  g_free (block_scores);
-  g_free (comb_mask);
-  return block_score;
+    if (block_score > (block_thresh >> 1)
+        && block_score <= block_thresh) {
+      /* blend if nothing more combed comes along */
+      g_atomic_int_compare_and_exchange (&job->combed, COMB_NONE, COMB_SLIGHT);
+    } else if (block_score > block_thresh) {
+      g_atomic_int_set (&job->combed, COMB_FULL);
+      return;
+    }
+  }
 }
 
 /* a pass is made over the field using one of three comb-detection metrics
@@ -1340,57 +1187,66 @@ static gfloat
 opposite_parity_windowed_comb (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2])
 {
-  gint j;
-  gboolean slightly_combed;
+  FieldAnalysisCombJob job;
+  gsize n_scratch;
 
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
-  const guint64 block_thresh = filter->block_thresh;
   const guint64 block_height = filter->block_height;
-  guint8 *base_fj, *base_fjp1;
 
   if ((*history)[0].parity == TOP_FIELD) {
-    base_fj =
+    job.base_fj =
         GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
         0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame, 0);
-    base_fjp1 =
+    job.base_fjp1 =
         GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
         0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
         0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0);
   } else {
-    base_fj =
+    job.base_fj =
         GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
         0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame, 0);
-    base_fjp1 =
+    job.base_fjp1 =
         GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
         0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
         0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
   }
 
-  /* we operate on a row of blocks of height block_height through each iteration */
-  slightly_combed = FALSE;
-  for (j = 0; j <= height - filter->ignored_lines - block_height;
-      j += block_height) {
-    guint64 line_offset = (filter->ignored_lines + j) * stride;
-    guint block_score =
-        filter->block_score_for_row (filter, history, base_fj + line_offset,
-        base_fjp1 + line_offset);
+  /* we operate on a row of blocks of height block_height per item */
+  if (block_height == 0 || height < filter->ignored_lines + block_height)
+    job.n_rows = 0;
+  else
+    job.n_rows = (height - filter->ignored_lines - block_height) /
+        block_height + 1;
+
+  /* each slice needs its own comb mask line and column counters */
+  n_scratch = MAX (filter->slices.n_slices, 1);
+  if (filter->scratch_width != width || filter->scratch_slices < n_scratch) {
+    g_free (filter->comb_mask);
+    g_free (filter->comb_cols);
+    filter->comb_mask = g_malloc (n_scratch * width);
+    filter->comb_cols = g_new (guint, n_scratch * (width + 1));
+    filter->scratch_width = width;
+    filter->scratch_slices = n_scratch;
+  }
 
-    if (block_score > (block_thresh >> 1)
-        && block_score <= block_thresh) {
-      /* blend if nothing more combed comes along */
-      slightly_combed = TRUE;
-    } else if (block_score > block_thresh) {
-      if (GST_VIDEO_INFO_INTERLACE_MODE (&(*history)[0].frame.info) ==
-          GST_VIDEO_INTERLACE_MODE_INTERLEAVED) {
-        return 1.0f;            /* blend */
-      } else {
-        return 2.0f;            /* deinterlace */
-      }
+  job.filter = filter;
+  job.history = history;
+  job.combed = COMB_NONE;
+
+  gst_slice_runner_run (&filter->slices, job.n_rows,
+      opposite_parity_windowed_comb_slice, &job);
+
+  if (job.combed == COMB_FULL) {
+    if (GST_VIDEO_INFO_INTERLACE_MODE (&(*history)[0].frame.info) ==
+        GST_VIDEO_INTERLACE_MODE_INTERLEAVED) {
+      return 1.0f;              /* blend */
+    } else {
+      return 2.0f;              /* deinterlace */
     }
   }
 
-  return (gfloat) slightly_combed;      /* TRUE means blend, else don't */
+  return (gfloat) (job.combed == COMB_SLIGHT);  /* TRUE means blend, else don't */
 }
 
 /* this is where the magic happens
@@ -1425,6 +1281,8 @@ gst_field_analysis_process_buffer (GstFieldAnalysis * filter,
   FieldAnalysisFields history[2];
   GstBuffer *outbuf = NULL;
 
+  gst_field_analysis_update_slices (filter);
+
   /* move previous result to index 1 */
   filter->frames[1] = filter->frames[0];
 
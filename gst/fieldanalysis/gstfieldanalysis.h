@@ -45,6 +45,9 @@
 #define __GST_FIELDANALYSIS_H__
 
 #include <gst/gst.h>
+#include <gst/slice-runner-private.h>
+
+#include "gstfieldanalysiscomb.h"
 
 G_BEGIN_DECLS
 #define GST_TYPE_FIELDANALYSIS \
@@ -119,14 +122,21 @@ struct _GstFieldAnalysis
   GstVideoInfo vinfo;
   gfloat (*same_field) (GstFieldAnalysis *, FieldAnalysisFields (*)[2]);
   gfloat (*same_frame) (GstFieldAnalysis *, FieldAnalysisFields (*)[2]);
-  guint64 (*block_score_for_row) (GstFieldAnalysis *, FieldAnalysisFields (*)[2], guint8 *, guint8 *);
+  FieldAnalysisCombLineFunc comb_line;
   gboolean is_telecine;
   gboolean first_buffer; /* indicates the first buffer for which a buffer will be output
                           * after a discont or flushing seek */
-  guint8 *comb_mask;
-  guint *block_scores;
   gboolean flushing;     /* indicates whether we are flushing or not */
 
+  /* slice threading */
+  GstSliceRunner slices;
+  guint8 *comb_mask;     /* n_slices lines of width bytes */
+  guint *comb_cols;      /* n_slices lines of width + 1 column counters */
+  gsize scratch_width;   /* width the comb scratch buffers are sized for */
+  gsize scratch_slices;  /* slices the comb scratch buffers are sized for */
+  guint32 *line_sums;    /* per-line metric results, summed in line order */
+  gsize line_sums_len;
+
   /* properties */
   guint32 noise_floor; /* threshold for the result of a metric to be valid */
   gfloat field_thresh; /* threshold used for the same parity field metric */
@@ -135,6 +145,7 @@ struct _GstFieldAnalysis
   guint64 block_width, block_height; /* width/height of window used for comb clusted detection */
   guint64 block_thresh;
   guint64 ignored_lines;
+  guint n_threads;
 };
 
 struct _GstFieldAnalysisClass
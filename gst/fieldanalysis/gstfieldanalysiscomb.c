@@ -0,0 +1,194 @@
+/*
+ * GStreamer
+ * Copyright (C) 2011 Robert Swain <robert.swain@collabora.co.uk>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* comb detection kernels of the windowed comb metric, kept apart from the
+ * element so that they can be checked against the reference
+ * implementations */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gstfieldanalysiscomb.h"
+
+/* the comb mask line functions are written without branches in the inner loop
+ * so that the compiler can vectorise them. the spatial threshold is clamped
+ * to 255 by the caller which does not change any decision as differences
+ * between 8-bit samples cannot exceed it, but keeps all intermediates in
+ * 32-bit integers */
+
+/* this metric was sourced from HandBrake but originally from transcode */
+void
+gst_field_analysis_comb_line_32detect (guint8 * mask, const guint8 * fjm2,
+    const guint8 * fjm1, const guint8 * fj, const guint8 * fjp1,
+    const guint8 * fjp2, gint incr, gint width, gint spatial_thresh)
+{
+  gint i;
+
+  for (i = 0; i < width; i++) {
+    const gint idx = i * incr;
+    const gint diff1 = fj[idx] - fjm1[idx];
+    const gint diff2 = fj[idx] - fjp1[idx];
+    /* change in the same direction */
+    const gint same_dir = ((diff1 > spatial_thresh) & (diff2 > spatial_thresh))
+        | ((diff1 < -spatial_thresh) & (diff2 < -spatial_thresh));
+
+    mask[i] = same_dir & (abs (fj[idx] - fjm2[idx]) < 10) & (abs (diff1) > 15);
+  }
+}
+
+/* this metric was sourced from HandBrake but originally from
+ * tritical's isCombedT Avisynth function */
+void
+gst_field_analysis_comb_line_iscombed (guint8 * mask, const guint8 * fjm2,
+    const guint8 * fjm1, const guint8 * fj, const guint8 * fjp1,
+    const guint8 * fjp2, gint incr, gint width, gint spatial_thresh)
+{
+  const gint spatial_thresh_squared = spatial_thresh * spatial_thresh;
+  gint i;
+
+  for (i = 0; i < width; i++) {
+    const gint idx = i * incr;
+    const gint diff1 = fj[idx] - fjm1[idx];
+    const gint diff2 = fj[idx] - fjp1[idx];
+    const gint same_dir = ((diff1 > spatial_thresh) & (diff2 > spatial_thresh))
+        | ((diff1 < -spatial_thresh) & (diff2 < -spatial_thresh));
+
+    /* (fjm1 - fj) * (fjp1 - fj) */
+    mask[i] = same_dir & (diff1 * diff2 > spatial_thresh_squared);
+  }
+}
+
+/* this metric was sourced from HandBrake but originally from
+ * tritical's isCombedT Avisynth function */
+void
+gst_field_analysis_comb_line_5_tap (guint8 * mask, const guint8 * fjm2,
+    const guint8 * fjm1, const guint8 * fj, const guint8 * fjp1,
+    const guint8 * fjp2, gint incr, gint width, gint spatial_thresh)
+{
+  const gint spatial_threshx6 = 6 * spatial_thresh;
+  gint i;
+
+  for (i = 0; i < width; i++) {
+    const gint idx = i * incr;
+    const gint diff1 = fj[idx] - fjm1[idx];
+    const gint diff2 = fj[idx] - fjp1[idx];
+    const gint same_dir = ((diff1 > spatial_thresh) & (diff2 > spatial_thresh))
+        | ((diff1 < -spatial_thresh) & (diff2 < -spatial_thresh));
+
+    mask[i] = same_dir & (abs (fjm2[idx] + (fj[idx] << 2) + fjp2[idx] -
+            3 * (fjm1[idx] + fjp1[idx])) > spatial_threshx6);
+  }
+}
+
+/* if the samples to the left and right of a combed sample are also combed,
+ * it contributes to the score of its block. column i counts for the block
+ * containing sample i - 1, and the left and right edges only need two combed
+ * samples. the extra column at width holds the right edge pair so that it
+ * falls into the last block too */
+static void
+comb_mask_accumulate (guint * cols, const guint8 * mask, gint width)
+{
+  gint i;
+
+  cols[1] += mask[0] & mask[1];
+  for (i = 2; i < width; i++)
+    cols[i] += mask[i - 2] & mask[i - 1] & mask[i];
+  if (width > 2)
+    cols[width] += mask[width - 2] & mask[width - 1];
+}
+
+/* the return value is the highest block score for the row of blocks of
+ * block_height lines starting at base_fj and base_fjp1, the lines of the two
+ * fields. width is rounded down to a multiple of block_width */
+guint64
+gst_field_analysis_block_score_for_row (FieldAnalysisCombLineFunc comb_line,
+    const guint8 * base_fj, const guint8 * base_fjp1, gint incr, gint stride,
+    gint width, guint64 block_width, guint64 block_height,
+    gint64 spatial_thresh, guint8 * comb_mask, guint * comb_cols)
+{
+  guint64 i, j;
+  guint64 block_score;
+  const guint8 *fjm2, *fjm1, *fj, *fjp1, *fjp2;
+  const gint stridex2 = stride << 1;
+  const gint thresh = MIN (spatial_thresh, 255);
+
+  width -= width % block_width;
+  if (width < 2)
+    return 0;
+
+  fjm2 = base_fj - stridex2;
+  fjm1 = base_fjp1 - stridex2;
+  fj = base_fj;
+  fjp1 = base_fjp1;
+  fjp2 = fj + stridex2;
+
+  memset (comb_cols, 0, (width + 1) * sizeof (guint));
+
+  for (j = 0; j < block_height; j++) {
+    comb_line (comb_mask, fjm2, fjm1, fj, fjp1, fjp2, incr, width, thresh);
+    comb_mask_accumulate (comb_cols, comb_mask, width);
+
+    /* advance down a line */
+    fjm2 = fjm1;
+    fjm1 = fj;
+    fj = fjp1;
+    fjp1 = fjp2;
+    fjp2 = fj + stridex2;
+  }
+
+  block_score = 0;
+  for (i = 0; i < width; i += block_width) {
+    guint64 k, score = 0;
+
+    for (k = i + 1; k <= i + block_width; k++)
+      score += comb_cols[k];
+    if (score > block_score)
+      block_score = score;
+  }
+
+  return block_score;
+}
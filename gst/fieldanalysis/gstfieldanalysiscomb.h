@@ -0,0 +1,82 @@
+/*
+ * GStreamer
+ * Copyright (C) 2010 Robert Swain <robert.swain@collabora.co.uk>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_FIELDANALYSIS_COMB_H__
+#define __GST_FIELDANALYSIS_COMB_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* computes one line of the comb mask (1 for combed samples, 0 otherwise) from
+ * the five vertically neighbouring lines of the woven frame */
+typedef void (*FieldAnalysisCombLineFunc) (guint8 * mask, const guint8 * fjm2,
+    const guint8 * fjm1, const guint8 * fj, const guint8 * fjp1,
+    const guint8 * fjp2, gint incr, gint width, gint spatial_thresh);
+
+G_GNUC_INTERNAL
+void gst_field_analysis_comb_line_32detect (guint8 * mask,
+    const guint8 * fjm2, const guint8 * fjm1, const guint8 * fj,
+    const guint8 * fjp1, const guint8 * fjp2, gint incr, gint width,
+    gint spatial_thresh);
+
+G_GNUC_INTERNAL
+void gst_field_analysis_comb_line_iscombed (guint8 * mask,
+    const guint8 * fjm2, const guint8 * fjm1, const guint8 * fj,
+    const guint8 * fjp1, const guint8 * fjp2, gint incr, gint width,
+    gint spatial_thresh);
+
+G_GNUC_INTERNAL
+void gst_field_analysis_comb_line_5_tap (guint8 * mask,
+    const guint8 * fjm2, const guint8 * fjm1, const guint8 * fj,
+    const guint8 * fjp1, const guint8 * fjp2, gint incr, gint width,
+    gint spatial_thresh);
+
+G_GNUC_INTERNAL
+guint64 gst_field_analysis_block_score_for_row (FieldAnalysisCombLineFunc
+    comb_line, const guint8 * base_fj, const guint8 * base_fjp1, gint incr,
+    gint stride, gint width, guint64 block_width, guint64 block_height,
+    gint64 spatial_thresh, guint8 * comb_mask, guint * comb_cols);
+
+G_END_DECLS
+#endif /* __GST_FIELDANALYSIS_COMB_H__ */
@@ -34,6 +34,11 @@
  *
  * Reverberation/room effect.
  *
+ * Mono and stereo input is turned into a stereo reverb. Streams with more
+ * channels keep their layout, each channel is run through its own filter
+ * network with slightly different delays and the wet signal is cross-fed
+ * between channel pairs according to #GstFreeverb:width.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 audiotestsrc wave=saw ! freeverb ! autoaudiosink
@@ -44,6 +49,7 @@
 
 /* FIXME:
  * - add mono-to-mono, then we might also need stereo-to-mono ?
+ * - channels are paired by position in the stream, not by channel-mask
  */
 
 #ifdef HAVE_CONFIG_H
@@ -76,7 +82,7 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("audio/x-raw, "
         "format = (string) { " GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (S16) "}, "
-        "rate = (int) [ 1, MAX ], " "channels = (int) [ 1, 2 ], "
+        "rate = (int) [ 1, MAX ], " "channels = (int) [ 1, MAX ], "
         "layout = (string) interleaved")
     );
 
@@ -85,7 +91,7 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("audio/x-raw, "
         "format = (string) { " GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (S16) "}, "
-        "rate = (int) [ 1, MAX ], " "channels = (int) 2, "
+        "rate = (int) [ 1, MAX ], " "channels = (int) [ 2, MAX ], "
         "layout = (string) interleaved")
     );
 
@@ -106,26 +112,16 @@ static gboolean gst_freeverb_set_caps (GstBaseTransform * base,
 static GstFlowReturn gst_freeverb_transform (GstBaseTransform * base,
     GstBuffer * inbuf, GstBuffer * outbuf);
 
-static gboolean gst_freeverb_transform_m2s_int (GstFreeverb * filter,
-    gint16 * idata, gint16 * odata, guint num_samples);
-static gboolean gst_freeverb_transform_s2s_int (GstFreeverb * filter,
+static gboolean gst_freeverb_transform_int (GstFreeverb * filter,
     gint16 * idata, gint16 * odata, guint num_samples);
-static gboolean gst_freeverb_transform_m2s_float (GstFreeverb * filter,
-    gfloat * idata, gfloat * odata, guint num_samples);
-static gboolean gst_freeverb_transform_s2s_float (GstFreeverb * filter,
+static gboolean gst_freeverb_transform_float (GstFreeverb * filter,
     gfloat * idata, gfloat * odata, guint num_samples);
 
 
-/* Table with processing functions: [channels][format] */
-static const GstFreeverbProcessFunc process_functions[2][2] = {
-  {
-        (GstFreeverbProcessFunc) gst_freeverb_transform_m2s_int,
-        (GstFreeverbProcessFunc) gst_freeverb_transform_m2s_float,
-      },
-  {
-        (GstFreeverbProcessFunc) gst_freeverb_transform_s2s_int,
-        (GstFreeverbProcessFunc) gst_freeverb_transform_s2s_float,
-      }
+/* Table with processing functions: [format] */
+static const GstFreeverbProcessFunc process_functions[2] = {
+  (GstFreeverbProcessFunc) gst_freeverb_transform_int,
+  (GstFreeverbProcessFunc) gst_freeverb_transform_float,
 };
 
 /***************************************************************
@@ -147,6 +143,11 @@ static const GstFreeverbProcessFunc process_functions[2][2] = {
 #define DC_OFFSET 1e-8
 //#define DC_OFFSET 0.001f
 
+/* Maximum number of frames run through the filter network at once. Blocks
+ * are further limited to the shortest delay line, so that no sample written
+ * in a block is read back within the same block. */
+#define FREEVERB_BLOCK_SIZE 128
+
 /* all pass filter */
 
 typedef struct _freeverb_allpass
@@ -160,6 +161,7 @@ typedef struct _freeverb_allpass
 static void
 freeverb_allpass_setbuffer (freeverb_allpass * allpass, gint size)
 {
+  size = MAX (size, 1);
   allpass->bufidx = 0;
   allpass->buffer = g_new (gfloat, size);
   allpass->bufsize = size;
@@ -188,24 +190,37 @@ freeverb_allpass_setfeedback (freeverb_allpass * allpass, gfloat val)
   allpass->feedback = val;
 }
 
-/*
-static gfloat
-freeverb_allpass_getfeedback(freeverb_allpass* allpass)
+/* runs @n samples of @data through a contiguous stretch of the delay line,
+ * there is no dependency between the iterations so this vectorizes */
+static inline void
+freeverb_allpass_run (gfloat * buf, gfloat * data, gint n, gfloat feedback)
 {
-  return allpass->feedback;
-}*/
+  gint k;
+
+  for (k = 0; k < n; k++) {
+    gfloat bufout = buf[k];
+    gfloat output = bufout - data[k];
 
-#define freeverb_allpass_process(_allpass, _input_1) \
-{ \
-  gfloat output; \
-  gfloat bufout; \
-  bufout = _allpass.buffer[_allpass.bufidx]; \
-  output = bufout-_input_1; \
-  _allpass.buffer[_allpass.bufidx] = _input_1 + (bufout * _allpass.feedback); \
-  if (++_allpass.bufidx >= _allpass.bufsize) { \
-    _allpass.bufidx = 0; \
-  } \
-  _input_1 = output; \
+    buf[k] = data[k] + (bufout * feedback);
+    data[k] = output;
+  }
+}
+
+/* processes @n <= bufsize samples of @data in place */
+static void
+freeverb_allpass_process_block (freeverb_allpass * allpass, gfloat * data,
+    gint n)
+{
+  gint len = MIN (n, allpass->bufsize - allpass->bufidx);
+
+  freeverb_allpass_run (allpass->buffer + allpass->bufidx, data, len,
+      allpass->feedback);
+  freeverb_allpass_run (allpass->buffer, data + len, n - len,
+      allpass->feedback);
+
+  allpass->bufidx += n;
+  if (allpass->bufidx >= allpass->bufsize)
+    allpass->bufidx -= allpass->bufsize;
 }
 
 /* comb filter */
@@ -224,6 +239,7 @@ typedef struct _freeverb_comb
 static void
 freeverb_comb_setbuffer (freeverb_comb * comb, gint size)
 {
+  size = MAX (size, 1);
   comb->filterstore = 0;
   comb->bufidx = 0;
   comb->buffer = g_new (gfloat, size);
@@ -254,37 +270,12 @@ freeverb_comb_setdamp (freeverb_comb * comb, gfloat val)
   comb->damp2 = 1 - val;
 }
 
-/*
-static gfloat
-freeverb_comb_getdamp(freeverb_comb* comb)
-{
-  return comb->damp1;
-}*/
-
 static void
 freeverb_comb_setfeedback (freeverb_comb * comb, gfloat val)
 {
   comb->feedback = val;
 }
 
-/*
-static gfloat
-freeverb_comb_getfeedback(freeverb_comb* comb)
-{
-  return comb->feedback;
-}*/
-
-#define freeverb_comb_process(_comb, _input_1, _output) \
-{ \
-  gfloat _tmp = _comb.buffer[_comb.bufidx]; \
-  _comb.filterstore = (_tmp * _comb.damp2) + (_comb.filterstore * _comb.damp1); \
-  _comb.buffer[_comb.bufidx] = _input_1 + (_comb.filterstore * _comb.feedback); \
-  if (++_comb.bufidx >= _comb.bufsize) { \
-    _comb.bufidx = 0; \
-  } \
-  _output += _tmp; \
-}
-
 #define numcombs 8
 #define numallpasses 4
 #define	fixedgain 0.015f
@@ -298,31 +289,106 @@ freeverb_comb_getfeedback(freeverb_comb* comb)
 /* These values assume 44.1KHz sample rate
  * they will need scaling for 96KHz (or other) sample rates.
  * The values were obtained by listening tests.
+ *
+ * Channel n uses these delays plus n * stereospread, which gives the
+ * classic left/right tunings for stereo and keeps the reverb tails of
+ * further channels decorrelated.
  */
-#define combtuningL1 1116
-#define combtuningR1 (1116 + stereospread)
-#define combtuningL2 1188
-#define combtuningR2 (1188 + stereospread)
-#define combtuningL3 1277
-#define combtuningR3 (1277 + stereospread)
-#define combtuningL4 1356
-#define combtuningR4 (1356 + stereospread)
-#define combtuningL5 1422
-#define combtuningR5 (1422 + stereospread)
-#define combtuningL6 1491
-#define combtuningR6 (1491 + stereospread)
-#define combtuningL7 1557
-#define combtuningR7 (1557 + stereospread)
-#define combtuningL8 1617
-#define combtuningR8 (1617 + stereospread)
-#define allpasstuningL1 556
-#define allpasstuningR1 (556 + stereospread)
-#define allpasstuningL2 441
-#define allpasstuningR2 (441 + stereospread)
-#define allpasstuningL3 341
-#define allpasstuningR3 (341 + stereospread)
-#define allpasstuningL4 225
-#define allpasstuningR4 (225 + stereospread)
+static const gint combtuning[numcombs] = {
+  1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617
+};
+
+static const gint allpasstuning[numallpasses] = {
+  556, 441, 341, 225
+};
+
+/* The filter network of one output channel */
+typedef struct _freeverb_channel
+{
+  /* Comb filters */
+  freeverb_comb comb[numcombs];
+  /* Allpass filters */
+  freeverb_allpass allpass[numallpasses];
+} freeverb_channel;
+
+/* Copies @n delayed samples of @comb into lane @lane of @lanes */
+static inline void
+freeverb_comb_gather (freeverb_comb * comb,
+    gfloat lanes[FREEVERB_BLOCK_SIZE][numcombs], gint lane, gint n)
+{
+  gint k, len = MIN (n, comb->bufsize - comb->bufidx);
+  const gfloat *buf = comb->buffer + comb->bufidx;
+
+  for (k = 0; k < len; k++)
+    lanes[k][lane] = buf[k];
+  for (; k < n; k++)
+    lanes[k][lane] = comb->buffer[k - len];
+}
+
+/* Writes lane @lane of @lanes back into the delay line of @comb */
+static inline void
+freeverb_comb_scatter (freeverb_comb * comb,
+    gfloat lanes[FREEVERB_BLOCK_SIZE][numcombs], gint lane, gint n)
+{
+  gint k, len = MIN (n, comb->bufsize - comb->bufidx);
+  gfloat *buf = comb->buffer + comb->bufidx;
+
+  for (k = 0; k < len; k++)
+    buf[k] = lanes[k][lane];
+  for (; k < n; k++)
+    comb->buffer[k - len] = lanes[k][lane];
+
+  comb->bufidx += n;
+  if (comb->bufidx >= comb->bufsize)
+    comb->bufidx -= comb->bufsize;
+}
+
+/* Runs @n samples of @input through the parallel comb bank of @channel and
+ * stores the sum of the comb outputs in @output.
+ *
+ * The delayed samples of all combs are gathered up front, which is valid as
+ * long as @n does not exceed the shortest comb. The recursive damping filter
+ * then runs with one comb per lane, so the inner loops map onto SIMD
+ * registers of 4 or 8 floats. */
+static void
+freeverb_comb_bank_process (freeverb_channel * channel, const gfloat * input,
+    gfloat * output, gint n)
+{
+  gfloat lanes[FREEVERB_BLOCK_SIZE][numcombs];
+  gfloat store[numcombs], damp1[numcombs], damp2[numcombs];
+  gfloat feedback[numcombs];
+  gint i, k;
+
+  for (i = 0; i < numcombs; i++) {
+    freeverb_comb *comb = &channel->comb[i];
+
+    store[i] = comb->filterstore;
+    damp1[i] = comb->damp1;
+    damp2[i] = comb->damp2;
+    feedback[i] = comb->feedback;
+    freeverb_comb_gather (comb, lanes, i, n);
+  }
+
+  for (k = 0; k < n; k++) {
+    gfloat out = 0.0f, in = input[k];
+
+    /* Accumulate comb filters in parallel, in the same order as the
+     * per-sample implementation so results are unchanged */
+    for (i = 0; i < numcombs; i++)
+      out += lanes[k][i];
+
+    for (i = 0; i < numcombs; i++) {
+      store[i] = (lanes[k][i] * damp2[i]) + (store[i] * damp1[i]);
+      lanes[k][i] = in + (store[i] * feedback[i]);
+    }
+    output[k] = out;
+  }
+
+  for (i = 0; i < numcombs; i++) {
+    channel->comb[i].filterstore = store[i];
+    freeverb_comb_scatter (&channel->comb[i], lanes, i, n);
+  }
+}
 
 struct _GstFreeverbPrivate
 {
@@ -331,17 +397,16 @@ struct _GstFreeverbPrivate
   gfloat wet, wet1, wet2, dry;
   gfloat width;
   gfloat gain;
-  /*
-     The following are all declared inline
-     to remove the need for dynamic allocation
-     with its subsequent error-checking messiness
-   */
-  /* Comb filters */
-  freeverb_comb combL[numcombs];
-  freeverb_comb combR[numcombs];
-  /* Allpass filters */
-  freeverb_allpass allpassL[numallpasses];
-  freeverb_allpass allpassR[numallpasses];
+
+  /* one filter network per output channel */
+  freeverb_channel *channels;
+  gint n_channels;
+  gint block_size;
+
+  /* per channel scratch blocks of FREEVERB_BLOCK_SIZE samples */
+  gfloat *input;                /* dry input, per input channel */
+  gfloat *feed;                 /* scaled input into the filter network */
+  gfloat *output;               /* wet output, per output channel */
 };
 
 G_DEFINE_TYPE_WITH_CODE (GstFreeverb, gst_freeverb, GST_TYPE_BASE_TRANSFORM,
@@ -354,15 +419,13 @@ static void
 freeverb_revmodel_init (GstFreeverb * filter)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i;
+  gint c, i;
 
-  for (i = 0; i < numcombs; i++) {
-    freeverb_comb_init (&priv->combL[i]);
-    freeverb_comb_init (&priv->combR[i]);
-  }
-  for (i = 0; i < numallpasses; i++) {
-    freeverb_allpass_init (&priv->allpassL[i]);
-    freeverb_allpass_init (&priv->allpassR[i]);
+  for (c = 0; c < priv->n_channels; c++) {
+    for (i = 0; i < numcombs; i++)
+      freeverb_comb_init (&priv->channels[c].comb[i]);
+    for (i = 0; i < numallpasses; i++)
+      freeverb_allpass_init (&priv->channels[c].allpass[i]);
   }
 }
 
@@ -370,15 +433,67 @@ static void
 freeverb_revmodel_free (GstFreeverb * filter)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i;
+  gint c, i;
 
-  for (i = 0; i < numcombs; i++) {
-    freeverb_comb_release (&priv->combL[i]);
-    freeverb_comb_release (&priv->combR[i]);
+  for (c = 0; c < priv->n_channels; c++) {
+    for (i = 0; i < numcombs; i++)
+      freeverb_comb_release (&priv->channels[c].comb[i]);
+    for (i = 0; i < numallpasses; i++)
+      freeverb_allpass_release (&priv->channels[c].allpass[i]);
+  }
+  g_free (priv->channels);
+  priv->channels = NULL;
+  priv->n_channels = 0;
+
+  g_free (priv->input);
+  priv->input = NULL;
+  g_free (priv->feed);
+  priv->feed = NULL;
+  g_free (priv->output);
+  priv->output = NULL;
+}
+
+/* Runs one block of priv->input through the filter networks into
+ * priv->output */
+static void
+freeverb_revmodel_process_block (GstFreeverb * filter, gint n)
+{
+  GstFreeverbPrivate *priv = filter->priv;
+  gint in_channels = GST_AUDIO_INFO_CHANNELS (&filter->info);
+  gint c, i, k;
+
+  if (in_channels == 1) {
+    /* The original Freeverb code expects a stereo signal and 'input_1'
+     * is set to the sum of the left and right input_1 sample. Since
+     * this code works on a mono signal, 'input_1' is set to twice the
+     * input_1 sample. Both output channels are fed from it. */
+    for (k = 0; k < n; k++)
+      priv->feed[k] = (2.0f * priv->input[k] + DC_OFFSET) * priv->gain;
+  } else {
+    for (c = 0; c < in_channels; c++) {
+      const gfloat *in = priv->input + c * FREEVERB_BLOCK_SIZE;
+      gfloat *feed = priv->feed + c * FREEVERB_BLOCK_SIZE;
+
+      for (k = 0; k < n; k++)
+        feed[k] = (in[k] + DC_OFFSET) * priv->gain;
+    }
   }
-  for (i = 0; i < numallpasses; i++) {
-    freeverb_allpass_release (&priv->allpassL[i]);
-    freeverb_allpass_release (&priv->allpassR[i]);
+
+  for (c = 0; c < priv->n_channels; c++) {
+    freeverb_channel *channel = &priv->channels[c];
+    const gfloat *feed =
+        priv->feed + (in_channels == 1 ? 0 : c) * FREEVERB_BLOCK_SIZE;
+    gfloat *out = priv->output + c * FREEVERB_BLOCK_SIZE;
+
+    freeverb_comb_bank_process (channel, feed, out, n);
+
+    /* Feed through allpasses in series */
+    for (i = 0; i < numallpasses; i++)
+      freeverb_allpass_process_block (&channel->allpass[i], out, n);
+
+    /* Remove the DC offset */
+    for (k = 0; k < n; k++)
+      out[k] -= (gfloat) DC_OFFSET;
   }
 }
 
@@ -447,8 +562,6 @@ gst_freeverb_init (GstFreeverb * filter)
   filter->process = NULL;
 
   gst_base_transform_set_gap_aware (GST_BASE_TRANSFORM (filter), TRUE);
-
-  freeverb_revmodel_init (filter);
 }
 
 static void
@@ -464,69 +577,63 @@ gst_freeverb_finalize (GObject * object)
 static gboolean
 gst_freeverb_set_process_function (GstFreeverb * filter, GstAudioInfo * info)
 {
-  gint channel_index, format_index;
+  gint format_index;
   const GstAudioFormatInfo *finfo = info->finfo;
 
   /* set processing function */
-  channel_index = GST_AUDIO_INFO_CHANNELS (info) - 1;
-  if (channel_index > 1 || channel_index < 0) {
+  if (GST_AUDIO_INFO_CHANNELS (info) < 1) {
     filter->process = NULL;
     return FALSE;
   }
 
   format_index = GST_AUDIO_FORMAT_INFO_IS_FLOAT (finfo) ? 1 : 0;
 
-  filter->process = process_functions[channel_index][format_index];
+  filter->process = process_functions[format_index];
   return TRUE;
 }
 
 static void
-gst_freeverb_init_rev_model (GstFreeverb * filter)
+gst_freeverb_init_rev_model (GstFreeverb * filter, gint n_channels)
 {
   gfloat srfactor = GST_AUDIO_INFO_RATE (&filter->info) / 44100.0f;
+  gint in_channels = GST_AUDIO_INFO_CHANNELS (&filter->info);
   GstFreeverbPrivate *priv = filter->priv;
+  gint c, i, block_size = FREEVERB_BLOCK_SIZE;
 
   freeverb_revmodel_free (filter);
 
   priv->gain = fixedgain;
+  priv->n_channels = n_channels;
+  priv->channels = g_new0 (freeverb_channel, n_channels);
 
-  freeverb_comb_setbuffer (&priv->combL[0], combtuningL1 * srfactor);
-  freeverb_comb_setbuffer (&priv->combR[0], combtuningR1 * srfactor);
-  freeverb_comb_setbuffer (&priv->combL[1], combtuningL2 * srfactor);
-  freeverb_comb_setbuffer (&priv->combR[1], combtuningR2 * srfactor);
-  freeverb_comb_setbuffer (&priv->combL[2], combtuningL3 * srfactor);
-  freeverb_comb_setbuffer (&priv->combR[2], combtuningR3 * srfactor);
-  freeverb_comb_setbuffer (&priv->combL[3], combtuningL4 * srfactor);
-  freeverb_comb_setbuffer (&priv->combR[3], combtuningR4 * srfactor);
-  freeverb_comb_setbuffer (&priv->combL[4], combtuningL5 * srfactor);
-  freeverb_comb_setbuffer (&priv->combR[4], combtuningR5 * srfactor);
-  freeverb_comb_setbuffer (&priv->combL[5], combtuningL6 * srfactor);
-  freeverb_comb_setbuffer (&priv->combR[5], combtuningR6 * srfactor);
-  freeverb_comb_setbuffer (&priv->combL[6], combtuningL7 * srfactor);
-  freeverb_comb_setbuffer (&priv->combR[6], combtuningR7 * srfactor);
-  freeverb_comb_setbuffer (&priv->combL[7], combtuningL8 * srfactor);
-  freeverb_comb_setbuffer (&priv->combR[7], combtuningR8 * srfactor);
-  freeverb_allpass_setbuffer (&priv->allpassL[0], allpasstuningL1 * srfactor);
-  freeverb_allpass_setbuffer (&priv->allpassR[0], allpasstuningR1 * srfactor);
-  freeverb_allpass_setbuffer (&priv->allpassL[1], allpasstuningL2 * srfactor);
-  freeverb_allpass_setbuffer (&priv->allpassR[1], allpasstuningR2 * srfactor);
-  freeverb_allpass_setbuffer (&priv->allpassL[2], allpasstuningL3 * srfactor);
-  freeverb_allpass_setbuffer (&priv->allpassR[2], allpasstuningR3 * srfactor);
-  freeverb_allpass_setbuffer (&priv->allpassL[3], allpasstuningL4 * srfactor);
-  freeverb_allpass_setbuffer (&priv->allpassR[3], allpasstuningR4 * srfactor);
+  for (c = 0; c < n_channels; c++) {
+    freeverb_channel *channel = &priv->channels[c];
+
+    for (i = 0; i < numcombs; i++) {
+      freeverb_comb_setbuffer (&channel->comb[i],
+          (combtuning[i] + c * stereospread) * srfactor);
+      freeverb_comb_setfeedback (&channel->comb[i], priv->roomsize);
+      freeverb_comb_setdamp (&channel->comb[i], priv->damp);
+      block_size = MIN (block_size, channel->comb[i].bufsize);
+    }
+    for (i = 0; i < numallpasses; i++) {
+      freeverb_allpass_setbuffer (&channel->allpass[i],
+          (allpasstuning[i] + c * stereospread) * srfactor);
+      freeverb_allpass_setfeedback (&channel->allpass[i], 0.5f);
+      block_size = MIN (block_size, channel->allpass[i].bufsize);
+    }
+  }
+  priv->block_size = block_size;
+
+  priv->input = g_new (gfloat, in_channels * FREEVERB_BLOCK_SIZE);
+  priv->feed = g_new (gfloat, in_channels * FREEVERB_BLOCK_SIZE);
+  priv->output = g_new (gfloat, n_channels * FREEVERB_BLOCK_SIZE);
 
   /* clear buffers */
   freeverb_revmodel_init (filter);
 
-  /* set default values */
-  freeverb_allpass_setfeedback (&priv->allpassL[0], 0.5f);
-  freeverb_allpass_setfeedback (&priv->allpassR[0], 0.5f);
-  freeverb_allpass_setfeedback (&priv->allpassL[1], 0.5f);
-  freeverb_allpass_setfeedback (&priv->allpassR[1], 0.5f);
-  freeverb_allpass_setfeedback (&priv->allpassL[2], 0.5f);
-  freeverb_allpass_setfeedback (&priv->allpassR[2], 0.5f);
-  freeverb_allpass_setfeedback (&priv->allpassL[3], 0.5f);
-  freeverb_allpass_setfeedback (&priv->allpassR[3], 0.5f);
+  GST_DEBUG_OBJECT (filter, "%d -> %d channels, block size %d", in_channels,
+      n_channels, block_size);
 }
 
 static void
@@ -535,23 +642,24 @@ gst_freeverb_set_property (GObject * object, guint prop_id,
 {
   GstFreeverb *filter = GST_FREEVERB (object);
   GstFreeverbPrivate *priv = filter->priv;
-  gint i;
+  gint c, i;
 
   switch (prop_id) {
     case PROP_ROOM_SIZE:
       filter->room_size = g_value_get_float (value);
       priv->roomsize = (filter->room_size * scaleroom) + offsetroom;
-      for (i = 0; i < numcombs; i++) {
-        freeverb_comb_setfeedback (&priv->combL[i], priv->roomsize);
-        freeverb_comb_setfeedback (&priv->combR[i], priv->roomsize);
+      for (c = 0; c < priv->n_channels; c++) {
+        for (i = 0; i < numcombs; i++)
+          freeverb_comb_setfeedback (&priv->channels[c].comb[i],
+              priv->roomsize);
       }
       break;
     case PROP_DAMPING:
       filter->damping = g_value_get_float (value);
       priv->damp = filter->damping * scaledamp;
-      for (i = 0; i < numcombs; i++) {
-        freeverb_comb_setdamp (&priv->combL[i], priv->damp);
-        freeverb_comb_setdamp (&priv->combR[i], priv->damp);
+      for (c = 0; c < priv->n_channels; c++) {
+        for (i = 0; i < numcombs; i++)
+          freeverb_comb_setdamp (&priv->channels[c].comb[i], priv->damp);
       }
       break;
     case PROP_PAN_WIDTH:
@@ -618,26 +726,78 @@ gst_freeverb_get_unit_size (GstBaseTransform * base, GstCaps * caps,
   return TRUE;
 }
 
+/* Intersects the @channels field value (any channel count if unset) with
+ * [@min, @max], storing the result in @res */
+static gboolean
+gst_freeverb_intersect_channels (const GValue * channels, gint min, gint max,
+    GValue * res)
+{
+  GValue range = G_VALUE_INIT;
+  gboolean ret;
+
+  if (min == max) {
+    g_value_init (&range, G_TYPE_INT);
+    g_value_set_int (&range, min);
+  } else {
+    g_value_init (&range, GST_TYPE_INT_RANGE);
+    gst_value_set_int_range (&range, min, max);
+  }
+
+  if (channels) {
+    ret = gst_value_intersect (res, channels, &range);
+    g_value_unset (&range);
+  } else {
+    *res = range;
+    ret = TRUE;
+  }
+
+  return ret;
+}
+
 static GstCaps *
 gst_freeverb_transform_caps (GstBaseTransform * base,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter)
 {
   GstCaps *res;
   GstStructure *structure;
+  GstCapsFeatures *features;
+  const GValue *channels;
+  GValue value = G_VALUE_INIT;
   gint i;
 
-  /* replace the channel property with our range. */
-  res = gst_caps_copy (caps);
-  for (i = 0; i < gst_caps_get_size (res); i++) {
-    structure = gst_caps_get_structure (res, i);
-    if (direction == GST_PAD_SRC) {
-      GST_INFO_OBJECT (base, "[%d] allow 1-2 channels", i);
-      gst_structure_set (structure, "channels", GST_TYPE_INT_RANGE, 1, 2, NULL);
-    } else {
-      GST_INFO_OBJECT (base, "[%d] allow 2 channels", i);
-      gst_structure_set (structure, "channels", G_TYPE_INT, 2, NULL);
+  /* Mono and stereo input is reverberated into stereo, layouts with more
+   * channels are kept as they are. */
+  res = gst_caps_new_empty ();
+  for (i = 0; i < gst_caps_get_size (caps); i++) {
+    structure = gst_caps_get_structure (caps, i);
+    features = gst_caps_get_features (caps, i);
+    channels = gst_structure_get_value (structure, "channels");
+
+    if (gst_freeverb_intersect_channels (channels,
+            direction == GST_PAD_SRC ? 2 : 1, 2, &value)) {
+      GstStructure *s = gst_structure_copy (structure);
+
+      g_value_unset (&value);
+      if (direction == GST_PAD_SRC) {
+        GST_INFO_OBJECT (base, "[%d] allow 1-2 channels", i);
+        gst_structure_set (s, "channels", GST_TYPE_INT_RANGE, 1, 2, NULL);
+      } else {
+        GST_INFO_OBJECT (base, "[%d] allow 2 channels", i);
+        gst_structure_set (s, "channels", G_TYPE_INT, 2, NULL);
+      }
+      gst_structure_remove_field (s, "channel-mask");
+      res = gst_caps_merge_structure_full (res, s,
+          features ? gst_caps_features_copy (features) : NULL);
+    }
+
+    if (gst_freeverb_intersect_channels (channels, 3, G_MAXINT, &value)) {
+      GstStructure *s = gst_structure_copy (structure);
+
+      GST_INFO_OBJECT (base, "[%d] allow same multi-channel layout", i);
+      gst_structure_take_value (s, "channels", &value);
+      res = gst_caps_merge_structure_full (res, s,
+          features ? gst_caps_features_copy (features) : NULL);
     }
-    gst_structure_remove_field (structure, "channel-mask");
   }
   GST_DEBUG_OBJECT (base, "transformed %" GST_PTR_FORMAT, res);
 
@@ -660,21 +820,30 @@ gst_freeverb_set_caps (GstBaseTransform * base, GstCaps * incaps,
     GstCaps * outcaps)
 {
   GstFreeverb *filter = GST_FREEVERB (base);
-  GstAudioInfo info;
+  GstAudioInfo info, out_info;
+  gint in_channels, out_channels;
 
   /*GST_INFO ("incaps are %" GST_PTR_FORMAT, incaps); */
   if (!gst_audio_info_from_caps (&info, incaps))
     goto no_format;
+  if (!gst_audio_info_from_caps (&out_info, outcaps))
+    goto no_format;
+
+  in_channels = GST_AUDIO_INFO_CHANNELS (&info);
+  out_channels = GST_AUDIO_INFO_CHANNELS (&out_info);
 
   GST_DEBUG ("try to process %d input with %d channels",
-      GST_AUDIO_INFO_FORMAT (&info), GST_AUDIO_INFO_CHANNELS (&info));
+      GST_AUDIO_INFO_FORMAT (&info), in_channels);
+
+  if (out_channels != (in_channels <= 2 ? 2 : in_channels))
+    goto no_format;
 
   if (!gst_freeverb_set_process_function (filter, &info))
     goto no_format;
 
   filter->info = info;
 
-  gst_freeverb_init_rev_model (filter);
+  gst_freeverb_init_rev_model (filter, out_channels);
   filter->drained = FALSE;
   GST_INFO_OBJECT (base, "model configured");
 
@@ -687,190 +856,108 @@ no_format:
   }
 }
 
-static gboolean
-gst_freeverb_transform_m2s_int (GstFreeverb * filter,
-    gint16 * idata, gint16 * odata, guint num_samples)
+/* The wet signal of output channel c is mixed with the one of its pair
+ * partner c ^ 1 according to the width, which for stereo is the usual
+ * left/right cross-feed. An unpaired last channel is mixed with itself. */
+static inline gint
+gst_freeverb_partner_channel (gint c, gint n_channels)
 {
-  GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1;
-  gfloat out_l2, out_r2, input_2;
-  gboolean drained = TRUE;
-
-  for (k = 0; k < num_samples; k++) {
-    out_l1 = out_r1 = 0.0;
+  gint partner = c ^ 1;
 
-    /* The original Freeverb code expects a stereo signal and 'input_1'
-     * is set to the sum of the left and right input_1 sample. Since
-     * this code works on a mono signal, 'input_1' is set to twice the
-     * input_1 sample. */
-    input_2 = (gfloat) * idata++;
-    input_1 = (2.0f * input_2 + DC_OFFSET) * priv->gain;
-
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1, out_r1);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
-    }
-
-    /* Remove the DC offset */
-    out_l1 -= (gfloat) DC_OFFSET;
-    out_r1 -= (gfloat) DC_OFFSET;
-
-    /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2 * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2 * priv->dry;
-    out_l2 = CLAMP (out_l2, G_MININT16, G_MAXINT16);
-    out_r2 = CLAMP (out_r2, G_MININT16, G_MAXINT16);
-    *odata++ = (gint16) out_l2;
-    *odata++ = (gint16) out_r2;
-
-    if (abs ((gint16) out_l2) > 0 || abs ((gint16) out_r2) > 0)
-      drained = FALSE;
-  }
-  return drained;
+  return partner < n_channels ? partner : c;
 }
 
 static gboolean
-gst_freeverb_transform_s2s_int (GstFreeverb * filter,
+gst_freeverb_transform_int (GstFreeverb * filter,
     gint16 * idata, gint16 * odata, guint num_samples)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1l, input_1r;
-  gfloat out_l2, out_r2, input_2l, input_2r;
+  gint in_channels = GST_AUDIO_INFO_CHANNELS (&filter->info);
+  gint out_channels = priv->n_channels;
+  gint c, k, n;
   gboolean drained = TRUE;
 
-  for (k = 0; k < num_samples; k++) {
-    out_l1 = out_r1 = 0.0;
+  while (num_samples > 0) {
+    n = MIN (num_samples, priv->block_size);
 
-    input_2l = (gfloat) * idata++;
-    input_2r = (gfloat) * idata++;
-    input_1l = (input_2l + DC_OFFSET) * priv->gain;
-    input_1r = (input_2r + DC_OFFSET) * priv->gain;
+    for (c = 0; c < in_channels; c++) {
+      gfloat *in = priv->input + c * FREEVERB_BLOCK_SIZE;
 
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1l, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1r, out_r1);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
+      for (k = 0; k < n; k++)
+        in[k] = (gfloat) idata[k * in_channels + c];
     }
 
-    /* Remove the DC offset */
-    out_l1 -= (gfloat) DC_OFFSET;
-    out_r1 -= (gfloat) DC_OFFSET;
+    freeverb_revmodel_process_block (filter, n);
 
     /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2l * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2r * priv->dry;
-    out_l2 = CLAMP (out_l2, G_MININT16, G_MAXINT16);
-    out_r2 = CLAMP (out_r2, G_MININT16, G_MAXINT16);
-    *odata++ = (gint16) out_l2;
-    *odata++ = (gint16) out_r2;
-
-    if (abs ((gint16) out_l2) > 0 || abs ((gint16) out_r2) > 0)
-      drained = FALSE;
-  }
-  return drained;
-}
-
-static gboolean
-gst_freeverb_transform_m2s_float (GstFreeverb * filter,
-    gfloat * idata, gfloat * odata, guint num_samples)
-{
-  GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1;
-  gfloat out_l2, out_r2, input_2;
-  gboolean drained = TRUE;
-
-  for (k = 0; k < num_samples; k++) {
-    out_l1 = out_r1 = 0.0;
-
-    /* The original Freeverb code expects a stereo signal and 'input_1'
-     * is set to the sum of the left and right input_1 sample. Since
-     * this code works on a mono signal, 'input_1' is set to twice the
-     * input_1 sample. */
-    input_2 = *idata++;
-    input_1 = (2.0f * input_2 + DC_OFFSET) * priv->gain;
-
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1, out_r1);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
+    for (c = 0; c < out_channels; c++) {
+      const gfloat *wet = priv->output + c * FREEVERB_BLOCK_SIZE;
+      const gfloat *cross = priv->output +
+          gst_freeverb_partner_channel (c, out_channels) * FREEVERB_BLOCK_SIZE;
+      const gfloat *in =
+          priv->input + (in_channels == 1 ? 0 : c) * FREEVERB_BLOCK_SIZE;
+
+      for (k = 0; k < n; k++) {
+        gfloat out = wet[k] * priv->wet1 + cross[k] * priv->wet2 +
+            in[k] * priv->dry;
+        gint16 sample = (gint16) CLAMP (out, G_MININT16, G_MAXINT16);
+
+        odata[k * out_channels + c] = sample;
+        if (sample != 0)
+          drained = FALSE;
+      }
     }
 
-    /* Remove the DC offset */
-    out_l1 -= (gfloat) DC_OFFSET;
-    out_r1 -= (gfloat) DC_OFFSET;
-
-    /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2 * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2 * priv->dry;
-    *odata++ = out_l2;
-    *odata++ = out_r2;
-
-    if (fabs (out_l2) > 0 || fabs (out_r2) > 0)
-      drained = FALSE;
+    idata += n * in_channels;
+    odata += n * out_channels;
+    num_samples -= n;
   }
   return drained;
 }
 
 static gboolean
-gst_freeverb_transform_s2s_float (GstFreeverb * filter,
+gst_freeverb_transform_float (GstFreeverb * filter,
     gfloat * idata, gfloat * odata, guint num_samples)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1l, input_1r;
-  gfloat out_l2, out_r2, input_2l, input_2r;
+  gint in_channels = GST_AUDIO_INFO_CHANNELS (&filter->info);
+  gint out_channels = priv->n_channels;
+  gint c, k, n;
   gboolean drained = TRUE;
 
-  for (k = 0; k < num_samples; k++) {
-    out_l1 = out_r1 = 0.0;
+  while (num_samples > 0) {
+    n = MIN (num_samples, priv->block_size);
 
-    input_2l = *idata++;
-    input_2r = *idata++;
-    input_1l = (input_2l + DC_OFFSET) * priv->gain;
-    input_1r = (input_2r + DC_OFFSET) * priv->gain;
+    for (c = 0; c < in_channels; c++) {
+      gfloat *in = priv->input + c * FREEVERB_BLOCK_SIZE;
 
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1l, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1r, out_r1);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
+      for (k = 0; k < n; k++)
+        in[k] = idata[k * in_channels + c];
     }
 
-    /* Remove the DC offset */
-    out_l1 -= (gfloat) DC_OFFSET;
-    out_r1 -= (gfloat) DC_OFFSET;
+    freeverb_revmodel_process_block (filter, n);
 
     /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2l * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2r * priv->dry;
-    *odata++ = out_l2;
-    *odata++ = out_r2;
+    for (c = 0; c < out_channels; c++) {
+      const gfloat *wet = priv->output + c * FREEVERB_BLOCK_SIZE;
+      const gfloat *cross = priv->output +
+          gst_freeverb_partner_channel (c, out_channels) * FREEVERB_BLOCK_SIZE;
+      const gfloat *in =
+          priv->input + (in_channels == 1 ? 0 : c) * FREEVERB_BLOCK_SIZE;
+
+      for (k = 0; k < n; k++) {
+        gfloat out = wet[k] * priv->wet1 + cross[k] * priv->wet2 +
+            in[k] * priv->dry;
+
+        odata[k * out_channels + c] = out;
+        if (fabs (out) > 0)
+          drained = FALSE;
+      }
+    }
 
-    if (fabs (out_l2) > 0 || fabs (out_r2) > 0)
-      drained = FALSE;
+    idata += n * in_channels;
+    odata += n * out_channels;
+    num_samples -= n;
   }
   return drained;
 }
@@ -892,7 +979,8 @@ gst_freeverb_transform (GstBaseTransform * base, GstBuffer * inbuf,
 
   gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
   gst_buffer_map (outbuf, &outmap, GST_MAP_WRITE);
-  num_samples = outmap.size / (2 * GST_AUDIO_INFO_BPS (&filter->info));
+  num_samples = outmap.size / (filter->priv->n_channels *
+      GST_AUDIO_INFO_BPS (&filter->info));
 
   GST_DEBUG_OBJECT (filter, "processing %u samples at %" GST_TIME_FORMAT,
       num_samples, GST_TIME_ARGS (timestamp));
@@ -926,7 +1014,6 @@ gst_freeverb_transform (GstBaseTransform * base, GstBuffer * inbuf,
   return GST_FLOW_OK;
 }
 
-
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
@@ -49,6 +49,15 @@ G_BEGIN_DECLS
 
 void gst_dp_dump_byte_array (guint8 *array, guint length);
 
+/* incremental payload CRC: start from GST_DP_CRC_INIT, feed the payload with
+ * gst_dp_crc_update() and compare GST_DP_CRC_FINISH() of the result with the
+ * payload CRC of the header */
+#define GST_DP_CRC_INIT                 0xFFFF
+#define GST_DP_CRC_FINISH(crc)          ((guint16) (0xffff ^ (crc)))
+
+guint16 gst_dp_crc_update (guint16 crc_register, const guint8 * buffer,
+    gsize length);
+
 G_END_DECLS
 
 #endif /* __GST_DP_PRIVATE_H__ */
@@ -39,6 +39,7 @@
 #include <string.h>
 
 #include "dataprotocol.h"
+#include "dp-private.h"
 
 #include "gstgdpelements.h"
 #include "gstgdpdepay.h"
@@ -90,6 +91,8 @@ static void gst_gdp_depay_set_property (GObject * object, guint prop_id,
 static void gst_gdp_depay_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void gst_gdp_depay_decide_allocation (GstGDPDepay * depay);
+static void gst_gdp_depay_clear_buffer (GstGDPDepay * this);
+static void gst_gdp_depay_clear_pool (GstGDPDepay * this);
 
 static void
 gst_gdp_depay_class_init (GstGDPDepayClass * klass)
@@ -158,6 +161,8 @@ gst_gdp_depay_finalize (GObject * gobject)
   if (this->caps)
     gst_caps_unref (this->caps);
   g_free (this->header);
+  gst_gdp_depay_clear_buffer (this);
+  gst_gdp_depay_clear_pool (this);
   gst_adapter_clear (this->adapter);
   g_object_unref (this->adapter);
   if (this->allocator)
@@ -218,6 +223,8 @@ gst_gdp_depay_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
     case GST_EVENT_FLUSH_STOP:
       /* clear adapter on flush */
       gst_adapter_clear (this->adapter);
+      gst_gdp_depay_clear_buffer (this);
+      this->state = GST_GDP_DEPAY_STATE_HEADER;
       /* forward flush stop */
       res = gst_pad_push_event (this->srcpad, event);
       break;
@@ -262,6 +269,179 @@ gst_gdp_depay_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
   return res;
 }
 
+static void
+gst_gdp_depay_clear_buffer (GstGDPDepay * this)
+{
+  if (this->outbuf_mapped)
+    gst_buffer_unmap (this->outbuf, &this->outmap);
+  this->outbuf_mapped = FALSE;
+  gst_clear_buffer (&this->outbuf);
+}
+
+static void
+gst_gdp_depay_clear_pool (GstGDPDepay * this)
+{
+  if (this->pool) {
+    gst_buffer_pool_set_active (this->pool, FALSE);
+    gst_object_unref (this->pool);
+    this->pool = NULL;
+  }
+  this->pool_size = 0;
+}
+
+static GstBufferPool *
+gst_gdp_depay_create_pool (GstGDPDepay * this, guint32 size)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+
+  pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, this->caps, size, 0, 0);
+  gst_buffer_pool_config_set_allocator (config, this->allocator,
+      &this->allocation_params);
+
+  if (!gst_buffer_pool_set_config (pool, config) ||
+      !gst_buffer_pool_set_active (pool, TRUE)) {
+    GST_WARNING_OBJECT (this, "failed to set up a pool of %u bytes buffers",
+        size);
+    gst_object_unref (pool);
+    return NULL;
+  }
+
+  GST_DEBUG_OBJECT (this, "using a pool of %u bytes buffers", size);
+
+  return pool;
+}
+
+static guint16
+gst_gdp_depay_buffer_crc_update (guint16 crc, GstBuffer * buf)
+{
+  guint i, n_mem;
+
+  n_mem = gst_buffer_n_memory (buf);
+  for (i = 0; i < n_mem; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buf, i);
+    GstMapInfo map;
+
+    if (!gst_memory_map (mem, &map, GST_MAP_READ))
+      continue;
+    crc = gst_dp_crc_update (crc, map.data, map.size);
+    gst_memory_unmap (mem, &map);
+  }
+
+  return crc;
+}
+
+/* Sets up the output buffer for the payload of a buffer packet. Returns FALSE
+ * if no buffer could be allocated */
+static gboolean
+gst_gdp_depay_start_buffer (GstGDPDepay * this)
+{
+  GstBuffer *buf = NULL;
+
+  this->payload_offset = 0;
+  this->payload_crc = GST_DP_CRC_INIT;
+
+  /* The whole payload is in the first queued buffer, typically when gdppay
+   * and gdpdepay are in the same process: share its memory */
+  if (gst_adapter_available_fast (this->adapter) >= this->payload_length) {
+    buf = gst_adapter_take_buffer (this->adapter, this->payload_length);
+    buf = gst_buffer_make_writable (buf);
+    gst_dp_buffer_set_metadata_from_header (GST_DP_HEADER_LENGTH,
+        this->header, buf);
+    if (GST_DP_HEADER_FLAGS (this->header) & GST_DP_HEADER_FLAG_CRC_PAYLOAD)
+      this->payload_crc = gst_gdp_depay_buffer_crc_update (this->payload_crc,
+          buf);
+    this->outbuf = buf;
+    this->payload_offset = this->payload_length;
+    return TRUE;
+  }
+
+  /* Raw media has payloads of a constant size. Once two consecutive payloads
+   * have the same size, recycle buffers of that size */
+  if (this->pool && this->pool_size != this->payload_length)
+    gst_gdp_depay_clear_pool (this);
+  if (!this->pool && this->payload_length == this->last_payload_length) {
+    this->pool = gst_gdp_depay_create_pool (this, this->payload_length);
+    if (this->pool)
+      this->pool_size = this->payload_length;
+  }
+  this->last_payload_length = this->payload_length;
+
+  if (this->pool) {
+    if (gst_buffer_pool_acquire_buffer (this->pool, &buf,
+            NULL) == GST_FLOW_OK) {
+      gst_dp_buffer_set_metadata_from_header (GST_DP_HEADER_LENGTH,
+          this->header, buf);
+    } else {
+      buf = NULL;
+    }
+  }
+
+  if (!buf)
+    buf = gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header,
+        this->allocator, &this->allocation_params);
+  if (!buf)
+    return FALSE;
+
+  if (!gst_buffer_map (buf, &this->outmap, GST_MAP_WRITE)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+
+  this->outbuf = buf;
+  this->outbuf_mapped = TRUE;
+
+  return TRUE;
+}
+
+/* Moves the queued payload data to the output buffer, and returns TRUE once
+ * the whole payload was read */
+static gboolean
+gst_gdp_depay_fill_buffer (GstGDPDepay * this)
+{
+  gboolean crc_payload;
+  gsize available, n;
+
+  if (!this->outbuf_mapped)
+    return this->payload_offset == this->payload_length;
+
+  crc_payload =
+      GST_DP_HEADER_FLAGS (this->header) & GST_DP_HEADER_FLAG_CRC_PAYLOAD;
+
+  available = gst_adapter_available (this->adapter);
+  n = MIN (available, this->payload_length - this->payload_offset);
+  if (n > 0) {
+    guint8 *dest = this->outmap.data + this->payload_offset;
+
+    /* the CRC is computed while the data is still in cache */
+    gst_adapter_copy (this->adapter, dest, 0, n);
+    gst_adapter_flush (this->adapter, n);
+    if (crc_payload)
+      this->payload_crc = gst_dp_crc_update (this->payload_crc, dest, n);
+    this->payload_offset += n;
+  }
+
+  if (this->payload_offset < this->payload_length)
+    return FALSE;
+
+  gst_buffer_unmap (this->outbuf, &this->outmap);
+  this->outbuf_mapped = FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+gst_gdp_depay_validate_buffer_payload (GstGDPDepay * this)
+{
+  if (!(GST_DP_HEADER_FLAGS (this->header) & GST_DP_HEADER_FLAG_CRC_PAYLOAD))
+    return TRUE;
+
+  return GST_DP_CRC_FINISH (this->payload_crc) ==
+      GST_DP_HEADER_CRC_PAYLOAD (this->header);
+}
+
 static GstFlowReturn
 gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
@@ -283,6 +463,7 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
    * lost sync */
   if (GST_BUFFER_IS_DISCONT (buffer)) {
     gst_adapter_clear (this->adapter);
+    gst_gdp_depay_clear_buffer (this);
     this->state = GST_GDP_DEPAY_STATE_HEADER;
   }
   gst_adapter_push (this->adapter, buffer);
@@ -322,6 +503,24 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       }
       case GST_GDP_DEPAY_STATE_PAYLOAD:
       {
+        if (this->payload_type == GST_DP_PAYLOAD_BUFFER
+            && this->payload_length > 0) {
+          /* buffer payloads are moved to the output buffer as they arrive
+           * instead of being accumulated in the adapter */
+          if (!this->caps)
+            goto no_caps;
+          if (!this->outbuf && !gst_gdp_depay_start_buffer (this))
+            goto buffer_failed;
+          if (!gst_gdp_depay_fill_buffer (this))
+            goto done;
+          if (!gst_gdp_depay_validate_buffer_payload (this))
+            goto payload_validate_error;
+
+          GST_LOG_OBJECT (this, "switching to state BUFFER");
+          this->state = GST_GDP_DEPAY_STATE_BUFFER;
+          break;
+        }
+
         /* in this state we wait for all the payload data to be available in the
          * adapter. Then we switch to the state where we actually process the
          * payload. */
@@ -364,22 +563,16 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
         if (!this->caps)
           goto no_caps;
 
-        GST_LOG_OBJECT (this, "reading GDP buffer from adapter");
-        buf =
-            gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header,
-            this->allocator, &this->allocation_params);
-        if (!buf)
-          goto buffer_failed;
-
-        /* now take the payload if there is any */
-        if (this->payload_length > 0) {
-          GstMapInfo map;
-
-          gst_buffer_map (buf, &map, GST_MAP_WRITE);
-          gst_adapter_copy (this->adapter, map.data, 0, this->payload_length);
-          gst_buffer_unmap (buf, &map);
-
-          gst_adapter_flush (this->adapter, this->payload_length);
+        /* the payload, if any, was already read into the output buffer */
+        if (this->outbuf) {
+          buf = this->outbuf;
+          this->outbuf = NULL;
+        } else {
+          buf =
+              gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header,
+              this->allocator, &this->allocation_params);
+          if (!buf)
+            goto buffer_failed;
         }
 
         if (GST_BUFFER_TIMESTAMP (buf) > -this->ts_offset)
@@ -537,6 +730,10 @@ gst_gdp_depay_change_state (GstElement * element, GstStateChange transition)
         this->caps = NULL;
       }
       gst_adapter_clear (this->adapter);
+      gst_gdp_depay_clear_buffer (this);
+      gst_gdp_depay_clear_pool (this);
+      this->last_payload_length = 0;
+      this->state = GST_GDP_DEPAY_STATE_HEADER;
       if (this->allocator)
         gst_object_unref (this->allocator);
       this->allocator = NULL;
@@ -586,6 +783,9 @@ gst_gdp_depay_decide_allocation (GstGDPDepay * gdpdepay)
   gdpdepay->allocator = allocator;
   gdpdepay->allocation_params = params;
 
+  /* the pool is set up again with the new allocator and caps */
+  gst_gdp_depay_clear_pool (gdpdepay);
+
   gst_caps_unref (caps);
   gst_query_unref (query);
 }
@@ -71,6 +71,18 @@ struct _GstGDPDepay
 
   GstAllocator *allocator;
   GstAllocationParams allocation_params;
+
+  /* output buffer the payload of a buffer packet is read into */
+  GstBuffer *outbuf;
+  GstMapInfo outmap;
+  gboolean outbuf_mapped;
+  guint32 payload_offset;
+  guint16 payload_crc;
+
+  /* pool of buffers of the size of the last buffer payloads */
+  GstBufferPool *pool;
+  guint32 pool_size;
+  guint32 last_payload_length;
 };
 
 struct _GstGDPDepayClass
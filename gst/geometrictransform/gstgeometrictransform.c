@@ -49,7 +49,9 @@ static GstVideoFilterClass *parent_class = NULL;
 enum
 {
   PROP_0,
-  PROP_OFF_EDGE_PIXELS
+  PROP_OFF_EDGE_PIXELS,
+  PROP_INTERPOLATION,
+  PROP_N_THREADS
 };
 
 #define GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE ( \
@@ -74,7 +76,110 @@ gst_geometric_transform_off_edges_pixels_method_get_type (void)
   return method_type;
 }
 
+#define GST_GT_INTERPOLATION_METHOD_TYPE ( \
+    gst_geometric_transform_interpolation_method_get_type())
+static GType
+gst_geometric_transform_interpolation_method_get_type (void)
+{
+  static GType method_type = 0;
+
+  static const GEnumValue method_types[] = {
+    {GST_GT_INTERPOLATION_NEAREST, "Nearest neighbour", "nearest"},
+    {GST_GT_INTERPOLATION_BILINEAR, "Bilinear", "bilinear"},
+    {0, NULL, NULL}
+  };
+
+  if (!method_type) {
+    method_type =
+        g_enum_register_static ("GstGeometricTransformInterpolationMethod",
+        method_types);
+  }
+  return method_type;
+}
+
 #define DEFAULT_OFF_EDGE_PIXELS GST_GT_OFF_EDGES_PIXELS_IGNORE
+#define DEFAULT_INTERPOLATION GST_GT_INTERPOLATION_NEAREST
+#define DEFAULT_N_THREADS 1
+
+/* bilinear weights are in 1/128 units so that the sum of the four weights
+ * of a pixel fits in 14 bits */
+#define GT_WEIGHT_BITS 7
+#define GT_WEIGHT_ONE (1 << GT_WEIGHT_BITS)
+
+static gboolean
+gst_geometric_transform_use_bilinear (GstGeometricTransform * gt)
+{
+  /* only formats with 8 bits per component are interpolated */
+  return gt->interpolation == GST_GT_INTERPOLATION_BILINEAR
+      && gt->format != GST_VIDEO_FORMAT_GRAY16_BE
+      && gt->format != GST_VIDEO_FORMAT_GRAY16_LE
+      && gt->width > 1 && gt->height > 1;
+}
+
+/* resolves the input position of an output pixel into an input byte offset
+ * (and bilinear weights), applying the off edge pixels method */
+static void
+gst_geometric_transform_resolve (GstGeometricTransform * gt, gdouble in_x,
+    gdouble in_y, gboolean bilinear, gint32 * offset, guint16 * weights)
+{
+  gint trunc_x, trunc_y;
+
+  /* operate on out of edge pixels */
+  switch (gt->off_edge_pixels) {
+    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
+      in_x = CLAMP (in_x, 0, gt->width - 1);
+      in_y = CLAMP (in_y, 0, gt->height - 1);
+      break;
+
+    case GST_GT_OFF_EDGES_PIXELS_WRAP:
+      in_x = gst_gm_mod_float (in_x, gt->width);
+      in_y = gst_gm_mod_float (in_y, gt->height);
+      if (in_x < 0)
+        in_x += gt->width;
+      if (in_y < 0)
+        in_y += gt->height;
+      break;
+
+    default:
+      break;
+  }
+
+  trunc_x = (gint) in_x;
+  trunc_y = (gint) in_y;
+
+  /* only set the values if the values are valid */
+  if (trunc_x < 0 || trunc_x >= gt->width || trunc_y < 0 ||
+      trunc_y >= gt->height) {
+    *offset = -1;
+    if (weights)
+      *weights = 0;
+    return;
+  }
+
+  if (bilinear) {
+    gint fx, fy;
+
+    /* the top-left pixel is moved inwards at the right and bottom edges
+     * so that its neighbours are always inside the frame */
+    fx = (gint) ((in_x - trunc_x) * GT_WEIGHT_ONE + 0.5);
+    fy = (gint) ((in_y - trunc_y) * GT_WEIGHT_ONE + 0.5);
+    if (in_x < 0)
+      fx = 0;
+    if (in_y < 0)
+      fy = 0;
+    if (trunc_x == gt->width - 1) {
+      trunc_x--;
+      fx = GT_WEIGHT_ONE;
+    }
+    if (trunc_y == gt->height - 1) {
+      trunc_y--;
+      fy = GT_WEIGHT_ONE;
+    }
+    *weights = fx | (fy << 8);
+  }
+
+  *offset = trunc_y * gt->row_stride + trunc_x * gt->pixel_stride;
+}
 
 /* must be called with the object lock */
 static gboolean
@@ -83,25 +188,29 @@ gst_geometric_transform_generate_map (GstGeometricTransform * gt)
   gint x, y;
   gdouble in_x, in_y;
   gboolean ret = TRUE;
+  gboolean bilinear;
   GstGeometricTransformClass *klass;
-  gdouble *ptr;
-
-  GST_INFO_OBJECT (gt, "Generating new transform map");
+  gint32 *offsets;
+  guint16 *weights;
 
-  /* cleanup old map */
-  g_free (gt->map);
-  gt->map = NULL;
+  GST_LOG_OBJECT (gt, "Generating new transform map");
 
   klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
 
   /* subclass must have defined the map_func */
   g_return_val_if_fail (klass->map_func, FALSE);
 
-  /*
-   * (x,y) pairs of the inverse mapping
-   */
-  gt->map = g_malloc0 (sizeof (gdouble) * gt->width * gt->height * 2);
-  ptr = gt->map;
+  bilinear = gst_geometric_transform_use_bilinear (gt);
+
+  /* the map is only reallocated when its size changes, which does not
+   * happen for subclasses regenerating it for each frame */
+  if (gt->map_offsets == NULL)
+    gt->map_offsets = g_new (gint32, gt->width * gt->height);
+  if (bilinear && gt->map_weights == NULL)
+    gt->map_weights = g_new (guint16, gt->width * gt->height);
+
+  offsets = gt->map_offsets;
+  weights = bilinear ? gt->map_weights : NULL;
 
   for (y = 0; y < gt->height; y++) {
     for (x = 0; x < gt->width; x++) {
@@ -111,22 +220,35 @@ gst_geometric_transform_generate_map (GstGeometricTransform * gt)
         goto end;
       }
 
-      ptr[0] = in_x;
-      ptr[1] = in_y;
-      ptr += 2;
+      gst_geometric_transform_resolve (gt, in_x, in_y, bilinear, offsets,
+          weights);
+      offsets++;
+      if (weights)
+        weights++;
     }
   }
 
 end:
   if (!ret) {
     GST_WARNING_OBJECT (gt, "Generating transform map failed");
-    g_free (gt->map);
-    gt->map = NULL;
+    g_free (gt->map_offsets);
+    gt->map_offsets = NULL;
+    g_free (gt->map_weights);
+    gt->map_weights = NULL;
   } else
     gt->needs_remap = FALSE;
   return ret;
 }
 
+static void
+gst_geometric_transform_free_map (GstGeometricTransform * gt)
+{
+  g_free (gt->map_offsets);
+  gt->map_offsets = NULL;
+  g_free (gt->map_weights);
+  gt->map_weights = NULL;
+}
+
 static gboolean
 gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
     GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
@@ -135,6 +257,7 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
   gboolean ret = TRUE;
   gint old_width;
   gint old_height;
+  GstVideoFormat old_format;
   GstGeometricTransformClass *klass;
 
   gt = GST_GEOMETRIC_TRANSFORM_CAST (vfilter);
@@ -142,16 +265,20 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
 
   old_width = gt->width;
   old_height = gt->height;
+  old_format = gt->format;
 
+  /* regenerate the map */
+  GST_OBJECT_LOCK (gt);
   gt->width = in_info->width;
   gt->height = in_info->height;
+  gt->format = GST_VIDEO_INFO_FORMAT (in_info);
   gt->row_stride = in_info->stride[0];
   gt->pixel_stride = GST_VIDEO_INFO_COMP_PSTRIDE (in_info, 0);
 
-  /* regenerate the map */
-  GST_OBJECT_LOCK (gt);
-  if (gt->map == NULL || old_width == 0 || old_height == 0
-      || gt->width != old_width || gt->height != old_height) {
+  if (gt->map_offsets == NULL || old_width == 0 || old_height == 0
+      || gt->width != old_width || gt->height != old_height
+      || gt->format != old_format) {
+    gst_geometric_transform_free_map (gt);
     if (klass->prepare_func)
       if (!klass->prepare_func (gt)) {
         GST_OBJECT_UNLOCK (gt);
@@ -164,48 +291,167 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
   return ret;
 }
 
-static void
-gst_geometric_transform_do_map (GstGeometricTransform * gt, guint8 * in_data,
-    guint8 * out_data, gint x, gint y, gdouble in_x, gdouble in_y)
+/* sampling
+ *
+ * the rows of the output frame are split into slices which are processed on
+ * the slice runner */
+typedef struct
 {
-  gint in_offset;
-  gint out_offset;
+  GstGeometricTransform *gt;
+  const guint8 *in_data;
+  guint8 *out_data;
+  gint out_stride;
+  gboolean bilinear;
+} GstGeometricTransformSampleJob;
 
-  out_offset = y * gt->row_stride + x * gt->pixel_stride;
+static void
+sample_row_nearest (guint8 * out, const guint8 * in, const gint32 * offsets,
+    gint width, gint pixel_stride)
+{
+  gint x;
 
-  /* operate on out of edge pixels */
-  switch (gt->off_edge_pixels) {
-    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
-      in_x = CLAMP (in_x, 0, gt->width - 1);
-      in_y = CLAMP (in_y, 0, gt->height - 1);
+  switch (pixel_stride) {
+    case 4:
+      for (x = 0; x < width; x++) {
+        if (offsets[x] >= 0)
+          memcpy (out + 4 * x, in + offsets[x], 4);
+      }
       break;
-
-    case GST_GT_OFF_EDGES_PIXELS_WRAP:
-      in_x = gst_gm_mod_float (in_x, gt->width);
-      in_y = gst_gm_mod_float (in_y, gt->height);
-      if (in_x < 0)
-        in_x += gt->width;
-      if (in_y < 0)
-        in_y += gt->height;
+    case 3:
+      for (x = 0; x < width; x++) {
+        if (offsets[x] >= 0)
+          memcpy (out + 3 * x, in + offsets[x], 3);
+      }
+      break;
+    case 2:
+      for (x = 0; x < width; x++) {
+        if (offsets[x] >= 0)
+          memcpy (out + 2 * x, in + offsets[x], 2);
+      }
+      break;
+    case 1:
+      for (x = 0; x < width; x++) {
+        if (offsets[x] >= 0)
+          out[x] = in[offsets[x]];
+      }
       break;
-
     default:
+      for (x = 0; x < width; x++) {
+        if (offsets[x] >= 0)
+          memcpy (out + pixel_stride * x, in + offsets[x], pixel_stride);
+      }
       break;
   }
+}
+
+/* the fixed pixel stride variants let the compiler unroll and vectorise the
+ * component loop */
+#define SAMPLE_ROW_BILINEAR(n) \
+static void \
+sample_row_bilinear_##n (guint8 * out, const guint8 * in, \
+    const gint32 * offsets, const guint16 * weights, gint width, \
+    gint pixel_stride, gint row_stride) \
+{ \
+  gint x, c; \
+  \
+  for (x = 0; x < width; x++) { \
+    const guint8 *p00, *p01, *p10, *p11; \
+    guint8 *dst; \
+    guint fx, fy, w00, w01, w10, w11; \
+    \
+    if (offsets[x] < 0) \
+      continue; \
+    \
+    fx = weights[x] & 0xff; \
+    fy = weights[x] >> 8; \
+    w00 = (GT_WEIGHT_ONE - fx) * (GT_WEIGHT_ONE - fy); \
+    w01 = fx * (GT_WEIGHT_ONE - fy); \
+    w10 = (GT_WEIGHT_ONE - fx) * fy; \
+    w11 = fx * fy; \
+    \
+    p00 = in + offsets[x]; \
+    p01 = p00 + pixel_stride; \
+    p10 = p00 + row_stride; \
+    p11 = p10 + pixel_stride; \
+    \
+    /* indexed by x, as untouched pixels skip the loop body */ \
+    dst = out + x * pixel_stride; \
+    for (c = 0; c < (n ? n : pixel_stride); c++) \
+      dst[c] = (p00[c] * w00 + p01[c] * w01 + p10[c] * w10 + p11[c] * w11 + \
+          (1 << (2 * GT_WEIGHT_BITS - 1))) >> (2 * GT_WEIGHT_BITS); \
+  } \
+}
 
-  {
-    gint trunc_x = (gint) in_x;
-    gint trunc_y = (gint) in_y;
-    /* only set the values if the values are valid */
-    if (trunc_x >= 0 && trunc_x < gt->width && trunc_y >= 0 &&
-        trunc_y < gt->height) {
-      in_offset = trunc_y * gt->row_stride + trunc_x * gt->pixel_stride;
+SAMPLE_ROW_BILINEAR (0)
+SAMPLE_ROW_BILINEAR (1)
+SAMPLE_ROW_BILINEAR (3)
+SAMPLE_ROW_BILINEAR (4)
 
-      memcpy (out_data + out_offset, in_data + in_offset, gt->pixel_stride);
+static void
+gst_geometric_transform_sample_slice (gpointer data, guint slice,
+    guint n_slices)
+{
+  GstGeometricTransformSampleJob *job = data;
+  GstGeometricTransform *gt = job->gt;
+  gint y, y_start, y_end;
+
+  y_start = GST_SLICE_START (gt->height, slice, n_slices);
+  y_end = GST_SLICE_END (gt->height, slice, n_slices);
+
+  for (y = y_start; y < y_end; y++) {
+    const gint32 *offsets = gt->map_offsets + y * gt->width;
+    guint8 *out = job->out_data + y * job->out_stride;
+
+    if (job->bilinear) {
+      const guint16 *weights = gt->map_weights + y * gt->width;
+
+      switch (gt->pixel_stride) {
+        case 4:
+          sample_row_bilinear_4 (out, job->in_data, offsets, weights,
+              gt->width, 4, gt->row_stride);
+          break;
+        case 3:
+          sample_row_bilinear_3 (out, job->in_data, offsets, weights,
+              gt->width, 3, gt->row_stride);
+          break;
+        case 1:
+          sample_row_bilinear_1 (out, job->in_data, offsets, weights,
+              gt->width, 1, gt->row_stride);
+          break;
+        default:
+          sample_row_bilinear_0 (out, job->in_data, offsets, weights,
+              gt->width, gt->pixel_stride, gt->row_stride);
+          break;
+      }
+    } else {
+      sample_row_nearest (out, job->in_data, offsets, gt->width,
+          gt->pixel_stride);
     }
   }
 }
 
+/* must be called with the object lock */
+static void
+gst_geometric_transform_update_slices (GstGeometricTransform * gt)
+{
+  GError *err = NULL;
+
+  if (!gst_slice_runner_set_n_threads (&gt->slices, gt->n_threads, &err)) {
+    GST_WARNING_OBJECT (gt, "Failed to create slice thread pool: %s",
+        err->message);
+    g_clear_error (&err);
+  }
+}
+
+static void
+gst_geometric_transform_sample (GstGeometricTransform * gt,
+    GstGeometricTransformSampleJob * job)
+{
+  gst_geometric_transform_update_slices (gt);
+  gst_slice_runner_run (&gt->slices, gt->height,
+      gst_geometric_transform_sample_slice, job);
+}
+
 static void
 gst_geometric_transform_before_transform (GstBaseTransform * trans,
     GstBuffer * outbuf)
@@ -229,16 +475,14 @@ gst_geometric_transform_transform_frame (GstVideoFilter * vfilter,
 {
   GstGeometricTransform *gt;
   GstGeometricTransformClass *klass;
-  gint x, y, i;
+  GstGeometricTransformSampleJob job;
+  gint i;
   GstFlowReturn ret = GST_FLOW_OK;
-  gdouble *ptr;
-  guint8 *in_data;
   guint8 *out_data;
 
   gt = GST_GEOMETRIC_TRANSFORM_CAST (vfilter);
   klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
 
-  in_data = GST_VIDEO_FRAME_PLANE_DATA (in_frame, 0);
   out_data = GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0);
 
   if (GST_VIDEO_FRAME_FORMAT (out_frame) == GST_VIDEO_FORMAT_AYUV) {
@@ -252,41 +496,28 @@ gst_geometric_transform_transform_frame (GstVideoFilter * vfilter,
   }
 
   GST_OBJECT_LOCK (gt);
-  if (gt->precalc_map) {
-    if (gt->needs_remap) {
-      if (klass->prepare_func)
-        if (!klass->prepare_func (gt)) {
-          ret = FALSE;
-          goto end;
-        }
-      gst_geometric_transform_generate_map (gt);
-    }
-    g_return_val_if_fail (gt->map, GST_FLOW_ERROR);
-    ptr = gt->map;
-    for (y = 0; y < gt->height; y++) {
-      for (x = 0; x < gt->width; x++) {
-        /* do the mapping */
-        gst_geometric_transform_do_map (gt, in_data, out_data, x, y, ptr[0],
-            ptr[1]);
-        ptr += 2;
-      }
-    }
-  } else {
-    for (y = 0; y < gt->height; y++) {
-      for (x = 0; x < gt->width; x++) {
-        gdouble in_x, in_y;
-
-        if (klass->map_func (gt, x, y, &in_x, &in_y)) {
-          gst_geometric_transform_do_map (gt, in_data, out_data, x, y, in_x,
-              in_y);
-        } else {
-          GST_WARNING_OBJECT (gt, "Failed to do mapping for %d %d", x, y);
-          ret = GST_FLOW_ERROR;
-          goto end;
-        }
+  /* subclasses without a precalculated map get a new map for each frame */
+  if (gt->needs_remap || !gt->precalc_map || gt->map_offsets == NULL) {
+    if (gt->precalc_map && klass->prepare_func)
+      if (!klass->prepare_func (gt)) {
+        ret = GST_FLOW_ERROR;
+        goto end;
       }
+    if (!gst_geometric_transform_generate_map (gt)) {
+      ret = GST_FLOW_ERROR;
+      goto end;
     }
   }
+
+  job.gt = gt;
+  job.in_data = GST_VIDEO_FRAME_PLANE_DATA (in_frame, 0);
+  job.out_data = out_data;
+  job.out_stride = GST_VIDEO_FRAME_PLANE_STRIDE (out_frame, 0);
+  job.bilinear = gst_geometric_transform_use_bilinear (gt)
+      && gt->map_weights != NULL;
+
+  gst_geometric_transform_sample (gt, &job);
+
 end:
   GST_OBJECT_UNLOCK (gt);
   return ret;
@@ -304,6 +535,19 @@ gst_geometric_transform_set_property (GObject * object, guint prop_id,
     case PROP_OFF_EDGE_PIXELS:
       GST_OBJECT_LOCK (gt);
       gt->off_edge_pixels = g_value_get_enum (value);
+      /* the off edge pixels method is applied when generating the map */
+      gst_geometric_transform_set_need_remap (gt);
+      GST_OBJECT_UNLOCK (gt);
+      break;
+    case PROP_INTERPOLATION:
+      GST_OBJECT_LOCK (gt);
+      gt->interpolation = g_value_get_enum (value);
+      gst_geometric_transform_set_need_remap (gt);
+      GST_OBJECT_UNLOCK (gt);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (gt);
+      gt->n_threads = g_value_get_uint (value);
       GST_OBJECT_UNLOCK (gt);
       break;
     default:
@@ -324,6 +568,12 @@ gst_geometric_transform_get_property (GObject * object, guint prop_id,
     case PROP_OFF_EDGE_PIXELS:
       g_value_set_enum (value, gt->off_edge_pixels);
       break;
+    case PROP_INTERPOLATION:
+      g_value_set_enum (value, gt->interpolation);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, gt->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -341,8 +591,9 @@ gst_geometric_transform_stop (GstBaseTransform * trans)
   gt->width = 0;
   gt->height = 0;
 
-  g_free (gt->map);
-  gt->map = NULL;
+  gst_geometric_transform_free_map (gt);
+
+  gst_slice_runner_clear (&gt->slices);
 
   return TRUE;
 }
@@ -389,7 +640,36 @@ gst_geometric_transform_class_init (gpointer klass, gpointer class_data)
           GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE, DEFAULT_OFF_EDGE_PIXELS,
           GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstGeometricTransform:interpolation:
+   *
+   * How input pixels are sampled. Bilinear interpolation is only done for
+   * formats with 8 bits per component, others always use the nearest
+   * neighbour.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (obj_class, PROP_INTERPOLATION,
+      g_param_spec_enum ("interpolation", "Interpolation",
+          "How input pixels are sampled", GST_GT_INTERPOLATION_METHOD_TYPE,
+          DEFAULT_INTERPOLATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstGeometricTransform:n-threads:
+   *
+   * Number of threads the output rows are sampled on, 0 for one per
+   * processor.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (obj_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads to use (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_type_mark_as_plugin_api (GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE, 0);
+  gst_type_mark_as_plugin_api (GST_GT_INTERPOLATION_METHOD_TYPE, 0);
   gst_type_mark_as_plugin_api (GST_TYPE_GEOMETRIC_TRANSFORM, 0);
 }
 
@@ -399,6 +679,8 @@ gst_geometric_transform_init (GTypeInstance * instance, gpointer g_class)
   GstGeometricTransform *gt = GST_GEOMETRIC_TRANSFORM_CAST (instance);
 
   gt->off_edge_pixels = DEFAULT_OFF_EDGE_PIXELS;
+  gt->interpolation = DEFAULT_INTERPOLATION;
+  gt->n_threads = DEFAULT_N_THREADS;
   gt->precalc_map = TRUE;
   gt->needs_remap = TRUE;
 }
@@ -22,6 +22,7 @@
 
 #include <gst/video/gstvideofilter.h>
 #include <gst/video/video.h>
+#include <gst/slice-runner-private.h>
 
 G_BEGIN_DECLS
 
@@ -46,6 +47,12 @@ enum
   GST_GT_OFF_EDGES_PIXELS_WRAP
 };
 
+enum
+{
+  GST_GT_INTERPOLATION_NEAREST = 0,
+  GST_GT_INTERPOLATION_BILINEAR
+};
+
 typedef struct _GstGeometricTransform GstGeometricTransform;
 typedef struct _GstGeometricTransformClass GstGeometricTransformClass;
 
@@ -99,8 +106,17 @@ struct _GstGeometricTransform {
 
   /* properties */
   gint off_edge_pixels;
+  gint interpolation;
+  guint n_threads;
+
+  /* For each output pixel, the byte offset of the (top-left) input pixel or
+   * -1 if the output pixel is left untouched. With bilinear interpolation,
+   * map_weights holds the horizontal and vertical weights of the right and
+   * bottom neighbours in 1/128 units in the low and high byte. */
+  gint32 *map_offsets;
+  guint16 *map_weights;
 
-  gdouble *map;
+  GstSliceRunner slices;
 };
 
 struct _GstGeometricTransformClass {
@@ -60,12 +60,15 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     );
 
 static int DEFAULT_IGNORE_PCR = FALSE;
+#define DEFAULT_DROP_REPEATED_SECTIONS FALSE
 
 enum
 {
   PROP_0,
   PROP_PARSE_PRIVATE_SECTIONS,
   PROP_IGNORE_PCR,
+  PROP_DROP_REPEATED_SECTIONS,
+  PROP_SECTION_STATS,
   /* FILL ME */
 };
 
@@ -164,6 +167,42 @@ mpegts_base_class_init (MpegTSBaseClass * klass)
           "Ignore PCR stream for timing", DEFAULT_IGNORE_PCR,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMpegtsBase:drop-repeated-sections:
+   *
+   * Only parse and post sections other than PAT, CAT and PMT again when
+   * their content changes. Applications then only get a section message
+   * for the first copy of each EIT, SDT, NIT, etc. section, and no longer
+   * for each of its repetitions. An identical section is recognised by its
+   * CRC_32 before it is parsed.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_DROP_REPEATED_SECTIONS,
+      g_param_spec_boolean ("drop-repeated-sections",
+          "Drop repeated sections",
+          "Only output sections other than PAT, CAT and PMT when they change",
+          DEFAULT_DROP_REPEATED_SECTIONS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMpegtsBase:section-stats:
+   *
+   * Statistics about repeated PSI/SI sections, if
+   * #GstMpegtsBase:drop-repeated-sections is enabled. This property
+   * returns a #GstStructure with name
+   * `application/x-mpegts-section-stats` with the following fields:
+   *
+   * - #guint64 `cache-hits`: repeated sections that were dropped
+   * - #guint64 `cache-misses`: new or changed sections that were output
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_SECTION_STATS,
+      g_param_spec_boxed ("section-stats", "Section statistics",
+          "Statistics about repeated sections", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   klass->sink_query = GST_DEBUG_FUNCPTR (mpegts_base_default_sink_query);
   klass->handle_psi = NULL;
 
@@ -183,6 +222,9 @@ mpegts_base_set_property (GObject * object, guint prop_id,
     case PROP_IGNORE_PCR:
       base->ignore_pcr = g_value_get_boolean (value);
       break;
+    case PROP_DROP_REPEATED_SECTIONS:
+      base->packetizer->drop_repeated_sections = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -201,6 +243,20 @@ mpegts_base_get_property (GObject * object, guint prop_id,
     case PROP_IGNORE_PCR:
       g_value_set_boolean (value, base->ignore_pcr);
       break;
+    case PROP_DROP_REPEATED_SECTIONS:
+      g_value_set_boolean (value, base->packetizer->drop_repeated_sections);
+      break;
+    case PROP_SECTION_STATS:{
+      guint hits, misses;
+
+      hits = g_atomic_int_get (&base->packetizer->section_cache_hits);
+      misses = g_atomic_int_get (&base->packetizer->section_cache_misses);
+      g_value_take_boxed (value,
+          gst_structure_new ("application/x-mpegts-section-stats",
+              "cache-hits", G_TYPE_UINT64, (guint64) hits, "cache-misses",
+              G_TYPE_UINT64, (guint64) misses, NULL));
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -284,6 +340,7 @@ mpegts_base_init (MpegTSBase * base)
   base->push_data = TRUE;
   base->push_section = TRUE;
   base->ignore_pcr = DEFAULT_IGNORE_PCR;
+  base->packetizer->drop_repeated_sections = DEFAULT_DROP_REPEATED_SECTIONS;
 
   mpegts_base_reset (base);
 }
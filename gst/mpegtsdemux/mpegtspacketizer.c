@@ -191,6 +191,34 @@ seen_section_before (MpegTSPacketizerStream * stream, guint8 table_id,
   return FALSE;
 }
 
+/* Whether sections of @table_id are only output when their content changes.
+ * PAT, CAT and PMT are always output since mpegtsbase relies on them after
+ * flushes */
+#define SECTION_IS_CACHED(packetizer, table_id) \
+    ((packetizer)->drop_repeated_sections && \
+     (table_id) > GST_MTS_TABLE_ID_TS_PROGRAM_MAP)
+
+/* Whether a section with the same CRC_32 was already output */
+static gboolean
+seen_section_crc_before (MpegTSPacketizerStream * stream, guint8 table_id,
+    guint16 subtable_extension, guint8 version_number, guint8 section_number,
+    guint8 last_section_number, guint32 crc)
+{
+  MpegTSPacketizerStreamSubtable *subtable;
+
+  subtable = find_subtable (stream->subtables, table_id, subtable_extension);
+  if (!subtable || !subtable->section_crc ||
+      section_number > last_section_number)
+    return FALSE;
+
+  if (subtable->version_number != version_number ||
+      subtable->last_section_number != last_section_number ||
+      !MPEGTS_BIT_IS_SET (subtable->seen_section, section_number))
+    return FALSE;
+
+  return subtable->section_crc[section_number] == crc;
+}
+
 static MpegTSPacketizerStreamSubtable *
 mpegts_packetizer_stream_subtable_new (guint8 table_id,
     guint16 subtable_extension, guint8 last_section_number)
@@ -233,6 +261,7 @@ static void
 mpegts_packetizer_stream_subtable_free (MpegTSPacketizerStreamSubtable *
     subtable)
 {
+  g_free (subtable->section_crc);
   g_free (subtable);
 }
 
@@ -257,6 +286,17 @@ mpegts_packetizer_class_init (MpegTSPacketizer2Class * klass)
   gobject_class->finalize = mpegts_packetizer_finalize;
 }
 
+static void
+mpegts_packetizer_clear_buffers (MpegTSPacketizer2 * packetizer)
+{
+  GstBuffer *buf;
+
+  while ((buf = g_queue_pop_head (&packetizer->buffers)))
+    gst_buffer_unref (buf);
+  packetizer->buffers_skip = 0;
+  packetizer->buffers_untracked = 0;
+}
+
 static void
 mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
 {
@@ -274,6 +314,10 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
   packetizer->need_sync = FALSE;
+  packetizer->track_buffers = FALSE;
+  g_queue_init (&packetizer->buffers);
+  packetizer->buffers_skip = 0;
+  packetizer->buffers_untracked = 0;
 
   memset (packetizer->pcrtablelut, 0xff, 0x2000);
   memset (packetizer->observations, 0x0, sizeof (packetizer->observations));
@@ -307,6 +351,7 @@ mpegts_packetizer_dispose (GObject * object)
 
     gst_adapter_clear (packetizer->adapter);
     g_object_unref (packetizer->adapter);
+    mpegts_packetizer_clear_buffers (packetizer);
     g_mutex_clear (&packetizer->group_lock);
     packetizer->disposed = TRUE;
     packetizer->offset = 0;
@@ -535,6 +580,8 @@ mpegts_packetizer_parse_section_header (MpegTSPacketizer2 * packetizer,
       subtable->version_number = stream->version_number;
       subtable->last_section_number = stream->last_section_number;
       memset (subtable->seen_section, 0, 32);
+      g_free (subtable->section_crc);
+      subtable->section_crc = NULL;
     }
   } else {
     GST_DEBUG ("Appending new subtable_extension: 0x%04x",
@@ -575,6 +622,18 @@ mpegts_packetizer_parse_section_header (MpegTSPacketizer2 * packetizer,
      * */
     MPEGTS_BIT_SET (subtable->seen_section, stream->section_number);
     res->offset = stream->offset;
+
+    /* Only remember sections with a valid CRC, so that a corrupted copy
+     * doesn't cause the following good ones to be dropped */
+    if (!res->short_section && SECTION_IS_CACHED (packetizer, res->table_id)
+        && subtable->last_section_number == res->last_section_number &&
+        gst_mpegts_calc_crc32 (res->data, res->section_length) == 0) {
+      if (!subtable->section_crc)
+        subtable->section_crc =
+            g_new0 (guint32, subtable->last_section_number + 1);
+      subtable->section_crc[res->section_number] = res->crc;
+      g_atomic_int_inc (&packetizer->section_cache_misses);
+    }
   }
 
   return res;
@@ -599,8 +658,11 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
   }
 
   gst_adapter_clear (packetizer->adapter);
+  mpegts_packetizer_clear_buffers (packetizer);
   packetizer->offset = 0;
   packetizer->empty = TRUE;
+  g_atomic_int_set (&packetizer->section_cache_hits, 0);
+  g_atomic_int_set (&packetizer->section_cache_misses, 0);
   packetizer->need_sync = FALSE;
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
@@ -640,6 +702,7 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer, gboolean hard)
     }
   }
   gst_adapter_clear (packetizer->adapter);
+  mpegts_packetizer_clear_buffers (packetizer);
 
   packetizer->offset = 0;
   packetizer->empty = TRUE;
@@ -705,6 +768,8 @@ mpegts_packetizer_push (MpegTSPacketizer2 * packetizer, GstBuffer * buffer)
   GST_DEBUG ("Pushing %" G_GSIZE_FORMAT " byte from offset %"
       G_GUINT64_FORMAT, gst_buffer_get_size (buffer),
       GST_BUFFER_OFFSET (buffer));
+  if (packetizer->track_buffers)
+    g_queue_push_tail (&packetizer->buffers, gst_buffer_ref (buffer));
   gst_adapter_push (packetizer->adapter, buffer);
   /* If the buffer has a valid timestamp, store it - preferring DTS,
    * which is where upstream arrival times should be stored */
@@ -715,12 +780,44 @@ mpegts_packetizer_push (MpegTSPacketizer2 * packetizer, GstBuffer * buffer)
   packetizer->last_dts = GST_BUFFER_DTS (buffer);
 }
 
+/* Drops the first @size bytes from the buffers mirroring the adapter */
+static void
+mpegts_packetizer_flush_buffers (MpegTSPacketizer2 * packetizer, gsize size)
+{
+  if (!packetizer->track_buffers)
+    return;
+
+  /* the data that was in the adapter before tracking started goes first */
+  if (size <= packetizer->buffers_untracked) {
+    packetizer->buffers_untracked -= size;
+    return;
+  }
+  size -= packetizer->buffers_untracked;
+  packetizer->buffers_untracked = 0;
+
+  size += packetizer->buffers_skip;
+
+  while (!g_queue_is_empty (&packetizer->buffers)) {
+    GstBuffer *buf = g_queue_peek_head (&packetizer->buffers);
+    gsize buf_size = gst_buffer_get_size (buf);
+
+    if (size < buf_size)
+      break;
+
+    size -= buf_size;
+    gst_buffer_unref (g_queue_pop_head (&packetizer->buffers));
+  }
+
+  packetizer->buffers_skip = size;
+}
+
 static void
 mpegts_packetizer_flush_bytes (MpegTSPacketizer2 * packetizer, gsize size)
 {
   if (size > 0) {
     GST_LOG ("flushing %" G_GSIZE_FORMAT " bytes from adapter", size);
     gst_adapter_flush (packetizer->adapter, size);
+    mpegts_packetizer_flush_buffers (packetizer, size);
   }
 
   packetizer->map_data = NULL;
@@ -915,6 +1012,86 @@ mpegts_packetizer_process_next_packet (MpegTSPacketizer2 * packetizer)
   return ret;
 }
 
+/**
+ * mpegts_packetizer_set_track_buffers:
+ * @track: whether to keep references to the input buffers
+ *
+ * Input buffers are only kept around for mpegts_packetizer_get_buffer() when
+ * @track is %TRUE. After enabling it, mpegts_packetizer_get_buffer() fails
+ * for the data that was already in the adapter.
+ */
+void
+mpegts_packetizer_set_track_buffers (MpegTSPacketizer2 * packetizer,
+    gboolean track)
+{
+  if (packetizer->track_buffers == track)
+    return;
+
+  mpegts_packetizer_clear_buffers (packetizer);
+  packetizer->track_buffers = track;
+  if (track)
+    packetizer->buffers_untracked =
+        gst_adapter_available (packetizer->adapter);
+}
+
+/**
+ * mpegts_packetizer_get_buffer:
+ * @data: start of the data, inside the packet currently being processed
+ * @size: number of bytes
+ *
+ * Returns a buffer sharing the memory of the input buffer(s) @data..@data+@size
+ * was read from, so packet payloads can be forwarded without copying them.
+ * The result spans several memories if the range crosses input buffers.
+ *
+ * Returns: (transfer full) (nullable): the buffer, or %NULL if the data is
+ *   not part of the currently mapped input.
+ */
+GstBuffer *
+mpegts_packetizer_get_buffer (MpegTSPacketizer2 * packetizer,
+    const guint8 * data, gsize size)
+{
+  GstBuffer *res = NULL;
+  GList *walk;
+  gsize pos;
+
+  /* map_data always starts at the head of the adapter */
+  if (G_UNLIKELY (!packetizer->track_buffers || packetizer->map_data == NULL
+          || data < packetizer->map_data
+          || data + size > packetizer->map_data + packetizer->map_size))
+    return NULL;
+
+  pos = data - packetizer->map_data;
+  if (pos < packetizer->buffers_untracked)
+    return NULL;
+  pos = pos - packetizer->buffers_untracked + packetizer->buffers_skip;
+
+  for (walk = packetizer->buffers.head; walk && size > 0; walk = walk->next) {
+    GstBuffer *buf = walk->data;
+    gsize buf_size = gst_buffer_get_size (buf);
+    gsize len;
+
+    if (pos >= buf_size) {
+      pos -= buf_size;
+      continue;
+    }
+
+    len = MIN (size, buf_size - pos);
+    if (res == NULL)
+      res = gst_buffer_copy_region (buf, GST_BUFFER_COPY_MEMORY, pos, len);
+    else
+      res = gst_buffer_append_region (res, gst_buffer_ref (buf), pos, len);
+    size -= len;
+    pos = 0;
+  }
+
+  if (G_UNLIKELY (size > 0)) {
+    GST_WARNING ("Data not found in input buffers");
+    gst_clear_buffer (&res);
+  }
+
+  return res;
+}
+
 void
 mpegts_packetizer_clear_packet (MpegTSPacketizer2 * packetizer,
     MpegTSPacketizerPacket * packet)
@@ -1080,7 +1257,19 @@ accumulate_data:
         stream->pid, stream->section_offset, stream->section_length);
   GST_DEBUG ("PID 0x%04x Section complete", stream->pid);
 
-  if ((section = mpegts_packetizer_parse_section_header (packetizer, stream))) {
+  if (SECTION_IS_CACHED (packetizer, stream->table_id)
+      && (stream->section_data[1] & 0x80)
+      && stream->section_length >= 12 && seen_section_crc_before (stream,
+          stream->table_id, stream->subtable_extension, stream->version_number,
+          stream->section_number, stream->last_section_number,
+          GST_READ_UINT32_BE (stream->section_data + stream->section_length -
+              4))) {
+    GST_DEBUG ("PID 0x%04x Dropping repeated table_id:0x%02x section_number:%d",
+        stream->pid, stream->table_id, stream->section_number);
+    g_atomic_int_inc (&packetizer->section_cache_hits);
+    mpegts_packetizer_clear_section (stream);
+  } else if ((section =
+          mpegts_packetizer_parse_section_header (packetizer, stream))) {
     if (res)
       others = g_list_append (others, section);
     else
@@ -1215,6 +1404,23 @@ section_start:
       goto out;
     goto section_start;
   }
+  /* If the full section is in this packet, its CRC_32 tells whether it's
+   * identical to a section we already output */
+  if (long_packet && SECTION_IS_CACHED (packetizer, table_id)
+      && section_length >= 12 && to_read == section_length
+      && seen_section_crc_before (stream, table_id, subtable_extension,
+          version_number, section_number, last_section_number,
+          GST_READ_UINT32_BE (data_start + section_length - 4))) {
+    GST_DEBUG ("PID 0x%04x Dropping repeated table_id:0x%02x "
+        "subtable_extension:0x%04x, version_number:%d, section_number:%d",
+        packet->pid, table_id, subtable_extension, version_number,
+        section_number);
+    g_atomic_int_inc (&packetizer->section_cache_hits);
+    data = data_start + to_read;
+    if (data == packet->data_end || *data == 0xff)
+      goto out;
+    goto section_start;
+  }
   if (G_UNLIKELY (section_number > last_section_number)) {
     GST_WARNING
         ("PID 0x%04x corrupted packet (section_number:%d > last_section_number:%d)",
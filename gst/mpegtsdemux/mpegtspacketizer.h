@@ -269,6 +269,16 @@ struct _MpegTSPacketizer2 {
   gsize map_size;
   gboolean need_sync;
 
+  /* The buffers currently held by the adapter, oldest first, and the number
+   * of bytes already flushed from the first one. Used to hand out references
+   * to packet data with mpegts_packetizer_get_buffer(). Only kept with
+   * track_buffers, which starts with buffers_untracked bytes in the adapter
+   * that are not part of them */
+  gboolean track_buffers;
+  GQueue buffers;
+  gsize buffers_skip;
+  gsize buffers_untracked;
+
   /* Reference offset */
   guint64 refoffset;
 
@@ -291,6 +301,15 @@ struct _MpegTSPacketizer2 {
   /* Extra time offset to handle values before initial PCR.
    * This will be added to all converted timestamps */
   GstClockTime extra_shift;
+
+  /* Whether repeated sections other than PAT, CAT and PMT are dropped */
+  gboolean drop_repeated_sections;
+
+  /* Sections dropped because identical to an already output one, and
+   * sections output after a CRC check. Atomic, as they are read from the
+   * application thread */
+  guint section_cache_hits;
+  guint section_cache_misses;
 };
 
 struct _MpegTSPacketizer2Class {
@@ -331,6 +350,9 @@ typedef struct
    * Use MPEGTS_BIT_* macros to check */
   /* Size is 32, because there's a maximum of 256 (32*8) section_number */
   guint8   seen_section[32];
+  /* CRC_32 of each seen section (last_section_number + 1 entries), used
+   * to drop identical repetitions (optional) */
+  guint32 *section_crc;
 } MpegTSPacketizerStreamSubtable;
 
 #define MPEGTS_BIT_SET(field, offs)    ((field)[(offs) >> 3] |=  (1 << ((offs) & 0x7)))
@@ -354,6 +376,10 @@ G_GNUC_INTERNAL MpegTSPacketizerPacketReturn mpegts_packetizer_next_packet (Mpeg
   MpegTSPacketizerPacket *packet);
 G_GNUC_INTERNAL MpegTSPacketizerPacketReturn
 mpegts_packetizer_process_next_packet(MpegTSPacketizer2 * packetizer);
+G_GNUC_INTERNAL void mpegts_packetizer_set_track_buffers (MpegTSPacketizer2 *packetizer,
+					 gboolean track);
+G_GNUC_INTERNAL GstBuffer *mpegts_packetizer_get_buffer (MpegTSPacketizer2 *packetizer,
+					 const guint8 *data, gsize size);
 G_GNUC_INTERNAL void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetizer,
 				     MpegTSPacketizerPacket *packet);
 G_GNUC_INTERNAL void mpegts_packetizer_remove_stream(MpegTSPacketizer2 *packetizer,
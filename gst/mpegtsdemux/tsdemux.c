@@ -75,6 +75,8 @@
 /* latency in msecs */
 #define DEFAULT_LATENCY (700)
 
+#define DEFAULT_ZERO_COPY FALSE
+
 /* Limit PES packet collection to a maximum of 32MB
  * which is more than large enough to support an H264 frame at
  * maximum profile/level/bitrate at 30fps or above.
@@ -187,6 +189,15 @@ struct _TSDemuxStream
   /* Size of ->data */
   guint allocated_size;
 
+  /* Data being reconstructed as references to the input buffers, used
+   * instead of ->data in zero-copy mode (optional). ->chunks holds at most
+   * gst_buffer_get_max_memory() memories, the previous full ones of the same
+   * PES are in ->chunk_list */
+  GstBuffer *chunks;
+  GstBufferList *chunk_list;
+  /* Whether the current PES had to be converted from ->chunks to ->data */
+  gboolean flattened;
+
   /* Current PTS/DTS for this stream (in running time) */
   GstClockTime pts;
   GstClockTime dts;
@@ -302,6 +313,8 @@ enum
   PROP_EMIT_STATS,
   PROP_LATENCY,
   PROP_SEND_SCTE35_EVENTS,
+  PROP_ZERO_COPY,
+  PROP_STATS,
   /* FILL ME */
 };
 
@@ -435,6 +448,43 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
           G_MAXINT, DEFAULT_LATENCY,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * tsdemux:zero-copy:
+   *
+   * Reassemble PES payloads as references into the incoming buffers
+   * instead of copying every TS packet payload into a new allocation.
+   *
+   * A PES spanning more memories than a #GstBuffer can hold is output as a
+   * buffer list for the video streams that are parsed downstream (MPEG-1/2,
+   * MPEG-4 part 2, H.264 and H.265), and flattened into a single memory for
+   * the other streams. Payloads are also flattened when the demuxer needs to
+   * parse them itself.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero copy",
+          "Reference PES payloads in the input buffers instead of copying them",
+          DEFAULT_ZERO_COPY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * tsdemux:stats:
+   *
+   * Various PES reassembly statistics. This property returns a
+   * #GstStructure with name `application/x-tsdemux-stats` with the
+   * following fields:
+   *
+   * - #guint64 `bytes-copied`: payload bytes copied during reassembly
+   * - #guint64 `bytes-shared`: payload bytes referenced without a copy
+   * - #guint64 `pes-flattened`: PES packets that had to be flattened
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "PES reassembly statistics", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   element_class = GST_ELEMENT_CLASS (klass);
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&video_template));
@@ -496,6 +546,10 @@ gst_ts_demux_reset (MpegTSBase * base)
   demux->program_generation = 0;
 
   demux->mpeg_pts_offset = 0;
+
+  GST_OBJECT_LOCK (demux);
+  mpegts_packetizer_set_track_buffers (base->packetizer, demux->zero_copy);
+  GST_OBJECT_UNLOCK (demux);
 }
 
 static void
@@ -512,6 +566,7 @@ gst_ts_demux_init (GstTSDemux * demux)
   demux->requested_program_number = -1;
   demux->program_number = -1;
   demux->latency = DEFAULT_LATENCY;
+  demux->zero_copy = DEFAULT_ZERO_COPY;
   gst_ts_demux_reset (base);
 
   g_mutex_init (&demux->lock);
@@ -539,6 +594,11 @@ gst_ts_demux_set_property (GObject * object, guint prop_id,
     case PROP_LATENCY:
       demux->latency = g_value_get_int (value);
       break;
+    case PROP_ZERO_COPY:
+      GST_OBJECT_LOCK (demux);
+      demux->zero_copy = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -563,6 +623,19 @@ gst_ts_demux_get_property (GObject * object, guint prop_id,
     case PROP_LATENCY:
       g_value_set_int (value, demux->latency);
       break;
+    case PROP_ZERO_COPY:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_boolean (value, demux->zero_copy);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_STATS:
+      GST_OBJECT_LOCK (demux);
+      g_value_take_boxed (value, gst_structure_new ("application/x-tsdemux-stats",
+              "bytes-copied", G_TYPE_UINT64, demux->bytes_copied,
+              "bytes-shared", G_TYPE_UINT64, demux->bytes_shared,
+              "pes-flattened", G_TYPE_UINT64, demux->pes_flattened, NULL));
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -2132,6 +2205,13 @@ activate_pad_for_stream (GstTSDemux * tsdemux, TSDemuxStream * stream)
   }
 }
 
+static void
+gst_ts_demux_stream_clear_chunks (TSDemuxStream * stream)
+{
+  gst_clear_buffer (&stream->chunks);
+  gst_clear_buffer_list (&stream->chunk_list);
+}
+
 static void
 gst_ts_demux_stream_flush (TSDemuxStream * stream, GstTSDemux * tsdemux,
     gboolean hard)
@@ -2140,6 +2220,7 @@ gst_ts_demux_stream_flush (TSDemuxStream * stream, GstTSDemux * tsdemux,
 
   g_free (stream->data);
   stream->data = NULL;
+  gst_ts_demux_stream_clear_chunks (stream);
   g_free (stream->pending_header_data);
   stream->pending_header_data = NULL;
   stream->pending_header_size = 0;
@@ -2588,12 +2669,114 @@ check_pending_buffers (GstTSDemux * demux)
   return TRUE;
 }
 
+/* Whether the payload of @stream can be output as references to the input
+ * buffers, which excludes the streams the demuxer needs to parse itself */
+static gboolean
+gst_ts_demux_stream_can_share (TSDemuxStream * stream)
+{
+  MpegTSBaseStream *bs = (MpegTSBaseStream *) stream;
+
+  if (stream->needs_keyframe)
+    return FALSE;
+
+  if (bs->stream_type == GST_MPEGTS_STREAM_TYPE_PRIVATE_PES_PACKETS &&
+      bs->registration_id == DRF_ID_OPUS)
+    return FALSE;
+
+  return bs->stream_type != GST_MPEGTS_STREAM_TYPE_VIDEO_JP2K &&
+      bs->stream_type != GST_MPEGTS_STREAM_TYPE_AUDIO_AAC_ADTS;
+}
+
+/* Whether a PES of @stream can be output in several buffers, because
+ * downstream parses the elementary stream anyway */
+static gboolean
+gst_ts_demux_stream_can_split (TSDemuxStream * stream)
+{
+  switch (((MpegTSBaseStream *) stream)->stream_type) {
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG1:
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG2:
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG4:
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_H264:
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_HEVC:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+/* Copies ->chunk_list and ->chunks into a newly allocated ->data, with room
+ * for @extra more bytes */
+static void
+gst_ts_demux_stream_flatten (TSDemuxStream * stream, guint extra)
+{
+  gsize offset = 0;
+
+  GST_LOG ("flattening %u bytes of pid 0x%04x", stream->current_size,
+      stream->stream.pid);
+
+  stream->allocated_size =
+      MAX (stream->expected_size, stream->current_size + extra);
+  stream->allocated_size = MAX (8192, stream->allocated_size);
+  stream->data = g_malloc (stream->allocated_size);
+
+  if (stream->chunk_list) {
+    guint i, n = gst_buffer_list_length (stream->chunk_list);
+
+    for (i = 0; i < n; i++) {
+      GstBuffer *chunk = gst_buffer_list_get (stream->chunk_list, i);
+
+      offset += gst_buffer_extract (chunk, 0, stream->data + offset,
+          gst_buffer_get_size (chunk));
+    }
+  }
+  gst_buffer_extract (stream->chunks, 0, stream->data + offset,
+      stream->current_size - offset);
+
+  gst_ts_demux_stream_clear_chunks (stream);
+  stream->flattened = TRUE;
+}
+
+/* Hands out the collected payload as a single buffer, or as a buffer list if
+ * it spans several chunks */
+static void
+gst_ts_demux_stream_take_output (TSDemuxStream * stream, GstBuffer ** buffer,
+    GstBufferList ** buffer_list)
+{
+  if (stream->chunk_list) {
+    gst_buffer_list_add (stream->chunk_list, stream->chunks);
+    *buffer_list = stream->chunk_list;
+    stream->chunk_list = NULL;
+    stream->chunks = NULL;
+  } else if (stream->chunks) {
+    *buffer = stream->chunks;
+    stream->chunks = NULL;
+  } else {
+    *buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+    stream->data = NULL;
+  }
+}
+
+static void
+gst_ts_demux_update_stats (GstTSDemux * demux, TSDemuxStream * stream)
+{
+  GST_OBJECT_LOCK (demux);
+  if (stream->chunks)
+    demux->bytes_shared += stream->current_size;
+  else
+    demux->bytes_copied += stream->current_size;
+  if (stream->flattened)
+    demux->pes_flattened++;
+  GST_OBJECT_UNLOCK (demux);
+}
+
 static void
 gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
     guint8 * data, guint32 length, guint64 bufferoffset)
 {
+  MpegTSBase *base = (MpegTSBase *) demux;
   PESHeader header;
   PESParsingResult parseres;
+  gboolean zero_copy;
 
   GST_MEMDUMP ("Header buffer", data, MIN (length, 32));
 
@@ -2663,15 +2846,37 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
   data += header.header_size;
   length -= header.header_size;
 
+  g_assert (stream->data == NULL && stream->chunks == NULL);
+  stream->flattened = FALSE;
+
+  GST_OBJECT_LOCK (demux);
+  zero_copy = demux->zero_copy;
+  GST_OBJECT_UNLOCK (demux);
+
+  /* The packetizer only keeps the input buffers around in zero-copy mode */
+  mpegts_packetizer_set_track_buffers (base->packetizer, zero_copy);
+
+  /* Reference the payload in the input buffer if possible. This fails if
+   * the header was reconstructed from several packets, or right after
+   * enabling zero-copy */
+  if (zero_copy && gst_ts_demux_stream_can_share (stream)) {
+    if (length > 0)
+      stream->chunks = mpegts_packetizer_get_buffer (base->packetizer, data,
+          length);
+    else
+      stream->chunks = gst_buffer_new ();
+  }
+
   /* Create the output buffer */
-  if (stream->expected_size)
-    stream->allocated_size = MAX (stream->expected_size, length);
-  else
-    stream->allocated_size = MAX (8192, length);
+  if (stream->chunks == NULL) {
+    if (stream->expected_size)
+      stream->allocated_size = MAX (stream->expected_size, length);
+    else
+      stream->allocated_size = MAX (8192, length);
 
-  g_assert (stream->data == NULL);
-  stream->data = g_malloc (stream->allocated_size);
-  memcpy (stream->data, data, length);
+    stream->data = g_malloc (stream->allocated_size);
+    memcpy (stream->data, data, length);
+  }
   stream->current_size = length;
 
   stream->state = PENDING_PACKET_BUFFER;
@@ -2702,6 +2907,7 @@ static inline void
 gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     MpegTSPacketizerPacket * packet)
 {
+  MpegTSBase *base = (MpegTSBase *) demux;
   guint8 *data;
   guint size;
   guint8 cc = FLAGS_CONTINUITY_COUNTER (packet->scram_afc_cc);
@@ -2726,6 +2932,7 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
           g_free (stream->data);
           stream->data = NULL;
         }
+        gst_ts_demux_stream_clear_chunks (stream);
         if (G_UNLIKELY (stream->pending_header_data)) {
           g_free (stream->pending_header_data);
           stream->pending_header_data = NULL;
@@ -2767,6 +2974,32 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     case PENDING_PACKET_BUFFER:
     {
       GST_LOG_OBJECT (demux, "BUFFER: appending data");
+      if (stream->chunks) {
+        GstBuffer *buf;
+
+        buf = mpegts_packetizer_get_buffer (base->packetizer, data, size);
+        if (buf && gst_buffer_n_memory (stream->chunks) +
+            gst_buffer_n_memory (buf) <= gst_buffer_get_max_memory ()) {
+          stream->chunks = gst_buffer_append (stream->chunks, buf);
+          stream->current_size += size;
+          break;
+        }
+
+        /* The chunk is full, start a new one if the PES can be output in
+         * several buffers */
+        if (buf && gst_ts_demux_stream_can_split (stream)) {
+          if (stream->chunk_list == NULL)
+            stream->chunk_list = gst_buffer_list_new ();
+          gst_buffer_list_add (stream->chunk_list, stream->chunks);
+          stream->chunks = buf;
+          stream->current_size += size;
+          break;
+        }
+
+        /* Otherwise continue with a single copy of the payload */
+        gst_clear_buffer (&buf);
+        gst_ts_demux_stream_flatten (stream, size);
+      }
       if (G_UNLIKELY (stream->current_size + size > stream->allocated_size)) {
         GST_LOG_OBJECT (demux, "resizing buffer");
         do {
@@ -2785,6 +3018,7 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
         g_free (stream->data);
         stream->data = NULL;
       }
+      gst_ts_demux_stream_clear_chunks (stream);
       if (G_UNLIKELY (stream->pending_header_data)) {
         g_free (stream->pending_header_data);
         stream->pending_header_data = NULL;
@@ -3323,7 +3557,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
       "stream:%p, pid:0x%04x stream_type:%d state:%d", stream, bs->pid,
       bs->stream_type, stream->state);
 
-  if (G_UNLIKELY (stream->data == NULL)) {
+  if (G_UNLIKELY (stream->data == NULL && stream->chunks == NULL)) {
     GST_LOG_OBJECT (stream->pad, "stream->data == NULL");
     goto beach;
   }
@@ -3344,6 +3578,13 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
     goto beach;
   }
 
+  /* Keyframe scanning and the access unit parsers need contiguous data */
+  if (stream->chunks && (stream->needs_keyframe
+          || !gst_ts_demux_stream_can_share (stream)))
+    gst_ts_demux_stream_flatten (stream, 0);
+
+  gst_ts_demux_update_stats (demux, stream);
+
   if (stream->needs_keyframe) {
     MpegTSBase *base = (MpegTSBase *) demux;
 
@@ -3373,7 +3614,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
           goto beach;
         }
       } else {
-        buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+        gst_ts_demux_stream_take_output (stream, &buffer, &buffer_list);
       }
 
       stream->seeked_pts = stream->pts;
@@ -3398,6 +3639,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
         if (cand->data)
           g_free (cand->data);
         cand->data = NULL;
+        gst_ts_demux_stream_clear_chunks (cand);
         cand->allocated_size = 0;
         cand->current_size = 0;
       }
@@ -3433,7 +3675,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
         goto beach;
       }
     } else {
-      buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+      gst_ts_demux_stream_take_output (stream, &buffer, &buffer_list);
     }
 
     if (G_UNLIKELY (stream->pending_ts && !check_pending_buffers (demux))) {
@@ -3599,6 +3841,7 @@ beach:
       stream->expected_size -= stream->current_size;
   }
   stream->data = NULL;
+  gst_ts_demux_stream_clear_chunks (stream);
   stream->allocated_size = 0;
   stream->current_size = 0;
 
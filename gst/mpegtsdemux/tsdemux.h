@@ -78,6 +78,12 @@ struct _GstTSDemux
   gboolean emit_statistics;
   gboolean send_scte35_events;
   gint latency; /* latency in ms */
+  gboolean zero_copy; /* Reference PES payloads instead of copying them */
+
+  /* PES reassembly statistics, protected with the OBJECT_LOCK */
+  guint64 bytes_copied;
+  guint64 bytes_shared;
+  guint64 pes_flattened;
 
   /*< private >*/
   gint program_generation; /* Incremented each time we switch program 0..15 */
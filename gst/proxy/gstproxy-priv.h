@@ -35,6 +35,9 @@ GstPad* gst_proxy_sink_get_internal_sinkpad (GstProxySink *sink);
 G_GNUC_INTERNAL
 GstPad* gst_proxy_src_get_internal_srcpad (GstProxySrc *src);
 
+G_GNUC_INTERNAL
+void gst_proxy_src_buffers_queued (GstProxySrc *src, guint n_buffers);
+
 G_END_DECLS
 
 #endif /* __GST_PROXY_PRIV_H__ */
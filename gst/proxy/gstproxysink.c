@@ -258,6 +258,8 @@ gst_proxy_sink_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     }
 
     ret = gst_pad_push (srcpad, buffer);
+    if (ret == GST_FLOW_OK)
+      gst_proxy_src_buffers_queued (src, 1);
     gst_object_unref (srcpad);
     gst_object_unref (src);
 
@@ -284,6 +286,8 @@ gst_proxy_sink_sink_chain_list (GstPad * pad, GstObject * parent,
   src = g_weak_ref_get (&self->proxysrc);
   if (src) {
     GstPad *srcpad;
+    guint n_buffers;
+
     srcpad = gst_proxy_src_get_internal_srcpad (src);
 
     if (self->pending_sticky_events) {
@@ -293,7 +297,10 @@ gst_proxy_sink_sink_chain_list (GstPad * pad, GstObject * parent,
       self->pending_sticky_events = data.ret != GST_FLOW_OK;
     }
 
+    n_buffers = gst_buffer_list_length (list);
     ret = gst_pad_push_list (srcpad, list);
+    if (ret == GST_FLOW_OK)
+      gst_proxy_src_buffers_queued (src, n_buffers);
     gst_object_unref (srcpad);
     gst_object_unref (src);
     GST_LOG_OBJECT (pad, "Chained buffer list %p: %s", list,
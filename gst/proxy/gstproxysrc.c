@@ -33,6 +33,12 @@
  * However, the queue may get filled up if the downstream pipeline does not
  * accept buffers quickly enough; perhaps because it is not yet PLAYING.
  *
+ * The size of the queue can be set with the max-size properties. By default
+ * the upstream pipeline blocks while the queue is full, the leaky property
+ * makes the queue drop buffers instead, which are counted in the dropped
+ * property. The current-level properties tell how much data is queued, and
+ * the queue is taken into account in latency queries.
+ *
  * ## Usage
  * 
  * |[<!-- language="C" -->
@@ -91,8 +97,42 @@ enum
 {
   PROP_0,
   PROP_PROXYSINK,
+  PROP_MAX_SIZE_BUFFERS,
+  PROP_MAX_SIZE_BYTES,
+  PROP_MAX_SIZE_TIME,
+  PROP_LEAKY,
+  PROP_CURRENT_LEVEL_BUFFERS,
+  PROP_CURRENT_LEVEL_BYTES,
+  PROP_CURRENT_LEVEL_TIME,
+  PROP_DROPPED,
 };
 
+/* the defaults of the queue element */
+#define DEFAULT_MAX_SIZE_BUFFERS 200
+#define DEFAULT_MAX_SIZE_BYTES (10 * 1024 * 1024)
+#define DEFAULT_MAX_SIZE_TIME GST_SECOND
+#define DEFAULT_LEAKY GST_PROXY_SRC_LEAKY_NONE
+
+#define GST_TYPE_PROXY_SRC_LEAKY (gst_proxy_src_leaky_get_type ())
+static GType
+gst_proxy_src_leaky_get_type (void)
+{
+  static GType leaky_type = 0;
+  static const GEnumValue leaky[] = {
+    {GST_PROXY_SRC_LEAKY_NONE, "Not Leaky", "no"},
+    {GST_PROXY_SRC_LEAKY_UPSTREAM, "Leaky on upstream (new buffers)",
+        "upstream"},
+    {GST_PROXY_SRC_LEAKY_DOWNSTREAM, "Leaky on downstream (old buffers)",
+        "downstream"},
+    {0, NULL, NULL},
+  };
+
+  if (!leaky_type) {
+    leaky_type = g_enum_register_static ("GstProxySrcLeaky", leaky);
+  }
+  return leaky_type;
+}
+
 /* We're not subclassing from basesrc because we don't want any of the special
  * handling it has for events/queries/etc. We just pass-through everything. */
 
@@ -114,6 +154,7 @@ static gboolean gst_proxy_src_send_event (GstElement * element,
     GstEvent * event);
 static gboolean gst_proxy_src_query (GstElement * element, GstQuery * query);
 static void gst_proxy_src_dispose (GObject * object);
+static guint64 gst_proxy_src_get_dropped (GstProxySrc * self);
 
 static void
 gst_proxy_src_get_property (GObject * object, guint prop_id, GValue * value,
@@ -125,6 +166,24 @@ gst_proxy_src_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_PROXYSINK:
       g_value_take_object (value, g_weak_ref_get (&self->proxysink));
       break;
+    case PROP_MAX_SIZE_BUFFERS:
+    case PROP_MAX_SIZE_BYTES:
+    case PROP_MAX_SIZE_TIME:
+    case PROP_CURRENT_LEVEL_BUFFERS:
+    case PROP_CURRENT_LEVEL_BYTES:
+    case PROP_CURRENT_LEVEL_TIME:
+      g_object_get_property (G_OBJECT (self->queue), spec->name, value);
+      break;
+    case PROP_LEAKY:{
+      gint leaky;
+
+      g_object_get (self->queue, "leaky", &leaky, NULL);
+      g_value_set_enum (value, leaky);
+      break;
+    }
+    case PROP_DROPPED:
+      g_value_set_uint64 (value, gst_proxy_src_get_dropped (self));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, spec);
       break;
@@ -157,6 +216,14 @@ gst_proxy_src_set_property (GObject * object, guint prop_id,
         g_object_unref (sink);
       }
       break;
+    case PROP_MAX_SIZE_BUFFERS:
+    case PROP_MAX_SIZE_BYTES:
+    case PROP_MAX_SIZE_TIME:
+      g_object_set_property (G_OBJECT (self->queue), spec->name, value);
+      break;
+    case PROP_LEAKY:
+      g_object_set (self->queue, "leaky", g_value_get_enum (value), NULL);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, spec);
   }
@@ -179,6 +246,105 @@ gst_proxy_src_class_init (GstProxySrcClass * klass)
       g_param_spec_object ("proxysink", "Proxysink", "Matching proxysink",
           GST_TYPE_PROXY_SINK, G_PARAM_READWRITE));
 
+  /**
+   * GstProxySrc:max-size-buffers:
+   *
+   * Max. number of buffers in the queue (0=disable).
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BUFFERS,
+      g_param_spec_uint ("max-size-buffers", "Max. size (buffers)",
+          "Max. number of buffers in the queue (0=disable)", 0, G_MAXUINT,
+          DEFAULT_MAX_SIZE_BUFFERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:max-size-bytes:
+   *
+   * Max. amount of data in the queue (bytes, 0=disable).
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BYTES,
+      g_param_spec_uint ("max-size-bytes", "Max. size (kB)",
+          "Max. amount of data in the queue (bytes, 0=disable)", 0, G_MAXUINT,
+          DEFAULT_MAX_SIZE_BYTES, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:max-size-time:
+   *
+   * Max. amount of data in the queue (in ns, 0=disable).
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_TIME,
+      g_param_spec_uint64 ("max-size-time", "Max. size (ns)",
+          "Max. amount of data in the queue (in ns, 0=disable)", 0,
+          G_MAXUINT64, DEFAULT_MAX_SIZE_TIME,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:leaky:
+   *
+   * Where the queue drops buffers when it is full, instead of blocking the
+   * upstream pipeline.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_LEAKY,
+      g_param_spec_enum ("leaky", "Leaky",
+          "Where the queue leaks, if at all", GST_TYPE_PROXY_SRC_LEAKY,
+          DEFAULT_LEAKY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:current-level-buffers:
+   *
+   * Current number of buffers in the queue.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_CURRENT_LEVEL_BUFFERS,
+      g_param_spec_uint ("current-level-buffers", "Current level (buffers)",
+          "Current number of buffers in the queue", 0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:current-level-bytes:
+   *
+   * Current amount of data in the queue (bytes).
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_CURRENT_LEVEL_BYTES,
+      g_param_spec_uint ("current-level-bytes", "Current level (kB)",
+          "Current amount of data in the queue (bytes)", 0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:current-level-time:
+   *
+   * Current amount of data in the queue (in ns).
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_CURRENT_LEVEL_TIME,
+      g_param_spec_uint64 ("current-level-time", "Current level (ns)",
+          "Current amount of data in the queue (in ns)", 0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:dropped:
+   *
+   * Number of buffers dropped by a leaky queue.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_DROPPED,
+      g_param_spec_uint64 ("dropped", "Dropped",
+          "Number of buffers dropped by a leaky queue", 0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_proxy_src_change_state;
   gstelement_class->send_event = gst_proxy_src_send_event;
   gstelement_class->query = gst_proxy_src_query;
@@ -188,6 +354,91 @@ gst_proxy_src_class_init (GstProxySrcClass * klass)
   gst_element_class_set_static_metadata (gstelement_class, "Proxy source",
       "Source", "Proxy source for internal process communication",
       "Sebastian Dröge <sebastian@centricular.com>");
+
+  gst_type_mark_as_plugin_api (GST_TYPE_PROXY_SRC_LEAKY, 0);
+}
+
+/* Buffers that were queued, but neither came out nor are in the queue
+ * anymore, were dropped. While a buffer is being queued or taken out, this
+ * can be off by that buffer for a moment, but not permanently */
+static guint64
+gst_proxy_src_get_dropped_unlocked (GstProxySrc * self, guint level)
+{
+  guint64 queued = self->n_out + level;
+
+  return self->dropped + (self->n_in > queued ? self->n_in - queued : 0);
+}
+
+static guint64
+gst_proxy_src_get_dropped (GstProxySrc * self)
+{
+  guint64 dropped;
+  guint level;
+
+  g_object_get (self->queue, "current-level-buffers", &level, NULL);
+
+  GST_OBJECT_LOCK (self);
+  dropped = gst_proxy_src_get_dropped_unlocked (self, level);
+  GST_OBJECT_UNLOCK (self);
+
+  return dropped;
+}
+
+/* Called by proxysink once the queue accepted @n_buffers, which it either
+ * queued or, if leaky upstream, dropped. A push waiting for space in the
+ * queue is not counted before it is done */
+void
+gst_proxy_src_buffers_queued (GstProxySrc * self, guint n_buffers)
+{
+  GST_OBJECT_LOCK (self);
+  self->n_in += n_buffers;
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* Called on flush-stop, before the queue discards the buffers it holds,
+ * which does not count as dropping them. No buffers move at that point */
+static void
+gst_proxy_src_restart_counting (GstProxySrc * self)
+{
+  guint level;
+
+  g_object_get (self->queue, "current-level-buffers", &level, NULL);
+
+  GST_OBJECT_LOCK (self);
+  self->dropped = gst_proxy_src_get_dropped_unlocked (self, level);
+  self->n_in = self->n_out = 0;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static GstPadProbeReturn
+gst_proxy_src_queue_sink_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstProxySrc *self = user_data;
+
+  if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_FLUSH_STOP)
+    gst_proxy_src_restart_counting (self);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* The buffers are counted when they leave the queue, before they are pushed
+ * downstream */
+static GstPadProbeReturn
+gst_proxy_src_queue_src_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstProxySrc *self = user_data;
+  guint n_buffers = 1;
+
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+    n_buffers = gst_buffer_list_length (GST_PAD_PROBE_INFO_BUFFER_LIST (info));
+
+  GST_OBJECT_LOCK (self);
+  self->n_out += n_buffers;
+  GST_OBJECT_UNLOCK (self);
+
+  return GST_PAD_PROBE_OK;
 }
 
 static void
@@ -207,10 +458,20 @@ gst_proxy_src_init (GstProxySrc * self)
   templ = gst_static_pad_template_get (&src_template);
   self->srcpad = gst_ghost_pad_new_from_template ("src", srcpad, templ);
   gst_object_unref (templ);
+
+  /* count the buffers going through the queue, for the dropped property */
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER |
+      GST_PAD_PROBE_TYPE_BUFFER_LIST, gst_proxy_src_queue_src_probe, self,
+      NULL);
   gst_object_unref (srcpad);
 
   gst_element_add_pad (GST_ELEMENT (self), self->srcpad);
 
+  sinkpad = gst_element_get_static_pad (self->queue, "sink");
+  gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+      gst_proxy_src_queue_sink_probe, self, NULL);
+  gst_object_unref (sinkpad);
+
   /* A dummy sinkpad that's not actually used anywhere
    * Explanation for why this is needed is below */
   self->dummy_sinkpad = gst_pad_new ("dummy_sinkpad", GST_PAD_SINK);
@@ -263,6 +524,16 @@ gst_proxy_src_change_state (GstElement * element, GstStateChange transition)
   GstProxySrc *self = GST_PROXY_SRC (element);
   GstStateChangeReturn ret;
 
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      GST_OBJECT_LOCK (self);
+      self->n_in = self->n_out = self->dropped = 0;
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      break;
+  }
+
   ret = gstelement_class->change_state (element, transition);
   if (ret == GST_STATE_CHANGE_FAILURE)
     return ret;
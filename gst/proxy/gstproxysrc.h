@@ -56,8 +56,31 @@ struct _GstProxySrc {
 
   /* The matching proxysink; queries and events are sent to its sinkpad */
   GWeakRef proxysink;
+
+  /* Buffers that went in and out of the queue since the last flush, and
+   * buffers the queue dropped before that. Protected by the object lock */
+  guint64 n_in;
+  guint64 n_out;
+  guint64 dropped;
 };
 
+/**
+ * GstProxySrcLeaky:
+ * @GST_PROXY_SRC_LEAKY_NONE: Not leaky
+ * @GST_PROXY_SRC_LEAKY_UPSTREAM: Leaky on upstream (new buffers)
+ * @GST_PROXY_SRC_LEAKY_DOWNSTREAM: Leaky on downstream (old buffers)
+ *
+ * Buffers dropped by proxysrc when its queue is full, with the same values
+ * as the leaky property of the queue element.
+ *
+ * Since: 1.22
+ */
+typedef enum {
+  GST_PROXY_SRC_LEAKY_NONE = 0,
+  GST_PROXY_SRC_LEAKY_UPSTREAM = 1,
+  GST_PROXY_SRC_LEAKY_DOWNSTREAM = 2
+} GstProxySrcLeaky;
+
 struct _GstProxySrcClass {
   GstBinClass parent_class;
 };
@@ -24,6 +24,8 @@
  * @title: removesilence
  *
  * Removes all silence periods from an audio stream, dropping silence buffers.
+ * Multi-channel streams are analysed per channel, without downmixing, and a
+ * buffer is silence only if all of its channels are.
  * If the "silent" property is disabled, removesilence will generate
  * bus messages named "removesilence". 
  * The message's structure contains one of these fields:
@@ -87,7 +89,7 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_STATIC_CAPS ("audio/x-raw, "
         "format = (string) " GST_AUDIO_NE (S16) ", "
         "layout = (string) interleaved, "
-        "rate = (int) [ 1, MAX ], " "channels = (int) 1"));
+        "rate = (int) [ 1, MAX ], " "channels = (int) [ 1, MAX ]"));
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
@@ -95,7 +97,7 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_STATIC_CAPS ("audio/x-raw, "
         "format = (string) " GST_AUDIO_NE (S16) ", "
         "layout = (string) interleaved, "
-        "rate = (int) [ 1, MAX ], " "channels = (int) 1"));
+        "rate = (int) [ 1, MAX ], " "channels = (int) [ 1, MAX ]"));
 
 
 #define DEBUG_INIT(bla) \
@@ -113,6 +115,8 @@ static void gst_remove_silence_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 
 static gboolean gst_remove_silence_start (GstBaseTransform * trans);
+static gboolean gst_remove_silence_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
 static gboolean gst_remove_silence_sink_event (GstBaseTransform * trans,
     GstEvent * event);
 static GstFlowReturn gst_remove_silence_transform_ip (GstBaseTransform * base,
@@ -191,6 +195,8 @@ gst_remove_silence_class_init (GstRemoveSilenceClass * klass)
   gst_element_class_add_static_pad_template (gstelement_class, &sink_template);
 
   base_transform_class->start = GST_DEBUG_FUNCPTR (gst_remove_silence_start);
+  base_transform_class->set_caps =
+      GST_DEBUG_FUNCPTR (gst_remove_silence_set_caps);
   base_transform_class->sink_event =
       GST_DEBUG_FUNCPTR (gst_remove_silence_sink_event);
   base_transform_class->transform_ip =
@@ -240,6 +246,27 @@ gst_remove_silence_start (GstBaseTransform * trans)
   return TRUE;
 }
 
+static gboolean
+gst_remove_silence_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstRemoveSilence *filter = GST_REMOVE_SILENCE (trans);
+  GstAudioInfo info;
+
+  if (!gst_audio_info_from_caps (&info, incaps)) {
+    GST_ERROR_OBJECT (filter, "invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+
+  /* each channel is analysed in place, a frame is voice if any of its
+   * channels is */
+  GST_INFO_OBJECT (filter, "analysing %d channels",
+      GST_AUDIO_INFO_CHANNELS (&info));
+  vad_set_channels (filter->vad, GST_AUDIO_INFO_CHANNELS (&info));
+
+  return TRUE;
+}
+
 static gboolean
 gst_remove_silence_sink_event (GstBaseTransform * trans, GstEvent * event)
 {
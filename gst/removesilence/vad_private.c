@@ -29,45 +29,48 @@
 #define VAD_POWER_ALPHA     0x0800      /* Q16 */
 #define VAD_ZCR_THRESHOLD   0
 #define VAD_BUFFER_SIZE     256
+/* The zero crossing rate is measured over this many samples per channel */
+#define VAD_HISTORY_SIZE    (VAD_BUFFER_SIZE - 1)
+/* The power is updated by blocks of this many samples, with VAD_LANES
+ * independent sums the compiler can map to SIMD registers */
+#define VAD_BLOCK_SIZE      64
+#define VAD_LANES           8
 
-
-union pgen
+typedef struct _vad_channel_s
 {
-  guint64 a;
-  gpointer v;
-  guint64 *l;
-  guchar *b;
-  guint16 *w;
-  gint16 *s;
-};
-
-struct _cqueue_s
-{
-  union pgen base;
-  union pgen tail;
-  union pgen head;
-  gint size;
-};
-
-typedef struct _cqueue_s cqueue_t;
+  gdouble power;
+  gint16 history[VAD_HISTORY_SIZE];
+  gint history_len;
+} VADChannel;
 
 struct _vad_s
 {
-  gint16 vad_buffer[VAD_BUFFER_SIZE];
-  cqueue_t cqueue;
+  VADChannel *channels;
+  gint n_channels;
+  /* decay of the power per sample and per block, and the weight of each
+   * sample of a block in the power at the end of the block */
+  gdouble decay;
+  gdouble block_decay;
+  gfloat block_weights[VAD_BLOCK_SIZE];
   gint vad_state;
   guint64 hysteresis;
   guint64 vad_samples;
-  guint64 vad_power;
   guint64 threshold;
-  long vad_zcr;
 };
 
 VADFilter *
 vad_new (guint64 hysteresis, gint threshold)
 {
-  VADFilter *vad = malloc (sizeof (VADFilter));
-  vad_reset (vad);
+  VADFilter *vad = calloc (1, sizeof (VADFilter));
+  gint i;
+
+  vad->decay = (0xFFFF - VAD_POWER_ALPHA) / 65536.0;
+  vad->block_decay = pow (vad->decay, VAD_BLOCK_SIZE);
+  for (i = 0; i < VAD_BLOCK_SIZE; i++)
+    vad->block_weights[i] =
+        VAD_POWER_ALPHA * pow (vad->decay, VAD_BLOCK_SIZE - 1 - i);
+
+  vad_set_channels (vad, 1);
   vad->hysteresis = hysteresis;
   vad_set_threshold (vad, threshold);
   return vad;
@@ -76,19 +79,38 @@ vad_new (guint64 hysteresis, gint threshold)
 void
 vad_reset (VADFilter * vad)
 {
-  memset (vad, 0, sizeof (*vad));
-  vad->cqueue.base.s = vad->vad_buffer;
-  vad->cqueue.tail.a = vad->cqueue.head.a = 0;
-  vad->cqueue.size = VAD_BUFFER_SIZE;
+  memset (vad->channels, 0, vad->n_channels * sizeof (VADChannel));
   vad->vad_state = VAD_SILENCE;
+  vad->vad_samples = 0;
 }
 
 void
 vad_destroy (VADFilter * p)
 {
+  free (p->channels);
   free (p);
 }
 
+void
+vad_set_channels (VADFilter * p, gint channels)
+{
+  g_return_if_fail (channels > 0);
+
+  if (p->n_channels == channels)
+    return;
+
+  free (p->channels);
+  p->channels = malloc (channels * sizeof (VADChannel));
+  p->n_channels = channels;
+  vad_reset (p);
+}
+
+gint
+vad_get_channels (VADFilter * p)
+{
+  return p->n_channels;
+}
+
 void
 vad_set_hysteresis (struct _vad_s *p, guint64 hysteresis)
 {
@@ -114,43 +136,111 @@ vad_get_threshold_as_db (struct _vad_s *p)
   return (gint) (10 * log10 (p->threshold / 4294967295.0));
 }
 
-gint
-vad_update (struct _vad_s * p, gint16 * data, gint len)
+#define VAD_ENERGY(x) ((((gint) (x)) * ((gint) (x)) >> 14) & 0xFFFF)
+
+/* Weighted energy of VAD_BLOCK_SIZE samples, @stride samples apart. The
+ * lanes are summed separately so that the loop vectorizes without
+ * reassociating floating point additions */
+static inline gfloat
+vad_block_power (const gint16 * data, gint stride, const gfloat * weights)
+{
+  gfloat acc[VAD_LANES] = { 0.0f, };
+  gint i, j;
+
+  for (i = 0; i < VAD_BLOCK_SIZE; i += VAD_LANES) {
+    for (j = 0; j < VAD_LANES; j++)
+      acc[j] += weights[i + j] * VAD_ENERGY (data[(i + j) * stride]);
+  }
+
+  for (j = 1; j < VAD_LANES; j++)
+    acc[0] += acc[j];
+
+  return acc[0];
+}
+
+static void
+vad_update_power (VADFilter * p, VADChannel * chan, const gint16 * data,
+    gint stride, gint len)
 {
-  guint64 tail;
-  gint frame_type;
-  gint16 sample;
+  gdouble power = chan->power;
   gint i;
 
-  for (i = 0; i < len; i++) {
-    p->vad_power = VAD_POWER_ALPHA * ((data[i] * data[i] >> 14) & 0xFFFF) +
-        (0xFFFF - VAD_POWER_ALPHA) * (p->vad_power >> 16) +
-        ((0xFFFF - VAD_POWER_ALPHA) * (p->vad_power & 0xFFFF) >> 16);
-    /* Update VAD buffer */
-    p->cqueue.base.s[p->cqueue.head.a] = data[i];
-    p->cqueue.head.a = (p->cqueue.head.a + 1) & (p->cqueue.size - 1);
-    if (p->cqueue.head.a == p->cqueue.tail.a)
-      p->cqueue.tail.a = (p->cqueue.tail.a + 1) & (p->cqueue.size - 1);
+  /* separate calls so that the mono case is compiled with a constant
+   * stride */
+  if (stride == 1) {
+    for (i = 0; i + VAD_BLOCK_SIZE <= len; i += VAD_BLOCK_SIZE)
+      power = power * p->block_decay +
+          vad_block_power (data + i, 1, p->block_weights);
+  } else {
+    for (i = 0; i + VAD_BLOCK_SIZE <= len; i += VAD_BLOCK_SIZE)
+      power = power * p->block_decay +
+          vad_block_power (data + i * stride, stride, p->block_weights);
   }
 
-  tail = p->cqueue.tail.a;
-  p->vad_zcr = 0;
-  for (;;) {
-    sample = p->cqueue.base.s[tail];
-    tail = (tail + 1) & (p->cqueue.size - 1);
-    if (tail == p->cqueue.head.a)
-      break;
-    p->vad_zcr +=
-        ((sample & 0x8000) != (p->cqueue.base.s[tail] & 0x8000)) ? 1 : -1;
+  for (; i < len; i++)
+    power = power * p->decay + VAD_POWER_ALPHA * VAD_ENERGY (data[i * stride]);
+
+  chan->power = power;
+}
+
+static void
+vad_update_history (VADChannel * chan, const gint16 * data, gint stride,
+    gint len)
+{
+  gint i, keep;
+
+  if (len >= VAD_HISTORY_SIZE) {
+    data += (len - VAD_HISTORY_SIZE) * stride;
+    len = VAD_HISTORY_SIZE;
   }
 
-  frame_type = (p->vad_power > p->threshold
-      && p->vad_zcr < VAD_ZCR_THRESHOLD) ? VAD_VOICE : VAD_SILENCE;
+  keep = MIN (chan->history_len, VAD_HISTORY_SIZE - len);
+  memmove (chan->history, chan->history + chan->history_len - keep,
+      keep * sizeof (gint16));
+  for (i = 0; i < len; i++)
+    chan->history[keep + i] = data[i * stride];
+  chan->history_len = keep + len;
+}
+
+/* +1 for each pair of consecutive samples with different signs, -1 for
+ * each pair without */
+static gint
+vad_zcr (const gint16 * history, gint len)
+{
+  gint i, crossings = 0;
+
+  if (len < 2)
+    return 0;
+
+  for (i = 0; i < len - 1; i++)
+    crossings += ((history[i] ^ history[i + 1]) >> 15) & 1;
+
+  return 2 * crossings - (len - 1);
+}
+
+gint
+vad_update (struct _vad_s * p, gint16 * data, gint len)
+{
+  gint frame_type = VAD_SILENCE;
+  gint frames = len / p->n_channels;
+  gint c;
+
+  /* voice on any channel makes the frame voice */
+  for (c = 0; c < p->n_channels; c++) {
+    VADChannel *chan = &p->channels[c];
+
+    vad_update_power (p, chan, data + c, p->n_channels, frames);
+    vad_update_history (chan, data + c, p->n_channels, frames);
+
+    if (chan->power > p->threshold
+        && vad_zcr (chan->history, chan->history_len) < VAD_ZCR_THRESHOLD)
+      frame_type = VAD_VOICE;
+  }
 
   if (p->vad_state != frame_type) {
     /* Voice to silence transition */
     if (p->vad_state == VAD_VOICE) {
-      p->vad_samples += len;
+      p->vad_samples += frames;
       if (p->vad_samples >= p->hysteresis) {
         p->vad_state = frame_type;
         p->vad_samples = 0;
@@ -29,6 +29,7 @@
 
 typedef struct _vad_s VADFilter;
 
+/* @len is the number of samples of all channels, interleaved */
 gint vad_update(VADFilter *p, gint16 *data, gint len);
 
 void vad_set_hysteresis(VADFilter *p, guint64 hysteresis);
@@ -41,6 +42,10 @@ gint vad_get_threshold_as_db(VADFilter *p);
 
 VADFilter* vad_new(guint64 hysteresis, gint threshold);
 
+void vad_set_channels(VADFilter *p, gint channels);
+
+gint vad_get_channels(VADFilter *p);
+
 void vad_reset(VADFilter *p);
 
 void vad_destroy(VADFilter *p);
@@ -56,6 +56,12 @@
  * formats, like the example above (it applies volume only to 44.1 kHz PCM audio).
  * </refsect2>
  *
+ * By default, the elements of the paths that are not the current one are kept
+ * in the NULL state, so switching to a path has to bring its elements all the
+ * way up to PLAYING, which can take a while (opening devices, loading decoders
+ * etc.). With #GstSwitchBin:standby-state set to READY or PAUSED, these
+ * elements are kept in that state instead, and switching only re-links pads
+ * and does the remaining state changes.
  */
 
 #include <string.h>
@@ -71,10 +77,12 @@ enum
   PROP_0,
   PROP_NUM_PATHS,
   PROP_CURRENT_PATH,
+  PROP_STANDBY_STATE,
   PROP_LAST
 };
 
 #define DEFAULT_NUM_PATHS 0
+#define DEFAULT_STANDBY_STATE GST_STATE_NULL
 GParamSpec *switchbin_props[PROP_LAST];
 
 #define PATH_LOCK(obj) g_mutex_lock(&(GST_SWITCH_BIN_CAST (obj)->path_mutex))
@@ -118,6 +126,8 @@ static void gst_switch_bin_unlock_paths_and_notify (GstSwitchBin * switchbin);
 
 static void gst_switch_bin_dispose (GObject * object);
 static void gst_switch_bin_finalize (GObject * object);
+static GstStateChangeReturn gst_switch_bin_change_state (GstElement * element,
+    GstStateChange transition);
 static void gst_switch_bin_set_property (GObject * object, guint prop_id,
     GValue const *value, GParamSpec * pspec);
 static void gst_switch_bin_get_property (GObject * object, guint prop_id,
@@ -144,6 +154,8 @@ static void gst_switch_bin_set_sinkpad_block (GstSwitchBin * switch_bin,
 static GstPadProbeReturn gst_switch_bin_blocking_pad_probe (GstPad * pad,
     GstPadProbeInfo * info, gpointer user_data);
 
+static void gst_switch_bin_set_path_standby (GstSwitchBin * switch_bin,
+    GstSwitchBinPath * path, GstState state);
 static GstCaps *gst_switch_bin_get_allowed_caps (GstSwitchBin * switch_bin,
     GstPad * switch_bin_pad, gchar const *pad_name, GstCaps * filter);
 static gboolean gst_switch_bin_are_caps_acceptable (GstSwitchBin *
@@ -257,6 +269,27 @@ gst_switch_bin_class_init (GstSwitchBinClass * klass)
   g_object_class_install_property (object_class,
       PROP_CURRENT_PATH, switchbin_props[PROP_CURRENT_PATH]);
 
+  /**
+   * GstSwitchBin:standby-state
+   *
+   * State the elements of the paths that are not the current one are kept
+   * in, at most, while the switchbin is running. NULL, READY or PAUSED.
+   * Higher standby states use more resources, but make switching to these
+   * paths faster. Elements left in PAUSED are flushed when their path stops
+   * being the current one.
+   *
+   * Since: 1.22
+   */
+  switchbin_props[PROP_STANDBY_STATE] =
+      g_param_spec_enum ("standby-state", "Standby state",
+      "State of the elements of the non-current paths", GST_TYPE_STATE,
+      DEFAULT_STANDBY_STATE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class,
+      PROP_STANDBY_STATE, switchbin_props[PROP_STANDBY_STATE]);
+
+  element_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_switch_bin_change_state);
+
   gst_element_class_set_static_metadata (element_class,
       "switchbin",
       "Generic/Bin",
@@ -277,6 +310,7 @@ gst_switch_bin_init (GstSwitchBin * switch_bin)
   switch_bin->blocking_probe_id = 0;
   switch_bin->drop_probe_id = 0;
   switch_bin->last_caps = NULL;
+  switch_bin->standby_state = DEFAULT_STANDBY_STATE;
 
   switch_bin->sinkpad = gst_ghost_pad_new_no_target_from_template ("sink",
       gst_element_class_get_pad_template (GST_ELEMENT_GET_CLASS (switch_bin),
@@ -352,6 +386,22 @@ gst_switch_bin_set_property (GObject * object, guint prop_id,
       gst_switch_bin_set_num_paths (switch_bin, g_value_get_uint (value));
       PATH_UNLOCK_AND_CHECK (switch_bin);
       break;
+    case PROP_STANDBY_STATE:{
+      GstState state;
+      guint i;
+
+      PATH_LOCK (switch_bin);
+      switch_bin->standby_state =
+          CLAMP (g_value_get_enum (value), GST_STATE_NULL, GST_STATE_PAUSED);
+      GST_OBJECT_LOCK (switch_bin);
+      state = GST_STATE (switch_bin);
+      GST_OBJECT_UNLOCK (switch_bin);
+      for (i = 0; i < switch_bin->num_paths; ++i)
+        gst_switch_bin_set_path_standby (switch_bin, switch_bin->paths[i],
+            state);
+      PATH_UNLOCK (switch_bin);
+      break;
+    }
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -387,6 +437,11 @@ gst_switch_bin_get_property (GObject * object, guint prop_id, GValue * value,
       }
       PATH_UNLOCK (switch_bin);
       break;
+    case PROP_STANDBY_STATE:
+      PATH_LOCK (switch_bin);
+      g_value_set_enum (value, switch_bin->standby_state);
+      PATH_UNLOCK (switch_bin);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -394,6 +449,32 @@ gst_switch_bin_get_property (GObject * object, guint prop_id, GValue * value,
 }
 
 
+static GstStateChangeReturn
+gst_switch_bin_change_state (GstElement * element, GstStateChange transition)
+{
+  GstSwitchBin *switch_bin = GST_SWITCH_BIN (element);
+  GstStateChangeReturn ret;
+  guint i;
+
+  ret =
+      GST_ELEMENT_CLASS (gst_switch_bin_parent_class)->change_state (element,
+      transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  /* The elements of the non-current paths have their state locked, so they
+   * do not follow the bin; bring them to the standby state, as far as the
+   * bin's state allows */
+  PATH_LOCK (switch_bin);
+  for (i = 0; i < switch_bin->num_paths; ++i)
+    gst_switch_bin_set_path_standby (switch_bin, switch_bin->paths[i],
+        GST_STATE_TRANSITION_NEXT (transition));
+  PATH_UNLOCK (switch_bin);
+
+  return ret;
+}
+
+
 static gboolean
 gst_switch_bin_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -659,9 +740,14 @@ gst_switch_bin_select_path_for_caps (GstSwitchBin * switch_bin, GstCaps * caps)
   } else {
     /* Matching path found. Try to switch to it. */
 
+    gint64 start;
+
     GST_DEBUG_OBJECT (switch_bin, "found matching path \"%s\" (%p) - switching",
         GST_OBJECT_NAME (path), (gpointer) path);
+    start = g_get_monotonic_time ();
     ret = gst_switch_bin_switch_to_path (switch_bin, path);
+    GST_INFO_OBJECT (switch_bin, "switched to path \"%s\" in %" G_GINT64_FORMAT
+        " us", GST_OBJECT_NAME (path), g_get_monotonic_time () - start);
   }
 
   if (ret && (caps != switch_bin->last_caps))
@@ -701,15 +787,23 @@ gst_switch_bin_switch_to_path (GstSwitchBin * switch_bin,
   if (switch_bin->current_path != NULL) {
     GstSwitchBinPath *cur_path = switch_bin->current_path;
 
-    if (cur_path->element != NULL) {
-      gst_element_set_state (cur_path->element, GST_STATE_NULL);
-      gst_element_unlink (switch_bin->input_identity, cur_path->element);
-    }
-
     gst_ghost_pad_set_target (GST_GHOST_PAD (switch_bin->srcpad), NULL);
 
     switch_bin->current_path = NULL;
     switch_bin->path_changed = TRUE;
+
+    if (cur_path->element != NULL) {
+      GstState state;
+
+      /* Put the element in standby; its srcpad is not a target of the ghost
+       * srcpad anymore, so a flush does not go downstream */
+      GST_OBJECT_LOCK (switch_bin);
+      state = GST_STATE (switch_bin);
+      GST_OBJECT_UNLOCK (switch_bin);
+      gst_element_set_locked_state (cur_path->element, TRUE);
+      gst_switch_bin_set_path_standby (switch_bin, cur_path, state);
+      gst_element_unlink (switch_bin->input_identity, cur_path->element);
+    }
   }
 
   /* Link the new path's element (if a new path is specified) */
@@ -798,6 +892,47 @@ finish:
 }
 
 
+static void
+gst_switch_bin_set_path_standby (GstSwitchBin * switch_bin,
+    GstSwitchBinPath * path, GstState state)
+{
+  /* must be called with path lock held */
+
+  GstState standby_state, old_state;
+
+  if (path == switch_bin->current_path || path->element == NULL)
+    return;
+
+  standby_state = MIN (switch_bin->standby_state, state);
+
+  GST_OBJECT_LOCK (path->element);
+  old_state = GST_STATE (path->element);
+  GST_OBJECT_UNLOCK (path->element);
+
+  GST_DEBUG_OBJECT (switch_bin, "putting path \"%s\" in standby state %s",
+      GST_OBJECT_NAME (path), gst_element_state_get_name (standby_state));
+
+  if (gst_element_set_state (path->element, standby_state) ==
+      GST_STATE_CHANGE_FAILURE) {
+    GST_WARNING_OBJECT (switch_bin, "could not put path \"%s\" in state %s",
+        GST_OBJECT_NAME (path), gst_element_state_get_name (standby_state));
+    return;
+  }
+
+  /* Data left inside an element that was running, like frames held back by a
+   * decoder, must not come out when switching back to its path */
+  if (standby_state == GST_STATE_PAUSED && old_state == GST_STATE_PLAYING) {
+    GstPad *pad = gst_element_get_static_pad (path->element, "sink");
+
+    if (pad != NULL) {
+      gst_pad_send_event (pad, gst_event_new_flush_start ());
+      gst_pad_send_event (pad, gst_event_new_flush_stop (TRUE));
+      gst_object_unref (GST_OBJECT (pad));
+    }
+  }
+}
+
+
 static GstSwitchBinPath *
 gst_switch_bin_find_matching_path (GstSwitchBin * switch_bin,
     GstCaps const *caps)
@@ -1170,6 +1305,16 @@ gst_switch_bin_path_use_new_element (GstSwitchBinPath * switch_bin_path,
      * but is unable to do so as long as it isn't linked. By locking the state,
      * it won't follow state changes, so the freeze does not happen. */
     gst_element_set_locked_state (new_element, TRUE);
+
+    if (!is_current_path) {
+      GstState state;
+
+      GST_OBJECT_LOCK (switch_bin_path->bin);
+      state = GST_STATE (switch_bin_path->bin);
+      GST_OBJECT_UNLOCK (switch_bin_path->bin);
+      gst_switch_bin_set_path_standby (switch_bin_path->bin, switch_bin_path,
+          state);
+    }
   }
 
   /* We are done. Switch back to the path if it is the current one,
@@ -60,6 +60,9 @@ struct _GstSwitchBin
 	gulong blocking_probe_id, drop_probe_id;
 
 	GstCaps *last_caps;
+
+	/* state of the elements of the paths that are not the current one */
+	GstState standby_state;
 };
 
 
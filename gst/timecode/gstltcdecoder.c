@@ -0,0 +1,443 @@
+/*
+ * GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* A linear timecode decoder scanning all channels of interleaved audio at
+ * once.
+ *
+ * Audio is handled in blocks of BLOCK_SIZE samples. For each block, the
+ * samples of all channels are converted to float, the peak of each channel
+ * is tracked and each sample is quantized to -1, 0 or 1 against a threshold
+ * relative to that peak. These passes run over all channels in the inner loop
+ * and are auto-vectorized. Only then is each scanned channel walked for level
+ * changes, which are rare, and fed to a biphase mark state machine that
+ * assembles 80-bit frames and looks for the sync word.
+ *
+ * Frame offsets are those of the zero crossing starting bit 0 of the frame,
+ * so they are sample accurate.
+ *
+ * With the channel set to -1, every channel is decoded and the first one to
+ * give two consecutive frames is locked on. The decoder switches to another
+ * channel if the locked one stopped giving frames for half a second.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstltcdecoder.h"
+
+#include <string.h>
+
+#define BLOCK_SIZE 256
+#define PEAK_DECAY 0.99f
+#define THRESHOLD_RATIO 0.25f
+#define MIN_THRESHOLD (1.0f / 256.0f)
+#define MAX_EDGE_BACKTRACK 8
+
+#define LTC_FRAME_BITS 80
+#define LTC_SYNC_WORD 0xbffc
+
+typedef struct
+{
+  gfloat peak;
+  gint8 level;
+
+  /* biphase mark state */
+  gboolean has_edge;
+  gboolean pending_half;
+  gfloat period;
+  guint64 last_edge;
+  guint64 bit_start;
+
+  /* the last 80 bits, the newest one being the highest bit of hi */
+  guint64 lo;
+  guint16 hi;
+  guint n_bits;
+  guint64 bit_starts[LTC_FRAME_BITS];
+  guint ring_pos;
+
+  gboolean has_frame;
+  guint64 last_frame_offset;
+  guint consecutive;
+} LtcChannel;
+
+struct _GstLtcDecoder
+{
+  GstAudioFormat format;
+  gint rate;
+  gint channels;
+  gint channel;
+  gint locked;
+
+  gfloat min_period;
+  gfloat max_period;
+
+  gfloat *block;
+  gint8 *levels;
+  gfloat *block_peaks;
+  gfloat *thresholds;
+  LtcChannel *ch;
+
+  GArray *frames;
+};
+
+GstLtcDecoder *
+gst_ltc_decoder_new (GstAudioFormat format, gint rate, gint channels)
+{
+  GstLtcDecoder *dec;
+
+  g_return_val_if_fail (format == GST_AUDIO_FORMAT_U8 ||
+      format == GST_AUDIO_FORMAT_S16LE || format == GST_AUDIO_FORMAT_S32LE ||
+      format == GST_AUDIO_FORMAT_F32LE, NULL);
+  g_return_val_if_fail (rate > 0 && channels > 0, NULL);
+
+  dec = g_new0 (GstLtcDecoder, 1);
+  dec->format = format;
+  dec->rate = rate;
+  dec->channels = channels;
+  dec->channel = -1;
+
+  /* 80 bits per frame, from 24 fps to 30 fps with some margin */
+  dec->min_period = rate / (LTC_FRAME_BITS * 30 * 1.1f);
+  dec->max_period = rate / (LTC_FRAME_BITS * 24 / 1.1f);
+
+  dec->block = g_new (gfloat, BLOCK_SIZE * channels);
+  dec->levels = g_new (gint8, BLOCK_SIZE * channels);
+  dec->block_peaks = g_new (gfloat, channels);
+  dec->thresholds = g_new (gfloat, channels);
+  dec->ch = g_new0 (LtcChannel, channels);
+  dec->frames = g_array_new (FALSE, FALSE, sizeof (GstLtcDecoderFrame));
+
+  gst_ltc_decoder_reset (dec);
+
+  return dec;
+}
+
+void
+gst_ltc_decoder_free (GstLtcDecoder * dec)
+{
+  g_free (dec->block);
+  g_free (dec->levels);
+  g_free (dec->block_peaks);
+  g_free (dec->thresholds);
+  g_free (dec->ch);
+  g_array_unref (dec->frames);
+  g_free (dec);
+}
+
+void
+gst_ltc_decoder_reset (GstLtcDecoder * dec)
+{
+  gint c;
+
+  memset (dec->ch, 0, sizeof (LtcChannel) * dec->channels);
+  for (c = 0; c < dec->channels; c++)
+    dec->ch[c].period = dec->rate / (LTC_FRAME_BITS * 25.0f);
+
+  dec->locked = -1;
+  g_array_set_size (dec->frames, 0);
+}
+
+/* Keeps the detected channel if @channel does not change anything, so that
+ * this can be called for every buffer */
+void
+gst_ltc_decoder_set_channel (GstLtcDecoder * dec, gint channel)
+{
+  if (channel >= dec->channels)
+    channel = -1;
+
+  if (channel == dec->channel)
+    return;
+
+  dec->channel = channel;
+  dec->locked = -1;
+}
+
+/* The channel timecodes are taken from, -1 if not locked yet */
+gint
+gst_ltc_decoder_get_channel (GstLtcDecoder * dec)
+{
+  return dec->channel >= 0 ? dec->channel : dec->locked;
+}
+
+static void
+ltc_channel_lose_sync (LtcChannel * lc, guint64 pos)
+{
+  lc->pending_half = FALSE;
+  lc->n_bits = 0;
+  lc->consecutive = 0;
+  lc->bit_start = pos;
+}
+
+static void
+ltc_decoder_frame (GstLtcDecoder * dec, gint c, guint64 offset)
+{
+  LtcChannel *lc = &dec->ch[c];
+  GstLtcDecoderFrame frame;
+  guint64 lo = lc->lo;
+  guint fu, ft, su, st, mu, mt, hu, ht;
+
+  fu = lo & 0xf;
+  ft = (lo >> 8) & 0x3;
+  su = (lo >> 16) & 0xf;
+  st = (lo >> 24) & 0x7;
+  mu = (lo >> 32) & 0xf;
+  mt = (lo >> 40) & 0x7;
+  hu = (lo >> 48) & 0xf;
+  ht = (lo >> 56) & 0x3;
+
+  if (fu > 9 || su > 9 || mu > 9 || hu > 9 || ft * 10 + fu > 29 || st > 5 ||
+      mt > 5 || ht * 10 + hu > 23) {
+    lc->consecutive = 0;
+    return;
+  }
+
+  if (lc->has_frame &&
+      ABS ((gint64) (offset - lc->last_frame_offset) -
+          (gint64) (LTC_FRAME_BITS * lc->period)) < 4 * lc->period)
+    lc->consecutive++;
+  else
+    lc->consecutive = 1;
+  lc->has_frame = TRUE;
+  lc->last_frame_offset = offset;
+
+  if (dec->channel < 0) {
+    if (lc->consecutive < 2)
+      return;
+
+    if (dec->locked < 0 || (dec->locked != c &&
+            offset > dec->ch[dec->locked].last_frame_offset + dec->rate / 2))
+      dec->locked = c;
+
+    if (dec->locked != c)
+      return;
+  }
+
+  frame.frames = ft * 10 + fu;
+  frame.seconds = st * 10 + su;
+  frame.minutes = mt * 10 + mu;
+  frame.hours = ht * 10 + hu;
+  frame.drop_frame = (lo >> 10) & 1;
+  frame.offset = offset;
+  frame.channel = c;
+  g_array_append_val (dec->frames, frame);
+}
+
+static void
+ltc_decoder_bit (GstLtcDecoder * dec, gint c, guint bit, guint64 start)
+{
+  LtcChannel *lc = &dec->ch[c];
+
+  lc->lo = (lc->lo >> 1) | ((guint64) (lc->hi & 1) << 63);
+  lc->hi = (lc->hi >> 1) | (bit << 15);
+
+  lc->bit_starts[lc->ring_pos] = start;
+  lc->ring_pos = (lc->ring_pos + 1) % LTC_FRAME_BITS;
+  if (lc->n_bits < LTC_FRAME_BITS)
+    lc->n_bits++;
+
+  if (lc->n_bits == LTC_FRAME_BITS && lc->hi == LTC_SYNC_WORD) {
+    /* the oldest bit start is that of bit 0 */
+    ltc_decoder_frame (dec, c, lc->bit_starts[lc->ring_pos]);
+    lc->n_bits = 0;
+  }
+}
+
+static void
+ltc_decoder_edge (GstLtcDecoder * dec, gint c, guint64 pos)
+{
+  LtcChannel *lc = &dec->ch[c];
+  gfloat interval;
+
+  if (!lc->has_edge) {
+    lc->has_edge = TRUE;
+    lc->last_edge = lc->bit_start = pos;
+    return;
+  }
+
+  interval = pos - lc->last_edge;
+  lc->last_edge = pos;
+
+  if (interval < 0.3f * lc->period || interval > 1.4f * lc->period) {
+    /* glitch or dropout, restart from this edge with the new bit period if
+     * it is a plausible one */
+    ltc_channel_lose_sync (lc, pos);
+    if (interval >= dec->min_period && interval <= dec->max_period)
+      lc->period = interval;
+    return;
+  }
+
+  if (interval > 0.75f * lc->period) {
+    /* a full bit without transition in the middle is a 0 */
+    if (lc->pending_half) {
+      ltc_channel_lose_sync (lc, pos);
+      return;
+    }
+    ltc_decoder_bit (dec, c, 0, lc->bit_start);
+    lc->bit_start = pos;
+    lc->period += (interval - lc->period) / 8;
+  } else {
+    /* two half bits are a 1 */
+    if (lc->pending_half) {
+      ltc_decoder_bit (dec, c, 1, lc->bit_start);
+      lc->bit_start = pos;
+    }
+    lc->pending_half = !lc->pending_half;
+    lc->period += (2 * interval - lc->period) / 8;
+  }
+
+  lc->period = CLAMP (lc->period, dec->min_period, dec->max_period);
+}
+
+static void
+ltc_decoder_convert (GstLtcDecoder * dec, const guint8 * data, guint n)
+{
+  gfloat *out = dec->block;
+  guint i;
+
+  switch (dec->format) {
+    case GST_AUDIO_FORMAT_U8:
+      for (i = 0; i < n; i++)
+        out[i] = ((gint) data[i] - 128) / 128.0f;
+      break;
+    case GST_AUDIO_FORMAT_S16LE:{
+      const gint16 *in = (const gint16 *) data;
+
+      for (i = 0; i < n; i++)
+        out[i] = GINT16_FROM_LE (in[i]) / 32768.0f;
+      break;
+    }
+    case GST_AUDIO_FORMAT_S32LE:{
+      const gint32 *in = (const gint32 *) data;
+
+      for (i = 0; i < n; i++)
+        out[i] = GINT32_FROM_LE (in[i]) / 2147483648.0f;
+      break;
+    }
+    case GST_AUDIO_FORMAT_F32LE:
+      memcpy (out, data, n * sizeof (gfloat));
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+}
+
+static void
+ltc_decoder_process_block (GstLtcDecoder * dec, guint n, guint64 offset)
+{
+  const gint channels = dec->channels;
+  const gfloat *block = dec->block;
+  gint8 *levels = dec->levels;
+  gfloat *peaks = dec->block_peaks;
+  gfloat *thr = dec->thresholds;
+  gint c, first, last;
+  guint i;
+
+  /* channel peaks */
+  for (c = 0; c < channels; c++)
+    peaks[c] = 0;
+  for (i = 0; i < n; i++) {
+    for (c = 0; c < channels; c++) {
+      gfloat v = ABS (block[i * channels + c]);
+
+      peaks[c] = MAX (peaks[c], v);
+    }
+  }
+
+  for (c = 0; c < channels; c++) {
+    dec->ch[c].peak = MAX (dec->ch[c].peak * PEAK_DECAY, peaks[c]);
+    thr[c] = MAX (dec->ch[c].peak * THRESHOLD_RATIO, MIN_THRESHOLD);
+  }
+
+  /* quantize with a dead zone around 0 */
+  for (i = 0; i < n; i++) {
+    for (c = 0; c < channels; c++) {
+      gfloat v = block[i * channels + c];
+
+      levels[i * channels + c] = (v > thr[c]) - (v < -thr[c]);
+    }
+  }
+
+  if (dec->channel >= 0) {
+    first = last = dec->channel;
+  } else {
+    first = 0;
+    last = channels - 1;
+  }
+
+  /* level changes, placed at the zero crossing that preceded them */
+  for (c = first; c <= last; c++) {
+    LtcChannel *lc = &dec->ch[c];
+    gint8 level = lc->level;
+
+    for (i = 0; i < n; i++) {
+      gint8 q = levels[i * channels + c];
+
+      if (q != 0 && q != level) {
+        if (level != 0) {
+          guint j = i, k = 0;
+
+          while (j > 0 && k < MAX_EDGE_BACKTRACK &&
+              (block[(j - 1) * channels + c] > 0) == (q > 0)) {
+            j--;
+            k++;
+          }
+          ltc_decoder_edge (dec, c, offset + j);
+        }
+        level = q;
+      }
+    }
+
+    lc->level = level;
+  }
+}
+
+/* Decodes @n_samples interleaved samples, the first one being at sample
+ * @offset */
+void
+gst_ltc_decoder_write (GstLtcDecoder * dec, const guint8 * data,
+    guint n_samples, guint64 offset)
+{
+  guint bpf = GST_AUDIO_FORMAT_INFO_WIDTH (gst_audio_format_get_info
+      (dec->format)) / 8 * dec->channels;
+
+  while (n_samples > 0) {
+    guint n = MIN (n_samples, BLOCK_SIZE);
+
+    ltc_decoder_convert (dec, data, n * dec->channels);
+    ltc_decoder_process_block (dec, n, offset);
+
+    data += n * bpf;
+    offset += n;
+    n_samples -= n;
+  }
+}
+
+gboolean
+gst_ltc_decoder_read (GstLtcDecoder * dec, GstLtcDecoderFrame * frame)
+{
+  if (dec->frames->len == 0)
+    return FALSE;
+
+  *frame = g_array_index (dec->frames, GstLtcDecoderFrame, 0);
+  g_array_remove_index (dec->frames, 0);
+
+  return TRUE;
+}
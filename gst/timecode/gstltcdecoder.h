@@ -0,0 +1,70 @@
+/*
+ * GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_LTC_DECODER_H__
+#define __GST_LTC_DECODER_H__
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstLtcDecoder GstLtcDecoder;
+
+/* A decoded LTC frame */
+typedef struct
+{
+  guint hours;
+  guint minutes;
+  guint seconds;
+  guint frames;
+  gboolean drop_frame;
+  /* Sample offset of the first edge of the frame, in the offsets passed to
+   * gst_ltc_decoder_write() */
+  guint64 offset;
+  guint channel;
+} GstLtcDecoderFrame;
+
+G_GNUC_INTERNAL
+GstLtcDecoder * gst_ltc_decoder_new (GstAudioFormat format, gint rate,
+    gint channels);
+
+G_GNUC_INTERNAL
+void gst_ltc_decoder_free (GstLtcDecoder * dec);
+
+G_GNUC_INTERNAL
+void gst_ltc_decoder_reset (GstLtcDecoder * dec);
+
+G_GNUC_INTERNAL
+void gst_ltc_decoder_set_channel (GstLtcDecoder * dec, gint channel);
+
+G_GNUC_INTERNAL
+gint gst_ltc_decoder_get_channel (GstLtcDecoder * dec);
+
+G_GNUC_INTERNAL
+void gst_ltc_decoder_write (GstLtcDecoder * dec, const guint8 * data,
+    guint n_samples, guint64 offset);
+
+G_GNUC_INTERNAL
+gboolean gst_ltc_decoder_read (GstLtcDecoder * dec,
+    GstLtcDecoderFrame * frame);
+
+G_END_DECLS
+
+#endif /* __GST_LTC_DECODER_H__ */
@@ -35,6 +35,11 @@
  * gst-launch-1.0 videotestsrc ! timecodestamper ! autovideosink
  * ]|
  *
+ * With #GstTimeCodeStamper:ltc-decoder set to `builtin`, the LTC audio can
+ * have any number of channels, in U8, S16LE, S32LE or F32LE. All channels
+ * are scanned in one pass and the one carrying LTC is detected, unless
+ * #GstTimeCodeStamper:ltc-channel selects it. Timecodes are placed at the
+ * sample where their frame starts.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -71,7 +76,9 @@ enum
   PROP_LTC_TIMEOUT,
   PROP_RTC_MAX_DRIFT,
   PROP_RTC_AUTO_RESYNC,
-  PROP_TIMECODE_OFFSET
+  PROP_TIMECODE_OFFSET,
+  PROP_LTC_DECODER,
+  PROP_LTC_CHANNEL
 };
 
 #define DEFAULT_SOURCE GST_TIME_CODE_STAMPER_SOURCE_INTERNAL
@@ -88,6 +95,8 @@ enum
 #define DEFAULT_RTC_MAX_DRIFT 250000000
 #define DEFAULT_RTC_AUTO_RESYNC TRUE
 #define DEFAULT_TIMECODE_OFFSET 0
+#define DEFAULT_LTC_DECODER GST_TIME_CODE_STAMPER_LTC_DECODER_LIBLTC
+#define DEFAULT_LTC_CHANNEL -1
 
 #define DEFAULT_LTC_QUEUE 100
 
@@ -113,9 +122,12 @@ static GstStaticPadTemplate gst_timecodestamper_ltc_template =
 GST_STATIC_PAD_TEMPLATE ("ltc_sink",
     GST_PAD_SINK,
     GST_PAD_REQUEST,
-    GST_STATIC_CAPS ("audio/x-raw,format=U8,rate=[1,max],channels=1")
+    GST_STATIC_CAPS ("audio/x-raw,format={U8,S16LE,S32LE,F32LE},"
+        "rate=[1,max],channels=[1,max],layout=interleaved")
     );
 
+#define LIBLTC_CAPS "audio/x-raw,format=U8,rate=[1,max],channels=1"
+
 static void gst_timecodestamper_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_timecodestamper_get_property (GObject * object, guint prop_id,
@@ -217,6 +229,24 @@ gst_timecodestamper_set_get_type (void)
   return type;
 }
 
+GType
+gst_timecodestamper_ltc_decoder_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_TIME_CODE_STAMPER_LTC_DECODER_LIBLTC,
+        "libltc, on mono U8 audio", "libltc"},
+    {GST_TIME_CODE_STAMPER_LTC_DECODER_BUILTIN,
+        "Built-in decoder, on any channel of multi-channel audio", "builtin"},
+    {0, NULL, NULL},
+  };
+
+  if (!type) {
+    type = g_enum_register_static ("GstTimeCodeStamperLtcDecoder", values);
+  }
+  return type;
+}
+
 static void
 gst_timecodestamper_class_init (GstTimeCodeStamperClass * klass)
 {
@@ -315,6 +345,35 @@ gst_timecodestamper_class_init (GstTimeCodeStamperClass * klass)
           "useful if there is an offset between the timecode source and video",
           G_MININT, G_MAXINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstTimeCodeStamper:ltc-decoder:
+   *
+   * Decoder used for the LTC audio.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_LTC_DECODER,
+      g_param_spec_enum ("ltc-decoder", "LTC Decoder",
+          "Decoder used for the LTC audio",
+          GST_TYPE_TIME_CODE_STAMPER_LTC_DECODER, DEFAULT_LTC_DECODER,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstTimeCodeStamper:ltc-channel:
+   *
+   * Channel of the LTC audio carrying the timecode, or -1 to detect it. Only
+   * used by the built-in decoder.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_LTC_CHANNEL,
+      g_param_spec_int ("ltc-channel", "LTC Channel",
+          "Channel of the LTC audio carrying the timecode (-1 = detect)",
+          -1, G_MAXINT, DEFAULT_LTC_CHANNEL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&gst_timecodestamper_sink_template));
   gst_element_class_add_pad_template (element_class,
@@ -340,6 +399,7 @@ gst_timecodestamper_class_init (GstTimeCodeStamperClass * klass)
 
   gst_type_mark_as_plugin_api (GST_TYPE_TIME_CODE_STAMPER_SOURCE, 0);
   gst_type_mark_as_plugin_api (GST_TYPE_TIME_CODE_STAMPER_SET, 0);
+  gst_type_mark_as_plugin_api (GST_TYPE_TIME_CODE_STAMPER_LTC_DECODER, 0);
 }
 
 static void
@@ -357,6 +417,8 @@ gst_timecodestamper_init (GstTimeCodeStamper * timecodestamper)
   timecodestamper->ltc_daily_jam = DEFAULT_LTC_DAILY_JAM;
   timecodestamper->ltc_auto_resync = DEFAULT_LTC_AUTO_RESYNC;
   timecodestamper->ltc_extra_latency = DEFAULT_LTC_EXTRA_LATENCY;
+  timecodestamper->ltc_decoder = DEFAULT_LTC_DECODER;
+  timecodestamper->ltc_channel = DEFAULT_LTC_CHANNEL;
   timecodestamper->ltc_timeout = DEFAULT_LTC_TIMEOUT;
   timecodestamper->rtc_max_drift = DEFAULT_RTC_MAX_DRIFT;
   timecodestamper->rtc_auto_resync = DEFAULT_RTC_AUTO_RESYNC;
@@ -382,6 +444,8 @@ gst_timecodestamper_init (GstTimeCodeStamper * timecodestamper)
   timecodestamper->ltc_internal_tc = NULL;
   timecodestamper->ltc_internal_running_time = GST_CLOCK_TIME_NONE;
   timecodestamper->ltc_dec = NULL;
+  timecodestamper->ltc_builtin_dec = NULL;
+  timecodestamper->ltc_builtin_channel = -1;
   timecodestamper->ltc_total = 0;
 
   timecodestamper->ltc_eos = TRUE;
@@ -454,6 +518,11 @@ gst_timecodestamper_dispose (GObject * object)
     timecodestamper->ltc_dec = NULL;
   }
 
+  if (timecodestamper->ltc_builtin_dec) {
+    gst_ltc_decoder_free (timecodestamper->ltc_builtin_dec);
+    timecodestamper->ltc_builtin_dec = NULL;
+  }
+
   if (timecodestamper->stream_align) {
     gst_audio_stream_align_free (timecodestamper->stream_align);
     timecodestamper->stream_align = NULL;
@@ -545,6 +614,12 @@ gst_timecodestamper_set_property (GObject * object, guint prop_id,
     case PROP_LTC_EXTRA_LATENCY:
       timecodestamper->ltc_extra_latency = g_value_get_uint64 (value);
       break;
+    case PROP_LTC_DECODER:
+      timecodestamper->ltc_decoder = g_value_get_enum (value);
+      break;
+    case PROP_LTC_CHANNEL:
+      timecodestamper->ltc_channel = g_value_get_int (value);
+      break;
     case PROP_RTC_MAX_DRIFT:
       timecodestamper->rtc_max_drift = g_value_get_uint64 (value);
       break;
@@ -603,6 +678,12 @@ gst_timecodestamper_get_property (GObject * object, guint prop_id,
     case PROP_LTC_EXTRA_LATENCY:
       g_value_set_uint64 (value, timecodestamper->ltc_extra_latency);
       break;
+    case PROP_LTC_DECODER:
+      g_value_set_enum (value, timecodestamper->ltc_decoder);
+      break;
+    case PROP_LTC_CHANNEL:
+      g_value_set_int (value, timecodestamper->ltc_channel);
+      break;
     case PROP_RTC_MAX_DRIFT:
       g_value_set_uint64 (value, timecodestamper->rtc_max_drift);
       break;
@@ -682,6 +763,11 @@ gst_timecodestamper_stop (GstBaseTransform * trans)
     timecodestamper->ltc_dec = NULL;
   }
 
+  if (timecodestamper->ltc_builtin_dec) {
+    gst_ltc_decoder_free (timecodestamper->ltc_builtin_dec);
+    timecodestamper->ltc_builtin_dec = NULL;
+  }
+
   if (timecodestamper->stream_align) {
     gst_audio_stream_align_free (timecodestamper->stream_align);
     timecodestamper->stream_align = NULL;
@@ -1740,6 +1826,11 @@ gst_timecodestamper_release_pad (GstElement * element, GstPad * pad)
     timecodestamper->ltc_dec = NULL;
   }
 
+  if (timecodestamper->ltc_builtin_dec) {
+    gst_ltc_decoder_free (timecodestamper->ltc_builtin_dec);
+    timecodestamper->ltc_builtin_dec = NULL;
+  }
+
   if (timecodestamper->stream_align) {
     gst_audio_stream_align_free (timecodestamper->stream_align);
     timecodestamper->stream_align = NULL;
@@ -1759,6 +1850,59 @@ gst_timecodestamper_release_pad (GstElement * element, GstPad * pad)
 }
 
 #if HAVE_LTC
+/* Called with the mutex held. @offset is in samples since the first buffer
+ * after the last discont */
+static void
+gst_timecodestamper_queue_ltc_timecode (GstTimeCodeStamper * timecodestamper,
+    gint64 offset, guint hours, guint minutes, guint seconds, guint frames,
+    gboolean discont)
+{
+  TimestampedTimecode *ltc_tc;
+  GstClockTime ltc_running_time;
+
+  if (offset < 0) {
+    GstClockTime time_offset =
+        gst_util_uint64_scale (GST_SECOND, -offset,
+        timecodestamper->ainfo.rate);
+
+    if (time_offset > timecodestamper->ltc_first_running_time)
+      ltc_running_time = 0;
+    else
+      ltc_running_time = timecodestamper->ltc_first_running_time - time_offset;
+  } else {
+    ltc_running_time = timecodestamper->ltc_first_running_time +
+        gst_util_uint64_scale (GST_SECOND, offset, timecodestamper->ainfo.rate);
+  }
+
+  GST_INFO_OBJECT (timecodestamper,
+      "Got LTC timecode %02u:%02u:%02u:%02u at %" GST_TIME_FORMAT,
+      hours, minutes, seconds, frames, GST_TIME_ARGS (ltc_running_time));
+
+  ltc_tc = g_new0 (TimestampedTimecode, 1);
+  ltc_tc->running_time = ltc_running_time;
+  /* We fill in the framerate and other metadata later */
+  gst_video_time_code_init (&ltc_tc->timecode,
+      0, 0, timecodestamper->ltc_daily_jam, 0,
+      hours, minutes, seconds, frames, 0);
+
+  /* If we have a discontinuity it might happen that we're getting
+   * timecodes that are in the past relative to timecodes we already have
+   * in our queue. We have to get rid of all the timecodes that are in the
+   * future now. */
+  if (discont) {
+    TimestampedTimecode *tmp;
+
+    while ((tmp = g_queue_peek_tail (&timecodestamper->ltc_current_tcs)) &&
+        tmp->running_time >= ltc_running_time) {
+      gst_video_time_code_clear (&tmp->timecode);
+      g_free (tmp);
+      g_queue_pop_tail (&timecodestamper->ltc_current_tcs);
+    }
+  }
+
+  g_queue_push_tail (&timecodestamper->ltc_current_tcs, ltc_tc);
+}
+
 static GstFlowReturn
 gst_timecodestamper_ltcpad_chain (GstPad * pad,
     GstObject * parent, GstBuffer * buffer)
@@ -1769,6 +1913,8 @@ gst_timecodestamper_ltcpad_chain (GstPad * pad,
   GstClockTime timestamp, running_time, duration;
   guint nsamples;
   gboolean discont;
+  GstTimeCodeStamperLtcDecoder ltc_decoder;
+  gint ltc_channel;
 
   if (timecodestamper->audio_latency == -1 || gst_pad_check_reconfigure (pad)) {
     gst_timecodestamper_update_latency (timecodestamper, pad,
@@ -1797,15 +1943,34 @@ gst_timecodestamper_ltcpad_chain (GstPad * pad,
       &timestamp, &duration, NULL);
 
   if (discont) {
-    if (timecodestamper->ltc_dec) {
+    if (timecodestamper->ltc_dec || timecodestamper->ltc_builtin_dec) {
       GST_WARNING_OBJECT (timecodestamper, "Got discont at %" GST_TIME_FORMAT,
           GST_TIME_ARGS (timestamp));
-      ltc_decoder_queue_flush (timecodestamper->ltc_dec);
     }
+    if (timecodestamper->ltc_dec)
+      ltc_decoder_queue_flush (timecodestamper->ltc_dec);
+    if (timecodestamper->ltc_builtin_dec)
+      gst_ltc_decoder_reset (timecodestamper->ltc_builtin_dec);
     timecodestamper->ltc_total = 0;
   }
 
-  if (!timecodestamper->ltc_dec) {
+  GST_OBJECT_LOCK (timecodestamper);
+  ltc_decoder = timecodestamper->ltc_decoder;
+  ltc_channel = timecodestamper->ltc_channel;
+  GST_OBJECT_UNLOCK (timecodestamper);
+
+  if (ltc_decoder == GST_TIME_CODE_STAMPER_LTC_DECODER_BUILTIN) {
+    if (!timecodestamper->ltc_builtin_dec) {
+      timecodestamper->ltc_builtin_dec =
+          gst_ltc_decoder_new (GST_AUDIO_INFO_FORMAT (&timecodestamper->ainfo),
+          GST_AUDIO_INFO_RATE (&timecodestamper->ainfo),
+          GST_AUDIO_INFO_CHANNELS (&timecodestamper->ainfo));
+      timecodestamper->ltc_builtin_channel = -1;
+      timecodestamper->ltc_total = 0;
+    }
+    gst_ltc_decoder_set_channel (timecodestamper->ltc_builtin_dec,
+        ltc_channel);
+  } else if (!timecodestamper->ltc_dec) {
     gint samples_per_frame = 1920;
 
     GST_OBJECT_LOCK (timecodestamper);
@@ -1836,71 +2001,45 @@ gst_timecodestamper_ltcpad_chain (GstPad * pad,
     timecodestamper->ltc_first_running_time = running_time;
   }
 
-  gst_buffer_map (buffer, &map, GST_MAP_READ);
-  ltc_decoder_write (timecodestamper->ltc_dec, map.data, map.size,
-      timecodestamper->ltc_total);
-  timecodestamper->ltc_total += map.size;
-  gst_buffer_unmap (buffer, &map);
-
   /* Now read all the timecodes from the decoder that are currently available
    * and store them in our own queue, which gives us more control over how
    * things are working. */
-  {
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  if (ltc_decoder == GST_TIME_CODE_STAMPER_LTC_DECODER_BUILTIN) {
+    GstLtcDecoderFrame frame;
+    gint channel;
+
+    gst_ltc_decoder_write (timecodestamper->ltc_builtin_dec, map.data,
+        nsamples, timecodestamper->ltc_total);
+    timecodestamper->ltc_total += nsamples;
+    gst_buffer_unmap (buffer, &map);
+
+    while (gst_ltc_decoder_read (timecodestamper->ltc_builtin_dec, &frame)) {
+      gst_timecodestamper_queue_ltc_timecode (timecodestamper, frame.offset,
+          frame.hours, frame.minutes, frame.seconds, frame.frames, discont);
+    }
+
+    channel = gst_ltc_decoder_get_channel (timecodestamper->ltc_builtin_dec);
+    if (channel != timecodestamper->ltc_builtin_channel) {
+      GST_INFO_OBJECT (timecodestamper, "Decoding LTC from channel %d",
+          channel);
+      timecodestamper->ltc_builtin_channel = channel;
+    }
+  } else {
     LTCFrameExt ltc_frame;
 
+    ltc_decoder_write (timecodestamper->ltc_dec, map.data, map.size,
+        timecodestamper->ltc_total);
+    timecodestamper->ltc_total += map.size;
+    gst_buffer_unmap (buffer, &map);
+
     while (ltc_decoder_read (timecodestamper->ltc_dec, &ltc_frame) == 1) {
       SMPTETimecode stc;
-      TimestampedTimecode *ltc_tc;
-      GstClockTime ltc_running_time;
-
-      if (ltc_frame.off_start < 0) {
-        GstClockTime offset =
-            gst_util_uint64_scale (GST_SECOND, -ltc_frame.off_start,
-            timecodestamper->ainfo.rate);
-
-        if (offset > timecodestamper->ltc_first_running_time)
-          ltc_running_time = 0;
-        else
-          ltc_running_time = timecodestamper->ltc_first_running_time - offset;
-      } else {
-        ltc_running_time = timecodestamper->ltc_first_running_time +
-            gst_util_uint64_scale (GST_SECOND, ltc_frame.off_start,
-            timecodestamper->ainfo.rate);
-      }
 
       ltc_frame_to_time (&stc, &ltc_frame.ltc, 0);
-      GST_INFO_OBJECT (timecodestamper,
-          "Got LTC timecode %02d:%02d:%02d:%02d at %" GST_TIME_FORMAT,
-          stc.hours, stc.mins, stc.secs, stc.frame,
-          GST_TIME_ARGS (ltc_running_time));
-
-      ltc_tc = g_new0 (TimestampedTimecode, 1);
-      ltc_tc->running_time = ltc_running_time;
-      /* We fill in the framerate and other metadata later */
-      gst_video_time_code_init (&ltc_tc->timecode,
-          0, 0, timecodestamper->ltc_daily_jam, 0,
-          stc.hours, stc.mins, stc.secs, stc.frame, 0);
-
-      /* If we have a discontinuity it might happen that we're getting
-       * timecodes that are in the past relative to timecodes we already have
-       * in our queue. We have to get rid of all the timecodes that are in the
-       * future now. */
-      if (discont) {
-        TimestampedTimecode *tmp;
-
-        while ((tmp = g_queue_peek_tail (&timecodestamper->ltc_current_tcs)) &&
-            tmp->running_time >= ltc_running_time) {
-          gst_video_time_code_clear (&tmp->timecode);
-          g_free (tmp);
-          g_queue_pop_tail (&timecodestamper->ltc_current_tcs);
-        }
-
-        g_queue_push_tail (&timecodestamper->ltc_current_tcs,
-            g_steal_pointer (&ltc_tc));
-      } else {
-        g_queue_push_tail (&timecodestamper->ltc_current_tcs,
-            g_steal_pointer (&ltc_tc));
-      }
+      gst_timecodestamper_queue_ltc_timecode (timecodestamper,
+          ltc_frame.off_start, stc.hours, stc.mins, stc.secs, stc.frame,
+          discont);
     }
   }
 
@@ -1917,7 +2056,7 @@ gst_timecodestamper_ltcpad_chain (GstPad * pad,
     while ((timecodestamper->video_current_running_time == GST_CLOCK_TIME_NONE
             || running_time + duration >=
             timecodestamper->video_current_running_time)
-        && timecodestamper->ltc_dec
+        && (timecodestamper->ltc_dec || timecodestamper->ltc_builtin_dec)
         && g_queue_get_length (&timecodestamper->ltc_current_tcs) >
         DEFAULT_LTC_QUEUE / 2 && !timecodestamper->video_eos
         && !timecodestamper->ltc_flushing) {
@@ -1948,20 +2087,46 @@ gst_timecodestamper_ltcpad_event (GstPad * pad,
   gboolean ret = TRUE;
 
   switch (GST_EVENT_TYPE (event)) {
-    case GST_EVENT_CAPS:
+    case GST_EVENT_CAPS:{
+      GstAudioInfo ainfo;
+      GstTimeCodeStamperLtcDecoder ltc_decoder;
+
       gst_event_parse_caps (event, &caps);
 
-      if (!gst_audio_info_from_caps (&timecodestamper->ainfo, caps)) {
+      if (!gst_audio_info_from_caps (&ainfo, caps)) {
         gst_event_unref (event);
         return FALSE;
       }
 
+      GST_OBJECT_LOCK (timecodestamper);
+      ltc_decoder = timecodestamper->ltc_decoder;
+      GST_OBJECT_UNLOCK (timecodestamper);
+
+      if (ltc_decoder == GST_TIME_CODE_STAMPER_LTC_DECODER_LIBLTC &&
+          (GST_AUDIO_INFO_FORMAT (&ainfo) != GST_AUDIO_FORMAT_U8 ||
+              GST_AUDIO_INFO_CHANNELS (&ainfo) != 1)) {
+        GST_ERROR_OBJECT (timecodestamper,
+            "libltc only handles mono U8 audio, caps %" GST_PTR_FORMAT, caps);
+        gst_event_unref (event);
+        return FALSE;
+      }
+
+      g_mutex_lock (&timecodestamper->mutex);
+      if (timecodestamper->ltc_builtin_dec &&
+          !gst_audio_info_is_equal (&ainfo, &timecodestamper->ainfo)) {
+        gst_ltc_decoder_free (timecodestamper->ltc_builtin_dec);
+        timecodestamper->ltc_builtin_dec = NULL;
+      }
+      timecodestamper->ainfo = ainfo;
+      g_mutex_unlock (&timecodestamper->mutex);
+
       if (timecodestamper->stream_align) {
         gst_audio_stream_align_set_rate (timecodestamper->stream_align,
             timecodestamper->ainfo.rate);
       }
 
       break;
+    }
     case GST_EVENT_SEGMENT:
       gst_event_copy_segment (event, &timecodestamper->ltc_segment);
       break;
@@ -1998,12 +2163,22 @@ static gboolean
 gst_timecodestamper_ltcpad_query (GstPad * pad,
     GstObject * parent, GstQuery * query)
 {
+  GstTimeCodeStamper *timecodestamper = GST_TIME_CODE_STAMPER (parent);
   GstCaps *caps, *filter, *tcaps;
+  GstTimeCodeStamperLtcDecoder ltc_decoder;
 
   switch (GST_QUERY_TYPE (query)) {
     case GST_QUERY_CAPS:
       gst_query_parse_caps (query, &filter);
-      tcaps = gst_pad_get_pad_template_caps (pad);
+
+      GST_OBJECT_LOCK (timecodestamper);
+      ltc_decoder = timecodestamper->ltc_decoder;
+      GST_OBJECT_UNLOCK (timecodestamper);
+
+      if (ltc_decoder == GST_TIME_CODE_STAMPER_LTC_DECODER_LIBLTC)
+        tcaps = gst_caps_from_string (LIBLTC_CAPS);
+      else
+        tcaps = gst_pad_get_pad_template_caps (pad);
       if (filter)
         caps = gst_caps_intersect_full (tcaps, filter,
             GST_CAPS_INTERSECT_FIRST);
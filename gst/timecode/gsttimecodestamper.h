@@ -31,6 +31,8 @@
 #include <ltc.h>
 #endif
 
+#include "gstltcdecoder.h"
+
 #define GST_TYPE_TIME_CODE_STAMPER            (gst_timecodestamper_get_type())
 #define GST_TIME_CODE_STAMPER(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_TIME_CODE_STAMPER,GstTimeCodeStamper))
 #define GST_TIME_CODE_STAMPER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_TIME_CODE_STAMPER,GstTimeCodeStamperClass))
@@ -40,6 +42,7 @@
 
 #define GST_TYPE_TIME_CODE_STAMPER_SOURCE (gst_timecodestamper_source_get_type())
 #define GST_TYPE_TIME_CODE_STAMPER_SET (gst_timecodestamper_set_get_type())
+#define GST_TYPE_TIME_CODE_STAMPER_LTC_DECODER (gst_timecodestamper_ltc_decoder_get_type())
 
 typedef struct _GstTimeCodeStamper GstTimeCodeStamper;
 typedef struct _GstTimeCodeStamperClass GstTimeCodeStamperClass;
@@ -60,6 +63,11 @@ typedef enum GstTimeCodeStamperSet {
   GST_TIME_CODE_STAMPER_SET_ALWAYS,
 } GstTimeCodeStamperSet;
 
+typedef enum GstTimeCodeStamperLtcDecoder {
+  GST_TIME_CODE_STAMPER_LTC_DECODER_LIBLTC,
+  GST_TIME_CODE_STAMPER_LTC_DECODER_BUILTIN,
+} GstTimeCodeStamperLtcDecoder;
+
 /**
  * GstTimeCodeStamper:
  *
@@ -86,6 +94,8 @@ struct _GstTimeCodeStamper
   gboolean ltc_auto_resync;
   GstClockTime ltc_timeout;
   GstClockTime ltc_extra_latency;
+  GstTimeCodeStamperLtcDecoder ltc_decoder;
+  gint ltc_channel;
   GstClockTime rtc_max_drift;
   gboolean rtc_auto_resync;
   gint timecode_offset;
@@ -136,6 +146,8 @@ struct _GstTimeCodeStamper
 
   /* Protected by mutex above */
   LTCDecoder *ltc_dec;
+  GstLtcDecoder *ltc_builtin_dec;
+  gint ltc_builtin_channel;
   ltc_off_t ltc_total;
 
   /* Protected by mutex above */
@@ -167,6 +179,7 @@ GST_ELEMENT_REGISTER_DECLARE (timecodestamper);
 
 GType gst_timecodestamper_source_get_type (void);
 GType gst_timecodestamper_set_get_type (void);
+GType gst_timecodestamper_ltc_decoder_get_type (void);
 
 G_END_DECLS
 #endif /* __GST_TIME_CODE_STAMPER_H__ */
@@ -33,6 +33,23 @@
  *
  * The scenechange element does not work with compressed video.
  *
+ * In #GstSceneChange:mode=fast, the element computes a thumbnail of the
+ * luma plane and per-block luma histograms of the thumbnail once per frame,
+ * and keeps only this compact signature of the previous frame instead of a
+ * reference to its buffer. The detection then runs on the signatures, which
+ * makes it considerably cheaper on high resolution video. As the thumbnail
+ * lacks the fine detail, its scores are lower than the full resolution ones
+ * and the fast mode uses lower thresholds, and also detects a change when
+ * the histogram distance shows that most of the picture changed. Cuts
+ * between pictures that only differ in fine detail can be missed.
+ *
+ * If #GstSceneChange:add-meta is enabled, every frame after the first is
+ * decorated with a "GstSceneChangeMeta" custom meta (see
+ * gst_buffer_get_custom_meta()) whose structure holds the "score" and the
+ * "threshold" used for the decision, whether a "scene-change" was detected
+ * and, in fast mode, the "histogram-distance" between 0.0 and 1.0. Encoders
+ * can use this for rate control decisions around cuts.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 -v filesrc location=some_file.ogv ! decodebin !
@@ -90,6 +107,12 @@ GST_DEBUG_CATEGORY_STATIC (gst_scene_change_debug_category);
 /* prototypes */
 
 
+static void gst_scene_change_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_scene_change_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_scene_change_finalize (GObject * object);
+static gboolean gst_scene_change_stop (GstBaseTransform * trans);
 static GstFlowReturn gst_scene_change_transform_frame_ip (GstVideoFilter *
     filter, GstVideoFrame * frame);
 
@@ -100,9 +123,59 @@ static gboolean is_shot_change (int frame_number);
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_MODE,
+  PROP_DOWNSCALE,
+  PROP_ADD_META
 };
 
+#define DEFAULT_MODE GST_SCENE_CHANGE_MODE_FULL
+#define DEFAULT_DOWNSCALE 8
+#define DEFAULT_ADD_META FALSE
+
+#define SCENE_CHANGE_META_NAME "GstSceneChangeMeta"
+
+/* Absolute score thresholds of the decision: below min_score there is never
+ * a scene change, above jump_score there is one if the score jumped from the
+ * previous frame, and above max_score there always is one */
+typedef struct
+{
+  double min_score;
+  double jump_score;
+  double max_score;
+} GstSceneChangeThresholds;
+
+static const GstSceneChangeThresholds full_thresholds = { 5, 30, 50 };
+
+/* The thumbnail scores are lower, see get_signature_score(), so the fast
+ * mode uses lower thresholds and, as the histograms of the blocks change
+ * far more on a cut than on motion, also detects a change if more than
+ * FAST_HIST_DIST_CUT of the thumbnail moved to other bins */
+static const GstSceneChangeThresholds fast_thresholds = { 3, 20, 35 };
+
+#define FAST_HIST_DIST_CUT 0.45
+
+#define GST_TYPE_SCENE_CHANGE_MODE (gst_scene_change_mode_get_type ())
+GType
+gst_scene_change_mode_get_type (void)
+{
+  static GType scene_change_mode_type = 0;
+
+  if (!scene_change_mode_type) {
+    static const GEnumValue scene_change_modes[] = {
+      {GST_SCENE_CHANGE_MODE_FULL,
+          "Full resolution luma SAD against the previous frame", "full"},
+      {GST_SCENE_CHANGE_MODE_FAST,
+          "Thumbnail and histogram signature of the previous frame", "fast"},
+      {0, NULL, NULL},
+    };
+
+    scene_change_mode_type =
+        g_enum_register_static ("GstSceneChangeMode", scene_change_modes);
+  }
+  return scene_change_mode_type;
+}
+
 #define VIDEO_CAPS \
     GST_VIDEO_CAPS_MAKE("{ I420, Y42B, Y41B, Y444 }")
 
@@ -118,7 +191,11 @@ GST_ELEMENT_REGISTER_DEFINE (scenechange, "scenechange",
 static void
 gst_scene_change_class_init (GstSceneChangeClass * klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstBaseTransformClass *base_transform_class =
+      GST_BASE_TRANSFORM_CLASS (klass);
   GstVideoFilterClass *video_filter_class = GST_VIDEO_FILTER_CLASS (klass);
+  static const gchar *meta_tags[] = { GST_META_TAG_VIDEO_STR, NULL };
 
   gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
       gst_pad_template_new ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
@@ -132,14 +209,153 @@ gst_scene_change_class_init (GstSceneChangeClass * klass)
       "Video/Filter", "Detects scene changes in video",
       "David Schleef <ds@entropywave.com>");
 
+  gobject_class->set_property = gst_scene_change_set_property;
+  gobject_class->get_property = gst_scene_change_get_property;
+  gobject_class->finalize = gst_scene_change_finalize;
+  base_transform_class->stop = GST_DEBUG_FUNCPTR (gst_scene_change_stop);
   video_filter_class->transform_frame_ip =
       GST_DEBUG_FUNCPTR (gst_scene_change_transform_frame_ip);
 
+  /**
+   * GstSceneChange:mode:
+   *
+   * How the difference between consecutive frames is measured.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode",
+          "How the difference between consecutive frames is measured",
+          GST_TYPE_SCENE_CHANGE_MODE, DEFAULT_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSceneChange:downscale:
+   *
+   * Downscaling factor of the thumbnail used in fast mode.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_DOWNSCALE,
+      g_param_spec_int ("downscale", "Downscale",
+          "Downscaling factor of the thumbnail used in fast mode", 1, 64,
+          DEFAULT_DOWNSCALE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSceneChange:add-meta:
+   *
+   * Attach a "GstSceneChangeMeta" custom meta with the scene change score to
+   * the outgoing buffers.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_ADD_META,
+      g_param_spec_boolean ("add-meta", "Add meta",
+          "Attach the scene change score as GstSceneChangeMeta custom meta",
+          DEFAULT_ADD_META, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  if (!gst_meta_get_info (SCENE_CHANGE_META_NAME))
+    gst_meta_register_custom (SCENE_CHANGE_META_NAME, meta_tags, NULL, NULL,
+        NULL);
+
+  gst_type_mark_as_plugin_api (GST_TYPE_SCENE_CHANGE_MODE, 0);
 }
 
 static void
 gst_scene_change_init (GstSceneChange * scenechange)
 {
+  scenechange->mode = DEFAULT_MODE;
+  scenechange->downscale = DEFAULT_DOWNSCALE;
+  scenechange->add_meta = DEFAULT_ADD_META;
+}
+
+static void
+gst_scene_change_reset (GstSceneChange * scenechange)
+{
+  gst_buffer_replace (&scenechange->oldbuf, NULL);
+  g_free (scenechange->sig[0].thumb);
+  g_free (scenechange->sig[1].thumb);
+  memset (scenechange->sig, 0, sizeof (scenechange->sig));
+  scenechange->have_sig = FALSE;
+}
+
+void
+gst_scene_change_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstSceneChange *scenechange = GST_SCENE_CHANGE (object);
+
+  GST_DEBUG_OBJECT (scenechange, "set_property");
+
+  switch (property_id) {
+    case PROP_MODE:
+      GST_OBJECT_LOCK (scenechange);
+      scenechange->mode = g_value_get_enum (value);
+      GST_OBJECT_UNLOCK (scenechange);
+      break;
+    case PROP_DOWNSCALE:
+      GST_OBJECT_LOCK (scenechange);
+      scenechange->downscale = g_value_get_int (value);
+      GST_OBJECT_UNLOCK (scenechange);
+      break;
+    case PROP_ADD_META:
+      GST_OBJECT_LOCK (scenechange);
+      scenechange->add_meta = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (scenechange);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+void
+gst_scene_change_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSceneChange *scenechange = GST_SCENE_CHANGE (object);
+
+  GST_DEBUG_OBJECT (scenechange, "get_property");
+
+  switch (property_id) {
+    case PROP_MODE:
+      g_value_set_enum (value, scenechange->mode);
+      break;
+    case PROP_DOWNSCALE:
+      g_value_set_int (value, scenechange->downscale);
+      break;
+    case PROP_ADD_META:
+      g_value_set_boolean (value, scenechange->add_meta);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_scene_change_finalize (GObject * object)
+{
+  GstSceneChange *scenechange = GST_SCENE_CHANGE (object);
+
+  gst_scene_change_reset (scenechange);
+
+  G_OBJECT_CLASS (gst_scene_change_parent_class)->finalize (object);
+}
+
+static gboolean
+gst_scene_change_stop (GstBaseTransform * trans)
+{
+  GstSceneChange *scenechange = GST_SCENE_CHANGE (trans);
+
+  GST_DEBUG_OBJECT (scenechange, "stop");
+
+  gst_scene_change_reset (scenechange);
+
+  if (GST_BASE_TRANSFORM_CLASS (gst_scene_change_parent_class)->stop)
+    return
+        GST_BASE_TRANSFORM_CLASS (gst_scene_change_parent_class)->stop (trans);
+  return TRUE;
 }
 
 
@@ -158,39 +374,136 @@ get_frame_score (GstVideoFrame * f1, GstVideoFrame * f2)
   return ((double) score) / (width * height);
 }
 
+/* Each thumbnail sample is the average of downscale luma samples along the
+ * centre line of its cell, so only every downscale-th line is read. The
+ * histograms are then computed from the thumbnail. */
+static void
+compute_signature (GstSceneChangeSignature * sig, GstVideoFrame * frame,
+    int downscale)
+{
+  const guint8 *data = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
+  const int stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+  const int width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0);
+  const int height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0);
+  int tw, th, x, y, i;
+
+  downscale = MIN (downscale, MIN (width, height));
+  tw = width / downscale;
+  th = height / downscale;
+
+  if (sig->width != tw || sig->height != th) {
+    g_free (sig->thumb);
+    sig->thumb = g_malloc (tw * th);
+    sig->width = tw;
+    sig->height = th;
+  }
+
+  for (y = 0; y < th; y++) {
+    const guint8 *line = data + (y * downscale + downscale / 2) * stride;
+    guint8 *out = sig->thumb + y * tw;
+
+    for (x = 0; x < tw; x++) {
+      const guint8 *cell = line + x * downscale;
+      guint sum = 0;
+
+      for (i = 0; i < downscale; i++)
+        sum += cell[i];
+      out[x] = (sum + downscale / 2) / downscale;
+    }
+  }
+
+  memset (sig->hist, 0, sizeof (sig->hist));
+  for (y = 0; y < th; y++) {
+    const guint8 *line = sig->thumb + y * tw;
+    guint32 (*hist_row)[SC_HIST_BINS] =
+        &sig->hist[(y * SC_HIST_GRID / th) * SC_HIST_GRID];
+
+    for (x = 0; x < tw; x++)
+      hist_row[x * SC_HIST_GRID / tw][line[x] * SC_HIST_BINS / 256]++;
+  }
+}
+
+/* mean absolute difference of the thumbnails. Averaging removes the fine
+ * detail, so this is a lower bound of the full resolution score: about the
+ * same for cuts between different pictures, but only a third to a half of
+ * it for noise and motion */
+static double
+get_signature_score (GstSceneChangeSignature * s1,
+    GstSceneChangeSignature * s2)
+{
+  guint32 score = 0;
+
+  orc_sad_nxm_u8 (&score, s1->thumb, s1->width, s2->thumb, s2->width,
+      s1->width, s1->height);
+
+  return ((double) score) / (s1->width * s1->height);
+}
+
+/* sum of the absolute bin differences of all blocks, normalised to
+ * [0.0, 1.0] */
+static double
+get_histogram_distance (GstSceneChangeSignature * s1,
+    GstSceneChangeSignature * s2)
+{
+  guint64 dist = 0;
+  int i, j;
+
+  for (i = 0; i < SC_HIST_BLOCKS; i++) {
+    for (j = 0; j < SC_HIST_BINS; j++)
+      dist += ABS ((gint64) s1->hist[i][j] - (gint64) s2->hist[i][j]);
+  }
+
+  return ((double) dist) / (2.0 * s1->width * s1->height);
+}
+
+/* the score is negative if there is no previous frame to compare with */
+static void
+gst_scene_change_score_fast (GstSceneChange * scenechange,
+    GstVideoFrame * frame, int downscale, double *score, double *hist_dist)
+{
+  GstSceneChangeSignature *cur = &scenechange->sig[0];
+  GstSceneChangeSignature *prev = &scenechange->sig[1];
+  GstSceneChangeSignature tmp;
+
+  /* the previous signature moves to index 1 */
+  tmp = *prev;
+  *prev = *cur;
+  *cur = tmp;
+
+  compute_signature (cur, frame, downscale);
+
+  if (!scenechange->have_sig || cur->width != prev->width
+      || cur->height != prev->height) {
+    scenechange->have_sig = TRUE;
+    *score = -1.0;
+    return;
+  }
+
+  *score = get_signature_score (prev, cur);
+  *hist_dist = get_histogram_distance (prev, cur);
+}
+
+/* the score is negative if there is no previous frame to compare with */
 static GstFlowReturn
-gst_scene_change_transform_frame_ip (GstVideoFilter * filter,
-    GstVideoFrame * frame)
+gst_scene_change_score_full (GstSceneChange * scenechange,
+    GstVideoFrame * frame, double *score)
 {
-  GstSceneChange *scenechange = GST_SCENE_CHANGE (filter);
   GstVideoFrame oldframe;
-  double score_min;
-  double score_max;
-  double threshold;
-  double score;
-  gboolean change;
-  gboolean ret;
-  int i;
-
-  GST_DEBUG_OBJECT (scenechange, "transform_frame_ip");
 
   if (!scenechange->oldbuf) {
-    scenechange->n_diffs = 0;
-    memset (scenechange->diffs, 0, sizeof (double) * SC_N_DIFFS);
     scenechange->oldbuf = gst_buffer_ref (frame->buffer);
     memcpy (&scenechange->oldinfo, &frame->info, sizeof (GstVideoInfo));
+    *score = -1.0;
     return GST_FLOW_OK;
   }
 
-  ret =
-      gst_video_frame_map (&oldframe, &scenechange->oldinfo,
-      scenechange->oldbuf, GST_MAP_READ);
-  if (!ret) {
+  if (!gst_video_frame_map (&oldframe, &scenechange->oldinfo,
+          scenechange->oldbuf, GST_MAP_READ)) {
     GST_ERROR_OBJECT (scenechange, "failed to map old video frame");
     return GST_FLOW_ERROR;
   }
 
-  score = get_frame_score (&oldframe, frame);
+  *score = get_frame_score (&oldframe, frame);
 
   gst_video_frame_unmap (&oldframe);
 
@@ -198,6 +511,76 @@ gst_scene_change_transform_frame_ip (GstVideoFilter * filter,
   scenechange->oldbuf = gst_buffer_ref (frame->buffer);
   memcpy (&scenechange->oldinfo, &frame->info, sizeof (GstVideoInfo));
 
+  return GST_FLOW_OK;
+}
+
+static void
+gst_scene_change_add_meta (GstSceneChange * scenechange, GstBuffer * buffer,
+    double score, double threshold, double hist_dist, gboolean change)
+{
+  GstCustomMeta *meta;
+  GstStructure *s;
+
+  meta = gst_buffer_add_custom_meta (buffer, SCENE_CHANGE_META_NAME);
+  if (!meta) {
+    GST_WARNING_OBJECT (scenechange, "failed to add meta");
+    return;
+  }
+
+  s = gst_custom_meta_get_structure (meta);
+  gst_structure_set (s, "score", G_TYPE_DOUBLE, score,
+      "threshold", G_TYPE_DOUBLE, threshold,
+      "scene-change", G_TYPE_BOOLEAN, change, NULL);
+  if (hist_dist >= 0)
+    gst_structure_set (s, "histogram-distance", G_TYPE_DOUBLE, hist_dist, NULL);
+}
+
+static GstFlowReturn
+gst_scene_change_transform_frame_ip (GstVideoFilter * filter,
+    GstVideoFrame * frame)
+{
+  GstSceneChange *scenechange = GST_SCENE_CHANGE (filter);
+  GstSceneChangeMode mode;
+  int downscale;
+  gboolean add_meta;
+  const GstSceneChangeThresholds *thresholds;
+  double score_min;
+  double score_max;
+  double threshold;
+  double score = 0.0;
+  double hist_dist = -1.0;
+  gboolean change;
+  GstFlowReturn ret = GST_FLOW_OK;
+  int i;
+
+  GST_DEBUG_OBJECT (scenechange, "transform_frame_ip");
+
+  GST_OBJECT_LOCK (scenechange);
+  mode = scenechange->mode;
+  downscale = scenechange->downscale;
+  add_meta = scenechange->add_meta;
+  GST_OBJECT_UNLOCK (scenechange);
+
+  /* only keep the state the current mode needs */
+  if (mode == GST_SCENE_CHANGE_MODE_FAST) {
+    gst_buffer_replace (&scenechange->oldbuf, NULL);
+    thresholds = &fast_thresholds;
+    gst_scene_change_score_fast (scenechange, frame, downscale, &score,
+        &hist_dist);
+  } else {
+    thresholds = &full_thresholds;
+    scenechange->have_sig = FALSE;
+    ret = gst_scene_change_score_full (scenechange, frame, &score);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  }
+
+  if (score < 0) {
+    scenechange->n_diffs = 0;
+    memset (scenechange->diffs, 0, sizeof (double) * SC_N_DIFFS);
+    return GST_FLOW_OK;
+  }
+
   memmove (scenechange->diffs, scenechange->diffs + 1,
       sizeof (double) * (SC_N_DIFFS - 1));
   scenechange->diffs[SC_N_DIFFS - 1] = score;
@@ -213,16 +596,18 @@ gst_scene_change_transform_frame_ip (GstVideoFilter * filter,
   threshold = 1.8 * score_max - 0.8 * score_min;
 
   if (scenechange->n_diffs > (SC_N_DIFFS - 1)) {
-    if (score < 5) {
+    if (score < thresholds->min_score) {
       change = FALSE;
     } else if (score / threshold < 1.0) {
       change = FALSE;
-    } else if ((score > 30)
+    } else if ((score > thresholds->jump_score)
         && (score / scenechange->diffs[SC_N_DIFFS - 2] > 1.4)) {
       change = TRUE;
     } else if (score / threshold > 2.3) {
       change = TRUE;
-    } else if (score > 50) {
+    } else if (score > thresholds->max_score) {
+      change = TRUE;
+    } else if (hist_dist > FAST_HIST_DIST_CUT) {
       change = TRUE;
     } else {
       change = FALSE;
@@ -256,6 +641,10 @@ gst_scene_change_transform_frame_ip (GstVideoFilter * filter,
     gst_pad_push_event (GST_BASE_TRANSFORM_SRC_PAD (scenechange), event);
   }
 
+  if (add_meta)
+    gst_scene_change_add_meta (scenechange, frame->buffer, score, threshold,
+        hist_dist, change);
+
   return GST_FLOW_OK;
 }
 
@@ -36,15 +36,45 @@ typedef struct _GstSceneChangeClass GstSceneChangeClass;
 
 #define SC_N_DIFFS 5
 
+/* the histograms are computed over a SC_HIST_GRID x SC_HIST_GRID grid of
+ * blocks of the thumbnail */
+#define SC_HIST_GRID 4
+#define SC_HIST_BLOCKS (SC_HIST_GRID * SC_HIST_GRID)
+#define SC_HIST_BINS 16
+
+typedef enum
+{
+  GST_SCENE_CHANGE_MODE_FULL,
+  GST_SCENE_CHANGE_MODE_FAST
+} GstSceneChangeMode;
+
+typedef struct
+{
+  guint8 *thumb;
+  int width;
+  int height;
+  guint32 hist[SC_HIST_BLOCKS][SC_HIST_BINS];
+} GstSceneChangeSignature;
+
 struct _GstSceneChange
 {
   GstVideoFilter base_scenechange;
 
+  /* properties */
+  GstSceneChangeMode mode;
+  int downscale;
+  gboolean add_meta;
+
+  /* state */
   int n_diffs;
   double diffs[SC_N_DIFFS];
   GstBuffer *oldbuf;
   GstVideoInfo oldinfo;
   int count;
+
+  /* fast mode: signatures of the current and the previous frame */
+  GstSceneChangeSignature sig[2];
+  gboolean have_sig;
 };
 
 struct _GstSceneChangeClass
@@ -53,6 +83,7 @@ struct _GstSceneChangeClass
 };
 
 GType gst_scene_change_get_type (void);
+GType gst_scene_change_mode_get_type (void);
 GST_ELEMENT_REGISTER_DECLARE (scenechange);
 
 G_END_DECLS
@@ -32,6 +32,11 @@
 #  define ssize_t int
 #  include <winsock2.h>
 #endif
+#ifdef HAVE_IPC_PIPELINE_SHM
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
 #include <errno.h>
 #include <string.h>
 #include <gst/base/gstbytewriter.h>
@@ -43,6 +48,16 @@ GST_DEBUG_CATEGORY_STATIC (gst_ipc_pipeline_comm_debug);
 
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
 
+/* shared memory segment layout: a ShmHeader, one state per slot, and the
+ * data area, starting at a page boundary */
+#define SHM_MAGIC 0x53504947    /* "GIPS" */
+#define SHM_N_SLOTS 64
+#define SHM_ALIGN 64
+/* longest wait for free space before falling back to the socket, in us */
+#define SHM_MAX_WAIT (20 * G_TIME_SPAN_MILLISECOND)
+#define SHM_DATA_OFFSET(n_slots) \
+    GST_ROUND_UP_N (sizeof (ShmHeader) + (n_slots) * sizeof (gint), 4096)
+
 GQuark QUARK_ID;
 
 typedef enum
@@ -193,6 +208,10 @@ gst_ipc_pipeline_comm_data_type_get_name (GstIpcPipelineCommDataType type)
       return "MESSAGE";
     case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
       return "GERROR_MESSAGE";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_SEGMENT:
+      return "SHM_SEGMENT";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER:
+      return "SHM_BUFFER";
     default:
       return "UNKNOWN";
   }
@@ -278,6 +297,434 @@ write_byte_writer_to_fd (GstIpcPipelineComm * comm, GstByteWriter * bw)
   return ret;
 }
 
+/* Shared memory data plane.
+ *
+ * When enabled on the sending side, buffer payloads are copied into a
+ * shared memory segment offered to the peer once, instead of being written
+ * to the socket. Buffers get variable sized regions of the segment, placed
+ * in the first gap large enough between the regions in use. Each region has
+ * a slot whose state lives in the segment itself: the receiver wraps the
+ * region in a GstMemory and clears the slot once that memory is freed, and
+ * the sender reclaims the regions of the cleared slots, in any order. No
+ * message is needed to release a region. When the receiving pipeline holds
+ * on to too much data, the sender waits shortly for free space and then
+ * writes buffers to the socket until a region is released. */
+
+typedef struct
+{
+  guint32 magic;
+  guint32 n_slots;
+  guint64 data_size;
+  gint slot_state[];
+} ShmHeader;
+
+typedef struct
+{
+  gsize offset;
+  gsize size;
+  gboolean in_use;
+} ShmSlot;
+
+struct _GstIpcPipelineShm
+{
+  gint refcount;
+  guint8 *base;
+  gsize size;
+  ShmHeader *header;
+  guint8 *data;
+  gsize data_size;
+  guint n_slots;
+
+  /* sending side: the region of each slot, and the slots in use sorted by
+   * offset. starved is set after a wait for free space timed out */
+  ShmSlot *slots;
+  guint *used;
+  guint n_used;
+  gboolean starved;
+};
+
+#ifdef HAVE_IPC_PIPELINE_SHM
+static GstIpcPipelineShm *
+gst_ipc_pipeline_shm_ref (GstIpcPipelineShm * shm)
+{
+  g_atomic_int_inc (&shm->refcount);
+  return shm;
+}
+
+static void
+gst_ipc_pipeline_shm_unref (GstIpcPipelineShm * shm)
+{
+  if (!g_atomic_int_dec_and_test (&shm->refcount))
+    return;
+
+  munmap (shm->base, shm->size);
+  g_free (shm->slots);
+  g_free (shm->used);
+  g_free (shm);
+}
+
+static GstIpcPipelineShm *
+gst_ipc_pipeline_shm_map (int fd, gsize size)
+{
+  GstIpcPipelineShm *shm;
+  void *base;
+
+  base = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+    return NULL;
+
+  shm = g_new0 (GstIpcPipelineShm, 1);
+  shm->refcount = 1;
+  shm->base = base;
+  shm->size = size;
+  shm->header = base;
+
+  return shm;
+}
+
+static void
+gst_ipc_pipeline_shm_set_layout (GstIpcPipelineShm * shm, guint n_slots)
+{
+  shm->n_slots = n_slots;
+  shm->data = shm->base + SHM_DATA_OFFSET (n_slots);
+  shm->data_size = shm->size - SHM_DATA_OFFSET (n_slots);
+}
+
+/* Creates a segment with room for data_size bytes of payloads. The segment
+ * name is returned in name, and should be unlinked once the peer opened it */
+static GstIpcPipelineShm *
+gst_ipc_pipeline_shm_create (GstIpcPipelineComm * comm, gsize data_size,
+    gchar ** name)
+{
+  static gint counter = 0;
+  GstIpcPipelineShm *shm;
+  gsize size;
+  int fd;
+
+  size = SHM_DATA_OFFSET (SHM_N_SLOTS) + data_size;
+  *name = g_strdup_printf ("/gst-ipcpipeline-%d-%d", (int) getpid (),
+      g_atomic_int_add (&counter, 1));
+
+  fd = shm_open (*name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  if (fd < 0)
+    goto open_failed;
+  if (ftruncate (fd, size) < 0) {
+    close (fd);
+    shm_unlink (*name);
+    goto open_failed;
+  }
+
+  shm = gst_ipc_pipeline_shm_map (fd, size);
+  close (fd);
+  if (!shm) {
+    shm_unlink (*name);
+    goto open_failed;
+  }
+
+  gst_ipc_pipeline_shm_set_layout (shm, SHM_N_SLOTS);
+  shm->header->magic = SHM_MAGIC;
+  shm->header->n_slots = SHM_N_SLOTS;
+  shm->header->data_size = shm->data_size;
+  shm->slots = g_new0 (ShmSlot, SHM_N_SLOTS);
+  shm->used = g_new (guint, SHM_N_SLOTS);
+
+  GST_DEBUG_OBJECT (comm->element, "Created shared memory segment %s of %"
+      G_GSIZE_FORMAT " bytes", *name, size);
+
+  return shm;
+
+open_failed:
+  GST_WARNING_OBJECT (comm->element, "Failed to create shared memory "
+      "segment %s: %s", *name, strerror (errno));
+  g_free (*name);
+  *name = NULL;
+  return NULL;
+}
+
+static GstIpcPipelineShm *
+gst_ipc_pipeline_shm_open (GstIpcPipelineComm * comm, const gchar * name,
+    guint32 n_slots, guint64 data_size)
+{
+  GstIpcPipelineShm *shm;
+  gsize size;
+  int fd;
+
+  if (n_slots == 0 || n_slots > G_MAXUINT16 || data_size > G_MAXSIZE / 2)
+    return NULL;
+
+  size = SHM_DATA_OFFSET (n_slots) + data_size;
+  fd = shm_open (name, O_RDWR, 0);
+  if (fd < 0) {
+    GST_WARNING_OBJECT (comm->element, "Failed to open shared memory "
+        "segment %s: %s", name, strerror (errno));
+    return NULL;
+  }
+
+  shm = gst_ipc_pipeline_shm_map (fd, size);
+  close (fd);
+  if (!shm)
+    return NULL;
+
+  if (shm->header->magic != SHM_MAGIC || shm->header->n_slots != n_slots ||
+      shm->header->data_size != data_size) {
+    GST_WARNING_OBJECT (comm->element, "Invalid shared memory segment %s",
+        name);
+    gst_ipc_pipeline_shm_unref (shm);
+    return NULL;
+  }
+  gst_ipc_pipeline_shm_set_layout (shm, n_slots);
+
+  GST_DEBUG_OBJECT (comm->element, "Opened shared memory segment %s", name);
+
+  return shm;
+}
+
+/* Reclaims the regions of the slots released by the receiver, whatever
+ * the order they were allocated in */
+static void
+gst_ipc_pipeline_shm_reclaim (GstIpcPipelineShm * shm)
+{
+  guint i, n = 0;
+
+  for (i = 0; i < shm->n_used; i++) {
+    guint slot = shm->used[i];
+
+    if (g_atomic_int_get (&shm->header->slot_state[slot]))
+      shm->used[n++] = slot;
+    else
+      shm->slots[slot].in_use = FALSE;
+  }
+  shm->n_used = n;
+}
+
+/* Returns the slot of a free region of size bytes, or -1 if there is
+ * currently no free slot or no gap large enough */
+static gint
+gst_ipc_pipeline_shm_alloc (GstIpcPipelineShm * shm, gsize size)
+{
+  gsize offset = 0;
+  guint i, slot;
+
+  gst_ipc_pipeline_shm_reclaim (shm);
+
+  if (shm->n_used == shm->n_slots)
+    return -1;
+
+  /* first fit, regions start on SHM_ALIGN boundaries */
+  for (i = 0; i < shm->n_used; i++) {
+    ShmSlot *used = &shm->slots[shm->used[i]];
+
+    if (used->offset - offset >= size)
+      break;
+    offset = GST_ROUND_UP_N (used->offset + used->size, SHM_ALIGN);
+  }
+  if (i == shm->n_used && (offset > shm->data_size ||
+          shm->data_size - offset < size))
+    return -1;
+
+  for (slot = 0; shm->slots[slot].in_use; slot++);
+
+  memmove (&shm->used[i + 1], &shm->used[i],
+      (shm->n_used - i) * sizeof (guint));
+  shm->used[i] = slot;
+  shm->n_used++;
+
+  shm->slots[slot].offset = offset;
+  shm->slots[slot].size = size;
+  shm->slots[slot].in_use = TRUE;
+  g_atomic_int_set (&shm->header->slot_state[slot], 1);
+
+  return slot;
+}
+
+typedef struct
+{
+  GstIpcPipelineShm *shm;
+  guint slot;
+} ShmRegion;
+
+static void
+shm_region_free (ShmRegion * region)
+{
+  g_atomic_int_set (&region->shm->header->slot_state[region->slot], 0);
+  gst_ipc_pipeline_shm_unref (region->shm);
+  g_free (region);
+}
+
+static GstMemory *
+gst_ipc_pipeline_shm_wrap (GstIpcPipelineShm * shm, guint slot,
+    guint64 offset, gsize size)
+{
+  ShmRegion *region;
+
+  region = g_new (ShmRegion, 1);
+  region->shm = gst_ipc_pipeline_shm_ref (shm);
+  region->slot = slot;
+
+  return gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, shm->data + offset,
+      size, 0, size, region, (GDestroyNotify) shm_region_free);
+}
+#endif
+
+static void
+gst_ipc_pipeline_comm_clear_shm (GstIpcPipelineComm * comm)
+{
+#ifdef HAVE_IPC_PIPELINE_SHM
+  if (comm->shm)
+    gst_ipc_pipeline_shm_unref (comm->shm);
+#endif
+  comm->shm = NULL;
+  comm->shm_fdout = -1;
+}
+
+/* Forgets the shared memory segment, so that a new one is offered to the
+ * next peer */
+void
+gst_ipc_pipeline_comm_reset_shm (GstIpcPipelineComm * comm)
+{
+  g_mutex_lock (&comm->mutex);
+  gst_ipc_pipeline_comm_clear_shm (comm);
+  g_mutex_unlock (&comm->mutex);
+}
+
+/* Offers a new shared memory segment to the peer, unless this was already
+ * done on the current fdout. Called with the lock taken, returns TRUE if
+ * the shared memory segment can be used */
+static gboolean
+gst_ipc_pipeline_comm_ensure_shm (GstIpcPipelineComm * comm)
+{
+#ifdef HAVE_IPC_PIPELINE_SHM
+  const unsigned char payload_type =
+      GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_SEGMENT;
+  GstIpcPipelineShm *shm;
+  GstByteWriter bw;
+  gchar *name = NULL;
+  guint32 ret32 = FALSE, size;
+
+  if (comm->shm_fdout == comm->fdout)
+    return comm->shm != NULL;
+
+  gst_ipc_pipeline_comm_clear_shm (comm);
+  comm->shm_fdout = comm->fdout;
+
+  shm = gst_ipc_pipeline_shm_create (comm, comm->shm_size, &name);
+  if (!shm)
+    return FALSE;
+
+  ++comm->send_id;
+  GST_DEBUG_OBJECT (comm->element, "Offering shared memory segment %s: %u",
+      name, comm->send_id);
+
+  gst_byte_writer_init (&bw);
+  size = sizeof (guint32) + sizeof (guint64) + strlen (name) + 1;
+  if (!gst_byte_writer_put_uint8 (&bw, payload_type) ||
+      !gst_byte_writer_put_uint32_le (&bw, comm->send_id) ||
+      !gst_byte_writer_put_uint32_le (&bw, size) ||
+      !gst_byte_writer_put_uint32_le (&bw, shm->n_slots) ||
+      !gst_byte_writer_put_uint64_le (&bw, shm->data_size) ||
+      !gst_byte_writer_put_data (&bw, (const guint8 *) name,
+          strlen (name) + 1) || !write_byte_writer_to_fd (comm, &bw)) {
+    gst_byte_writer_reset (&bw);
+    goto failed;
+  }
+
+  if (!gst_ipc_pipeline_comm_sync_fd (comm, comm->send_id, NULL, &ret32,
+          ACK_TYPE_TIMED, COMM_REQUEST_TYPE_EVENT) || !ret32)
+    goto failed;
+
+  /* the peer has it mapped now */
+  shm_unlink (name);
+  g_free (name);
+  comm->shm = shm;
+
+  return TRUE;
+
+failed:
+  GST_WARNING_OBJECT (comm->element, "Peer did not accept shared memory "
+      "segment %s, writing buffers to the socket", name);
+  shm_unlink (name);
+  g_free (name);
+  gst_ipc_pipeline_shm_unref (shm);
+  return FALSE;
+#else
+  return FALSE;
+#endif
+}
+
+/* Releases a region the peer will never know about */
+static void
+gst_ipc_pipeline_comm_release_shm_slot (GstIpcPipelineComm * comm, gint slot)
+{
+#ifdef HAVE_IPC_PIPELINE_SHM
+  if (comm->shm)
+    g_atomic_int_set (&comm->shm->header->slot_state[slot], 0);
+#endif
+}
+
+/* Copies the buffer data into a region of the shared memory segment, and
+ * returns its slot, or -1 if the data has to be written to the socket.
+ * Called with the lock taken, which is released while waiting for space */
+static gint
+gst_ipc_pipeline_comm_write_buffer_to_shm (GstIpcPipelineComm * comm,
+    GstBuffer * buffer, guint64 * offset)
+{
+#ifdef HAVE_IPC_PIPELINE_SHM
+  GstIpcPipelineShm *shm;
+  gsize size = gst_buffer_get_size (buffer);
+  gint64 end_time;
+  gulong wait = 50;
+  gint slot;
+
+  if (comm->shm_size == 0 || size == 0)
+    return -1;
+  if (!gst_ipc_pipeline_comm_ensure_shm (comm) || size > comm->shm->data_size)
+    return -1;
+
+  slot = gst_ipc_pipeline_shm_alloc (comm->shm, size);
+  if (slot < 0 && !comm->shm->starved) {
+    end_time = g_get_monotonic_time () + MIN (comm->ack_time / GST_USECOND,
+        SHM_MAX_WAIT);
+    while ((slot = gst_ipc_pipeline_shm_alloc (comm->shm, size)) < 0) {
+      /* the receiving pipeline holds the segment: wait a bit for it to
+       * release some, letting events and queries through meanwhile */
+      if (g_get_monotonic_time () >= end_time) {
+        GST_WARNING_OBJECT (comm->element, "Shared memory full, writing "
+            "buffers to the socket until some is released");
+        comm->shm->starved = TRUE;
+        return -1;
+      }
+      GST_LOG_OBJECT (comm->element, "Shared memory full, waiting");
+      shm = gst_ipc_pipeline_shm_ref (comm->shm);
+      g_mutex_unlock (&comm->mutex);
+      g_usleep (wait);
+      wait = MIN (wait * 2, 1000);
+      g_mutex_lock (&comm->mutex);
+      gst_ipc_pipeline_shm_unref (shm);
+      /* reconnected or cleared meanwhile */
+      if (comm->shm != shm)
+        return -1;
+    }
+  }
+  if (slot < 0) {
+    /* don't wait again before the receiver released something */
+    GST_LOG_OBJECT (comm->element, "Shared memory still full");
+    return -1;
+  }
+
+  shm = comm->shm;
+  shm->starved = FALSE;
+  *offset = shm->slots[slot].offset;
+  gst_buffer_extract (buffer, 0, shm->data + *offset, size);
+
+  GST_TRACE_OBJECT (comm->element, "Buffer data in slot %d at offset %"
+      G_GUINT64_FORMAT ", %u slots in use", slot, *offset, shm->n_used);
+
+  return slot;
+#else
+  return -1;
+#endif
+}
+
 static void
 gst_ipc_pipeline_comm_write_ack_to_fd (GstIpcPipelineComm * comm, guint32 id,
     guint32 ret, CommRequestType type)
@@ -523,7 +970,7 @@ GstFlowReturn
 gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
     GstBuffer * buffer)
 {
-  const unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
+  unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
   GstMapInfo map;
   guint32 ret32 = GST_FLOW_OK;
   guint32 size, n;
@@ -531,12 +978,20 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   GstFlowReturn ret;
   MetaListRepresentation repr = { comm, 0, 4, NULL };   /* starts a 4 for n_meta */
   GstByteWriter bw;
+  guint64 shm_offset = 0;
+  gint shm_slot;
 
   g_mutex_lock (&comm->mutex);
+
+  shm_slot = gst_ipc_pipeline_comm_write_buffer_to_shm (comm, buffer,
+      &shm_offset);
+  if (shm_slot >= 0)
+    payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER;
+
   ++comm->send_id;
 
-  GST_TRACE_OBJECT (comm->element, "Writing buffer %u: %" GST_PTR_FORMAT,
-      comm->send_id, buffer);
+  GST_TRACE_OBJECT (comm->element, "Writing buffer %u%s: %" GST_PTR_FORMAT,
+      comm->send_id, shm_slot >= 0 ? " (shared memory)" : "", buffer);
 
   gst_byte_writer_init (&bw);
 
@@ -554,9 +1009,11 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
     goto write_failed;
   if (!gst_byte_writer_put_uint32_le (&bw, comm->send_id))
     goto write_failed;
-  size =
-      gst_buffer_get_size (buffer) + sizeof (guint32) +
-      sizeof (CommBufferMetadata) + repr.total_bytes;
+  if (shm_slot >= 0)
+    size = sizeof (guint32) + sizeof (guint64);
+  else
+    size = gst_buffer_get_size (buffer);
+  size += sizeof (guint32) + sizeof (CommBufferMetadata) + repr.total_bytes;
   if (!gst_byte_writer_put_uint32_le (&bw, size))
     goto write_failed;
   if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta, sizeof (meta)))
@@ -564,18 +1021,28 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   size = gst_buffer_get_size (buffer);
   if (!gst_byte_writer_put_uint32_le (&bw, size))
     goto write_failed;
-  if (!write_byte_writer_to_fd (comm, &bw))
-    goto write_failed;
 
-  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
-    goto map_failed;
-  ret = write_to_fd_raw (comm, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
-  if (!ret)
-    goto write_failed;
+  if (shm_slot >= 0) {
+    /* the data is already in shared memory, only send where it is */
+    if (!gst_byte_writer_put_uint32_le (&bw, shm_slot))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint64_le (&bw, shm_offset))
+      goto write_failed;
+  } else {
+    if (!write_byte_writer_to_fd (comm, &bw))
+      goto write_failed;
+
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+      goto map_failed;
+    ret = write_to_fd_raw (comm, map.data, map.size);
+    gst_buffer_unmap (buffer, &map);
+    if (!ret)
+      goto write_failed;
+
+    gst_byte_writer_init (&bw);
+  }
 
   /* meta */
-  gst_byte_writer_init (&bw);
   if (!gst_byte_writer_put_uint32_le (&bw, repr.n_meta))
     goto write_failed;
   for (n = 0; n < repr.n_meta; ++n) {
@@ -627,6 +1094,8 @@ done:
 write_failed:
   GST_ELEMENT_ERROR (comm->element, RESOURCE, WRITE, (NULL),
       ("Failed to write to socket"));
+  if (shm_slot >= 0)
+    gst_ipc_pipeline_comm_release_shm_slot (comm, shm_slot);
   ret = GST_FLOW_COMM_ERROR;
   goto done;
 
@@ -643,8 +1112,92 @@ map_failed:
   goto done;
 }
 
+/* Maps the shared memory segment offered by the peer, and replaces the
+ * previous one, which stays mapped until all its buffers are freed */
+static gboolean
+gst_ipc_pipeline_comm_read_shm_segment (GstIpcPipelineComm * comm,
+    guint32 size)
+{
+#ifdef HAVE_IPC_PIPELINE_SHM
+  GstIpcPipelineShm *shm = NULL;
+  const guint8 *payload;
+  guint32 n_slots;
+  guint64 data_size;
+  const gchar *name;
+
+  g_return_val_if_fail (gst_adapter_available (comm->adapter) >= size, FALSE);
+
+  if (size <= sizeof (n_slots) + sizeof (data_size))
+    goto done;
+
+  payload = gst_adapter_map (comm->adapter, size);
+  if (!payload)
+    return FALSE;
+  memcpy (&n_slots, payload, sizeof (n_slots));
+  memcpy (&data_size, payload + sizeof (n_slots), sizeof (data_size));
+  name = (const gchar *) payload + sizeof (n_slots) + sizeof (data_size);
+  if (name[size - sizeof (n_slots) - sizeof (data_size) - 1] == 0)
+    shm = gst_ipc_pipeline_shm_open (comm, name, n_slots, data_size);
+  gst_adapter_unmap (comm->adapter);
+
+done:
+  gst_adapter_flush (comm->adapter, size);
+  if (!shm)
+    return FALSE;
+
+  gst_ipc_pipeline_comm_clear_shm (comm);
+  comm->shm = shm;
+
+  return TRUE;
+#else
+  gst_adapter_flush (comm->adapter, size);
+  return FALSE;
+#endif
+}
+
+/* Wraps the shared memory region the buffer data was written to */
+static GstBuffer *
+gst_ipc_pipeline_comm_read_shm_buffer (GstIpcPipelineComm * comm,
+    guint32 buffer_data_size)
+{
+#ifdef HAVE_IPC_PIPELINE_SHM
+  const guint8 *payload;
+  GstBuffer *buffer;
+  guint32 slot;
+  guint64 offset;
+
+  payload = gst_adapter_map (comm->adapter, sizeof (slot) + sizeof (offset));
+  if (!payload)
+    return NULL;
+  memcpy (&slot, payload, sizeof (slot));
+  memcpy (&offset, payload + sizeof (slot), sizeof (offset));
+  gst_adapter_unmap (comm->adapter);
+  gst_adapter_flush (comm->adapter, sizeof (slot) + sizeof (offset));
+
+  if (!comm->shm || slot >= comm->shm->n_slots
+      || offset > comm->shm->data_size
+      || buffer_data_size > comm->shm->data_size - offset) {
+    GST_ERROR_OBJECT (comm->element, "Invalid shared memory buffer: slot %u, "
+        "offset %" G_GUINT64_FORMAT ", size %u", slot, offset,
+        buffer_data_size);
+    return NULL;
+  }
+
+  buffer = gst_buffer_new ();
+  gst_buffer_append_memory (buffer,
+      gst_ipc_pipeline_shm_wrap (comm->shm, slot, offset, buffer_data_size));
+
+  return buffer;
+#else
+  GST_ERROR_OBJECT (comm->element, "Got a shared memory buffer, but shared "
+      "memory is not supported");
+  return NULL;
+#endif
+}
+
 static GstBuffer *
-gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
+gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size,
+    gboolean shm)
 {
   GstBuffer *buffer;
   CommBufferMetadata meta;
@@ -667,13 +1220,20 @@ gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
   gst_adapter_unmap (comm->adapter);
   gst_adapter_flush (comm->adapter, mapped_size);
 
-  if (buffer_data_size == 0) {
-    buffer = gst_buffer_new ();
+  if (shm) {
+    buffer = gst_ipc_pipeline_comm_read_shm_buffer (comm, buffer_data_size);
+    if (!buffer)
+      return NULL;
+    size -= sizeof (guint32) + sizeof (guint64);
   } else {
-    buffer = gst_adapter_get_buffer (comm->adapter, buffer_data_size);
-    gst_adapter_flush (comm->adapter, buffer_data_size);
+    if (buffer_data_size == 0) {
+      buffer = gst_buffer_new ();
+    } else {
+      buffer = gst_adapter_get_buffer (comm->adapter, buffer_data_size);
+      gst_adapter_flush (comm->adapter, buffer_data_size);
+    }
+    size -= buffer_data_size;
   }
-  size -= buffer_data_size;
 
   GST_BUFFER_PTS (buffer) = meta.pts;
   GST_BUFFER_DTS (buffer) = meta.dts;
@@ -1624,6 +2184,7 @@ gst_ipc_pipeline_comm_init (GstIpcPipelineComm * comm, GstElement * element)
   comm->element = element;
   comm->fdin = comm->fdout = -1;
   comm->ack_time = DEFAULT_ACK_TIME;
+  comm->shm_fdout = -1;
   comm->waiting_ids =
       g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
       (GDestroyNotify) comm_request_free);
@@ -1636,6 +2197,7 @@ void
 gst_ipc_pipeline_comm_clear (GstIpcPipelineComm * comm)
 {
   g_hash_table_destroy (comm->waiting_ids);
+  gst_ipc_pipeline_comm_clear_shm (comm);
   gst_object_unref (comm->adapter);
   gst_poll_free (comm->poll);
   g_mutex_clear (&comm->mutex);
@@ -1845,6 +2407,8 @@ read_many (GstIpcPipelineComm * comm)
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_SEGMENT:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER:
             GST_TRACE_OBJECT (comm->element, "switching to state %s",
                 gst_ipc_pipeline_comm_data_type_get_name (type));
             comm->state = type;
@@ -1909,6 +2473,7 @@ read_many (GstIpcPipelineComm * comm)
         break;
       }
       case GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER:
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER:
       {
         GstBuffer *buf;
 
@@ -1916,7 +2481,8 @@ read_many (GstIpcPipelineComm * comm)
         if (available < comm->payload_length)
           goto done;
 
-        buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length);
+        buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length,
+            comm->state == GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER);
         if (!buf)
           goto buffer_failed;
 
@@ -2106,6 +2672,24 @@ read_many (GstIpcPipelineComm * comm)
         if (comm->on_message)
           (*comm->on_message) (comm->id, message, comm->user_data);
 
+        GST_TRACE_OBJECT (comm->element, "switching to state TYPE");
+        comm->state = GST_IPC_PIPELINE_COMM_STATE_TYPE;
+        break;
+      }
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_SEGMENT:
+      {
+        gboolean mapped;
+
+        available = gst_adapter_available (comm->adapter);
+        if (available < comm->payload_length)
+          goto done;
+
+        mapped = gst_ipc_pipeline_comm_read_shm_segment (comm,
+            comm->payload_length);
+        GST_DEBUG_OBJECT (comm->element, "%s shared memory segment %u",
+            mapped ? "Accepting" : "Rejecting", comm->id);
+        gst_ipc_pipeline_comm_write_boolean_ack_to_fd (comm, comm->id, mapped);
+
         GST_TRACE_OBJECT (comm->element, "switching to state TYPE");
         comm->state = GST_IPC_PIPELINE_COMM_STATE_TYPE;
         break;
@@ -51,8 +51,12 @@ typedef enum {
   GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE,
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_SEGMENT,
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER,
 } GstIpcPipelineCommDataType;
 
+typedef struct _GstIpcPipelineShm GstIpcPipelineShm;
+
 typedef struct
 {
   GstElement *element;
@@ -76,6 +80,13 @@ typedef struct
   guint read_chunk_size;
   GstClockTime ack_time;
 
+  /* shared memory data plane: size of the segment to offer to the peer
+   * (0 to disable), and the segment currently in use, as the sender or as
+   * the receiver */
+  guint shm_size;
+  GstIpcPipelineShm *shm;
+  int shm_fdout;
+
   void (*on_buffer) (guint32, GstBuffer *, gpointer);
   void (*on_event) (guint32, GstEvent *, gboolean, gpointer);
   void (*on_query) (guint32, GstQuery *, gboolean, gpointer);
@@ -92,6 +103,7 @@ void gst_ipc_pipeline_comm_init (GstIpcPipelineComm *comm, GstElement *e);
 void gst_ipc_pipeline_comm_clear (GstIpcPipelineComm *comm);
 void gst_ipc_pipeline_comm_cancel (GstIpcPipelineComm * comm,
     gboolean flushing);
+void gst_ipc_pipeline_comm_reset_shm (GstIpcPipelineComm * comm);
 
 void gst_ipc_pipeline_comm_write_flow_ack_to_fd (GstIpcPipelineComm * comm,
     guint32 id, GstFlowReturn ret);
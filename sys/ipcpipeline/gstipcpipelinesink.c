@@ -65,8 +65,10 @@
  * serialization may occur (ex error/warning/info messages that contain a
  * GError are serialized differently).
  *
- * Buffers are transported by writing their content directly on the socket.
- * More efficient ways for memory sharing could be implemented in the future.
+ * Buffers are transported by writing their content directly on the socket,
+ * or, if #GstIpcPipelineSink:shm-size is set, by copying their content into
+ * a shared memory segment that the peer maps. Only the position of the data
+ * in the segment is then written on the socket.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -99,11 +101,13 @@ enum
   PROP_FDOUT,
   PROP_READ_CHUNK_SIZE,
   PROP_ACK_TIME,
+  PROP_SHM_SIZE,
 };
 
 
 #define DEFAULT_READ_CHUNK_SIZE 4096
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
+#define DEFAULT_SHM_SIZE 0
 
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT (gst_ipc_pipeline_sink_debug, "ipcpipelinesink", 0, "ipcpipelinesink element");
@@ -179,6 +183,23 @@ gst_ipc_pipeline_sink_class_init (GstIpcPipelineSinkClass * klass)
           0, G_MAXUINT64, DEFAULT_ACK_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstIpcPipelineSink:shm-size:
+   *
+   * Size in bytes of a shared memory segment to copy buffer data into,
+   * instead of writing it to the socket. Only small control packets then go
+   * through the socket. The peer must run on the same host. Buffers that do
+   * not fit in the segment are written to the socket. 0 disables shared
+   * memory.
+   *
+   * Since: 1.22
+   */
+  g_object_class_install_property (gobject_class, PROP_SHM_SIZE,
+      g_param_spec_uint ("shm-size", "Shared memory size",
+          "Size of the shared memory segment for buffer data (0 = disabled)",
+          0, G_MAXINT, DEFAULT_SHM_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_ipc_pipeline_sink_signals[SIGNAL_DISCONNECT] =
       g_signal_new ("disconnect",
       G_TYPE_FROM_CLASS (klass),
@@ -214,6 +235,7 @@ gst_ipc_pipeline_sink_init (GstIpcPipelineSink * sink)
   gst_ipc_pipeline_comm_init (&sink->comm, GST_ELEMENT (sink));
   sink->comm.read_chunk_size = DEFAULT_READ_CHUNK_SIZE;
   sink->comm.ack_time = DEFAULT_ACK_TIME;
+  sink->comm.shm_size = DEFAULT_SHM_SIZE;
   sink->comm.fdin = -1;
   sink->comm.fdout = -1;
   sink->threads = g_thread_pool_new (pusher, sink, -1, FALSE, NULL);
@@ -268,6 +290,7 @@ gst_ipc_pipeline_sink_set_property (GObject * object, guint prop_id,
       break;
     case PROP_FDOUT:
       sink->comm.fdout = g_value_get_int (value);
+      gst_ipc_pipeline_comm_reset_shm (&sink->comm);
       break;
     case PROP_READ_CHUNK_SIZE:
       sink->comm.read_chunk_size = g_value_get_uint (value);
@@ -275,6 +298,10 @@ gst_ipc_pipeline_sink_set_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       sink->comm.ack_time = g_value_get_uint64 (value);
       break;
+    case PROP_SHM_SIZE:
+      sink->comm.shm_size = g_value_get_uint (value);
+      gst_ipc_pipeline_comm_reset_shm (&sink->comm);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -300,6 +327,9 @@ gst_ipc_pipeline_sink_get_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       g_value_set_uint64 (value, sink->comm.ack_time);
       break;
+    case PROP_SHM_SIZE:
+      g_value_set_uint (value, sink->comm.shm_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -581,6 +611,7 @@ gst_ipc_pipeline_sink_disconnect (GstIpcPipelineSink * sink)
   sink->comm.fdin = -1;
   sink->comm.fdout = -1;
   gst_ipc_pipeline_comm_cancel (&sink->comm, FALSE);
+  gst_ipc_pipeline_comm_reset_shm (&sink->comm);
   gst_ipc_pipeline_sink_start_reader_thread (sink);
 }
 
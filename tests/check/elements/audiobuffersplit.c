@@ -0,0 +1,182 @@
+/* GStreamer
+ *
+ * unit test for audiobuffersplit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define CAPS "audio/x-raw,format=S16LE,rate=48000,channels=2,layout=interleaved"
+#define BPF 4
+#define IN_SAMPLES 700
+#define OUT_SAMPLES 480
+#define N_INPUT 6
+
+static GstHarness *
+setup_harness (gboolean zero_copy, gboolean output_buffer_list)
+{
+  GstHarness *h;
+
+  h = gst_harness_new ("audiobuffersplit");
+  g_object_set (h->element, "output-buffer-duration", 1, 100, "zero-copy",
+      zero_copy, "output-buffer-list", output_buffer_list, NULL);
+  gst_harness_set_caps_str (h, CAPS, CAPS);
+
+  return h;
+}
+
+/* Pushes N_INPUT buffers whose samples count up from 0 */
+static void
+push_input (GstHarness * h)
+{
+  guint i, j;
+
+  for (i = 0; i < N_INPUT; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate (NULL, IN_SAMPLES * BPF, NULL);
+    GstMapInfo map;
+    guint32 *samples;
+
+    gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+    samples = (guint32 *) map.data;
+    for (j = 0; j < IN_SAMPLES; j++)
+      samples[j] = i * IN_SAMPLES + j;
+    gst_buffer_unmap (buffer, &map);
+
+    GST_BUFFER_PTS (buffer) =
+        gst_util_uint64_scale (i * IN_SAMPLES, GST_SECOND, 48000);
+    GST_BUFFER_DURATION (buffer) =
+        gst_util_uint64_scale (IN_SAMPLES, GST_SECOND, 48000);
+    fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+  }
+}
+
+/* Pulls all the full output buffers, checks their samples and timestamps and
+ * returns how many of them have more than one memory */
+static guint
+check_output (GstHarness * h)
+{
+  guint n_buffers = IN_SAMPLES * N_INPUT / OUT_SAMPLES;
+  guint i, j, n_multi_memory = 0;
+
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), n_buffers);
+
+  for (i = 0; i < n_buffers; i++) {
+    GstBuffer *buffer = gst_harness_pull (h);
+    GstMapInfo map;
+    const guint32 *samples;
+
+    fail_unless_equals_int (gst_buffer_get_size (buffer), OUT_SAMPLES * BPF);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buffer),
+        gst_util_uint64_scale (i * OUT_SAMPLES, GST_SECOND, 48000));
+    fail_unless_equals_uint64 (GST_BUFFER_DURATION (buffer), 10 * GST_MSECOND);
+
+    if (gst_buffer_n_memory (buffer) > 1)
+      n_multi_memory++;
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    samples = (const guint32 *) map.data;
+    for (j = 0; j < OUT_SAMPLES; j++)
+      fail_unless_equals_int (samples[j], i * OUT_SAMPLES + j);
+    gst_buffer_unmap (buffer, &map);
+
+    gst_buffer_unref (buffer);
+  }
+
+  return n_multi_memory;
+}
+
+GST_START_TEST (test_copy)
+{
+  GstHarness *h = setup_harness (FALSE, FALSE);
+
+  push_input (h);
+  fail_unless_equals_int (check_output (h), 0);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_zero_copy)
+{
+  GstHarness *h = setup_harness (TRUE, FALSE);
+
+  /* 5 of the 8 output buffers span two input buffers */
+  push_input (h);
+  fail_unless_equals_int (check_output (h), 5);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+count_lists (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  guint *n_lists = user_data;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+    (*n_lists)++;
+  else
+    fail ("got a buffer outside of a buffer list");
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_output_buffer_list)
+{
+  GstHarness *h = setup_harness (TRUE, TRUE);
+  GstPad *srcpad;
+  guint n_lists = 0;
+
+  srcpad = gst_element_get_static_pad (h->element, "src");
+  gst_pad_add_probe (srcpad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST, count_lists,
+      &n_lists, NULL);
+  gst_object_unref (srcpad);
+
+  /* the first input buffer gives one output buffer, and each of the other
+   * ones one or two, always pushed in one list */
+  push_input (h);
+  fail_unless_equals_int (n_lists, N_INPUT);
+  check_output (h);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+audiobuffersplit_suite (void)
+{
+  Suite *s = suite_create ("audiobuffersplit");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_copy);
+  tcase_add_test (tc_chain, test_zero_copy);
+  tcase_add_test (tc_chain, test_output_buffer_list);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiobuffersplit);
@@ -0,0 +1,222 @@
+/* GStreamer
+ *
+ * unit test for audiolatency element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/check/gstcheck.h>
+
+/* Loops the output of audiolatency back to its input through a queue holding
+ * @delay of audio at @rate, measuring in correlation mode */
+static GstElement *
+create_loopback (GstClockTime delay, gint rate)
+{
+  GstElement *pipeline, *latency, *capsfilter, *queue;
+  GstCaps *caps;
+
+  pipeline = gst_pipeline_new (NULL);
+  latency = gst_element_factory_make ("audiolatency", NULL);
+  capsfilter = gst_element_factory_make ("capsfilter", NULL);
+  queue = gst_element_factory_make ("queue", NULL);
+  fail_unless (latency && capsfilter && queue);
+
+  caps = gst_caps_new_simple ("audio/x-raw", "rate", G_TYPE_INT, rate,
+      "channels", G_TYPE_INT, 2, NULL);
+  g_object_set (capsfilter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+  g_object_set (latency, "mode", 1 /* correlation */ , NULL);
+  g_object_set (queue, "min-threshold-time", delay, "max-size-time",
+      (guint64) 0, "max-size-buffers", 0, "max-size-bytes", 0, NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), latency, capsfilter, queue, NULL);
+  fail_unless (gst_element_link_many (latency, capsfilter, queue, latency,
+          NULL));
+
+  return pipeline;
+}
+
+/* Waits for the next latency measurement, in microseconds */
+static gint64
+next_latency (GstBus * bus)
+{
+  gint64 last = -1;
+
+  while (last < 0) {
+    GstMessage *msg;
+    const GstStructure *s;
+    gdouble confidence;
+
+    msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+        GST_MESSAGE_ELEMENT | GST_MESSAGE_ERROR);
+    fail_unless (msg != NULL, "no latency measured");
+    fail_unless (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ELEMENT);
+
+    s = gst_message_get_structure (msg);
+    if (gst_structure_has_name (s, "latency")) {
+      fail_unless (gst_structure_get_int64 (s, "last-latency", &last));
+      fail_unless (gst_structure_get_double (s, "confidence", &confidence));
+      GST_INFO ("latency %" G_GINT64_FORMAT "us, confidence %f", last,
+          confidence);
+      fail_unless (confidence >= 0.5 && confidence <= 1.0);
+    }
+    gst_message_unref (msg);
+  }
+
+  return last;
+}
+
+/* the queue only lets a 5ms buffer through once it holds the delay, and the
+ * threads add some scheduling jitter */
+static void
+assert_latency (gint64 measured, GstClockTime delay)
+{
+  gint64 expected = delay / GST_USECOND;
+
+  GST_INFO ("expected %" G_GINT64_FORMAT "us, measured %" G_GINT64_FORMAT
+      "us", expected, measured);
+  fail_unless (measured >= expected - 5000 && measured <= expected + 30000,
+      "expected %" G_GINT64_FORMAT "us, measured %" G_GINT64_FORMAT "us",
+      expected, measured);
+}
+
+/* Returns the average of the first @n_measurements measurements, in
+ * microseconds */
+static gint64
+measure_loopback_latency (GstClockTime delay, gint rate, guint n_measurements)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  gint64 total = 0;
+  guint n;
+
+  pipeline = create_loopback (delay, rate);
+  bus = gst_element_get_bus (pipeline);
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  for (n = 0; n < n_measurements; n++)
+    total += next_latency (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return total / n_measurements;
+}
+
+GST_START_TEST (test_correlation_loopback)
+{
+  static const GstClockTime delays[] = { 40 * GST_MSECOND,
+    200 * GST_MSECOND
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (delays); i++)
+    assert_latency (measure_loopback_latency (delays[i], 48000, 2), delays[i]);
+}
+
+GST_END_TEST;
+
+/* Latencies up to the duration of the sequence, 2s at 16kHz, are measured */
+GST_START_TEST (test_correlation_long_latency)
+{
+  assert_latency (measure_loopback_latency (1200 * GST_MSECOND, 16000, 2),
+      1200 * GST_MSECOND);
+}
+
+GST_END_TEST;
+
+/* The audio received before a pause is not timed against the sequence sent
+ * after it */
+GST_START_TEST (test_correlation_pause)
+{
+  GstClockTime delay = 200 * GST_MSECOND;
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+
+  pipeline = create_loopback (delay, 48000);
+  bus = gst_element_get_bus (pipeline);
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  assert_latency (next_latency (bus), delay);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PAUSED) !=
+      GST_STATE_CHANGE_FAILURE);
+  g_usleep (300 * G_TIME_SPAN_MILLISECOND);
+  while ((msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT)))
+    gst_message_unref (msg);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  assert_latency (next_latency (bus), delay);
+  assert_latency (next_latency (bus), delay);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_correlation_properties)
+{
+  GstElement *latency;
+  gdouble confidence;
+  gfloat amplitude;
+  gint mode;
+
+  latency = gst_check_setup_element ("audiolatency");
+
+  g_object_get (latency, "mode", &mode, "probe-amplitude", &amplitude,
+      "confidence", &confidence, NULL);
+  fail_unless_equals_int (mode, 0);
+  fail_unless (amplitude > 0.0 && amplitude < 0.01);
+  fail_unless (confidence == 0.0);
+
+  g_object_set (latency, "mode", 1, "probe-amplitude", 0.01, NULL);
+  g_object_get (latency, "mode", &mode, "probe-amplitude", &amplitude, NULL);
+  fail_unless_equals_int (mode, 1);
+  fail_unless_equals_float (amplitude, 0.01);
+
+  gst_check_teardown_element (latency);
+}
+
+GST_END_TEST;
+
+static Suite *
+audiolatency_suite (void)
+{
+  Suite *s = suite_create ("audiolatency");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 60);
+  tcase_add_test (tc_chain, test_correlation_properties);
+  tcase_add_test (tc_chain, test_correlation_loopback);
+  tcase_add_test (tc_chain, test_correlation_long_latency);
+  tcase_add_test (tc_chain, test_correlation_pause);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiolatency);
@@ -0,0 +1,309 @@
+/* GStreamer
+ *
+ * unit test for audiomixmatrix
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/audio.h>
+#include <math.h>
+
+#define IN_CHANNELS 8
+#define OUT_CHANNELS 6
+#define N_SAMPLES 1000
+
+/* a dense row, a copy, a sparse row, silence, a scaled input and another
+ * dense row */
+static const gdouble matrix[OUT_CHANNELS][IN_CHANNELS] = {
+  {0.1, 0.2, 0.3, 0.4, -0.1, -0.2, -0.3, 0.05},
+  {0, 0, 1, 0, 0, 0, 0, 0},
+  {0.5, 0, 0, 0, 0, 0, 0, -0.5},
+  {0, 0, 0, 0, 0, 0, 0, 0},
+  {0, 0, 0, 0, 0.75, 0, 0, 0},
+  {-0.3, -0.3, 0.2, 0.1, 0.3, -0.4, 0.25, 0.125},
+};
+
+/* the rows of the matrix in reverse order */
+static const gdouble swapped_matrix[OUT_CHANNELS][IN_CHANNELS] = {
+  {-0.3, -0.3, 0.2, 0.1, 0.3, -0.4, 0.25, 0.125},
+  {0, 0, 0, 0, 0.75, 0, 0, 0},
+  {0, 0, 0, 0, 0, 0, 0, 0},
+  {0.5, 0, 0, 0, 0, 0, 0, -0.5},
+  {0, 0, 1, 0, 0, 0, 0, 0},
+  {0.1, 0.2, 0.3, 0.4, -0.1, -0.2, -0.3, 0.05},
+};
+
+static void
+set_matrix (GstElement * element, const gdouble m[OUT_CHANNELS][IN_CHANNELS])
+{
+  GValue v = G_VALUE_INIT;
+  guint in, out;
+
+  g_value_init (&v, GST_TYPE_ARRAY);
+  for (out = 0; out < OUT_CHANNELS; out++) {
+    GValue row = G_VALUE_INIT;
+
+    g_value_init (&row, GST_TYPE_ARRAY);
+    for (in = 0; in < IN_CHANNELS; in++) {
+      GValue itm = G_VALUE_INIT;
+
+      g_value_init (&itm, G_TYPE_DOUBLE);
+      g_value_set_double (&itm, m[out][in]);
+      gst_value_array_append_value (&row, &itm);
+      g_value_unset (&itm);
+    }
+    gst_value_array_append_value (&v, &row);
+    g_value_unset (&row);
+  }
+  g_object_set_property (G_OBJECT (element), "matrix", &v);
+  g_value_unset (&v);
+}
+
+static GstBuffer *
+create_input (GstAudioFormat format, gboolean planar)
+{
+  GstAudioInfo info;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint i;
+
+  gst_audio_info_set_format (&info, format, 48000, IN_CHANNELS, NULL);
+  if (planar)
+    info.layout = GST_AUDIO_LAYOUT_NON_INTERLEAVED;
+
+  buf = gst_buffer_new_allocate (NULL, N_SAMPLES * info.bpf, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < N_SAMPLES * IN_CHANNELS; i++) {
+    switch (format) {
+      case GST_AUDIO_FORMAT_F32:
+        ((gfloat *) map.data)[i] = g_random_double_range (-1.0, 1.0);
+        break;
+      case GST_AUDIO_FORMAT_F64:
+        ((gdouble *) map.data)[i] = g_random_double_range (-1.0, 1.0);
+        break;
+      case GST_AUDIO_FORMAT_S16:
+        ((gint16 *) map.data)[i] = g_random_int_range (G_MININT16,
+            G_MAXINT16 + 1);
+        break;
+      case GST_AUDIO_FORMAT_S32:
+        ((gint32 *) map.data)[i] = g_random_int ();
+        break;
+      default:
+        g_assert_not_reached ();
+    }
+  }
+  gst_buffer_unmap (buf, &map);
+
+  if (planar)
+    gst_buffer_add_audio_meta (buf, &info, N_SAMPLES, NULL);
+  GST_BUFFER_PTS (buf) = 0;
+  GST_BUFFER_DURATION (buf) = gst_util_uint64_scale_int (N_SAMPLES,
+      GST_SECOND, 48000);
+
+  return buf;
+}
+
+static GstHarness *
+setup_mix (GstAudioFormat format, gboolean planar, guint n_threads)
+{
+  GstHarness *h;
+  gchar *caps;
+
+  h = gst_harness_new ("audiomixmatrix");
+  g_object_set (h->element, "in-channels", IN_CHANNELS, "out-channels",
+      OUT_CHANNELS, "n-threads", n_threads, NULL);
+  set_matrix (h->element, matrix);
+
+  caps = g_strdup_printf ("audio/x-raw,format=%s,rate=48000,channels=%d,"
+      "channel-mask=(bitmask)0,layout=%s", gst_audio_format_to_string (format),
+      IN_CHANNELS, planar ? "non-interleaved" : "interleaved");
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  return h;
+}
+
+static GstBuffer *
+mix (GstHarness * h, GstBuffer * input)
+{
+  GstBuffer *out;
+
+  out = gst_harness_push_and_pull (h, gst_buffer_ref (input));
+  fail_unless (out != NULL);
+
+  return out;
+}
+
+static void
+assert_buffers_equal (GstBuffer * a, GstBuffer * b)
+{
+  GstMapInfo map;
+
+  gst_buffer_map (b, &map, GST_MAP_READ);
+  fail_unless_equals_uint64 (gst_buffer_get_size (a), map.size);
+  fail_unless (gst_buffer_memcmp (a, 0, map.data, map.size) == 0);
+  gst_buffer_unmap (b, &map);
+}
+
+/* Mixes @input sample by sample, adding every input in the precision of the
+ * format as the element did before it was threaded, and compares the
+ * result with @output. Only contracting the multiply-adds differently may
+ * change the last bit */
+static void
+check_float_reference (GstAudioFormat format, gboolean planar,
+    const gdouble m[OUT_CHANNELS][IN_CHANNELS], GstBuffer * input,
+    GstBuffer * output)
+{
+  GstMapInfo in_map, out_map;
+  guint s, in, out;
+
+  gst_buffer_map (input, &in_map, GST_MAP_READ);
+  gst_buffer_map (output, &out_map, GST_MAP_READ);
+  fail_unless_equals_uint64 (out_map.size, N_SAMPLES * OUT_CHANNELS *
+      (format == GST_AUDIO_FORMAT_F32 ? sizeof (gfloat) : sizeof (gdouble)));
+
+  for (s = 0; s < N_SAMPLES; s++) {
+    for (out = 0; out < OUT_CHANNELS; out++) {
+      guint out_idx = planar ? out * N_SAMPLES + s : s * OUT_CHANNELS + out;
+
+      if (format == GST_AUDIO_FORMAT_F32) {
+        const gfloat *src = (const gfloat *) in_map.data;
+        gfloat outval = 0;
+
+        for (in = 0; in < IN_CHANNELS; in++) {
+          if (m[out][in] != 0.0)
+            outval += src[planar ? in * N_SAMPLES + s : s * IN_CHANNELS + in]
+                * m[out][in];
+        }
+        fail_unless (fabs (((const gfloat *) out_map.data)[out_idx] - outval)
+            <= 1e-6, "sample %u of channel %u differs", s, out);
+      } else {
+        const gdouble *src = (const gdouble *) in_map.data;
+        gdouble outval = 0;
+
+        for (in = 0; in < IN_CHANNELS; in++) {
+          if (m[out][in] != 0.0)
+            outval += src[planar ? in * N_SAMPLES + s : s * IN_CHANNELS + in]
+                * m[out][in];
+        }
+        fail_unless (fabs (((const gdouble *) out_map.data)[out_idx] -
+                outval) <= 1e-12, "sample %u of channel %u differs", s, out);
+      }
+    }
+  }
+
+  gst_buffer_unmap (output, &out_map);
+  gst_buffer_unmap (input, &in_map);
+}
+
+static void
+check_threads (GstAudioFormat format, gboolean planar)
+{
+  GstBuffer *input, *serial, *threaded;
+  GstHarness *h;
+  guint n_threads;
+
+  input = create_input (format, planar);
+
+  h = setup_mix (format, planar, 1);
+  serial = mix (h, input);
+  gst_harness_teardown (h);
+
+  if (format == GST_AUDIO_FORMAT_F32 || format == GST_AUDIO_FORMAT_F64)
+    check_float_reference (format, planar, matrix, input, serial);
+
+  for (n_threads = 2; n_threads <= OUT_CHANNELS + 1; n_threads++) {
+    h = setup_mix (format, planar, n_threads);
+    threaded = mix (h, input);
+    assert_buffers_equal (serial, threaded);
+    gst_buffer_unref (threaded);
+    gst_harness_teardown (h);
+  }
+
+  gst_buffer_unref (serial);
+  gst_buffer_unref (input);
+}
+
+GST_START_TEST (test_threads_interleaved)
+{
+  check_threads (GST_AUDIO_FORMAT_F32, FALSE);
+  check_threads (GST_AUDIO_FORMAT_F64, FALSE);
+  check_threads (GST_AUDIO_FORMAT_S16, FALSE);
+  check_threads (GST_AUDIO_FORMAT_S32, FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threads_non_interleaved)
+{
+  check_threads (GST_AUDIO_FORMAT_F32, TRUE);
+  check_threads (GST_AUDIO_FORMAT_F64, TRUE);
+  check_threads (GST_AUDIO_FORMAT_S16, TRUE);
+  check_threads (GST_AUDIO_FORMAT_S32, TRUE);
+}
+
+GST_END_TEST;
+
+/* The number of threads and the matrix can be changed while streaming */
+GST_START_TEST (test_update_while_streaming)
+{
+  GstBuffer *input, *serial, *threaded;
+  GstHarness *h;
+
+  input = create_input (GST_AUDIO_FORMAT_F32, FALSE);
+
+  h = setup_mix (GST_AUDIO_FORMAT_F32, FALSE, 1);
+  serial = mix (h, input);
+
+  g_object_set (h->element, "n-threads", 4, NULL);
+  threaded = mix (h, input);
+  assert_buffers_equal (serial, threaded);
+  gst_buffer_unref (threaded);
+
+  set_matrix (h->element, swapped_matrix);
+  threaded = mix (h, input);
+  check_float_reference (GST_AUDIO_FORMAT_F32, FALSE, swapped_matrix, input,
+      threaded);
+  gst_buffer_unref (threaded);
+
+  gst_harness_teardown (h);
+  gst_buffer_unref (serial);
+  gst_buffer_unref (input);
+}
+
+GST_END_TEST;
+
+static Suite *
+audiomixmatrix_suite (void)
+{
+  Suite *s = suite_create ("audiomixmatrix");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_threads_interleaved);
+  tcase_add_test (tc_chain, test_threads_non_interleaved);
+  tcase_add_test (tc_chain, test_update_while_streaming);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiomixmatrix);
@@ -0,0 +1,463 @@
+/* GStreamer
+ *
+ * unit test for the compare element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+#define MAX_CHECK_PADS 3
+
+/* The compare element collects one buffer on each of its pads before
+ * comparing them, so the buffers of the check pads are pushed from their
+ * own threads while the reference is pushed on the sink pad */
+
+typedef struct
+{
+  GstElement *compare;
+  GstBus *bus;
+  GstHarness *hsink;
+  GstHarness *hcheck[MAX_CHECK_PADS];
+  guint n_check;
+} CompareTest;
+
+typedef struct
+{
+  GstHarness *h;
+  GstBuffer *buf;
+} PushData;
+
+static void
+compare_test_setup (CompareTest * t, guint n_check, const gchar * method,
+    gboolean upper, gdouble threshold, guint n_threads)
+{
+  guint i;
+
+  t->compare = gst_element_factory_make ("compare", NULL);
+  fail_unless (t->compare != NULL);
+  gst_util_set_object_arg (G_OBJECT (t->compare), "method", method);
+  g_object_set (t->compare, "upper", upper, "threshold", threshold,
+      "n-threads", n_threads, "post-results", TRUE, NULL);
+
+  t->bus = gst_bus_new ();
+  gst_element_set_bus (t->compare, t->bus);
+
+  t->hsink = gst_harness_new_with_element (t->compare, "sink", "src");
+  t->n_check = n_check;
+  for (i = 0; i < n_check; i++)
+    t->hcheck[i] = gst_harness_new_with_element (t->compare,
+        i == 0 ? "check" : "check_%u", NULL);
+}
+
+static void
+compare_test_set_caps (CompareTest * t, const gchar * sink_caps,
+    const gchar * check_caps)
+{
+  guint i;
+
+  gst_harness_set_src_caps_str (t->hsink, sink_caps);
+  for (i = 0; i < t->n_check; i++)
+    gst_harness_set_src_caps_str (t->hcheck[i], check_caps);
+}
+
+static void
+compare_test_teardown (CompareTest * t)
+{
+  guint i;
+
+  for (i = 0; i < t->n_check; i++)
+    gst_harness_teardown (t->hcheck[i]);
+  gst_harness_teardown (t->hsink);
+  gst_element_set_bus (t->compare, NULL);
+  gst_object_unref (t->bus);
+  gst_object_unref (t->compare);
+}
+
+static gpointer
+push_thread (PushData * data)
+{
+  fail_unless_equals_int (gst_harness_push (data->h, data->buf),
+      GST_FLOW_OK);
+  return NULL;
+}
+
+/* Compares the reference with one candidate per check pad, all buffers
+ * are taken */
+static void
+compare_test_push (CompareTest * t, GstBuffer * ref, GstBuffer ** check)
+{
+  PushData data[MAX_CHECK_PADS];
+  GThread *threads[MAX_CHECK_PADS];
+  guint i;
+
+  for (i = 0; i < t->n_check; i++) {
+    data[i].h = t->hcheck[i];
+    data[i].buf = check[i];
+    threads[i] = g_thread_new ("push", (GThreadFunc) push_thread, &data[i]);
+  }
+  fail_unless_equals_int (gst_harness_push (t->hsink, ref), GST_FLOW_OK);
+  for (i = 0; i < t->n_check; i++)
+    g_thread_join (threads[i]);
+
+  gst_buffer_unref (gst_harness_pull (t->hsink));
+}
+
+/* Pops the n_results compare-result messages of the last comparisons into
+ * results, and returns the names of the pads with a content mismatch in the
+ * order they were posted */
+static gchar *
+compare_test_pop_messages (CompareTest * t, GstStructure ** results,
+    guint n_results)
+{
+  GString *pads = g_string_new (NULL);
+  GstMessage *msg;
+  guint n = 0;
+
+  while ((msg = gst_bus_pop_filtered (t->bus, GST_MESSAGE_ELEMENT))) {
+    const GstStructure *s = gst_message_get_structure (msg);
+
+    if (gst_structure_has_name (s, "compare-result")) {
+      fail_unless (n < n_results);
+      results[n++] = gst_structure_copy (s);
+    } else if (gst_structure_has_name (s, "delta") &&
+        gst_structure_has_field (s, "content")) {
+      if (pads->len)
+        g_string_append_c (pads, ' ');
+      g_string_append (pads, gst_structure_get_string (s, "pad"));
+    }
+    gst_message_unref (msg);
+  }
+  fail_unless_equals_int (n, n_results);
+
+  return g_string_free (pads, FALSE);
+}
+
+/* Pops the compare-result message of the last comparison, and checks the
+ * pads with a content mismatch */
+static GstStructure *
+compare_test_pop_result (CompareTest * t, const gchar * mismatches)
+{
+  GstStructure *s;
+  gchar *pads;
+
+  pads = compare_test_pop_messages (t, &s, 1);
+  fail_unless_equals_string (pads, mismatches);
+  g_free (pads);
+
+  return s;
+}
+
+static gdouble
+result_plane (const GstStructure * s, guint i)
+{
+  const GValue *planes = gst_structure_get_value (s, "planes");
+
+  fail_unless (i < gst_value_array_get_size (planes));
+  return g_value_get_double (gst_value_array_get_value (planes, i));
+}
+
+static gdouble
+result_value (const GstStructure * s)
+{
+  gdouble value;
+
+  fail_unless (gst_structure_get_double (s, "value", &value));
+  return value;
+}
+
+/* A frame with every sample of each plane set to the given value */
+static GstBuffer *
+make_flat_frame (GstVideoFormat format, gint width, gint height,
+    const guint8 * values)
+{
+  GstVideoInfo info;
+  GstVideoFrame frame;
+  GstBuffer *buf;
+  guint i;
+  gint y;
+
+  gst_video_info_set_format (&info, format, width, height);
+  buf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+  fail_unless (gst_video_frame_map (&frame, &info, buf, GST_MAP_WRITE));
+  for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (&frame); i++) {
+    for (y = 0; y < GST_VIDEO_FRAME_COMP_HEIGHT (&frame, i); y++)
+      memset (GST_VIDEO_FRAME_PLANE_DATA (&frame, i) +
+          y * GST_VIDEO_FRAME_PLANE_STRIDE (&frame, i), values[i],
+          GST_VIDEO_FRAME_COMP_WIDTH (&frame, i));
+  }
+  gst_video_frame_unmap (&frame);
+
+  return buf;
+}
+
+static GstBuffer *
+make_random_frame (gsize size, guint32 seed)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+  GRand *rand = g_rand_new_with_seed (seed);
+  GstMapInfo map;
+  gsize i;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < map.size; i++)
+    map.data[i] = g_rand_int_range (rand, 0, 256);
+  gst_buffer_unmap (buf, &map);
+  g_rand_free (rand);
+
+  return buf;
+}
+
+static gdouble
+expected_psnr (gdouble mse)
+{
+  return 10.0 * log10 (255.0 * 255.0 / mse);
+}
+
+/* SSIM of two flat windows, which have no variance */
+static gdouble
+expected_flat_ssim (gdouble a, gdouble b)
+{
+  const gdouble c1 = (0.01 * 255) * (0.01 * 255);
+
+  return (2 * a * b + c1) / (a * a + b * b + c1);
+}
+
+GST_START_TEST (test_psnr)
+{
+  const guint8 ref_values[] = { 100, 128, 128 };
+  const guint8 check_values[] = { 100, 138, 128 };
+  CompareTest t;
+  GstBuffer *check;
+  GstStructure *s;
+
+  compare_test_setup (&t, 1, "psnr", FALSE, 30, 1);
+  compare_test_set_caps (&t, "video/x-raw,format=I420,width=64,height=48",
+      "video/x-raw,format=I420,width=64,height=48");
+
+  /* identical frames */
+  check = make_flat_frame (GST_VIDEO_FORMAT_I420, 64, 48, ref_values);
+  compare_test_push (&t, make_flat_frame (GST_VIDEO_FORMAT_I420, 64, 48,
+          ref_values), &check);
+  s = compare_test_pop_result (&t, "");
+  fail_unless_equals_string (gst_structure_get_string (s, "pad"), "check");
+  fail_unless_equals_string (gst_structure_get_string (s, "method"), "psnr");
+  fail_unless_equals_float (result_value (s), 100.0);
+  fail_unless_equals_float (result_plane (s, 0), 100.0);
+  fail_unless_equals_float (result_plane (s, 1), 100.0);
+  fail_unless_equals_float (result_plane (s, 2), 100.0);
+  gst_structure_free (s);
+
+  /* only the U plane differs, by 10 on every sample */
+  check = make_flat_frame (GST_VIDEO_FORMAT_I420, 64, 48, check_values);
+  compare_test_push (&t, make_flat_frame (GST_VIDEO_FORMAT_I420, 64, 48,
+          ref_values), &check);
+  s = compare_test_pop_result (&t, "");
+  fail_unless_equals_float (result_plane (s, 0), 100.0);
+  fail_unless (fabs (result_plane (s, 1) - expected_psnr (100)) < 1e-9);
+  fail_unless_equals_float (result_plane (s, 2), 100.0);
+  /* 32x24 differing samples out of 64x48 + 2 * 32x24 */
+  fail_unless (fabs (result_value (s) - expected_psnr (100.0 / 6)) < 1e-9);
+  gst_structure_free (s);
+
+  compare_test_teardown (&t);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_ssim)
+{
+  const guint8 ref_values[] = { 100 };
+  const guint8 check_values[] = { 110 };
+  CompareTest t;
+  GstBuffer *check;
+  GstStructure *s;
+
+  compare_test_setup (&t, 1, "ssim", FALSE, 0.999, 1);
+  compare_test_set_caps (&t, "video/x-raw,format=GRAY8,width=40,height=32",
+      "video/x-raw,format=GRAY8,width=40,height=32");
+
+  check = make_flat_frame (GST_VIDEO_FORMAT_GRAY8, 40, 32, ref_values);
+  compare_test_push (&t, make_flat_frame (GST_VIDEO_FORMAT_GRAY8, 40, 32,
+          ref_values), &check);
+  s = compare_test_pop_result (&t, "");
+  fail_unless_equals_string (gst_structure_get_string (s, "method"), "ssim");
+  fail_unless (fabs (result_value (s) - 1.0) < 1e-9);
+  fail_unless (fabs (result_plane (s, 0) - 1.0) < 1e-9);
+  gst_structure_free (s);
+
+  /* every window is flat, partial ones at the edges included */
+  check = make_flat_frame (GST_VIDEO_FORMAT_GRAY8, 40, 32, check_values);
+  compare_test_push (&t, make_flat_frame (GST_VIDEO_FORMAT_GRAY8, 40, 32,
+          ref_values), &check);
+  s = compare_test_pop_result (&t, "check");
+  fail_unless (fabs (result_value (s) - expected_flat_ssim (100,
+              110)) < 1e-9);
+  gst_structure_free (s);
+
+  compare_test_teardown (&t);
+}
+
+GST_END_TEST;
+
+/* the results do not depend on the number of threads */
+static void
+check_threads (const gchar * method)
+{
+  const guint n_threads[] = { 1, 2, 3, 7 };
+  gdouble value = 0, planes[3] = { 0, };
+  GstVideoInfo info;
+  guint i, j;
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, 100, 70);
+
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    CompareTest t;
+    GstBuffer *check;
+    GstStructure *s;
+
+    compare_test_setup (&t, 1, method, TRUE, 1000, n_threads[i]);
+    compare_test_set_caps (&t, "video/x-raw,format=I420,width=100,height=70",
+        "video/x-raw,format=I420,width=100,height=70");
+
+    check = make_random_frame (GST_VIDEO_INFO_SIZE (&info), 2);
+    compare_test_push (&t, make_random_frame (GST_VIDEO_INFO_SIZE (&info), 1),
+        &check);
+    s = compare_test_pop_result (&t, "");
+    if (i == 0) {
+      value = result_value (s);
+      for (j = 0; j < 3; j++)
+        planes[j] = result_plane (s, j);
+    } else {
+      fail_unless_equals_float (result_value (s), value);
+      for (j = 0; j < 3; j++)
+        fail_unless_equals_float (result_plane (s, j), planes[j]);
+    }
+    gst_structure_free (s);
+
+    compare_test_teardown (&t);
+  }
+}
+
+GST_START_TEST (test_psnr_threads)
+{
+  check_threads ("psnr");
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_ssim_threads)
+{
+  check_threads ("ssim");
+}
+
+GST_END_TEST;
+
+/* a size mismatch fails whatever the threshold direction */
+GST_START_TEST (test_psnr_size_mismatch)
+{
+  const guint8 values[] = { 100 };
+  gboolean upper;
+
+  for (upper = FALSE; upper <= TRUE; upper++) {
+    CompareTest t;
+    GstBuffer *check;
+    GstStructure *s;
+
+    compare_test_setup (&t, 1, "psnr", upper, 30, 1);
+    compare_test_set_caps (&t, "video/x-raw,format=GRAY8,width=16,height=16",
+        "video/x-raw,format=GRAY8,width=16,height=8");
+
+    check = make_flat_frame (GST_VIDEO_FORMAT_GRAY8, 16, 8, values);
+    compare_test_push (&t, make_flat_frame (GST_VIDEO_FORMAT_GRAY8, 16, 16,
+            values), &check);
+    s = compare_test_pop_result (&t, "check");
+    gst_structure_free (s);
+
+    compare_test_teardown (&t);
+  }
+}
+
+GST_END_TEST;
+
+/* one reference against several candidates, each result is reported on
+ * its own pad */
+GST_START_TEST (test_n_way)
+{
+  const guint8 ref_values[] = { 100 };
+  const guint8 bad_values[] = { 90 };
+  CompareTest t;
+  GstBuffer *check[3];
+  GstStructure *s[3];
+  gchar *pads;
+  guint i;
+
+  compare_test_setup (&t, 3, "psnr", FALSE, 30, 1);
+  compare_test_set_caps (&t, "video/x-raw,format=GRAY8,width=16,height=16",
+      "video/x-raw,format=GRAY8,width=16,height=16");
+
+  check[0] = make_flat_frame (GST_VIDEO_FORMAT_GRAY8, 16, 16, ref_values);
+  check[1] = make_flat_frame (GST_VIDEO_FORMAT_GRAY8, 16, 16, bad_values);
+  check[2] = make_flat_frame (GST_VIDEO_FORMAT_GRAY8, 16, 16, ref_values);
+  compare_test_push (&t, make_flat_frame (GST_VIDEO_FORMAT_GRAY8, 16, 16,
+          ref_values), check);
+
+  pads = compare_test_pop_messages (&t, s, 3);
+  fail_unless_equals_string (pads, "check_0");
+  g_free (pads);
+
+  fail_unless_equals_string (gst_structure_get_string (s[0], "pad"), "check");
+  fail_unless_equals_float (result_value (s[0]), 100.0);
+  fail_unless_equals_string (gst_structure_get_string (s[1], "pad"),
+      "check_0");
+  fail_unless (fabs (result_value (s[1]) - expected_psnr (100)) < 1e-9);
+  fail_unless_equals_string (gst_structure_get_string (s[2], "pad"),
+      "check_1");
+  fail_unless_equals_float (result_value (s[2]), 100.0);
+  for (i = 0; i < 3; i++)
+    gst_structure_free (s[i]);
+
+  compare_test_teardown (&t);
+}
+
+GST_END_TEST;
+
+static Suite *
+compare_suite (void)
+{
+  Suite *s = suite_create ("compare");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_psnr);
+  tcase_add_test (tc_chain, test_ssim);
+  tcase_add_test (tc_chain, test_psnr_threads);
+  tcase_add_test (tc_chain, test_ssim_threads);
+  tcase_add_test (tc_chain, test_psnr_size_mismatch);
+  tcase_add_test (tc_chain, test_n_way);
+
+  return s;
+}
+
+GST_CHECK_MAIN (compare);
@@ -6266,6 +6266,167 @@ GST_START_TEST (dash_mpdparser_check_mpd_xml_generator)
 
 GST_END_TEST;
 
+/*
+ * Test generating the SegmentBaseType attributes and the SegmentTimeline of
+ * a SegmentTemplate.
+ *
+ */
+GST_START_TEST (dash_mpdparser_check_mpd_xml_generator_segment_template)
+{
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\">"
+      "  <Period id=\"p0\">"
+      "    <AdaptationSet id=\"1\">"
+      "      <Representation id=\"v0\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"v0_$Number$.mp4\" timescale=\"1000\""
+      "                         availabilityTimeOffset=\"1.5\""
+      "                         availabilityTimeComplete=\"false\">"
+      "          <SegmentTimeline><S d=\"2000\"/></SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  gchar *new_xml;
+  gint new_xml_size;
+  GstMPDClient *first_mpdclient, *second_mpdclient;
+  GstMPDPeriodNode *period;
+  GstMPDAdaptationSetNode *adaptation_set;
+  GstMPDRepresentationNode *representation;
+  GstMPDMultSegmentBaseNode *mult_seg_base;
+  GstMPDSNode *s_node;
+
+  first_mpdclient = gst_mpd_client_new ();
+  ret = gst_mpd_client_parse (first_mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  ret = gst_mpd_client_add_segment_timeline_entry (first_mpdclient, "p0", 1,
+      "v0", 2000, 1960);
+  assert_equals_int (ret, TRUE);
+
+  gst_mpd_client_get_xml_content (first_mpdclient, &new_xml, &new_xml_size);
+
+  /* The SegmentBaseType attributes belong to the SegmentTemplate element */
+  fail_if (strstr (new_xml, "<SegmentBase") != NULL);
+
+  second_mpdclient = gst_mpd_client_new ();
+  ret = gst_mpd_client_parse (second_mpdclient, new_xml, new_xml_size);
+  assert_equals_int (ret, TRUE);
+  g_free (new_xml);
+
+  period = (GstMPDPeriodNode *) second_mpdclient->mpd_root_node->Periods->data;
+  adaptation_set = (GstMPDAdaptationSetNode *) period->AdaptationSets->data;
+  representation =
+      (GstMPDRepresentationNode *) adaptation_set->Representations->data;
+  mult_seg_base =
+      GST_MPD_MULT_SEGMENT_BASE_NODE (representation->SegmentTemplate);
+  assert_equals_uint64 (mult_seg_base->SegmentBase->timescale, 1000);
+  fail_unless (mult_seg_base->SegmentBase->availabilityTimeOffset == 1.5);
+  assert_equals_int (mult_seg_base->SegmentBase->availabilityTimeComplete,
+      FALSE);
+
+  assert_equals_int (g_queue_get_length (&mult_seg_base->SegmentTimeline->S),
+      2);
+  s_node = g_queue_peek_tail (&mult_seg_base->SegmentTimeline->S);
+  assert_equals_uint64 (s_node->t, 2000);
+  assert_equals_uint64 (s_node->d, 1960);
+
+  gst_mpd_client_free (first_mpdclient);
+  gst_mpd_client_free (second_mpdclient);
+}
+
+GST_END_TEST;
+
+/*
+ * Test trimming a SegmentTimeline to a window, and keeping the indexRange
+ * of a SegmentTemplate when generating the MPD.
+ *
+ */
+GST_START_TEST (dash_mpdparser_check_mpd_xml_generator_trim_timeline)
+{
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\">"
+      "  <Period id=\"p0\">"
+      "    <AdaptationSet id=\"1\">"
+      "      <Representation id=\"v0\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"v0_$Number$.mp4\" timescale=\"1000\""
+      "                         indexRange=\"0-99\" indexRangeExact=\"true\">"
+      "          <SegmentTimeline>"
+      "            <S t=\"0\" d=\"2000\" r=\"2\"/><S d=\"1000\"/>"
+      "          </SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  gchar *new_xml;
+  gint new_xml_size;
+  GstMPDClient *first_mpdclient, *second_mpdclient;
+  GstMPDPeriodNode *period;
+  GstMPDAdaptationSetNode *adaptation_set;
+  GstMPDRepresentationNode *representation;
+  GstMPDMultSegmentBaseNode *mult_seg_base;
+  GstMPDSNode *s_node;
+
+  first_mpdclient = gst_mpd_client_new ();
+  ret = gst_mpd_client_parse (first_mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  /* 4 segments, a window of 5 keeps all of them */
+  assert_equals_int (gst_mpd_client_trim_segment_timeline (first_mpdclient,
+          "p0", 1, "v0", 5), 0);
+
+  ret = gst_mpd_client_add_segment_timeline_entry (first_mpdclient, "p0", 1,
+      "v0", 7000, 2000);
+  assert_equals_int (ret, TRUE);
+
+  /* 5 segments, keeping the last 2 */
+  assert_equals_int (gst_mpd_client_trim_segment_timeline (first_mpdclient,
+          "p0", 1, "v0", 2), 3);
+
+  gst_mpd_client_get_xml_content (first_mpdclient, &new_xml, &new_xml_size);
+
+  second_mpdclient = gst_mpd_client_new ();
+  ret = gst_mpd_client_parse (second_mpdclient, new_xml, new_xml_size);
+  assert_equals_int (ret, TRUE);
+  g_free (new_xml);
+
+  period = (GstMPDPeriodNode *) second_mpdclient->mpd_root_node->Periods->data;
+  adaptation_set = (GstMPDAdaptationSetNode *) period->AdaptationSets->data;
+  representation =
+      (GstMPDRepresentationNode *) adaptation_set->Representations->data;
+  mult_seg_base =
+      GST_MPD_MULT_SEGMENT_BASE_NODE (representation->SegmentTemplate);
+
+  /* the first remaining segment is the fourth one */
+  assert_equals_int (mult_seg_base->startNumber, 4);
+  assert_equals_int (g_queue_get_length (&mult_seg_base->SegmentTimeline->S),
+      2);
+  s_node = g_queue_peek_head (&mult_seg_base->SegmentTimeline->S);
+  assert_equals_uint64 (s_node->t, 6000);
+  assert_equals_uint64 (s_node->d, 1000);
+  assert_equals_int (s_node->r, 0);
+  s_node = g_queue_peek_tail (&mult_seg_base->SegmentTimeline->S);
+  assert_equals_uint64 (s_node->t, 7000);
+  assert_equals_uint64 (s_node->d, 2000);
+
+  fail_unless (mult_seg_base->SegmentBase->indexRange != NULL);
+  assert_equals_uint64 (mult_seg_base->SegmentBase->indexRange->first_byte_pos,
+      0);
+  assert_equals_uint64 (mult_seg_base->SegmentBase->indexRange->last_byte_pos,
+      99);
+  assert_equals_int (mult_seg_base->SegmentBase->indexRangeExact, TRUE);
+
+  gst_mpd_client_free (first_mpdclient);
+  gst_mpd_client_free (second_mpdclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test add mpd content with mpd_client set methods
  *
@@ -6483,6 +6644,10 @@ dash_suite (void)
 
   /* test parsing the simplest possible mpd */
   tcase_add_test (tc_simpleMPD, dash_mpdparser_check_mpd_xml_generator);
+  tcase_add_test (tc_simpleMPD,
+      dash_mpdparser_check_mpd_xml_generator_segment_template);
+  tcase_add_test (tc_simpleMPD,
+      dash_mpdparser_check_mpd_xml_generator_trim_timeline);
 
   /* test mpd client set methods */
   tcase_add_test (tc_simpleMPD, dash_mpdparser_check_mpd_client_set_methods);
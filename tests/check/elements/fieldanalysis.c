@@ -0,0 +1,424 @@
+/* GStreamer
+ *
+ * unit test for fieldanalysis
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+#include <stdlib.h>
+
+#include "../../../gst/fieldanalysis/gstfieldanalysiscomb.h"
+
+enum
+{
+  METHOD_32DETECT,
+  METHOD_IS_COMBED,
+  METHOD_5_TAP,
+  N_METHODS
+};
+
+static const FieldAnalysisCombLineFunc comb_lines[N_METHODS] = {
+  gst_field_analysis_comb_line_32detect,
+  gst_field_analysis_comb_line_iscombed,
+  gst_field_analysis_comb_line_5_tap,
+};
+
+/* The comb mask of a sample as the element computed it sample by sample
+ * before its kernels were rewritten without branches */
+static gboolean
+ref_comb_mask (gint method, const guint8 * fjm2, const guint8 * fjm1,
+    const guint8 * fj, const guint8 * fjp1, const guint8 * fjp2, guint64 idx,
+    gint64 spatial_thresh)
+{
+  gint diff1 = fj[idx] - fjm1[idx];
+  gint diff2 = fj[idx] - fjp1[idx];
+
+  if (!((diff1 > spatial_thresh && diff2 > spatial_thresh)
+          || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)))
+    return FALSE;
+
+  switch (method) {
+    case METHOD_32DETECT:
+      return abs (fj[idx] - fjm2[idx]) < 10 && abs (fj[idx] - fjm1[idx]) > 15;
+    case METHOD_IS_COMBED:
+      return (fjm1[idx] - fj[idx]) * (fjp1[idx] - fj[idx]) >
+          spatial_thresh * spatial_thresh;
+    case METHOD_5_TAP:
+      return abs (fjm2[idx] + (fj[idx] << 2) + fjp2[idx] -
+          3 * (fjm1[idx] + fjp1[idx])) > 6 * spatial_thresh;
+    default:
+      g_assert_not_reached ();
+  }
+
+  return FALSE;
+}
+
+/* The block score of a row as the element computed it before, working one
+ * sample ahead of the block scores with special cases at the edges */
+static guint64
+ref_block_score_for_row (gint method, const guint8 * base_fj,
+    const guint8 * base_fjp1, gint incr, gint stride, gint frame_width,
+    guint64 block_width, guint64 block_height, gint64 spatial_thresh)
+{
+  const gint stridex2 = stride << 1;
+  const gint width = frame_width - (frame_width % block_width);
+  const guint8 *fjm2, *fjm1, *fj, *fjp1, *fjp2;
+  guint8 *comb_mask = g_new0 (guint8, width + 1);
+  guint *block_scores = g_new0 (guint, width / block_width + 1);
+  guint64 i, j, block_score;
+
+  fjm2 = base_fj - stridex2;
+  fjm1 = base_fjp1 - stridex2;
+  fj = base_fj;
+  fjp1 = base_fjp1;
+  fjp2 = fj + stridex2;
+
+  for (j = 0; j < block_height; j++) {
+    comb_mask[0] = ref_comb_mask (method, fjm2, fjm1, fj, fjp1, fjp2, 0,
+        spatial_thresh);
+
+    for (i = 1; i < width; i++) {
+      const guint64 res_idx = (i - 1) / block_width;
+
+      comb_mask[i] = ref_comb_mask (method, fjm2, fjm1, fj, fjp1, fjp2,
+          i * incr, spatial_thresh);
+
+      if (i == 1 && comb_mask[i - 1] && comb_mask[i]) {
+        /* left edge */
+        block_scores[res_idx]++;
+      } else if (i == width - 1) {
+        /* right edge */
+        if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
+          block_scores[res_idx]++;
+        if (comb_mask[i - 1] && comb_mask[i])
+          block_scores[i / block_width]++;
+      } else if (i >= 2 && comb_mask[i - 2] && comb_mask[i - 1]
+          && comb_mask[i]) {
+        block_scores[res_idx]++;
+      }
+    }
+
+    /* advance down a line */
+    fjm2 = fjm1;
+    fjm1 = fj;
+    fj = fjp1;
+    fjp1 = fjp2;
+    fjp2 = fj + stridex2;
+  }
+
+  block_score = 0;
+  for (i = 0; i < width / block_width; i++) {
+    if (block_scores[i] > block_score)
+      block_score = block_scores[i];
+  }
+
+  g_free (block_scores);
+  g_free (comb_mask);
+
+  return block_score;
+}
+
+#define MAX_WIDTH 100
+#define MAX_BLOCK_HEIGHT 16
+/* two lines above the first field line and three below the last one are
+ * read */
+#define N_LINES (MAX_BLOCK_HEIGHT + 6)
+
+/* Fills @data with random samples, or with alternating lines of a different
+ * amplitude every few columns and some noise, as a moving edge leaves in a
+ * woven frame */
+static void
+fill_lines (guint8 * data, gint stride, gboolean combed)
+{
+  gint x, y;
+
+  for (y = 0; y < N_LINES; y++) {
+    for (x = 0; x < stride; x++) {
+      if (combed) {
+        gint amplitude = (x / 5) % 4 * 30;
+        gint base = (y & 1) ? 128 + amplitude : 128 - amplitude;
+
+        data[y * stride + x] = base + g_random_int_range (-4, 5);
+      } else {
+        data[y * stride + x] = g_random_int_range (0, 256);
+      }
+    }
+  }
+}
+
+GST_START_TEST (test_block_score_for_row)
+{
+  static const gint widths[] = { 7, 16, 33, 64, MAX_WIDTH };
+  static const guint64 block_widths[] = { 1, 3, 8, 16 };
+  static const guint64 block_heights[] = { 1, 2, MAX_BLOCK_HEIGHT };
+  /* the last ones are above the largest difference of two samples */
+  static const gint64 thresholds[] = { 0, 9, 20, 100, 300, 100000 };
+  guint8 *data, *comb_mask;
+  guint *comb_cols;
+  gint incr, combed, method;
+  guint w, bw, bh, t, n_scores = 0;
+
+  data = g_new (guint8, N_LINES * MAX_WIDTH * 2);
+  comb_mask = g_new (guint8, MAX_WIDTH);
+  comb_cols = g_new (guint, MAX_WIDTH + 1);
+
+  for (incr = 1; incr <= 2; incr++) {
+    const gint stride = MAX_WIDTH * incr;
+    const guint8 *base_fj = data + 2 * stride;
+    const guint8 *base_fjp1 = base_fj + stride;
+
+    for (combed = 0; combed <= 1; combed++) {
+      fill_lines (data, stride, combed);
+
+      for (method = 0; method < N_METHODS; method++) {
+        for (w = 0; w < G_N_ELEMENTS (widths); w++) {
+          for (bw = 0; bw < G_N_ELEMENTS (block_widths); bw++) {
+            for (bh = 0; bh < G_N_ELEMENTS (block_heights); bh++) {
+              for (t = 0; t < G_N_ELEMENTS (thresholds); t++) {
+                guint64 expected, score;
+
+                expected = ref_block_score_for_row (method, base_fj,
+                    base_fjp1, incr, stride, widths[w], block_widths[bw],
+                    block_heights[bh], thresholds[t]);
+                score = gst_field_analysis_block_score_for_row
+                    (comb_lines[method], base_fj, base_fjp1, incr, stride,
+                    widths[w], block_widths[bw], block_heights[bh],
+                    thresholds[t], comb_mask, comb_cols);
+
+                fail_unless_equals_uint64 (score, expected);
+                if (expected > 0)
+                  n_scores++;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /* make sure that some of the rows were combed */
+  fail_unless (n_scores > 0);
+
+  g_free (comb_cols);
+  g_free (comb_mask);
+  g_free (data);
+}
+
+GST_END_TEST;
+
+#define WIDTH 320
+#define HEIGHT 240
+#define N_FRAMES 20
+
+typedef enum
+{
+  CONTENT_PROGRESSIVE,
+  CONTENT_INTERLACED,
+  CONTENT_TELECINE
+} Content;
+
+/* A bright bar moving right over a gradient with some noise, sampled at
+ * @time for the luma line @y */
+static void
+draw_line (guint8 * line, guint y, guint time)
+{
+  guint bar = (time * 12) % WIDTH;
+  guint x;
+
+  for (x = 0; x < WIDTH; x++) {
+    gint v = (x + WIDTH - bar) % WIDTH < 48 ? 220 : 40 + (x + y) / 8;
+
+    line[x] = CLAMP (v + g_random_int_range (-3, 4), 0, 255);
+  }
+}
+
+/* The times the top and bottom fields of frame @i were sampled at */
+static void
+field_times (Content content, guint i, guint * top, guint * bottom)
+{
+  /* 3:2 pulldown, AA BB BC CD DD */
+  static const guint pulldown[5][2] = {
+    {0, 0}, {1, 1}, {1, 2}, {2, 3}, {3, 3}
+  };
+
+  switch (content) {
+    case CONTENT_PROGRESSIVE:
+      *top = *bottom = 2 * i;
+      break;
+    case CONTENT_INTERLACED:
+      *top = 2 * i;
+      *bottom = 2 * i + 1;
+      break;
+    case CONTENT_TELECINE:
+      *top = 2 * (i / 5 * 4 + pulldown[i % 5][0]);
+      *bottom = 2 * (i / 5 * 4 + pulldown[i % 5][1]);
+      break;
+  }
+}
+
+static GstBuffer *
+create_frame (Content content, guint i)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint top, bottom, y;
+
+  field_times (content, i, &top, &bottom);
+
+  buf = gst_buffer_new_allocate (NULL, WIDTH * HEIGHT * 3 / 2, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (y = 0; y < HEIGHT; y++)
+    draw_line (map.data + y * WIDTH, y, (y & 1) ? bottom : top);
+  memset (map.data + WIDTH * HEIGHT, 128, WIDTH * HEIGHT / 2);
+  gst_buffer_unmap (buf, &map);
+
+  GST_BUFFER_PTS (buf) = gst_util_uint64_scale_int (i, GST_SECOND, 30);
+  GST_BUFFER_DURATION (buf) = GST_SECOND / 30;
+
+  return buf;
+}
+
+#define FLAGS_MASK (GST_VIDEO_BUFFER_FLAG_INTERLACED | \
+    GST_VIDEO_BUFFER_FLAG_TFF | GST_VIDEO_BUFFER_FLAG_RFF | \
+    GST_VIDEO_BUFFER_FLAG_ONEFIELD)
+
+/* Runs @frames through fieldanalysis and returns a description of the flags
+ * of every output buffer followed by the caps it pushed */
+static gchar *
+analyse (GstBuffer ** frames, const gchar * frame_metric,
+    const gchar * comb_method, guint n_threads)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GstEvent *event;
+  GString *s = g_string_new (NULL);
+  guint i, n_buffers = 0;
+
+  h = gst_harness_new ("fieldanalysis");
+  gst_util_set_object_arg (G_OBJECT (h->element), "frame-metric",
+      frame_metric);
+  gst_util_set_object_arg (G_OBJECT (h->element), "comb-method", comb_method);
+  g_object_set (h->element, "n-threads", n_threads, NULL);
+  gst_harness_set_src_caps_str (h, "video/x-raw,format=I420,width=320,"
+      "height=240,framerate=30/1");
+
+  for (i = 0; i < N_FRAMES; i++) {
+    fail_unless_equals_int (gst_harness_push (h, gst_buffer_copy (frames[i])),
+        GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  while ((buf = gst_harness_try_pull (h))) {
+    g_string_append_printf (s, "%x ", GST_BUFFER_FLAGS (buf) & FLAGS_MASK);
+    gst_buffer_unref (buf);
+    n_buffers++;
+  }
+  fail_unless_equals_int (n_buffers, N_FRAMES);
+
+  while ((event = gst_harness_try_pull_event (h))) {
+    if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+      GstCaps *caps;
+      gchar *str;
+
+      gst_event_parse_caps (event, &caps);
+      str = gst_caps_to_string (caps);
+      g_string_append_printf (s, "\n%s", str);
+      g_free (str);
+    }
+    gst_event_unref (event);
+  }
+
+  gst_harness_teardown (h);
+
+  return g_string_free (s, FALSE);
+}
+
+/* The decisions don't depend on how many threads computed the metrics */
+static void
+check_threads (Content content)
+{
+  static const gchar *configs[][2] = {
+    {"5-tap", "5-tap"},
+    {"windowed-comb", "32-detect"},
+    {"windowed-comb", "isCombed"},
+    {"windowed-comb", "5-tap"},
+  };
+  GstBuffer *frames[N_FRAMES];
+  guint i;
+
+  for (i = 0; i < N_FRAMES; i++)
+    frames[i] = create_frame (content, i);
+
+  for (i = 0; i < G_N_ELEMENTS (configs); i++) {
+    gchar *serial, *threaded;
+
+    serial = analyse (frames, configs[i][0], configs[i][1], 1);
+    threaded = analyse (frames, configs[i][0], configs[i][1], 4);
+    GST_LOG ("%s/%s on content %d:\n%s", configs[i][0], configs[i][1],
+        content, serial);
+    fail_unless_equals_string (threaded, serial);
+    g_free (threaded);
+    g_free (serial);
+  }
+
+  for (i = 0; i < N_FRAMES; i++)
+    gst_buffer_unref (frames[i]);
+}
+
+GST_START_TEST (test_threads_progressive)
+{
+  check_threads (CONTENT_PROGRESSIVE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threads_interlaced)
+{
+  check_threads (CONTENT_INTERLACED);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threads_telecine)
+{
+  check_threads (CONTENT_TELECINE);
+}
+
+GST_END_TEST;
+
+static Suite *
+fieldanalysis_suite (void)
+{
+  Suite *s = suite_create ("fieldanalysis");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_block_score_for_row);
+  tcase_add_test (tc_chain, test_threads_progressive);
+  tcase_add_test (tc_chain, test_threads_interlaced);
+  tcase_add_test (tc_chain, test_threads_telecine);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fieldanalysis);
@@ -0,0 +1,336 @@
+/* GStreamer
+ *
+ * unit test for the timing histograms of fpsdisplaysink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#include "../../../gst/debugutils/fpsdisplaysink.c"
+
+static guint64
+get_percentile (GstFPSDisplaySinkHistogram * hist, const gchar * field)
+{
+  GstStructure *s = gst_structure_new_empty ("stats");
+  guint64 value;
+  gchar *name;
+
+  histogram_add_percentiles (hist, s, "test");
+  name = g_strdup_printf ("test-%s", field);
+  fail_unless (gst_structure_get_uint64 (s, name, &value), "no %s", name);
+  g_free (name);
+  gst_structure_free (s);
+
+  return value;
+}
+
+static void
+record_n (GstFPSDisplaySinkHistogram * hist, GstClockTimeDiff value, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    histogram_record (hist, value);
+}
+
+/* each value is reported as the upper bound of its bucket, within 1/16th
+ * above the value */
+GST_START_TEST (test_histogram_buckets)
+{
+  const guint64 values_us[] = {
+    0, 1, 15, 16, 17, 31, 32, 33, 100, 1000, 16666, 33333, 1000000,
+    G_GUINT64_CONSTANT (3600000000)
+  };
+  GstFPSDisplaySinkHistogram *hist = g_new0 (GstFPSDisplaySinkHistogram, 1);
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (values_us); i++) {
+    GstClockTime value = values_us[i] * GST_USECOND;
+    guint64 max;
+
+    histogram_reset (hist);
+    histogram_record (hist, value);
+    max = get_percentile (hist, "max");
+    fail_unless (max >= value, "%" G_GUINT64_FORMAT " us reported as %"
+        G_GUINT64_FORMAT " ns", values_us[i], max);
+    fail_unless (max - value <= value / 16, "%" G_GUINT64_FORMAT
+        " us reported as %" G_GUINT64_FORMAT " ns", values_us[i], max);
+    fail_unless_equals_uint64 (get_percentile (hist, "p50"), max);
+  }
+
+  /* sub-microsecond and negative values fall in the first bucket */
+  histogram_reset (hist);
+  histogram_record (hist, 999);
+  histogram_record (hist, -5 * GST_MSECOND);
+  fail_unless_equals_int (g_atomic_int_get (&hist->count), 2);
+  fail_unless_equals_int (g_atomic_int_get (&hist->buckets[0]), 2);
+  fail_unless_equals_uint64 (get_percentile (hist, "max"), 0);
+
+  /* the largest difference still fits */
+  histogram_reset (hist);
+  histogram_record (hist, G_MAXINT64);
+  fail_unless (get_percentile (hist, "max") >= G_MAXINT64 / GST_USECOND *
+      GST_USECOND);
+
+  g_free (hist);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_histogram_percentiles)
+{
+  GstFPSDisplaySinkHistogram *hist = g_new0 (GstFPSDisplaySinkHistogram, 1);
+
+  /* an empty histogram reports 0 */
+  fail_unless_equals_uint64 (get_percentile (hist, "p50"), 0);
+  fail_unless_equals_uint64 (get_percentile (hist, "p99"), 0);
+  fail_unless_equals_uint64 (get_percentile (hist, "p999"), 0);
+  fail_unless_equals_uint64 (get_percentile (hist, "max"), 0);
+
+  /* values in the linear buckets are exact */
+  record_n (hist, 3 * GST_USECOND, 900);
+  record_n (hist, 10 * GST_USECOND, 90);
+  record_n (hist, 12 * GST_USECOND, 9);
+  record_n (hist, 15 * GST_USECOND, 1);
+  fail_unless_equals_uint64 (get_percentile (hist, "p50"), 3 * GST_USECOND);
+  fail_unless_equals_uint64 (get_percentile (hist, "p99"), 10 * GST_USECOND);
+  fail_unless_equals_uint64 (get_percentile (hist, "p999"),
+      12 * GST_USECOND);
+  fail_unless_equals_uint64 (get_percentile (hist, "max"), 15 * GST_USECOND);
+
+  /* one more, larger, sample moves the upper percentiles by one sample */
+  record_n (hist, GST_SECOND, 1);
+  fail_unless_equals_uint64 (get_percentile (hist, "p50"), 3 * GST_USECOND);
+  fail_unless_equals_uint64 (get_percentile (hist, "p99"), 12 * GST_USECOND);
+  fail_unless_equals_uint64 (get_percentile (hist, "p999"),
+      15 * GST_USECOND);
+  fail_unless (get_percentile (hist, "max") >= GST_SECOND);
+
+  /* percentiles round up to the next sample */
+  histogram_reset (hist);
+  record_n (hist, 1 * GST_USECOND, 1);
+  record_n (hist, 2 * GST_USECOND, 1);
+  fail_unless_equals_uint64 (get_percentile (hist, "p50"), 1 * GST_USECOND);
+  fail_unless_equals_uint64 (get_percentile (hist, "p99"), 2 * GST_USECOND);
+
+  g_free (hist);
+}
+
+GST_END_TEST;
+
+/* the counts are halved before they overflow, keeping the percentiles */
+GST_START_TEST (test_histogram_halve)
+{
+  GstFPSDisplaySinkHistogram *hist = g_new0 (GstFPSDisplaySinkHistogram, 1);
+  gint count;
+
+  hist->buckets[3] = FPS_DISPLAY_SINK_HISTOGRAM_MAX_COUNT - 11;
+  hist->buckets[10] = 10;
+  hist->count = FPS_DISPLAY_SINK_HISTOGRAM_MAX_COUNT - 1;
+
+  histogram_record (hist, 10 * GST_USECOND);
+
+  count = g_atomic_int_get (&hist->count);
+  fail_unless (count < FPS_DISPLAY_SINK_HISTOGRAM_MAX_COUNT / 2 + 1);
+  fail_unless_equals_int (g_atomic_int_get (&hist->buckets[3]),
+      (FPS_DISPLAY_SINK_HISTOGRAM_MAX_COUNT - 11) / 2);
+  fail_unless_equals_int (g_atomic_int_get (&hist->buckets[10]), 5);
+  fail_unless_equals_int (count, g_atomic_int_get (&hist->buckets[3]) +
+      g_atomic_int_get (&hist->buckets[10]));
+  fail_unless_equals_uint64 (get_percentile (hist, "p50"), 3 * GST_USECOND);
+  fail_unless_equals_uint64 (get_percentile (hist, "max"), 10 * GST_USECOND);
+
+  g_free (hist);
+}
+
+GST_END_TEST;
+
+#define FRAME_DURATION (GST_SECOND / 30)
+
+/* The frames are timed against the harness test clock, and the running
+ * time of the element is the time of the clock as it is not in a
+ * pipeline */
+static GstHarness *
+setup_sink (void)
+{
+  GstElement *sink, *video_sink;
+  GstHarness *h;
+
+  video_sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (video_sink != NULL);
+  g_object_set (video_sink, "async", FALSE, NULL);
+
+  sink = g_object_new (GST_TYPE_FPS_DISPLAY_SINK, "video-sink", video_sink,
+      "text-overlay", FALSE, "sync", FALSE, "silent", TRUE, NULL);
+  h = gst_harness_new_with_element (sink, "sink", NULL);
+  gst_object_unref (sink);
+
+  gst_harness_set_src_caps_str (h, "video/x-raw,format=I420,width=16,"
+      "height=16,framerate=30/1");
+
+  return h;
+}
+
+/* Pushes frames @first to @last, each reaching the sink @delay after its
+ * running time, @base being the running time of frame 0 */
+static void
+push_frames (GstHarness * h, guint first, guint last, GstClockTime base,
+    GstClockTime delay)
+{
+  guint i;
+
+  for (i = first; i <= last; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, 16 * 16 * 3 / 2, NULL);
+
+    GST_BUFFER_PTS (buf) = i * FRAME_DURATION;
+    GST_BUFFER_DURATION (buf) = FRAME_DURATION;
+    fail_unless (gst_harness_set_time (h, base + i * FRAME_DURATION + delay));
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+}
+
+static guint64
+get_stat (GstHarness * h, const gchar * field)
+{
+  GstStructure *s;
+  guint64 value;
+
+  g_object_get (h->element, "stats", &s, NULL);
+  fail_unless (s != NULL);
+  fail_unless (gst_structure_get_uint64 (s, field, &value), "no %s", field);
+  gst_structure_free (s);
+
+  return value;
+}
+
+/* the histograms report @expected within 1/16th above */
+static void
+assert_stat (GstHarness * h, const gchar * field, GstClockTime expected)
+{
+  guint64 value = get_stat (h, field);
+
+  fail_unless (value >= expected && value - expected <= expected / 16,
+      "%s is %" GST_TIME_FORMAT ", expected %" GST_TIME_FORMAT, field,
+      GST_TIME_ARGS (value), GST_TIME_ARGS (expected));
+}
+
+GST_START_TEST (test_record_frame_lateness)
+{
+  GstHarness *h = setup_sink ();
+
+  /* without any latency, a frame arriving after its running time is late */
+  push_frames (h, 0, 9, 0, 5 * GST_MSECOND);
+  fail_unless_equals_uint64 (get_stat (h, "samples"), 10);
+  assert_stat (h, "latency-p50", 5 * GST_MSECOND);
+  assert_stat (h, "lateness-p50", 5 * GST_MSECOND);
+  assert_stat (h, "lateness-max", 5 * GST_MSECOND);
+
+  /* the deadline moves with the latency configured on the sink */
+  fail_unless (gst_element_send_event (h->element,
+          gst_event_new_latency (20 * GST_MSECOND)));
+  push_frames (h, 10, 29, 0, 5 * GST_MSECOND);
+  fail_unless_equals_uint64 (get_stat (h, "samples"), 30);
+  assert_stat (h, "latency-max", 5 * GST_MSECOND);
+  fail_unless_equals_uint64 (get_stat (h, "lateness-p50"), 0);
+  assert_stat (h, "lateness-max", 5 * GST_MSECOND);
+
+  /* frames arriving later than the latency are late by the difference */
+  push_frames (h, 30, 59, 0, 30 * GST_MSECOND);
+  fail_unless_equals_uint64 (get_stat (h, "samples"), 60);
+  assert_stat (h, "latency-max", 30 * GST_MSECOND);
+  assert_stat (h, "lateness-p99", 10 * GST_MSECOND);
+  assert_stat (h, "lateness-max", 10 * GST_MSECOND);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_record_frame_jitter)
+{
+  GstHarness *h = setup_sink ();
+  GstFPSDisplaySink *self = GST_FPS_DISPLAY_SINK (h->element);
+
+  /* frames arriving at a constant delay have no jitter */
+  push_frames (h, 0, 9, 0, 5 * GST_MSECOND);
+  fail_unless_equals_int (g_atomic_int_get (&self->jitter_hist.count), 9);
+  fail_unless_equals_uint64 (get_stat (h, "jitter-max"), 0);
+
+  /* one frame arriving 8 ms later than the others is off by that much from
+   * both of its neighbours */
+  push_frames (h, 10, 10, 0, 13 * GST_MSECOND);
+  push_frames (h, 11, 99, 0, 5 * GST_MSECOND);
+  fail_unless_equals_int (g_atomic_int_get (&self->jitter_hist.count), 99);
+  fail_unless_equals_uint64 (get_stat (h, "jitter-p50"), 0);
+  assert_stat (h, "jitter-p99", 8 * GST_MSECOND);
+  assert_stat (h, "jitter-max", 8 * GST_MSECOND);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* The first frame of a new segment has no jitter against the last one of
+ * the previous segment */
+GST_START_TEST (test_record_frame_segment_reset)
+{
+  GstHarness *h = setup_sink ();
+  GstFPSDisplaySink *self = GST_FPS_DISPLAY_SINK (h->element);
+  GstSegment segment;
+
+  push_frames (h, 0, 9, 0, 5 * GST_MSECOND);
+  fail_unless_equals_int (g_atomic_int_get (&self->jitter_hist.count), 9);
+
+  /* the timestamps start again from 0, 10 seconds later */
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  segment.base = 10 * GST_SECOND;
+  fail_unless (gst_harness_push_event (h, gst_event_new_segment (&segment)));
+  push_frames (h, 0, 9, 10 * GST_SECOND, 5 * GST_MSECOND);
+
+  fail_unless_equals_uint64 (get_stat (h, "samples"), 20);
+  fail_unless_equals_int (g_atomic_int_get (&self->jitter_hist.count), 18);
+  assert_stat (h, "latency-max", 5 * GST_MSECOND);
+  fail_unless_equals_uint64 (get_stat (h, "jitter-max"), 0);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+fpsdisplaysink_suite (void)
+{
+  Suite *s = suite_create ("fpsdisplaysink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_histogram_buckets);
+  tcase_add_test (tc_chain, test_histogram_percentiles);
+  tcase_add_test (tc_chain, test_histogram_halve);
+  tcase_add_test (tc_chain, test_record_frame_lateness);
+  tcase_add_test (tc_chain, test_record_frame_jitter);
+  tcase_add_test (tc_chain, test_record_frame_segment_reset);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fpsdisplaysink);
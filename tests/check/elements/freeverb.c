@@ -0,0 +1,308 @@
+/* GStreamer
+ *
+ * unit test for freeverb
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/audio.h>
+#include <math.h>
+
+#define ROOM_SIZE 0.8f
+#define DAMPING 0.3f
+#define WIDTH 0.7f
+#define LEVEL 0.6f
+
+/* buffer sizes that put the block boundaries at varying positions, for a
+ * total longer than the longest delay line */
+static const guint buffer_frames[] = { 1, 127, 128, 1000, 3001, 50, 5000 };
+
+/* The reference is the per-sample implementation freeverb had before it
+ * processed blocks, with one filter network per output channel and the wet
+ * signal cross-fed within channel pairs as for stereo */
+
+#define DC_OFFSET 1e-8
+#define NUM_COMBS 8
+#define NUM_ALLPASSES 4
+#define STEREO_SPREAD 23
+
+static const gint comb_tuning[NUM_COMBS] = {
+  1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617
+};
+
+static const gint allpass_tuning[NUM_ALLPASSES] = { 556, 441, 341, 225 };
+
+typedef struct
+{
+  gfloat *buffer;
+  gint size;
+  gint idx;
+  gfloat store;
+} Delay;
+
+typedef struct
+{
+  Delay comb[NUM_COMBS];
+  Delay allpass[NUM_ALLPASSES];
+} RefChannel;
+
+typedef struct
+{
+  RefChannel *channels;
+  gint in_channels;
+  gint out_channels;
+  gfloat gain, feedback, damp1, damp2, wet1, wet2, dry;
+} Reference;
+
+static void
+delay_init (Delay * delay, gint size)
+{
+  gint i;
+
+  delay->size = size;
+  delay->idx = 0;
+  delay->store = 0;
+  delay->buffer = g_new (gfloat, size);
+  for (i = 0; i < size; i++)
+    delay->buffer[i] = (gfloat) DC_OFFSET;
+}
+
+static void
+reference_init (Reference * ref, gint rate, gint in_channels)
+{
+  gfloat srfactor = rate / 44100.0f;
+  gfloat roomsize, damp, wet, width;
+  gint c, i;
+
+  ref->in_channels = in_channels;
+  ref->out_channels = in_channels <= 2 ? 2 : in_channels;
+  ref->channels = g_new (RefChannel, ref->out_channels);
+  for (c = 0; c < ref->out_channels; c++) {
+    for (i = 0; i < NUM_COMBS; i++)
+      delay_init (&ref->channels[c].comb[i],
+          (comb_tuning[i] + c * STEREO_SPREAD) * srfactor);
+    for (i = 0; i < NUM_ALLPASSES; i++)
+      delay_init (&ref->channels[c].allpass[i],
+          (allpass_tuning[i] + c * STEREO_SPREAD) * srfactor);
+  }
+
+  /* as the element derives its parameters from the properties */
+  roomsize = (ROOM_SIZE * 0.28f) + 0.7f;
+  damp = DAMPING * 1.0f;
+  wet = LEVEL * 1.0f;
+  width = WIDTH;
+  ref->gain = 0.015f;
+  ref->feedback = roomsize;
+  ref->damp1 = damp;
+  ref->damp2 = 1 - damp;
+  ref->wet1 = wet * (width / 2.0f + 0.5f);
+  ref->wet2 = wet * ((1.0f - width) / 2.0f);
+  ref->dry = (1.0 - LEVEL) * 1.0f;
+}
+
+static void
+reference_free (Reference * ref)
+{
+  gint c, i;
+
+  for (c = 0; c < ref->out_channels; c++) {
+    for (i = 0; i < NUM_COMBS; i++)
+      g_free (ref->channels[c].comb[i].buffer);
+    for (i = 0; i < NUM_ALLPASSES; i++)
+      g_free (ref->channels[c].allpass[i].buffer);
+  }
+  g_free (ref->channels);
+}
+
+/* runs one frame of @in through the reference, and stores the output frame
+ * before it is converted to the sample format in @out */
+static void
+reference_process (Reference * ref, const gfloat * in, gfloat * out)
+{
+  gfloat wet[GST_AUDIO_MAX_CHANNELS];
+  gint c, i;
+
+  for (c = 0; c < ref->out_channels; c++) {
+    RefChannel *channel = &ref->channels[c];
+    gfloat input, output = 0.0f;
+
+    /* mono input is doubled and fed to both channels */
+    if (ref->in_channels == 1)
+      input = (2.0f * in[0] + DC_OFFSET) * ref->gain;
+    else
+      input = (in[c] + DC_OFFSET) * ref->gain;
+
+    for (i = 0; i < NUM_COMBS; i++) {
+      Delay *comb = &channel->comb[i];
+      gfloat tmp = comb->buffer[comb->idx];
+
+      comb->store = (tmp * ref->damp2) + (comb->store * ref->damp1);
+      comb->buffer[comb->idx] = input + (comb->store * ref->feedback);
+      if (++comb->idx >= comb->size)
+        comb->idx = 0;
+      output += tmp;
+    }
+
+    for (i = 0; i < NUM_ALLPASSES; i++) {
+      Delay *allpass = &channel->allpass[i];
+      gfloat bufout = allpass->buffer[allpass->idx];
+      gfloat tmp = bufout - output;
+
+      allpass->buffer[allpass->idx] = output + (bufout * 0.5f);
+      if (++allpass->idx >= allpass->size)
+        allpass->idx = 0;
+      output = tmp;
+    }
+
+    wet[c] = output - (gfloat) DC_OFFSET;
+  }
+
+  for (c = 0; c < ref->out_channels; c++) {
+    gint partner = (c ^ 1) < ref->out_channels ? c ^ 1 : c;
+
+    out[c] = wet[c] * ref->wet1 + wet[partner] * ref->wet2 +
+        in[ref->in_channels == 1 ? 0 : c] * ref->dry;
+  }
+}
+
+static void
+check_freeverb (GstAudioFormat format, gint rate, gint in_channels)
+{
+  gboolean is_float = format == GST_AUDIO_FORMAT_F32;
+  gint bps = is_float ? sizeof (gfloat) : sizeof (gint16);
+  Reference ref;
+  GstHarness *h;
+  gchar *caps;
+  guint i, k;
+  gint c, frame = 0;
+
+  reference_init (&ref, rate, in_channels);
+
+  h = gst_harness_new ("freeverb");
+  g_object_set (h->element, "room-size", ROOM_SIZE, "damping", DAMPING,
+      "width", WIDTH, "level", LEVEL, NULL);
+  caps = g_strdup_printf ("audio/x-raw,format=%s,layout=interleaved,"
+      "rate=%d,channels=%d%s", gst_audio_format_to_string (format), rate,
+      in_channels, in_channels > 2 ? ",channel-mask=(bitmask)0" : "");
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  for (i = 0; i < G_N_ELEMENTS (buffer_frames); i++) {
+    GstBuffer *buf;
+    GstMapInfo map;
+    gfloat *input;
+
+    input = g_new (gfloat, buffer_frames[i] * in_channels);
+    buf = gst_buffer_new_allocate (NULL,
+        buffer_frames[i] * in_channels * bps, NULL);
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    for (k = 0; k < buffer_frames[i] * in_channels; k++) {
+      if (is_float) {
+        input[k] = g_random_double_range (-0.5, 0.5);
+        ((gfloat *) map.data)[k] = input[k];
+      } else {
+        ((gint16 *) map.data)[k] = g_random_int_range (-16000, 16000);
+        input[k] = ((gint16 *) map.data)[k];
+      }
+    }
+    gst_buffer_unmap (buf, &map);
+
+    buf = gst_harness_push_and_pull (h, buf);
+    fail_unless (buf != NULL);
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_uint64 (map.size,
+        buffer_frames[i] * ref.out_channels * bps);
+    for (k = 0; k < buffer_frames[i]; k++, frame++) {
+      gfloat expected[GST_AUDIO_MAX_CHANNELS];
+
+      reference_process (&ref, input + k * in_channels, expected);
+
+      /* allowing for multiply-adds contracted differently */
+      for (c = 0; c < ref.out_channels; c++) {
+        if (is_float) {
+          gfloat out = ((gfloat *) map.data)[k * ref.out_channels + c];
+
+          fail_unless (fabs (out - expected[c]) <= 1e-6,
+              "%d channels: sample %d of channel %d is %f instead of %f",
+              in_channels, frame, c, out, expected[c]);
+        } else {
+          gint16 out = ((gint16 *) map.data)[k * ref.out_channels + c];
+          gint16 exp = CLAMP (expected[c], G_MININT16, G_MAXINT16);
+
+          fail_unless (ABS (out - exp) <= 1,
+              "%d channels: sample %d of channel %d is %d instead of %d",
+              in_channels, frame, c, out, exp);
+        }
+      }
+    }
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+    g_free (input);
+  }
+
+  gst_harness_teardown (h);
+  reference_free (&ref);
+}
+
+GST_START_TEST (test_mono)
+{
+  check_freeverb (GST_AUDIO_FORMAT_F32, 44100, 1);
+  check_freeverb (GST_AUDIO_FORMAT_S16, 44100, 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_stereo)
+{
+  check_freeverb (GST_AUDIO_FORMAT_F32, 44100, 2);
+  check_freeverb (GST_AUDIO_FORMAT_S16, 44100, 2);
+  check_freeverb (GST_AUDIO_FORMAT_F32, 48000, 2);
+}
+
+GST_END_TEST;
+
+/* the last of an odd number of channels is cross-fed with itself */
+GST_START_TEST (test_multichannel)
+{
+  check_freeverb (GST_AUDIO_FORMAT_F32, 48000, 3);
+  check_freeverb (GST_AUDIO_FORMAT_F32, 48000, 6);
+  check_freeverb (GST_AUDIO_FORMAT_S16, 48000, 6);
+}
+
+GST_END_TEST;
+
+static Suite *
+freeverb_suite (void)
+{
+  Suite *s = suite_create ("freeverb");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_mono);
+  tcase_add_test (tc_chain, test_stereo);
+  tcase_add_test (tc_chain, test_multichannel);
+
+  return s;
+}
+
+GST_CHECK_MAIN (freeverb);
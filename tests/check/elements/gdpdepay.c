@@ -400,6 +400,269 @@ GST_START_TEST (test_streamheader)
 
 GST_END_TEST;
 
+#define PAYLOAD_SIZE 4000
+
+/* Sets @gdpdepay to playing and feeds it the stream-start, caps and segment
+ * packets that come before the buffers */
+static void
+gdpdepay_start_stream (GstElement * gdpdepay)
+{
+  GstCaps *caps;
+  GstBuffer *inbuffer, *buffer;
+  GstEvent *event;
+  GstSegment segment;
+
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_empty_simple ("application/x-gdp");
+  gst_check_setup_events (mysrcpad, gdpdepay, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  event = gst_event_new_stream_start ("s-s-id-1234");
+  inbuffer = gst_dp_payload_event (event, 0);
+  gst_event_unref (event);
+
+  caps = gst_caps_from_string (AUDIO_CAPS_STRING);
+  buffer = gst_dp_payload_caps (caps, 0);
+  gst_caps_unref (caps);
+  inbuffer = gst_buffer_append (inbuffer, buffer);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  event = gst_event_new_segment (&segment);
+  buffer = gst_dp_payload_event (event, 0);
+  gst_event_unref (event);
+  inbuffer = gst_buffer_append (inbuffer, buffer);
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 0);
+}
+
+static void
+gdpdepay_stop (GstElement * gdpdepay)
+{
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+  ASSERT_OBJECT_REFCOUNT (gdpdepay, "gdpdepay", 1);
+  cleanup_gdpdepay (gdpdepay);
+}
+
+static GstBuffer *
+create_payload (gsize size, guint seed)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gsize i;
+
+  buffer = gst_buffer_new_and_alloc (size);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  for (i = 0; i < size; i++)
+    map.data[i] = (seed + i * 7) % 251;
+  gst_buffer_unmap (buffer, &map);
+
+  GST_BUFFER_TIMESTAMP (buffer) = seed * GST_SECOND;
+  GST_BUFFER_DURATION (buffer) = GST_SECOND;
+
+  return buffer;
+}
+
+/* Pushes the bytes of @packet in new buffers of the sizes listed in @chunks,
+ * up to a 0 size, and the rest in one last buffer. Stops at the first push
+ * that fails and returns its result */
+static GstFlowReturn
+gdpdepay_push_chunks (GstBuffer * packet, const gsize * chunks)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstMapInfo map;
+  gsize offset = 0;
+
+  gst_buffer_map (packet, &map, GST_MAP_READ);
+  while (offset < map.size && ret == GST_FLOW_OK) {
+    GstBuffer *inbuffer;
+    gsize size = map.size - offset;
+
+    if (*chunks > 0) {
+      size = MIN (*chunks, size);
+      chunks++;
+    }
+
+    inbuffer = gst_buffer_new_and_alloc (size);
+    gst_buffer_fill (inbuffer, 0, map.data + offset, size);
+    ret = gst_pad_push (mysrcpad, inbuffer);
+    offset += size;
+  }
+  gst_buffer_unmap (packet, &map);
+
+  return ret;
+}
+
+static void
+check_output (GstBuffer * outbuffer, GstBuffer * payload)
+{
+  GstMapInfo map;
+
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (outbuffer),
+      GST_BUFFER_TIMESTAMP (payload));
+  fail_unless_equals_uint64 (GST_BUFFER_DURATION (outbuffer),
+      GST_BUFFER_DURATION (payload));
+
+  gst_buffer_map (payload, &map, GST_MAP_READ);
+  fail_unless_equals_uint64 (gst_buffer_get_size (outbuffer), map.size);
+  fail_unless (gst_buffer_memcmp (outbuffer, 0, map.data, map.size) == 0);
+  gst_buffer_unmap (payload, &map);
+}
+
+/* payloads that don't arrive in one piece are read into new buffers, which
+ * come from a pool once consecutive payloads have the same size */
+GST_START_TEST (test_buffer_pool)
+{
+  /* the header and the start of the payload, then the rest */
+  const gsize chunks[] = { GST_DP_HEADER_LENGTH + 1000, 0 };
+  GstBuffer *payloads[4], *packet;
+  GstBufferPool *pool;
+  GstElement *gdpdepay;
+  guint i;
+
+  gdpdepay = setup_gdpdepay ();
+  gdpdepay_start_stream (gdpdepay);
+
+  for (i = 0; i < G_N_ELEMENTS (payloads); i++) {
+    /* the last payload has another size */
+    payloads[i] = create_payload (i < 3 ? PAYLOAD_SIZE : PAYLOAD_SIZE / 2, i);
+    packet = gst_dp_payload_buffer (payloads[i], 0);
+    fail_unless_equals_int (gdpdepay_push_chunks (packet, chunks),
+        GST_FLOW_OK);
+    gst_buffer_unref (packet);
+  }
+
+  fail_unless_equals_int (g_list_length (buffers), G_N_ELEMENTS (payloads));
+  for (i = 0; i < G_N_ELEMENTS (payloads); i++)
+    check_output (g_list_nth_data (buffers, i), payloads[i]);
+
+  pool = ((GstBuffer *) g_list_nth_data (buffers, 1))->pool;
+  fail_unless (((GstBuffer *) g_list_nth_data (buffers, 0))->pool == NULL);
+  fail_unless (pool != NULL);
+  fail_unless (((GstBuffer *) g_list_nth_data (buffers, 2))->pool == pool);
+  fail_unless (((GstBuffer *) g_list_nth_data (buffers, 3))->pool == NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (payloads); i++)
+    gst_buffer_unref (payloads[i]);
+  gdpdepay_stop (gdpdepay);
+}
+
+GST_END_TEST;
+
+/* a payload that is whole in the input buffer is not copied */
+GST_START_TEST (test_buffer_shared_memory)
+{
+  GstBuffer *payload, *packet, *outbuffer;
+  GstMapInfo map, outmap;
+  GstElement *gdpdepay;
+
+  gdpdepay = setup_gdpdepay ();
+  gdpdepay_start_stream (gdpdepay);
+
+  payload = create_payload (PAYLOAD_SIZE, 0);
+  packet = gst_dp_payload_buffer (payload, 0);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, packet), GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  outbuffer = buffers->data;
+  check_output (outbuffer, payload);
+  fail_unless (outbuffer->pool == NULL);
+
+  gst_buffer_map (payload, &map, GST_MAP_READ);
+  gst_buffer_map (outbuffer, &outmap, GST_MAP_READ);
+  fail_unless (outmap.data == map.data);
+  gst_buffer_unmap (outbuffer, &outmap);
+  gst_buffer_unmap (payload, &map);
+
+  gst_buffer_unref (payload);
+  gdpdepay_stop (gdpdepay);
+}
+
+GST_END_TEST;
+
+/* the payload CRC is computed piece by piece as the payload arrives */
+GST_START_TEST (test_payload_crc)
+{
+  const gsize split[] = { GST_DP_HEADER_LENGTH, 1, 1000, 7, 0 };
+  const gsize whole[] = { 0 };
+  GstBuffer *payloads[3], *packet;
+  GstElement *gdpdepay;
+  guint i;
+
+  gdpdepay = setup_gdpdepay ();
+  gdpdepay_start_stream (gdpdepay);
+
+  for (i = 0; i < G_N_ELEMENTS (payloads); i++) {
+    payloads[i] = create_payload (PAYLOAD_SIZE, i);
+    packet = gst_dp_payload_buffer (payloads[i], GST_DP_HEADER_FLAG_CRC);
+    /* a new, a pooled and a shared buffer */
+    fail_unless_equals_int (gdpdepay_push_chunks (packet,
+            i < 2 ? split : whole), GST_FLOW_OK);
+    gst_buffer_unref (packet);
+  }
+
+  fail_unless_equals_int (g_list_length (buffers), G_N_ELEMENTS (payloads));
+  for (i = 0; i < G_N_ELEMENTS (payloads); i++) {
+    check_output (g_list_nth_data (buffers, i), payloads[i]);
+    gst_buffer_unref (payloads[i]);
+  }
+
+  gdpdepay_stop (gdpdepay);
+}
+
+GST_END_TEST;
+
+/* Pushes a buffer packet with a corrupted payload byte in the pieces listed
+ * in @chunks, or as it is if @chunks is NULL, and checks that it is
+ * rejected */
+static void
+check_payload_crc_mismatch (const gsize * chunks)
+{
+  GstBuffer *payload, *packet, *corrupted;
+  GstElement *gdpdepay;
+  GstFlowReturn ret;
+
+  gdpdepay = setup_gdpdepay ();
+  gdpdepay_start_stream (gdpdepay);
+
+  payload = create_payload (PAYLOAD_SIZE, 0);
+  packet = gst_dp_payload_buffer (payload, GST_DP_HEADER_FLAG_CRC);
+  corrupted = gst_buffer_copy_deep (packet);
+  gst_buffer_memset (corrupted, GST_DP_HEADER_LENGTH + PAYLOAD_SIZE / 2,
+      0xff, 1);
+  gst_buffer_unref (packet);
+  gst_buffer_unref (payload);
+
+  if (chunks) {
+    ret = gdpdepay_push_chunks (corrupted, chunks);
+    gst_buffer_unref (corrupted);
+  } else {
+    ret = gst_pad_push (mysrcpad, corrupted);
+  }
+  fail_unless_equals_int (ret, GST_FLOW_ERROR);
+  fail_unless_equals_int (g_list_length (buffers), 0);
+
+  gdpdepay_stop (gdpdepay);
+}
+
+GST_START_TEST (test_payload_crc_mismatch)
+{
+  const gsize split[] = { GST_DP_HEADER_LENGTH, 1, 1000, 7, 0 };
+
+  check_payload_crc_mismatch (split);
+  check_payload_crc_mismatch (NULL);
+}
+
+GST_END_TEST;
+
 static Suite *
 gdpdepay_suite (void)
 {
@@ -410,6 +673,10 @@ gdpdepay_suite (void)
   tcase_add_test (tc_chain, test_audio_per_byte);
   tcase_add_test (tc_chain, test_audio_in_one_buffer);
   tcase_add_test (tc_chain, test_streamheader);
+  tcase_add_test (tc_chain, test_buffer_pool);
+  tcase_add_test (tc_chain, test_buffer_shared_memory);
+  tcase_add_test (tc_chain, test_payload_crc);
+  tcase_add_test (tc_chain, test_payload_crc_mismatch);
 
   return s;
 }
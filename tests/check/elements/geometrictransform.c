@@ -0,0 +1,270 @@
+/* GStreamer
+ *
+ * unit test for the sampling of GstGeometricTransform
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+#include <math.h>
+
+#define WIDTH 24
+#define HEIGHT 16
+
+/* The rotate element maps most output pixels between input pixels. Its
+ * output is compared with a reference computing the same mapping and
+ * sampling the input with exact weights */
+
+typedef enum
+{
+  OFF_EDGES_IGNORE,
+  OFF_EDGES_CLAMP,
+  OFF_EDGES_WRAP
+} OffEdges;
+
+static const gchar *off_edges_nicks[] = { "ignore", "clamp", "wrap" };
+
+typedef struct
+{
+  const gchar *format;
+  gboolean interpolated;        /* whether bilinear applies to the format */
+} Format;
+
+static const Format formats[] = {
+  {"RGBA", TRUE},
+  {"RGB", TRUE},
+  {"GRAY8", TRUE},
+  /* only 8 bits components are interpolated */
+  {"GRAY16_LE", FALSE},
+};
+
+/* the input position of output pixel @x,@y, as rotate computes it */
+static void
+rotate_position (gdouble angle, gint x, gint y, gdouble * in_x,
+    gdouble * in_y)
+{
+  gdouble cx = 0.5 * WIDTH, cy = 0.5 * HEIGHT;
+  gdouble xo = x - cx, yo = y - cy;
+  gdouble r = sqrt (xo * xo + yo * yo);
+  gdouble a = atan2 (yo, xo) + angle;
+  gdouble xi = r * cos (a), yi = r * sin (a);
+
+  *in_x = xi + cx;
+  *in_y = yi + cy;
+}
+
+static gdouble
+wrap_position (gdouble a, gint size)
+{
+  gint n = (gint) (a / size);
+
+  a -= n * size;
+  if (a < 0)
+    return a + size;
+  return a;
+}
+
+/* positions this close to a pixel edge may truncate to either side with
+ * another rounding of the mapping */
+static gboolean
+near_pixel_edge (gdouble v)
+{
+  return fabs (v - floor (v + 0.5)) < 1e-6;
+}
+
+/* Returns the value of byte @c of the output pixel sampled at @in_x,@in_y:
+ * the input pixel it truncates to, or the input pixels around it weighted
+ * by the exact distances. Past the last row or column, the last one is
+ * used alone */
+static gdouble
+reference_sample (const guint8 * in, gint pixel_stride, gint row_stride,
+    gboolean bilinear, gdouble in_x, gdouble in_y, gint c)
+{
+  gint x0 = (gint) in_x, y0 = (gint) in_y;
+  gint x1 = MIN (x0 + 1, WIDTH - 1), y1 = MIN (y0 + 1, HEIGHT - 1);
+  gdouble fx, fy;
+
+#define P(x,y) ((gdouble) in[(y) * row_stride + (x) * pixel_stride + c])
+
+  if (!bilinear)
+    return P (x0, y0);
+
+  fx = in_x < 0 || x0 == WIDTH - 1 ? 0 : in_x - x0;
+  fy = in_y < 0 || y0 == HEIGHT - 1 ? 0 : in_y - y0;
+
+  return (1 - fy) * ((1 - fx) * P (x0, y0) + fx * P (x1, y0)) +
+      fy * ((1 - fx) * P (x0, y1) + fx * P (x1, y1));
+
+#undef P
+}
+
+static void
+check_rotate (const Format * format, gboolean bilinear, OffEdges off_edges,
+    guint n_threads, gdouble angle)
+{
+  GstHarness *h;
+  GstVideoInfo info;
+  GstBuffer *inbuf, *outbuf;
+  GstMapInfo in_map, out_map;
+  gint pixel_stride, row_stride;
+  gint x, y, c;
+  gchar *caps;
+  gsize i;
+
+  gst_video_info_set_format (&info,
+      gst_video_format_from_string (format->format), WIDTH, HEIGHT);
+  pixel_stride = GST_VIDEO_INFO_COMP_PSTRIDE (&info, 0);
+  row_stride = GST_VIDEO_INFO_PLANE_STRIDE (&info, 0);
+
+  h = gst_harness_new ("rotate");
+  g_object_set (h->element, "angle", angle, "n-threads", n_threads, NULL);
+  gst_util_set_object_arg (G_OBJECT (h->element), "interpolation",
+      bilinear ? "bilinear" : "nearest");
+  gst_util_set_object_arg (G_OBJECT (h->element), "off-edge-pixels",
+      off_edges_nicks[off_edges]);
+
+  caps = g_strdup_printf ("video/x-raw,format=%s,width=%d,height=%d,"
+      "framerate=25/1", format->format, WIDTH, HEIGHT);
+  gst_harness_set_caps_str (h, caps, caps);
+  g_free (caps);
+
+  inbuf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+  gst_buffer_map (inbuf, &in_map, GST_MAP_WRITE);
+  for (i = 0; i < in_map.size; i++)
+    in_map.data[i] = g_random_int_range (1, 256);
+  gst_buffer_unmap (inbuf, &in_map);
+
+  outbuf = gst_harness_push_and_pull (h, gst_buffer_ref (inbuf));
+  fail_unless (outbuf != NULL);
+
+  bilinear = bilinear && format->interpolated;
+
+  gst_buffer_map (inbuf, &in_map, GST_MAP_READ);
+  gst_buffer_map (outbuf, &out_map, GST_MAP_READ);
+  fail_unless_equals_int (out_map.size, GST_VIDEO_INFO_SIZE (&info));
+
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++) {
+      const guint8 *out = out_map.data + y * row_stride + x * pixel_stride;
+      gdouble in_x, in_y;
+      gboolean inside;
+
+      rotate_position (angle, x, y, &in_x, &in_y);
+      if (near_pixel_edge (in_x) || near_pixel_edge (in_y))
+        continue;
+
+      switch (off_edges) {
+        case OFF_EDGES_CLAMP:
+          in_x = CLAMP (in_x, 0, WIDTH - 1);
+          in_y = CLAMP (in_y, 0, HEIGHT - 1);
+          break;
+        case OFF_EDGES_WRAP:
+          in_x = wrap_position (in_x, WIDTH);
+          in_y = wrap_position (in_y, HEIGHT);
+          break;
+        default:
+          break;
+      }
+
+      inside = (gint) in_x >= 0 && (gint) in_x < WIDTH && (gint) in_y >= 0
+          && (gint) in_y < HEIGHT;
+
+      for (c = 0; c < pixel_stride; c++) {
+        gdouble expected = 0;
+
+        if (inside)
+          expected = reference_sample (in_map.data, pixel_stride, row_stride,
+              bilinear, in_x, in_y, c);
+
+        /* the weights are rounded to 1/128, which is off by less than 2
+         * levels, then the result is rounded */
+        if (fabs (out[c] - expected) > (bilinear ? 2.5 : 0))
+          fail ("%s, %s, off edge pixels %s, %u threads, angle %f: byte %d "
+              "of pixel %d,%d mapped to %f,%f is %u instead of %f",
+              format->format, bilinear ? "bilinear" : "nearest",
+              off_edges_nicks[off_edges], n_threads, angle, c, x, y, in_x,
+              in_y, out[c], expected);
+      }
+    }
+  }
+
+  gst_buffer_unmap (outbuf, &out_map);
+  gst_buffer_unmap (inbuf, &in_map);
+
+  gst_buffer_unref (outbuf);
+  gst_buffer_unref (inbuf);
+  gst_harness_teardown (h);
+}
+
+static void
+check_all (gboolean bilinear, guint n_threads)
+{
+  const gdouble angles[] = { 0.3, -2.5 };
+  OffEdges off_edges;
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    for (j = 0; j < G_N_ELEMENTS (angles); j++) {
+      for (off_edges = OFF_EDGES_IGNORE; off_edges <= OFF_EDGES_WRAP;
+          off_edges++)
+        check_rotate (&formats[i], bilinear, off_edges, n_threads,
+            angles[j]);
+    }
+  }
+}
+
+GST_START_TEST (test_nearest)
+{
+  check_all (FALSE, 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bilinear)
+{
+  check_all (TRUE, 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bilinear_threaded)
+{
+  check_all (TRUE, 3);
+}
+
+GST_END_TEST;
+
+static Suite *
+geometrictransform_suite (void)
+{
+  Suite *s = suite_create ("geometrictransform");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_nearest);
+  tcase_add_test (tc_chain, test_bilinear);
+  tcase_add_test (tc_chain, test_bilinear_threaded);
+
+  return s;
+}
+
+GST_CHECK_MAIN (geometrictransform);
@@ -0,0 +1,297 @@
+/* GStreamer
+ *
+ * unit test for hlssink2 Low-Latency HLS output
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gio/gio.h>
+
+#define FPS 10
+#define GOP_FRAMES 10
+#define N_FRAMES 40
+#define FRAME_SIZE 1000
+#define PART_DURATION 200
+#define PARTS_PER_GOP (GOP_FRAMES * 1000 / FPS / PART_DURATION)
+
+/* The playlists and fragments are written to memory streams, as an HTTP
+ * server would get them */
+
+typedef struct
+{
+  guint media_sequence;
+  guint part;
+  gchar *playlist;
+} PlaylistUpdate;
+
+static GMutex lock;
+static GCond cond;
+static GPtrArray *updates;
+static GPtrArray *fragments;
+
+static void
+playlist_update_free (PlaylistUpdate * update)
+{
+  g_free (update->playlist);
+  g_free (update);
+}
+
+static GOutputStream *
+get_playlist_stream (GstElement * sink, const gchar * location)
+{
+  return g_memory_output_stream_new_resizable ();
+}
+
+static GOutputStream *
+get_fragment_stream (GstElement * sink, const gchar * location)
+{
+  GOutputStream *stream = g_memory_output_stream_new_resizable ();
+
+  g_mutex_lock (&lock);
+  g_ptr_array_add (fragments, g_object_ref (stream));
+  g_mutex_unlock (&lock);
+
+  return stream;
+}
+
+static void
+playlist_updated (GstElement * sink, guint media_sequence, guint part,
+    const gchar * playlist)
+{
+  PlaylistUpdate *update = g_new0 (PlaylistUpdate, 1);
+
+  GST_LOG ("playlist for part %u of %u:\n%s", part, media_sequence, playlist);
+
+  update->media_sequence = media_sequence;
+  update->part = part;
+  update->playlist = g_strdup (playlist);
+
+  g_mutex_lock (&lock);
+  g_ptr_array_add (updates, update);
+  g_cond_signal (&cond);
+  g_mutex_unlock (&lock);
+}
+
+/* Waits until a playlist for at least @part parts of fragment
+ * @media_sequence, or one containing @text, was written */
+static void
+wait_update (guint media_sequence, guint part, const gchar * text)
+{
+  gint64 deadline = g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND;
+
+  g_mutex_lock (&lock);
+  for (;;) {
+    PlaylistUpdate *update = NULL;
+
+    if (updates->len > 0)
+      update = g_ptr_array_index (updates, updates->len - 1);
+    if (update && (text ? strstr (update->playlist, text) != NULL :
+            (update->media_sequence > media_sequence ||
+                (update->media_sequence == media_sequence &&
+                    update->part >= part))))
+      break;
+
+    fail_unless (g_cond_wait_until (&cond, &lock, deadline),
+        "Timed out waiting for the playlist");
+  }
+  g_mutex_unlock (&lock);
+}
+
+static void
+push_frames (GstHarness * h, guint first, guint last)
+{
+  guint i;
+
+  for (i = first; i <= last; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, FRAME_SIZE, NULL);
+
+    gst_buffer_memset (buf, 0, i, FRAME_SIZE);
+    GST_BUFFER_PTS (buf) = GST_BUFFER_DTS (buf) =
+        gst_util_uint64_scale_int (i, GST_SECOND, FPS);
+    GST_BUFFER_DURATION (buf) = GST_SECOND / FPS;
+    if (i % GOP_FRAMES != 0)
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+}
+
+/* Checks that the EXT-X-PART byte ranges of @uri in @playlist cover the
+ * fragment written to @stream completely and in order. Returns the number
+ * of parts */
+static guint
+check_parts (const gchar * playlist, const gchar * uri, GOutputStream * stream)
+{
+  gchar **lines = g_strsplit (playlist, "\n", -1);
+  gchar *uri_attr = g_strdup_printf ("URI=\"%s\"", uri);
+  guint64 offset = 0;
+  guint i, n_parts = 0;
+
+  for (i = 0; lines[i]; i++) {
+    const gchar *byterange;
+    guint64 size, part_offset;
+
+    if (!g_str_has_prefix (lines[i], "#EXT-X-PART:")
+        || !strstr (lines[i], uri_attr))
+      continue;
+
+    byterange = strstr (lines[i], "BYTERANGE=\"");
+    fail_unless (byterange != NULL);
+    fail_unless_equals_int (sscanf (byterange, "BYTERANGE=\"%"
+            G_GUINT64_FORMAT "@%" G_GUINT64_FORMAT "\"", &size,
+            &part_offset), 2);
+    fail_unless_equals_uint64 (part_offset, offset);
+    fail_unless (size > 0);
+    offset += size;
+    n_parts++;
+  }
+
+  fail_unless_equals_uint64 (offset,
+      g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream)));
+
+  g_free (uri_attr);
+  g_strfreev (lines);
+
+  return n_parts;
+}
+
+GST_START_TEST (test_low_latency)
+{
+  GstHarness *h;
+  GstIterator *it;
+  GValue item = G_VALUE_INIT;
+  PlaylistUpdate *update, *last;
+  guint i, n_parts;
+
+  updates = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      playlist_update_free);
+  fragments = g_ptr_array_new_with_free_func (g_object_unref);
+
+  h = gst_harness_new_with_padnames ("hlssink2", "video", NULL);
+  g_object_set (h->element, "target-duration", 2, "part-duration",
+      PART_DURATION, NULL);
+  g_signal_connect (h->element, "get-playlist-stream",
+      G_CALLBACK (get_playlist_stream), NULL);
+  g_signal_connect (h->element, "get-fragment-stream",
+      G_CALLBACK (get_fragment_stream), NULL);
+  g_signal_connect (h->element, "playlist-updated",
+      G_CALLBACK (playlist_updated), NULL);
+
+  /* don't wait for the harness test clock to write the fragments */
+  it = gst_bin_iterate_all_by_element_factory_name (GST_BIN (h->element),
+      "giostreamsink");
+  fail_unless_equals_int (gst_iterator_next (it, &item), GST_ITERATOR_OK);
+  g_object_set (g_value_get_object (&item), "sync", FALSE, NULL);
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  gst_harness_set_src_caps_str (h, "video/x-h264,stream-format=byte-stream,"
+      "alignment=au,width=320,height=240,framerate=10/1");
+
+  /* splitmuxsink holds the first GOP back until the next one starts */
+  push_frames (h, 0, GOP_FRAMES - 1);
+  g_usleep (G_USEC_PER_SEC / 10);
+  g_mutex_lock (&lock);
+  fail_unless_equals_int (updates->len, 0);
+  g_mutex_unlock (&lock);
+
+  /* then all of its parts but the last one are written at once */
+  push_frames (h, GOP_FRAMES, GOP_FRAMES);
+  wait_update (0, PARTS_PER_GOP - 1, NULL);
+
+  g_mutex_lock (&lock);
+  last = g_ptr_array_index (updates, updates->len - 1);
+  fail_unless_equals_int (last->media_sequence, 0);
+  fail_unless (strstr (last->playlist,
+          "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,") != NULL);
+  fail_unless (strstr (last->playlist, "#EXTINF:") == NULL);
+  /* the next part continues the same fragment */
+  fail_unless (strstr (last->playlist,
+          "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"segment00000.ts\","
+          "BYTERANGE-START=") != NULL);
+  g_mutex_unlock (&lock);
+
+  push_frames (h, GOP_FRAMES + 1, N_FRAMES - 1);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+  wait_update (0, 0, "#EXT-X-ENDLIST");
+
+  g_mutex_lock (&lock);
+
+  /* a blocking reload can be answered by any later playlist */
+  for (i = 1; i < updates->len; i++) {
+    PlaylistUpdate *prev = g_ptr_array_index (updates, i - 1);
+
+    update = g_ptr_array_index (updates, i);
+    fail_unless (update->media_sequence > prev->media_sequence ||
+        (update->media_sequence == prev->media_sequence &&
+            update->part >= prev->part));
+  }
+
+  /* the first fragment is announced with a preload hint for the next one */
+  for (i = 0; i < updates->len; i++) {
+    update = g_ptr_array_index (updates, i);
+    if (update->media_sequence == 1)
+      break;
+  }
+  fail_unless (i < updates->len);
+  fail_unless_equals_int (update->part, 0);
+  fail_unless (strstr (update->playlist, "#EXTINF:") != NULL);
+  fail_unless (strstr (update->playlist,
+          "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"segment00001.ts\"\n") != NULL);
+
+  /* in the end, the parts cover both fragments */
+  fail_unless_equals_int (fragments->len, N_FRAMES / FPS / 2);
+  last = g_ptr_array_index (updates, updates->len - 1);
+  fail_unless (strstr (last->playlist, "#EXT-X-PRELOAD-HINT") == NULL);
+  n_parts = check_parts (last->playlist, "segment00000.ts",
+      g_ptr_array_index (fragments, 0));
+  fail_unless (n_parts >= 2 * PARTS_PER_GOP - 1);
+  check_parts (last->playlist, "segment00001.ts",
+      g_ptr_array_index (fragments, 1));
+
+  g_mutex_unlock (&lock);
+
+  gst_harness_teardown (h);
+  g_ptr_array_unref (fragments);
+  g_ptr_array_unref (updates);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlssink2_suite (void)
+{
+  Suite *s = suite_create ("hlssink2");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+
+  if (gst_registry_check_feature_version (gst_registry_get (), "splitmuxsink",
+          GST_VERSION_MAJOR, GST_VERSION_MINOR, 0)) {
+    tcase_add_test (tc_chain, test_low_latency);
+  } else {
+    GST_WARNING ("splitmuxsink element not available, skipping tests");
+  }
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlssink2);
@@ -0,0 +1,175 @@
+/* GStreamer
+ *
+ * unit test for the hlssink2 playlist writer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#undef GST_CAT_DEFAULT
+#include "gstm3u8playlist.h"
+#include "gstm3u8playlist.c"
+
+GST_DEBUG_CATEGORY (hls_debug);
+
+static guint
+count_occurrences (const gchar * haystack, const gchar * needle)
+{
+  guint n = 0;
+
+  while ((haystack = strstr (haystack, needle)) != NULL) {
+    haystack += strlen (needle);
+    n++;
+  }
+
+  return n;
+}
+
+GST_START_TEST (test_render_entries)
+{
+  GstM3U8Playlist *playlist;
+  gchar *s;
+
+  playlist = gst_m3u8_playlist_new (3, 2);
+  gst_m3u8_playlist_add_entry (playlist, "seg0.ts", NULL, 4 * GST_SECOND, 0,
+      FALSE);
+  gst_m3u8_playlist_add_entry (playlist, "seg1.ts", NULL, 4 * GST_SECOND, 1,
+      FALSE);
+  gst_m3u8_playlist_add_entry (playlist, "seg2.ts", NULL, 4 * GST_SECOND, 2,
+      TRUE);
+
+  s = gst_m3u8_playlist_render (playlist);
+  assert_equals_string (s, "#EXTM3U\n"
+      "#EXT-X-VERSION:3\n"
+      "#EXT-X-MEDIA-SEQUENCE:1\n"
+      "#EXT-X-TARGETDURATION:4\n"
+      "\n"
+      "#EXTINF:4,\n"
+      "seg1.ts\n"
+      "#EXT-X-DISCONTINUITY\n" "#EXTINF:4,\n" "seg2.ts\n");
+  g_free (s);
+
+  playlist->end_list = TRUE;
+  s = gst_m3u8_playlist_render (playlist);
+  fail_unless (g_str_has_suffix (s, "seg2.ts\n#EXT-X-ENDLIST"));
+  fail_if (strstr (s, "EXT-X-PART") != NULL);
+  g_free (s);
+
+  gst_m3u8_playlist_free (playlist);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_render_parts)
+{
+  GstM3U8Playlist *playlist;
+  gchar *s;
+
+  playlist = gst_m3u8_playlist_new (3, 5);
+  playlist->part_target = GST_SECOND / 2;
+  playlist->can_block_reload = TRUE;
+
+  gst_m3u8_playlist_add_part (playlist, "seg0.ts", GST_SECOND / 2, 0, 1880,
+      TRUE);
+  gst_m3u8_playlist_set_preload_hint (playlist, "seg0.ts", 1880);
+
+  s = gst_m3u8_playlist_render (playlist);
+  assert_equals_string (s, "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "#EXT-X-MEDIA-SEQUENCE:0\n"
+      "#EXT-X-TARGETDURATION:0\n"
+      "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=1.5\n"
+      "#EXT-X-PART-INF:PART-TARGET=0.5\n"
+      "\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"seg0.ts\",INDEPENDENT=YES,"
+      "BYTERANGE=\"1880@0\"\n"
+      "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg0.ts\",BYTERANGE-START=1880\n");
+  g_free (s);
+
+  /* Completing the segment moves its parts before its EXTINF */
+  gst_m3u8_playlist_add_part (playlist, "seg0.ts", GST_SECOND / 2, 1880, 376,
+      FALSE);
+  gst_m3u8_playlist_add_entry (playlist, "seg0.ts", NULL, GST_SECOND, 0,
+      FALSE);
+  gst_m3u8_playlist_set_preload_hint (playlist, "seg1.ts", 0);
+
+  s = gst_m3u8_playlist_render (playlist);
+  fail_unless (strstr (s,
+          "#EXT-X-PART:DURATION=0.5,URI=\"seg0.ts\",BYTERANGE=\"376@1880\"\n"
+          "#EXTINF:1,\nseg0.ts\n"
+          "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg1.ts\"\n") != NULL);
+  g_free (s);
+
+  /* No preload hint once the playlist is finished */
+  playlist->end_list = TRUE;
+  s = gst_m3u8_playlist_render (playlist);
+  fail_if (strstr (s, "EXT-X-PRELOAD-HINT") != NULL);
+  g_free (s);
+
+  gst_m3u8_playlist_free (playlist);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_part_ageing)
+{
+  GstM3U8Playlist *playlist;
+  gchar *name, *s;
+  guint i;
+
+  playlist = gst_m3u8_playlist_new (3, 4);
+  playlist->part_target = GST_SECOND;
+
+  for (i = 0; i < 6; i++) {
+    name = g_strdup_printf ("seg%u.ts", i);
+    gst_m3u8_playlist_add_part (playlist, name, GST_SECOND, 0, 188, TRUE);
+    gst_m3u8_playlist_add_part (playlist, name, GST_SECOND, 188, 188, FALSE);
+    gst_m3u8_playlist_add_entry (playlist, name, NULL, 2 * GST_SECOND, i,
+        FALSE);
+    g_free (name);
+  }
+
+  /* Window of 4 segments, only the last 3 of them list their parts */
+  s = gst_m3u8_playlist_render (playlist);
+  fail_unless (strstr (s, "#EXT-X-MEDIA-SEQUENCE:2\n") != NULL);
+  fail_unless_equals_int (count_occurrences (s, "#EXTINF:"), 4);
+  fail_unless_equals_int (count_occurrences (s, "#EXT-X-PART:"),
+      2 * GST_M3U8_PART_SEGMENTS);
+  fail_if (strstr (s, "URI=\"seg2.ts\"") != NULL);
+  fail_unless (strstr (s, "URI=\"seg3.ts\"") != NULL);
+  g_free (s);
+
+  gst_m3u8_playlist_free (playlist);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlssink2_m3u8_suite (void)
+{
+  Suite *s = suite_create ("hlssink2_m3u8");
+  TCase *tc0 = tcase_create ("m3u8playlist");
+
+  suite_add_tcase (s, tc0);
+  tcase_add_test (tc0, test_render_entries);
+  tcase_add_test (tc0, test_render_parts);
+  tcase_add_test (tc0, test_part_ageing);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlssink2_m3u8);
@@ -0,0 +1,231 @@
+/* GStreamer
+ *
+ * unit test for the ipcpipeline shared memory data plane
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/app/app.h>
+
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BUFFER_SIZE 4096
+#define N_SHM_BUFFERS 16
+
+/* Both pipelines live in this process: the master one pushes from an
+ * appsrc to an ipcpipelinesink with a shared memory segment holding
+ * N_SHM_BUFFERS buffers, and the slave one follows its state and pulls
+ * from an appsink. The buffers received through the shared memory are
+ * wrapped read-only, the ones received through the socket are not */
+
+static GstElement *master, *slave;
+static GstAppSrc *appsrc;
+static GstAppSink *appsink;
+static int fds[2];
+
+static void
+set_nonblock (int fd)
+{
+  fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+}
+
+static void
+setup_pipelines (void)
+{
+  GstElement *src, *sink;
+  GstCaps *caps;
+
+  fail_unless (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  set_nonblock (fds[0]);
+  set_nonblock (fds[1]);
+
+  master = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("appsrc", NULL);
+  sink = gst_element_factory_make ("ipcpipelinesink", NULL);
+  fail_unless (src != NULL && sink != NULL);
+  caps = gst_caps_new_empty_simple ("application/x-test");
+  g_object_set (src, "caps", caps, "format", GST_FORMAT_TIME, NULL);
+  gst_caps_unref (caps);
+  g_object_set (sink, "fdin", fds[0], "fdout", fds[0], "shm-size",
+      N_SHM_BUFFERS * BUFFER_SIZE, NULL);
+  gst_bin_add_many (GST_BIN (master), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+  appsrc = GST_APP_SRC (src);
+
+  slave = gst_element_factory_make ("ipcslavepipeline", NULL);
+  src = gst_element_factory_make ("ipcpipelinesrc", NULL);
+  sink = gst_element_factory_make ("appsink", NULL);
+  fail_unless (slave != NULL && src != NULL && sink != NULL);
+  g_object_set (src, "fdin", fds[1], "fdout", fds[1], NULL);
+  g_object_set (sink, "sync", FALSE, "enable-last-sample", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (slave), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+  appsink = GST_APP_SINK (sink);
+
+  fail_if (gst_element_set_state (master, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+}
+
+static void
+teardown_pipelines (void)
+{
+  gst_element_set_state (master, GST_STATE_NULL);
+  gst_element_set_state (slave, GST_STATE_NULL);
+  gst_object_unref (master);
+  gst_object_unref (slave);
+  close (fds[0]);
+  close (fds[1]);
+}
+
+static void
+push_buffer (guint n)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_new_allocate (NULL, BUFFER_SIZE, NULL);
+  gst_buffer_memset (buf, 0, n & 0xff, BUFFER_SIZE);
+  GST_BUFFER_PTS (buf) = n * GST_MSECOND;
+  fail_unless_equals_int (gst_app_src_push_buffer (appsrc, buf), GST_FLOW_OK);
+}
+
+/* Pulls the next sample, checks it carries buffer n and whether it came
+ * through the shared memory */
+static GstSample *
+pull_sample (guint n, gboolean shm)
+{
+  GstSample *sample;
+  GstBuffer *buf;
+  GstMemory *mem;
+  GstMapInfo map;
+  gsize i;
+
+  sample = gst_app_sink_try_pull_sample (appsink, 5 * GST_SECOND);
+  fail_unless (sample != NULL, "no buffer %u", n);
+  buf = gst_sample_get_buffer (sample);
+  fail_unless_equals_int (gst_buffer_get_size (buf), BUFFER_SIZE);
+
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  for (i = 0; i < map.size; i++) {
+    if (map.data[i] != (n & 0xff))
+      fail ("buffer %u: byte %" G_GSIZE_FORMAT " is %u", n, i, map.data[i]);
+  }
+  gst_buffer_unmap (buf, &map);
+
+  fail_unless_equals_int (gst_buffer_n_memory (buf), 1);
+  mem = gst_buffer_peek_memory (buf, 0);
+  fail_unless_equals_int (GST_MEMORY_IS_READONLY (mem), shm);
+
+  return sample;
+}
+
+GST_START_TEST (test_shm_transfer)
+{
+  guint i;
+
+  setup_pipelines ();
+
+  for (i = 0; i < 4 * N_SHM_BUFFERS; i++) {
+    push_buffer (i);
+    gst_sample_unref (pull_sample (i, TRUE));
+  }
+
+  teardown_pipelines ();
+}
+
+GST_END_TEST;
+
+/* a region held by the receiver must not keep the ones allocated after it
+ * from being reused */
+GST_START_TEST (test_shm_held_buffer)
+{
+  GstSample *held;
+  guint i;
+
+  setup_pipelines ();
+
+  push_buffer (0);
+  held = pull_sample (0, TRUE);
+
+  for (i = 1; i <= 200; i++) {
+    push_buffer (i);
+    gst_sample_unref (pull_sample (i, TRUE));
+  }
+
+  gst_sample_unref (held);
+  teardown_pipelines ();
+}
+
+GST_END_TEST;
+
+/* once the receiver holds the whole segment, buffers go through the socket
+ * without waiting for each of them, and through the shared memory again
+ * as soon as some of it is released */
+GST_START_TEST (test_shm_fallback)
+{
+  GstSample *held[N_SHM_BUFFERS];
+  gint64 start;
+  guint i, n = 0;
+
+  setup_pipelines ();
+
+  for (i = 0; i < N_SHM_BUFFERS; i++, n++) {
+    push_buffer (n);
+    held[i] = pull_sample (n, TRUE);
+  }
+
+  push_buffer (n);
+  gst_sample_unref (pull_sample (n++, FALSE));
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < 10; i++, n++) {
+    push_buffer (n);
+    gst_sample_unref (pull_sample (n, FALSE));
+  }
+  fail_unless (g_get_monotonic_time () - start < G_TIME_SPAN_SECOND / 2);
+
+  for (i = 0; i < N_SHM_BUFFERS; i++)
+    gst_sample_unref (held[i]);
+
+  push_buffer (n);
+  gst_sample_unref (pull_sample (n, TRUE));
+
+  teardown_pipelines ();
+}
+
+GST_END_TEST;
+
+static Suite *
+ipcpipelineshm_suite (void)
+{
+  Suite *s = suite_create ("ipcpipelineshm");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_shm_transfer);
+  tcase_add_test (tc_chain, test_shm_held_buffer);
+  tcase_add_test (tc_chain, test_shm_fallback);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ipcpipelineshm);
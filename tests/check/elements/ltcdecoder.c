@@ -0,0 +1,180 @@
+/* GStreamer
+ *
+ * unit test for the built-in LTC decoder of timecodestamper
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#include "../../../gst/timecode/gstltcdecoder.c"
+
+#define RATE 48000
+#define LEAD_IN 777
+#define N_FRAMES 50
+
+/* Fills @bits with the 80 bits of the LTC frame @index frames after
+ * 10:00:00:00, at @fps frames per second */
+static void
+ltc_frame_bits (guint index, guint fps, guint8 bits[80])
+{
+  static const guint8 sync[16] = {
+    0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1
+  };
+  guint frames = index % fps;
+  guint seconds = (index / fps) % 60;
+  guint minutes = (index / fps / 60) % 60;
+  guint values[8] = {
+    frames % 10, frames / 10, seconds % 10, seconds / 10,
+    minutes % 10, minutes / 10, 0, 1
+  };
+  guint i, j;
+
+  memset (bits, 0, 80);
+  for (i = 0; i < 8; i++) {
+    for (j = 0; j < 4; j++)
+      bits[i * 8 + j] = (values[i] >> j) & 1;
+  }
+  memcpy (bits + 64, sync, 16);
+}
+
+/* Generates @n_channels channels of S16LE noise, with LTC on
+ * @ltc_channel */
+static gint16 *
+generate_ltc (guint fps, guint n_channels, guint ltc_channel, guint * n_samples)
+{
+  guint samples_per_frame = RATE / fps;
+  guint samples_per_bit = samples_per_frame / 80;
+  gint16 *samples;
+  gint level = 1;
+  guint i, c, f, b, k;
+
+  *n_samples = LEAD_IN + N_FRAMES * samples_per_frame + 500;
+  samples = g_new0 (gint16, *n_samples * n_channels);
+
+  for (i = 0; i < *n_samples; i++) {
+    for (c = 0; c < n_channels; c++)
+      samples[i * n_channels + c] = g_random_int_range (-100, 100);
+  }
+
+  for (f = 0; f < N_FRAMES; f++) {
+    guint8 bits[80];
+
+    ltc_frame_bits (f, fps, bits);
+    for (b = 0; b < 80; b++) {
+      guint start = LEAD_IN + f * samples_per_frame + b * samples_per_bit;
+
+      level = -level;
+      for (k = 0; k < samples_per_bit; k++) {
+        if (bits[b] && k == samples_per_bit / 2)
+          level = -level;
+        samples[(start + k) * n_channels + ltc_channel] =
+            level * 6000 + g_random_int_range (-100, 100);
+      }
+    }
+  }
+
+  return samples;
+}
+
+static void
+check_decode (guint fps, guint n_channels, guint ltc_channel, gint channel)
+{
+  GstLtcDecoder *dec;
+  GstLtcDecoderFrame frame;
+  guint samples_per_frame = RATE / fps;
+  guint n_samples, offset = 0, n_decoded = 0;
+  gint16 *samples;
+
+  samples = generate_ltc (fps, n_channels, ltc_channel, &n_samples);
+
+  dec = gst_ltc_decoder_new (GST_AUDIO_FORMAT_S16LE, RATE, n_channels);
+  gst_ltc_decoder_set_channel (dec, channel);
+
+  /* write in buffers of random sizes, to cross block boundaries anywhere */
+  while (offset < n_samples) {
+    guint n = MIN (g_random_int_range (1, 1000), n_samples - offset);
+
+    gst_ltc_decoder_write (dec, (const guint8 *) (samples + offset *
+            n_channels), n, offset);
+    offset += n;
+
+    while (gst_ltc_decoder_read (dec, &frame)) {
+      guint index = (frame.offset - LEAD_IN) / samples_per_frame;
+
+      fail_unless_equals_uint64 (frame.offset,
+          LEAD_IN + index * samples_per_frame);
+      fail_unless_equals_int (frame.channel, ltc_channel);
+      fail_unless_equals_int (frame.hours, 10);
+      fail_unless_equals_int (frame.minutes, 0);
+      fail_unless_equals_int (frame.seconds, index / fps);
+      fail_unless_equals_int (frame.frames, index % fps);
+      fail_if (frame.drop_frame);
+      n_decoded++;
+    }
+  }
+
+  /* the first frames are needed to lock on the bit period */
+  GST_INFO ("decoded %u of %u frames", n_decoded, N_FRAMES);
+  fail_unless (n_decoded >= N_FRAMES - 4);
+  fail_unless_equals_int (gst_ltc_decoder_get_channel (dec), ltc_channel);
+
+  gst_ltc_decoder_free (dec);
+  g_free (samples);
+}
+
+GST_START_TEST (test_decode_mono)
+{
+  check_decode (25, 1, 0, -1);
+  check_decode (30, 1, 0, -1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_decode_detect_channel)
+{
+  check_decode (25, 32, 17, -1);
+  check_decode (30, 8, 5, -1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_decode_fixed_channel)
+{
+  check_decode (25, 4, 2, 2);
+}
+
+GST_END_TEST;
+
+static Suite *
+ltcdecoder_suite (void)
+{
+  Suite *s = suite_create ("ltcdecoder");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_decode_mono);
+  tcase_add_test (tc_chain, test_decode_detect_channel);
+  tcase_add_test (tc_chain, test_decode_fixed_channel);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ltcdecoder);
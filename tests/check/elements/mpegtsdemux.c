@@ -21,6 +21,7 @@
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstharness.h>
+#include <gst/mpegts/mpegts.h>
 
 #define PACKETSIZE 188
 
@@ -335,6 +336,130 @@ GST_START_TEST (test_tsparse_padding)
 
 GST_END_TEST;
 
+/* A TS packet on the SDT PID carrying a one service SDT section */
+static GstBuffer *
+make_sdt_packet (guint8 continuity_counter, guint8 version_number)
+{
+  guint8 *data = g_malloc (PACKETSIZE);
+  guint8 *section = data + 5;
+  guint32 crc;
+
+  memset (data, 0xff, PACKETSIZE);
+  data[0] = 0x47;
+  data[1] = 0x40;
+  data[2] = 0x11;
+  data[3] = 0x10 | (continuity_counter & 0x0f);
+  data[4] = 0x00;
+
+  section[0] = GST_MTS_TABLE_ID_SERVICE_DESCRIPTION_ACTUAL_TS;
+  section[1] = 0xf0;
+  section[2] = 17;
+  GST_WRITE_UINT16_BE (section + 3, 1);
+  section[5] = 0xc1 | (version_number << 1);
+  section[6] = 0;
+  section[7] = 0;
+  GST_WRITE_UINT16_BE (section + 8, 1);
+  section[10] = 0xff;
+  GST_WRITE_UINT16_BE (section + 11, 1);
+  section[13] = 0xfc;
+  section[14] = 0x80;
+  section[15] = 0x00;
+  crc = gst_mpegts_calc_crc32 (section, 16);
+  GST_WRITE_UINT32_BE (section + 16, crc);
+
+  return gst_buffer_new_wrapped (data, PACKETSIZE);
+}
+
+static guint
+count_sdt_messages (GstBus * bus)
+{
+  GstMessage *msg;
+  guint n_sdt = 0;
+
+  while ((msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT))) {
+    GstMpegtsSection *section = gst_message_parse_mpegts_section (msg);
+
+    if (section) {
+      if (GST_MPEGTS_SECTION_TYPE (section) == GST_MPEGTS_SECTION_SDT)
+        n_sdt++;
+      gst_mpegts_section_unref (section);
+    }
+    gst_message_unref (msg);
+  }
+
+  return n_sdt;
+}
+
+static void
+check_section_stats (GstElement * element, guint64 hits, guint64 misses)
+{
+  GstStructure *stats;
+  guint64 value;
+
+  g_object_get (element, "section-stats", &stats, NULL);
+  fail_unless (stats != NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "cache-hits", &value));
+  fail_unless_equals_uint64 (value, hits);
+  fail_unless (gst_structure_get_uint64 (stats, "cache-misses", &value));
+  fail_unless_equals_uint64 (value, misses);
+  gst_structure_free (stats);
+}
+
+/* By default, every repetition of a section is posted */
+GST_START_TEST (test_tsparse_repeated_section)
+{
+  GstHarness *h = gst_harness_new ("tsparse");
+  GstBus *bus = gst_bus_new ();
+
+  gst_mpegts_initialize ();
+  gst_element_set_bus (h->element, bus);
+  gst_harness_set_src_caps_str (h, "video/mpegts,systemstream=true");
+
+  fail_unless (gst_harness_push (h, make_sdt_packet (0, 0)) == GST_FLOW_OK);
+  fail_unless (gst_harness_push (h, make_sdt_packet (1, 0)) == GST_FLOW_OK);
+  fail_unless (gst_harness_push (h, make_sdt_packet (2, 0)) == GST_FLOW_OK);
+  fail_unless_equals_int (count_sdt_messages (bus), 3);
+  check_section_stats (h->element, 0, 0);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_tsparse_drop_repeated_section)
+{
+  GstHarness *h = gst_harness_new ("tsparse");
+  GstBus *bus = gst_bus_new ();
+
+  gst_mpegts_initialize ();
+  g_object_set (h->element, "drop-repeated-sections", TRUE, NULL);
+  gst_element_set_bus (h->element, bus);
+  gst_harness_set_src_caps_str (h, "video/mpegts,systemstream=true");
+
+  fail_unless (gst_harness_push (h, make_sdt_packet (0, 0)) == GST_FLOW_OK);
+  fail_unless_equals_int (count_sdt_messages (bus), 1);
+  check_section_stats (h->element, 0, 1);
+
+  /* identical repetitions are dropped before being parsed or posted */
+  fail_unless (gst_harness_push (h, make_sdt_packet (1, 0)) == GST_FLOW_OK);
+  fail_unless (gst_harness_push (h, make_sdt_packet (2, 0)) == GST_FLOW_OK);
+  fail_unless_equals_int (count_sdt_messages (bus), 0);
+  check_section_stats (h->element, 2, 1);
+
+  /* a new version is output again */
+  fail_unless (gst_harness_push (h, make_sdt_packet (3, 1)) == GST_FLOW_OK);
+  fail_unless_equals_int (count_sdt_messages (bus), 1);
+  check_section_stats (h->element, 2, 2);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static void
 tsdemux_simple_pad_added (GstElement * tsdemux, GstPad * pad, GstHarness * h)
 {
@@ -377,6 +502,131 @@ GST_START_TEST (test_tsdemux_simple)
 
 GST_END_TEST;
 
+#define H264_FRAMES 3
+#define H264_FRAME_SIZE 20000
+
+/* Muxes H264_FRAMES access units, each spanning over a hundred TS packets */
+static GstBuffer *
+mux_h264 (void)
+{
+  GstHarness *h = gst_harness_new_with_padnames ("mpegtsmux", "sink_%d",
+      "src");
+  GstBuffer *ts;
+  guint i, j;
+
+  gst_harness_set_src_caps_str (h,
+      "video/x-h264,stream-format=byte-stream,alignment=au");
+
+  for (i = 0; i < H264_FRAMES; i++) {
+    static const guint8 start[] = { 0, 0, 0, 1, 0x09, 0xf0, 0, 0, 0, 1, 0x65 };
+    GstBuffer *frame = gst_buffer_new_allocate (NULL, H264_FRAME_SIZE, NULL);
+    GstMapInfo map;
+
+    gst_buffer_map (frame, &map, GST_MAP_WRITE);
+    memcpy (map.data, start, sizeof (start));
+    for (j = sizeof (start); j < map.size; j++)
+      map.data[j] = g_random_int_range (1, 256);
+    gst_buffer_unmap (frame, &map);
+
+    GST_BUFFER_PTS (frame) = GST_BUFFER_DTS (frame) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (frame) = 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_harness_push (h, frame), GST_FLOW_OK);
+  }
+  gst_harness_push_event (h, gst_event_new_eos ());
+
+  ts = gst_harness_take_all_data_as_buffer (h);
+  gst_harness_teardown (h);
+
+  return ts;
+}
+
+static void
+tsdemux_add_pad (GstElement * tsdemux, GstPad * pad, GstHarness * h)
+{
+  gst_harness_add_element_src_pad (h, pad);
+}
+
+/* Demuxes @ts in buffers of 7 packets, like received over UDP */
+static GstBuffer *
+demux_h264 (GstBuffer * ts, gboolean zero_copy, guint * n_buffers,
+    GstStructure ** stats)
+{
+  GstElement *tsdemux;
+  GstHarness *h;
+  GstBuffer *out;
+  GstSegment segment;
+  gsize offset, size = gst_buffer_get_size (ts);
+
+  tsdemux = gst_element_factory_make ("tsdemux", NULL);
+  g_object_set (tsdemux, "zero-copy", zero_copy, NULL);
+  h = gst_harness_new_with_element (tsdemux, "sink", NULL);
+  gst_object_unref (tsdemux);
+
+  gst_harness_set_src_caps_str (h, "video/mpegts,systemstream=true");
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_harness_push_event (h, gst_event_new_segment (&segment));
+  gst_harness_set_sink_caps_str (h, "video/x-h264");
+  g_signal_connect (h->element, "pad-added", G_CALLBACK (tsdemux_add_pad), h);
+
+  for (offset = 0; offset < size; offset += 7 * PACKETSIZE) {
+    GstBuffer *buf = gst_buffer_copy_region (ts, GST_BUFFER_COPY_ALL, offset,
+        MIN (7 * PACKETSIZE, size - offset));
+
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  gst_harness_push_event (h, gst_event_new_eos ());
+
+  *n_buffers = gst_harness_buffers_in_queue (h);
+  out = gst_harness_take_all_data_as_buffer (h);
+  g_object_get (h->element, "stats", stats, NULL);
+  gst_harness_teardown (h);
+
+  return out;
+}
+
+GST_START_TEST (test_tsdemux_zero_copy)
+{
+  GstBuffer *ts, *copied, *shared;
+  GstStructure *copy_stats, *zero_copy_stats;
+  guint n_copied, n_shared;
+  guint64 bytes;
+  GstMapInfo map;
+
+  ts = mux_h264 ();
+  copied = demux_h264 (ts, FALSE, &n_copied, &copy_stats);
+  shared = demux_h264 (ts, TRUE, &n_shared, &zero_copy_stats);
+
+  /* the same data, with each PES split in buffers of at most
+   * gst_buffer_get_max_memory() packet payloads instead of copied */
+  fail_unless (gst_buffer_get_size (copied) >= H264_FRAMES * H264_FRAME_SIZE);
+  gst_buffer_map (copied, &map, GST_MAP_READ);
+  gst_check_buffer_data (shared, map.data, map.size);
+  gst_buffer_unmap (copied, &map);
+
+  fail_unless_equals_int (n_copied, H264_FRAMES);
+  fail_unless (n_shared > n_copied);
+
+  fail_unless (gst_structure_get_uint64 (copy_stats, "bytes-shared", &bytes));
+  fail_unless_equals_uint64 (bytes, 0);
+  fail_unless (gst_structure_get_uint64 (zero_copy_stats, "bytes-copied",
+          &bytes));
+  fail_unless_equals_uint64 (bytes, 0);
+  fail_unless (gst_structure_get_uint64 (zero_copy_stats, "bytes-shared",
+          &bytes));
+  fail_unless_equals_uint64 (bytes, gst_buffer_get_size (shared));
+  fail_unless (gst_structure_get_uint64 (zero_copy_stats, "pes-flattened",
+          &bytes));
+  fail_unless_equals_uint64 (bytes, 0);
+
+  gst_structure_free (copy_stats);
+  gst_structure_free (zero_copy_stats);
+  gst_buffer_unref (copied);
+  gst_buffer_unref (shared);
+  gst_buffer_unref (ts);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsdemux_suite (void)
 {
@@ -390,10 +640,13 @@ mpegtsdemux_suite (void)
   tcase_add_test (tc, test_tsparse_align_fuse);
   tcase_add_test (tc, test_tsparse_align_split);
   tcase_add_test (tc, test_tsparse_padding);
+  tcase_add_test (tc, test_tsparse_repeated_section);
+  tcase_add_test (tc, test_tsparse_drop_repeated_section);
 
   tc = tcase_create ("tsdemux");
   suite_add_tcase (s, tc);
   tcase_add_test (tc, test_tsdemux_simple);
+  tcase_add_test (tc, test_tsdemux_zero_copy);
 
   return s;
 }
@@ -0,0 +1,310 @@
+/* GStreamer
+ *
+ * unit test for the proxysrc queue counters
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define MAX_SIZE_BUFFERS 2
+
+/* The buffers pushed to proxysink are held back by a blocking probe on the
+ * proxysrc source pad, so that the first one is in flight between the queue
+ * and downstream, and the next ones fill the queue */
+
+static GstHarness *hsink, *hsrc;
+static gulong probe_id;
+static GMutex lock;
+static GCond cond;
+static gboolean blocked;
+
+static GstPadProbeReturn
+block_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  g_mutex_lock (&lock);
+  blocked = TRUE;
+  g_cond_signal (&cond);
+  g_mutex_unlock (&lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+setup_proxy (gint leaky)
+{
+  GstPad *srcpad;
+
+  hsink = gst_harness_new ("proxysink");
+  hsrc = gst_harness_new_with_padnames ("proxysrc", NULL, "src");
+  g_object_set (hsrc->element, "proxysink", hsink->element,
+      "max-size-buffers", MAX_SIZE_BUFFERS, "max-size-bytes", 0,
+      "max-size-time", (guint64) 0, "leaky", leaky, NULL);
+
+  blocked = FALSE;
+  srcpad = gst_element_get_static_pad (hsrc->element, "src");
+  probe_id = gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BLOCK |
+      GST_PAD_PROBE_TYPE_BUFFER, block_probe, NULL, NULL);
+  gst_object_unref (srcpad);
+
+  gst_harness_set_src_caps_str (hsink, "application/x-test");
+}
+
+static void
+unblock (void)
+{
+  GstPad *srcpad;
+
+  srcpad = gst_element_get_static_pad (hsrc->element, "src");
+  gst_pad_remove_probe (srcpad, probe_id);
+  gst_object_unref (srcpad);
+}
+
+static void
+teardown_proxy (void)
+{
+  gst_harness_teardown (hsink);
+  gst_harness_teardown (hsrc);
+}
+
+static void
+push_buffer (guint n)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, 4, NULL);
+
+  GST_BUFFER_OFFSET (buf) = n;
+  fail_unless_equals_int (gst_harness_push (hsink, buf), GST_FLOW_OK);
+}
+
+/* Pushes a list of @len buffers, numbered from @first */
+static void
+push_buffer_list (guint first, guint len)
+{
+  GstBufferList *list = gst_buffer_list_new ();
+  guint i;
+
+  for (i = 0; i < len; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, 4, NULL);
+
+    GST_BUFFER_OFFSET (buf) = first + i;
+    gst_buffer_list_add (list, buf);
+  }
+  fail_unless_equals_int (gst_pad_push_list (hsink->srcpad, list),
+      GST_FLOW_OK);
+}
+
+static void
+wait_blocked (void)
+{
+  g_mutex_lock (&lock);
+  while (!blocked)
+    g_cond_wait (&cond, &lock);
+  g_mutex_unlock (&lock);
+}
+
+static void
+check_counters (guint level, guint64 dropped)
+{
+  guint current_level;
+  guint64 current_dropped;
+
+  g_object_get (hsrc->element, "current-level-buffers", &current_level,
+      "dropped", &current_dropped, NULL);
+  fail_unless_equals_int (current_level, level);
+  fail_unless_equals_uint64 (current_dropped, dropped);
+}
+
+static void
+check_pull (guint n)
+{
+  GstBuffer *buf = gst_harness_pull (hsrc);
+
+  fail_unless (buf != NULL);
+  fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buf), n);
+  gst_buffer_unref (buf);
+}
+
+static void
+check_leaky (gint leaky)
+{
+  guint i;
+
+  setup_proxy (leaky);
+
+  /* the buffer in flight is not dropped */
+  push_buffer (0);
+  wait_blocked ();
+  check_counters (0, 0);
+
+  for (i = 1; i <= MAX_SIZE_BUFFERS; i++)
+    push_buffer (i);
+  check_counters (MAX_SIZE_BUFFERS, 0);
+
+  /* each buffer pushed to the full queue drops one */
+  for (i = 0; i < 3; i++)
+    push_buffer (MAX_SIZE_BUFFERS + 1 + i);
+  check_counters (MAX_SIZE_BUFFERS, 3);
+
+  unblock ();
+  check_pull (0);
+  if (leaky == 1) {
+    /* the new buffers were dropped */
+    check_pull (1);
+    check_pull (2);
+  } else {
+    /* the old buffers were dropped */
+    check_pull (4);
+    check_pull (5);
+  }
+  check_counters (0, 3);
+
+  /* flushing does not count as dropping */
+  push_buffer (6);
+  fail_unless (gst_harness_push_event (hsink, gst_event_new_flush_start ()));
+  fail_unless (gst_harness_push_event (hsink,
+          gst_event_new_flush_stop (TRUE)));
+  check_counters (0, 3);
+
+  teardown_proxy ();
+}
+
+GST_START_TEST (test_leaky_upstream)
+{
+  check_leaky (1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_leaky_downstream)
+{
+  check_leaky (2);
+}
+
+GST_END_TEST;
+
+/* The queue drops whole lists, and can drop several of them for one
+ * overrun */
+static void
+check_leaky_buffer_lists (gint leaky)
+{
+  setup_proxy (leaky);
+
+  push_buffer (0);
+  wait_blocked ();
+
+  push_buffer_list (1, MAX_SIZE_BUFFERS);
+  check_counters (MAX_SIZE_BUFFERS, 0);
+
+  /* leaky upstream drops this list, leaky downstream the queued one */
+  push_buffer_list (MAX_SIZE_BUFFERS + 1, 3);
+  if (leaky == 1)
+    check_counters (MAX_SIZE_BUFFERS, 3);
+  else
+    check_counters (3, MAX_SIZE_BUFFERS);
+
+  /* a single buffer drops the whole list queued before it */
+  push_buffer (MAX_SIZE_BUFFERS + 4);
+  if (leaky == 1)
+    check_counters (MAX_SIZE_BUFFERS, 4);
+  else
+    check_counters (1, MAX_SIZE_BUFFERS + 3);
+
+  unblock ();
+  check_pull (0);
+  if (leaky == 1) {
+    check_pull (1);
+    check_pull (2);
+  } else {
+    check_pull (MAX_SIZE_BUFFERS + 4);
+  }
+  check_counters (0, leaky == 1 ? 4 : MAX_SIZE_BUFFERS + 3);
+
+  teardown_proxy ();
+}
+
+GST_START_TEST (test_leaky_upstream_buffer_lists)
+{
+  check_leaky_buffer_lists (1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_leaky_downstream_buffer_lists)
+{
+  check_leaky_buffer_lists (2);
+}
+
+GST_END_TEST;
+
+static gpointer
+push_thread (gpointer data)
+{
+  push_buffer (GPOINTER_TO_UINT (data));
+  return NULL;
+}
+
+GST_START_TEST (test_blocking)
+{
+  GThread *thread;
+  guint i;
+
+  setup_proxy (0);
+
+  push_buffer (0);
+  wait_blocked ();
+  for (i = 1; i <= MAX_SIZE_BUFFERS; i++)
+    push_buffer (i);
+  check_counters (MAX_SIZE_BUFFERS, 0);
+
+  /* the next push waits for space instead of dropping */
+  thread = g_thread_new ("push", push_thread,
+      GUINT_TO_POINTER (MAX_SIZE_BUFFERS + 1));
+  g_usleep (G_USEC_PER_SEC / 10);
+  check_counters (MAX_SIZE_BUFFERS, 0);
+
+  unblock ();
+  g_thread_join (thread);
+  for (i = 0; i <= MAX_SIZE_BUFFERS + 1; i++)
+    check_pull (i);
+  check_counters (0, 0);
+
+  teardown_proxy ();
+}
+
+GST_END_TEST;
+
+static Suite *
+proxysrc_suite (void)
+{
+  Suite *s = suite_create ("proxysrc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_leaky_upstream);
+  tcase_add_test (tc_chain, test_leaky_downstream);
+  tcase_add_test (tc_chain, test_leaky_upstream_buffer_lists);
+  tcase_add_test (tc_chain, test_leaky_downstream_buffer_lists);
+  tcase_add_test (tc_chain, test_blocking);
+
+  return s;
+}
+
+GST_CHECK_MAIN (proxysrc);
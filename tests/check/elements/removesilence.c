@@ -0,0 +1,192 @@
+/* GStreamer
+ *
+ * unit test for removesilence
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/audio.h>
+#include <math.h>
+
+#define RATE 8000
+#define BUFFER_SAMPLES 800
+#define BUFFER_DURATION (GST_SECOND * BUFFER_SAMPLES / RATE)
+#define MAX_CHANNELS 2
+
+/* Fills channel @c of @data with a buffer of:
+ * - 'V': voice, a 200Hz tone well above the threshold, with few zero
+ *   crossings
+ * - 'I': the same tone inverted
+ * - 'S': silence, low level noise */
+static void
+fill_channel (gint16 * data, gint channels, gint c, gchar kind, guint index)
+{
+  guint i;
+
+  for (i = 0; i < BUFFER_SAMPLES; i++) {
+    gdouble t = (gdouble) (index * BUFFER_SAMPLES + i) / RATE;
+    gint16 v;
+
+    switch (kind) {
+      case 'V':
+        v = 8000 * sin (2 * G_PI * 200 * t);
+        break;
+      case 'I':
+        v = -8000 * sin (2 * G_PI * 200 * t);
+        break;
+      case 'S':
+        v = g_random_int_range (-2, 3);
+        break;
+      default:
+        g_assert_not_reached ();
+    }
+    data[i * channels + c] = v;
+  }
+}
+
+/* Pushes a buffer for each character of the patterns, one per channel, to
+ * removesilence with remove=true and returns which of them went through as
+ * 'V' or were removed as 'S'. Checks that the messages announce each
+ * transition at the timestamp of its first buffer */
+static gchar *
+run_removesilence (gint channels, const gchar * patterns[MAX_CHANNELS])
+{
+  guint n_buffers = strlen (patterns[0]);
+  gchar *result = g_malloc0 (n_buffers + 1);
+  gchar *caps;
+  GstHarness *h;
+  GstMessage *msg;
+  GstBus *bus;
+  guint i;
+  gint c;
+
+  h = gst_harness_new ("removesilence");
+  g_object_set (h->element, "remove", TRUE, "silent", FALSE, NULL);
+  bus = gst_bus_new ();
+  gst_element_set_bus (h->element, bus);
+
+  caps = g_strdup_printf ("audio/x-raw,format=%s,layout=interleaved,"
+      "rate=%d,channels=%d", GST_AUDIO_NE (S16), RATE, channels);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  for (i = 0; i < n_buffers; i++) {
+    GstBuffer *buf, *out;
+    GstMapInfo map;
+
+    buf = gst_buffer_new_allocate (NULL,
+        BUFFER_SAMPLES * channels * sizeof (gint16), NULL);
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    for (c = 0; c < channels; c++)
+      fill_channel ((gint16 *) map.data, channels, c, patterns[c][i], i);
+    gst_buffer_unmap (buf, &map);
+    GST_BUFFER_PTS (buf) = i * BUFFER_DURATION;
+    GST_BUFFER_DURATION (buf) = BUFFER_DURATION;
+
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+    out = gst_harness_try_pull (h);
+    result[i] = out ? 'V' : 'S';
+    if (out)
+      gst_buffer_unref (out);
+  }
+
+  /* silence is announced even at the start */
+  for (i = 0; i < n_buffers; i++) {
+    const GstStructure *s;
+    const gchar *field;
+    guint64 pts;
+
+    if (result[i] == (i > 0 ? result[i - 1] : 'V'))
+      continue;
+
+    msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+    fail_unless (msg != NULL, "no message for buffer %u", i);
+    s = gst_message_get_structure (msg);
+    fail_unless (gst_structure_has_name (s, "removesilence"));
+    field = result[i] == 'S' ? "silence_detected" : "silence_finished";
+    fail_unless (gst_structure_get_uint64 (s, field, &pts),
+        "no %s for buffer %u", field, i);
+    fail_unless_equals_uint64 (pts, i * BUFFER_DURATION);
+    gst_message_unref (msg);
+  }
+  fail_unless (gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT) == NULL);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+
+  return result;
+}
+
+static void
+check_removesilence (gint channels, const gchar * left, const gchar * right,
+    const gchar * expected)
+{
+  const gchar *patterns[MAX_CHANNELS] = { left, right };
+  gchar *result;
+
+  result = run_removesilence (channels, patterns);
+  fail_unless_equals_string (result, expected);
+  g_free (result);
+}
+
+GST_START_TEST (test_mono)
+{
+  check_removesilence (1, "VVVVSSSSVVVV", NULL, "VVVVSSSSVVVV");
+  check_removesilence (1, "SSSVVVSSSSVS", NULL, "SSSVVVSSSSVS");
+}
+
+GST_END_TEST;
+
+/* a frame is voice if any of its channels is */
+GST_START_TEST (test_stereo)
+{
+  check_removesilence (2, "VVVVSSSSSSSS", "SSSSSSSSVVVV", "VVVVSSSSVVVV");
+  check_removesilence (2, "VVSSSSSSVVVV", "VVVVSSSSSSVV", "VVVVSSSSVVVV");
+  check_removesilence (2, "SSSSSSSSSSSS", "SSSSSSSSSSSS", "SSSSSSSSSSSS");
+}
+
+GST_END_TEST;
+
+/* the channels are not downmixed, where opposite signals would cancel */
+GST_START_TEST (test_stereo_opposite_phase)
+{
+  check_removesilence (2, "SSVVVVSS", "SSIIIISS", "SSVVVVSS");
+}
+
+GST_END_TEST;
+
+static Suite *
+removesilence_suite (void)
+{
+  Suite *s = suite_create ("removesilence");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_mono);
+  tcase_add_test (tc_chain, test_stereo);
+  tcase_add_test (tc_chain, test_stereo_opposite_phase);
+
+  return s;
+}
+
+GST_CHECK_MAIN (removesilence);
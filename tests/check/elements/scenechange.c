@@ -0,0 +1,178 @@
+/* GStreamer
+ *
+ * unit test for scenechange
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+#define WIDTH 160
+#define HEIGHT 120
+#define N_FRAMES 48
+#define SCENE_FRAMES 12
+
+static guint8
+hash (guint a, guint b, guint c)
+{
+  guint32 v = (a * 73856093u) ^ (b * 19349663u) ^ (c * 83492791u);
+
+  return (v * 2654435761u) >> 24;
+}
+
+/* A scene is a grid of 32x32 cells of random luma spanning @contrast, with
+ * a texture of 4x4 blocks and some noise on top, panned horizontally by
+ * @offset pixels */
+static GstBuffer *
+create_frame (guint scene, guint offset, guint contrast)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint x, y;
+
+  buf = gst_buffer_new_allocate (NULL, WIDTH * HEIGHT * 3 / 2, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++) {
+      guint px = x + offset;
+      gint cell = hash (px / 32, y / 32, scene) * contrast / 256;
+      gint texture = hash (px / 4, y / 4, scene + 1000) % 41 - 20;
+      gint noise = g_random_int_range (-3, 4);
+
+      map.data[y * WIDTH + x] =
+          CLAMP (128 - (gint) contrast / 2 + cell + texture + noise, 0, 255);
+    }
+  }
+  memset (map.data + WIDTH * HEIGHT, 128, WIDTH * HEIGHT / 2);
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+/* Pushes N_FRAMES frames, starting a new scene every SCENE_FRAMES frames if
+ * @cuts is set, and returns the frames the element detected a change at as
+ * a bitmask */
+static guint64
+run_scenechange (const gchar * mode, gboolean cuts, guint speed,
+    guint contrast)
+{
+  GstHarness *h;
+  guint64 changes = 0;
+  guint i;
+
+  h = gst_harness_new_parse ("scenechange add-meta=true");
+  gst_util_set_object_arg (G_OBJECT (h->element), "mode", mode);
+  gst_harness_set_src_caps_str (h, "video/x-raw,format=I420,width=160,"
+      "height=120,framerate=25/1");
+
+  for (i = 0; i < N_FRAMES; i++) {
+    guint scene = cuts ? 1 + 2 * (i / SCENE_FRAMES) : 1;
+    guint offset = (cuts ? i % SCENE_FRAMES : i) * speed;
+    GstBuffer *buf = create_frame (scene, offset, contrast);
+    GstCustomMeta *meta;
+    gboolean change;
+
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale_int (i, GST_SECOND, 25);
+    GST_BUFFER_DURATION (buf) = GST_SECOND / 25;
+    buf = gst_harness_push_and_pull (h, buf);
+    fail_unless (buf != NULL);
+
+    meta = gst_buffer_get_custom_meta (buf, "GstSceneChangeMeta");
+    if (i == 0) {
+      fail_unless (meta == NULL);
+    } else {
+      GstStructure *s;
+      gdouble score, hist_dist;
+
+      fail_unless (meta != NULL);
+      s = gst_custom_meta_get_structure (meta);
+      fail_unless (gst_structure_get_boolean (s, "scene-change", &change));
+      fail_unless (gst_structure_get_double (s, "score", &score));
+      fail_unless_equals_int (gst_structure_get_double (s,
+              "histogram-distance", &hist_dist), g_str_equal (mode, "fast"));
+      GST_LOG ("%s frame %u: score %g, changed %d", mode, i, score, change);
+      if (change)
+        changes |= G_GUINT64_CONSTANT (1) << i;
+    }
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+
+  return changes;
+}
+
+#define CUTS ((G_GUINT64_CONSTANT (1) << SCENE_FRAMES) | \
+    (G_GUINT64_CONSTANT (1) << (2 * SCENE_FRAMES)) | \
+    (G_GUINT64_CONSTANT (1) << (3 * SCENE_FRAMES)))
+
+GST_START_TEST (test_static_content)
+{
+  fail_unless_equals_uint64 (run_scenechange ("full", FALSE, 0, 128), 0);
+  fail_unless_equals_uint64 (run_scenechange ("fast", FALSE, 0, 128), 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pan)
+{
+  fail_unless_equals_uint64 (run_scenechange ("full", FALSE, 1, 96), 0);
+  fail_unless_equals_uint64 (run_scenechange ("fast", FALSE, 1, 96), 0);
+  fail_unless_equals_uint64 (run_scenechange ("full", FALSE, 10, 128), 0);
+  fail_unless_equals_uint64 (run_scenechange ("fast", FALSE, 10, 128), 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_cuts)
+{
+  fail_unless_equals_uint64 (run_scenechange ("full", TRUE, 6, 96), CUTS);
+  fail_unless_equals_uint64 (run_scenechange ("fast", TRUE, 6, 96), CUTS);
+}
+
+GST_END_TEST;
+
+/* The thumbnail scores of these cuts stay below the absolute thresholds of
+ * the full mode, and the fast mode has to detect them from the histograms */
+GST_START_TEST (test_low_contrast_cuts_fast)
+{
+  fail_unless_equals_uint64 (run_scenechange ("fast", TRUE, 8, 80), CUTS);
+}
+
+GST_END_TEST;
+
+static Suite *
+scenechange_suite (void)
+{
+  Suite *s = suite_create ("scenechange");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_static_content);
+  tcase_add_test (tc_chain, test_pan);
+  tcase_add_test (tc_chain, test_cuts);
+  tcase_add_test (tc_chain, test_low_contrast_cuts_fast);
+
+  return s;
+}
+
+GST_CHECK_MAIN (scenechange);
@@ -96,6 +96,58 @@ GST_START_TEST (test_switchbin_simple)
 
 GST_END_TEST;
 
+GST_START_TEST (test_switchbin_standby)
+{
+  GstElement *switchbin, *e0, *e1;
+  GstCaps *c0, *c1;
+  GstHarness *h;
+  GstBuffer *buf;
+
+  switchbin = gst_element_factory_make ("switchbin", NULL);
+  fail_unless (switchbin != NULL);
+  g_object_set (switchbin, "num-paths", 2, "standby-state", GST_STATE_PAUSED,
+      NULL);
+  h = gst_harness_new_with_element (switchbin, "sink", "src");
+
+  e0 = gst_element_factory_make ("identity", NULL);
+  c0 = gst_caps_from_string ("audio/x-raw,rate=48000");
+  e1 = gst_element_factory_make ("identity", NULL);
+  c1 = gst_caps_from_string ("audio/x-raw,rate=44100");
+  gst_child_proxy_set (GST_CHILD_PROXY (switchbin),
+      "path0::element", e0, "path0::caps", c0,
+      "path1::element", e1, "path1::caps", c1, NULL);
+
+  /* The non-current path is prerolled, but not running */
+  gst_harness_set_src_caps (h, c0);
+  gst_harness_push (h, gst_harness_create_buffer (h, 480));
+  buf = gst_harness_pull (h);
+  gst_buffer_unref (buf);
+  fail_unless_equals_int (GST_STATE (e0), GST_STATE_PLAYING);
+  fail_unless_equals_int (GST_STATE (e1), GST_STATE_PAUSED);
+
+  /* Switching swaps these states */
+  gst_harness_set_src_caps (h, c1);
+  gst_harness_push (h, gst_harness_create_buffer (h, 480));
+  buf = gst_harness_pull (h);
+  gst_buffer_unref (buf);
+  fail_unless_equals_int (GST_STATE (e0), GST_STATE_PAUSED);
+  fail_unless_equals_int (GST_STATE (e1), GST_STATE_PLAYING);
+
+  /* Lowering the standby state applies to the non-current paths right away */
+  g_object_set (switchbin, "standby-state", GST_STATE_READY, NULL);
+  fail_unless_equals_int (GST_STATE (e0), GST_STATE_READY);
+  fail_unless_equals_int (GST_STATE (e1), GST_STATE_PLAYING);
+
+  /* And the bin's state limits the standby state */
+  gst_element_set_state (switchbin, GST_STATE_NULL);
+  fail_unless_equals_int (GST_STATE (e0), GST_STATE_NULL);
+
+  gst_harness_teardown (h);
+  gst_object_unref (switchbin);
+}
+
+GST_END_TEST;
+
 static Suite *
 switchbin_suite (void)
 {
@@ -104,6 +156,7 @@ switchbin_suite (void)
 
   suite_add_tcase (s, tc_basic);
   tcase_add_test (tc_basic, test_switchbin_simple);
+  tcase_add_test (tc_basic, test_switchbin_standby);
 
   return s;
 }
@@ -0,0 +1,255 @@
+/* GStreamer
+ *
+ * unit test for timecodestamper with the built-in LTC decoder
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+#define RATE 48000
+#define FPS 25
+#define SAMPLES_PER_FRAME (RATE / FPS)
+#define LEAD_IN 100
+#define N_CHANNELS 2
+#define N_FRAMES 36
+
+/* Channel 0 carries LTC at 10:00:00:00 for the first CH0_FRAMES frames,
+ * channel 1 at 11:00:00:00 for all N_FRAMES frames, a quarter of a frame
+ * later. The LTC frame of each channel with a given index starts less than
+ * half a frame after the video frame with that index */
+#define CH0_FRAMES 15
+#define CH1_DELAY (SAMPLES_PER_FRAME / 4)
+
+/* Writes the LTC frame @index frames after @hours:00:00:00 to @channel,
+ * starting at sample @start */
+static void
+write_ltc_frame (gint16 * samples, guint channel, guint start, guint hours,
+    guint index)
+{
+  static const guint8 sync[16] = {
+    0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1
+  };
+  guint samples_per_bit = SAMPLES_PER_FRAME / 80;
+  guint frames = index % FPS;
+  guint seconds = index / FPS;
+  guint values[8] = {
+    frames % 10, frames / 10, seconds % 10, seconds / 10, 0, 0,
+    hours % 10, hours / 10
+  };
+  guint8 bits[80];
+  gint level = 1;
+  guint i, j;
+
+  memset (bits, 0, 80);
+  for (i = 0; i < 8; i++) {
+    for (j = 0; j < 4; j++)
+      bits[i * 8 + j] = (values[i] >> j) & 1;
+  }
+  memcpy (bits + 64, sync, 16);
+
+  for (i = 0; i < 80; i++) {
+    level = -level;
+    for (j = 0; j < samples_per_bit; j++) {
+      if (bits[i] && j == samples_per_bit / 2)
+        level = -level;
+      samples[(start + i * samples_per_bit + j) * N_CHANNELS + channel] =
+          level * 6000 + g_random_int_range (-100, 100);
+    }
+  }
+}
+
+static gint16 *
+generate_ltc (guint * n_samples)
+{
+  gint16 *samples;
+  guint i;
+
+  *n_samples = LEAD_IN + CH1_DELAY + N_FRAMES * SAMPLES_PER_FRAME;
+  samples = g_new (gint16, *n_samples * N_CHANNELS);
+  for (i = 0; i < *n_samples * N_CHANNELS; i++)
+    samples[i] = g_random_int_range (-100, 100);
+
+  for (i = 0; i < N_FRAMES; i++) {
+    if (i < CH0_FRAMES)
+      write_ltc_frame (samples, 0, LEAD_IN + i * SAMPLES_PER_FRAME, 10, i);
+    write_ltc_frame (samples, 1, LEAD_IN + CH1_DELAY + i * SAMPLES_PER_FRAME,
+        11, i);
+  }
+
+  return samples;
+}
+
+/* Pushes the whole LTC audio in buffers of 1024 samples, then EOS. Without
+ * a live source, the video is stamped once the LTC pad is EOS */
+static void
+push_ltc (GstHarness * h)
+{
+  guint n_samples, offset;
+  gint16 *samples;
+
+  samples = generate_ltc (&n_samples);
+  for (offset = 0; offset < n_samples; offset += 1024) {
+    guint n = MIN (1024, n_samples - offset);
+    GstBuffer *buf;
+
+    buf = gst_buffer_new_memdup (samples + offset * N_CHANNELS,
+        n * N_CHANNELS * sizeof (gint16));
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale_int (offset, GST_SECOND,
+        RATE);
+    GST_BUFFER_DURATION (buf) = gst_util_uint64_scale_int (n, GST_SECOND,
+        RATE);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  g_free (samples);
+}
+
+/* Stamps N_FRAMES video frames and returns the hours of each timecode,
+ * checking that the rest of it matches the frame */
+static void
+stamp_video (GstHarness * h, guint hours[N_FRAMES])
+{
+  guint i;
+
+  for (i = 0; i < N_FRAMES; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, 16 * 16, NULL);
+    GstVideoTimeCodeMeta *meta;
+
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale_int (i, GST_SECOND, FPS);
+    GST_BUFFER_DURATION (buf) = GST_SECOND / FPS;
+    buf = gst_harness_push_and_pull (h, buf);
+    fail_unless (buf != NULL);
+
+    meta = gst_buffer_get_video_time_code_meta (buf);
+    fail_unless (meta != NULL);
+    hours[i] = meta->tc.hours;
+    if (hours[i] != 0) {
+      fail_unless_equals_int (meta->tc.minutes, 0);
+      fail_unless_equals_int (meta->tc.seconds, i / FPS);
+      fail_unless_equals_int (meta->tc.frames, i % FPS);
+    }
+    gst_buffer_unref (buf);
+  }
+}
+
+static void
+check_stamp (const gchar * ltc_channel, guint hours[N_FRAMES])
+{
+  GstElement *stamper;
+  GstHarness *h, *hltc;
+  GstPad *ltcpad;
+
+  stamper = gst_element_factory_make ("timecodestamper", NULL);
+  fail_unless (stamper != NULL);
+  gst_util_set_object_arg (G_OBJECT (stamper), "source", "ltc");
+  gst_util_set_object_arg (G_OBJECT (stamper), "ltc-decoder", "builtin");
+  gst_util_set_object_arg (G_OBJECT (stamper), "ltc-channel", ltc_channel);
+
+  /* the LTC pad can only be requested before the element is started */
+  ltcpad = gst_element_request_pad_simple (stamper, "ltc_sink");
+  if (ltcpad == NULL) {
+    GST_INFO ("timecodestamper was built without LTC support");
+    gst_object_unref (stamper);
+    memset (hours, 0xff, N_FRAMES * sizeof (guint));
+    return;
+  }
+
+  h = gst_harness_new_with_element (stamper, "sink", "src");
+  hltc = gst_harness_new_with_element (stamper, NULL, NULL);
+  gst_harness_add_element_sink_pad (hltc, ltcpad);
+  gst_object_unref (ltcpad);
+  gst_object_unref (stamper);
+
+  gst_harness_set_live (h, FALSE);
+  gst_harness_set_live (hltc, FALSE);
+  gst_harness_set_src_caps_str (h, "video/x-raw,format=GRAY8,width=16,"
+      "height=16,framerate=25/1");
+  gst_harness_set_src_caps_str (hltc, "audio/x-raw,format=S16LE,rate=48000,"
+      "channels=2,layout=interleaved");
+
+  push_ltc (hltc);
+  stamp_video (h, hours);
+
+  gst_harness_teardown (h);
+  gst_harness_teardown (hltc);
+}
+
+/* With both channels carrying LTC, the one detected first is kept until it
+ * has had no timecode for half a second */
+GST_START_TEST (test_ltc_detect_channel)
+{
+  guint hours[N_FRAMES];
+  guint i, switched = 0;
+
+  check_stamp ("-1", hours);
+  if (hours[0] == G_MAXUINT)
+    return;
+
+  /* the first frames are needed to lock on the bit period */
+  for (i = 4; i < CH0_FRAMES; i++)
+    fail_unless_equals_int (hours[i], 10);
+
+  for (i = CH0_FRAMES; i < N_FRAMES; i++) {
+    if (hours[i] == 11 && switched == 0)
+      switched = i;
+    fail_unless_equals_int (hours[i], switched ? 11 : 10);
+  }
+
+  /* half a second after the last timecode of channel 0 */
+  GST_INFO ("switched to channel 1 at frame %u", switched);
+  fail_unless (switched >= CH0_FRAMES + FPS / 2 - 1);
+  fail_unless (switched <= CH0_FRAMES + FPS / 2 + 2);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_ltc_fixed_channel)
+{
+  guint hours[N_FRAMES];
+  guint i;
+
+  check_stamp ("1", hours);
+  if (hours[0] == G_MAXUINT)
+    return;
+
+  for (i = 4; i < N_FRAMES; i++)
+    fail_unless_equals_int (hours[i], 11);
+}
+
+GST_END_TEST;
+
+static Suite *
+timecodestamper_suite (void)
+{
+  Suite *s = suite_create ("timecodestamper");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_ltc_detect_channel);
+  tcase_add_test (tc_chain, test_ltc_fixed_channel);
+
+  return s;
+}
+
+GST_CHECK_MAIN (timecodestamper);
@@ -0,0 +1,409 @@
+/* GStreamer
+ *
+ * unit test for the frame checksums of videocodectestsink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <glib/gstdio.h>
+
+#include "../../../gst/debugutils/gstvideocodectestsink.c"
+
+#define WIDTH 20
+#define HEIGHT 10
+
+static gchar *
+test_crc64 (const gchar * data, gsize length)
+{
+  g_once (&crc64_once, crc64_init_table, NULL);
+
+  return g_strdup_printf ("%016" G_GINT64_MODIFIER "x",
+      ~crc64_update (G_MAXUINT64, (const guint8 *) data, length));
+}
+
+static gchar *
+test_xxh64 (const gchar * data, gsize length)
+{
+  Xxh64State state;
+
+  xxh64_init (&state);
+  xxh64_update (&state, (const guint8 *) data, length);
+
+  return g_strdup_printf ("%016" G_GINT64_MODIFIER "x",
+      xxh64_digest (&state));
+}
+
+#define fail_unless_digest(func, data, length, expected) G_STMT_START { \
+  gchar *digest = func (data, length);                                   \
+  fail_unless_equals_string (digest, expected);                          \
+  g_free (digest);                                                       \
+} G_STMT_END
+
+GST_START_TEST (test_crc64_vectors)
+{
+  fail_unless_digest (test_crc64, "", 0, "0000000000000000");
+  fail_unless_digest (test_crc64, "a", 1, "330284772e652b05");
+  fail_unless_digest (test_crc64, "abc", 3, "2cd8094a1a277627");
+  fail_unless_digest (test_crc64, "123456789", 9, "995dc9bbdf1939fa");
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_xxh64_vectors)
+{
+  guint8 data[100];
+  Xxh64State state;
+  guint i;
+
+  fail_unless_digest (test_xxh64, "", 0, "ef46db3751d8e999");
+  fail_unless_digest (test_xxh64, "a", 1, "d24ec4f1a98c6e5b");
+  fail_unless_digest (test_xxh64, "abc", 3, "44bc2cf5ad770999");
+  fail_unless_digest (test_xxh64, "123456789", 9, "8cb841db40e6ae83");
+
+  /* several stripes, fed in pieces not aligned on them */
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = i;
+  xxh64_init (&state);
+  xxh64_update (&state, data, 7);
+  xxh64_update (&state, data + 7, 50);
+  xxh64_update (&state, data + 57, 43);
+  fail_unless_equals_uint64 (xxh64_digest (&state),
+      G_GUINT64_CONSTANT (0x6ac1e58032166597));
+}
+
+GST_END_TEST;
+
+/* The unpadded I420 samples of frame n */
+static guint8
+sample (guint n, guint comp, guint x, guint y)
+{
+  switch (comp) {
+    case 0:
+      return n * 7 + y * WIDTH + x;
+    case 1:
+      return n * 3 + 100 + y * (WIDTH / 2) + x;
+    default:
+      return n + 200 + y * (WIDTH / 2) + x;
+  }
+}
+
+/* Frame n in the given format, with garbage in the padding */
+static GstBuffer *
+make_frame (GstVideoFormat format, guint n)
+{
+  GstVideoInfo info;
+  GstVideoFrame frame;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint comp, x, y;
+
+  gst_video_info_set_format (&info, format, WIDTH, HEIGHT);
+  buf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  memset (map.data, 0xa5, map.size);
+  gst_buffer_unmap (buf, &map);
+
+  fail_unless (gst_video_frame_map (&frame, &info, buf, GST_MAP_WRITE));
+  for (comp = 0; comp < 3; comp++) {
+    guint8 *data = GST_VIDEO_FRAME_COMP_DATA (&frame, comp);
+    guint pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (&frame, comp);
+    guint stride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, comp);
+
+    for (y = 0; y < GST_VIDEO_FRAME_COMP_HEIGHT (&frame, comp); y++) {
+      for (x = 0; x < GST_VIDEO_FRAME_COMP_WIDTH (&frame, comp); x++)
+        data[y * stride + x * pstride] = sample (n, comp, x, y);
+    }
+  }
+  gst_video_frame_unmap (&frame);
+
+  GST_BUFFER_PTS (buf) = n * GST_SECOND / 25;
+
+  return buf;
+}
+
+/* The xxHash 64 of frame n, or of one of its planes, computed on its
+ * unpadded I420 layout */
+static gchar *
+frame_xxh64 (guint n, gint plane)
+{
+  GString *data = g_string_new (NULL);
+  guint comp, x, y;
+  gchar *ret;
+
+  for (comp = 0; comp < 3; comp++) {
+    guint w = comp ? WIDTH / 2 : WIDTH;
+    guint h = comp ? HEIGHT / 2 : HEIGHT;
+
+    if (plane >= 0 && (gint) comp != plane)
+      continue;
+    for (y = 0; y < h; y++) {
+      for (x = 0; x < w; x++)
+        g_string_append_c (data, sample (n, comp, x, y));
+    }
+  }
+  ret = test_xxh64 (data->str, data->len);
+  g_string_free (data, TRUE);
+
+  return ret;
+}
+
+static GstHarness *
+setup_sink (GstBus * bus, const gchar * format, const gchar * frame_checksum,
+    gboolean per_plane, guint n_threads, const gchar * reference)
+{
+  GstElement *sink;
+  GstHarness *h;
+  gchar *caps;
+
+  sink = gst_element_factory_make ("videocodectestsink", NULL);
+  fail_unless (sink != NULL);
+  gst_util_set_object_arg (G_OBJECT (sink), "frame-checksum",
+      frame_checksum);
+  g_object_set (sink, "per-plane", per_plane, "n-threads", n_threads,
+      "reference", reference, NULL);
+  gst_element_set_bus (sink, bus);
+
+  h = gst_harness_new_with_element (sink, "sink", NULL);
+  gst_object_unref (sink);
+
+  caps = g_strdup_printf ("video/x-raw,format=%s,width=%d,height=%d,"
+      "framerate=25/1", format, WIDTH, HEIGHT);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  return h;
+}
+
+static void
+teardown_sink (GstHarness * h)
+{
+  gst_element_set_bus (h->element, NULL);
+  gst_harness_teardown (h);
+}
+
+/* Pops the next frame checksum message, checks it is for frame n and
+ * returns its checksums separated by spaces */
+static gchar *
+pop_frame_checksum (GstBus * bus, const gchar * type, guint64 n)
+{
+  const GstStructure *s;
+  GstMessage *msg;
+  guint64 frame, timestamp;
+  gchar *ret;
+
+  while ((msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT))) {
+    if (gst_message_has_name (msg, "conformance/frame-checksum"))
+      break;
+    gst_message_unref (msg);
+  }
+  fail_unless (msg != NULL, "no checksum for frame %" G_GUINT64_FORMAT, n);
+
+  s = gst_message_get_structure (msg);
+  fail_unless_equals_string (gst_structure_get_string (s, "checksum-type"),
+      type);
+  fail_unless (gst_structure_get_uint64 (s, "frame", &frame));
+  fail_unless_equals_uint64 (frame, n);
+  fail_unless (gst_structure_get_uint64 (s, "timestamp", &timestamp));
+  fail_unless_equals_uint64 (timestamp, n * GST_SECOND / 25);
+
+  if (gst_structure_has_field (s, "plane-checksums")) {
+    const GValue *planes = gst_structure_get_value (s, "plane-checksums");
+    gchar *strv[4] = { NULL, };
+    guint i;
+
+    fail_unless_equals_int (gst_value_array_get_size (planes), 3);
+    for (i = 0; i < 3; i++)
+      strv[i] = (gchar *)
+          g_value_get_string (gst_value_array_get_value (planes, i));
+    ret = g_strjoinv (" ", strv);
+  } else {
+    ret = g_strdup (gst_structure_get_string (s, "checksum"));
+  }
+  gst_message_unref (msg);
+
+  return ret;
+}
+
+static const gchar *crc64_frames[2] = {
+  "5dbe64ec0eba8a5a",
+  "29aa24bd870d845b",
+};
+
+static const gchar *crc64_planes[2] = {
+  "87337fd7b885819c bbe76aa5961cf2ea 48f6cb94ff057d15",
+  "2dec9369a0a0bccd 5ec55a4b46f0af96 705676c91560542e",
+};
+
+static const gchar *xxh64_frames[2] = {
+  "1d6909c9df4b7d18",
+  "673aa596406212a0",
+};
+
+static const gchar *xxh64_planes[2] = {
+  "50dc1079b99e879c 1a4f401434d39836 9413e36e958ce6a5",
+  "90607f3a3cea6543 e1778502804a4e3c 66ba86ef0f176497",
+};
+
+static void
+check_frame_checksums (const gchar * format, const gchar * type,
+    gboolean per_plane, const gchar ** expected)
+{
+  GstBus *bus = gst_bus_new ();
+  GstHarness *h;
+  guint n;
+
+  h = setup_sink (bus, format, type, per_plane, 1, NULL);
+
+  for (n = 0; n < 2; n++) {
+    gchar *checksums;
+
+    fail_unless_equals_int (gst_harness_push (h,
+            make_frame (gst_video_format_from_string (format), n)),
+        GST_FLOW_OK);
+    checksums = pop_frame_checksum (bus, type, n);
+    fail_unless_equals_string (checksums, expected[n]);
+    g_free (checksums);
+  }
+
+  teardown_sink (h);
+  gst_object_unref (bus);
+}
+
+/* NV12 chroma is deinterleaved, so both formats give the same checksums */
+GST_START_TEST (test_frame_checksums)
+{
+  const gchar *formats[] = { "I420", "NV12" };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    check_frame_checksums (formats[i], "crc64", FALSE, crc64_frames);
+    check_frame_checksums (formats[i], "crc64", TRUE, crc64_planes);
+    check_frame_checksums (formats[i], "xxhash64", FALSE, xxh64_frames);
+    check_frame_checksums (formats[i], "xxhash64", TRUE, xxh64_planes);
+  }
+}
+
+GST_END_TEST;
+
+/* the workers finish frames in any order, they are posted in frame order */
+GST_START_TEST (test_frame_order)
+{
+  GstBus *bus = gst_bus_new ();
+  GstHarness *h;
+  guint n;
+
+  h = setup_sink (bus, "I420", "xxhash64", FALSE, 4, NULL);
+
+  for (n = 0; n < 50; n++)
+    fail_unless_equals_int (gst_harness_push (h,
+            make_frame (GST_VIDEO_FORMAT_I420, n)), GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  for (n = 0; n < 50; n++) {
+    gchar *checksum = pop_frame_checksum (bus, "xxhash64", n);
+    gchar *expected = frame_xxh64 (n, -1);
+
+    fail_unless_equals_string (checksum, expected);
+    g_free (expected);
+    g_free (checksum);
+  }
+
+  teardown_sink (h);
+  gst_object_unref (bus);
+}
+
+GST_END_TEST;
+
+/* an error names the first frame not matching the reference */
+GST_START_TEST (test_reference_mismatch)
+{
+  GstBus *bus = gst_bus_new ();
+  GError *error = NULL;
+  GstMessage *msg;
+  GstHarness *h;
+  GString *contents;
+  gchar *reference, *debug;
+  GstFlowReturn ret = GST_FLOW_OK;
+  gint fd;
+  guint n;
+
+  contents = g_string_new ("# per plane xxHash 64\n\n");
+  for (n = 0; n < 6; n++) {
+    gchar *planes[3];
+    guint i;
+
+    for (i = 0; i < 3; i++)
+      planes[i] = frame_xxh64 (n, i);
+    /* frame 3 has a wrong U plane */
+    g_string_append_printf (contents, "%s\t%s %s\n", planes[0],
+        n == 3 ? "0000000000000000" : planes[1], planes[2]);
+    for (i = 0; i < 3; i++)
+      g_free (planes[i]);
+  }
+
+  fd = g_file_open_tmp ("videocodectestsink-XXXXXX", &reference, NULL);
+  fail_unless (fd >= 0);
+  g_close (fd, NULL);
+  fail_unless (g_file_set_contents (reference, contents->str, -1, NULL));
+  g_string_free (contents, TRUE);
+
+  h = setup_sink (bus, "I420", "xxhash64", TRUE, 1, reference);
+
+  for (n = 0; n < 6 && ret == GST_FLOW_OK; n++)
+    ret = gst_harness_push (h, make_frame (GST_VIDEO_FORMAT_I420, n));
+  fail_unless_equals_int (ret, GST_FLOW_ERROR);
+  fail_unless_equals_int (n, 4);
+
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  gst_message_parse_error (msg, &error, &debug);
+  fail_unless (g_str_has_prefix (error->message,
+          "Frame 3 does not match the reference"), "%s", error->message);
+  g_clear_error (&error);
+  g_free (debug);
+  gst_message_unref (msg);
+
+  teardown_sink (h);
+  gst_object_unref (bus);
+  g_unlink (reference);
+  g_free (reference);
+}
+
+GST_END_TEST;
+
+static Suite *
+videocodectestsink_suite (void)
+{
+  Suite *s = suite_create ("videocodectestsink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_crc64_vectors);
+  tcase_add_test (tc_chain, test_xxh64_vectors);
+  tcase_add_test (tc_chain, test_frame_checksums);
+  tcase_add_test (tc_chain, test_frame_order);
+  tcase_add_test (tc_chain, test_reference_mismatch);
+
+  return s;
+}
+
+GST_CHECK_MAIN (videocodectestsink);
@@ -670,6 +670,58 @@ GST_START_TEST (test_mpegts_dvb_descriptors)
 
 GST_END_TEST;
 
+/* Bit by bit reference of the MPEG-2 CRC32 */
+static guint32
+calc_crc32_reference (const guint8 * data, gsize length)
+{
+  guint32 crc = 0xffffffff;
+  gsize i;
+  gint bit;
+
+  for (i = 0; i < length; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (bit = 0; bit < 8; bit++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+/* The optimised implementations only take over from a few dozen bytes on,
+ * and may load unaligned data */
+GST_START_TEST (test_mpegts_crc32)
+{
+  guint8 *data = g_malloc (1024 + 8 + 4);
+  gsize length, i;
+  guint offset;
+
+  for (i = 0; i < 1024 + 8 + 4; i++)
+    data[i] = g_random_int_range (0, 256);
+
+  for (offset = 0; offset < 8; offset++) {
+    for (length = 0; length <= 1024; length++) {
+      guint32 crc = gst_mpegts_calc_crc32 (data + offset, length);
+
+      fail_unless_equals_int_hex (crc,
+          calc_crc32_reference (data + offset, length));
+
+      /* a section followed by its CRC_32 checks to 0 */
+      GST_WRITE_UINT32_BE (data + offset + length, crc);
+      fail_unless_equals_int_hex (gst_mpegts_calc_crc32 (data + offset,
+              length + 4), 0);
+    }
+  }
+
+  fail_unless_equals_int_hex (gst_mpegts_calc_crc32 (pat_data_check,
+          sizeof (pat_data_check)), 0);
+  fail_unless_equals_int_hex (gst_mpegts_calc_crc32 (nit_data_check,
+          sizeof (nit_data_check)), 0);
+
+  g_free (data);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegts_suite (void)
 {
@@ -688,6 +740,7 @@ mpegts_suite (void)
   tcase_add_test (tc_chain, test_mpegts_atsc_stt);
   tcase_add_test (tc_chain, test_mpegts_descriptors);
   tcase_add_test (tc_chain, test_mpegts_dvb_descriptors);
+  tcase_add_test (tc_chain, test_mpegts_crc32);
 
   return s;
 }
@@ -0,0 +1,392 @@
+/* GStreamer
+ *
+ * unit test for GstNonstreamAudioDecoder
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/gstnonstreamaudiodecoder.h>
+
+#define RATE 8000
+#define BLOCK_SAMPLES 1000
+#define N_BLOCKS 32
+
+/* position at which decode() switches to twice the rate */
+static guint64 rate_change_position = G_MAXUINT64;
+
+/* A decoder whose samples count up from 0, and whose whole player state is
+ * the position */
+
+typedef struct
+{
+  GstNonstreamAudioDecoder parent;
+
+  guint64 position;
+  guint n_seeks;
+  guint n_restores;
+} GstTestNonstreamDec;
+
+typedef struct
+{
+  GstNonstreamAudioDecoderClass parent_class;
+} GstTestNonstreamDecClass;
+
+GType gst_test_nonstream_dec_get_type (void);
+
+G_DEFINE_TYPE (GstTestNonstreamDec, gst_test_nonstream_dec,
+    GST_TYPE_NONSTREAM_AUDIO_DECODER);
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("audio/x-raw, format = (string) " GST_AUDIO_NE (S16)
+        ", layout = (string) interleaved, rate = (int) { 8000, 16000 }, "
+        "channels = (int) 1")
+    );
+
+static gboolean
+test_dec_load_from_custom (GstNonstreamAudioDecoder * dec,
+    guint initial_subsong, GstNonstreamAudioSubsongMode initial_subsong_mode,
+    GstClockTime * initial_position,
+    GstNonstreamAudioOutputMode * initial_output_mode,
+    gint * initial_num_loops)
+{
+  GstTestNonstreamDec *self = (GstTestNonstreamDec *) dec;
+
+  self->position = 0;
+  *initial_position = 0;
+  *initial_output_mode = GST_NONSTREAM_AUDIO_OUTPUT_MODE_STEADY;
+  *initial_num_loops = 0;
+
+  return gst_nonstream_audio_decoder_set_output_format_simple (dec, RATE,
+      GST_AUDIO_FORMAT_S16, 1);
+}
+
+static guint
+test_dec_get_supported_output_modes (GstNonstreamAudioDecoder * dec)
+{
+  return 1u << GST_NONSTREAM_AUDIO_OUTPUT_MODE_STEADY;
+}
+
+static gboolean
+test_dec_seek (GstNonstreamAudioDecoder * dec, GstClockTime * new_position)
+{
+  GstTestNonstreamDec *self = (GstTestNonstreamDec *) dec;
+
+  self->position = gst_util_uint64_scale_int (*new_position, RATE, GST_SECOND);
+  self->n_seeks++;
+
+  return TRUE;
+}
+
+static GstClockTime
+test_dec_tell (GstNonstreamAudioDecoder * dec)
+{
+  GstTestNonstreamDec *self = (GstTestNonstreamDec *) dec;
+
+  return gst_util_uint64_scale_int (self->position, GST_SECOND, RATE);
+}
+
+static gboolean
+test_dec_decode (GstNonstreamAudioDecoder * dec, GstBuffer ** buffer,
+    guint * num_samples)
+{
+  GstTestNonstreamDec *self = (GstTestNonstreamDec *) dec;
+  GstMapInfo map;
+  gint16 *samples;
+  guint i;
+
+  if (self->position >= N_BLOCKS * BLOCK_SAMPLES)
+    return FALSE;
+
+  if (self->position == rate_change_position)
+    gst_nonstream_audio_decoder_set_output_format_simple (dec, 2 * RATE,
+        GST_AUDIO_FORMAT_S16, 1);
+
+  *buffer = gst_nonstream_audio_decoder_allocate_output_buffer (dec,
+      BLOCK_SAMPLES * sizeof (gint16));
+  gst_buffer_map (*buffer, &map, GST_MAP_WRITE);
+  samples = (gint16 *) map.data;
+  for (i = 0; i < BLOCK_SAMPLES; i++)
+    samples[i] = self->position + i;
+  gst_buffer_unmap (*buffer, &map);
+
+  self->position += BLOCK_SAMPLES;
+  *num_samples = BLOCK_SAMPLES;
+
+  return TRUE;
+}
+
+static GBytes *
+test_dec_save_state (GstNonstreamAudioDecoder * dec)
+{
+  GstTestNonstreamDec *self = (GstTestNonstreamDec *) dec;
+
+  return g_bytes_new (&self->position, sizeof (self->position));
+}
+
+static gboolean
+test_dec_restore_state (GstNonstreamAudioDecoder * dec, GBytes * state)
+{
+  GstTestNonstreamDec *self = (GstTestNonstreamDec *) dec;
+
+  fail_unless_equals_int (g_bytes_get_size (state), sizeof (self->position));
+  memcpy (&self->position, g_bytes_get_data (state, NULL),
+      sizeof (self->position));
+  self->n_restores++;
+
+  return TRUE;
+}
+
+static void
+gst_test_nonstream_dec_class_init (GstTestNonstreamDecClass * klass)
+{
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstNonstreamAudioDecoderClass *dec_class =
+      GST_NONSTREAM_AUDIO_DECODER_CLASS (klass);
+
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "Test nonstream decoder", "Codec/Decoder/Audio",
+      "Outputs samples counting up", "GStreamer");
+
+  dec_class->loads_from_sinkpad = FALSE;
+  dec_class->load_from_custom = test_dec_load_from_custom;
+  dec_class->get_supported_output_modes = test_dec_get_supported_output_modes;
+  dec_class->seek = test_dec_seek;
+  dec_class->tell = test_dec_tell;
+  dec_class->decode = test_dec_decode;
+  dec_class->save_state = test_dec_save_state;
+  dec_class->restore_state = test_dec_restore_state;
+}
+
+static void
+gst_test_nonstream_dec_init (GstTestNonstreamDec * self)
+{
+}
+
+static GstHarness *
+setup_harness (GstClockTime snapshot_interval, guint render_ahead)
+{
+  GstElement *dec;
+  GstHarness *h;
+
+  dec = g_object_new (gst_test_nonstream_dec_get_type (), "snapshot-interval",
+      snapshot_interval, "render-ahead", render_ahead, NULL);
+  h = gst_harness_new_with_element (dec, NULL, "src");
+  gst_object_unref (dec);
+  gst_harness_play (h);
+
+  return h;
+}
+
+/* Pulls buffers up to the end of the song, checking that the samples and
+ * timestamps continue from first_sample, and waits for EOS */
+static void
+check_output (GstHarness * h, guint64 first_sample)
+{
+  guint64 position = first_sample;
+  GstEvent *event;
+
+  while (position < N_BLOCKS * BLOCK_SAMPLES) {
+    GstBuffer *buffer = gst_harness_pull (h);
+    GstMapInfo map;
+    const gint16 *samples;
+    gsize i;
+
+    fail_unless (buffer != NULL);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buffer),
+        gst_util_uint64_scale_int (position, GST_SECOND, RATE));
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    samples = (const gint16 *) map.data;
+    for (i = 0; i < map.size / sizeof (gint16); i++)
+      fail_unless_equals_int (samples[i], position + i);
+    position += map.size / sizeof (gint16);
+    gst_buffer_unmap (buffer, &map);
+
+    gst_buffer_unref (buffer);
+  }
+
+  while ((event = gst_harness_pull_event (h)) != NULL) {
+    GstEventType type = GST_EVENT_TYPE (event);
+
+    gst_event_unref (event);
+    if (type == GST_EVENT_EOS)
+      break;
+  }
+}
+
+static void
+seek (GstHarness * h, GstClockTime position)
+{
+  fail_unless (gst_harness_push_upstream_event (h,
+          gst_event_new_seek (1.0, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH,
+              GST_SEEK_TYPE_SET, position, GST_SEEK_TYPE_NONE, -1)));
+}
+
+GST_START_TEST (test_seek_without_snapshots)
+{
+  GstHarness *h = setup_harness (0, 0);
+  GstTestNonstreamDec *dec = (GstTestNonstreamDec *) h->element;
+
+  check_output (h, 0);
+
+  seek (h, 2550 * GST_MSECOND);
+  check_output (h, 20400);
+  fail_unless_equals_int (dec->n_seeks, 1);
+  fail_unless_equals_int (dec->n_restores, 0);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_seek_to_snapshot)
+{
+  GstHarness *h = setup_harness (GST_SECOND, 0);
+  GstTestNonstreamDec *dec = (GstTestNonstreamDec *) h->element;
+
+  check_output (h, 0);
+
+  /* restores the snapshot at 2 s, renders 4 blocks and a part of the
+   * fifth, and outputs the rest of it */
+  seek (h, 2550 * GST_MSECOND);
+  check_output (h, 20400);
+  fail_unless_equals_int (dec->n_seeks, 0);
+  fail_unless_equals_int (dec->n_restores, 1);
+
+  /* before the first snapshot, the subclass seeks */
+  seek (h, 100 * GST_MSECOND);
+  check_output (h, 800);
+  fail_unless_equals_int (dec->n_seeks, 1);
+  fail_unless_equals_int (dec->n_restores, 1);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_render_ahead)
+{
+  GstHarness *h = setup_harness (GST_SECOND, 4);
+  GstTestNonstreamDec *dec = (GstTestNonstreamDec *) h->element;
+
+  check_output (h, 0);
+
+  seek (h, 2550 * GST_MSECOND);
+  check_output (h, 20400);
+  fail_unless_equals_int (dec->n_restores, 1);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* changing render-ahead while playing takes effect after the next seek */
+GST_START_TEST (test_render_ahead_changed)
+{
+  GstHarness *h = setup_harness (GST_SECOND, 4);
+
+  gst_buffer_unref (gst_harness_pull (h));
+  g_object_set (h->element, "render-ahead", 0, NULL);
+  check_output (h, BLOCK_SAMPLES);
+
+  seek (h, 2550 * GST_MSECOND);
+  check_output (h, 20400);
+
+  g_object_set (h->element, "render-ahead", 2, NULL);
+  seek (h, 100 * GST_MSECOND);
+  check_output (h, 800);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+record_buffer_rate (GstPad * pad, GstPadProbeInfo * info, GArray * rates)
+{
+  GstAudioInfo audio_info;
+  GstCaps *caps;
+
+  caps = gst_pad_get_current_caps (pad);
+  fail_unless (caps != NULL);
+  fail_unless (gst_audio_info_from_caps (&audio_info, caps));
+  g_array_append_val (rates, GST_AUDIO_INFO_RATE (&audio_info));
+  gst_caps_unref (caps);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* the caps of a new output format set while rendering ahead must not
+ * overtake the buffers rendered before it */
+GST_START_TEST (test_render_ahead_format_change)
+{
+  const guint render_ahead[] = { 0, 4 };
+  guint i, j;
+
+  rate_change_position = 8 * BLOCK_SAMPLES;
+
+  for (i = 0; i < G_N_ELEMENTS (render_ahead); i++) {
+    GArray *rates = g_array_new (FALSE, FALSE, sizeof (gint));
+    GstHarness *h = setup_harness (0, render_ahead[i]);
+    GstPad *srcpad = gst_element_get_static_pad (h->element, "src");
+
+    gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER,
+        (GstPadProbeCallback) record_buffer_rate, rates, NULL);
+    gst_object_unref (srcpad);
+
+    for (j = 0; j < N_BLOCKS; j++)
+      gst_buffer_unref (gst_harness_pull (h));
+
+    /* the first buffers might have been pushed before the probe was added */
+    fail_unless (rates->len >= N_BLOCKS - render_ahead[i] - 2);
+    for (j = 0; j < rates->len; j++) {
+      guint block = N_BLOCKS - rates->len + j;
+
+      fail_unless_equals_int (g_array_index (rates, gint, j),
+          block < 8 ? RATE : 2 * RATE);
+    }
+
+    gst_harness_teardown (h);
+    g_array_unref (rates);
+  }
+
+  rate_change_position = G_MAXUINT64;
+}
+
+GST_END_TEST;
+
+static Suite *
+nonstreamaudiodecoder_suite (void)
+{
+  Suite *s = suite_create ("nonstreamaudiodecoder");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_seek_without_snapshots);
+  tcase_add_test (tc_chain, test_seek_to_snapshot);
+  tcase_add_test (tc_chain, test_render_ahead);
+  tcase_add_test (tc_chain, test_render_ahead_changed);
+  tcase_add_test (tc_chain, test_render_ahead_format_change);
+
+  return s;
+}
+
+GST_CHECK_MAIN (nonstreamaudiodecoder);
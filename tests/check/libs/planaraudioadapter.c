@@ -342,6 +342,136 @@ GST_START_TEST (test_retrieve_combined)
 
 GST_END_TEST;
 
+/* Generates @nsamples of 3 S16 planes, where sample n of channel c is
+ * c * 1000 + @start + n */
+static GstBuffer *
+generate_counting_buffer (GstAudioInfo * info, gsize start, gsize nsamples)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  gint16 *data;
+  gsize c, i;
+
+  buf = gst_buffer_new_allocate (NULL, 3 * nsamples * sizeof (gint16), NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  data = (gint16 *) map.data;
+  for (c = 0; c < 3; c++) {
+    for (i = 0; i < nsamples; i++)
+      data[c * nsamples + i] = c * 1000 + start + i;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  gst_buffer_add_audio_meta (buf, info, nsamples, NULL);
+  GST_BUFFER_PTS (buf) = start * GST_MSECOND;
+
+  return buf;
+}
+
+static void
+verify_counting_plane (const gint16 * plane, gsize n, gint c, gsize start)
+{
+  gsize i;
+
+  for (i = 0; i < n; i++)
+    fail_unless_equals_int (plane[i], c * 1000 + start + i);
+}
+
+GST_START_TEST (test_ring_buffer)
+{
+  GstPlanarAudioAdapter *adapter;
+  GstAudioInfo info;
+  GstBuffer *buf;
+  gpointer planes[3], wrap_planes[3];
+  gsize pushed = 0, read = 0, wrap_samples, start;
+  guint64 distance;
+  gint c, i;
+
+  adapter = gst_planar_audio_adapter_new ();
+
+  gst_audio_info_init (&info);
+  gst_audio_info_set_format (&info, GST_AUDIO_FORMAT_S16, 1000, 3, NULL);
+  info.layout = GST_AUDIO_LAYOUT_NON_INTERLEAVED;
+
+  gst_planar_audio_adapter_configure_ring_buffer (adapter, &info, 16);
+
+  /* push 7 samples and read 5 at a time, so that the reads regularly wrap
+   * around the end of the ring buffer */
+  for (i = 0; i < 20; i++) {
+    gst_planar_audio_adapter_push (adapter,
+        generate_counting_buffer (&info, pushed, 7));
+    pushed += 7;
+
+    while (gst_planar_audio_adapter_available (adapter) >= 5) {
+      fail_unless (gst_planar_audio_adapter_peek_planes (adapter, 5, planes,
+              wrap_planes, &wrap_samples));
+      fail_unless (wrap_samples < 5);
+      for (c = 0; c < 3; c++) {
+        verify_counting_plane (planes[c], 5 - wrap_samples, c, read);
+        if (wrap_samples)
+          verify_counting_plane (wrap_planes[c], wrap_samples, c,
+              read + 5 - wrap_samples);
+      }
+
+      gst_planar_audio_adapter_flush (adapter, 5);
+      read += 5;
+
+      /* the pts of the buffer holding the next sample and the distance from
+       * its start, or of the last buffer if everything was read */
+      start = read < pushed ? read - read % 7 : pushed - 7;
+      fail_unless_equals_uint64 (gst_planar_audio_adapter_prev_pts (adapter,
+              &distance), start * GST_MSECOND);
+      fail_unless_equals_uint64 (distance, read - start);
+    }
+  }
+
+  /* contiguous access to blocks of 9 samples */
+  for (i = 0; i < 20; i++) {
+    gst_planar_audio_adapter_push (adapter,
+        generate_counting_buffer (&info, pushed, 7));
+    pushed += 7;
+
+    while (gst_planar_audio_adapter_available (adapter) >= 9) {
+      fail_unless (gst_planar_audio_adapter_peek_planes (adapter, 9, planes,
+              NULL, NULL));
+      for (c = 0; c < 3; c++)
+        verify_counting_plane (planes[c], 9, c, read);
+      gst_planar_audio_adapter_flush (adapter, 9);
+      read += 9;
+    }
+  }
+
+  /* growing the ring buffer */
+  for (i = 0; i < 10; i++) {
+    gst_planar_audio_adapter_push (adapter,
+        generate_counting_buffer (&info, pushed, 7));
+    pushed += 7;
+  }
+  fail_unless_equals_int (gst_planar_audio_adapter_available (adapter),
+      pushed - read);
+
+  /* copying the samples out */
+  buf = gst_planar_audio_adapter_take_buffer (adapter, pushed - read,
+      GST_MAP_READ);
+  fail_unless (buf);
+  {
+    GstAudioBuffer abuf;
+
+    gst_audio_buffer_map (&abuf, &info, buf, GST_MAP_READ);
+    for (c = 0; c < 3; c++)
+      verify_counting_plane (abuf.planes[c], pushed - read, c, read);
+    gst_audio_buffer_unmap (&abuf);
+  }
+  gst_buffer_unref (buf);
+
+  fail_unless_equals_int (gst_planar_audio_adapter_available (adapter), 0);
+  fail_if (gst_planar_audio_adapter_peek_planes (adapter, 1, planes, NULL,
+          NULL));
+
+  g_object_unref (adapter);
+}
+
+GST_END_TEST;
+
 static Suite *
 planar_audio_adapter_suite (void)
 {
@@ -354,6 +484,7 @@ planar_audio_adapter_suite (void)
   tcase_add_test (tc_chain, test_retrieve_smaller_for_read);
   tcase_add_test (tc_chain, test_retrieve_smaller_for_write);
   tcase_add_test (tc_chain, test_retrieve_combined);
+  tcase_add_test (tc_chain, test_ring_buffer);
 
   return s;
 }
@@ -0,0 +1,189 @@
+/* GStreamer
+ *
+ * unit test for GstTranscoder
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/pbutils/pbutils.h>
+#include <gst/transcoder/gsttranscoder.h>
+#include <glib/gstdio.h>
+
+#define N_FRAMES 75
+#define FRAME_DURATION (GST_SECOND / 25)
+
+/* JPEG frames are all keyframes, so the input can be split anywhere */
+#define PROFILE "video/x-matroska:image/jpeg"
+
+static const gchar *required_elements[] = {
+  "videotestsrc", "jpegenc", "jpegdec", "matroskamux", "matroskademux",
+  "splitmuxsrc"
+};
+
+static gchar *
+generate_input (const gchar * dir)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  gchar *location, *desc;
+
+  location = g_build_filename (dir, "input.mkv", NULL);
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d ! "
+      "video/x-raw,width=64,height=48,framerate=25/1 ! jpegenc ! "
+      "matroskamux ! filesink location=\"%s\"", N_FRAMES, location);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return location;
+}
+
+static GstClockTime
+discover_duration (const gchar * location)
+{
+  GstDiscoverer *discoverer;
+  GstDiscovererInfo *info;
+  GstClockTime duration;
+  GError *err = NULL;
+  gchar *uri;
+
+  discoverer = gst_discoverer_new (10 * GST_SECOND, &err);
+  fail_unless (discoverer != NULL, "%s", err ? err->message : "");
+
+  uri = gst_filename_to_uri (location, NULL);
+  info = gst_discoverer_discover_uri (discoverer, uri, &err);
+  fail_unless (info != NULL, "%s", err ? err->message : "");
+  fail_unless_equals_int (gst_discoverer_info_get_result (info),
+      GST_DISCOVERER_OK);
+  duration = gst_discoverer_info_get_duration (info);
+
+  gst_discoverer_info_unref (info);
+  gst_object_unref (discoverer);
+  g_free (uri);
+
+  return duration;
+}
+
+static void
+check_transcode (guint n_chunks)
+{
+  GstTranscoder *transcoder;
+  GstClockTime in_duration, out_duration;
+  GError *err = NULL;
+  gchar *dir, *input, *output, *src_uri, *dest_uri;
+  const gchar *name;
+  GDir *listing;
+
+  dir = g_dir_make_tmp ("gst-transcoder-XXXXXX", NULL);
+  fail_unless (dir != NULL);
+  input = generate_input (dir);
+  output = g_build_filename (dir, "output.mkv", NULL);
+  src_uri = gst_filename_to_uri (input, NULL);
+  dest_uri = gst_filename_to_uri (output, NULL);
+
+  transcoder = gst_transcoder_new (src_uri, dest_uri, PROFILE);
+  fail_unless (transcoder != NULL);
+  g_object_set (transcoder, "n-chunks", n_chunks, NULL);
+
+  fail_unless (gst_transcoder_run (transcoder, &err), "%s",
+      err ? err->message : "");
+  gst_object_unref (transcoder);
+
+  /* The chunks cover the whole input, without gaps or overlaps */
+  in_duration = discover_duration (input);
+  out_duration = discover_duration (output);
+  fail_unless (GST_CLOCK_TIME_IS_VALID (in_duration));
+  fail_unless (GST_CLOCK_TIME_IS_VALID (out_duration));
+  fail_unless (ABS (GST_CLOCK_DIFF (in_duration, out_duration)) <=
+      FRAME_DURATION, "%u chunks: output lasts %" GST_TIME_FORMAT
+      " instead of %" GST_TIME_FORMAT, n_chunks,
+      GST_TIME_ARGS (out_duration), GST_TIME_ARGS (in_duration));
+
+  /* and the temporary chunks were removed */
+  listing = g_dir_open (dir, 0, NULL);
+  fail_unless (listing != NULL);
+  while ((name = g_dir_read_name (listing))) {
+    fail_unless (g_str_equal (name, "input.mkv")
+        || g_str_equal (name, "output.mkv"), "%s was left behind", name);
+  }
+  g_dir_close (listing);
+
+  g_unlink (input);
+  g_unlink (output);
+  g_rmdir (dir);
+
+  g_free (src_uri);
+  g_free (dest_uri);
+  g_free (input);
+  g_free (output);
+  g_free (dir);
+}
+
+GST_START_TEST (test_linear)
+{
+  check_transcode (1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_chunked)
+{
+  check_transcode (3);
+  check_transcode (7);
+}
+
+GST_END_TEST;
+
+static Suite *
+transcoder_suite (void)
+{
+  Suite *s = suite_create ("transcoder");
+  TCase *tc_chain = tcase_create ("general");
+  guint i;
+
+  suite_add_tcase (s, tc_chain);
+
+  for (i = 0; i < G_N_ELEMENTS (required_elements); i++) {
+    if (!gst_registry_check_feature_version (gst_registry_get (),
+            required_elements[i], GST_VERSION_MAJOR, GST_VERSION_MINOR, 0)) {
+      GST_WARNING ("%s element not available, skipping tests",
+          required_elements[i]);
+      return s;
+    }
+  }
+
+  tcase_set_timeout (tc_chain, 60);
+  tcase_add_test (tc_chain, test_linear);
+  tcase_add_test (tc_chain, test_chunked);
+
+  return s;
+}
+
+GST_CHECK_MAIN (transcoder);
@@ -0,0 +1,123 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures audiomixmatrix throughput for a 64 channel 48 kHz stream with
+ * identity, permutation and dense matrices, in interleaved and
+ * non-interleaved layout, once on the streaming thread only and once with
+ * threading:
+ *
+ *   audiomixmatrix-bench [seconds] [channels]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#include "bench-common.h"
+
+typedef enum
+{
+  MATRIX_IDENTITY,
+  MATRIX_PERMUTATION,
+  MATRIX_DENSE
+} MatrixType;
+
+static gchar *
+make_matrix (MatrixType type, gint channels)
+{
+  GString *s = g_string_new ("<");
+  gint in, out;
+
+  for (out = 0; out < channels; out++) {
+    g_string_append (s, out ? ", <" : "<");
+    for (in = 0; in < channels; in++) {
+      gdouble coefficient;
+
+      switch (type) {
+        case MATRIX_IDENTITY:
+          coefficient = in == out;
+          break;
+        case MATRIX_PERMUTATION:
+          coefficient = in == channels - 1 - out;
+          break;
+        default:
+          coefficient = 1.0 / channels;
+          break;
+      }
+      g_string_append_printf (s, in ? ", (double)%g" : "(double)%g",
+          coefficient);
+    }
+    g_string_append (s, ">");
+  }
+  g_string_append (s, ">");
+
+  return g_string_free (s, FALSE);
+}
+
+int
+main (int argc, char **argv)
+{
+  const gchar *matrices[] = { "identity", "permutation", "dense" };
+  const gchar *layouts[] = { "interleaved", "non-interleaved" };
+  guint n_threads[] = { 1, 0 };
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  const gchar *format = "F32LE";
+#else
+  const gchar *format = "F32BE";
+#endif
+  gint seconds = 60, channels = 64, n_buffers;
+  guint i, j, k;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    seconds = atoi (argv[1]);
+  if (argc > 2)
+    channels = atoi (argv[2]);
+
+  /* 1024 samples per buffer at 48 kHz */
+  n_buffers = seconds * 48000 / 1024;
+
+  for (i = 0; i < G_N_ELEMENTS (matrices); i++) {
+    gchar *matrix = make_matrix (i, channels);
+
+    for (j = 0; j < G_N_ELEMENTS (layouts); j++) {
+      for (k = 0; k < G_N_ELEMENTS (n_threads); k++) {
+        gchar *desc;
+        gdouble secs;
+
+        desc = g_strdup_printf ("audiotestsrc num-buffers=%d "
+            "samplesperbuffer=1024 ! audio/x-raw,format=%s,rate=48000,"
+            "channels=%d,layout=%s ! audiomixmatrix in-channels=%d "
+            "out-channels=%d channel-mask=-1 n-threads=%u matrix=\"%s\" "
+            "! fakesink sync=false", n_buffers, format, channels, layouts[j],
+            channels, channels, n_threads[k], matrix);
+        secs = bench_run_pipeline (desc);
+        g_free (desc);
+
+        if (secs <= 0)
+          return 1;
+
+        g_print ("%-11s %-15s n-threads=%u: %8.1fx realtime\n", matrices[i],
+            layouts[j], n_threads[k], n_buffers * 1024 / 48000.0 / secs);
+      }
+    }
+    g_free (matrix);
+  }
+
+  return 0;
+}
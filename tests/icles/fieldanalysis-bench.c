@@ -0,0 +1,76 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures fieldanalysis throughput for progressive and interlaced input with
+ * both frame metrics, once on the streaming thread only and once with slice
+ * threading:
+ *
+ *   fieldanalysis-bench [n-frames] [width] [height]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#include "bench-common.h"
+
+int
+main (int argc, char **argv)
+{
+  const gchar *inputs[][2] = {
+    {"progressive", ""},
+    {"interlaced", "! interlace field-pattern=2:2 "},
+  };
+  const gchar *metrics[] = { "5-tap", "windowed-comb" };
+  guint n_threads[] = { 1, 0 };
+  gint n_frames = 300, width = 1920, height = 1080;
+  guint i, j, k;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_frames = atoi (argv[1]);
+  if (argc > 2)
+    width = atoi (argv[2]);
+  if (argc > 3)
+    height = atoi (argv[3]);
+
+  for (i = 0; i < G_N_ELEMENTS (inputs); i++) {
+    for (j = 0; j < G_N_ELEMENTS (metrics); j++) {
+      for (k = 0; k < G_N_ELEMENTS (n_threads); k++) {
+        gchar *desc;
+        gdouble secs;
+
+        desc = g_strdup_printf ("videotestsrc num-buffers=%d pattern=ball "
+            "! video/x-raw,format=I420,width=%d,height=%d,framerate=30/1 %s"
+            "! fieldanalysis frame-metric=%s n-threads=%u "
+            "! fakesink sync=false", n_frames, width, height, inputs[i][1],
+            metrics[j], n_threads[k]);
+        secs = bench_run_pipeline (desc);
+        g_free (desc);
+
+        if (secs <= 0)
+          return 1;
+
+        g_print ("%-12s %-14s n-threads=%u: %8.1f fps\n", inputs[i][0],
+            metrics[j], n_threads[k], n_frames / secs);
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures how much faster than realtime freeverb processes 48 kHz stereo
+ * and 5.1 input, in both supported sample formats:
+ *
+ *   freeverb-bench [seconds]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#include "bench-common.h"
+
+int
+main (int argc, char **argv)
+{
+  const gchar *layouts[][2] = {
+    {"stereo", "channels=2"},
+    {"5.1", "channels=6,channel-mask=(bitmask)0x3f"},
+  };
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  const gchar *formats[] = { "F32LE", "S16LE" };
+#else
+  const gchar *formats[] = { "F32BE", "S16BE" };
+#endif
+  gint seconds = 60, n_buffers;
+  guint i, j;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    seconds = atoi (argv[1]);
+
+  /* 1024 samples per buffer at 48 kHz */
+  n_buffers = seconds * 48000 / 1024;
+
+  for (i = 0; i < G_N_ELEMENTS (layouts); i++) {
+    for (j = 0; j < G_N_ELEMENTS (formats); j++) {
+      gchar *desc;
+      gdouble secs;
+
+      desc = g_strdup_printf ("audiotestsrc num-buffers=%d wave=pink-noise "
+          "samplesperbuffer=1024 ! audio/x-raw,rate=48000,format=%s,%s "
+          "! freeverb ! fakesink sync=false", n_buffers,
+          formats[j], layouts[i][1]);
+      secs = bench_run_pipeline (desc);
+      g_free (desc);
+
+      if (secs <= 0)
+        return 1;
+
+      g_print ("%-6s %-5s: %8.1fx realtime\n", layouts[i][0], formats[j],
+          n_buffers * 1024 / 48000.0 / secs);
+    }
+  }
+
+  return 0;
+}
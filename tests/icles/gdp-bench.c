@@ -0,0 +1,178 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures the raw video throughput of gdppay and gdpdepay, with and without
+ * payload CRC:
+ *
+ *   gdp-bench [frames] [width] [height]
+ *
+ * The payloaded stream is written to a temporary file which is then read
+ * back in 64 kB blocks, like data received from a socket.
+ */
+
+#include <stdlib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+static gint n_frames = 500;
+static gint width = 1920;
+static gint height = 1080;
+
+static void
+push_frames (GstElement * appsrc)
+{
+  GstBuffer *frame;
+  GstFlowReturn ret;
+  gsize size = width * height * 3 / 2;
+  gint i;
+
+  frame = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_memset (frame, 0, 0x80, size);
+
+  /* all the frames share the memory of the first one */
+  for (i = 0; i < n_frames; i++) {
+    GstBuffer *buf = gst_buffer_copy (frame);
+
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale (i, GST_SECOND, 30);
+    GST_BUFFER_DURATION (buf) = GST_SECOND / 30;
+    g_signal_emit_by_name (appsrc, "push-buffer", buf, &ret);
+    gst_buffer_unref (buf);
+  }
+  g_signal_emit_by_name (appsrc, "end-of-stream", &ret);
+
+  gst_buffer_unref (frame);
+}
+
+static gdouble
+run_pipeline (const gchar * description)
+{
+  GstElement *pipeline, *src;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+  gint64 start, end;
+  gdouble ret = -1;
+
+  pipeline = gst_parse_launch (description, &err);
+  if (!pipeline) {
+    g_printerr ("Failed to create '%s': %s\n", description, err->message);
+    g_clear_error (&err);
+    return -1;
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  start = g_get_monotonic_time ();
+  if (src) {
+    GstCaps *caps;
+
+    caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING,
+        "I420", "width", G_TYPE_INT, width, "height", G_TYPE_INT, height,
+        "framerate", GST_TYPE_FRACTION, 30, 1, NULL);
+    g_object_set (src, "caps", caps, "format", GST_FORMAT_TIME,
+        "max-bytes", (guint64) 0, NULL);
+    gst_caps_unref (caps);
+    push_frames (src);
+    gst_object_unref (src);
+  }
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  end = g_get_monotonic_time ();
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("Error: %s\n", err->message);
+    g_clear_error (&err);
+  } else {
+    ret = MAX (end - start, 1) / (gdouble) G_USEC_PER_SEC;
+  }
+
+  gst_message_unref (msg);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return ret;
+}
+
+static void
+report (const gchar * what, gboolean crc, gdouble seconds)
+{
+  gdouble megabytes = n_frames * (width * height * 3 / 2) / 1048576.0;
+
+  if (seconds < 0)
+    return;
+
+  g_print ("%-16s crc-payload=%-5s: %8.1f MB/s, %8.1f frames/s\n", what,
+      crc ? "true" : "false", megabytes / seconds, n_frames / seconds);
+}
+
+int
+main (int argc, char **argv)
+{
+  gchar *filename, *description;
+  gint fd, crc;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_frames = atoi (argv[1]);
+  if (argc > 2)
+    width = atoi (argv[2]);
+  if (argc > 3)
+    height = atoi (argv[3]);
+
+  fd = g_file_open_tmp ("gdp-bench-XXXXXX", &filename, NULL);
+  if (fd < 0) {
+    g_printerr ("Failed to create a temporary file\n");
+    return 1;
+  }
+  g_close (fd, NULL);
+
+  for (crc = 0; crc < 2; crc++) {
+    const gchar *crc_str = crc ? "true" : "false";
+
+    description = g_strdup_printf ("appsrc name=src ! gdppay crc-payload=%s "
+        "! fakesink sync=false", crc_str);
+    report ("gdppay", crc, run_pipeline (description));
+    g_free (description);
+
+    description = g_strdup_printf ("appsrc name=src ! gdppay crc-payload=%s "
+        "! gdpdepay ! fakesink sync=false", crc_str);
+    report ("in-process", crc, run_pipeline (description));
+    g_free (description);
+
+    description = g_strdup_printf ("appsrc name=src ! gdppay crc-payload=%s "
+        "! filesink location=\"%s\"", crc_str, filename);
+    run_pipeline (description);
+    g_free (description);
+
+    description = g_strdup_printf ("filesrc location=\"%s\" blocksize=65536 "
+        "! gdpdepay ! fakesink sync=false", filename);
+    report ("gdpdepay", crc, run_pipeline (description));
+    g_free (description);
+  }
+
+  g_unlink (filename);
+  g_free (filename);
+
+  return 0;
+}
@@ -0,0 +1,175 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures how many raw video frames per second ipcpipelinesink sends to an
+ * ipcpipelinesrc in a child process, through the socket and through shared
+ * memory:
+ *
+ *   ipcpipeline-bench [frames] [width] [height]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <gst/gst.h>
+
+static gint n_frames = 300;
+static gint width = 3840;
+static gint height = 2160;
+
+static void
+run_slave (int fd)
+{
+  GstElement *pipeline, *src, *sink;
+  GMainLoop *loop;
+
+  pipeline = gst_element_factory_make ("ipcslavepipeline", NULL);
+  src = gst_element_factory_make ("ipcpipelinesrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (src, "fdin", fd, "fdout", fd, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  gst_element_link (src, sink);
+
+  /* the slave follows the state of the master, until it gets killed */
+  loop = g_main_loop_new (NULL, FALSE);
+  g_main_loop_run (loop);
+}
+
+static gdouble
+run_master (int fd, guint shm_size)
+{
+  GstElement *pipeline, *sink;
+  GstMessage *msg;
+  GError *err = NULL;
+  gchar *description;
+  gint64 start, end;
+  gdouble ret = -1;
+
+  description = g_strdup_printf ("videotestsrc num-buffers=%d pattern=black "
+      "! video/x-raw,format=I420,width=%d,height=%d,framerate=30/1 "
+      "! ipcpipelinesink name=sink", n_frames, width, height);
+  pipeline = gst_parse_launch (description, &err);
+  g_free (description);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return -1;
+  }
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_object_set (sink, "fdin", fd, "fdout", fd, "shm-size", shm_size, NULL);
+  gst_object_unref (sink);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  end = g_get_monotonic_time ();
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("Error: %s\n", err->message);
+    g_clear_error (&err);
+  } else {
+    ret = MAX (end - start, 1) / (gdouble) G_USEC_PER_SEC;
+  }
+
+  gst_message_unref (msg);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return ret;
+}
+
+/* Forks a slave process, before any GStreamer thread is started, and
+ * returns the socket to talk to it */
+static int
+start_slave (pid_t * pid, int *argc, char ***argv)
+{
+  int sockets[2];
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sockets) ||
+      fcntl (sockets[0], F_SETFL, O_NONBLOCK) < 0 ||
+      fcntl (sockets[1], F_SETFL, O_NONBLOCK) < 0) {
+    g_printerr ("Error creating sockets: %s\n", strerror (errno));
+    exit (1);
+  }
+
+  *pid = fork ();
+  if (*pid < 0) {
+    g_printerr ("Error forking: %s\n", strerror (errno));
+    exit (1);
+  } else if (*pid == 0) {
+    close (sockets[0]);
+    gst_init (argc, argv);
+    run_slave (sockets[1]);
+    _exit (0);
+  }
+
+  close (sockets[1]);
+  return sockets[0];
+}
+
+static void
+run (int fd, pid_t pid, guint shm_size)
+{
+  gdouble seconds;
+
+  seconds = run_master (fd, shm_size);
+  kill (pid, SIGTERM);
+  waitpid (pid, NULL, 0);
+  close (fd);
+
+  if (seconds < 0)
+    return;
+
+  g_print ("shm-size=%-10u: %8.1f frames/s, %8.1f MB/s\n", shm_size,
+      n_frames / seconds,
+      n_frames * (width * height * 3 / 2) / 1048576.0 / seconds);
+}
+
+int
+main (int argc, char **argv)
+{
+  pid_t socket_pid, shm_pid;
+  int socket_fd, shm_fd;
+
+  if (argc > 1)
+    n_frames = atoi (argv[1]);
+  if (argc > 2)
+    width = atoi (argv[2]);
+  if (argc > 3)
+    height = atoi (argv[3]);
+
+  socket_fd = start_slave (&socket_pid, &argc, &argv);
+  shm_fd = start_slave (&shm_pid, &argc, &argv);
+
+  gst_init (&argc, &argv);
+
+  run (socket_fd, socket_pid, 0);
+  run (shm_fd, shm_pid, 8 * (width * height * 3 / 2));
+
+  return 0;
+}
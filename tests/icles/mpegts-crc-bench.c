@@ -0,0 +1,98 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Compares gst_mpegts_calc_crc32() against a byte-at-a-time table lookup
+ * for typical PSI/SI section sizes, up to the 4096 bytes of EIT sections:
+ *
+ *   mpegts-crc-bench [megabytes]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/mpegts/mpegts.h>
+
+static guint32 crc_tab[256];
+
+static guint32
+crc32_bytewise (const guint8 * data, gsize len)
+{
+  guint32 crc = 0xffffffff;
+
+  while (len--)
+    crc = (crc << 8) ^ crc_tab[((crc >> 24) ^ *data++) & 0xff];
+
+  return crc;
+}
+
+int
+main (int argc, char **argv)
+{
+  const gsize sizes[] = { 16, 184, 1024, 4096, 65536 };
+  gint megabytes = 256;
+  guint8 *data;
+  guint i, j;
+
+  gst_init (&argc, &argv);
+  gst_mpegts_initialize ();
+
+  if (argc > 1)
+    megabytes = atoi (argv[1]);
+
+  for (i = 0; i < 256; i++) {
+    guint32 c = i << 24;
+
+    for (j = 0; j < 8; j++)
+      c = (c & 0x80000000) ? (c << 1) ^ 0x04c11db7 : c << 1;
+    crc_tab[i] = c;
+  }
+
+  data = g_malloc (sizes[G_N_ELEMENTS (sizes) - 1]);
+  for (i = 0; i < sizes[G_N_ELEMENTS (sizes) - 1]; i++)
+    data[i] = g_random_int ();
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    guint64 iterations = ((guint64) megabytes << 20) / sizes[i];
+    guint32 ref = 0, crc = 0;
+    gint64 start, t_ref, t_crc;
+    guint64 n;
+
+    start = g_get_monotonic_time ();
+    for (n = 0; n < iterations; n++)
+      ref ^= crc32_bytewise (data, sizes[i]);
+    t_ref = MAX (g_get_monotonic_time () - start, 1);
+
+    start = g_get_monotonic_time ();
+    for (n = 0; n < iterations; n++)
+      crc ^= gst_mpegts_calc_crc32 (data, sizes[i]);
+    t_crc = MAX (g_get_monotonic_time () - start, 1);
+
+    if (crc != ref) {
+      g_printerr ("CRC mismatch for %" G_GSIZE_FORMAT " bytes\n", sizes[i]);
+      return 1;
+    }
+
+    g_print ("%6" G_GSIZE_FORMAT " bytes: bytewise %8.1f MB/s, "
+        "gst_mpegts_calc_crc32 %8.1f MB/s\n", sizes[i],
+        megabytes * (gdouble) G_USEC_PER_SEC / t_ref,
+        megabytes * (gdouble) G_USEC_PER_SEC / t_crc);
+  }
+
+  g_free (data);
+
+  return 0;
+}
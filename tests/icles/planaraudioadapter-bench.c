@@ -0,0 +1,147 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures how fast GstPlanarAudioAdapter turns 441 sample F32 buffers into
+ * blocks of 160 samples, like webrtcdsp does, with the queue of buffers and
+ * take_buffer(), and with the ring buffer and peek_planes():
+ *
+ *   planaraudioadapter-bench [seconds of audio] [channels]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+#include <gst/audio/gstplanaraudioadapter.h>
+
+#define RATE 48000
+#define IN_SAMPLES 441
+#define BLOCK_SAMPLES 160
+
+static gint seconds = 600;
+static gint channels = 8;
+
+/* Stands for the processing of a block, so that the samples are read */
+static gfloat
+process_block (gfloat ** planes, gsize n)
+{
+  gfloat sum = 0.0f;
+  gint c;
+  gsize i;
+
+  for (c = 0; c < channels; c++) {
+    for (i = 0; i < n; i++)
+      sum += planes[c][i];
+  }
+
+  return sum;
+}
+
+static gdouble
+run (GstAudioInfo * info, GstBuffer * input, gboolean ring_buffer)
+{
+  GstPlanarAudioAdapter *adapter;
+  gfloat **planes = g_newa (gfloat *, channels);
+  gfloat **wrap_planes = g_newa (gfloat *, channels);
+  guint64 n_buffers = (guint64) seconds * RATE / IN_SAMPLES, i;
+  gint64 start, end;
+  gfloat sum = 0.0f;
+
+  adapter = gst_planar_audio_adapter_new ();
+  if (ring_buffer)
+    gst_planar_audio_adapter_configure_ring_buffer (adapter, info, 1024);
+  else
+    gst_planar_audio_adapter_configure (adapter, info);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_buffers; i++) {
+    gst_planar_audio_adapter_push (adapter, gst_buffer_ref (input));
+
+    while (gst_planar_audio_adapter_available (adapter) >= BLOCK_SAMPLES) {
+      if (ring_buffer) {
+        gsize wrap_samples;
+
+        gst_planar_audio_adapter_peek_planes (adapter, BLOCK_SAMPLES,
+            (gpointer *) planes, (gpointer *) wrap_planes, &wrap_samples);
+        sum += process_block (planes, BLOCK_SAMPLES - wrap_samples);
+        if (wrap_samples)
+          sum += process_block (wrap_planes, wrap_samples);
+        gst_planar_audio_adapter_flush (adapter, BLOCK_SAMPLES);
+      } else {
+        GstBuffer *block;
+        GstAudioBuffer abuf;
+
+        block = gst_planar_audio_adapter_take_buffer (adapter, BLOCK_SAMPLES,
+            GST_MAP_READ);
+        gst_audio_buffer_map (&abuf, info, block, GST_MAP_READ);
+        sum += process_block ((gfloat **) abuf.planes, BLOCK_SAMPLES);
+        gst_audio_buffer_unmap (&abuf);
+        gst_buffer_unref (block);
+      }
+    }
+  }
+  end = g_get_monotonic_time ();
+
+  g_object_unref (adapter);
+
+  /* keeps the sums from being optimized away */
+  if (sum == 1.0f)
+    g_print (" ");
+
+  return MAX (end - start, 1) / (gdouble) G_USEC_PER_SEC;
+}
+
+int
+main (int argc, char **argv)
+{
+  GstAudioInfo info;
+  GstBuffer *input;
+  GstMapInfo map;
+  gdouble queue_time, ring_time;
+  gsize i;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    seconds = atoi (argv[1]);
+  if (argc > 2)
+    channels = atoi (argv[2]);
+
+  gst_audio_info_init (&info);
+  gst_audio_info_set_format (&info, GST_AUDIO_FORMAT_F32, RATE, channels,
+      NULL);
+  info.layout = GST_AUDIO_LAYOUT_NON_INTERLEAVED;
+
+  input = gst_buffer_new_allocate (NULL, IN_SAMPLES * info.bpf, NULL);
+  gst_buffer_map (input, &map, GST_MAP_WRITE);
+  for (i = 0; i < map.size / sizeof (gfloat); i++)
+    ((gfloat *) map.data)[i] = g_random_double_range (-1.0, 1.0);
+  gst_buffer_unmap (input, &map);
+  gst_buffer_add_audio_meta (input, &info, IN_SAMPLES, NULL);
+
+  queue_time = run (&info, input, FALSE);
+  ring_time = run (&info, input, TRUE);
+
+  g_print ("%d channels, %d s of audio\n", channels, seconds);
+  g_print ("queue      : %8.1f x realtime\n", seconds / queue_time);
+  g_print ("ring buffer: %8.1f x realtime (%.2fx)\n", seconds / ring_time,
+      queue_time / ring_time);
+
+  gst_buffer_unref (input);
+
+  return 0;
+}
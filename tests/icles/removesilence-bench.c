@@ -0,0 +1,82 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures how much faster than realtime removesilence analyses 16 kHz mono
+ * and 48 kHz multi-channel input in batch, with noise that is always
+ * analysed down to the zero crossing rate and with silence:
+ *
+ *   removesilence-bench [seconds]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#include "bench-common.h"
+
+int
+main (int argc, char **argv)
+{
+  const struct
+  {
+    const gchar *name;
+    gint rate;
+    gint channels;
+  } layouts[] = {
+    {"mono", 16000, 1},
+    {"stereo", 48000, 2},
+    {"5.1", 48000, 6},
+  };
+  const gchar *waves[] = { "white-noise", "silence" };
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  const gchar *format = "S16LE";
+#else
+  const gchar *format = "S16BE";
+#endif
+  gint seconds = 600;
+  guint i, j;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    seconds = atoi (argv[1]);
+
+  for (i = 0; i < G_N_ELEMENTS (layouts); i++) {
+    for (j = 0; j < G_N_ELEMENTS (waves); j++) {
+      /* 20 ms per buffer */
+      gint samples_per_buffer = layouts[i].rate / 50;
+      gint n_buffers = seconds * 50;
+      gchar *desc;
+      gdouble secs;
+
+      desc = g_strdup_printf ("audiotestsrc num-buffers=%d wave=%s "
+          "samplesperbuffer=%d ! audio/x-raw,format=%s,rate=%d,channels=%d "
+          "! removesilence ! fakesink sync=false", n_buffers, waves[j],
+          samples_per_buffer, format, layouts[i].rate, layouts[i].channels);
+      secs = bench_run_pipeline (desc);
+      g_free (desc);
+
+      if (secs <= 0)
+        return 1;
+
+      g_print ("%-6s %-11s: %8.1fx realtime\n", layouts[i].name, waves[j],
+          seconds / secs);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,162 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures how long switchbin takes to switch between two paths, for each
+ * standby state of the paths that are not the current one:
+ *
+ *   switchbin-bench [switches] [path description]
+ *
+ * Every buffer alternates between two video sizes, so each one makes
+ * switchbin change its path.
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+static gint n_switches = 200;
+static const gchar *path_description =
+    "videoconvert ! videoscale ! video/x-raw,width=320,height=240";
+
+static void
+push_frames (GstElement * appsrc)
+{
+  GstCaps *caps[2];
+  GstFlowReturn ret;
+  gint i;
+
+  caps[0] = gst_caps_from_string ("video/x-raw,format=I420,"
+      "width=640,height=480,framerate=30/1");
+  caps[1] = gst_caps_from_string ("video/x-raw,format=I420,"
+      "width=1280,height=720,framerate=30/1");
+
+  for (i = 0; i < n_switches; i++) {
+    GstStructure *s = gst_caps_get_structure (caps[i % 2], 0);
+    GstBuffer *buf;
+    GstSample *sample;
+    gint w, h;
+
+    gst_structure_get_int (s, "width", &w);
+    gst_structure_get_int (s, "height", &h);
+    buf = gst_buffer_new_allocate (NULL, w * h * 3 / 2, NULL);
+    gst_buffer_memset (buf, 0, 0x80, w * h * 3 / 2);
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale (i, GST_SECOND, 30);
+    GST_BUFFER_DURATION (buf) = GST_SECOND / 30;
+
+    sample = gst_sample_new (buf, caps[i % 2], NULL, NULL);
+    g_signal_emit_by_name (appsrc, "push-sample", sample, &ret);
+    gst_sample_unref (sample);
+    gst_buffer_unref (buf);
+  }
+  g_signal_emit_by_name (appsrc, "end-of-stream", &ret);
+
+  gst_caps_unref (caps[0]);
+  gst_caps_unref (caps[1]);
+}
+
+static GstElement *
+make_path_element (void)
+{
+  GError *err = NULL;
+  GstElement *bin;
+
+  bin = gst_parse_bin_from_description (path_description, TRUE, &err);
+  if (!bin) {
+    g_printerr ("Failed to create '%s': %s\n", path_description,
+        err->message);
+    g_clear_error (&err);
+    exit (1);
+  }
+
+  return bin;
+}
+
+static void
+run (GstState standby_state)
+{
+  GstElement *pipeline, *src, *switchbin, *sink;
+  GstCaps *c0, *c1;
+  GstMessage *msg;
+  GError *err = NULL;
+  gint64 start, end;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("appsrc", NULL);
+  switchbin = gst_element_factory_make ("switchbin", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  if (!src || !switchbin || !sink) {
+    g_printerr ("Missing elements\n");
+    exit (1);
+  }
+
+  g_object_set (src, "format", GST_FORMAT_TIME, "max-bytes", (guint64) 0,
+      NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+
+  c0 = gst_caps_from_string ("video/x-raw,width=640");
+  c1 = gst_caps_from_string ("video/x-raw,width=1280");
+  g_object_set (switchbin, "num-paths", 2, "standby-state", standby_state,
+      NULL);
+  gst_child_proxy_set (GST_CHILD_PROXY (switchbin),
+      "path0::element", make_path_element (), "path0::caps", c0,
+      "path1::element", make_path_element (), "path1::caps", c1, NULL);
+  gst_caps_unref (c0);
+  gst_caps_unref (c1);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, switchbin, sink, NULL);
+  gst_element_link_many (src, switchbin, sink, NULL);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = g_get_monotonic_time ();
+  push_frames (src);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  end = g_get_monotonic_time ();
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("Error: %s\n", err->message);
+    g_clear_error (&err);
+  } else {
+    g_print ("standby-state=%-8s: %8.1f us per switch\n",
+        gst_element_state_get_name (standby_state),
+        (end - start) / (gdouble) n_switches);
+  }
+
+  gst_message_unref (msg);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+int
+main (int argc, char **argv)
+{
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_switches = atoi (argv[1]);
+  if (argc > 2)
+    path_description = argv[2];
+
+  run (GST_STATE_NULL);
+  run (GST_STATE_READY);
+  run (GST_STATE_PAUSED);
+
+  return 0;
+}
@@ -0,0 +1,170 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures how long GstTranscoder takes to transcode a locally generated
+ * test file linearly and in chunks transcoded in parallel:
+ *
+ *   transcoder-bench [chunks] [seconds] [encoding profile]
+ *
+ * The test file is encoded with the same encoding profile, so it needs
+ * keyframes at least every seconds / chunks for all the chunks to be used.
+ */
+
+#include <stdlib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
+#include <gst/transcoder/gsttranscoder.h>
+
+static gint n_chunks = 4;
+static gint seconds = 60;
+static const gchar *profile_desc = "video/quicktime,variant=iso:video/x-h264";
+
+static GstEncodingProfile *
+make_profile (void)
+{
+  GstEncodingProfile *profile;
+  GValue value = G_VALUE_INIT;
+
+  g_value_init (&value, GST_TYPE_ENCODING_PROFILE);
+  if (!gst_value_deserialize (&value, profile_desc)) {
+    g_printerr ("Invalid encoding profile '%s'\n", profile_desc);
+    exit (1);
+  }
+  profile = g_value_dup_object (&value);
+  g_value_unset (&value);
+
+  return profile;
+}
+
+static gboolean
+generate_input (const gchar * location)
+{
+  GstElement *pipeline, *src, *capsfilter, *encodebin, *sink;
+  GstEncodingProfile *profile;
+  GstMessage *msg;
+  GstCaps *caps;
+  gboolean ret;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("videotestsrc", NULL);
+  capsfilter = gst_element_factory_make ("capsfilter", NULL);
+  encodebin = gst_element_factory_make ("encodebin", NULL);
+  sink = gst_element_factory_make ("filesink", NULL);
+
+  profile = make_profile ();
+  caps = gst_caps_from_string ("video/x-raw,width=1280,height=720,"
+      "framerate=30/1");
+  g_object_set (src, "num-buffers", seconds * 30, "pattern", 18, NULL);
+  g_object_set (capsfilter, "caps", caps, NULL);
+  g_object_set (encodebin, "profile", profile, NULL);
+  g_object_set (sink, "location", location, NULL);
+  gst_caps_unref (caps);
+  gst_object_unref (profile);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, capsfilter, encodebin, sink,
+      NULL);
+  if (!gst_element_link_many (src, capsfilter, encodebin, sink, NULL)) {
+    g_printerr ("Could not link the test file pipeline\n");
+    gst_object_unref (pipeline);
+    return FALSE;
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  ret = GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+  if (!ret)
+    g_printerr ("Could not generate the test file\n");
+
+  gst_message_unref (msg);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return ret;
+}
+
+static void
+run (const gchar * src_uri, const gchar * dest, guint chunks)
+{
+  GstTranscoder *transcoder;
+  GstEncodingProfile *profile;
+  GError *err = NULL;
+  gchar *dest_uri;
+  gint64 start, end;
+
+  dest_uri = gst_filename_to_uri (dest, NULL);
+  profile = make_profile ();
+  transcoder = gst_transcoder_new_full (src_uri, dest_uri, profile);
+  gst_object_unref (profile);
+  g_object_set (transcoder, "n-chunks", chunks, NULL);
+
+  start = g_get_monotonic_time ();
+  if (!gst_transcoder_run (transcoder, &err)) {
+    g_printerr ("Transcoding failed: %s\n", err->message);
+    g_clear_error (&err);
+  } else {
+    end = g_get_monotonic_time ();
+    g_print ("n-chunks=%-3u: %8.2f s, %6.1fx realtime\n", chunks,
+        (end - start) / (gdouble) G_USEC_PER_SEC,
+        seconds * (gdouble) G_USEC_PER_SEC / MAX (end - start, 1));
+  }
+
+  gst_object_unref (transcoder);
+  g_unlink (dest);
+  g_free (dest_uri);
+}
+
+int
+main (int argc, char **argv)
+{
+  gchar *dir, *input, *output, *src_uri;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_chunks = atoi (argv[1]);
+  if (argc > 2)
+    seconds = atoi (argv[2]);
+  if (argc > 3)
+    profile_desc = argv[3];
+
+  dir = g_dir_make_tmp ("transcoder-bench-XXXXXX", NULL);
+  if (!dir) {
+    g_printerr ("Could not create a temporary directory\n");
+    return 1;
+  }
+
+  input = g_build_filename (dir, "input", NULL);
+  output = g_build_filename (dir, "output", NULL);
+
+  if (generate_input (input)) {
+    src_uri = gst_filename_to_uri (input, NULL);
+    run (src_uri, output, 1);
+    run (src_uri, output, n_chunks);
+    g_free (src_uri);
+  }
+
+  g_unlink (input);
+  g_rmdir (dir);
+  g_free (input);
+  g_free (output);
+  g_free (dir);
+
+  return 0;
+}
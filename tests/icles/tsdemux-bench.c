@@ -0,0 +1,140 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Demuxes a transport stream with and without tsdemux:zero-copy and reports
+ * the time, CPU and number of payload bytes copied during PES reassembly:
+ *
+ *   tsdemux-bench FILE.ts [iterations]
+ *
+ * Use a long capture so that the file is served from the page cache after
+ * the first iteration.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <gst/gst.h>
+
+static void
+pad_added_cb (GstElement * demux, GstPad * pad, GstElement * pipeline)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, "async", FALSE, NULL);
+  gst_bin_add (GST_BIN (pipeline), sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+}
+
+static gboolean
+run_pipeline (const gchar * location, gboolean zero_copy, gdouble * wall,
+    gdouble * cpu, GstStructure ** stats)
+{
+  GstElement *pipeline, *src, *demux;
+  GstBus *bus;
+  GstMessage *msg;
+  gint64 start, end;
+  clock_t cpu_start, cpu_end;
+  gboolean ret = TRUE;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("filesrc", NULL);
+  demux = gst_element_factory_make ("tsdemux", NULL);
+  if (!src || !demux) {
+    g_printerr ("Missing filesrc or tsdemux\n");
+    return FALSE;
+  }
+
+  g_object_set (src, "location", location, NULL);
+  g_object_set (demux, "zero-copy", zero_copy, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, demux, NULL);
+  gst_element_link (src, demux);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added_cb), pipeline);
+
+  bus = gst_element_get_bus (pipeline);
+
+  start = g_get_monotonic_time ();
+  cpu_start = clock ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  cpu_end = clock ();
+  end = g_get_monotonic_time ();
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    GError *err = NULL;
+
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("Error: %s\n", err->message);
+    g_clear_error (&err);
+    ret = FALSE;
+  }
+
+  *wall = (end - start) / (gdouble) G_USEC_PER_SEC;
+  *cpu = (cpu_end - cpu_start) / (gdouble) CLOCKS_PER_SEC;
+  g_object_get (demux, "stats", stats, NULL);
+
+  gst_message_unref (msg);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return ret;
+}
+
+int
+main (int argc, char **argv)
+{
+  gint iterations = 3, i, mode;
+
+  gst_init (&argc, &argv);
+
+  if (argc < 2) {
+    g_printerr ("Usage: %s FILE.ts [iterations]\n", argv[0]);
+    return 1;
+  }
+  if (argc > 2)
+    iterations = atoi (argv[2]);
+
+  for (mode = 0; mode < 2; mode++) {
+    for (i = 0; i < iterations; i++) {
+      GstStructure *stats = NULL;
+      guint64 copied = 0, shared = 0, flattened = 0;
+      gdouble wall, cpu;
+
+      if (!run_pipeline (argv[1], mode, &wall, &cpu, &stats))
+        return 1;
+
+      gst_structure_get_uint64 (stats, "bytes-copied", &copied);
+      gst_structure_get_uint64 (stats, "bytes-shared", &shared);
+      gst_structure_get_uint64 (stats, "pes-flattened", &flattened);
+      gst_structure_free (stats);
+
+      g_print ("zero-copy=%-5s: %7.3f s wall, %7.3f s cpu, %12"
+          G_GUINT64_FORMAT " bytes copied, %12" G_GUINT64_FORMAT
+          " bytes shared, %8" G_GUINT64_FORMAT " PES flattened\n",
+          mode ? "true" : "false", wall, cpu, copied, shared, flattened);
+    }
+  }
+
+  return 0;
+}
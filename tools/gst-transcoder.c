@@ -62,6 +62,7 @@ static const gchar *HELP_SUMMARY =
 typedef struct
 {
   gint cpu_usage, rate;
+  gint chunks;
   gboolean list;
   GstEncodingProfile *profile;
   gchar *src_uri, *dest_uri, *encoding_format, *size;
@@ -327,6 +328,7 @@ main (int argc, char *argv[])
   GstTranscoderSignalAdapter *signal_adapter;
   Settings settings = {
     .cpu_usage = 100,
+    .chunks = 1,
     .rate = -1,
     .encoding_format = NULL,
     .size = NULL,
@@ -335,6 +337,8 @@ main (int argc, char *argv[])
   GOptionEntry options[] = {
     {"cpu-usage", 'c', 0, G_OPTION_ARG_INT, &settings.cpu_usage,
         "The CPU usage to target in the transcoding process", NULL},
+    {"chunks", 'n', 0, G_OPTION_ARG_INT, &settings.chunks,
+        "Split the input into that many parts, transcoded in parallel", NULL},
     {"list-targets", 'l', G_OPTION_ARG_NONE, 0, &settings.list,
         "List all encoding targets", NULL},
     {"size", 's', 0, G_OPTION_ARG_STRING, &settings.size,
@@ -417,6 +421,7 @@ main (int argc, char *argv[])
       settings.profile);
   gst_transcoder_set_avoid_reencoding (transcoder, TRUE);
   gst_transcoder_set_cpu_usage (transcoder, settings.cpu_usage);
+  g_object_set (transcoder, "n-chunks", CLAMP (settings.chunks, 1, 64), NULL);
 
   signal_adapter = gst_transcoder_get_signal_adapter (transcoder, NULL);
   g_signal_connect_swapped (signal_adapter, "position-updated",